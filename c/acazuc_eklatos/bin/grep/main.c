@@ -58,17 +58,44 @@ struct pattern
 {
 	regex_t regex;
 	char *str;
-	size_t len;
+	int cached;
+	size_t so; /* next match in the reader window */
+	size_t eo;
+};
+
+/*
+ * files are read in large chunks and each pattern is run once
+ * over all the complete lines of the chunk (REG_NEWLINE keeps
+ * the matches inside a line) instead of once per line: the
+ * position of the next match of every pattern is cached, and
+ * lines before it are known not to match
+ */
+struct reader
+{
+	FILE *fp;
+	char *buf;
+	size_t size;
+	size_t cap;
+	size_t pos; /* start of the next line */
+	size_t lines_end; /* end of the last complete line */
+	int eof;
+};
+
+struct line
+{
+	char *str;
+	struct match match;
+	int selected;
 };
 
+#define READ_CHUNK (64 * 1024)
+
 struct env
 {
 	const char *progname;
 	enum regex_type regex_type;
 	int opt;
 	int multiple;
-	regmatch_t *regmatches;
-	size_t regmatches_nb;
 	struct pattern *patterns;
 	size_t patterns_nb;
 	int has_written;
@@ -98,64 +125,182 @@ getline_no_nl(char **line, size_t *len, FILE *fp)
 	return 1;
 }
 
+static void
+reader_init(struct env *env, struct reader *rd, FILE *fp)
+{
+	memset(rd, 0, sizeof(*rd));
+	rd->fp = fp;
+	for (size_t i = 0; i < env->patterns_nb; ++i)
+		env->patterns[i].cached = 0;
+}
+
 static int
-match_line(struct env *env, const char *line, struct match *match)
+reader_fill(struct env *env, struct reader *rd)
 {
-	int matched = 0;
+	char *nl;
 
-	if (match)
+	if (rd->pos)
 	{
-		match->start = SIZE_MAX;
-		match->len = SIZE_MAX;
+		memmove(rd->buf, &rd->buf[rd->pos], rd->size - rd->pos);
+		rd->size -= rd->pos;
+		rd->pos = 0;
+		for (size_t i = 0; i < env->patterns_nb; ++i)
+			env->patterns[i].cached = 0;
 	}
-	switch (env->regex_type)
+	rd->lines_end = 0;
+	while (!rd->eof)
 	{
-		case REGEX_ERE:
-		case REGEX_BRE:
-			for (size_t i = 0; i < env->patterns_nb; ++i)
+		size_t ret;
+
+		if (rd->cap - rd->size < READ_CHUNK)
+		{
+			size_t cap = rd->cap ? rd->cap * 2 : READ_CHUNK * 4;
+			char *buf = realloc(rd->buf, cap + 1);
+			if (!buf)
 			{
-				struct pattern *pattern = &env->patterns[i];
-				int ret = regexec(&pattern->regex, line,
-				                  env->regmatches_nb,
-				                  env->regmatches, 0);
-				if (!!ret == !(env->opt & OPT_v))
-					continue;
-				if (match && !ret)
-				{
-					match->start = env->regmatches[0].rm_so;
-					match->len = env->regmatches[0].rm_eo - match->start;
-				}
-				matched = !ret;
-				break;
+				fprintf(stderr, "%s: realloc: %s\n", env->progname,
+				        strerror(errno));
+				return -1;
 			}
+			rd->buf = buf;
+			rd->cap = cap;
+		}
+		ret = fread(&rd->buf[rd->size], 1, rd->cap - rd->size, rd->fp);
+		if (!ret)
+		{
+			if (ferror(rd->fp))
+				return -1;
+			rd->eof = 1;
+			if (rd->size && rd->buf[rd->size - 1] != '\n')
+				rd->buf[rd->size++] = '\n';
 			break;
-		case REGEX_STR:
-			matched = 0;
-			for (size_t i = 0; i < env->patterns_nb; ++i)
-			{
-				struct pattern *pattern = &env->patterns[i];
-				char *it;
-				if (env->opt & OPT_i)
-					it = strcasestr(line, pattern->str);
-				else
-					it = strstr(line, pattern->str);
-				if (!it != !!(env->opt & OPT_v))
-					continue;
-				if (match && it)
-				{
-					match->start = it - line;
-					match->len = pattern->len;
-				}
-				matched = !!it;
-				break;
-			}
+		}
+		nl = memrchr(&rd->buf[rd->size], '\n', ret);
+		rd->size += ret;
+		if (nl)
 			break;
-		default:
-			return 0;
 	}
-	if (matched && (env->opt & OPT_q))
+	nl = memrchr(rd->buf, '\n', rd->size);
+	if (nl)
+		rd->lines_end = nl - rd->buf + 1;
+	return rd->lines_end != 0;
+}
+
+static void
+pattern_search(struct reader *rd, struct pattern *pattern, size_t from)
+{
+	regmatch_t m;
+
+	m.rm_so = from;
+	m.rm_eo = rd->lines_end - 1;
+	if (regexec(&pattern->regex, rd->buf, 1, &m, REG_STARTEND))
+	{
+		pattern->so = rd->lines_end;
+		pattern->eo = rd->lines_end;
+	}
+	else
+	{
+		pattern->so = m.rm_so;
+		pattern->eo = m.rm_eo;
+	}
+	pattern->cached = 1;
+}
+
+static int
+pattern_match(struct reader *rd, struct pattern *pattern, size_t ls,
+              size_t le, struct match *match)
+{
+	regmatch_t m;
+
+	if (!pattern->cached || pattern->so < ls)
+		pattern_search(rd, pattern, ls);
+	if (pattern->so > le)
+		return 0;
+	if (pattern->eo <= le)
+	{
+		match->start = pattern->so - ls;
+		match->len = pattern->eo - pattern->so;
+		return 1;
+	}
+	/* the match crossed a newline through a class such as
+	 * [[:space:]], retry within the line only
+	 */
+	pattern->cached = 0;
+	m.rm_so = ls;
+	m.rm_eo = le;
+	if (regexec(&pattern->regex, rd->buf, 1, &m, REG_STARTEND))
+		return 0;
+	match->start = m.rm_so - ls;
+	match->len = m.rm_eo - m.rm_so;
+	return 1;
+}
+
+static size_t
+first_match_line(struct env *env, struct reader *rd)
+{
+	size_t first = rd->lines_end;
+	char *nl;
+
+	for (size_t i = 0; i < env->patterns_nb; ++i)
+	{
+		struct pattern *pattern = &env->patterns[i];
+
+		if (!pattern->cached || pattern->so < rd->pos)
+			pattern_search(rd, pattern, rd->pos);
+		if (pattern->so < first)
+			first = pattern->so;
+	}
+	if (first == rd->lines_end)
+		return first;
+	nl = memrchr(&rd->buf[rd->pos], '\n', first - rd->pos);
+	return nl ? (size_t)(nl - rd->buf + 1) : rd->pos;
+}
+
+/*
+ * when skip is set and -v isn't, the lines without a match are
+ * not returned at all
+ */
+static int
+read_line(struct env *env, struct reader *rd, struct line *line, int skip)
+{
+	size_t ls;
+	size_t le;
+	int matched = 0;
+
+	while (1)
+	{
+		if (rd->pos == rd->lines_end)
+		{
+			int ret = reader_fill(env, rd);
+			if (ret <= 0)
+				return ret;
+			continue;
+		}
+		if (!skip || (env->opt & OPT_v))
+			break;
+		rd->pos = first_match_line(env, rd);
+		if (rd->pos != rd->lines_end)
+			break;
+	}
+	ls = rd->pos;
+	le = (char*)memchr(&rd->buf[ls], '\n', rd->lines_end - ls) - rd->buf;
+	rd->pos = le + 1;
+	line->match.start = SIZE_MAX;
+	line->match.len = SIZE_MAX;
+	for (size_t i = 0; i < env->patterns_nb; ++i)
+	{
+		if (pattern_match(rd, &env->patterns[i], ls, le, &line->match))
+		{
+			matched = 1;
+			break;
+		}
+	}
+	rd->buf[le] = '\0';
+	line->str = &rd->buf[ls];
+	line->selected = matched != !!(env->opt & OPT_v);
+	if (line->selected && (env->opt & OPT_q))
 		exit(EXIT_SUCCESS);
-	return matched;
+	return 1;
 }
 
 static void
@@ -231,18 +376,18 @@ print_separator(struct env *env)
 static int
 grep_normal(struct env *env, FILE *fp, const char *path)
 {
-	char *line = NULL;
-	size_t len = 0;
+	struct reader rd;
+	struct line line;
 	size_t n = 0;
 	size_t after = 0;
 	size_t last_before = 0;
 	size_t match_count = 0;
+	int ret;
 
-	while (getline_no_nl(&line, &len, fp))
+	reader_init(env, &rd, fp);
+	while ((ret = read_line(env, &rd, &line, 0)) > 0)
 	{
-		struct match match;
-
-		if (match_line(env, line, &match) && match_count < env->max)
+		if (line.selected && match_count < env->max)
 		{
 			if (env->after > 0)
 				after = env->after;
@@ -254,17 +399,18 @@ grep_normal(struct env *env, FILE *fp, const char *path)
 		else
 		{
 			if (match_count >= env->max)
-				return 0;
+				break;
 			if (env->before > 0)
 			{
 				struct before_line *before_line = &env->before_lines[n % env->before];
 				free(before_line->line);
-				before_line->line = strdup(line);
-				before_line->match = match;
+				before_line->line = strdup(line.str);
+				before_line->match = line.match;
 				if (!before_line->line)
 				{
 					fprintf(stderr, "%s: malloc: %s\n", env->progname,
 					        strerror(errno));
+					free(rd.buf);
 					return 1;
 				}
 			}
@@ -295,56 +441,68 @@ grep_normal(struct env *env, FILE *fp, const char *path)
 			if (!last_before || last_before != n)
 				print_separator(env);
 		}
-		print_line(env, path, line, &match, n);
+		print_line(env, path, line.str, &line.match, n);
 		env->has_written = 1;
 		n++;
 		match_count++;
 		last_before = n;
 	}
-	return ferror(fp);
+	free(rd.buf);
+	return ret < 0;
 }
 
 static int
 grep_filename(struct env *env, FILE *fp, const char *path)
 {
-	char *line = NULL;
-	size_t len = 0;
+	struct reader rd;
+	struct line line;
+	int matched = 0;
+	int ret;
 
-	while (getline_no_nl(&line, &len, fp))
+	reader_init(env, &rd, fp);
+	while ((ret = read_line(env, &rd, &line, 1)) > 0)
 	{
-		int matched = match_line(env, line, NULL);
-		if (((env->opt & OPT_l) && matched)
-		 || ((env->opt & OPT_L) && !matched))
+		if (line.selected)
 		{
-			if (env->colored)
-				printf("%s%s%s\n",
-				       env->colors[COLOR_PATH], path,
-				       env->colors[COLOR_RESET]);
-			else
-				printf("%s\n", path);
-			return 0;
+			matched = 1;
+			break;
 		}
 	}
-	return ferror(fp);
+	free(rd.buf);
+	if (ret < 0)
+		return 1;
+	if (matched == !!(env->opt & OPT_l))
+	{
+		if (env->colored)
+			printf("%s%s%s\n",
+			       env->colors[COLOR_PATH], path,
+			       env->colors[COLOR_RESET]);
+		else
+			printf("%s\n", path);
+	}
+	return 0;
 }
 
 static int
 grep_count(struct env *env, FILE *fp, const char *path)
 {
-	char *line = NULL;
-	size_t len = 0;
+	struct reader rd;
+	struct line line;
 	size_t match_count = 0;
+	int ret;
 
-	while (getline_no_nl(&line, &len, fp))
+	reader_init(env, &rd, fp);
+	while ((ret = read_line(env, &rd, &line, 1)) > 0)
 	{
-		if (match_line(env, line, NULL))
+		if (line.selected)
 		{
 			match_count++;
 			if (match_count >= env->max)
 				break;
 		}
 	}
-	if (ferror(fp))
+	free(rd.buf);
+	if (ret < 0)
 		return 1;
 	if (env->multiple || (env->opt & OPT_H))
 	{
@@ -509,14 +667,14 @@ end:
 }
 
 static int
-add_pattern(struct env *env, const char *str)
+add_pattern_str(struct env *env, const char *str, size_t len)
 {
 	struct pattern *new_patterns;
 	char *dup;
 
-	if (!*str)
+	if (!len)
 		return 0;
-	dup = strdup(str);
+	dup = strndup(str, len);
 	if (!dup)
 	{
 		fprintf(stderr, "%s: malloc: %s\n",
@@ -535,12 +693,85 @@ add_pattern(struct env *env, const char *str)
 		return 1;
 	}
 	new_patterns[env->patterns_nb].str = dup;
-	new_patterns[env->patterns_nb].len = strlen(dup);
 	env->patterns = new_patterns;
 	env->patterns_nb++;
 	return 0;
 }
 
+/* a newline separates patterns, as a pattern never spans lines */
+static int
+add_pattern(struct env *env, const char *str)
+{
+	const char *nl;
+
+	while ((nl = strchr(str, '\n')))
+	{
+		if (add_pattern_str(env, str, nl - str))
+			return 1;
+		str = nl + 1;
+	}
+	return add_pattern_str(env, str, strlen(str));
+}
+
+/* fixed strings go through the regex engine as an escaped bre,
+ * which is then searched for with memmem
+ */
+static char *
+escape_fixed(const char *str)
+{
+	char *ret;
+	size_t n = 0;
+
+	ret = malloc(strlen(str) * 2 + 1);
+	if (!ret)
+		return NULL;
+	for (; *str; ++str)
+	{
+		if (strchr(".[\\*^$", *str))
+			ret[n++] = '\\';
+		ret[n++] = *str;
+	}
+	ret[n] = '\0';
+	return ret;
+}
+
+static int
+compile_pattern(struct env *env, struct pattern *pattern)
+{
+	char *fixed = NULL;
+	int flags = REG_NEWLINE;
+	int ret;
+
+	if (env->opt & OPT_i)
+		flags |= REG_ICASE;
+	if (env->regex_type == REGEX_ERE)
+		flags |= REG_EXTENDED;
+	if (env->regex_type == REGEX_STR)
+	{
+		fixed = escape_fixed(pattern->str);
+		if (!fixed)
+		{
+			fprintf(stderr, "%s: malloc: %s\n",
+			        env->progname,
+			        strerror(errno));
+			return 1;
+		}
+	}
+	ret = regcomp(&pattern->regex, fixed ? fixed : pattern->str, flags);
+	free(fixed);
+	if (ret)
+	{
+		char buf[1024];
+		regerror(ret, &pattern->regex, buf, sizeof(buf));
+		fprintf(stderr, "%s: regcomp(%s): %s\n",
+		        env->progname,
+		        pattern->str,
+		        buf);
+		return 1;
+	}
+	return 0;
+}
+
 static int
 add_pattern_file(struct env *env, const char *filename)
 {
@@ -790,35 +1021,10 @@ main(int argc, char **argv)
 			return EXIT_FAILURE;
 		}
 	}
-	if (env.regex_type == REGEX_BRE || env.regex_type == REGEX_ERE)
+	for (size_t i = 0; i < env.patterns_nb; ++i)
 	{
-		for (size_t i = 0; i < env.patterns_nb; ++i)
-		{
-			struct pattern *pattern = &env.patterns[i];
-			int ret = regcomp(&pattern->regex, pattern->str,
-			                  (env.opt & OPT_i) ? REG_ICASE : 0);
-			if (ret)
-			{
-				char buf[1024];
-				regerror(ret, &pattern->regex, buf, sizeof(buf));
-				fprintf(stderr, "%s: regcomp(%s): %s\n",
-				        argv[0],
-				        pattern->str,
-				        buf);
-				return EXIT_FAILURE;
-			}
-			if (pattern->regex.re_nsub > env.regmatches_nb)
-				env.regmatches_nb = pattern->regex.re_nsub;
-		}
-		env.regmatches_nb++;
-		env.regmatches = malloc(sizeof(*env.regmatches) * env.regmatches_nb);
-		if (!env.regmatches)
-		{
-			fprintf(stderr, "%s: malloc: %s\n",
-			        argv[0],
-			        strerror(errno));
+		if (compile_pattern(&env, &env.patterns[i]))
 			return EXIT_FAILURE;
-		}
 	}
 	if (optind == argc)
 	{
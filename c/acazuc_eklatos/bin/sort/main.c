@@ -7,6 +7,7 @@
 
 #define OPT_f (1 << 0)
 #define OPT_r (1 << 1)
+#define OPT_s (1 << 2)
 
 struct env
 {
@@ -99,9 +100,10 @@ read_file(struct env *env, const char *file)
 static void
 usage(const char *progname)
 {
-	printf("%s [-f] [-r] [FILES]\n", progname);
+	printf("%s [-f] [-r] [-s] [FILES]\n", progname);
 	printf("-f: case insensitive sort\n");
 	printf("-r: reverse sort\n");
+	printf("-s: stable sort\n");
 }
 
 int
@@ -113,7 +115,7 @@ main(int argc, char **argv)
 
 	memset(&env, 0, sizeof(env));
 	env.progname = argv[0];
-	while ((c = getopt(argc, argv, "fr")) != -1)
+	while ((c = getopt(argc, argv, "frs")) != -1)
 	{
 		switch (c)
 		{
@@ -123,6 +125,9 @@ main(int argc, char **argv)
 			case 'r':
 				env.opt |= OPT_r;
 				break;
+			case 's':
+				env.opt |= OPT_s;
+				break;
 			default:
 				usage(argv[0]);
 				return EXIT_FAILURE;
@@ -151,7 +156,20 @@ main(int argc, char **argv)
 		else
 			cmp_fn = cmp_str;
 	}
-	qsort(env.lines, env.lines_nb, sizeof(char*), cmp_fn);
+	if (env.opt & OPT_s)
+	{
+		if (mergesort(env.lines, env.lines_nb, sizeof(char*), cmp_fn))
+		{
+			fprintf(stderr, "%s: mergesort: %s\n",
+			        env.progname,
+			        strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		qsort(env.lines, env.lines_nb, sizeof(char*), cmp_fn);
+	}
 	for (size_t i = 0; i < env.lines_nb; ++i)
 		fputs(env.lines[i], stdout);
 	return EXIT_SUCCESS;
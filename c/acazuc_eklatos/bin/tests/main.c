@@ -1,7 +1,22 @@
 #include "tests.h"
 
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <netinet/in.h>
+
+#include <arpa/inet.h>
+
+#include <libjpeg/jpeg.h>
+#include <libpng/png.h>
+
 #include <inttypes.h>
 #include <libelf.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
@@ -9,7 +24,9 @@
 #include <errno.h>
 #include <stdio.h>
 #include <time.h>
+#include <regex.h>
 #include <link.h>
+#include <zlib.h>
 
 enum test_type
 {
@@ -29,6 +46,15 @@ enum test_type
 	TEST_GLOB        = (1 << 13),
 	TEST_WCSTRING    = (1 << 14),
 	TEST_MISC        = (1 << 15),
+	TEST_STRING_RATE = (1 << 16),
+	TEST_SORT_RATE   = (1 << 17),
+	TEST_ZLIB_RATE   = (1 << 18),
+	TEST_REGEX       = (1 << 19),
+	TEST_REGEX_RATE  = (1 << 20),
+	TEST_MMAP_RATE   = (1 << 21),
+	TEST_STAT_RATE   = (1 << 22),
+	TEST_SENDFILE_RATE = (1 << 23),
+	TEST_IMAGE_RATE  = (1 << 24),
 };
 
 static const struct
@@ -53,6 +79,15 @@ static const struct
 	{"glob",        TEST_GLOB},
 	{"wcstring",    TEST_WCSTRING},
 	{"misc",        TEST_MISC},
+	{"string_rate", TEST_STRING_RATE},
+	{"sort_rate",   TEST_SORT_RATE},
+	{"zlib_rate",   TEST_ZLIB_RATE},
+	{"regex",       TEST_REGEX},
+	{"regex_rate",  TEST_REGEX_RATE},
+	{"mmap_rate",   TEST_MMAP_RATE},
+	{"stat_rate",   TEST_STAT_RATE},
+	{"sendfile_rate", TEST_SENDFILE_RATE},
+	{"image_rate",  TEST_IMAGE_RATE},
 };
 
 extern char **environ;
@@ -191,6 +226,766 @@ static void __attribute__ ((noinline)) test_memset_rate(void)
 	printf("memset: %lu us\n", (unsigned long)(e - s) / 1000);
 }
 
+static void __attribute__ ((noinline)) test_string_rate(void)
+{
+	static const size_t max = 1024 * 1024;
+	uint8_t *src = malloc(max + 1);
+	uint8_t *dst = malloc(max + 1);
+	ASSERT_NE(src, NULL);
+	ASSERT_NE(dst, NULL);
+	if (!src || !dst)
+		return;
+	memset(src, 1, max + 1);
+	memset(dst, 1, max + 1);
+	printf("%8s %8s %8s %8s %8s %8s (MB/s)\n", "size", "memcpy",
+	       "memset", "memcmp", "memchr", "strlen");
+	for (size_t n = 1; n <= max; n *= 4)
+	{
+		size_t count = 256 * 1024 * 1024 / n;
+		uint64_t rates[5];
+		uint64_t s;
+		uint64_t e;
+		volatile size_t sum = 0;
+		if (count > 1000000)
+			count = 1000000;
+		src[n] = 0;
+#define TEST_RATE(id, expr) \
+	s = nanotime(); \
+	for (size_t i = 0; i < count; ++i) \
+	{ \
+		expr; \
+		__asm__ volatile ("" : : : "memory"); \
+	} \
+	e = nanotime(); \
+	rates[id] = n * count * 1000 / (e - s + 1);
+		TEST_RATE(0, memcpy(dst, src, n));
+		TEST_RATE(1, memset(dst, 1, n));
+		TEST_RATE(2, sum += memcmp(src, dst, n));
+		TEST_RATE(3, sum += (size_t)memchr(src, 2, n));
+		TEST_RATE(4, sum += strlen((char*)src));
+#undef TEST_RATE
+		src[n] = 1;
+		printf("%8zu %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+		       " %8" PRIu64 "\n", n, rates[0], rates[1], rates[2],
+		       rates[3], rates[4]);
+	}
+	free(src);
+	free(dst);
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	int va = *(const int*)a;
+	int vb = *(const int*)b;
+	return va < vb ? -1 : va > vb;
+}
+
+static void __attribute__ ((noinline)) test_sort_rate(void)
+{
+	static const char *inputs[] =
+	{
+		"random",
+		"sorted",
+		"reversed",
+		"duplicates",
+		"organ pipe",
+	};
+	static const size_t n = 1000000;
+	int *values = malloc(sizeof(*values) * n);
+	int *tmp = malloc(sizeof(*tmp) * n);
+	ASSERT_NE(values, NULL);
+	ASSERT_NE(tmp, NULL);
+	if (!values || !tmp)
+		return;
+	printf("%-10s %10s %10s (us, %zu ints)\n", "input", "qsort",
+	       "mergesort", n);
+	for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+	{
+		uint64_t s;
+		uint64_t e;
+		uint64_t durations[2];
+		size_t unsorted;
+		for (size_t j = 0; j < n; ++j)
+		{
+			switch (i)
+			{
+				case 0:
+					values[j] = rand();
+					break;
+				case 1:
+					values[j] = j;
+					break;
+				case 2:
+					values[j] = n - j;
+					break;
+				case 3:
+					values[j] = rand() % 8;
+					break;
+				case 4:
+					values[j] = j < n / 2 ? j : n - j;
+					break;
+			}
+		}
+		memcpy(tmp, values, sizeof(*tmp) * n);
+		s = nanotime();
+		qsort(tmp, n, sizeof(*tmp), cmp_int);
+		e = nanotime();
+		durations[0] = (e - s) / 1000;
+		unsorted = 0;
+		for (size_t j = 1; j < n; ++j)
+			unsorted += tmp[j - 1] > tmp[j];
+		ASSERT_EQ(unsorted, 0);
+		memcpy(tmp, values, sizeof(*tmp) * n);
+		s = nanotime();
+		ASSERT_EQ(mergesort(tmp, n, sizeof(*tmp), cmp_int), 0);
+		e = nanotime();
+		durations[1] = (e - s) / 1000;
+		unsorted = 0;
+		for (size_t j = 1; j < n; ++j)
+			unsorted += tmp[j - 1] > tmp[j];
+		ASSERT_EQ(unsorted, 0);
+		printf("%-10s %10" PRIu64 " %10" PRIu64 "\n", inputs[i],
+		       durations[0], durations[1]);
+	}
+	free(values);
+	free(tmp);
+}
+
+static void __attribute__ ((noinline)) test_zlib_rate(void)
+{
+	static const size_t max = 1024 * 1024;
+	uint8_t *buf = malloc(max);
+	ASSERT_NE(buf, NULL);
+	if (!buf)
+		return;
+	for (size_t i = 0; i < max; ++i)
+		buf[i] = rand();
+	printf("%8s %8s %8s (GB/s)\n", "size", "crc32", "adler32");
+	for (size_t n = 16; n <= max; n *= 4)
+	{
+		size_t count = 1024 * 1024 * 1024 / n;
+		volatile uint32_t sum = 0;
+		uint64_t s;
+		uint64_t e;
+		double rates[2];
+		s = nanotime();
+		for (size_t i = 0; i < count; ++i)
+			sum += crc32_z(sum, buf, n);
+		e = nanotime();
+		rates[0] = (double)n * count / (e - s + 1);
+		s = nanotime();
+		for (size_t i = 0; i < count; ++i)
+			sum += adler32_z(sum, buf, n);
+		e = nanotime();
+		rates[1] = (double)n * count / (e - s + 1);
+		printf("%8zu %8.2f %8.2f\n", n, rates[0], rates[1]);
+	}
+	size_t count = 10000;
+	size_t errors = 0;
+	uint64_t s = nanotime();
+	for (size_t i = 0; i < count; ++i)
+	{
+		unsigned len = max;
+		if (uncompress(buf, &len, g_inflate_corpus,
+		               g_inflate_corpus_size) != Z_OK)
+			errors++;
+	}
+	uint64_t e = nanotime();
+	ASSERT_EQ(errors, 0);
+	char text[INFLATE_CORPUS_MAX];
+	size_t text_len = inflate_corpus_text(text);
+	printf("inflate: %.2f MB/s (%zu bytes corpus)\n",
+	       (double)text_len * count * 1000 / (e - s + 1), text_len);
+	free(buf);
+}
+
+static void __attribute__ ((noinline)) test_regex_rate(void)
+{
+	static const char *words[] =
+	{
+		"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+		"running", "regular", "expression", "engine", "matching",
+		"kernel", "buffer", "table",
+	};
+	static const struct
+	{
+		const char *pattern;
+		int cflags;
+	} patterns[] =
+	{
+		{"zebra", 0},
+		{"lazy dog", 0},
+		{"KERNEL BUFFER", REG_ICASE},
+		{"[a-z]*ing kernel", 0},
+		{"^fox.*table $", 0},
+		{"(quick|lazy) (fox|dog) jumps", REG_EXTENDED},
+		{"x[0-9]+y", REG_EXTENDED},
+		{"\\(fox\\) \\1", 0},
+	};
+	static const size_t max = 16 * 1024 * 1024;
+	char *text = malloc(max + 1);
+	size_t len = 0;
+	ASSERT_NE(text, NULL);
+	if (!text)
+		return;
+	while (len < max - 256)
+	{
+		size_t n = 4 + rand() % 10;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const char *word = words[rand() % (sizeof(words) / sizeof(*words))];
+			size_t word_len = strlen(word);
+			memcpy(&text[len], word, word_len);
+			len += word_len;
+			text[len++] = ' ';
+		}
+		text[len++] = '\n';
+	}
+	text[len] = '\0';
+	printf("%-32s %8s %8s\n", "pattern", "lines", "MB/s");
+	for (size_t i = 0; i < sizeof(patterns) / sizeof(*patterns); ++i)
+	{
+		regex_t regex;
+		regmatch_t match;
+		size_t lines = 0;
+		size_t pos = 0;
+		uint64_t s;
+		uint64_t e;
+		if (regcomp(&regex, patterns[i].pattern,
+		            patterns[i].cflags | REG_NEWLINE))
+		{
+			ASSERT_EQ(i, SIZE_MAX);
+			continue;
+		}
+		/* grep-like scan: one regexec per matching line */
+		s = nanotime();
+		while (pos < len)
+		{
+			char *nl;
+			match.rm_so = pos;
+			match.rm_eo = len;
+			if (regexec(&regex, text, 1, &match, REG_STARTEND))
+				break;
+			lines++;
+			nl = memchr(&text[match.rm_eo], '\n', len - match.rm_eo);
+			pos = nl ? (size_t)(nl - text + 1) : len;
+		}
+		e = nanotime();
+		regfree(&regex);
+		printf("%-32s %8zu %8.2f\n", patterns[i].pattern, lines,
+		       (double)len * 1000 / (e - s + 1));
+	}
+	free(text);
+}
+
+static void __attribute__ ((noinline)) test_mmap_rate(void)
+{
+	static const size_t sizes[] =
+	{
+		64 * 1024 * 1024,
+		1024 * 1024 * 1024,
+	};
+	printf("%-8s %10s %10s %10s %10s\n", "MB", "mmap", "fault", "mprotect",
+	       "munmap");
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i)
+	{
+		size_t size = sizes[i];
+		uint64_t t[5];
+		t[0] = nanotime();
+		uint8_t *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		t[1] = nanotime();
+		ASSERT_NE(ptr, MAP_FAILED);
+		if (ptr == MAP_FAILED)
+			continue;
+		/* only fault the smallest size, the others measure the
+		 * cost of the page tables walk alone
+		 */
+		if (!i)
+		{
+			for (size_t j = 0; j < size; j += 4096)
+				ptr[j] = 1;
+		}
+		t[2] = nanotime();
+		ASSERT_EQ(mprotect(ptr, size, PROT_READ), 0);
+		t[3] = nanotime();
+		ASSERT_EQ(munmap(ptr, size), 0);
+		t[4] = nanotime();
+		printf("%-8zu", size / (1024 * 1024));
+		for (size_t j = 0; j < 4; ++j)
+			printf(" %8" PRIu64 "us", (t[j + 1] - t[j]) / 1000);
+		printf("\n");
+	}
+}
+
+#define STAT_DEPTH 8
+#define STAT_FILES 16
+
+static size_t stat_walk(const char *path)
+{
+	DIR *dir = opendir(path);
+	if (!dir)
+		return 0;
+	size_t count = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir)))
+	{
+		if (!strcmp(dirent->d_name, ".")
+		 || !strcmp(dirent->d_name, ".."))
+			continue;
+		char child[4096];
+		struct stat st;
+		snprintf(child, sizeof(child), "%s/%s", path, dirent->d_name);
+		if (lstat(child, &st))
+			continue;
+		count++;
+		if (S_ISDIR(st.st_mode))
+			count += stat_walk(child);
+	}
+	closedir(dir);
+	return count;
+}
+
+static void stat_tree(int create)
+{
+	char path[4096];
+	size_t len = snprintf(path, sizeof(path), "/tmp/stat_rate");
+	if (create)
+		ASSERT_EQ(mkdir(path, 0755), 0);
+	for (size_t i = 0; i < STAT_DEPTH; ++i)
+	{
+		len += snprintf(&path[len], sizeof(path) - len, "/dir%zu", i);
+		if (create)
+			ASSERT_EQ(mkdir(path, 0755), 0);
+	}
+	for (size_t i = STAT_DEPTH + 1; i > 0; --i)
+	{
+		for (size_t j = 0; j < STAT_FILES; ++j)
+		{
+			char file[4096];
+			snprintf(file, sizeof(file), "%s/file%zu", path, j);
+			if (create)
+			{
+				FILE *fp = fopen(file, "w");
+				ASSERT_NE(fp, NULL);
+				if (fp)
+					fclose(fp);
+			}
+			else
+			{
+				ASSERT_EQ(unlink(file), 0);
+			}
+		}
+		if (!create)
+			ASSERT_EQ(rmdir(path), 0);
+		*strrchr(path, '/') = '\0';
+	}
+}
+
+static void __attribute__ ((noinline)) test_stat_rate(void)
+{
+	char deep[4096];
+	char missing[4096];
+	size_t len = snprintf(deep, sizeof(deep), "/tmp/stat_rate");
+	for (size_t i = 0; i < STAT_DEPTH; ++i)
+		len += snprintf(&deep[len], sizeof(deep) - len, "/dir%zu", i);
+	snprintf(missing, sizeof(missing), "%s/missing", deep);
+	snprintf(&deep[len], sizeof(deep) - len, "/file0");
+	stat_tree(1);
+	const char *env_path = getenv("PATH");
+	if (!env_path)
+		env_path = "/bin:/usr/bin:/usr/local/bin";
+	struct stat st;
+	uint64_t s;
+	uint64_t e;
+	size_t n = 100000;
+	s = nanotime();
+	for (size_t i = 0; i < n; ++i)
+		ASSERT_EQ(stat(deep, &st), 0);
+	e = nanotime();
+	printf("stat deep   : %6" PRIu64 "ns\n", (e - s) / n);
+	s = nanotime();
+	for (size_t i = 0; i < n; ++i)
+		ASSERT_EQ(stat(missing, &st), -1);
+	e = nanotime();
+	printf("stat missing: %6" PRIu64 "ns\n", (e - s) / n);
+	/* what a shell does to find a command */
+	n = 10000;
+	size_t lookups = 0;
+	s = nanotime();
+	for (size_t i = 0; i < n; ++i)
+	{
+		const char *it = env_path;
+		while (*it)
+		{
+			const char *end = strchrnul(it, ':');
+			char cmd[4096];
+			snprintf(cmd, sizeof(cmd), "%.*s/stat_rate_cmd",
+			         (int)(end - it), it);
+			ASSERT_EQ(stat(cmd, &st), -1);
+			lookups++;
+			it = *end ? end + 1 : end;
+		}
+	}
+	e = nanotime();
+	if (lookups)
+		printf("PATH lookup : %6" PRIu64 "ns\n", (e - s) / lookups);
+	/* ls -lR */
+	n = 100;
+	size_t entries = 0;
+	s = nanotime();
+	for (size_t i = 0; i < n; ++i)
+		entries += stat_walk("/tmp/stat_rate");
+	e = nanotime();
+	if (entries)
+		printf("ls -lR      : %6" PRIu64 "ns\n", (e - s) / entries);
+	stat_tree(0);
+}
+
+#define SENDFILE_SIZE (16 * 1024 * 1024)
+#define SENDFILE_PORT 4242
+
+static int sendfile_sockets(int *rfd, int *wfd, pid_t *pid)
+{
+	struct sockaddr_in addr;
+	int fds[2];
+	int lfd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(SENDFILE_PORT);
+	addr.sin_addr.s_addr = htonl(0x7F000001);
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (lfd >= 0
+	 && !bind(lfd, (struct sockaddr*)&addr, sizeof(addr))
+	 && !listen(lfd, 1))
+	{
+		*pid = fork();
+		if (*pid == -1)
+		{
+			close(lfd);
+			return -1;
+		}
+		if (!*pid)
+		{
+			close(lfd);
+			*rfd = socket(AF_INET, SOCK_STREAM, 0);
+			if (*rfd < 0
+			 || connect(*rfd, (struct sockaddr*)&addr, sizeof(addr)))
+				_exit(EXIT_FAILURE);
+			return 0;
+		}
+		*wfd = accept(lfd, NULL, NULL);
+		close(lfd);
+		printf("tcp over loopback\n");
+		return *wfd < 0 ? -1 : 0;
+	}
+	if (lfd >= 0)
+		close(lfd);
+	/* no tcp module, use a local stream */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+		return -1;
+	*pid = fork();
+	if (*pid == -1)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+	if (!*pid)
+	{
+		close(fds[1]);
+		*rfd = fds[0];
+		return 0;
+	}
+	close(fds[0]);
+	*wfd = fds[1];
+	printf("local socket pair\n");
+	return 0;
+}
+
+static void __attribute__ ((noinline)) test_sendfile_rate(void)
+{
+	static char buf[65536];
+	const char *path = "/tmp/sendfile_rate";
+	int rfd;
+	int wfd;
+	pid_t pid;
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	ASSERT_GE(fd, 0);
+	if (fd < 0)
+		return;
+	memset(buf, 'a', sizeof(buf));
+	for (size_t i = 0; i < SENDFILE_SIZE; i += sizeof(buf))
+		ASSERT_EQ(write(fd, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+	int ret = sendfile_sockets(&rfd, &wfd, &pid);
+	ASSERT_EQ(ret, 0);
+	if (ret)
+	{
+		close(fd);
+		unlink(path);
+		return;
+	}
+	if (!pid)
+	{
+		while (read(rfd, buf, sizeof(buf)) > 0)
+			;
+		_exit(EXIT_SUCCESS);
+	}
+	int pipefd[2];
+	ASSERT_EQ(pipe(pipefd), 0);
+	for (size_t mode = 0; mode < 3; ++mode)
+	{
+		static const char *names[] =
+		{
+			"read/write",
+			"sendfile",
+			"splice",
+		};
+		off_t off = 0;
+		size_t done = 0;
+		ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+		uint64_t s = nanotime();
+		while (done < SENDFILE_SIZE)
+		{
+			ssize_t ret;
+			switch (mode)
+			{
+				case 0:
+					ret = read(fd, buf, sizeof(buf));
+					if (ret > 0)
+						ret = write(wfd, buf, ret);
+					break;
+				case 1:
+					ret = sendfile(wfd, fd, &off,
+					               SENDFILE_SIZE - done);
+					break;
+				default:
+					ret = splice(fd, &off, pipefd[1], NULL,
+					             sizeof(buf), 0);
+					for (ssize_t n = 0; ret > 0 && n < ret;)
+					{
+						ssize_t wr = splice(pipefd[0], NULL,
+						                    wfd, NULL, ret - n,
+						                    0);
+						if (wr <= 0)
+						{
+							ret = wr;
+							break;
+						}
+						n += wr;
+					}
+					break;
+			}
+			ASSERT_GT(ret, 0);
+			if (ret <= 0)
+				break;
+			done += ret;
+		}
+		uint64_t e = nanotime();
+		printf("%-10s: %6" PRIu64 " MB/s\n", names[mode],
+		       (uint64_t)done / ((e - s) / 1000 + 1));
+	}
+	close(pipefd[0]);
+	close(pipefd[1]);
+	close(wfd);
+	waitpid(pid, NULL, 0);
+	close(fd);
+	unlink(path);
+}
+
+#define IMAGE_WIDTH  1024
+#define IMAGE_HEIGHT 768
+
+static int image_write_jpeg(const char *path, const uint8_t *data,
+                            int subsampling)
+{
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+		return 1;
+	struct jpeg *jpeg = jpeg_new();
+	int ret = 1;
+	if (!jpeg)
+		goto end;
+	jpeg_init_io(jpeg, fp);
+	jpeg_set_quality(jpeg, 90);
+	if (jpeg_set_subsampling(jpeg, subsampling)
+	 || jpeg_set_info(jpeg, IMAGE_WIDTH, IMAGE_HEIGHT, 3)
+	 || jpeg_write_headers(jpeg)
+	 || jpeg_write_data(jpeg, data))
+		goto end;
+	ret = 0;
+
+end:
+	jpeg_free(jpeg);
+	fclose(fp);
+	return ret;
+}
+
+static int image_read_jpeg(const char *path, uint8_t *data)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return 1;
+	struct jpeg *jpeg = jpeg_new();
+	int ret = 1;
+	if (!jpeg)
+		goto end;
+	jpeg_init_io(jpeg, fp);
+	if (jpeg_read_headers(jpeg)
+	 || jpeg_read_data(jpeg, data))
+		goto end;
+	ret = 0;
+
+end:
+	jpeg_free(jpeg);
+	fclose(fp);
+	return ret;
+}
+
+static int image_write_png(const char *path, uint8_t *data)
+{
+	png_bytep rows[IMAGE_HEIGHT];
+	png_structp png = NULL;
+	png_infop info = NULL;
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+		return 1;
+	for (size_t y = 0; y < IMAGE_HEIGHT; ++y)
+		rows[y] = &data[y * IMAGE_WIDTH * 3];
+	png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (!png)
+		goto err;
+	info = png_create_info_struct(png);
+	if (!info)
+		goto err;
+	if (setjmp(png_jmpbuf(png)))
+		goto err;
+	png_init_io(png, fp);
+	png_set_IHDR(png, info, IMAGE_WIDTH, IMAGE_HEIGHT, 8,
+	             PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+	             PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	png_write_info(png, info);
+	png_write_image(png, rows);
+	png_write_end(png, NULL);
+	png_destroy_write_struct(&png, &info);
+	fclose(fp);
+	return 0;
+
+err:
+	png_destroy_write_struct(&png, &info);
+	fclose(fp);
+	return 1;
+}
+
+static int image_read_png(const char *path, uint8_t *data)
+{
+	png_bytep rows[IMAGE_HEIGHT];
+	png_structp png = NULL;
+	png_infop info = NULL;
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return 1;
+	for (size_t y = 0; y < IMAGE_HEIGHT; ++y)
+		rows[y] = &data[y * IMAGE_WIDTH * 3];
+	png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (!png)
+		goto err;
+	info = png_create_info_struct(png);
+	if (!info)
+		goto err;
+	if (setjmp(png_jmpbuf(png)))
+		goto err;
+	png_init_io(png, fp);
+	png_read_info(png, info);
+	png_read_update_info(png, info);
+	png_read_image(png, rows);
+	png_destroy_read_struct(&png, &info, NULL);
+	fclose(fp);
+	return 0;
+
+err:
+	png_destroy_read_struct(&png, &info, NULL);
+	fclose(fp);
+	return 1;
+}
+
+static void __attribute__ ((noinline)) test_image_rate(void)
+{
+	static const size_t count = 20;
+	const char *jpeg_path = "/tmp/image_rate.jpg";
+	const char *png_path = "/tmp/image_rate.png";
+	size_t size = IMAGE_WIDTH * IMAGE_HEIGHT * 3;
+	uint8_t *src = malloc(size);
+	uint8_t *dst = malloc(size);
+	ASSERT_NE(src, NULL);
+	ASSERT_NE(dst, NULL);
+	if (!src || !dst)
+	{
+		free(src);
+		free(dst);
+		return;
+	}
+	/* gradients with some noise, to get both long and short codes */
+	for (size_t y = 0; y < IMAGE_HEIGHT; ++y)
+	{
+		for (size_t x = 0; x < IMAGE_WIDTH; ++x)
+		{
+			uint8_t *p = &src[(y * IMAGE_WIDTH + x) * 3];
+			uint8_t noise = rand() % 16;
+			p[0] = x + noise;
+			p[1] = y + noise;
+			p[2] = (x + y) / 2 + noise;
+		}
+	}
+	printf("%-10s %8s\n", "format", "MP/s");
+	for (size_t i = 0; i < 3; ++i)
+	{
+		static const char *names[] =
+		{
+			"jpeg 444",
+			"jpeg 420",
+			"png",
+		};
+		const char *path = i < 2 ? jpeg_path : png_path;
+		int ret;
+		switch (i)
+		{
+			case 0:
+				ret = image_write_jpeg(path, src, JPEG_SUBSAMPLING_444);
+				break;
+			case 1:
+				ret = image_write_jpeg(path, src, JPEG_SUBSAMPLING_420);
+				break;
+			default:
+				ret = image_write_png(path, src);
+				break;
+		}
+		ASSERT_EQ(ret, 0);
+		if (ret)
+			continue;
+		size_t errors = 0;
+		uint64_t s = nanotime();
+		for (size_t n = 0; n < count; ++n)
+		{
+			if (i < 2)
+				errors += image_read_jpeg(path, dst);
+			else
+				errors += image_read_png(path, dst);
+		}
+		uint64_t e = nanotime();
+		ASSERT_EQ(errors, 0);
+		if (i == 2)
+			ASSERT_EQ(memcmp(src, dst, size), 0);
+		printf("%-10s %8.2f\n", names[i],
+		       (double)IMAGE_WIDTH * IMAGE_HEIGHT * count * 1000
+		     / (e - s + 1));
+		unlink(path);
+	}
+	free(src);
+	free(dst);
+}
+
 static inline void timespec_diff(struct timespec *d, const struct timespec *a,
                                  const struct timespec *b)
 {
@@ -264,7 +1059,8 @@ int main(int argc, char **argv)
 		      | TEST_STRTO
 		      | TEST_GLOB
 		      | TEST_WCSTRING
-		      | TEST_MISC;
+		      | TEST_MISC
+		      | TEST_REGEX;
 	}
 
 	srand(time(NULL));
@@ -287,6 +1083,22 @@ int main(int argc, char **argv)
 		test_memset_rate();
 	if (tests & TEST_MALLOC)
 		test_malloc();
+	if (tests & TEST_STRING_RATE)
+		test_string_rate();
+	if (tests & TEST_SORT_RATE)
+		test_sort_rate();
+	if (tests & TEST_ZLIB_RATE)
+		test_zlib_rate();
+	if (tests & TEST_REGEX_RATE)
+		test_regex_rate();
+	if (tests & TEST_MMAP_RATE)
+		test_mmap_rate();
+	if (tests & TEST_STAT_RATE)
+		test_stat_rate();
+	if (tests & TEST_SENDFILE_RATE)
+		test_sendfile_rate();
+	if (tests & TEST_IMAGE_RATE)
+		test_image_rate();
 	if (tests & TEST_STRING)
 	{
 		test_strlen();
@@ -393,6 +1205,7 @@ int main(int argc, char **argv)
 		test_printf();
 		test_fifo();
 		test_qsort();
+		test_mergesort();
 		test_dl();
 		test_pf_local();
 		test_inet();
@@ -413,6 +1226,10 @@ int main(int argc, char **argv)
 		test_bsearch();
 		test_scanf();
 	}
+	if (tests & TEST_REGEX)
+	{
+		test_regex();
+	}
 
 	ASSERT_EQ(atexit(test_atexit), 0);
 	printf("passed: %zu\n", g_passed);
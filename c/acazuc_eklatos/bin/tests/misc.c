@@ -239,6 +239,34 @@ void test_qsort(void)
 		ASSERT_STR_LE(items[i - 1], items[i]);
 }
 
+struct stable_item
+{
+	int key;
+	int order;
+};
+
+static int cmp_stable_item(const void *a, const void *b)
+{
+	return ((struct stable_item*)a)->key - ((struct stable_item*)b)->key;
+}
+
+void test_mergesort(void)
+{
+	struct stable_item items[100];
+	for (size_t i = 0; i < sizeof(items) / sizeof(*items); ++i)
+	{
+		items[i].key = rand() % 5;
+		items[i].order = i;
+	}
+	ASSERT_EQ(mergesort(items, sizeof(items) / sizeof(*items), sizeof(*items), cmp_stable_item), 0);
+	for (size_t i = 1; i < sizeof(items) / sizeof(*items); ++i)
+	{
+		ASSERT_LE(items[i - 1].key, items[i].key);
+		if (items[i - 1].key == items[i].key)
+			ASSERT_LT(items[i - 1].order, items[i].order);
+	}
+}
+
 void test_dl(void)
 {
 	/* XXX it should be working with /lib/libc.so too */
@@ -327,6 +355,93 @@ void test_inet(void)
 	ASSERT_EQ(errno, ENOSPC);
 }
 
+/*
+ * 400 words drawn by an lcg from the dictionary below, 12 per line,
+ * compressed with zlib level 9 into a single dynamic block
+ */
+const uint8_t g_inflate_corpus[] =
+{
+	0x78, 0xDA, 0x65, 0x56, 0x5B, 0x62, 0xE2, 0x30, 0x0C, 0xFC, 0xF7, 0x29,
+	0x7C, 0xB5, 0x00, 0xA6, 0x49, 0x1B, 0x92, 0x5D, 0x08, 0x65, 0x77, 0x4F,
+	0xBF, 0x48, 0x33, 0x92, 0x25, 0xF7, 0xA7, 0x80, 0x2D, 0x8D, 0x66, 0xF4,
+	0x72, 0x1F, 0xC7, 0xBD, 0x4D, 0xB7, 0xFA, 0xC0, 0xC7, 0x79, 0xBF, 0xB4,
+	0x7A, 0x59, 0x1E, 0xC7, 0xB4, 0x9D, 0x5B, 0x9D, 0x9F, 0xD7, 0xEB, 0x6D,
+	0xDA, 0xEA, 0x65, 0xFF, 0xA8, 0xAF, 0x65, 0xBB, 0xEC, 0xAF, 0x7A, 0x7A,
+	0x1F, 0xB5, 0x7B, 0x3D, 0xA6, 0xD3, 0xDA, 0xEA, 0x3A, 0xFD, 0xFB, 0x5B,
+	0x97, 0xED, 0xBA, 0x4E, 0x47, 0x13, 0xA3, 0xF2, 0xF9, 0xBC, 0xFD, 0x7A,
+	0xD4, 0x63, 0x6E, 0x75, 0xFF, 0x7E, 0x5B, 0x5D, 0xF7, 0x3F, 0x7E, 0x2D,
+	0xDF, 0x4F, 0xEB, 0x7E, 0xFE, 0x82, 0x97, 0xFE, 0x61, 0xD0, 0x31, 0x5E,
+	0x91, 0x78, 0x6B, 0xDB, 0x3E, 0x8E, 0xD9, 0x29, 0x28, 0xDE, 0xE9, 0xBE,
+	0xBF, 0xB6, 0xBA, 0x2E, 0x47, 0xBB, 0x4F, 0x6B, 0x45, 0x30, 0xBD, 0xA0,
+	0x31, 0xEE, 0x03, 0xEB, 0xC2, 0x0B, 0x95, 0xF5, 0xFB, 0xB9, 0x48, 0x74,
+	0x7A, 0x7F, 0xB5, 0xFB, 0xD6, 0xFC, 0xC3, 0xE9, 0x6A, 0x68, 0xE1, 0x66,
+	0x27, 0x85, 0x41, 0x03, 0x90, 0xE8, 0x43, 0x70, 0x15, 0xA5, 0xF7, 0x94,
+	0x82, 0x1F, 0x02, 0x02, 0xAD, 0x82, 0x52, 0x98, 0x33, 0x31, 0x36, 0x6E,
+	0x84, 0xCB, 0x49, 0x25, 0x17, 0x78, 0x5A, 0xDE, 0x7A, 0xB6, 0x60, 0x5C,
+	0x18, 0xC9, 0x74, 0x24, 0xE9, 0x76, 0xA8, 0xE4, 0xA9, 0x17, 0xF7, 0x9D,
+	0xA9, 0x4A, 0xA0, 0x61, 0x11, 0x29, 0x8C, 0x6E, 0xD4, 0x72, 0x9A, 0xF0,
+	0xCB, 0x2B, 0x6A, 0xAC, 0x20, 0xDF, 0x0B, 0x27, 0x98, 0x96, 0xEB, 0x2C,
+	0x06, 0xFE, 0xB9, 0x30, 0x66, 0xA8, 0x3A, 0x99, 0x31, 0x43, 0x52, 0xA5,
+	0x80, 0x53, 0xE1, 0xB9, 0x0B, 0x08, 0x0A, 0x09, 0xA1, 0x22, 0xCC, 0x23,
+	0xAF, 0xF9, 0x4B, 0x48, 0x93, 0x6F, 0x31, 0x39, 0x4C, 0x93, 0x40, 0x23,
+	0x7C, 0x74, 0xB7, 0x28, 0x54, 0xD0, 0xDB, 0xA0, 0x37, 0x5F, 0x09, 0xD8,
+	0x98, 0x01, 0xBD, 0xD3, 0x9F, 0x3D, 0x95, 0xA1, 0x33, 0x5D, 0x98, 0x03,
+	0x95, 0x41, 0x93, 0x53, 0x53, 0x3E, 0x7D, 0x4C, 0x88, 0x25, 0xBD, 0x14,
+	0xE7, 0x08, 0xFD, 0xCE, 0xF2, 0x85, 0xBE, 0xD6, 0xAF, 0x3F, 0x3C, 0xF5,
+	0xD4, 0x3A, 0x46, 0xF4, 0x78, 0x54, 0x6B, 0xAB, 0x32, 0x0C, 0x44, 0x34,
+	0xC6, 0x36, 0x78, 0xC3, 0x78, 0x66, 0x14, 0x1F, 0xC2, 0x69, 0x6F, 0x57,
+	0x7D, 0x54, 0xA0, 0x7E, 0x1C, 0x2C, 0x92, 0xCA, 0xDD, 0xE5, 0xD9, 0x61,
+	0x54, 0x31, 0xD4, 0x1C, 0x01, 0xC3, 0x34, 0x2B, 0x8F, 0xA1, 0x3F, 0xBD,
+	0x38, 0x86, 0x25, 0xBE, 0xAC, 0x0E, 0x3F, 0xAC, 0xF8, 0xB6, 0xB3, 0x66,
+	0x88, 0x89, 0xCC, 0x62, 0x0F, 0x0E, 0x75, 0xC1, 0x21, 0xB4, 0x2A, 0x1D,
+	0x2B, 0x9C, 0x93, 0xD6, 0x5D, 0xC1, 0xE8, 0x14, 0x00, 0x46, 0x9A, 0x5B,
+	0x5E, 0x00, 0x60, 0x68, 0x60, 0x49, 0x96, 0x1D, 0x61, 0xA5, 0xF4, 0x7D,
+	0x3A, 0x4C, 0x09, 0x3D, 0x72, 0x42, 0x06, 0xAA, 0x26, 0xB4, 0x33, 0xB3,
+	0x2F, 0x7D, 0x21, 0x23, 0x82, 0x5F, 0xA4, 0x3D, 0x9E, 0xD3, 0xE6, 0x36,
+	0x08, 0x5D, 0x86, 0x28, 0x69, 0xA4, 0xE9, 0x92, 0x88, 0x4B, 0x34, 0xD8,
+	0x48, 0x82, 0xCC, 0x8B, 0xDB, 0xAB, 0xF7, 0x55, 0x4F, 0x05, 0xAD, 0x89,
+	0x1B, 0x86, 0x8F, 0x32, 0x0D, 0xC2, 0x97, 0x6B, 0xA1, 0x6F, 0x98, 0xC0,
+	0x5C, 0xF2, 0xAE, 0xC1, 0x0E, 0x86, 0x02, 0x84, 0x55, 0x68, 0xA6, 0xD6,
+	0x26, 0xA9, 0x19, 0x10, 0x21, 0xF5, 0x61, 0x6C, 0x19, 0x7F, 0x6A, 0x7C,
+	0x7D, 0x25, 0xC6, 0x25, 0xEF, 0xF7, 0xA1, 0x7A, 0xA1, 0xB5, 0xE2, 0xAE,
+	0xEA, 0x60, 0x41, 0x9E, 0x0D, 0x7C, 0x98, 0x24, 0x2A, 0xD1, 0xB7, 0x86,
+	0xCC, 0xF1, 0xBC, 0xB2, 0x4B, 0xDF, 0xE7, 0xBA, 0x92, 0x94, 0xA8, 0x61,
+	0x1B, 0xB1, 0xA4, 0x28, 0xB7, 0x6A, 0x78, 0xAD, 0x9C, 0x70, 0x5A, 0x51,
+	0xA8, 0x53, 0xA8, 0xB6, 0xB2, 0xFA, 0x91, 0x71, 0x0D, 0xAE, 0x0E, 0x90,
+	0x38, 0xBE, 0x98, 0xE9, 0x81, 0x93, 0x81, 0x10, 0xC6, 0xBE, 0x2E, 0xD2,
+	0xB3, 0x36, 0xBC, 0x11, 0x31, 0x71, 0xCC, 0xB0, 0xCF, 0x5D, 0x89, 0xD3,
+	0xCD, 0xA1, 0xB4, 0x26, 0x8D, 0x8F, 0x63, 0xEF, 0xC3, 0x2C, 0x87, 0x2E,
+	0x3E, 0x51, 0x61, 0xF9, 0x19, 0x0C, 0xAB, 0x37, 0xB7, 0xD4, 0xC7, 0x74,
+	0x1C, 0x1E, 0x46, 0xBC, 0x0E, 0xC2, 0xD7, 0x88, 0x31, 0xBD, 0xE1, 0xFF,
+	0x19, 0xDB, 0xB8, 0xC0, 0x4D, 0xFF, 0x48, 0x00, 0x0D, 0x0C, 0xD3, 0x06,
+	0x28, 0x71, 0x08, 0xE3, 0x92, 0xFF, 0x0F, 0xCF, 0x75, 0xA5, 0x1F,
+};
+
+const size_t g_inflate_corpus_size = sizeof(g_inflate_corpus);
+
+size_t inflate_corpus_text(char *dst)
+{
+	static const char *words[] =
+	{
+		"the", "quick", "brown", "fox", "jumps", "over", "lazy",
+		"dog", "kernel", "inflate", "window", "huffman", "table",
+		"code", "length", "distance", "literal", "block", "stream",
+		"buffer",
+	};
+	uint32_t x = 1;
+	size_t len = 0;
+	for (size_t i = 0; i < 400; ++i)
+	{
+		x = (x * 1103515245 + 12345) & 0x7FFFFFFF;
+		const char *word = words[(x >> 16) % (sizeof(words) / sizeof(*words))];
+		size_t word_len = strlen(word);
+		memcpy(&dst[len], word, word_len);
+		len += word_len;
+		dst[len++] = i % 12 == 11 ? '\n' : ' ';
+	}
+	return len;
+}
+
 void test_libz(void)
 {
 	ASSERT_EQ(adler32(0, NULL, 0), 1);
@@ -338,6 +453,50 @@ void test_libz(void)
 	ASSERT_EQ(crc32(0, (uint8_t*)"test", 4), 0xD87F7E0C);
 	ASSERT_EQ(crc32(0, (uint8_t*)"abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26 * 4 + 20), 0x5C45CDB1);
 	ASSERT_EQ(crc32(crc32(crc32(crc32(0, (uint8_t*)"t", 1), (uint8_t*)"e", 1), (uint8_t*)"s", 1), (uint8_t*)"t", 1), 0xD87F7E0C);
+	ASSERT_EQ(crc32_combine(crc32(0, (uint8_t*)"te", 2), crc32(0, (uint8_t*)"st", 2), 2), 0xD87F7E0C);
+
+	/* the vector paths must match the byte at a time results */
+	static uint8_t buf[100003];
+	uint32_t crc = 0;
+	uint32_t adler = 1;
+	for (size_t i = 0; i < sizeof(buf); ++i)
+	{
+		buf[i] = i * 7 + (i >> 8);
+		crc = crc32(crc, &buf[i], 1);
+		adler = adler32(adler, &buf[i], 1);
+	}
+	ASSERT_EQ(crc32_z(0, buf, sizeof(buf)), crc);
+	ASSERT_EQ(adler32_z(1, buf, sizeof(buf)), adler);
+	ASSERT_EQ(crc32_z(crc32(0, buf, 3), &buf[3], sizeof(buf) - 3), crc);
+	ASSERT_EQ(adler32_z(adler32(1, buf, 3), &buf[3], sizeof(buf) - 3), adler);
+	ASSERT_EQ(crc32_combine(crc32(0, buf, 1000), crc32_z(0, &buf[1000], sizeof(buf) - 1000), sizeof(buf) - 1000), crc);
+
+	char text[INFLATE_CORPUS_MAX];
+	size_t text_len = inflate_corpus_text(text);
+	unsigned len = sizeof(buf);
+	ASSERT_EQ(uncompress(buf, &len, g_inflate_corpus, g_inflate_corpus_size), Z_OK);
+	ASSERT_EQ(len, text_len);
+	ASSERT_EQ(memcmp(buf, text, text_len), 0);
+
+	/* tiny buffers keep the decoder on its resumable path */
+	z_stream stream;
+	int ret = Z_OK;
+	ASSERT_EQ(inflateInit(&stream), Z_OK);
+	stream.next_in = g_inflate_corpus;
+	stream.next_out = buf;
+	len = 0;
+	for (size_t i = 0; ret == Z_OK && i < sizeof(buf); ++i)
+	{
+		size_t avail_in = g_inflate_corpus + g_inflate_corpus_size - stream.next_in;
+		stream.avail_in = avail_in < 5 ? avail_in : 5;
+		stream.avail_out = 7;
+		ret = inflate(&stream, Z_NO_FLUSH);
+		len += 7 - stream.avail_out;
+	}
+	inflateEnd(&stream);
+	ASSERT_EQ(ret, Z_STREAM_END);
+	ASSERT_EQ(len, text_len);
+	ASSERT_EQ(memcmp(buf, text, text_len), 0);
 }
 
 void test_servent(void)
@@ -0,0 +1,232 @@
+#include "tests.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <regex.h>
+
+static int
+comp_ret(const char *pattern, int cflags)
+{
+	regex_t regex;
+	int ret;
+
+	ret = regcomp(&regex, pattern, cflags);
+	if (!ret)
+		regfree(&regex);
+	return ret;
+}
+
+/*
+ * returns the matched ranges as "so-eo" separated by spaces
+ * (unset subexpressions are "-1--1"), "nomatch" or "error"
+ */
+static const char *
+match_str(const char *pattern, int cflags, const char *str, int eflags)
+{
+	static char buf[256];
+	regmatch_t match[10];
+	regex_t regex;
+	size_t len = 0;
+	int ret;
+
+	if (regcomp(&regex, pattern, cflags))
+		return "error";
+	ret = regexec(&regex, str, sizeof(match) / sizeof(*match), match,
+	              eflags);
+	if (ret)
+	{
+		regfree(&regex);
+		return ret == REG_NOMATCH ? "nomatch" : "error";
+	}
+	buf[0] = '\0';
+	for (size_t i = 0; i <= regex.re_nsub && i < sizeof(match) / sizeof(*match); ++i)
+		len += snprintf(&buf[len], sizeof(buf) - len, "%s%d-%d",
+		                i ? " " : "",
+		                (int)match[i].rm_so, (int)match[i].rm_eo);
+	regfree(&regex);
+	return buf;
+}
+
+static void
+test_regex_bre(void)
+{
+	ASSERT_STR_EQ(match_str("abc", 0, "xxabcxx", 0), "2-5");
+	ASSERT_STR_EQ(match_str("abc", 0, "xxabxx", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("", 0, "abc", 0), "0-0");
+	ASSERT_STR_EQ(match_str("a.c", 0, "abc", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a*", 0, "aaab", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a*", 0, "baaa", 0), "0-0");
+	ASSERT_STR_EQ(match_str("ba*", 0, "xbaaa", 0), "1-5");
+	ASSERT_STR_EQ(match_str("*a", 0, "x*a", 0), "1-3");
+	ASSERT_STR_EQ(match_str("a\\+", 0, "xaab", 0), "1-3");
+	ASSERT_STR_EQ(match_str("ab\\?c", 0, "ac", 0), "0-2");
+	ASSERT_STR_EQ(match_str("a+", 0, "aa+", 0), "1-3");
+	ASSERT_STR_EQ(match_str("a|b", 0, "a|b", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a\\|b", 0, "xb", 0), "1-2");
+	ASSERT_STR_EQ(match_str("\\(ab\\)*c", 0, "ababc", 0), "0-5 2-4");
+	ASSERT_STR_EQ(match_str("\\(a\\)\\(b\\)\\?", 0, "a", 0), "0-1 0-1 -1--1");
+	ASSERT_STR_EQ(match_str("(ab)", 0, "(ab)", 0), "0-4");
+	ASSERT_STR_EQ(match_str("a\\{2\\}", 0, "aaa", 0), "0-2");
+	ASSERT_STR_EQ(match_str("a\\{2,\\}", 0, "baaaa", 0), "1-5");
+	ASSERT_STR_EQ(match_str("a\\{1,2\\}", 0, "aaa", 0), "0-2");
+	ASSERT_STR_EQ(match_str("a\\{3\\}", 0, "aa", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("a{2}", 0, "a{2}", 0), "0-4");
+	ASSERT_STR_EQ(match_str("^ab", 0, "abab", 0), "0-2");
+	ASSERT_STR_EQ(match_str("^ab", 0, "xab", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("ab$", 0, "abab", 0), "2-4");
+	ASSERT_STR_EQ(match_str("a^b", 0, "a^b", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a$b", 0, "a$b", 0), "0-3");
+	ASSERT_STR_EQ(match_str("\\(^a\\)", 0, "a", 0), "0-1 0-1");
+	ASSERT_STR_EQ(match_str("\\.\\*\\[", 0, "a.*[", 0), "1-4");
+}
+
+static void
+test_regex_ere(void)
+{
+	int e = REG_EXTENDED;
+
+	ASSERT_STR_EQ(match_str("a+", e, "xaab", 0), "1-3");
+	ASSERT_STR_EQ(match_str("ab?c", e, "abc", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a|b", e, "xb", 0), "1-2");
+	ASSERT_STR_EQ(match_str("(a|ab)(c|bcd)", e, "abcd", 0), "0-4 0-1 1-4");
+	ASSERT_STR_EQ(match_str("(wee|week)(knights|night)", e, "weeknights", 0), "0-10 0-3 3-10");
+	ASSERT_STR_EQ(match_str("x(a|ab|abc)", e, "xabcd", 0), "0-4 1-4");
+	ASSERT_STR_EQ(match_str("(a*)*", e, "aab", 0), "0-2 0-2");
+	ASSERT_STR_EQ(match_str("(a|b)*c", e, "abac", 0), "0-4 2-3");
+	ASSERT_STR_EQ(match_str("(a*)+", e, "aa", 0), "0-2 0-2");
+	ASSERT_STR_EQ(match_str("(a)|(b)", e, "b", 0), "0-1 -1--1 0-1");
+	ASSERT_STR_EQ(match_str("a{2,3}", e, "aaaa", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a{,2}b", e, "aaab", 0), "1-4");
+	ASSERT_STR_EQ(match_str("(ab){2}", e, "abababab", 0), "0-4 2-4");
+	ASSERT_STR_EQ(match_str("a{0}b", e, "ab", 0), "1-2");
+	ASSERT_STR_EQ(match_str("()", e, "a", 0), "0-0 0-0");
+	ASSERT_STR_EQ(match_str("a)", e, "a)", 0), "0-2");
+	ASSERT_STR_EQ(match_str("^(ab|a)$", e, "ab", 0), "0-2 0-2");
+	ASSERT_STR_EQ(match_str("a^b|c", e, "ab c", 0), "3-4");
+	ASSERT_STR_EQ(match_str("(^|x)a", e, "ba xa", 0), "3-5 3-4");
+	ASSERT_STR_EQ(match_str("a(b|$)", e, "xa", 0), "1-2 2-2");
+	ASSERT_STR_EQ(match_str("[[:digit:]]+\\.[[:digit:]]*", e, "v 12.5x", 0), "2-6");
+	ASSERT_STR_EQ(match_str(".*", e, "abc", 0), "0-3");
+	ASSERT_STR_EQ(match_str("(.*)c(.*)", e, "abcdcf", 0), "0-6 0-4 5-6");
+}
+
+static void
+test_regex_bracket(void)
+{
+	int e = REG_EXTENDED;
+
+	ASSERT_STR_EQ(match_str("[abc]+", e, "xcabd", 0), "1-4");
+	ASSERT_STR_EQ(match_str("[^abc]+", e, "abxyc", 0), "2-4");
+	ASSERT_STR_EQ(match_str("[a-c]+", e, "dcbae", 0), "1-4");
+	ASSERT_STR_EQ(match_str("[]a]+", e, "x]a]", 0), "1-4");
+	ASSERT_STR_EQ(match_str("[^]a]", e, "]ab", 0), "2-3");
+	ASSERT_STR_EQ(match_str("[a-]+", e, "x-a-", 0), "1-4");
+	ASSERT_STR_EQ(match_str("[.]", e, "ab.", 0), "2-3");
+	ASSERT_STR_EQ(match_str("[\\]+", e, "a\\\\", 0), "1-3");
+	ASSERT_STR_EQ(match_str("[[:alpha:]]+", e, "12ab3", 0), "2-4");
+	ASSERT_STR_EQ(match_str("[[:upper:][:digit:]]+", e, "aB1c", 0), "1-3");
+	ASSERT_STR_EQ(match_str("[[:space:]]", e, "a\tb", 0), "1-2");
+	ASSERT_STR_EQ(match_str("[[:xdigit:]]+", e, "xx0fAg", 0), "2-5");
+	ASSERT_STR_EQ(match_str("[[.a.]]", e, "ba", 0), "1-2");
+	ASSERT_STR_EQ(match_str("[[=a=]]", e, "ba", 0), "1-2");
+	ASSERT_EQ(comp_ret("[[:foo:]]", e), REG_ECTYPE);
+	ASSERT_EQ(comp_ret("[z-a]", e), REG_ERANGE);
+	ASSERT_EQ(comp_ret("[ab", e), REG_EBRACK);
+}
+
+static void
+test_regex_backref(void)
+{
+	ASSERT_STR_EQ(match_str("\\(a*\\)b\\1", 0, "aabaa", 0), "0-5 0-2");
+	ASSERT_STR_EQ(match_str("\\(a*\\)b\\1", 0, "aaba", 0), "1-4 1-2");
+	ASSERT_STR_EQ(match_str("\\(.\\)\\1", 0, "abccd", 0), "2-4 2-3");
+	ASSERT_STR_EQ(match_str("\\([a-c]*\\)\\1", 0, "abcabc", 0), "0-6 0-3");
+	ASSERT_STR_EQ(match_str("^\\(.*\\)-\\1$", 0, "foo-foo", 0), "0-7 0-3");
+	ASSERT_STR_EQ(match_str("^\\(.*\\)-\\1$", 0, "foo-bar", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("\\(a\\)\\1", REG_ICASE, "aA", 0), "0-2 0-1");
+	ASSERT_EQ(comp_ret("\\1", 0), REG_ESUBREG);
+	ASSERT_EQ(comp_ret("\\(a\\1\\)", 0), REG_ESUBREG);
+}
+
+static void
+test_regex_flags(void)
+{
+	int n = REG_NEWLINE;
+	regmatch_t match[2];
+	regex_t regex;
+
+	ASSERT_STR_EQ(match_str("ABC", REG_ICASE, "xaBc", 0), "1-4");
+	ASSERT_STR_EQ(match_str("[a-c]+", REG_ICASE | REG_EXTENDED, "xAbC", 0), "1-4");
+	ASSERT_STR_EQ(match_str("[^a]", REG_ICASE, "Ab", 0), "1-2");
+	ASSERT_STR_EQ(match_str("^b", 0, "a\nb", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("^b", n, "a\nb", 0), "2-3");
+	ASSERT_STR_EQ(match_str("a$", n, "a\nb", 0), "0-1");
+	ASSERT_STR_EQ(match_str("a.b", n, "a\nb", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("a.b", 0, "a\nb", 0), "0-3");
+	ASSERT_STR_EQ(match_str("a[^x]b", n, "a\nb", 0), "nomatch");
+	ASSERT_STR_EQ(match_str("^a", 0, "a", REG_NOTBOL), "nomatch");
+	ASSERT_STR_EQ(match_str("^a", n, "a\na", REG_NOTBOL), "2-3");
+	ASSERT_STR_EQ(match_str("a$", 0, "a", REG_NOTEOL), "nomatch");
+	ASSERT_STR_EQ(match_str("a$", n, "a\na", REG_NOTEOL), "0-1");
+	ASSERT_STR_EQ(match_str("^$", n, "a\n\nb", 0), "2-2");
+	ASSERT_STR_EQ(match_str("bb*$", n, "abb\nab", 0), "1-3");
+
+	ASSERT_EQ(regcomp(&regex, "\\(b\\)", REG_NOSUB), 0);
+	ASSERT_EQ(regexec(&regex, "abc", 0, NULL, 0), 0);
+	ASSERT_EQ(regexec(&regex, "ac", 0, NULL, 0), REG_NOMATCH);
+	regfree(&regex);
+
+	ASSERT_EQ(regcomp(&regex, "^b+", REG_EXTENDED), 0);
+	match[0].rm_so = 1;
+	match[0].rm_eo = 3;
+	ASSERT_EQ(regexec(&regex, "abbb", 1, match, REG_STARTEND), 0);
+	ASSERT_EQ(match[0].rm_so, 1);
+	ASSERT_EQ(match[0].rm_eo, 3);
+	match[0].rm_so = 1;
+	match[0].rm_eo = 3;
+	ASSERT_EQ(regexec(&regex, "abbb", 1, match, REG_STARTEND | REG_NOTBOL),
+	          REG_NOMATCH);
+	regfree(&regex);
+
+	ASSERT_EQ(regcomp(&regex, "a.c", 0), 0);
+	match[0].rm_so = 0;
+	match[0].rm_eo = 3;
+	ASSERT_EQ(regexec(&regex, "a\0c", 1, match, REG_STARTEND), 0);
+	regfree(&regex);
+}
+
+static void
+test_regex_errors(void)
+{
+	char buf[64];
+	regex_t regex;
+	size_t ret;
+
+	ASSERT_EQ(comp_ret("a\\{1", 0), REG_EBRACE);
+	ASSERT_EQ(comp_ret("a\\{2,1\\}", 0), REG_BADBR);
+	ASSERT_EQ(comp_ret("a{1", REG_EXTENDED), REG_EBRACE);
+	ASSERT_EQ(comp_ret("\\(a", 0), REG_EPAREN);
+	ASSERT_EQ(comp_ret("a\\)", 0), REG_EPAREN);
+	ASSERT_EQ(comp_ret("(a", REG_EXTENDED), REG_EPAREN);
+	ASSERT_EQ(comp_ret("*a", REG_EXTENDED), REG_BADRPT);
+	ASSERT_EQ(comp_ret("a|*b", REG_EXTENDED), REG_BADRPT);
+	ASSERT_EQ(comp_ret("a\\", 0), REG_EESCAPE);
+
+	ASSERT_EQ(regcomp(&regex, "(", REG_EXTENDED), REG_EPAREN);
+	ret = regerror(REG_EPAREN, &regex, buf, sizeof(buf));
+	ASSERT_EQ(ret, strlen(buf) + 1);
+	ASSERT_NE(buf[0], '\0');
+	ASSERT_EQ(regerror(REG_EPAREN, &regex, NULL, 0), ret);
+	ASSERT_EQ(regerror(REG_EPAREN, &regex, buf, 4), ret);
+	ASSERT_EQ(strlen(buf), 3);
+}
+
+void test_regex(void)
+{
+	test_regex_bre();
+	test_regex_ere();
+	test_regex_bracket();
+	test_regex_backref();
+	test_regex_flags();
+	test_regex_errors();
+}
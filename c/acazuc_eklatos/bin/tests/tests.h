@@ -70,6 +70,12 @@ extern size_t g_failed;
 
 uint64_t nanotime(void);
 
+#define INFLATE_CORPUS_MAX 4096
+
+extern const uint8_t g_inflate_corpus[];
+extern const size_t g_inflate_corpus_size;
+size_t inflate_corpus_text(char *dst);
+
 /* string.c */
 void test_strlen(void);
 void test_memchr(void);
@@ -169,6 +175,7 @@ void test_strftime(void);
 void test_printf(void);
 void test_fifo(void);
 void test_qsort(void);
+void test_mergesort(void);
 void test_dl(void);
 void test_pf_local(void);
 void test_inet(void);
@@ -189,4 +196,7 @@ void test_fmemopen(void);
 void test_bsearch(void);
 void test_scanf(void);
 
+/* regex.c */
+void test_regex(void);
+
 #endif
@@ -44,6 +44,13 @@ extern "C" {
 
 #define FD_CLOEXEC (1 << 0)
 
+#define SPLICE_F_MOVE     (1 << 0)
+#define SPLICE_F_NONBLOCK (1 << 1)
+#define SPLICE_F_MORE     (1 << 2)
+#define SPLICE_F_GIFT     (1 << 3)
+
+struct iovec;
+
 struct flock
 {
 	int16_t l_type;
@@ -59,6 +66,11 @@ int openat(int dirfd, const char *pathname, int flags, ...);
 
 int fcntl(int fd, int cmd, ...);
 
+ssize_t splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+               size_t len, unsigned flags);
+ssize_t vmsplice(int fd, const struct iovec *iov, size_t nr_segs,
+                 unsigned flags);
+
 #ifdef __cplusplus
 }
 #endif
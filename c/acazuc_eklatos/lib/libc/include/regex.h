@@ -9,12 +9,13 @@
 extern "C" {
 #endif
 
-#define REG_EXTEDED (1 << 0)
-#define REG_ICASE   (1 << 1)
-#define REG_NOSUB   (1 << 2)
-#define REG_NEWLINE (1 << 3)
-#define REG_NOTBOL  (1 << 4)
-#define REG_NOTEOL  (1 << 5)
+#define REG_EXTENDED (1 << 0)
+#define REG_ICASE    (1 << 1)
+#define REG_NOSUB    (1 << 2)
+#define REG_NEWLINE  (1 << 3)
+#define REG_NOTBOL   (1 << 4)
+#define REG_NOTEOL   (1 << 5)
+#define REG_STARTEND (1 << 6)
 
 #define REG_NOMATCH -1
 
@@ -36,9 +37,7 @@ typedef ssize_t regoff_t;
 typedef struct
 {
 	size_t re_nsub;
-	char *regex;
-	size_t regex_len;
-	int flags;
+	void *re_prog;
 } regex_t;
 
 typedef struct
@@ -68,6 +68,8 @@ int getsubopt(char **optionp, char * const *tokens, char **valuep);
 
 void qsort(void *base, size_t nmemb, size_t size,
            int (*cmp)(const void *, const void *));
+int mergesort(void *base, size_t nmemb, size_t size,
+              int (*cmp)(const void *, const void *));
 
 char *realpath(const char *path, char *resolved_path);
 
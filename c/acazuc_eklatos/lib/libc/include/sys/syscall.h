@@ -72,6 +72,9 @@ extern "C" {
 #define SYS_fsync          72
 #define SYS_fdatasync      73
 #define SYS_chroot         74
+#define SYS_sendfile       75
+#define SYS_splice         76
+#define SYS_vmsplice       77
 
 /* creds */
 #define SYS_getuid      80
@@ -0,0 +1,23 @@
+#ifndef _AMD64_CPU_H
+#define _AMD64_CPU_H
+
+#define CPU_PROBED (1 << 0)
+#define CPU_AVX2   (1 << 1)
+#define CPU_ERMS   (1 << 2)
+
+/* rep movsb / rep stosb are only used above this size */
+#define CPU_REP_THRESHOLD 2048
+
+/*
+ * load the cpu features into %r11d, probing them on first use
+ * there is no ifunc support in ld.so, hence the lazy probe
+ */
+.macro CPU_FEATURES
+	mov __libc_cpu_features(%rip), %r11d
+	test %r11d, %r11d
+	jnz .Lcpu_features\@
+	call __libc_cpu_probe
+.Lcpu_features\@:
+.endm
+
+#endif
@@ -0,0 +1,11 @@
+#include "../_syscall.h"
+
+#include <sys/uio.h>
+
+#include <fcntl.h>
+
+ssize_t
+vmsplice(int fd, const struct iovec *iov, size_t nr_segs, unsigned flags)
+{
+	return syscall4(SYS_vmsplice, fd, (uintptr_t)iov, nr_segs, flags);
+}
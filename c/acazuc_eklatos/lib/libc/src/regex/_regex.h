@@ -0,0 +1,75 @@
+#ifndef _REGEX_H
+#define _REGEX_H
+
+#include "../_lock.h"
+
+#include <sys/types.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * a compiled regex is a thompson nfa program:
+ * - SET consumes one byte of sets[x]
+ * - SPLIT forks to x (preferred) and y
+ * - SAVE stores the position in the capture slot x
+ * - MARK / CHECK guard loops over nullable bodies for the backtracker
+ *   (CHECK x fails if no byte was consumed since MARK x)
+ *
+ * patterns without back-references are searched with a lazily built dfa
+ * (regexec.c) and only run through the pike vm to extract the submatches
+ * of the line / range the dfa found
+ */
+
+enum re_op
+{
+	RE_OP_SET,
+	RE_OP_JMP,
+	RE_OP_SPLIT,
+	RE_OP_SAVE,
+	RE_OP_BOL,
+	RE_OP_EOL,
+	RE_OP_BACKREF,
+	RE_OP_MARK,
+	RE_OP_CHECK,
+	RE_OP_MATCH,
+};
+
+struct re_inst
+{
+	uint32_t op;
+	uint32_t x;
+	uint32_t y;
+};
+
+struct re_dfa;
+
+struct re_prog
+{
+	struct re_inst *insts;
+	size_t insts_nb;
+	uint32_t (*sets)[8];
+	size_t sets_nb;
+	size_t nsub;
+	size_t nmarks;
+	int cflags;
+	int has_backref;
+	int can_match_nl; /* some set holds '\n' */
+	int is_literal; /* the whole pattern is the literal below */
+	unsigned char *literal; /* required by every match, or NULL */
+	size_t literal_len;
+	uint8_t classes[256]; /* byte equivalence classes for the dfa */
+	size_t classes_nb;
+	struct _libc_lock dfa_lock;
+	struct re_dfa *dfa;
+};
+
+static inline int
+re_set_has(const uint32_t *set, unsigned char c)
+{
+	return (set[c / 32] >> (c % 32)) & 1;
+}
+
+void re_dfa_free(struct re_dfa *dfa);
+
+#endif
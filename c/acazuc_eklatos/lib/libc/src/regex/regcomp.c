@@ -1,14 +1,1092 @@
+#include "_regex.h"
+
+#include <sys/param.h>
+
 #include <string.h>
+#include <stdlib.h>
 #include <regex.h>
+#include <ctype.h>
+
+#define RE_DEPTH_MAX 256
+#define RE_INSTS_MAX (1 << 20)
+#define RE_LITERAL_MAX 255
+
+enum node_type
+{
+	NODE_EMPTY,
+	NODE_SET,
+	NODE_CAT,
+	NODE_ALT,
+	NODE_REPEAT,
+	NODE_GROUP,
+	NODE_BOL,
+	NODE_EOL,
+	NODE_BACKREF,
+};
+
+/*
+ * CAT and ALT nodes own a list of children linked by next,
+ * GROUP and REPEAT own a single child
+ */
+struct node
+{
+	enum node_type type;
+	int child;
+	int next;
+	int min;
+	int max; /* -1 for unbounded repeats */
+	uint32_t value; /* set index, group or back-reference number */
+};
+
+struct parser
+{
+	const unsigned char *s;
+	size_t pos;
+	int cflags;
+	int err;
+	size_t depth;
+	struct node *nodes;
+	size_t nodes_nb;
+	size_t nodes_size;
+	uint32_t (*sets)[8];
+	size_t sets_nb;
+	size_t sets_size;
+	size_t nsub;
+	uint32_t closed; /* groups 1 to 9 usable as back-references */
+	int has_backref;
+};
+
+struct compiler
+{
+	const struct parser *parser;
+	struct re_inst *insts;
+	size_t insts_nb;
+	size_t insts_size;
+	size_t nmarks;
+	int err;
+};
+
+struct literal
+{
+	unsigned char data[RE_LITERAL_MAX];
+	size_t len;
+};
+
+static int parse_alt(struct parser *p);
+
+static int
+new_node(struct parser *p, enum node_type type)
+{
+	struct node *node;
+
+	if (p->nodes_nb == p->nodes_size)
+	{
+		size_t size = p->nodes_size ? p->nodes_size * 2 : 32;
+		struct node *nodes = realloc(p->nodes, sizeof(*nodes) * size);
+		if (!nodes)
+		{
+			p->err = REG_ESPACE;
+			return -1;
+		}
+		p->nodes = nodes;
+		p->nodes_size = size;
+	}
+	node = &p->nodes[p->nodes_nb];
+	node->type = type;
+	node->child = -1;
+	node->next = -1;
+	node->min = 0;
+	node->max = 0;
+	node->value = 0;
+	return p->nodes_nb++;
+}
+
+static int
+new_set_node(struct parser *p, const uint32_t *set)
+{
+	size_t i;
+	int idx;
+
+	for (i = 0; i < p->sets_nb; ++i)
+	{
+		if (!memcmp(p->sets[i], set, sizeof(*p->sets)))
+			break;
+	}
+	if (i == p->sets_nb)
+	{
+		if (p->sets_nb == p->sets_size)
+		{
+			size_t size = p->sets_size ? p->sets_size * 2 : 16;
+			uint32_t (*sets)[8] = realloc(p->sets, sizeof(*sets) * size);
+			if (!sets)
+			{
+				p->err = REG_ESPACE;
+				return -1;
+			}
+			p->sets = sets;
+			p->sets_size = size;
+		}
+		memcpy(p->sets[p->sets_nb++], set, sizeof(*p->sets));
+	}
+	idx = new_node(p, NODE_SET);
+	if (idx != -1)
+		p->nodes[idx].value = i;
+	return idx;
+}
+
+static void
+set_add(uint32_t *set, unsigned c)
+{
+	set[c / 32] |= 1u << (c % 32);
+}
+
+static void
+set_add_case(struct parser *p, uint32_t *set)
+{
+	if (!(p->cflags & REG_ICASE))
+		return;
+	for (unsigned c = 0; c < 256; ++c)
+	{
+		if (!re_set_has(set, c))
+			continue;
+		set_add(set, tolower(c));
+		set_add(set, toupper(c));
+	}
+}
+
+static int
+new_char_node(struct parser *p, unsigned char c)
+{
+	uint32_t set[8] = {0};
+
+	set_add(set, c);
+	set_add_case(p, set);
+	return new_set_node(p, set);
+}
+
+static int
+new_any_node(struct parser *p)
+{
+	uint32_t set[8];
+
+	memset(set, 0xFF, sizeof(set));
+	if (p->cflags & REG_NEWLINE)
+		set['\n' / 32] &= ~(1u << ('\n' % 32));
+	return new_set_node(p, set);
+}
+
+static int
+ctype_match(const char *name, size_t len, unsigned c)
+{
+#define TEST_CLASS(class) \
+do \
+{ \
+	if (len == sizeof(#class) - 1 && !memcmp(name, #class, len)) \
+		return !!is##class(c); \
+} while (0)
+
+	TEST_CLASS(alnum);
+	TEST_CLASS(alpha);
+	TEST_CLASS(blank);
+	TEST_CLASS(cntrl);
+	TEST_CLASS(digit);
+	TEST_CLASS(graph);
+	TEST_CLASS(lower);
+	TEST_CLASS(print);
+	TEST_CLASS(punct);
+	TEST_CLASS(space);
+	TEST_CLASS(upper);
+	TEST_CLASS(xdigit);
+
+#undef TEST_CLASS
+	return -1;
+}
+
+/*
+ * parse a [:class:], [=c=] or [.c.] element, p->pos being on the '['
+ * returns the collating element, or -1 for a class (added to set)
+ */
+static int
+parse_bracket_special(struct parser *p, uint32_t *set)
+{
+	unsigned char type = p->s[p->pos + 1];
+	const unsigned char *name = &p->s[p->pos + 2];
+	size_t len = 0;
+
+	while (name[len] && (name[len] != type || name[len + 1] != ']'))
+		len++;
+	if (!name[len])
+	{
+		p->err = REG_EBRACK;
+		return -2;
+	}
+	p->pos += len + 4;
+	if (type == ':')
+	{
+		for (unsigned c = 0; c < 256; ++c)
+		{
+			int ret = ctype_match((const char*)name, len, c);
+			if (ret == -1)
+			{
+				p->err = REG_ECTYPE;
+				return -2;
+			}
+			if (ret)
+				set_add(set, c);
+		}
+		return -1;
+	}
+	if (len != 1)
+	{
+		p->err = REG_ECOLLATE;
+		return -2;
+	}
+	return name[0];
+}
+
+static int
+parse_bracket(struct parser *p)
+{
+	uint32_t set[8] = {0};
+	int neg = 0;
+	int first = 1;
+
+	p->pos++;
+	if (p->s[p->pos] == '^')
+	{
+		neg = 1;
+		p->pos++;
+	}
+	while (1)
+	{
+		unsigned char c = p->s[p->pos];
+		int lo;
+		int hi;
+
+		if (!c)
+		{
+			p->err = REG_EBRACK;
+			return -1;
+		}
+		if (c == ']' && !first)
+		{
+			p->pos++;
+			break;
+		}
+		first = 0;
+		if (c == '[' && (p->s[p->pos + 1] == ':'
+		              || p->s[p->pos + 1] == '='
+		              || p->s[p->pos + 1] == '.'))
+		{
+			lo = parse_bracket_special(p, set);
+			if (lo == -2)
+				return -1;
+			if (lo == -1)
+				continue;
+		}
+		else
+		{
+			lo = c;
+			p->pos++;
+		}
+		if (p->s[p->pos] != '-'
+		 || !p->s[p->pos + 1]
+		 || p->s[p->pos + 1] == ']')
+		{
+			set_add(set, lo);
+			continue;
+		}
+		p->pos++;
+		if (p->s[p->pos] == '[' && (p->s[p->pos + 1] == '='
+		                         || p->s[p->pos + 1] == '.'))
+		{
+			hi = parse_bracket_special(p, set);
+			if (hi == -2)
+				return -1;
+		}
+		else if (p->s[p->pos] == '[' && p->s[p->pos + 1] == ':')
+		{
+			p->err = REG_ERANGE;
+			return -1;
+		}
+		else
+		{
+			hi = p->s[p->pos++];
+		}
+		if (lo > hi)
+		{
+			p->err = REG_ERANGE;
+			return -1;
+		}
+		for (int i = lo; i <= hi; ++i)
+			set_add(set, i);
+	}
+	set_add_case(p, set);
+	if (neg)
+	{
+		for (size_t i = 0; i < 8; ++i)
+			set[i] = ~set[i];
+		if (p->cflags & REG_NEWLINE)
+			set['\n' / 32] &= ~(1u << ('\n' % 32));
+	}
+	return new_set_node(p, set);
+}
+
+static int
+at_alt(struct parser *p)
+{
+	if (p->cflags & REG_EXTENDED)
+		return p->s[p->pos] == '|';
+	return p->s[p->pos] == '\\' && p->s[p->pos + 1] == '|';
+}
+
+static int
+at_close(struct parser *p)
+{
+	if (!p->depth)
+		return 0;
+	if (p->cflags & REG_EXTENDED)
+		return p->s[p->pos] == ')';
+	return p->s[p->pos] == '\\' && p->s[p->pos + 1] == ')';
+}
+
+static int
+at_branch_end(struct parser *p)
+{
+	return !p->s[p->pos] || at_alt(p) || at_close(p);
+}
+
+static int
+parse_group(struct parser *p, size_t len)
+{
+	int group;
+	int child;
+	uint32_t idx;
+
+	if (p->depth >= RE_DEPTH_MAX)
+	{
+		p->err = REG_ESPACE;
+		return -1;
+	}
+	p->pos += len;
+	idx = ++p->nsub;
+	p->depth++;
+	child = parse_alt(p);
+	if (child != -1 && !at_close(p))
+	{
+		p->err = REG_EPAREN;
+		child = -1;
+	}
+	p->depth--;
+	if (child == -1)
+		return -1;
+	p->pos += len;
+	if (idx < 10)
+		p->closed |= 1u << idx;
+	group = new_node(p, NODE_GROUP);
+	if (group == -1)
+		return -1;
+	p->nodes[group].child = child;
+	p->nodes[group].value = idx;
+	return group;
+}
+
+static int
+parse_backref(struct parser *p, unsigned char c)
+{
+	int node;
+	uint32_t idx = c - '0';
+
+	if (!(p->closed & (1u << idx)))
+	{
+		p->err = REG_ESUBREG;
+		return -1;
+	}
+	p->pos += 2;
+	p->has_backref = 1;
+	node = new_node(p, NODE_BACKREF);
+	if (node != -1)
+		p->nodes[node].value = idx;
+	return node;
+}
+
+static int
+parse_atom_ere(struct parser *p)
+{
+	unsigned char c = p->s[p->pos];
+
+	switch (c)
+	{
+		case '(':
+			return parse_group(p, 1);
+		case '.':
+			p->pos++;
+			return new_any_node(p);
+		case '[':
+			return parse_bracket(p);
+		case '^':
+			p->pos++;
+			return new_node(p, NODE_BOL);
+		case '$':
+			p->pos++;
+			return new_node(p, NODE_EOL);
+		case '*':
+		case '+':
+		case '?':
+			p->err = REG_BADRPT;
+			return -1;
+		case '{':
+			if (isdigit(p->s[p->pos + 1]) || p->s[p->pos + 1] == ',')
+			{
+				p->err = REG_BADRPT;
+				return -1;
+			}
+			break;
+		case '\\':
+			c = p->s[p->pos + 1];
+			if (!c)
+			{
+				p->err = REG_EESCAPE;
+				return -1;
+			}
+			if (c >= '1' && c <= '9')
+				return parse_backref(p, c);
+			p->pos += 2;
+			return new_char_node(p, c);
+	}
+	p->pos++;
+	return new_char_node(p, c);
+}
+
+static int
+parse_atom_bre(struct parser *p, int first)
+{
+	unsigned char c = p->s[p->pos];
+
+	switch (c)
+	{
+		case '.':
+			p->pos++;
+			return new_any_node(p);
+		case '[':
+			return parse_bracket(p);
+		case '^':
+			if (!first)
+				break;
+			p->pos++;
+			return new_node(p, NODE_BOL);
+		case '$':
+			p->pos++;
+			if (!at_branch_end(p))
+				return new_char_node(p, c);
+			return new_node(p, NODE_EOL);
+		case '\\':
+			c = p->s[p->pos + 1];
+			if (!c)
+			{
+				p->err = REG_EESCAPE;
+				return -1;
+			}
+			if (c == '(')
+				return parse_group(p, 2);
+			if (c == '{')
+			{
+				p->err = REG_BADRPT;
+				return -1;
+			}
+			if (c == ')')
+			{
+				p->err = REG_EPAREN;
+				return -1;
+			}
+			if (c >= '1' && c <= '9')
+				return parse_backref(p, c);
+			p->pos += 2;
+			return new_char_node(p, c);
+	}
+	p->pos++;
+	return new_char_node(p, c);
+}
+
+static int
+parse_number(struct parser *p)
+{
+	int n = 0;
+
+	if (!isdigit(p->s[p->pos]))
+		return -1;
+	while (isdigit(p->s[p->pos]))
+	{
+		n = n * 10 + p->s[p->pos++] - '0';
+		if (n > _POSIX2_RE_DUP_MAX)
+			return -2;
+	}
+	return n;
+}
+
+/* p->pos is right after the opening brace */
+static int
+parse_interval(struct parser *p, int *min, int *max)
+{
+	*min = parse_number(p);
+	if (*min == -2)
+		goto badbr;
+	if (p->s[p->pos] == ',')
+	{
+		p->pos++;
+		*max = parse_number(p);
+		if (*max == -2)
+			goto badbr;
+		if (*min == -1)
+			*min = 0;
+	}
+	else
+	{
+		if (*min == -1)
+			goto badbr;
+		*max = *min;
+	}
+	if (p->cflags & REG_EXTENDED)
+	{
+		if (p->s[p->pos] != '}')
+			goto ebrace;
+		p->pos++;
+	}
+	else
+	{
+		if (p->s[p->pos] != '\\' || p->s[p->pos + 1] != '}')
+			goto ebrace;
+		p->pos += 2;
+	}
+	if (*max != -1 && *max < *min)
+		goto badbr;
+	return 0;
+
+ebrace:
+	p->err = p->s[p->pos] ? REG_BADBR : REG_EBRACE;
+	return -1;
+
+badbr:
+	p->err = REG_BADBR;
+	return -1;
+}
+
+/* returns 1 and the bounds if a repeat operator is at p->pos */
+static int
+parse_dup(struct parser *p, int *min, int *max)
+{
+	unsigned char c = p->s[p->pos];
+	size_t len = 1;
+
+	if (!(p->cflags & REG_EXTENDED))
+	{
+		if (c == '*')
+		{
+			p->pos++;
+			*min = 0;
+			*max = -1;
+			return 1;
+		}
+		if (c != '\\')
+			return 0;
+		c = p->s[p->pos + 1];
+		if (c != '{' && c != '+' && c != '?')
+			return 0;
+		len = 2;
+	}
+	switch (c)
+	{
+		case '*':
+			*min = 0;
+			*max = -1;
+			break;
+		case '+':
+			*min = 1;
+			*max = -1;
+			break;
+		case '?':
+			*min = 0;
+			*max = 1;
+			break;
+		case '{':
+			if ((p->cflags & REG_EXTENDED)
+			 && !isdigit(p->s[p->pos + 1])
+			 && p->s[p->pos + 1] != ',')
+				return 0;
+			p->pos += len;
+			if (parse_interval(p, min, max))
+				return -1;
+			return 1;
+		default:
+			return 0;
+	}
+	p->pos += len;
+	return 1;
+}
+
+static int
+parse_piece(struct parser *p, int first)
+{
+	int node;
+	int min;
+	int max;
+	int ret;
+
+	if ((p->cflags & REG_EXTENDED) || !first || p->s[p->pos] != '*')
+	{
+		if (p->cflags & REG_EXTENDED)
+			node = parse_atom_ere(p);
+		else
+			node = parse_atom_bre(p, first);
+	}
+	else
+	{
+		p->pos++;
+		node = new_char_node(p, '*');
+	}
+	if (node == -1)
+		return -1;
+	/* a leading ^ doesn't prevent a literal * in a bre */
+	if (!(p->cflags & REG_EXTENDED)
+	 && p->nodes[node].type == NODE_BOL)
+		return node;
+	while ((ret = parse_dup(p, &min, &max)) == 1)
+	{
+		int repeat = new_node(p, NODE_REPEAT);
+		if (repeat == -1)
+			return -1;
+		p->nodes[repeat].child = node;
+		p->nodes[repeat].min = min;
+		p->nodes[repeat].max = max;
+		node = repeat;
+	}
+	if (ret == -1)
+		return -1;
+	return node;
+}
+
+static int
+parse_branch(struct parser *p)
+{
+	int head = -1;
+	int last = -1;
+	int first = 1;
+	int cat;
+
+	while (!at_branch_end(p))
+	{
+		int node = parse_piece(p, first);
+		if (node == -1)
+			return -1;
+		first = p->nodes[node].type == NODE_BOL
+		     && !(p->cflags & REG_EXTENDED);
+		if (head == -1)
+			head = node;
+		else
+			p->nodes[last].next = node;
+		last = node;
+	}
+	if (head == -1)
+		return new_node(p, NODE_EMPTY);
+	if (head == last)
+		return head;
+	cat = new_node(p, NODE_CAT);
+	if (cat != -1)
+		p->nodes[cat].child = head;
+	return cat;
+}
+
+static int
+parse_alt(struct parser *p)
+{
+	int head;
+	int last;
+	int alt;
+
+	head = parse_branch(p);
+	if (head == -1)
+		return -1;
+	last = head;
+	while (at_alt(p))
+	{
+		int node;
+
+		p->pos += (p->cflags & REG_EXTENDED) ? 1 : 2;
+		node = parse_branch(p);
+		if (node == -1)
+			return -1;
+		p->nodes[last].next = node;
+		last = node;
+	}
+	if (head == last)
+		return head;
+	alt = new_node(p, NODE_ALT);
+	if (alt != -1)
+		p->nodes[alt].child = head;
+	return alt;
+}
+
+static int
+nullable(const struct parser *p, int idx)
+{
+	const struct node *node = &p->nodes[idx];
+
+	switch (node->type)
+	{
+		case NODE_SET:
+			return 0;
+		case NODE_CAT:
+			for (int child = node->child; child != -1; child = p->nodes[child].next)
+			{
+				if (!nullable(p, child))
+					return 0;
+			}
+			return 1;
+		case NODE_ALT:
+			for (int child = node->child; child != -1; child = p->nodes[child].next)
+			{
+				if (nullable(p, child))
+					return 1;
+			}
+			return 0;
+		case NODE_REPEAT:
+			return !node->min || nullable(p, node->child);
+		case NODE_GROUP:
+			return nullable(p, node->child);
+		default:
+			return 1;
+	}
+}
+
+static uint32_t
+emit(struct compiler *c, enum re_op op, uint32_t x, uint32_t y)
+{
+	struct re_inst *inst;
+
+	if (c->err)
+		return 0;
+	if (c->insts_nb == c->insts_size)
+	{
+		size_t size = c->insts_size ? c->insts_size * 2 : 64;
+		struct re_inst *insts;
+		if (size > RE_INSTS_MAX)
+		{
+			c->err = REG_ESPACE;
+			return 0;
+		}
+		insts = realloc(c->insts, sizeof(*insts) * size);
+		if (!insts)
+		{
+			c->err = REG_ESPACE;
+			return 0;
+		}
+		c->insts = insts;
+		c->insts_size = size;
+	}
+	inst = &c->insts[c->insts_nb];
+	inst->op = op;
+	inst->x = x;
+	inst->y = y;
+	return c->insts_nb++;
+}
+
+static void compile_node(struct compiler *c, int idx);
+
+static void
+compile_repeat(struct compiler *c, const struct node *node)
+{
+	uint32_t chain = UINT32_MAX;
+
+	for (int i = 0; i < node->min && !c->err; ++i)
+		compile_node(c, node->child);
+	if (node->max == -1)
+	{
+		uint32_t loop = emit(c, RE_OP_SPLIT, 0, 0);
+		if (nullable(c->parser, node->child))
+		{
+			uint32_t mark = c->nmarks++;
+			emit(c, RE_OP_MARK, mark, 0);
+			compile_node(c, node->child);
+			emit(c, RE_OP_CHECK, mark, 0);
+		}
+		else
+		{
+			compile_node(c, node->child);
+		}
+		emit(c, RE_OP_JMP, loop, 0);
+		if (c->err)
+			return;
+		c->insts[loop].x = loop + 1;
+		c->insts[loop].y = c->insts_nb;
+		return;
+	}
+	/* each optional copy jumps over the remaining ones */
+	for (int i = node->min; i < node->max && !c->err; ++i)
+	{
+		uint32_t split = emit(c, RE_OP_SPLIT, 0, chain);
+		if (c->err)
+			return;
+		c->insts[split].x = split + 1;
+		chain = split;
+		compile_node(c, node->child);
+	}
+	if (c->err)
+		return;
+	while (chain != UINT32_MAX)
+	{
+		uint32_t next = c->insts[chain].y;
+		c->insts[chain].y = c->insts_nb;
+		chain = next;
+	}
+}
+
+static void
+compile_node(struct compiler *c, int idx)
+{
+	const struct node *node = &c->parser->nodes[idx];
+
+	if (c->err)
+		return;
+	switch (node->type)
+	{
+		case NODE_EMPTY:
+			break;
+		case NODE_SET:
+			emit(c, RE_OP_SET, node->value, 0);
+			break;
+		case NODE_CAT:
+			for (int child = node->child; child != -1; child = c->parser->nodes[child].next)
+				compile_node(c, child);
+			break;
+		case NODE_ALT:
+		{
+			uint32_t chain = UINT32_MAX;
+			for (int child = node->child; child != -1; child = c->parser->nodes[child].next)
+			{
+				uint32_t split = 0;
+				if (c->parser->nodes[child].next != -1)
+					split = emit(c, RE_OP_SPLIT, 0, 0);
+				compile_node(c, child);
+				if (c->parser->nodes[child].next == -1)
+					break;
+				uint32_t jmp = emit(c, RE_OP_JMP, chain, 0);
+				if (c->err)
+					return;
+				chain = jmp;
+				c->insts[split].x = split + 1;
+				c->insts[split].y = c->insts_nb;
+			}
+			if (c->err)
+				return;
+			while (chain != UINT32_MAX)
+			{
+				uint32_t next = c->insts[chain].x;
+				c->insts[chain].x = c->insts_nb;
+				chain = next;
+			}
+			break;
+		}
+		case NODE_REPEAT:
+			compile_repeat(c, node);
+			break;
+		case NODE_GROUP:
+			emit(c, RE_OP_SAVE, node->value * 2, 0);
+			compile_node(c, node->child);
+			emit(c, RE_OP_SAVE, node->value * 2 + 1, 0);
+			break;
+		case NODE_BOL:
+			emit(c, RE_OP_BOL, 0, 0);
+			break;
+		case NODE_EOL:
+			emit(c, RE_OP_EOL, 0, 0);
+			break;
+		case NODE_BACKREF:
+			emit(c, RE_OP_BACKREF, node->value, 0);
+			break;
+	}
+}
+
+static void
+literal_flush(struct literal *cur, struct literal *best)
+{
+	if (cur->len > best->len)
+		*best = *cur;
+	cur->len = 0;
+}
+
+/*
+ * find the longest run of single-byte sets every match has to go through;
+ * returns 0 if anything else than such a run was encountered
+ */
+static int
+literal_walk(const struct parser *p, int idx, struct literal *cur,
+             struct literal *best)
+{
+	const struct node *node = &p->nodes[idx];
+	int pure = 1;
+
+	switch (node->type)
+	{
+		case NODE_EMPTY:
+			return 1;
+		case NODE_SET:
+		{
+			const uint32_t *set = p->sets[node->value];
+			int c = -1;
+			for (unsigned i = 0; i < 256; ++i)
+			{
+				if (!re_set_has(set, i))
+					continue;
+				if (c != -1)
+				{
+					literal_flush(cur, best);
+					return 0;
+				}
+				c = i;
+			}
+			if (c == -1)
+			{
+				literal_flush(cur, best);
+				return 0;
+			}
+			if (cur->len < sizeof(cur->data))
+				cur->data[cur->len++] = c;
+			else
+				pure = 0;
+			return pure;
+		}
+		case NODE_CAT:
+			for (int child = node->child; child != -1; child = p->nodes[child].next)
+			{
+				if (!literal_walk(p, child, cur, best))
+					pure = 0;
+			}
+			return pure;
+		case NODE_GROUP:
+			literal_walk(p, node->child, cur, best);
+			return 0;
+		case NODE_REPEAT:
+			if (node->min == 1 && node->max == 1)
+				return literal_walk(p, node->child, cur, best);
+			literal_flush(cur, best);
+			if (node->min)
+			{
+				literal_walk(p, node->child, cur, best);
+				literal_flush(cur, best);
+			}
+			return 0;
+		default:
+			literal_flush(cur, best);
+			return 0;
+	}
+}
+
+static void
+set_classes(struct re_prog *prog)
+{
+	uint8_t map[256][2];
+	size_t nb = 1;
+
+	memset(prog->classes, 0, sizeof(prog->classes));
+	/* '\n' may be an anchor boundary, keep it on its own */
+	prog->classes['\n'] = nb++;
+	for (size_t i = 0; i < prog->sets_nb; ++i)
+	{
+		size_t new_nb = 0;
+
+		memset(map, 0xFF, sizeof(map));
+		for (unsigned c = 0; c < 256; ++c)
+		{
+			uint8_t *id = &map[prog->classes[c]][re_set_has(prog->sets[i], c)];
+			if (*id == 0xFF)
+				*id = new_nb++;
+			prog->classes[c] = *id;
+		}
+		nb = new_nb;
+	}
+	prog->classes_nb = nb;
+}
+
+static void
+parser_free(struct parser *p)
+{
+	free(p->nodes);
+	free(p->sets);
+}
 
 int
-regcomp(regex_t *preg, const char *regex, int flags)
-{
-	preg->regex = strdup(regex);
-	if (!preg->regex)
-		return REG_ESPACE;
-	preg->regex_len = strlen(regex);
-	preg->flags = flags;
-	preg->re_nsub = 0;
+regcomp(regex_t *preg, const char *regex, int cflags)
+{
+	struct parser parser;
+	struct compiler compiler;
+	struct literal cur;
+	struct literal best;
+	struct re_prog *prog;
+	int root;
+	int pure;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.s = (const unsigned char*)regex;
+	parser.cflags = cflags;
+	root = parse_alt(&parser);
+	if (root != -1 && parser.s[parser.pos])
+		parser.err = REG_EPAREN;
+	if (parser.err)
+	{
+		parser_free(&parser);
+		return parser.err;
+	}
+	memset(&compiler, 0, sizeof(compiler));
+	compiler.parser = &parser;
+	emit(&compiler, RE_OP_SAVE, 0, 0);
+	compile_node(&compiler, root);
+	emit(&compiler, RE_OP_SAVE, 1, 0);
+	emit(&compiler, RE_OP_MATCH, 0, 0);
+	if (compiler.err)
+	{
+		free(compiler.insts);
+		parser_free(&parser);
+		return compiler.err;
+	}
+	prog = calloc(1, sizeof(*prog));
+	if (!prog)
+		goto espace;
+	prog->insts = compiler.insts;
+	prog->insts_nb = compiler.insts_nb;
+	prog->sets = parser.sets;
+	prog->sets_nb = parser.sets_nb;
+	prog->nsub = parser.nsub;
+	prog->nmarks = compiler.nmarks;
+	prog->cflags = cflags;
+	prog->has_backref = parser.has_backref;
+	for (size_t i = 0; i < prog->sets_nb; ++i)
+	{
+		if (re_set_has(prog->sets[i], '\n'))
+			prog->can_match_nl = 1;
+	}
+	set_classes(prog);
+	cur.len = 0;
+	best.len = 0;
+	pure = literal_walk(&parser, root, &cur, &best);
+	literal_flush(&cur, &best);
+	if (best.len)
+	{
+		prog->literal = malloc(best.len);
+		if (!prog->literal)
+			goto espace;
+		memcpy(prog->literal, best.data, best.len);
+		prog->literal_len = best.len;
+		prog->is_literal = pure;
+	}
+	_libc_lock_init(&prog->dfa_lock);
+	free(parser.nodes);
+	preg->re_nsub = prog->nsub;
+	preg->re_prog = prog;
 	return 0;
+
+espace:
+	free(prog);
+	free(compiler.insts);
+	parser_free(&parser);
+	return REG_ESPACE;
 }
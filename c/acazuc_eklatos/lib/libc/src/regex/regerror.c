@@ -1,11 +1,61 @@
+#include <string.h>
 #include <regex.h>
 
 size_t
 regerror(int err, const regex_t *regex, char *buf, size_t size)
 {
-	(void)err;
+	const char *msg;
+
 	(void)regex;
-	(void)buf;
-	(void)size;
-	return 0;
+	switch (err)
+	{
+		case 0:
+			msg = "success";
+			break;
+		case REG_NOMATCH:
+			msg = "no match";
+			break;
+		case REG_BADBR:
+			msg = "invalid content of \\{\\}";
+			break;
+		case REG_BADPAT:
+			msg = "invalid regular expression";
+			break;
+		case REG_BADRPT:
+			msg = "invalid use of repetition operator";
+			break;
+		case REG_EBRACE:
+			msg = "unmatched \\{";
+			break;
+		case REG_EBRACK:
+			msg = "unmatched [";
+			break;
+		case REG_ECOLLATE:
+			msg = "invalid collating element";
+			break;
+		case REG_ECTYPE:
+			msg = "invalid character class";
+			break;
+		case REG_EESCAPE:
+			msg = "trailing backslash";
+			break;
+		case REG_EPAREN:
+			msg = "unmatched ( or \\(";
+			break;
+		case REG_ERANGE:
+			msg = "invalid range end";
+			break;
+		case REG_ESPACE:
+			msg = "out of memory";
+			break;
+		case REG_ESUBREG:
+			msg = "invalid back reference";
+			break;
+		default:
+			msg = "unknown error";
+			break;
+	}
+	if (size)
+		strlcpy(buf, msg, size);
+	return strlen(msg) + 1;
 }
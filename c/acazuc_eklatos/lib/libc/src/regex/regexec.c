@@ -1,24 +1,968 @@
+#include "_regex.h"
+
 #include <string.h>
+#include <stdlib.h>
 #include <regex.h>
-#include <stdio.h>
+#include <ctype.h>
+
+#define DFA_STATES_MAX 4096
+#define DFA_HASH_SIZE 4096
+#define DFA_FLUSH_MAX 16
+
+#define DFA_BOL        (1 << 0) /* ^ holds at this position */
+#define DFA_ACCEPT     (1 << 1) /* a match ends here */
+#define DFA_ACCEPT_EOL (1 << 2) /* a match ends here if $ holds */
+#define DFA_DEAD       (1 << 3) /* no thread left */
+
+#define STACK_RESTORE UINT32_MAX
+
+/*
+ * a dfa state is the set of SET, MATCH and pending EOL instructions
+ * reachable at a position; the start of the program is added at each
+ * position so a single forward pass finds the end of the earliest match
+ */
+struct re_dfa_state
+{
+	struct re_dfa_state *hash_next;
+	uint32_t hash;
+	uint32_t flags;
+	uint32_t *pcs;
+	uint32_t pcs_nb;
+	struct re_dfa_state *next[];
+};
+
+struct sparse_set
+{
+	uint32_t *sparse;
+	uint32_t *dense;
+	uint32_t nb;
+};
+
+struct re_dfa
+{
+	struct re_dfa_state *hash[DFA_HASH_SIZE];
+	struct re_dfa_state *start[2];
+	size_t states_nb;
+	struct sparse_set set;
+	uint32_t *stack;
+	uint32_t *pcs;
+};
+
+struct pike_list
+{
+	struct sparse_set set;
+	regoff_t *caps;
+};
+
+struct pike_stack
+{
+	uint32_t pc;
+	uint32_t slot;
+	regoff_t value;
+};
+
+struct pike
+{
+	const struct re_prog *prog;
+	const unsigned char *text;
+	size_t so;
+	size_t eo;
+	int eflags;
+	size_t nslots;
+	struct pike_list lists[2];
+	struct pike_stack *stack;
+	regoff_t *cap;
+};
+
+static inline int
+sparse_set_has(const struct sparse_set *set, uint32_t v)
+{
+	uint32_t i = set->sparse[v];
+	return i < set->nb && set->dense[i] == v;
+}
+
+static inline void
+sparse_set_add(struct sparse_set *set, uint32_t v)
+{
+	set->sparse[v] = set->nb;
+	set->dense[set->nb++] = v;
+}
+
+static int
+sparse_set_init(struct sparse_set *set, size_t size)
+{
+	set->sparse = calloc(size, sizeof(*set->sparse));
+	set->dense = malloc(sizeof(*set->dense) * size);
+	set->nb = 0;
+	return set->sparse && set->dense ? 0 : -1;
+}
+
+static void
+sparse_set_free(struct sparse_set *set)
+{
+	free(set->sparse);
+	free(set->dense);
+}
+
+static int
+bol_at(const struct re_prog *prog, const unsigned char *text, size_t so,
+       size_t pos, int eflags)
+{
+	if (pos == so)
+		return !(eflags & REG_NOTBOL);
+	return (prog->cflags & REG_NEWLINE) && text[pos - 1] == '\n';
+}
+
+static int
+eol_at(const struct re_prog *prog, const unsigned char *text, size_t eo,
+       size_t pos, int eflags)
+{
+	if (pos == eo)
+		return !(eflags & REG_NOTEOL);
+	return (prog->cflags & REG_NEWLINE) && text[pos] == '\n';
+}
+
+static void
+dfa_flush(struct re_dfa *dfa)
+{
+	for (size_t i = 0; i < DFA_HASH_SIZE; ++i)
+	{
+		struct re_dfa_state *state = dfa->hash[i];
+		while (state)
+		{
+			struct re_dfa_state *next = state->hash_next;
+			free(state);
+			state = next;
+		}
+		dfa->hash[i] = NULL;
+	}
+	dfa->start[0] = NULL;
+	dfa->start[1] = NULL;
+	dfa->states_nb = 0;
+}
+
+void
+re_dfa_free(struct re_dfa *dfa)
+{
+	if (!dfa)
+		return;
+	dfa_flush(dfa);
+	sparse_set_free(&dfa->set);
+	free(dfa->stack);
+	free(dfa->pcs);
+	free(dfa);
+}
+
+static struct re_dfa *
+dfa_new(const struct re_prog *prog)
+{
+	struct re_dfa *dfa;
+
+	dfa = calloc(1, sizeof(*dfa));
+	if (!dfa)
+		return NULL;
+	dfa->stack = malloc(sizeof(*dfa->stack) * (prog->insts_nb + 1));
+	dfa->pcs = malloc(sizeof(*dfa->pcs) * prog->insts_nb);
+	if (sparse_set_init(&dfa->set, prog->insts_nb)
+	 || !dfa->stack
+	 || !dfa->pcs)
+	{
+		re_dfa_free(dfa);
+		return NULL;
+	}
+	return dfa;
+}
+
+/* follow the empty transitions of the stacked instructions into dfa->set */
+static void
+dfa_closure(const struct re_prog *prog, struct re_dfa *dfa, size_t sp,
+            int bol, int eol)
+{
+	while (sp)
+	{
+		uint32_t pc = dfa->stack[--sp];
+		while (!sparse_set_has(&dfa->set, pc))
+		{
+			const struct re_inst *inst = &prog->insts[pc];
+			sparse_set_add(&dfa->set, pc);
+			switch (inst->op)
+			{
+				case RE_OP_JMP:
+					pc = inst->x;
+					continue;
+				case RE_OP_SPLIT:
+					dfa->stack[sp++] = inst->y;
+					pc = inst->x;
+					continue;
+				case RE_OP_SAVE:
+				case RE_OP_MARK:
+				case RE_OP_CHECK:
+					pc++;
+					continue;
+				case RE_OP_BOL:
+					if (!bol)
+						break;
+					pc++;
+					continue;
+				case RE_OP_EOL:
+					if (!eol)
+						break;
+					pc++;
+					continue;
+				default:
+					break;
+			}
+			break;
+		}
+	}
+}
+
+/* resolve the pending EOL of pcs, returns whether a match is reached */
+static int
+dfa_resolve_eol(const struct re_prog *prog, struct re_dfa *dfa,
+                const uint32_t *pcs, size_t pcs_nb, int bol)
+{
+	size_t sp = 0;
+
+	dfa->set.nb = 0;
+	for (size_t i = 0; i < pcs_nb; ++i)
+	{
+		sparse_set_add(&dfa->set, pcs[i]);
+		if (prog->insts[pcs[i]].op == RE_OP_EOL)
+			dfa->stack[sp++] = pcs[i] + 1;
+	}
+	if (!sp)
+		return 0;
+	dfa_closure(prog, dfa, sp, bol, 1);
+	for (size_t i = pcs_nb; i < dfa->set.nb; ++i)
+	{
+		if (prog->insts[dfa->set.dense[i]].op == RE_OP_MATCH)
+			return 1;
+	}
+	return 0;
+}
+
+static int
+pc_cmp(const void *a, const void *b)
+{
+	uint32_t va = *(const uint32_t*)a;
+	uint32_t vb = *(const uint32_t*)b;
+
+	return va < vb ? -1 : va > vb;
+}
+
+/* turn dfa->set into a state, NULL on allocation failure */
+static struct re_dfa_state *
+dfa_state(const struct re_prog *prog, struct re_dfa *dfa, int bol,
+          int *flushed)
+{
+	struct re_dfa_state *state;
+	uint32_t hash = 0x811C9DC5;
+	uint32_t flags = bol ? DFA_BOL : 0;
+	size_t nb = 0;
+
+	for (size_t i = 0; i < dfa->set.nb; ++i)
+	{
+		uint32_t pc = dfa->set.dense[i];
+		switch (prog->insts[pc].op)
+		{
+			case RE_OP_MATCH:
+				flags |= DFA_ACCEPT;
+				/* FALLTHROUGH */
+			case RE_OP_SET:
+			case RE_OP_EOL:
+				dfa->pcs[nb++] = pc;
+				break;
+		}
+	}
+	qsort(dfa->pcs, nb, sizeof(*dfa->pcs), pc_cmp);
+	for (size_t i = 0; i < nb; ++i)
+		hash = (hash ^ dfa->pcs[i]) * 0x01000193;
+	hash = (hash ^ flags) * 0x01000193;
+	for (state = dfa->hash[hash % DFA_HASH_SIZE]; state; state = state->hash_next)
+	{
+		if (state->hash == hash
+		 && (state->flags & (DFA_BOL | DFA_ACCEPT)) == flags
+		 && state->pcs_nb == nb
+		 && !memcmp(state->pcs, dfa->pcs, sizeof(*dfa->pcs) * nb))
+			return state;
+	}
+	if (dfa->states_nb >= DFA_STATES_MAX)
+	{
+		dfa_flush(dfa);
+		*flushed = 1;
+	}
+	state = malloc(sizeof(*state)
+	             + sizeof(*state->next) * prog->classes_nb
+	             + sizeof(*state->pcs) * nb);
+	if (!state)
+		return NULL;
+	state->hash = hash;
+	state->pcs = (uint32_t*)&state->next[prog->classes_nb];
+	state->pcs_nb = nb;
+	memcpy(state->pcs, dfa->pcs, sizeof(*dfa->pcs) * nb);
+	memset(state->next, 0, sizeof(*state->next) * prog->classes_nb);
+	if (!nb)
+		flags |= DFA_DEAD;
+	if (dfa_resolve_eol(prog, dfa, state->pcs, nb, bol))
+		flags |= DFA_ACCEPT_EOL;
+	state->flags = flags;
+	state->hash_next = dfa->hash[hash % DFA_HASH_SIZE];
+	dfa->hash[hash % DFA_HASH_SIZE] = state;
+	dfa->states_nb++;
+	return state;
+}
+
+static struct re_dfa_state *
+dfa_start(const struct re_prog *prog, struct re_dfa *dfa, int bol)
+{
+	int flushed = 0;
+
+	if (dfa->start[bol])
+		return dfa->start[bol];
+	dfa->set.nb = 0;
+	dfa->stack[0] = 0;
+	dfa_closure(prog, dfa, 1, bol, 0);
+	dfa->start[bol] = dfa_state(prog, dfa, bol, &flushed);
+	return dfa->start[bol];
+}
+
+static struct re_dfa_state *
+dfa_step(const struct re_prog *prog, struct re_dfa *dfa,
+         struct re_dfa_state *state, unsigned char c, int *flushed)
+{
+	struct re_dfa_state *next;
+	int nl = (prog->cflags & REG_NEWLINE) && c == '\n';
+	size_t sp = 0;
+	size_t nb;
+
+	dfa->set.nb = 0;
+	for (size_t i = 0; i < state->pcs_nb; ++i)
+	{
+		uint32_t pc = state->pcs[i];
+		sparse_set_add(&dfa->set, pc);
+		if (nl && prog->insts[pc].op == RE_OP_EOL)
+			dfa->stack[sp++] = pc + 1;
+	}
+	if (sp)
+		dfa_closure(prog, dfa, sp, state->flags & DFA_BOL, 1);
+	nb = 0;
+	for (size_t i = 0; i < dfa->set.nb; ++i)
+	{
+		const struct re_inst *inst = &prog->insts[dfa->set.dense[i]];
+		if (inst->op == RE_OP_SET
+		 && re_set_has(prog->sets[inst->x], c))
+			dfa->pcs[nb++] = dfa->set.dense[i] + 1;
+	}
+	memcpy(dfa->stack, dfa->pcs, sizeof(*dfa->pcs) * nb);
+	dfa->stack[nb++] = 0;
+	dfa->set.nb = 0;
+	dfa_closure(prog, dfa, nb, nl, 0);
+	next = dfa_state(prog, dfa, nl, flushed);
+	if (next && !*flushed)
+		state->next[prog->classes[c]] = next;
+	return next;
+}
+
+/*
+ * returns the end of the earliest match in [start, end), -1 if there is
+ * none and -2 if the dfa can't be used (busy, out of memory or thrashing)
+ */
+static ssize_t
+dfa_search(struct re_prog *prog, const unsigned char *text, size_t start,
+           size_t end, int bol, int eol)
+{
+	const uint8_t *classes = prog->classes;
+	struct re_dfa_state *state;
+	struct re_dfa *dfa;
+	size_t flushes = 0;
+	ssize_t ret = -1;
+	size_t pos;
+
+	if (!_libc_trylock(&prog->dfa_lock))
+		return -2;
+	if (!prog->dfa)
+	{
+		prog->dfa = dfa_new(prog);
+		if (!prog->dfa)
+		{
+			ret = -2;
+			goto end;
+		}
+	}
+	dfa = prog->dfa;
+	state = dfa_start(prog, dfa, bol);
+	if (!state)
+	{
+		ret = -2;
+		goto end;
+	}
+	for (pos = start; pos < end; ++pos)
+	{
+		struct re_dfa_state *next;
+		int flushed;
+
+		if (state->flags & (DFA_ACCEPT | DFA_ACCEPT_EOL | DFA_DEAD))
+		{
+			if (state->flags & DFA_ACCEPT)
+			{
+				ret = pos;
+				goto end;
+			}
+			if ((state->flags & DFA_ACCEPT_EOL)
+			 && (prog->cflags & REG_NEWLINE)
+			 && text[pos] == '\n')
+			{
+				ret = pos;
+				goto end;
+			}
+			if (state->flags & DFA_DEAD)
+			{
+				const unsigned char *nl;
+				if (!(prog->cflags & REG_NEWLINE))
+					goto end;
+				nl = memchr(&text[pos], '\n', end - pos);
+				if (!nl)
+					goto end;
+				pos = nl - text;
+			}
+		}
+		next = state->next[classes[text[pos]]];
+		if (next)
+		{
+			state = next;
+			continue;
+		}
+		flushed = 0;
+		next = dfa_step(prog, dfa, state, text[pos], &flushed);
+		if (!next || (flushed && ++flushes > DFA_FLUSH_MAX))
+		{
+			ret = -2;
+			goto end;
+		}
+		state = next;
+	}
+	if ((state->flags & DFA_ACCEPT)
+	 || ((state->flags & DFA_ACCEPT_EOL) && eol))
+		ret = end;
+
+end:
+	_libc_unlock(&prog->dfa_lock);
+	return ret;
+}
+
+static void
+pike_add(struct pike *vm, struct pike_list *list, uint32_t pc, size_t pos)
+{
+	const struct re_prog *prog = vm->prog;
+	regoff_t *cap = vm->cap;
+	size_t sp = 0;
+
+	vm->stack[sp].pc = pc;
+	vm->stack[sp].slot = STACK_RESTORE;
+	sp++;
+	while (sp)
+	{
+		struct pike_stack *entry = &vm->stack[--sp];
+		if (entry->slot != STACK_RESTORE)
+		{
+			cap[entry->slot] = entry->value;
+			continue;
+		}
+		pc = entry->pc;
+		while (!sparse_set_has(&list->set, pc))
+		{
+			const struct re_inst *inst = &prog->insts[pc];
+			sparse_set_add(&list->set, pc);
+			switch (inst->op)
+			{
+				case RE_OP_JMP:
+					pc = inst->x;
+					continue;
+				case RE_OP_SPLIT:
+					vm->stack[sp].pc = inst->y;
+					vm->stack[sp].slot = STACK_RESTORE;
+					sp++;
+					pc = inst->x;
+					continue;
+				case RE_OP_SAVE:
+					if (inst->x < vm->nslots)
+					{
+						vm->stack[sp].slot = inst->x;
+						vm->stack[sp].value = cap[inst->x];
+						sp++;
+						cap[inst->x] = pos;
+					}
+					pc++;
+					continue;
+				case RE_OP_MARK:
+				case RE_OP_CHECK:
+					pc++;
+					continue;
+				case RE_OP_BOL:
+					if (!bol_at(prog, vm->text, vm->so, pos, vm->eflags))
+						break;
+					pc++;
+					continue;
+				case RE_OP_EOL:
+					if (!eol_at(prog, vm->text, vm->eo, pos, vm->eflags))
+						break;
+					pc++;
+					continue;
+				case RE_OP_SET:
+				case RE_OP_MATCH:
+					memcpy(&list->caps[pc * vm->nslots], cap,
+					       sizeof(*cap) * vm->nslots);
+					break;
+				default:
+					break;
+			}
+			break;
+		}
+	}
+}
+
+static void
+pike_free(struct pike *vm)
+{
+	for (size_t i = 0; i < 2; ++i)
+	{
+		sparse_set_free(&vm->lists[i].set);
+		free(vm->lists[i].caps);
+	}
+	free(vm->stack);
+	free(vm->cap);
+}
+
+/*
+ * leftmost-longest search of a match starting in [from, to], threads
+ * being ordered by start position, then by preference
+ */
+static int
+pike_search(struct re_prog *prog, const unsigned char *text, size_t so,
+            size_t eo, size_t from, size_t to, int eflags, regoff_t *caps,
+            size_t nslots)
+{
+	struct pike vm;
+	struct pike_list *clist;
+	struct pike_list *nlist;
+	int matched = 0;
+	int ret = REG_ESPACE;
+
+	vm.prog = prog;
+	vm.text = text;
+	vm.so = so;
+	vm.eo = eo;
+	vm.eflags = eflags;
+	vm.nslots = nslots;
+	vm.stack = malloc(sizeof(*vm.stack) * (prog->insts_nb * 2 + 1));
+	vm.cap = malloc(sizeof(*vm.cap) * nslots);
+	if (!vm.stack || !vm.cap)
+		ret = REG_NOMATCH;
+	for (size_t i = 0; i < 2; ++i)
+	{
+		vm.lists[i].caps = malloc(sizeof(*vm.lists[i].caps) * nslots
+		                        * prog->insts_nb);
+		if (sparse_set_init(&vm.lists[i].set, prog->insts_nb)
+		 || !vm.lists[i].caps)
+			ret = REG_NOMATCH;
+	}
+	if (ret != REG_ESPACE)
+	{
+		ret = REG_ESPACE;
+		goto end;
+	}
+	clist = &vm.lists[0];
+	nlist = &vm.lists[1];
+	for (size_t pos = from;; ++pos)
+	{
+		struct pike_list *tmp;
+
+		if (!matched)
+		{
+			for (size_t i = 0; i < nslots; ++i)
+				vm.cap[i] = -1;
+			pike_add(&vm, clist, 0, pos);
+		}
+		else if (!clist->set.nb)
+		{
+			break;
+		}
+		nlist->set.nb = 0;
+		for (size_t i = 0; i < clist->set.nb; ++i)
+		{
+			uint32_t pc = clist->set.dense[i];
+			const struct re_inst *inst = &prog->insts[pc];
+			regoff_t *tcaps = &clist->caps[pc * nslots];
+
+			if (inst->op != RE_OP_SET && inst->op != RE_OP_MATCH)
+				continue;
+			if (matched && tcaps[0] > caps[0])
+				break;
+			if (inst->op == RE_OP_MATCH)
+			{
+				if (!matched || tcaps[0] < caps[0] || tcaps[1] > caps[1])
+					memcpy(caps, tcaps, sizeof(*caps) * nslots);
+				matched = 1;
+				continue;
+			}
+			if (pos >= to
+			 || !re_set_has(prog->sets[inst->x], text[pos]))
+				continue;
+			memcpy(vm.cap, tcaps, sizeof(*vm.cap) * nslots);
+			pike_add(&vm, nlist, pc + 1, pos + 1);
+		}
+		tmp = clist;
+		clist = nlist;
+		nlist = tmp;
+		if (pos >= to)
+			break;
+	}
+	ret = matched ? 0 : REG_NOMATCH;
+
+end:
+	pike_free(&vm);
+	return ret;
+}
+
+static int
+bt_push(struct pike_stack **stack, size_t *size, size_t sp, uint32_t pc,
+        uint32_t slot, regoff_t value)
+{
+	if (sp == *size)
+	{
+		size_t new_size = *size * 2;
+		struct pike_stack *new_stack = realloc(*stack, sizeof(**stack) * new_size);
+		if (!new_stack)
+			return -1;
+		*stack = new_stack;
+		*size = new_size;
+	}
+	(*stack)[sp].pc = pc;
+	(*stack)[sp].slot = slot;
+	(*stack)[sp].value = value;
+	return 0;
+}
+
+static int
+backref_match(const struct re_prog *prog, const unsigned char *text,
+              size_t eo, size_t pos, const regoff_t *cap, uint32_t group)
+{
+	regoff_t start = cap[group * 2];
+	regoff_t end = cap[group * 2 + 1];
+
+	if (start == -1 || end == -1)
+		return -1;
+	if ((size_t)(end - start) > eo - pos)
+		return -1;
+	if (prog->cflags & REG_ICASE)
+	{
+		for (regoff_t i = 0; i < end - start; ++i)
+		{
+			if (tolower(text[start + i]) != tolower(text[pos + i]))
+				return -1;
+		}
+	}
+	else if (memcmp(&text[start], &text[pos], end - start))
+	{
+		return -1;
+	}
+	return end - start;
+}
+
+/*
+ * back-references make the language non-regular: explore every path from
+ * each start position in turn, keeping the longest match of the first
+ * position having one
+ *
+ * the stack holds either a path to explore (pc, value being the position)
+ * or a capture to restore when backtracking (slot, value)
+ */
+static int
+bt_search(struct re_prog *prog, const unsigned char *text, size_t so,
+          size_t eo, int eflags, regoff_t *caps, size_t nslots)
+{
+	size_t ncap = prog->nsub * 2 + 2 + prog->nmarks;
+	struct pike_stack *stack;
+	size_t size = 64;
+	regoff_t *cap;
+	int ret = REG_ESPACE;
+
+	stack = malloc(sizeof(*stack) * size);
+	cap = malloc(sizeof(*cap) * ncap);
+	if (!stack || !cap)
+		goto end;
+	for (size_t start = so; start <= eo; ++start)
+	{
+		size_t sp = 1;
+		int matched = 0;
+
+		for (size_t i = 0; i < ncap; ++i)
+			cap[i] = -1;
+		stack[0].pc = 0;
+		stack[0].slot = STACK_RESTORE;
+		stack[0].value = start;
+		while (sp)
+		{
+			struct pike_stack entry = stack[--sp];
+			size_t pos = entry.value;
+			uint32_t pc = entry.pc;
+
+			if (entry.slot != STACK_RESTORE)
+			{
+				cap[entry.slot] = entry.value;
+				continue;
+			}
+			while (1)
+			{
+				const struct re_inst *inst = &prog->insts[pc];
+				int len;
+
+				switch (inst->op)
+				{
+					case RE_OP_SET:
+						if (pos >= eo
+						 || !re_set_has(prog->sets[inst->x], text[pos]))
+							break;
+						pos++;
+						pc++;
+						continue;
+					case RE_OP_JMP:
+						pc = inst->x;
+						continue;
+					case RE_OP_SPLIT:
+						if (bt_push(&stack, &size, sp, inst->y,
+						            STACK_RESTORE, pos))
+							goto end;
+						sp++;
+						pc = inst->x;
+						continue;
+					case RE_OP_SAVE:
+						if (bt_push(&stack, &size, sp, 0, inst->x,
+						            cap[inst->x]))
+							goto end;
+						sp++;
+						cap[inst->x] = pos;
+						pc++;
+						continue;
+					case RE_OP_MARK:
+					{
+						uint32_t slot = prog->nsub * 2 + 2 + inst->x;
+						if (bt_push(&stack, &size, sp, 0, slot, cap[slot]))
+							goto end;
+						sp++;
+						cap[slot] = pos;
+						pc++;
+						continue;
+					}
+					case RE_OP_CHECK:
+						if (cap[prog->nsub * 2 + 2 + inst->x] == (regoff_t)pos)
+							break;
+						pc++;
+						continue;
+					case RE_OP_BOL:
+						if (!bol_at(prog, text, so, pos, eflags))
+							break;
+						pc++;
+						continue;
+					case RE_OP_EOL:
+						if (!eol_at(prog, text, eo, pos, eflags))
+							break;
+						pc++;
+						continue;
+					case RE_OP_BACKREF:
+						len = backref_match(prog, text, eo, pos, cap, inst->x);
+						if (len == -1)
+							break;
+						pos += len;
+						pc++;
+						continue;
+					case RE_OP_MATCH:
+						if (!matched || cap[1] > caps[1])
+							memcpy(caps, cap, sizeof(*caps) * nslots);
+						matched = 1;
+						break;
+				}
+				break;
+			}
+			if (matched && (size_t)caps[1] == eo)
+				break;
+		}
+		if (matched)
+		{
+			ret = 0;
+			goto end;
+		}
+	}
+	ret = REG_NOMATCH;
+
+end:
+	free(stack);
+	free(cap);
+	return ret;
+}
+
+/*
+ * with REG_NEWLINE and a pattern unable to cross lines, only the line
+ * holding the dfa match (or the required literal) goes through the vm
+ */
+static int
+line_search(struct re_prog *prog, const unsigned char *text, size_t so,
+            size_t eo, int eflags, regoff_t *caps, size_t nslots,
+            size_t nmatch)
+{
+	size_t pos = so;
+
+	while (1)
+	{
+		const unsigned char *it;
+		size_t ls = pos;
+		size_t le = eo;
+		ssize_t end;
+		int ret;
+
+		if (prog->literal)
+		{
+			size_t off;
+
+			it = memmem(&text[pos], eo - pos, prog->literal,
+			            prog->literal_len);
+			if (!it)
+				return REG_NOMATCH;
+			off = it - text;
+			it = memrchr(&text[pos], '\n', off - pos);
+			if (it)
+				ls = it - text + 1;
+			it = memchr(&text[off], '\n', eo - off);
+			if (it)
+				le = it - text;
+			end = dfa_search(prog, text, ls, le,
+			                 bol_at(prog, text, so, ls, eflags),
+			                 eol_at(prog, text, eo, le, eflags));
+		}
+		else
+		{
+			end = dfa_search(prog, text, pos, eo,
+			                 bol_at(prog, text, so, pos, eflags),
+			                 eol_at(prog, text, eo, eo, eflags));
+			if (end == -1)
+				return REG_NOMATCH;
+			if (end >= 0)
+			{
+				it = memrchr(&text[pos], '\n', end - pos);
+				if (it)
+					ls = it - text + 1;
+				it = memchr(&text[end], '\n', eo - end);
+				if (it)
+					le = it - text;
+			}
+		}
+		if (end >= 0 && !nmatch)
+			return 0;
+		if (end != -1)
+		{
+			ret = pike_search(prog, text, so, eo, ls, le, eflags, caps,
+			                  nslots);
+			if (ret != REG_NOMATCH || end >= 0)
+				return ret;
+		}
+		if (le == eo)
+			return REG_NOMATCH;
+		pos = le + 1;
+	}
+}
+
+static int
+search(struct re_prog *prog, const unsigned char *text, size_t so,
+       size_t eo, int eflags, regoff_t *caps, size_t nslots, size_t nmatch)
+{
+	ssize_t end;
+
+	if (prog->is_literal)
+	{
+		const unsigned char *it = memmem(&text[so], eo - so, prog->literal,
+		                                 prog->literal_len);
+		if (!it)
+			return REG_NOMATCH;
+		caps[0] = it - text;
+		caps[1] = caps[0] + prog->literal_len;
+		return 0;
+	}
+	if (!prog->has_backref
+	 && (prog->cflags & REG_NEWLINE)
+	 && !prog->can_match_nl)
+		return line_search(prog, text, so, eo, eflags, caps, nslots,
+		                   nmatch);
+	if (prog->literal && !memmem(&text[so], eo - so, prog->literal,
+	                             prog->literal_len))
+		return REG_NOMATCH;
+	if (prog->has_backref)
+		return bt_search(prog, text, so, eo, eflags, caps, nslots);
+	end = dfa_search(prog, text, so, eo, !(eflags & REG_NOTBOL),
+	                 !(eflags & REG_NOTEOL));
+	if (end == -1)
+		return REG_NOMATCH;
+	if (end >= 0 && !nmatch)
+		return 0;
+	return pike_search(prog, text, so, eo, so, eo, eflags, caps, nslots);
+}
 
 int
-regexec(const regex_t *regex,
-        const char *str,
+regexec(const regex_t *preg,
+        const char *string,
         size_t nmatch,
-        regmatch_t *matches,
-        int flags)
+        regmatch_t *pmatch,
+        int eflags)
 {
-	char *it;
+	struct re_prog *prog = preg->re_prog;
+	regoff_t local_caps[20];
+	regoff_t *caps = local_caps;
+	size_t nslots;
+	size_t so;
+	size_t eo;
+	int ret;
 
-	(void)flags;
-	it = strstr(str, regex->regex);
-	if (!it)
-		return REG_NOMATCH;
-	if (nmatch)
+	if (eflags & REG_STARTEND)
 	{
-		matches[0].rm_so = it - str;
-		matches[0].rm_eo = matches[0].rm_so + regex->regex_len;
+		so = pmatch[0].rm_so;
+		eo = pmatch[0].rm_eo;
 	}
-	return 0;
+	else
+	{
+		so = 0;
+		eo = strlen(string);
+	}
+	if (prog->cflags & REG_NOSUB)
+		nmatch = 0;
+	if (nmatch > prog->nsub + 1)
+		nslots = (prog->nsub + 1) * 2;
+	else
+		nslots = nmatch ? nmatch * 2 : 2;
+	if (nslots > sizeof(local_caps) / sizeof(*local_caps))
+	{
+		caps = malloc(sizeof(*caps) * nslots);
+		if (!caps)
+			return REG_ESPACE;
+	}
+	ret = search(prog, (const unsigned char*)string, so, eo, eflags, caps,
+	             nslots, nmatch);
+	if (!ret)
+	{
+		for (size_t i = 0; i < nmatch; ++i)
+		{
+			if (i * 2 < nslots)
+			{
+				pmatch[i].rm_so = caps[i * 2];
+				pmatch[i].rm_eo = caps[i * 2 + 1];
+			}
+			else
+			{
+				pmatch[i].rm_so = -1;
+				pmatch[i].rm_eo = -1;
+			}
+		}
+	}
+	if (caps != local_caps)
+		free(caps);
+	return ret;
 }
@@ -1,9 +1,19 @@
+#include "_regex.h"
+
 #include <stdlib.h>
 #include <regex.h>
 
 void
 regfree(regex_t *regex)
 {
-	free(regex->regex);
-	regex->regex = NULL;
+	struct re_prog *prog = regex->re_prog;
+
+	if (!prog)
+		return;
+	re_dfa_free(prog->dfa);
+	free(prog->insts);
+	free(prog->sets);
+	free(prog->literal);
+	free(prog);
+	regex->re_prog = NULL;
 }
@@ -0,0 +1,13 @@
+#include "_syscall.h"
+
+#include <sys/sendfile.h>
+
+ssize_t
+sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+	return syscall4(SYS_sendfile,
+	                out_fd,
+	                in_fd,
+	                (uintptr_t)offset,
+	                count);
+}
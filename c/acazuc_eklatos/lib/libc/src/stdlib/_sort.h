@@ -0,0 +1,77 @@
+#ifndef _SORT_H
+#define _SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* elements are moved by the widest word dividing both the size and base */
+enum sort_width
+{
+	SORT_WIDTH_1,
+	SORT_WIDTH_4,
+	SORT_WIDTH_8,
+};
+
+static inline enum sort_width
+sort_width(const void *base, size_t size)
+{
+	if (!(((uintptr_t)base | size) % sizeof(uint64_t)))
+		return SORT_WIDTH_8;
+	if (!(((uintptr_t)base | size) % sizeof(uint32_t)))
+		return SORT_WIDTH_4;
+	return SORT_WIDTH_1;
+}
+
+static inline void
+sort_swap(void *a, void *b, size_t size, enum sort_width width)
+{
+	switch (width)
+	{
+		case SORT_WIDTH_8:
+			for (size_t i = 0; i < size / sizeof(uint64_t); ++i)
+			{
+				uint64_t tmp = ((uint64_t*)a)[i];
+				((uint64_t*)a)[i] = ((uint64_t*)b)[i];
+				((uint64_t*)b)[i] = tmp;
+			}
+			break;
+		case SORT_WIDTH_4:
+			for (size_t i = 0; i < size / sizeof(uint32_t); ++i)
+			{
+				uint32_t tmp = ((uint32_t*)a)[i];
+				((uint32_t*)a)[i] = ((uint32_t*)b)[i];
+				((uint32_t*)b)[i] = tmp;
+			}
+			break;
+		case SORT_WIDTH_1:
+			for (size_t i = 0; i < size; ++i)
+			{
+				uint8_t tmp = ((uint8_t*)a)[i];
+				((uint8_t*)a)[i] = ((uint8_t*)b)[i];
+				((uint8_t*)b)[i] = tmp;
+			}
+			break;
+	}
+}
+
+static inline void
+sort_copy(void *dst, const void *src, size_t size, enum sort_width width)
+{
+	switch (width)
+	{
+		case SORT_WIDTH_8:
+			for (size_t i = 0; i < size / sizeof(uint64_t); ++i)
+				((uint64_t*)dst)[i] = ((const uint64_t*)src)[i];
+			break;
+		case SORT_WIDTH_4:
+			for (size_t i = 0; i < size / sizeof(uint32_t); ++i)
+				((uint32_t*)dst)[i] = ((const uint32_t*)src)[i];
+			break;
+		case SORT_WIDTH_1:
+			for (size_t i = 0; i < size; ++i)
+				((uint8_t*)dst)[i] = ((const uint8_t*)src)[i];
+			break;
+	}
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "_sort.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * stable bottom-up merge sort: runs of RUN_SIZE elements are first sorted
+ * by insertion, then merged by pairs, going back and forth between base
+ * and a temporary buffer of the same size
+ *
+ * a merge whose halves are already in order is a plain copy, which makes
+ * sorted inputs linear
+ */
+
+#define RUN_SIZE 16
+
+struct sort
+{
+	size_t size;
+	enum sort_width width;
+	int (*cmp)(const void *, const void *);
+};
+
+#define ELEM(base, i) (&((uint8_t*)(base))[(i) * sort->size])
+
+static void
+insertion_sort(const struct sort *sort, void *base, size_t nmemb)
+{
+	for (size_t i = 1; i < nmemb; ++i)
+	{
+		for (size_t j = i; j > 0; --j)
+		{
+			uint8_t *a = ELEM(base, j - 1);
+			uint8_t *b = ELEM(base, j);
+			if (sort->cmp(a, b) <= 0)
+				break;
+			sort_swap(a, b, sort->size, sort->width);
+		}
+	}
+}
+
+static void
+merge(const struct sort *sort, const void *src, void *dst, size_t nleft,
+      size_t nright)
+{
+	const uint8_t *left = src;
+	const uint8_t *right = ELEM(src, nleft);
+	const uint8_t *left_end = right;
+	const uint8_t *right_end = ELEM(right, nright);
+	uint8_t *out = dst;
+
+	if (!nright || sort->cmp(ELEM(left, nleft - 1), right) <= 0)
+	{
+		memcpy(dst, src, (nleft + nright) * sort->size);
+		return;
+	}
+	while (left < left_end && right < right_end)
+	{
+		if (sort->cmp(left, right) <= 0)
+		{
+			sort_copy(out, left, sort->size, sort->width);
+			left += sort->size;
+		}
+		else
+		{
+			sort_copy(out, right, sort->size, sort->width);
+			right += sort->size;
+		}
+		out += sort->size;
+	}
+	if (left < left_end)
+		memcpy(out, left, left_end - left);
+	else
+		memcpy(out, right, right_end - right);
+}
+
+int
+mergesort(void *base,
+          size_t nmemb,
+          size_t size,
+          int (*cmp)(const void *, const void *))
+{
+	struct sort sort;
+	void *tmp;
+	void *src;
+	void *dst;
+
+	if (nmemb < 2 || !size)
+		return 0;
+	if (nmemb > SIZE_MAX / size)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+	sort.size = size;
+	sort.width = sort_width(base, size);
+	sort.cmp = cmp;
+	for (size_t i = 0; i < nmemb; i += RUN_SIZE)
+	{
+		size_t n = nmemb - i;
+		if (n > RUN_SIZE)
+			n = RUN_SIZE;
+		insertion_sort(&sort, &((uint8_t*)base)[i * size], n);
+	}
+	if (nmemb <= RUN_SIZE)
+		return 0;
+	tmp = malloc(nmemb * size);
+	if (!tmp)
+		return -1;
+	if (sort_width(tmp, size) < sort.width)
+		sort.width = sort_width(tmp, size);
+	src = base;
+	dst = tmp;
+	for (size_t width = RUN_SIZE; width < nmemb; width *= 2)
+	{
+		for (size_t i = 0; i < nmemb; i += width * 2)
+		{
+			size_t nleft = nmemb - i;
+			size_t nright;
+			if (nleft > width)
+				nleft = width;
+			nright = nmemb - i - nleft;
+			if (nright > width)
+				nright = width;
+			merge(&sort, &((uint8_t*)src)[i * size],
+			      &((uint8_t*)dst)[i * size], nleft, nright);
+		}
+		void *swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != base)
+		memcpy(base, src, nmemb * size);
+	free(tmp);
+	return 0;
+}
@@ -1,45 +1,190 @@
+#include "_sort.h"
+
 #include <stdlib.h>
 
-void
-qsort(void *base,
-      size_t nmemb,
-      size_t size,
-      int (*cmp)(const void *, const void *))
+/*
+ * introsort: quicksort with a median of 3 (ninther for large partitions)
+ * pivot, partitions smaller than INSERTION_THRESHOLD left to a final
+ * insertion sort, and a heapsort fallback once the recursion gets deeper
+ * than 2 * log2(nmemb)
+ *
+ * the partition stops on elements equal to the pivot on both sides, which
+ * splits duplicate-heavy inputs evenly; only the smallest side is recursed
+ * into so the stack depth stays O(log(nmemb))
+ */
+
+#define INSERTION_THRESHOLD 16
+#define NINTHER_THRESHOLD 128
+
+struct sort
 {
-	void *pivot;
-	size_t left, right;
+	size_t size;
+	enum sort_width width;
+	int (*cmp)(const void *, const void *);
+};
 
-	if (nmemb < 2)
-		return;
-	pivot = &((uint8_t*)base)[size * ((nmemb - 1) / 2)];
-	right = nmemb;
-	left = (size_t)-1;
-	while (1)
+#define ELEM(base, i) (&((uint8_t*)(base))[(i) * sort->size])
+
+static uint8_t *
+median3(const struct sort *sort, uint8_t *a, uint8_t *b, uint8_t *c)
+{
+	if (sort->cmp(a, b) < 0)
 	{
-		do
-		{
-			right--;
-		} while (cmp(&((uint8_t*)base)[size * right], pivot) > 0);
-		do
+		if (sort->cmp(b, c) < 0)
+			return b;
+		return sort->cmp(a, c) < 0 ? c : a;
+	}
+	if (sort->cmp(a, c) < 0)
+		return a;
+	return sort->cmp(b, c) < 0 ? c : b;
+}
+
+static uint8_t *
+choose_pivot(const struct sort *sort, void *base, size_t nmemb)
+{
+	size_t mid = nmemb / 2;
+	size_t last = nmemb - 1;
+
+	if (nmemb >= NINTHER_THRESHOLD)
+	{
+		size_t step = nmemb / 8;
+		uint8_t *a = median3(sort,
+		                     ELEM(base, 0),
+		                     ELEM(base, step),
+		                     ELEM(base, step * 2));
+		uint8_t *b = median3(sort,
+		                     ELEM(base, mid - step),
+		                     ELEM(base, mid),
+		                     ELEM(base, mid + step));
+		uint8_t *c = median3(sort,
+		                     ELEM(base, last - step * 2),
+		                     ELEM(base, last - step),
+		                     ELEM(base, last));
+		return median3(sort, a, b, c);
+	}
+	return median3(sort,
+	               ELEM(base, nmemb / 4),
+	               ELEM(base, mid),
+	               ELEM(base, last - nmemb / 4));
+}
+
+static void
+insertion_sort(const struct sort *sort, void *base, size_t nmemb)
+{
+	for (size_t i = 1; i < nmemb; ++i)
+	{
+		for (size_t j = i; j > 0; --j)
 		{
+			uint8_t *a = ELEM(base, j - 1);
+			uint8_t *b = ELEM(base, j);
+			if (sort->cmp(a, b) <= 0)
+				break;
+			sort_swap(a, b, sort->size, sort->width);
+		}
+	}
+}
+
+static void
+sift_down(const struct sort *sort, void *base, size_t root, size_t nmemb)
+{
+	while (1)
+	{
+		size_t child = root * 2 + 1;
+		if (child >= nmemb)
+			return;
+		if (child + 1 < nmemb
+		 && sort->cmp(ELEM(base, child), ELEM(base, child + 1)) < 0)
+			child++;
+		if (sort->cmp(ELEM(base, root), ELEM(base, child)) >= 0)
+			return;
+		sort_swap(ELEM(base, root), ELEM(base, child), sort->size,
+		          sort->width);
+		root = child;
+	}
+}
+
+static void
+heap_sort(const struct sort *sort, void *base, size_t nmemb)
+{
+	for (size_t i = nmemb / 2; i > 0; --i)
+		sift_down(sort, base, i - 1, nmemb);
+	for (size_t i = nmemb - 1; i > 0; --i)
+	{
+		sort_swap(ELEM(base, 0), ELEM(base, i), sort->size, sort->width);
+		sift_down(sort, base, 0, i);
+	}
+}
+
+/* returns the final index of the pivot */
+static size_t
+partition(const struct sort *sort, void *base, size_t nmemb)
+{
+	uint8_t *pivot = ELEM(base, 0);
+	size_t left = 1;
+	size_t right = nmemb - 1;
+
+	sort_swap(pivot, choose_pivot(sort, base, nmemb), sort->size,
+	          sort->width);
+	while (1)
+	{
+		while (left <= right && sort->cmp(ELEM(base, left), pivot) < 0)
 			left++;
-		} while (cmp(&((uint8_t*)base)[size * left], pivot) < 0);
+		while (left <= right && sort->cmp(ELEM(base, right), pivot) > 0)
+			right--;
 		if (left >= right)
 			break;
-		uint8_t *src = &((uint8_t*)base)[size * left];
-		uint8_t *dst = &((uint8_t*)base)[size * right];
-		for (size_t i = 0; i < size; ++i)
+		sort_swap(ELEM(base, left), ELEM(base, right), sort->size,
+		          sort->width);
+		left++;
+		right--;
+	}
+	sort_swap(pivot, ELEM(base, right), sort->size, sort->width);
+	return right;
+}
+
+static void
+intro_sort(const struct sort *sort, void *base, size_t nmemb, size_t depth)
+{
+	while (nmemb > INSERTION_THRESHOLD)
+	{
+		if (!depth)
+		{
+			heap_sort(sort, base, nmemb);
+			return;
+		}
+		depth--;
+		size_t mid = partition(sort, base, nmemb);
+		if (mid < nmemb - mid - 1)
 		{
-			uint8_t tmp = src[i];
-			src[i] = dst[i];
-			dst[i] = tmp;
+			intro_sort(sort, base, mid, depth);
+			base = ELEM(base, mid + 1);
+			nmemb -= mid + 1;
+		}
+		else
+		{
+			intro_sort(sort, ELEM(base, mid + 1), nmemb - mid - 1,
+			           depth);
+			nmemb = mid;
 		}
-		if (pivot == src)
-			pivot = dst;
-		else if (pivot == dst)
-			pivot = src;
 	}
-	qsort(base, right + 1, size, cmp);
-	qsort(&((uint8_t*)base)[size * (right + 1)], nmemb - (right + 1), size,
-	      cmp);
+}
+
+void
+qsort(void *base,
+      size_t nmemb,
+      size_t size,
+      int (*cmp)(const void *, const void *))
+{
+	struct sort sort;
+	size_t depth = 0;
+
+	if (nmemb < 2 || !size)
+		return;
+	sort.size = size;
+	sort.width = sort_width(base, size);
+	sort.cmp = cmp;
+	for (size_t n = nmemb; n > 1; n >>= 1)
+		depth += 2;
+	intro_sort(&sort, base, nmemb, depth);
+	insertion_sort(&sort, base, nmemb);
 }
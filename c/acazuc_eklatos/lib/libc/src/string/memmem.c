@@ -1,18 +1,33 @@
 #include <string.h>
 
+/*
+ * let memchr skip to the candidates for the first byte, as it
+ * scans whole vectors at once on architectures providing it
+ */
 void *
 memmem(const void *haystack,
        size_t haystacklen,
        const void *needle,
        size_t needlelen)
 {
+	const unsigned char *it = haystack;
+	const unsigned char *n = needle;
+	const unsigned char *end;
+
+	if (!needlelen)
+		return (void*)haystack;
 	if (needlelen > haystacklen)
 		return NULL;
-	haystacklen -= needlelen;
-	for (size_t i = 0; i <= haystacklen; ++i)
+	end = it + haystacklen - needlelen + 1;
+	while (it < end)
 	{
-		if (!memcmp(&((unsigned char*)haystack)[i], needle, needlelen))
-			return &((unsigned char*)haystack)[i];
+		it = memchr(it, n[0], end - it);
+		if (!it)
+			return NULL;
+		if (it[needlelen - 1] == n[needlelen - 1]
+		 && !memcmp(it + 1, n + 1, needlelen - 1))
+			return (void*)it;
+		it++;
 	}
 	return NULL;
 }
@@ -1889,6 +1889,40 @@ syscalls[] =
 	                     {{"path",          DBG_SYSCALL_ARG_PATH,
 	                                        DBG_SYSCALL_ARG_IN}}},
 
+	[SYS_sendfile]      = {"sendfile",      DBG_SYSCALL_RET_SSIZE, 4,
+	                     {{"out_fd",        DBG_SYSCALL_ARG_FD,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"in_fd",         DBG_SYSCALL_ARG_FD,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"offset",        DBG_SYSCALL_ARG_OFF,
+	                                        DBG_SYSCALL_ARG_INOUT},
+	                      {"count",         DBG_SYSCALL_ARG_ULONG,
+	                                        DBG_SYSCALL_ARG_IN}}},
+
+	[SYS_splice]        = {"splice",        DBG_SYSCALL_RET_SSIZE, 6,
+	                     {{"in_fd",         DBG_SYSCALL_ARG_FD,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"in_off",        DBG_SYSCALL_ARG_OFF,
+	                                        DBG_SYSCALL_ARG_INOUT},
+	                      {"out_fd",        DBG_SYSCALL_ARG_FD,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"out_off",       DBG_SYSCALL_ARG_OFF,
+	                                        DBG_SYSCALL_ARG_INOUT},
+	                      {"count",         DBG_SYSCALL_ARG_ULONG,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"flags",         DBG_SYSCALL_ARG_UINT,
+	                                        DBG_SYSCALL_ARG_IN}}},
+
+	[SYS_vmsplice]      = {"vmsplice",      DBG_SYSCALL_RET_SSIZE, 4,
+	                     {{"fd",            DBG_SYSCALL_ARG_FD,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"iov",           DBG_SYSCALL_ARG_IOV,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"iovcnt",        DBG_SYSCALL_ARG_IOVCNT,
+	                                        DBG_SYSCALL_ARG_IN},
+	                      {"flags",         DBG_SYSCALL_ARG_UINT,
+	                                        DBG_SYSCALL_ARG_IN}}},
+
 	[SYS_getuid]        = {"getuid",        DBG_SYSCALL_RET_UID, 0},
 
 	[SYS_getgid]        = {"getgid",        DBG_SYSCALL_RET_GID, 0},
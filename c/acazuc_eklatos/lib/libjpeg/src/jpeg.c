@@ -523,6 +523,24 @@ huffman_generate(struct huffman *huff,
 		code = (code + counts[i]) << 1;
 	}
 	memcpy(huff->values, values, count);
+	for (size_t i = 0; i < (1 << HUFF_LOOKAHEAD); ++i)
+	{
+		uint16_t value = 0;
+		size_t len = 0;
+		huff->lookahead[i] = 0;
+		while (len < HUFF_LOOKAHEAD)
+		{
+			value |= (i >> (HUFF_LOOKAHEAD - 1 - len)) & 1;
+			if (value < huff->maxcodes[len])
+				break;
+			value <<= 1;
+			len++;
+		}
+		if (len == HUFF_LOOKAHEAD || value < huff->codes[len])
+			continue;
+		uint8_t symbol = huff->values[huff->offsets[len] + (value - huff->codes[len])];
+		huff->lookahead[i] = ((len + 1) << 8) | symbol;
+	}
 }
 
 const char *
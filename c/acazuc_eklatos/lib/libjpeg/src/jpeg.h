@@ -46,6 +46,14 @@
 
 #define JPEG_RSHIFT(v, n) (((v) + (1 << ((n) - 1))) >> (n))
 
+/*
+ * codes up to HUFF_LOOKAHEAD bits are decoded with a single lookup into
+ * struct huffman lookahead, indexed by the next HUFF_LOOKAHEAD bits of the
+ * stream: entries hold the code length in the high byte and the symbol in
+ * the low byte, 0 means the code is longer (or invalid)
+ */
+#define HUFF_LOOKAHEAD 9
+
 struct huffman
 {
 	uint16_t offsets[MAX_BITS];
@@ -55,6 +63,7 @@ struct huffman
 	uint8_t values[256];
 	uint8_t sizes[256];
 	uint16_t map[256];
+	uint16_t lookahead[1 << HUFF_LOOKAHEAD];
 };
 
 struct jpeg
@@ -4,17 +4,21 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
 static const uint8_t
-inv_zigzag_table[64] =
-{
-	 0,  1,  5,  6, 14, 15, 27, 28,
-	 2,  4,  7, 13, 16, 26, 29, 42,
-	 3,  8, 12, 17, 25, 30, 41, 43,
-	 9, 11, 18, 24, 31, 40, 44, 53,
-	10, 19, 23, 32, 39, 45, 52, 54,
-	20, 22, 33, 38, 46, 51, 55, 60,
-	21, 34, 37, 47, 50, 56, 59, 61,
-	35, 36, 48, 49, 57, 58, 62, 63,
+zigzag_table[64] =
+{
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63,
 };
 
 static int
@@ -452,18 +456,39 @@ jpeg_read_headers(struct jpeg *jpeg)
 static int
 huffman_decode(struct jpeg *jpeg, struct huffman *huff)
 {
+	struct bitstream *bs = &jpeg->bs;
+	/*
+	 * a failed refill keeps the bytes it got: the bit by bit path below
+	 * reports the error once they are consumed
+	 */
+	if (bs->len < HUFF_LOOKAHEAD && !jpeg->eof)
+		bs->get(bs);
+	if (bs->len >= HUFF_LOOKAHEAD)
+	{
+		size_t peek = bs->buf >> (bs->len - HUFF_LOOKAHEAD);
+		uint16_t entry = huff->lookahead[peek & ((1 << HUFF_LOOKAHEAD) - 1)];
+		if (entry)
+		{
+			bs->len -= entry >> 8;
+			return entry & 0xFF;
+		}
+	}
 	uint16_t value = 0;
 	size_t i = 0;
 	while (1)
 	{
-		int ret = bs_getbit(&jpeg->bs);
+		int ret = bs_getbit(bs);
 		if (ret < 0)
 			return ret;
 		value |= ret;
 		if (value < huff->maxcodes[i])
 			break;
 		value <<= 1;
-		i++;
+		if (++i == MAX_BITS)
+		{
+			JPEG_ERR(jpeg, "invalid huffman code");
+			return -1;
+		}
 	}
 	if (value < huff->codes[i])
 	{
@@ -474,84 +499,79 @@ huffman_decode(struct jpeg *jpeg, struct huffman *huff)
 }
 
 static int
-decode_component(struct jpeg *jpeg, size_t component, int32_t *values)
+decode_coefficient(struct jpeg *jpeg, int code, int32_t *value)
+{
+	uint32_t v = bs_getbits(&jpeg->bs, code);
+	switch (v)
+	{
+		case (uint32_t)-1:
+			JPEG_ERR(jpeg, "read failed");
+			return 1;
+		case (uint32_t)-2:
+			JPEG_ERR(jpeg, "unexpected eof");
+			return 1;
+	}
+	if (v & (1 << (code - 1)))
+		*value = v;
+	else
+		*value = v - (1 << code) + 1;
+	return 0;
+}
+
+/*
+ * coefficients are dequantified and stored at their natural position as
+ * they are decoded, the zero runs are left from the initial clear;
+ * has_ac is cleared when only the DC coefficient can be non-zero
+ */
+static int
+decode_component(struct jpeg *jpeg,
+                 size_t component,
+                 int32_t *values,
+                 int *has_ac)
 {
 	struct huffman *dct = &jpeg->huff_tables[jpeg->components[component].dc_huff].huffman;
 	struct huffman *act = &jpeg->huff_tables[jpeg->components[component].ac_huff].huffman;
-	struct huffman *huffman = dct;
-	size_t n = 0;
+	const int32_t *qt = &jpeg->dqt[jpeg->components[component].table][0];
+	memset(values, 0, sizeof(*values) * 64);
+	int code = huffman_decode(jpeg, dct);
+	if (code == -1)
+		return 1;
+	int32_t dc = 0;
+	if (code && decode_coefficient(jpeg, code, &dc))
+		return 1;
+	dc += jpeg->components[component].prev_dc;
+	jpeg->components[component].prev_dc = dc;
+	values[0] = dc * qt[0];
+	*has_ac = 0;
+	size_t n = 1;
 	while (n < 64)
 	{
-		int code = huffman_decode(jpeg, huffman);
+		code = huffman_decode(jpeg, act);
 		if (code == -1)
 			return 1;
-		huffman = act;
-		if (n)
-		{
-			uint8_t nzero;
-			if (!code)
-				nzero = 64 - n - 1;
-			else
-				nzero = (code & 0xF0) >> 4;
-			if (nzero)
-			{
-				if (!n)
-				{
-					JPEG_ERR(jpeg, "rle on dct");
-					return 1;
-				}
-				if (n + nzero >= 64)
-				{
-					JPEG_ERR(jpeg, "rle overflow %d + %d", (int)n, (int)nzero);
-					return 1;
-				}
-				for (size_t i = 0; i < nzero; ++i)
-					values[n++] = 0;
-			}
-			code &= 0xF;
-		}
 		if (!code)
+			break;
+		uint8_t nzero = (code & 0xF0) >> 4;
+		if (n + nzero >= 64)
 		{
-			values[n++] = 0;
-			continue;
+			JPEG_ERR(jpeg, "rle overflow %d + %d", (int)n, (int)nzero);
+			return 1;
 		}
-		uint32_t v = bs_getbits(&jpeg->bs, code);
-		switch (v)
+		n += nzero;
+		code &= 0xF;
+		if (code)
 		{
-			case (uint32_t)-1:
-				JPEG_ERR(jpeg, "read failed");
-				return 1;
-			case (uint32_t)-2:
-				JPEG_ERR(jpeg, "unexpected eof");
+			int32_t v;
+			if (decode_coefficient(jpeg, code, &v))
 				return 1;
+			values[zigzag_table[n]] = v * qt[n];
+			*has_ac = 1;
 		}
-		if (v & (1 << (code - 1)))
-			values[n] = v;
-		else
-			values[n] = v - (1 << code) + 1;
 		n++;
 	}
 	return 0;
 }
 
-static void
-dequantify(struct jpeg *jpeg,
-           size_t component,
-           int32_t * restrict dst,
-           int32_t * restrict src)
-{
-	int32_t *qt = &jpeg->dqt[jpeg->components[component].table][0];
-	for (size_t i = 0; i < 64; ++i)
-		dst[i] = src[i] * qt[i];
-}
-
-static void
-dezigzag(int32_t * restrict dst, int32_t * restrict src)
-{
-	for (size_t i = 0; i < 64; ++i)
-		dst[i] = src[inv_zigzag_table[i]];
-}
-
 static void
 idct1(int32_t * restrict dst, const int32_t * restrict src)
 {
@@ -651,29 +671,248 @@ idct2(int32_t * restrict dst, const int32_t * restrict src)
 	}
 }
 
+/*
+ * with only the DC coefficient set, every column pass input but the first
+ * is zero and the block is constant: the two passes reduce to their v0 and
+ * t0 / t7 terms
+ */
+static int32_t
+idct_dc(int32_t dc)
+{
+	int32_t v = JPEG_RSHIFT(dc * (int32_t)(8192 / 0.353553), 4);
+	v = JPEG_RSHIFT(v, 1);
+	v = JPEG_RSHIFT(v, 1);
+	v = JPEG_RSHIFT(v, 1);
+	v = JPEG_RSHIFT(v * (int32_t)(2048 / 0.353553), 11);
+	v = JPEG_RSHIFT(v, 1);
+	v = JPEG_RSHIFT(v, 1);
+	return JPEG_RSHIFT(v, 10);
+}
+
+#ifdef __SSE2__
+#define RSHIFT_EPI32(v, n) _mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(1 << ((n) - 1))), n)
+
+/* sse2 has no pmulld: the low halves of the two pmuludq are interleaved */
+static inline __m128i
+mullo_epi32(__m128i a, int32_t b)
+{
+	__m128i m = _mm_set1_epi32(b);
+	__m128i even = _mm_mul_epu32(a, m);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+	even = _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0));
+	odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0));
+	return _mm_unpacklo_epi32(even, odd);
+}
+
+static inline void
+transpose_epi32(__m128i *a, __m128i *b, __m128i *c, __m128i *d)
+{
+	__m128i t0 = _mm_unpacklo_epi32(*a, *b);
+	__m128i t1 = _mm_unpacklo_epi32(*c, *d);
+	__m128i t2 = _mm_unpackhi_epi32(*a, *b);
+	__m128i t3 = _mm_unpackhi_epi32(*c, *d);
+	*a = _mm_unpacklo_epi64(t0, t1);
+	*b = _mm_unpackhi_epi64(t0, t1);
+	*c = _mm_unpacklo_epi64(t2, t3);
+	*d = _mm_unpackhi_epi64(t2, t3);
+}
+
+/*
+ * one idct1 / idct2 pass on four columns at once, v[n] holding the n-th
+ * coefficient of each column: the arithmetic is the scalar one, lane-wise
+ */
+static inline void
+idct_pass_sse2(__m128i *v, const int32_t *mul, int in_shift, int out_shift)
+{
+	__m128i v0 = RSHIFT_EPI32(mullo_epi32(v[0], mul[0]), in_shift);
+	__m128i v1 = RSHIFT_EPI32(mullo_epi32(v[1], mul[1]), in_shift);
+	__m128i v2 = RSHIFT_EPI32(mullo_epi32(v[2], mul[2]), in_shift);
+	__m128i v3 = RSHIFT_EPI32(mullo_epi32(v[3], mul[3]), in_shift);
+	__m128i v4 = RSHIFT_EPI32(mullo_epi32(v[4], mul[4]), in_shift);
+	__m128i v5 = RSHIFT_EPI32(mullo_epi32(v[5], mul[5]), in_shift);
+	__m128i v6 = RSHIFT_EPI32(mullo_epi32(v[6], mul[6]), in_shift);
+	__m128i v7 = RSHIFT_EPI32(mullo_epi32(v[7], mul[7]), in_shift);
+
+	__m128i z0 = RSHIFT_EPI32(_mm_sub_epi32(v5, v3), 1);
+	__m128i z1 = RSHIFT_EPI32(_mm_sub_epi32(v1, v7), 1);
+	__m128i z2 = RSHIFT_EPI32(_mm_add_epi32(v1, v7), 1);
+	__m128i z3 = RSHIFT_EPI32(_mm_add_epi32(v5, v3), 1);
+	__m128i z4 = RSHIFT_EPI32(_mm_add_epi32(z2, z3), 1);
+	__m128i z5 = RSHIFT_EPI32(_mm_add_epi32(v2, v6), 1);
+	__m128i z6 = RSHIFT_EPI32(_mm_sub_epi32(z2, z3), 1);
+	__m128i z7 = RSHIFT_EPI32(_mm_sub_epi32(v2, v6), 1);
+
+	__m128i t0 = RSHIFT_EPI32(_mm_add_epi32(v0, v4), 1);
+	__m128i t1 = RSHIFT_EPI32(_mm_sub_epi32(v0, v4), 1);
+
+	__m128i t2 = RSHIFT_EPI32(mullo_epi32(_mm_sub_epi32(z0, z1), (int32_t)(0.382683 * 2048)), 11);
+	__m128i t3 = RSHIFT_EPI32(mullo_epi32(z1, (int32_t)(0.541196 * 2048)), 11);
+	t3 = _mm_sub_epi32(_mm_sub_epi32(t3, z4), t2);
+	__m128i t4 = RSHIFT_EPI32(mullo_epi32(z6, (int32_t)(1.414215 * 2048)), 11);
+	t4 = _mm_sub_epi32(t4, t3);
+	__m128i t5 = RSHIFT_EPI32(mullo_epi32(z0, (int32_t)(1.306562 * 2048)), 11);
+	t5 = _mm_sub_epi32(_mm_sub_epi32(t5, t2), t4);
+	__m128i t6 = RSHIFT_EPI32(mullo_epi32(z7, (int32_t)(1.414215 * 2048)), 11);
+	t6 = _mm_sub_epi32(t6, z5);
+
+	__m128i t7  = RSHIFT_EPI32(_mm_add_epi32(t0, z5), 1);
+	__m128i t8  = RSHIFT_EPI32(_mm_add_epi32(t1, t6), 1);
+	__m128i t9  = RSHIFT_EPI32(_mm_sub_epi32(t1, t6), 1);
+	__m128i t10 = RSHIFT_EPI32(_mm_sub_epi32(t0, z5), 1);
+
+	v[0] = RSHIFT_EPI32(_mm_add_epi32(t7,  z4), out_shift);
+	v[1] = RSHIFT_EPI32(_mm_add_epi32(t8,  t3), out_shift);
+	v[2] = RSHIFT_EPI32(_mm_add_epi32(t9,  t4), out_shift);
+	v[3] = RSHIFT_EPI32(_mm_add_epi32(t10, t5), out_shift);
+	v[4] = RSHIFT_EPI32(_mm_sub_epi32(t10, t5), out_shift);
+	v[5] = RSHIFT_EPI32(_mm_sub_epi32(t9,  t4), out_shift);
+	v[6] = RSHIFT_EPI32(_mm_sub_epi32(t8,  t3), out_shift);
+	v[7] = RSHIFT_EPI32(_mm_sub_epi32(t7,  z4), out_shift);
+}
+
+/*
+ * the columns pass runs on the two halves of the block, which are then
+ * transposed by 4x4 quarters so that the rows pass is a columns pass too
+ */
+static void
+idct_sse2(int32_t * restrict dst, const int32_t * restrict src)
+{
+	static const int32_t mul1[8] =
+	{
+		(int32_t)(8192 / 0.353553),
+		(int32_t)(8192 / 0.254897),
+		(int32_t)(8192 / 0.270598),
+		(int32_t)(8192 / 0.300672),
+		(int32_t)(8192 / 0.353553),
+		(int32_t)(8192 / 0.449988),
+		(int32_t)(8192 / 0.653281),
+		(int32_t)(8192 / 1.281457),
+	};
+	static const int32_t mul2[8] =
+	{
+		(int32_t)(2048 / 0.353553),
+		(int32_t)(2048 / 0.254897),
+		(int32_t)(2048 / 0.270598),
+		(int32_t)(2048 / 0.300672),
+		(int32_t)(2048 / 0.353553),
+		(int32_t)(2048 / 0.449988),
+		(int32_t)(2048 / 0.653281),
+		(int32_t)(2048 / 1.281457),
+	};
+	__m128i l[8];
+	__m128i r[8];
+	for (size_t i = 0; i < 8; ++i)
+	{
+		l[i] = _mm_loadu_si128((const __m128i*)&src[i * 8]);
+		r[i] = _mm_loadu_si128((const __m128i*)&src[i * 8 + 4]);
+	}
+	idct_pass_sse2(l, mul1, 4, 1);
+	idct_pass_sse2(r, mul1, 4, 1);
+	transpose_epi32(&l[0], &l[1], &l[2], &l[3]);
+	transpose_epi32(&l[4], &l[5], &l[6], &l[7]);
+	transpose_epi32(&r[0], &r[1], &r[2], &r[3]);
+	transpose_epi32(&r[4], &r[5], &r[6], &r[7]);
+	__m128i top[8] = {l[0], l[1], l[2], l[3], r[0], r[1], r[2], r[3]};
+	__m128i bot[8] = {l[4], l[5], l[6], l[7], r[4], r[5], r[6], r[7]};
+	idct_pass_sse2(top, mul2, 11, 10);
+	idct_pass_sse2(bot, mul2, 11, 10);
+	transpose_epi32(&top[0], &top[1], &top[2], &top[3]);
+	transpose_epi32(&top[4], &top[5], &top[6], &top[7]);
+	transpose_epi32(&bot[0], &bot[1], &bot[2], &bot[3]);
+	transpose_epi32(&bot[4], &bot[5], &bot[6], &bot[7]);
+	for (size_t i = 0; i < 4; ++i)
+	{
+		_mm_storeu_si128((__m128i*)&dst[i * 8], top[i]);
+		_mm_storeu_si128((__m128i*)&dst[i * 8 + 4], top[i + 4]);
+		_mm_storeu_si128((__m128i*)&dst[32 + i * 8], bot[i]);
+		_mm_storeu_si128((__m128i*)&dst[32 + i * 8 + 4], bot[i + 4]);
+	}
+}
+#endif
+
 static void
-idct(int32_t * restrict dst, const int32_t * restrict src)
+idct(int32_t * restrict dst, const int32_t * restrict src, int has_ac)
 {
+	if (!has_ac)
+	{
+		int32_t v = idct_dc(src[0]);
+		for (size_t i = 0; i < 64; ++i)
+			dst[i] = v;
+		return;
+	}
+#ifdef __SSE2__
+	idct_sse2(dst, src);
+#else
 	int32_t tmp[64];
 	idct1(tmp, src);
 	idct2(dst, tmp);
+#endif
 }
 
 static int
 decode_block_component(struct jpeg *jpeg, int32_t *values, size_t component)
 {
-	int32_t tmp1[64];
-	int32_t tmp2[64];
-	if (decode_component(jpeg, component, &tmp1[0]))
+	int32_t coefs[64];
+	int has_ac;
+	if (decode_component(jpeg, component, &coefs[0], &has_ac))
 		return 1;
-	tmp1[0] += jpeg->components[component].prev_dc;
-	jpeg->components[component].prev_dc = tmp1[0];
-	dequantify(jpeg, component, &tmp2[0], &tmp1[0]);
-	dezigzag(&tmp1[0], &tmp2[0]);
-	idct(values, &tmp1[0]);
+	idct(values, &coefs[0], has_ac);
 	return 0;
 }
 
+/*
+ * writes each sample of the block 1 << shift times along x: this is the
+ * horizontal chroma upsampling, done in a single pass
+ */
+static void
+upsample_block(int32_t *dst, const int32_t *src, size_t dst_pitch, size_t shift)
+{
+	for (size_t y = 0; y < 8; ++y)
+	{
+		for (size_t x = 0; x < 8; ++x)
+		{
+			for (size_t i = 0; i < (1u << shift); ++i)
+				dst[(x << shift) + i] = src[x];
+		}
+		dst += dst_pitch;
+		src += 8;
+	}
+}
+
+#ifdef __SSE2__
+static void
+upsample_block_sse2(int32_t *dst,
+                    const int32_t *src,
+                    size_t dst_pitch,
+                    size_t shift)
+{
+	for (size_t y = 0; y < 8; ++y)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)&src[0]);
+		__m128i b = _mm_loadu_si128((const __m128i*)&src[4]);
+		if (shift == 1)
+		{
+			_mm_storeu_si128((__m128i*)&dst[0], _mm_unpacklo_epi32(a, a));
+			_mm_storeu_si128((__m128i*)&dst[4], _mm_unpackhi_epi32(a, a));
+			_mm_storeu_si128((__m128i*)&dst[8], _mm_unpacklo_epi32(b, b));
+			_mm_storeu_si128((__m128i*)&dst[12], _mm_unpackhi_epi32(b, b));
+		}
+		else
+		{
+			_mm_storeu_si128((__m128i*)&dst[0], _mm_shuffle_epi32(a, 0x00));
+			_mm_storeu_si128((__m128i*)&dst[4], _mm_shuffle_epi32(a, 0x55));
+			_mm_storeu_si128((__m128i*)&dst[8], _mm_shuffle_epi32(a, 0xAA));
+			_mm_storeu_si128((__m128i*)&dst[12], _mm_shuffle_epi32(a, 0xFF));
+			_mm_storeu_si128((__m128i*)&dst[16], _mm_shuffle_epi32(b, 0x00));
+			_mm_storeu_si128((__m128i*)&dst[20], _mm_shuffle_epi32(b, 0x55));
+			_mm_storeu_si128((__m128i*)&dst[24], _mm_shuffle_epi32(b, 0xAA));
+			_mm_storeu_si128((__m128i*)&dst[28], _mm_shuffle_epi32(b, 0xFF));
+		}
+		dst += dst_pitch;
+		src += 8;
+	}
+}
+#endif
 static void
 copy_block(int32_t *dst, int32_t *src, size_t dst_pitch, size_t src_shift)
 {
@@ -713,6 +952,20 @@ apply_block_component(struct jpeg *jpeg,
 			break;
 	}
 	size_t dst_pitch = jpeg->component_width * scale_y;
+	if (scale_x == (1u << src_shift))
+	{
+		for (size_t y = 0; y < scale_y; ++y)
+		{
+#ifdef __SSE2__
+			if (src_shift)
+				upsample_block_sse2(dst, values, dst_pitch, src_shift);
+			else
+#endif
+				upsample_block(dst, values, dst_pitch, src_shift);
+			dst += jpeg->component_width;
+		}
+		return;
+	}
 	for (size_t y = 0; y < scale_y; ++y)
 	{
 		int32_t *dst_row = dst;
@@ -764,6 +1017,139 @@ decode_block(struct jpeg *jpeg)
 	return 0;
 }
 
+static void
+merge_gray_row(uint8_t *dst, const int32_t *Y_data, size_t width)
+{
+	for (size_t x = 0; x < width; ++x)
+	{
+		int32_t Y = Y_data[x];
+		int32_t c = 128 + Y;
+		if (c < 0)
+			c = 0;
+		else if (c > 255)
+			c = 255;
+		dst[x] = c;
+	}
+}
+
+static void
+merge_rgb_row(uint8_t *dst,
+              const int32_t *Y_row,
+              const int32_t *Cb_row,
+              const int32_t *Cr_row,
+              size_t width)
+{
+	for (size_t x = 0; x < width; ++x)
+	{
+		int32_t Y = Y_row[x];
+		int32_t Cb = Cb_row[x];
+		int32_t Cr = Cr_row[x];
+		int32_t r = (128 + Y) * 65536;
+		int32_t g = r;
+		int32_t b = r;
+		r += Cr * (int32_t)(1.402   * 65536);
+		g -= Cr * (int32_t)(0.71414 * 65536);
+		b += Cb * (int32_t)(1.772   * 65536);
+		g -= Cb * (int32_t)(0.34414 * 65536);
+		r = JPEG_RSHIFT(r, 16);
+		g = JPEG_RSHIFT(g, 16);
+		b = JPEG_RSHIFT(b, 16);
+		if (r < 0)
+			r = 0;
+		else if (r > 255)
+			r = 255;
+		if (g < 0)
+			g = 0;
+		else if (g > 255)
+			g = 255;
+		if (b < 0)
+			b = 0;
+		else if (b > 255)
+			b = 255;
+		dst[0] = r;
+		dst[1] = g;
+		dst[2] = b;
+		dst += 3;
+	}
+}
+
+#ifdef __SSE2__
+/*
+ * the clamp to [0, 255] is the signed saturation to 16 bits followed by
+ * the unsigned saturation to 8 bits
+ */
+static size_t
+merge_gray_row_sse2(uint8_t *dst, const int32_t *Y_data, size_t width)
+{
+	const __m128i bias = _mm_set1_epi32(128);
+	size_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i y0 = _mm_loadu_si128((const __m128i*)&Y_data[x + 0]);
+		__m128i y1 = _mm_loadu_si128((const __m128i*)&Y_data[x + 4]);
+		__m128i y2 = _mm_loadu_si128((const __m128i*)&Y_data[x + 8]);
+		__m128i y3 = _mm_loadu_si128((const __m128i*)&Y_data[x + 12]);
+		__m128i lo = _mm_packs_epi32(_mm_add_epi32(y0, bias),
+		                             _mm_add_epi32(y1, bias));
+		__m128i hi = _mm_packs_epi32(_mm_add_epi32(y2, bias),
+		                             _mm_add_epi32(y3, bias));
+		_mm_storeu_si128((__m128i*)&dst[x], _mm_packus_epi16(lo, hi));
+	}
+	return x;
+}
+
+/*
+ * eight pixels per iteration: the channels are computed and clamped as
+ * vectors, then interleaved through a small buffer
+ */
+static size_t
+merge_rgb_row_sse2(uint8_t *dst,
+                   const int32_t *Y_row,
+                   const int32_t *Cb_row,
+                   const int32_t *Cr_row,
+                   size_t width)
+{
+	const __m128i bias = _mm_set1_epi32(128);
+	size_t x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i r16[2];
+		__m128i g16[2];
+		__m128i b16[2];
+		for (size_t i = 0; i < 2; ++i)
+		{
+			__m128i Y = _mm_loadu_si128((const __m128i*)&Y_row[x + i * 4]);
+			__m128i Cb = _mm_loadu_si128((const __m128i*)&Cb_row[x + i * 4]);
+			__m128i Cr = _mm_loadu_si128((const __m128i*)&Cr_row[x + i * 4]);
+			__m128i base = _mm_slli_epi32(_mm_add_epi32(Y, bias), 16);
+			__m128i r = _mm_add_epi32(base, mullo_epi32(Cr, (int32_t)(1.402 * 65536)));
+			__m128i g = _mm_sub_epi32(base, mullo_epi32(Cr, (int32_t)(0.71414 * 65536)));
+			__m128i b = _mm_add_epi32(base, mullo_epi32(Cb, (int32_t)(1.772 * 65536)));
+			g = _mm_sub_epi32(g, mullo_epi32(Cb, (int32_t)(0.34414 * 65536)));
+			r16[i] = RSHIFT_EPI32(r, 16);
+			g16[i] = RSHIFT_EPI32(g, 16);
+			b16[i] = RSHIFT_EPI32(b, 16);
+		}
+		__m128i rg = _mm_packus_epi16(_mm_packs_epi32(r16[0], r16[1]),
+		                              _mm_packs_epi32(g16[0], g16[1]));
+		__m128i bb = _mm_packus_epi16(_mm_packs_epi32(b16[0], b16[1]),
+		                              _mm_setzero_si128());
+		uint8_t tmp[32];
+		_mm_storeu_si128((__m128i*)&tmp[0], rg);
+		_mm_storeu_si128((__m128i*)&tmp[16], bb);
+		uint8_t *out = &dst[x * 3];
+		for (size_t i = 0; i < 8; ++i)
+		{
+			out[0] = tmp[i];
+			out[1] = tmp[i + 8];
+			out[2] = tmp[i + 16];
+			out += 3;
+		}
+	}
+	return x;
+}
+#endif
+
 static void
 merge_gray(struct jpeg *jpeg, uint8_t *data)
 {
@@ -771,17 +1157,11 @@ merge_gray(struct jpeg *jpeg, uint8_t *data)
 	{
 		const int32_t *Y_data = &jpeg->components[0].data[y * jpeg->component_width];
 		uint8_t *row = &data[y * jpeg->width];
-		for (size_t x = 0; x < jpeg->width; ++x)
-		{
-			uint8_t *dst = &row[x];
-			int32_t Y = Y_data[x];
-			int32_t c = 128 + Y;
-			if (c < 0)
-				c = 0;
-			else if (c > 255)
-				c = 255;
-			dst[0] = c;
-		}
+		size_t x = 0;
+#ifdef __SSE2__
+		x = merge_gray_row_sse2(row, Y_data, jpeg->width);
+#endif
+		merge_gray_row(&row[x], &Y_data[x], jpeg->width - x);
 	}
 }
 
@@ -794,38 +1174,12 @@ merge_rgb(struct jpeg *jpeg, uint8_t *data)
 	uint8_t *row = data;
 	for (size_t y = 0; y < jpeg->height; ++y)
 	{
-		for (size_t x = 0; x < jpeg->width; ++x)
-		{
-			uint8_t *dst = &row[x * 3];
-			int32_t Y = Y_row[x];
-			int32_t Cb = Cb_row[x];
-			int32_t Cr = Cr_row[x];
-			int32_t r = (128 + Y) * 65536;
-			int32_t g = r;
-			int32_t b = r;
-			r += Cr * (int32_t)(1.402   * 65536);
-			g -= Cr * (int32_t)(0.71414 * 65536);
-			b += Cb * (int32_t)(1.772   * 65536);
-			g -= Cb * (int32_t)(0.34414 * 65536);
-			r = JPEG_RSHIFT(r, 16);
-			g = JPEG_RSHIFT(g, 16);
-			b = JPEG_RSHIFT(b, 16);
-			if (r < 0)
-				r = 0;
-			else if (r > 255)
-				r = 255;
-			if (g < 0)
-				g = 0;
-			else if (g > 255)
-				g = 255;
-			if (b < 0)
-				b = 0;
-			else if (b > 255)
-				b = 255;
-			dst[0] = r;
-			dst[1] = g;
-			dst[2] = b;
-		}
+		size_t x = 0;
+#ifdef __SSE2__
+		x = merge_rgb_row_sse2(row, Y_row, Cb_row, Cr_row, jpeg->width);
+#endif
+		merge_rgb_row(&row[x * 3], &Y_row[x], &Cb_row[x], &Cr_row[x],
+		              jpeg->width - x);
 		Y_row += jpeg->component_width;
 		Cb_row += jpeg->component_width;
 		Cr_row += jpeg->component_width;
@@ -846,19 +1200,19 @@ jpeg_read_data(struct jpeg *jpeg, void *data)
 			return 1;
 		if (jpeg->block_y < jpeg->height)
 			continue;
-		if (jpeg->eof)
-			break;
-		uint8_t eoi_mark[2];
-		if (fread(eoi_mark, 1, 2, jpeg->fp) != 2)
-		{
-			JPEG_ERR(jpeg, "unexpected data EOF");
-			return 1;
-		}
-		if (eoi_mark[0] != 0xFF
-		 || eoi_mark[1] != JPEG_CHUNK_EOI)
+		/*
+		 * the refills stop at arbitrary points of the entropy coded
+		 * segment: skip what is left of it (padding bits, trailing
+		 * RST) up to the EOI
+		 */
+		while (!jpeg->eof)
 		{
-			JPEG_ERR(jpeg, "invalid EOI");
-			return 1;
+			jpeg->bs.len = 0;
+			if (jpeg->bs.get(&jpeg->bs))
+			{
+				JPEG_ERR(jpeg, "unexpected data EOF");
+				return 1;
+			}
 		}
 		break;
 	}
@@ -7,6 +7,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
 #define IS_CHUNK(t, a, b, c, d) \
    ((t)[0] == (a) \
  && (t)[1] == (b) \
@@ -230,6 +234,137 @@ paeth(png_byte a, png_byte b, png_byte c)
 	return c;
 }
 
+#ifdef __SSE2__
+/*
+ * the sse2 paths handle one pixel per vector for 3, 4, 6 and 8 bytes
+ * pixels (the left and corner dependencies are per pixel), and sixteen
+ * bytes per vector for the up filter; pixels are moved by 4 or 8 bytes,
+ * so they stop before the last pixel when bpp is 3 or 6 and return how
+ * far they got for the scalar loops to finish the row
+ */
+#define PIXEL_SIZE(bpp) ((bpp) <= 4 ? 4 : 8)
+
+static inline __m128i
+load_pixel(png_const_bytep p, png_size_t bpp)
+{
+	if (bpp <= 4)
+		return _mm_loadu_si32(p);
+	return _mm_loadl_epi64((const __m128i*)p);
+}
+
+static inline void
+store_pixel(png_bytep p, __m128i v, png_size_t bpp)
+{
+	if (bpp <= 4)
+		_mm_storeu_si32(p, v);
+	else
+		_mm_storel_epi64((__m128i*)p, v);
+}
+
+static png_size_t
+defilter_left_sse2(png_bytep dst,
+                   png_const_bytep src,
+                   png_size_t bpp,
+                   png_size_t pitch)
+{
+	__m128i left = _mm_setzero_si128();
+	png_size_t n = 0;
+	for (; n + PIXEL_SIZE(bpp) <= pitch; n += bpp)
+	{
+		left = _mm_add_epi8(load_pixel(&src[n], bpp), left);
+		store_pixel(&dst[n], left, bpp);
+	}
+	return n;
+}
+
+static png_size_t
+defilter_up_sse2(png_bytep dst,
+                 png_const_bytep src,
+                 png_const_bytep prv,
+                 png_size_t pitch)
+{
+	png_size_t n = 0;
+	for (; n + 16 <= pitch; n += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)&src[n]);
+		__m128i b = _mm_loadu_si128((const __m128i*)&prv[n]);
+		_mm_storeu_si128((__m128i*)&dst[n], _mm_add_epi8(a, b));
+	}
+	return n;
+}
+
+/*
+ * pavgb rounds up: the floor of the average is recovered by subtracting
+ * the low bit of a ^ b
+ */
+static png_size_t
+defilter_average_sse2(png_bytep dst,
+                      png_const_bytep src,
+                      png_const_bytep prv,
+                      png_size_t bpp,
+                      png_size_t pitch)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i left = _mm_setzero_si128();
+	png_size_t n = 0;
+	for (; n + PIXEL_SIZE(bpp) <= pitch; n += bpp)
+	{
+		__m128i up = load_pixel(&prv[n], bpp);
+		__m128i avg = _mm_avg_epu8(left, up);
+		avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(left, up), one));
+		left = _mm_add_epi8(load_pixel(&src[n], bpp), avg);
+		store_pixel(&dst[n], left, bpp);
+	}
+	return n;
+}
+
+/*
+ * the predictor is computed on 16 bits lanes: pa = |b - c|, pb = |a - c|
+ * and pc = |(b - c) + (a - c)|, with the ties broken as in paeth()
+ */
+static png_size_t
+defilter_paeth_sse2(png_bytep dst,
+                    png_const_bytep src,
+                    png_const_bytep prv,
+                    png_size_t bpp,
+                    png_size_t pitch)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero;
+	__m128i c = zero;
+	png_size_t n = 0;
+	for (; n + PIXEL_SIZE(bpp) <= pitch; n += bpp)
+	{
+		__m128i b = _mm_unpacklo_epi8(load_pixel(&prv[n], bpp), zero);
+		__m128i pa = _mm_sub_epi16(b, c);
+		__m128i pb = _mm_sub_epi16(a, c);
+		__m128i pc = _mm_add_epi16(pa, pb);
+		pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+		pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+		pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+		__m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb),
+		                             _mm_cmpgt_epi16(pa, pc));
+		__m128i is_c = _mm_and_si128(not_a, _mm_cmpgt_epi16(pb, pc));
+		__m128i is_b = _mm_andnot_si128(is_c, not_a);
+		__m128i pred = _mm_andnot_si128(not_a, a);
+		pred = _mm_or_si128(pred, _mm_and_si128(is_b, b));
+		pred = _mm_or_si128(pred, _mm_and_si128(is_c, c));
+		__m128i out = _mm_add_epi8(load_pixel(&src[n], bpp),
+		                           _mm_packus_epi16(pred, pred));
+		store_pixel(&dst[n], out, bpp);
+		a = _mm_unpacklo_epi8(out, zero);
+		c = b;
+	}
+	return n;
+}
+
+static int
+defilter_sse2(png_size_t bpp)
+{
+	return bpp == 3 || bpp == 4 || bpp == 6 || bpp == 8;
+}
+#endif
+
 static void
 defilter_left(png_bytep dst,
               png_const_bytep src,
@@ -237,6 +372,10 @@ defilter_left(png_bytep dst,
               png_size_t pitch)
 {
 	png_size_t n = 0;
+#ifdef __SSE2__
+	if (defilter_sse2(bpp))
+		n = defilter_left_sse2(dst, src, bpp, pitch);
+#endif
 	while (n < bpp)
 	{
 		dst[n] = src[n];
@@ -263,6 +402,9 @@ defilter_up(png_bytep dst,
 		return;
 	}
 	png_size_t n = 0;
+#ifdef __SSE2__
+	n = defilter_up_sse2(dst, src, prv, pitch);
+#endif
 	while (n < pitch)
 	{
 		dst[n] = src[n] + prv[n];
@@ -280,6 +422,10 @@ defilter_average(png_bytep dst,
 {
 	png_size_t n = 0;
 	png_const_bytep left = dst - bpp;
+#ifdef __SSE2__
+	if (y && defilter_sse2(bpp))
+		n = defilter_average_sse2(dst, src, prv, bpp, pitch);
+#endif
 	if (!y)
 	{
 		while (n < bpp)
@@ -317,6 +463,12 @@ defilter_paeth(png_bytep dst,
 	png_size_t n = 0;
 	png_const_bytep left = dst - bpp;
 	png_const_bytep corner = prv - bpp;
+#ifdef __SSE2__
+	/* without a previous row, the predictor is the left pixel */
+	if (defilter_sse2(bpp))
+		n = y ? defilter_paeth_sse2(dst, src, prv, bpp, pitch)
+		      : defilter_left_sse2(dst, src, bpp, pitch);
+#endif
 	if (!y)
 	{
 		while (n < bpp)
@@ -96,6 +96,7 @@ uint32_t adler32_z(uint32_t adler, const uint8_t *buf, size_t len);
 
 uint32_t crc32(uint32_t crc, const uint8_t *buf, unsigned len);
 uint32_t crc32_z(uint32_t crc, const uint8_t *buf, size_t len);
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
 
 #ifdef __cplusplus
 }
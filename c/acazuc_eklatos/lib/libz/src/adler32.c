@@ -1,33 +1,179 @@
+#include "cpu.h"
+
 #include <zlib.h>
 
-uint32_t
-adler32(uint32_t adler, const uint8_t *buf, unsigned len)
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define BASE 65521
+
+/*
+ * largest n such that 255 * n * (n + 1) / 2 + (n + 1) * (BASE - 1) fits in
+ * 32 bits: the sums can run that many bytes before being reduced
+ */
+#define NMAX 5552
+
+static uint32_t
+adler32_scalar(uint32_t s1, uint32_t s2, const uint8_t *buf, size_t len)
 {
-	/* XXX can certainly be faster... */
-	if (!buf)
-		return 1;
-	uint32_t s1 = (adler >> 0) & 0xFFFF;
-	uint32_t s2 = (adler >> 16) & 0xFFFF;
-	for (unsigned i = 0; i < len; ++i)
+	while (len)
 	{
-		s1 = (s1 + buf[i]) % 65521;
-		s2 = (s2 + s1) % 65521;
+		size_t n = len < NMAX ? len : NMAX;
+		len -= n;
+		for (; n >= 8; n -= 8)
+		{
+			s1 += buf[0];
+			s2 += s1;
+			s1 += buf[1];
+			s2 += s1;
+			s1 += buf[2];
+			s2 += s1;
+			s1 += buf[3];
+			s2 += s1;
+			s1 += buf[4];
+			s2 += s1;
+			s1 += buf[5];
+			s2 += s1;
+			s1 += buf[6];
+			s2 += s1;
+			s1 += buf[7];
+			s2 += s1;
+			buf += 8;
+		}
+		for (; n; --n)
+		{
+			s1 += *buf++;
+			s2 += s1;
+		}
+		s1 %= BASE;
+		s2 %= BASE;
 	}
 	return (s2 << 16) | s1;
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+/*
+ * the vector loops handle 32 bytes blocks: s1 gains the sum of the bytes
+ * (psadbw), s2 gains 32 times the s1 of the block start plus the bytes
+ * weighted 32 down to 1 (pmaddubsw), and the block start s1 are summed
+ * in ps so that the multiplication by 32 is done once per chunk
+ */
+#define BLOCK 32
+
+__attribute__((target("sse2")))
+static inline uint32_t
+hsum_epi32(__m128i v)
+{
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+static inline void
+adler32_reduce(uint32_t *s1, uint32_t *s2, size_t n, uint32_t v_s1,
+               uint32_t v_s2, uint32_t v_ps)
+{
+	uint64_t sum2 = *s2 + (uint64_t)*s1 * n * BLOCK
+	              + (uint64_t)v_ps * BLOCK + v_s2;
+	*s1 = (*s1 + v_s1) % BASE;
+	*s2 = sum2 % BASE;
+}
+
+__attribute__((target("ssse3")))
+static uint32_t
+adler32_ssse3(uint32_t s1, uint32_t s2, const uint8_t *buf, size_t len)
+{
+	const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+	                                   24, 23, 22, 21, 20, 19, 18, 17);
+	const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+	                                   8, 7, 6, 5, 4, 3, 2, 1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t blocks = len / BLOCK;
+	while (blocks)
+	{
+		size_t n = blocks < NMAX / BLOCK ? blocks : NMAX / BLOCK;
+		__m128i v_s1 = zero;
+		__m128i v_s2 = zero;
+		__m128i v_ps = zero;
+		blocks -= n;
+		for (size_t i = 0; i < n; ++i)
+		{
+			__m128i b1 = _mm_loadu_si128((const __m128i*)&buf[0]);
+			__m128i b2 = _mm_loadu_si128((const __m128i*)&buf[16]);
+			v_ps = _mm_add_epi32(v_ps, v_s1);
+			v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b1, zero));
+			v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b2, zero));
+			v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(b1, tap1), ones));
+			v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(b2, tap2), ones));
+			buf += BLOCK;
+		}
+		adler32_reduce(&s1, &s2, n, hsum_epi32(v_s1), hsum_epi32(v_s2),
+		               hsum_epi32(v_ps));
+	}
+	return adler32_scalar(s1, s2, buf, len % BLOCK);
+}
+
+__attribute__((target("avx2")))
+static uint32_t
+adler32_avx2(uint32_t s1, uint32_t s2, const uint8_t *buf, size_t len)
+{
+	const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+	                                     24, 23, 22, 21, 20, 19, 18, 17,
+	                                     16, 15, 14, 13, 12, 11, 10, 9,
+	                                     8, 7, 6, 5, 4, 3, 2, 1);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(1);
+	size_t blocks = len / BLOCK;
+	while (blocks)
+	{
+		size_t n = blocks < NMAX / BLOCK ? blocks : NMAX / BLOCK;
+		__m256i v_s1 = zero;
+		__m256i v_s2 = zero;
+		__m256i v_ps = zero;
+		blocks -= n;
+		for (size_t i = 0; i < n; ++i)
+		{
+			__m256i b = _mm256_loadu_si256((const __m256i*)buf);
+			v_ps = _mm256_add_epi32(v_ps, v_s1);
+			v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(b, zero));
+			v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(_mm256_maddubs_epi16(b, tap), ones));
+			buf += BLOCK;
+		}
+#define HSUM(v) hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v), \
+                                         _mm256_extracti128_si256(v, 1)))
+		adler32_reduce(&s1, &s2, n, HSUM(v_s1), HSUM(v_s2), HSUM(v_ps));
+#undef HSUM
+	}
+	return adler32_scalar(s1, s2, buf, len % BLOCK);
+}
+#endif
+
 uint32_t
 adler32_z(uint32_t adler, const uint8_t *buf, size_t len)
 {
-	/* XXX can certainly be faster... */
 	if (!buf)
-		return 1 << 16;
-	uint32_t s1 = (adler >> 0) & 0xFFFF;
-	uint32_t s2 = (adler >> 16) & 0xFFFF;
-	for (size_t i = 0; i < len; ++i)
+		return 1;
+	if (!len)
+		return adler;
+	uint32_t s1 = (adler & 0xFFFF) % BASE;
+	uint32_t s2 = (adler >> 16) % BASE;
+#if defined(__i386__) || defined(__x86_64__)
+	if (len >= 64)
 	{
-		s1 = (s1 + buf[i]) % 65521;
-		s2 = (s2 + s1) % 65521;
+		unsigned features = zlib_cpu_features();
+		if (features & CPU_AVX2)
+			return adler32_avx2(s1, s2, buf, len);
+		if (features & CPU_SSSE3)
+			return adler32_ssse3(s1, s2, buf, len);
 	}
-	return (s2 << 16) | s1;
+#endif
+	return adler32_scalar(s1, s2, buf, len);
+}
+
+uint32_t
+adler32(uint32_t adler, const uint8_t *buf, unsigned len)
+{
+	return adler32_z(adler, buf, len);
 }
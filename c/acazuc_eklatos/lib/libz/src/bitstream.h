@@ -52,9 +52,11 @@ static inline int bitstream_has_write(struct bitstream *bs, size_t bits)
 static inline void bitstream_peek(struct bitstream *bs, uint32_t *data,
                                   size_t bits)
 {
-	*data = 0;
-	for (size_t i = 0; i < bits; ++i)
-		*data |= bitstream_getbit(bs, i) << i;
+	uint64_t v = 0;
+	size_t bytes = (bs->pos + bits + 7) / 8;
+	for (size_t i = 0; i < bytes; ++i)
+		v |= (uint64_t)*(uint8_t*)ringbuf_read_ptr_at(bs->ringbuf, i) << (i * 8);
+	*data = (v >> bs->pos) & (((uint64_t)1 << bits) - 1);
 }
 
 static inline void bitstream_skip(struct bitstream *bs, size_t bits)
@@ -0,0 +1,52 @@
+#include "cpu.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+static unsigned features;
+
+static unsigned
+probe(void)
+{
+	unsigned ret = CPU_PROBED;
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned eax;
+	unsigned ebx;
+	unsigned ecx;
+	unsigned edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return ret;
+	if (ecx & bit_PCLMUL)
+		ret |= CPU_PCLMUL;
+	if (ecx & bit_SSSE3)
+		ret |= CPU_SSSE3;
+	if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX))
+	{
+		unsigned xcr0_lo;
+		unsigned xcr0_hi;
+		/* the kernel must be saving the ymm state */
+		__asm__ volatile ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+		if ((xcr0_lo & 0x6) == 0x6
+		 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+		 && (ebx & bit_AVX2))
+			ret |= CPU_AVX2;
+	}
+#endif
+	return ret;
+}
+
+/*
+ * there is no ifunc support in ld.so, so the features are probed on the
+ * first call and cached; concurrent probes store the same value
+ */
+unsigned
+zlib_cpu_features(void)
+{
+	unsigned ret = __atomic_load_n(&features, __ATOMIC_RELAXED);
+	if (ret)
+		return ret;
+	ret = probe();
+	__atomic_store_n(&features, ret, __ATOMIC_RELAXED);
+	return ret;
+}
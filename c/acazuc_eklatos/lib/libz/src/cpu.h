@@ -0,0 +1,19 @@
+#ifndef CPU_H
+#define CPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CPU_PROBED (1 << 0)
+#define CPU_PCLMUL (1 << 1)
+#define CPU_SSSE3  (1 << 2)
+#define CPU_AVX2   (1 << 3)
+
+unsigned zlib_cpu_features(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
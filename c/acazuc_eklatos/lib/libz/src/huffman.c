@@ -3,53 +3,141 @@
 
 #include <zlib.h>
 
-void
-huffman_generate(struct huffman *huff, uint8_t *sizes, uint32_t count)
+static uint32_t
+reverse_bits(uint32_t code, uint8_t len)
 {
-	huff->count = count;
-	for (size_t i = 0; i <= MAX_BITS; ++i)
-		huff->counts[i] = 0;
-	for (size_t i = 0; i < huff->count; ++i)
-		huff->counts[sizes[i]]++;
-	huff->counts[0] = 0;
-	uint32_t code = 0;
-	for (size_t i = 0; i <= MAX_BITS; ++i)
+	uint32_t ret = 0;
+	for (uint8_t i = 0; i < len; ++i)
 	{
-		huff->codes[i] = code;
-		code = (code + huff->counts[i]) << 1;
+		ret = (ret << 1) | (code & 1);
+		code >>= 1;
 	}
+	return ret;
+}
+
+/*
+ * the codes are canonical: walking the symbols sorted by length then by
+ * value gives increasing codes, so the long codes sharing the same root
+ * bits are contiguous and get their subtable when the first one is met
+ */
+int
+huffman_generate(struct huffman *huff, const uint8_t *sizes, uint32_t count,
+                 uint8_t root)
+{
+	uint16_t counts[MAX_BITS + 1];
 	uint16_t offsets[MAX_BITS + 1];
-	uint32_t offset = 0;
+	uint16_t sorted[288];
+	if (count > sizeof(sorted) / sizeof(*sorted))
+		return Z_DATA_ERROR;
+	for (size_t i = 0; i <= MAX_BITS; ++i)
+		counts[i] = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (sizes[i] > MAX_BITS)
+			return Z_DATA_ERROR;
+		counts[sizes[i]]++;
+	}
+	counts[0] = 0;
+	int32_t left = 1;
+	for (size_t i = 1; i <= MAX_BITS; ++i)
+	{
+		left = (left << 1) - counts[i];
+		if (left < 0)
+			return Z_DATA_ERROR; /* over-subscribed */
+	}
+	uint16_t offset = 0;
 	for (size_t i = 0; i <= MAX_BITS; ++i)
 	{
 		offsets[i] = offset;
-		offset += huff->counts[i];
+		offset += counts[i];
 	}
-	for (size_t i = 0; i < huff->count; ++i)
+	for (size_t i = 0; i < count; ++i)
 	{
 		if (sizes[i])
-			huff->values[offsets[sizes[i]]++] = i;
+			sorted[offsets[sizes[i]]++] = i;
 	}
+	huff->root = root;
+	for (size_t i = 0; i < (1U << root); ++i)
+	{
+		huff->table[i].value = 0;
+		huff->table[i].bits = 0;
+		huff->table[i].sub = 0;
+	}
+	size_t next = 1 << root;
+	uint32_t prefix = UINT32_MAX;
+	size_t subtable = 0;
+	uint32_t code = 0;
+	size_t n = 0;
+	for (uint8_t len = 1; len <= MAX_BITS; ++len)
+	{
+		for (size_t i = 0; i < counts[len]; ++i, ++code)
+		{
+			uint16_t symbol = sorted[n++];
+			uint32_t rev = reverse_bits(code, len);
+			if (len <= root)
+			{
+				for (uint32_t j = rev; j < (1U << root); j += 1 << len)
+				{
+					huff->table[j].value = symbol;
+					huff->table[j].bits = len;
+				}
+				continue;
+			}
+			uint32_t low = rev & ((1 << root) - 1);
+			if (low != prefix)
+			{
+				/*
+				 * grow the subtable until it holds all the
+				 * remaining codes of this prefix
+				 */
+				uint8_t sub = len - root;
+				int32_t avail = (1 << sub) - (counts[len] - i);
+				while (avail > 0 && root + sub < MAX_BITS)
+				{
+					sub++;
+					avail = (avail << 1) - counts[root + sub];
+				}
+				if (next + (1 << sub) > HUFFMAN_TABLE_SIZE)
+					return Z_DATA_ERROR;
+				for (size_t j = 0; j < (1U << sub); ++j)
+				{
+					huff->table[next + j].value = 0;
+					huff->table[next + j].bits = 0;
+					huff->table[next + j].sub = 0;
+				}
+				huff->table[low].value = next;
+				huff->table[low].bits = root;
+				huff->table[low].sub = sub;
+				prefix = low;
+				subtable = next;
+				next += 1 << sub;
+			}
+			uint8_t sub = huff->table[low].sub;
+			for (uint32_t j = rev >> root; j < (1U << sub); j += 1 << (len - root))
+			{
+				huff->table[subtable + j].value = symbol;
+				huff->table[subtable + j].bits = len - root;
+			}
+		}
+		code <<= 1;
+	}
+	return Z_OK;
 }
 
 int
 huffman_decode(struct bitstream *bs, struct huffman *huff)
 {
-	uint16_t value = 0;
-	uint32_t pos = 0;
-	for (size_t i = 1; i <= MAX_BITS; ++i)
-	{
-		if (!bitstream_has_read(bs, i))
-			return Z_NEED_MORE;
-		value = (value << 1) | bitstream_getbit(bs, i - 1);
-		uint32_t counts = huff->counts[i];
-		uint32_t base = huff->codes[i];
-		if (value >= base && value < base + counts)
-		{
-			bitstream_skip(bs, i);
-			return huff->values[pos + (value - base)];
-		}
-		pos += counts;
-	}
-	return Z_DATA_ERROR;
+	size_t avail = bitstream_avail_read(bs);
+	if (avail > MAX_BITS)
+		avail = MAX_BITS;
+	uint32_t bits;
+	bitstream_peek(bs, &bits, avail);
+	uint8_t len;
+	uint16_t value = huffman_lookup(huff, bits, &len);
+	if (!len)
+		return avail < MAX_BITS ? Z_NEED_MORE : Z_DATA_ERROR;
+	if (len > avail)
+		return Z_NEED_MORE;
+	bitstream_skip(bs, len);
+	return value;
 }
@@ -10,19 +10,64 @@ extern "C" {
 
 #define MAX_BITS 15
 
+/*
+ * root table bits of the literal / length, distance and code lengths
+ * tables; the longer codes go through a second level table
+ */
+#define HUFFMAN_LIT_BITS  9
+#define HUFFMAN_DIST_BITS 6
+#define HUFFMAN_CL_BITS   7
+
+/*
+ * worst case entries count of a root table plus its subtables, for 286
+ * codes with 9 root bits (the 288 of the static code fit in it)
+ */
+#define HUFFMAN_TABLE_SIZE 852
+
 struct bitstream;
 
+/*
+ * a code entry holds its symbol and length, a link entry holds the
+ * subtable offset in value, the root bits in bits and the subtable index
+ * bits in sub; an entry with no bits isn't a valid code
+ */
+struct huffman_entry
+{
+	uint16_t value;
+	uint8_t bits;
+	uint8_t sub;
+};
+
 struct huffman
 {
-	uint16_t counts[MAX_BITS + 1];
-	uint16_t codes[MAX_BITS + 1];
-	uint16_t values[288];
-	size_t count;
+	uint8_t root;
+	struct huffman_entry table[HUFFMAN_TABLE_SIZE];
 };
 
-void huffman_generate(struct huffman *huff, uint8_t *sizes, uint32_t count);
+int huffman_generate(struct huffman *huff, const uint8_t *sizes,
+                     uint32_t count, uint8_t root);
 int huffman_decode(struct bitstream *bs, struct huffman *huff);
 
+/*
+ * lookup the code at the start of the lsb-first bits, which must hold at
+ * least MAX_BITS bits (zero padded if needed), returns its length in *len
+ * or zero if there is no such code
+ */
+static inline uint16_t huffman_lookup(const struct huffman *huff,
+                                      uint32_t bits, uint8_t *len)
+{
+	struct huffman_entry entry = huff->table[bits & ((1 << huff->root) - 1)];
+	if (entry.sub)
+	{
+		bits >>= huff->root;
+		entry = huff->table[entry.value + (bits & ((1 << entry.sub) - 1))];
+		*len = entry.bits ? huff->root + entry.bits : 0;
+		return entry.value;
+	}
+	*len = entry.bits;
+	return entry.value;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,13 @@
 
 #define MAX_WINDOW_SIZE 32768
 
+/*
+ * inflate_fast() refills its bit buffer with unaligned 8 bytes loads, and
+ * copies matches 8 bytes at a time, overrunning them by up to 7 bytes
+ */
+#define FAST_IN_MARGIN  8
+#define FAST_OUT_MARGIN (258 + 8)
+
 enum ctx_state
 {
 	CTX_ZLHEAD, /* zlib header */
@@ -59,7 +66,7 @@ struct ctx
 	uint32_t dyn_hlit;
 	uint32_t dyn_hdist;
 	uint32_t dyn_hclen;
-	uint8_t dyn_lit_lengths_distances[286 + 32];
+	uint8_t dyn_lit_lengths_distances[288 + 32];
 	struct huffman dyn_code_lengths_huff;
 	size_t dyn_hlit_pos;
 	int dyn_hlit_hufcode;
@@ -95,6 +102,52 @@ struct ctx
 	} gzip;
 };
 
+static const uint16_t length_bases[] =
+{
+	/* 257 */ 3  , 4  , 5  , 6  , 7,
+	/* 262 */ 8  , 9  , 10 , 11 , 13,
+	/* 267 */ 15 , 17 , 19 , 23 , 27,
+	/* 272 */ 31 , 35 , 43 , 51 , 59,
+	/* 277 */ 67 , 83 , 99 , 115, 131,
+	/* 282 */ 163, 195, 227, 258,
+};
+
+static const uint8_t length_bits[] =
+{
+	/* 257 */ 0, 0, 0, 0,
+	/* 261 */ 0, 0, 0, 0,
+	/* 265 */ 1, 1, 1, 1,
+	/* 269 */ 2, 2, 2, 2,
+	/* 273 */ 3, 3, 3, 3,
+	/* 277 */ 4, 4, 4, 4,
+	/* 281 */ 5, 5, 5, 5,
+	/* 285 */ 0,
+};
+
+static const uint16_t dist_bases[] =
+{
+	/*  0 */ 1    , 2    , 3   , 4,
+	/*  4 */ 5    , 7    , 9   , 13,
+	/*  8 */ 17   , 25   , 33  , 49,
+	/* 12 */ 65   , 97   , 129 , 193,
+	/* 16 */ 257  , 385  , 513 , 769,
+	/* 20 */ 1025 , 1537 , 2049, 3073,
+	/* 24 */ 4097 , 6145 , 8193, 12289,
+	/* 28 */ 16385, 24577,
+};
+
+static const uint8_t dist_bits[] =
+{
+	/*  0 */ 0 , 0 , 0 , 0,
+	/*  4 */ 1 , 1 , 2 , 2,
+	/*  8 */ 3 , 3 , 4 , 4,
+	/* 12 */ 5 , 5 , 6 , 6,
+	/* 16 */ 7 , 7 , 8 , 8,
+	/* 20 */ 9 , 9 , 10, 10,
+	/* 24 */ 11, 11, 12, 12,
+	/* 28 */ 13, 13,
+};
+
 static void
 write_byte(struct ctx *ctx, uint8_t c)
 {
@@ -104,7 +157,7 @@ write_byte(struct ctx *ctx, uint8_t c)
 	ctx->zlib_adler = adler32(ctx->zlib_adler, &c, 1);
 }
 
-static void
+static int
 generate_static_huffman(struct ctx *ctx)
 {
 	/* XXX hardcode it in static memory */
@@ -121,12 +174,15 @@ generate_static_huffman(struct ctx *ctx)
 		lit_lengths_distances[i] = 8;
 	for (size_t i = 288; i < 288 + 32; ++i)
 		lit_lengths_distances[i] = 5;
-	huffman_generate(&ctx->huff_lit, lit_lengths_distances, hlit);
-	huffman_generate(&ctx->huff_dist, &lit_lengths_distances[hlit], hdist);
+	if (huffman_generate(&ctx->huff_lit, lit_lengths_distances, hlit,
+	                     HUFFMAN_LIT_BITS) != Z_OK)
+		return Z_DATA_ERROR;
+	return huffman_generate(&ctx->huff_dist, &lit_lengths_distances[hlit],
+	                        hdist, HUFFMAN_DIST_BITS);
 }
 
 static int
-decode_code(struct bitstream *bs, uint8_t *dst, size_t *i, int v)
+decode_code(struct bitstream *bs, uint8_t *dst, size_t *i, size_t max, int v)
 {
 	if (v == 16)
 	{
@@ -138,6 +194,8 @@ decode_code(struct bitstream *bs, uint8_t *dst, size_t *i, int v)
 		bitstream_read(bs, &rp, 2);
 		uint16_t cpy = dst[(*i) - 1];
 		rp += 3;
+		if (*i + rp > max)
+			return Z_DATA_ERROR;
 		for (size_t j = 0; j < rp; ++j)
 			dst[(*i)++] = cpy;
 		return Z_OK;
@@ -149,6 +207,8 @@ decode_code(struct bitstream *bs, uint8_t *dst, size_t *i, int v)
 		uint32_t rp;
 		bitstream_read(bs, &rp, 3);
 		rp += 3;
+		if (*i + rp > max)
+			return Z_DATA_ERROR;
 		for (size_t j = 0; j < rp; ++j)
 			dst[(*i)++] = 0;
 		return Z_OK;
@@ -160,6 +220,8 @@ decode_code(struct bitstream *bs, uint8_t *dst, size_t *i, int v)
 		uint32_t rp;
 		bitstream_read(bs, &rp, 7);
 		rp += 11;
+		if (*i + rp > max)
+			return Z_DATA_ERROR;
 		for (size_t j = 0; j < rp; ++j)
 			dst[(*i)++] = 0;
 		return Z_OK;
@@ -389,7 +451,8 @@ handle_blkhdr(struct ctx *ctx)
 			ctx->state = CTX_RAWHDR;
 			return Z_OK;
 		case 1:
-			generate_static_huffman(ctx);
+			if (generate_static_huffman(ctx) != Z_OK)
+				return Z_DATA_ERROR;
 			ctx->state = CTX_HUFCOD;
 			ctx->hufcode_char = -1;
 			return Z_OK;
@@ -461,6 +524,8 @@ handle_dynhdr(struct ctx *ctx)
 	ctx->dyn_hlit += 257;
 	ctx->dyn_hdist += 1;
 	ctx->dyn_hclen += 4;
+	if (ctx->dyn_hlit > 286 || ctx->dyn_hdist > 30)
+		return Z_DATA_ERROR;
 	ctx->state = CTX_DYNLEN;
 	return Z_OK;
 }
@@ -487,7 +552,9 @@ handle_dynlen(struct ctx *ctx)
 	}
 	for (size_t i = ctx->dyn_hclen; i < 19; ++i)
 		code_lengths[code_lengths_idx[i]] = 0;
-	huffman_generate(&ctx->dyn_code_lengths_huff, code_lengths, 19);
+	if (huffman_generate(&ctx->dyn_code_lengths_huff, code_lengths, 19,
+	                     HUFFMAN_CL_BITS) != Z_OK)
+		return Z_DATA_ERROR;
 	ctx->dyn_hlit_pos = 0;
 	ctx->state = CTX_DYNLIT;
 	ctx->dyn_hlit_hufcode = -1;
@@ -508,24 +575,162 @@ handle_dynlit(struct ctx *ctx)
 		}
 		int ret = decode_code(&ctx->bs, ctx->dyn_lit_lengths_distances,
 		                      &ctx->dyn_hlit_pos,
+		                      ctx->dyn_hlit + ctx->dyn_hdist,
 		                      ctx->dyn_hlit_hufcode);
 		if (ret != Z_OK)
 			return ret;
 		ctx->dyn_hlit_hufcode = -1;
 	}
-	huffman_generate(&ctx->huff_lit, ctx->dyn_lit_lengths_distances,
-	                 ctx->dyn_hlit);
-	huffman_generate(&ctx->huff_dist,
-	                 &ctx->dyn_lit_lengths_distances[ctx->dyn_hlit],
-	                 ctx->dyn_hdist);
+	if (huffman_generate(&ctx->huff_lit, ctx->dyn_lit_lengths_distances,
+	                     ctx->dyn_hlit, HUFFMAN_LIT_BITS) != Z_OK)
+		return Z_DATA_ERROR;
+	if (huffman_generate(&ctx->huff_dist,
+	                     &ctx->dyn_lit_lengths_distances[ctx->dyn_hlit],
+	                     ctx->dyn_hdist, HUFFMAN_DIST_BITS) != Z_OK)
+		return Z_DATA_ERROR;
 	ctx->state = CTX_HUFCOD;
 	ctx->hufcode_char = -1;
 	return Z_OK;
 }
 
+static inline uint64_t
+load_le64(const uint8_t *ptr)
+{
+	uint64_t v;
+	memcpy(&v, ptr, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+/*
+ * decode the literal / length / distance codes straight from the input
+ * ring to the output window, with a 64-bit bit buffer refilled once per
+ * code (a code, a distance and their extra bits take at most 48 bits)
+ * it stops at the end of the block, or when the contiguous input or output
+ * space gets too small, leaving the rest to the resumable handlers
+ */
+static int
+inflate_fast(struct ctx *ctx)
+{
+	const uint8_t *in_start = ringbuf_read_ptr(&ctx->input);
+	const uint8_t *in_end = in_start + ringbuf_contiguous_read_size(&ctx->input);
+	const uint8_t *in = in_start;
+	uint8_t *window = ctx->output.data;
+	uint8_t *out_start = ringbuf_write_ptr(&ctx->output);
+	uint8_t *out_end = out_start + ringbuf_contiguous_write_size(&ctx->output);
+	uint8_t *out = out_start;
+	size_t mask = ctx->output.size - 1;
+	uint64_t bitbuf = 0;
+	size_t bitcnt = 0;
+	int ret = Z_OK;
+	if (in_end - in < FAST_IN_MARGIN || out_end - out < FAST_OUT_MARGIN)
+		return Z_OK;
+	bitbuf = load_le64(in) >> ctx->bs.pos;
+	bitcnt = 56 - ctx->bs.pos;
+	in += 7;
+	while (in_end - in >= FAST_IN_MARGIN && out_end - out >= FAST_OUT_MARGIN)
+	{
+		/* the byte at in always starts at bit bitcnt */
+		bitbuf |= load_le64(in) << bitcnt;
+		in += (63 - bitcnt) / 8;
+		bitcnt |= 56;
+		uint8_t len;
+		uint16_t symbol = huffman_lookup(&ctx->huff_lit, bitbuf, &len);
+		if (!len)
+		{
+			ret = Z_DATA_ERROR;
+			break;
+		}
+		bitbuf >>= len;
+		bitcnt -= len;
+		if (symbol < 256)
+		{
+			*out++ = symbol;
+			continue;
+		}
+		if (symbol == 256)
+		{
+			ctx->state = CTX_BLKHDR;
+			break;
+		}
+		symbol -= 257;
+		if (symbol >= sizeof(length_bases) / sizeof(*length_bases))
+		{
+			ret = Z_DATA_ERROR;
+			break;
+		}
+		size_t length = length_bases[symbol]
+		              + (bitbuf & ((1 << length_bits[symbol]) - 1));
+		bitbuf >>= length_bits[symbol];
+		bitcnt -= length_bits[symbol];
+		symbol = huffman_lookup(&ctx->huff_dist, bitbuf, &len);
+		if (!len || symbol >= sizeof(dist_bases) / sizeof(*dist_bases))
+		{
+			ret = Z_DATA_ERROR;
+			break;
+		}
+		bitbuf >>= len;
+		bitcnt -= len;
+		size_t dist = dist_bases[symbol]
+		            + (bitbuf & ((1 << dist_bits[symbol]) - 1));
+		bitbuf >>= dist_bits[symbol];
+		bitcnt -= dist_bits[symbol];
+		size_t pos = out - window;
+		if (dist > pos)
+		{
+			/* the match starts before the window wrap */
+			for (size_t i = 0; i < length; ++i)
+				out[i] = window[(pos + i - dist) & mask];
+			out += length;
+			continue;
+		}
+		const uint8_t *src = out - dist;
+		uint8_t *end = out + length;
+		if (dist >= 8)
+		{
+			do
+			{
+				memcpy(out, src, 8);
+				out += 8;
+				src += 8;
+			} while (out < end);
+		}
+		else if (dist == 1)
+		{
+			memset(out, *src, length);
+		}
+		else
+		{
+			do
+			{
+				*out++ = *src++;
+			} while (out < end);
+		}
+		out = end;
+	}
+	size_t written = out - out_start;
+	if (written)
+	{
+		ctx->gz_len += written;
+		ctx->gz_crc = crc32_z(ctx->gz_crc, out_start, written);
+		ctx->zlib_adler = adler32_z(ctx->zlib_adler, out_start, written);
+		ringbuf_advance_write(&ctx->output, written);
+	}
+	bitstream_skip(&ctx->bs, (in - in_start) * 8 - bitcnt - ctx->bs.pos);
+	return ret;
+}
+
 static int
 handle_hufcod(struct ctx *ctx)
 {
+	if (ctx->hufcode_char < 0)
+	{
+		int ret = inflate_fast(ctx);
+		if (ret != Z_OK || ctx->state != CTX_HUFCOD)
+			return ret;
+	}
 	if (ctx->hufcode_char >= 0)
 	{
 		uint8_t c = ctx->hufcode_char;
@@ -550,33 +755,10 @@ handle_hufcod(struct ctx *ctx)
 		ctx->state = CTX_BLKHDR;
 		return Z_OK;
 	}
-	if (ctx->hufcode_char == 285)
-	{
-		ctx->back_size = 258;
-		ctx->state = CTX_HUFDST;
-		return Z_OK;
-	}
-	static const uint8_t extra_lengths[] =
-	{
-		/* 257 */ 3  , 4  , 5  , 6  , 7,
-		/* 262 */ 8  , 9  , 10 , 11 , 13,
-		/* 267 */ 15 , 17 , 19 , 23 , 27,
-		/* 272 */ 31 , 35 , 43 , 51 , 59,
-		/* 277 */ 67 , 83 , 99 , 115, 131,
-		/* 282 */ 163, 195, 227,
-	};
-	static const uint8_t extra_length_bits[] =
-	{
-		/* 257 */ 0, 0, 0, 0,
-		/* 261 */ 0, 0, 0, 0,
-		/* 265 */ 1, 1, 1, 1,
-		/* 269 */ 2, 2, 2, 2,
-		/* 273 */ 3, 3, 3, 3,
-		/* 277 */ 4, 4, 4, 4,
-		/* 281 */ 5, 5, 5, 5,
-	};
-	ctx->back_size = extra_lengths[ctx->hufcode_char - 257];
-	ctx->extra_length_bits = extra_length_bits[ctx->hufcode_char - 257];
+	if (ctx->hufcode_char > 285)
+		return Z_DATA_ERROR;
+	ctx->back_size = length_bases[ctx->hufcode_char - 257];
+	ctx->extra_length_bits = length_bits[ctx->hufcode_char - 257];
 	if (ctx->extra_length_bits)
 		ctx->state = CTX_EXTLEN;
 	else
@@ -602,30 +784,10 @@ handle_hufdst(struct ctx *ctx)
 	ctx->hufcode_dist = huffman_decode(&ctx->bs, &ctx->huff_dist);
 	if (ctx->hufcode_dist < 0)
 		return ctx->hufcode_dist;
-	static const uint8_t extra_dist_bits[] =
-	{
-		/*  0 */ 0 , 0 , 0 , 0,
-		/*  4 */ 1 , 1 , 2 , 2,
-		/*  8 */ 3 , 3 , 4 , 4,
-		/* 12 */ 5 , 5 , 6 , 6,
-		/* 16 */ 7 , 7 , 8 , 8,
-		/* 20 */ 9 , 9 , 10, 10,
-		/* 24 */ 11, 11, 12, 12,
-		/* 28 */ 13, 13,
-	};
-	static const uint16_t extra_dists[] =
-	{
-		/*  0 */ 1    , 2    , 3   , 4,
-		/*  4 */ 5    , 7    , 9   , 13,
-		/*  8 */ 17   , 25   , 33  , 49,
-		/* 12 */ 65   , 97   , 129 , 193,
-		/* 16 */ 257  , 385  , 513 , 769,
-		/* 20 */ 1025 , 1537 , 2049, 3073,
-		/* 24 */ 4097 , 6145 , 8193, 12289,
-		/* 28 */ 16385, 24577,
-	};
-	ctx->back_dist = extra_dists[ctx->hufcode_dist];
-	ctx->extra_dist_bits = extra_dist_bits[ctx->hufcode_dist];
+	if (ctx->hufcode_dist >= 30)
+		return Z_DATA_ERROR;
+	ctx->back_dist = dist_bases[ctx->hufcode_dist];
+	ctx->extra_dist_bits = dist_bits[ctx->hufcode_dist];
 	if (ctx->extra_dist_bits)
 		ctx->state = CTX_EXTDST;
 	else
@@ -865,8 +1027,14 @@ inflate(z_stream *stream, int flush)
 				ret = Z_OK;
 		}
 	}
-	if (ret == Z_STREAM_END && ringbuf_read_size(&ctx->output))
-		ret = Z_OK;
+	/* the input may be exhausted with output still in the window */
+	if (ret == Z_OK || ret == Z_NEED_MORE || ret == Z_STREAM_END)
+	{
+		if (stream->avail_out)
+			copy_out(stream);
+		if (ctx->state == CTX_STREND)
+			ret = ringbuf_read_size(&ctx->output) ? Z_OK : Z_STREAM_END;
+	}
 	if (ret == Z_NEED_MORE)
 		ret = Z_OK;
 	return ret;
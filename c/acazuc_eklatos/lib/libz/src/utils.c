@@ -63,5 +63,7 @@ uncompress2(uint8_t *dst,
 	inflateEnd(&stream);
 	if (ret == Z_OK)
 		return Z_BUF_ERROR;
+	if (ret == Z_STREAM_END)
+		return Z_OK;
 	return ret;
 }
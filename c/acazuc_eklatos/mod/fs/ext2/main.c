@@ -34,7 +34,7 @@ static struct fs_type fs_type =
 {
 	.op = &fs_type_op,
 	.name = "ext2fs",
-	.flags = 0,
+	.flags = FS_TYPE_DCACHE,
 };
 
 static const struct node_op dir_op =
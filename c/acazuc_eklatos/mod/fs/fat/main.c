@@ -147,7 +147,7 @@ static struct fs_type fs_type =
 {
 	.op = &fs_type_op,
 	.name = "fatfs",
-	.flags = 0,
+	.flags = FS_TYPE_DCACHE,
 };
 
 static const struct node_op
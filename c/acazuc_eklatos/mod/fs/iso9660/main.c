@@ -162,7 +162,7 @@ fs_type =
 {
 	.op = &fs_type_op,
 	.name = "iso9660",
-	.flags = 0,
+	.flags = FS_TYPE_DCACHE,
 };
 
 static const struct node_op
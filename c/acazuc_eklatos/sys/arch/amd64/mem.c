@@ -28,6 +28,7 @@
 #define DIR_FLAG_D     (1ULL << 6) /* dirty */
 #define DIR_FLAG_PS    (1ULL << 7) /* page size */
 #define DIR_FLAG_G     (1ULL << 8) /* global */
+#define DIR_FLAG_PAT   (1ULL << 12) /* page attribute table (large page) */
 #define DIR_FLAG_XD    (1ULL << 63) /* execute disable */
 #define DIR_FLAG_MASK  (0xFFF0000000000FFFULL)
 
@@ -46,6 +47,15 @@
 #define DIR_POFF(val)  (DIR_PADDR(val) >> DIR_SHIFT(0))
 #define DIR_PADDR(val) ((uint64_t)(val) & ~DIR_FLAG_MASK)
 
+#define LARGE_POFF(val) (DIR_POFF(val) & ~(uint64_t)(LARGE_PAGES - 1))
+
+#define LARGE_PAGES 512 /* pages in a 2MB page */
+#define LARGE_SIZE  ((uint64_t)PAGE_SIZE * LARGE_PAGES)
+#define LARGE_MASK  (LARGE_SIZE - 1)
+
+/* above this number of pages, flush the whole tlb instead of using invlpg */
+#define FLUSH_MAX 32
+
 #define PMAP(addr) ((void*)(VADDR_PMAP_BEGIN + (uint64_t)(addr)))
 
 extern uint8_t _kernel_end;
@@ -59,10 +69,9 @@ static inline uint64_t mkentry(uint64_t poff, uint64_t flags)
 	return (poff << DIR_SHIFT(0)) | flags;
 }
 
-static void set_dir(struct vm_space *space, uint64_t addr, uint64_t *dir,
-                    uint64_t poff, uint32_t prot)
+static uint64_t prot_flags(struct vm_space *space, uint32_t prot)
 {
-	uint64_t f = poff ? TBL_FLAG_P : 0;
+	uint64_t f = 0;
 	if (space)
 		f |= TBL_FLAG_US;
 	if (prot & VM_PROT_W)
@@ -85,29 +94,115 @@ static void set_dir(struct vm_space *space, uint64_t addr, uint64_t *dir,
 	}
 	if (!(prot & VM_PROT_X))
 		f |= TBL_FLAG_XD;
-	*dir = mkentry(poff, f);
+	return f;
+}
+
+/* the PAT bit of a large page is bit 12 because bit 7 is PS */
+static uint64_t large_flags(uint64_t tbl_flags)
+{
+	uint64_t f = (tbl_flags & ~TBL_FLAG_PAT) | DIR_FLAG_PS;
+	if (tbl_flags & TBL_FLAG_PAT)
+		f |= DIR_FLAG_PAT;
+	return f;
+}
+
+static uint64_t small_flags(uint64_t dir)
+{
+	uint64_t f = dir & DIR_FLAG_MASK & ~DIR_FLAG_PS;
+	if (dir & DIR_FLAG_PAT)
+		f |= TBL_FLAG_PAT;
+	return f;
+}
+
+static int is_active(struct vm_space *space)
+{
 	if (!space)
+		return 1;
+	struct thread *thread = curcpu()->thread;
+	return thread && space == thread->proc->vm_space;
+}
+
+/*
+ * pages mapped through this file are never global, so reloading
+ * cr3 is enough to drop them
+ */
+static void flush_range(struct vm_space *space, uintptr_t addr, size_t size)
+{
+	if (!is_active(space))
+		return;
+	if (size / PAGE_SIZE > FLUSH_MAX)
 	{
-		invlpg(addr);
+		setcr3(getcr3());
 		return;
 	}
-	struct thread *thread = curcpu()->thread;
-	if (thread && space == thread->proc->vm_space)
+	for (size_t i = 0; i < size; i += PAGE_SIZE)
+		invlpg(addr + i);
+}
+
+static void set_dir(struct vm_space *space, uint64_t addr, uint64_t *dir,
+                    uint64_t poff, uint32_t prot)
+{
+	uint64_t f = prot_flags(space, prot);
+	if (poff)
+		f |= TBL_FLAG_P;
+	*dir = mkentry(poff, f);
+	if (is_active(space))
 		invlpg(addr);
 }
 
-static int get_dir(struct vm_space *space, uint64_t addr, int create,
-                   uint64_t **dirp)
+static void ref_pages(uintptr_t poff, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		struct page *page = pm_get_page(poff + i);
+		if (page)
+			pm_ref_page(page);
+	}
+}
+
+static void free_pages(uintptr_t poff, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		pm_free_pt(poff + i);
+}
+
+/* replace a 2MB page by a table of the same 4KB pages */
+static int split_large(struct vm_space *space, uint64_t addr, uint64_t *dir)
+{
+	struct page *page;
+	int ret = pm_alloc_page(&page);
+	if (ret)
+		return ret;
+	uint64_t *tbl = PMAP(pm_page_addr(page));
+	uint64_t poff = LARGE_POFF(*dir);
+	uint64_t f = small_flags(*dir);
+	for (size_t i = 0; i < LARGE_PAGES; ++i)
+		tbl[i] = mkentry(poff + i, f);
+	f = DIR_FLAG_P | DIR_FLAG_RW;
+	if (space)
+		f |= DIR_FLAG_US;
+	*dir = mkentry(page->offset, f);
+	if (is_active(space))
+		invlpg(addr & ~LARGE_MASK);
+	return 0;
+}
+
+/*
+ * return the entry describing addr at the given level (0 being the
+ * 4KB pages table, 1 the 2MB pages directory); 2MB pages found on
+ * the way are split if create is set
+ */
+static int get_entry(struct vm_space *space, uint64_t addr, int level,
+                     int create, uint64_t **entryp)
 {
-	uint64_t pte_id = DIR_ID(3, addr);
 	uint64_t *pte = space ? PMAP(pm_page_addr(space->arch.dir_page)) : PMAP(kern_pml_page);
 	uint64_t f = DIR_FLAG_P | DIR_FLAG_RW;
 	if (space)
 		f |= DIR_FLAG_US;
-	uint8_t shift = DIR_SHIFT(2);
-	for (size_t i = 0; i < 3; ++i)
+	for (int n = 3; n > level; --n)
 	{
-		if (!(pte[pte_id] & DIR_FLAG_P))
+		uint64_t *entry = &pte[DIR_ID(n, addr)];
+		if (!(*entry & DIR_FLAG_P))
 		{
 			if (!create)
 				return -EINVAL;
@@ -115,17 +210,38 @@ static int get_dir(struct vm_space *space, uint64_t addr, int create,
 			int ret = pm_alloc_page(&page);
 			if (ret)
 				return ret;
-			pte[pte_id] = mkentry(page->offset, f);
 			memset(PMAP(page->offset * PAGE_SIZE), 0, PAGE_SIZE);
+			*entry = mkentry(page->offset, f);
+		}
+		else if (*entry & DIR_FLAG_PS)
+		{
+			if (!create || n != 1)
+				return -EINVAL;
+			int ret = split_large(space, addr, entry);
+			if (ret)
+				return ret;
 		}
-		pte = PMAP(DIR_PADDR(pte[pte_id]));
-		pte_id = (addr >> shift) & PTE_MASK;
-		shift -= 9;
+		pte = PMAP(DIR_PADDR(*entry));
 	}
-	*dirp = &pte[pte_id];
+	*entryp = &pte[DIR_ID(level, addr)];
 	return 0;
 }
 
+static int get_dir(struct vm_space *space, uint64_t addr, int create,
+                   uint64_t **dirp)
+{
+	return get_entry(space, addr, 0, create, dirp);
+}
+
+/* number of pages from addr to the end of its table, at most size */
+static size_t tbl_pages(uintptr_t addr, size_t size)
+{
+	size_t n = (LARGE_SIZE - (addr & LARGE_MASK)) / PAGE_SIZE;
+	if (n > size / PAGE_SIZE)
+		n = size / PAGE_SIZE;
+	return n;
+}
+
 void arch_vm_setspace(const struct vm_space *space)
 {
 	if (space)
@@ -154,6 +270,11 @@ static void cleanup_level(uint64_t *pte, size_t min, size_t max, uint8_t level)
 		uint64_t entry = pte[i];
 		if (!(entry & DIR_FLAG_P))
 			continue;
+		if (level == 1 && (entry & DIR_FLAG_PS))
+		{
+			free_pages(LARGE_POFF(entry), LARGE_PAGES);
+			continue;
+		}
 		if (level)
 			cleanup_level(PMAP(DIR_PADDR(entry)), 0, 512, level - 1);
 		pm_free_pt(DIR_POFF(entry));
@@ -193,6 +314,28 @@ static int dup_table(uint64_t *dir0_dst, const uint64_t *dir0_src)
 	return 0;
 }
 
+/* the copy of a 2MB page is made of 4KB pages */
+static int copy_large(uint64_t *dir_dst, const uint64_t *dir_src)
+{
+	struct page *page;
+	int ret = pm_alloc_page(&page);
+	if (ret)
+		return ret;
+	uint64_t *tbl = PMAP(pm_page_addr(page));
+	memset(tbl, 0, PAGE_SIZE);
+	*dir_dst = mkentry(page->offset, DIR_FLAG_P | DIR_FLAG_RW | DIR_FLAG_US);
+	uint64_t poff = LARGE_POFF(*dir_src);
+	uint64_t f = small_flags(*dir_src);
+	for (size_t i = 0; i < LARGE_PAGES; ++i)
+	{
+		uint64_t entry = mkentry(poff + i, f);
+		ret = dup_table(&tbl[i], &entry);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
 static int copy_level(uint64_t *dst, const uint64_t *src, size_t min, size_t max,
                       uint8_t level)
 {
@@ -203,7 +346,13 @@ static int copy_level(uint64_t *dst, const uint64_t *src, size_t min, size_t max
 			dst[i] = src[i];
 			continue;
 		}
-		if (level)
+		if (level == 1 && (src[i] & DIR_FLAG_PS))
+		{
+			int ret = copy_large(&dst[i], &src[i]);
+			if (ret)
+				return ret;
+		}
+		else if (level)
 		{
 			struct page *pte_page;
 			int ret = pm_alloc_page(&pte_page);
@@ -234,93 +383,202 @@ int arch_vm_space_copy(struct vm_space *dst, struct vm_space *src)
 	                  0, 256, 3);
 }
 
-static int map_page(struct vm_space *space, uintptr_t addr, uintptr_t poff,
-                    uint32_t prot)
-{
-	uint64_t *dir;
-	int ret = get_dir(space, addr, 1, &dir);
-	if (ret)
-	{
-		TRACE("failed to get vmap dir");
-		return ret;
-	}
-	if (*dir & TBL_FLAG_P)
-	{
-		TRACE("vmap already created page %p: 0x%016" PRIx64,
-		      (void*)addr, *dir);
-		return -EINVAL;
-	}
-	set_dir(space, addr, dir, poff, prot);
-	if (poff)
-	{
-		struct page *page = pm_get_page(poff);
-		if (page)
-			pm_ref_page(page);
-	}
-	return 0;
-}
-
 int arch_vm_map(struct vm_space *space, uintptr_t addr, uintptr_t poff,
                 size_t size, uint32_t prot)
 {
-	/* XXX optimize pte tree */
-	for (size_t i = 0; i < size; i += PAGE_SIZE)
+	uint64_t f = prot_flags(space, prot);
+	size_t i = 0;
+	int ret;
+	while (i < size)
 	{
-		int ret = map_page(space, addr + i, poff + i / PAGE_SIZE, prot);
+		uintptr_t vaddr = addr + i;
+		uintptr_t paddr = poff + i / PAGE_SIZE;
+		size_t n = tbl_pages(vaddr, size - i);
+		uint64_t *dir;
+		if (n == LARGE_PAGES && paddr && !(paddr % LARGE_PAGES))
+		{
+			ret = get_entry(space, vaddr, 1, 1, &dir);
+			if (ret)
+			{
+				TRACE("failed to get vmap dir");
+				goto err;
+			}
+			if (!(*dir & DIR_FLAG_P))
+			{
+				*dir = mkentry(paddr, large_flags(f) | DIR_FLAG_P);
+				ref_pages(paddr, LARGE_PAGES);
+				i += LARGE_SIZE;
+				continue;
+			}
+		}
+		ret = get_dir(space, vaddr, 1, &dir);
 		if (ret)
 		{
-			arch_vm_unmap(NULL, addr, i);
-			TRACE("failed to map page");
-			return ret;
+			TRACE("failed to get vmap dir");
+			goto err;
 		}
+		for (size_t j = 0; j < n; ++j)
+		{
+			if (dir[j] & TBL_FLAG_P)
+			{
+				TRACE("vmap already created page %p: 0x%016" PRIx64,
+				      (void*)(vaddr + j * PAGE_SIZE), dir[j]);
+				ret = -EINVAL;
+				goto err;
+			}
+		}
+		for (size_t j = 0; j < n; ++j)
+			dir[j] = mkentry(paddr + j, paddr + j ? f | TBL_FLAG_P : f);
+		ref_pages(paddr, n);
+		i += n * PAGE_SIZE;
 	}
+	flush_range(space, addr, size);
 	return 0;
-}
 
-static int unmap_page(struct vm_space *space, uintptr_t addr)
-{
-	uint64_t *dir;
-	if (get_dir(space, addr, 0, &dir))
-		return 0;
-	if (*dir & TBL_FLAG_P)
-		pm_free_pt(DIR_POFF(*dir));
-	*dir = mkentry(0, 0);
-	invlpg(addr);
-	return 0;
+err:
+	arch_vm_unmap(space, addr, i);
+	TRACE("failed to map page");
+	return ret;
 }
 
 int arch_vm_unmap(struct vm_space *space, uintptr_t addr, size_t size)
 {
-	/* XXX optimize pte tree */
-	for (size_t i = 0; i < size; i += PAGE_SIZE)
-		unmap_page(space, addr + i);
-	return 0;
+	int ret = 0;
+	for (size_t i = 0; i < size;)
+	{
+		uintptr_t vaddr = addr + i;
+		size_t n = tbl_pages(vaddr, size - i);
+		uint64_t *dir;
+		i += n * PAGE_SIZE;
+		if (get_entry(space, vaddr, 1, 0, &dir)
+		 || !(*dir & DIR_FLAG_P))
+			continue;
+		if (*dir & DIR_FLAG_PS)
+		{
+			if (n == LARGE_PAGES)
+			{
+				free_pages(LARGE_POFF(*dir), LARGE_PAGES);
+				*dir = mkentry(0, 0);
+				continue;
+			}
+			ret = split_large(space, vaddr, dir);
+			if (ret)
+			{
+				TRACE("failed to split large page");
+				continue;
+			}
+		}
+		uint64_t *tbl = &((uint64_t*)PMAP(DIR_PADDR(*dir)))[DIR_ID(0, vaddr)];
+		for (size_t j = 0; j < n; ++j)
+		{
+			if (tbl[j] & TBL_FLAG_P)
+				pm_free_pt(DIR_POFF(tbl[j]));
+			tbl[j] = mkentry(0, 0);
+		}
+		/* the whole table is now empty */
+		if (n == LARGE_PAGES)
+		{
+			pm_free_pt(DIR_POFF(*dir));
+			*dir = mkentry(0, 0);
+		}
+	}
+	flush_range(space, addr, size);
+	return ret;
 }
 
-static int protect_page(struct vm_space *space, uintptr_t addr, uint32_t prot)
+int arch_vm_protect(struct vm_space *space, uintptr_t addr, size_t size,
+                    uint32_t prot)
 {
-	uint64_t *dir;
-	int ret = get_dir(space, addr, 0, &dir);
-	if (ret)
-		return 0;
-	set_dir(space, addr, dir, DIR_POFF(*dir), prot);
-	return 0;
+	uint64_t f = prot_flags(space, prot);
+	int ret = 0;
+	for (size_t i = 0; i < size;)
+	{
+		uintptr_t vaddr = addr + i;
+		size_t n = tbl_pages(vaddr, size - i);
+		uint64_t *dir;
+		i += n * PAGE_SIZE;
+		if (get_entry(space, vaddr, 1, 0, &dir)
+		 || !(*dir & DIR_FLAG_P))
+			continue;
+		if (*dir & DIR_FLAG_PS)
+		{
+			if (n == LARGE_PAGES)
+			{
+				*dir = mkentry(LARGE_POFF(*dir),
+				               large_flags(f) | DIR_FLAG_P);
+				continue;
+			}
+			ret = split_large(space, vaddr, dir);
+			if (ret)
+			{
+				TRACE("failed to split large page");
+				continue;
+			}
+		}
+		uint64_t *tbl = &((uint64_t*)PMAP(DIR_PADDR(*dir)))[DIR_ID(0, vaddr)];
+		for (size_t j = 0; j < n; ++j)
+		{
+			if (tbl[j] & TBL_FLAG_P)
+				tbl[j] = mkentry(DIR_POFF(tbl[j]), f | TBL_FLAG_P);
+		}
+	}
+	flush_range(space, addr, size);
+	return ret;
 }
 
-int arch_vm_protect(struct vm_space *space, uintptr_t addr, size_t size,
-                    uint32_t prot)
+/*
+ * anonymous memory is faulted 2MB at a time when the whole aligned
+ * range belongs to the zone and no page of it is mapped yet
+ */
+static void populate_large(struct vm_space *space, uintptr_t addr,
+                           uint64_t *dir)
 {
-	/* XXX optimize pte tree */
-	for (size_t i = 0; i < size; i += PAGE_SIZE)
-		protect_page(space, addr + i, prot);
-	return 0;
+	uintptr_t base = addr & ~LARGE_MASK;
+	struct vm_zone *zone;
+	struct page *pages;
+	if (vm_space_find(space, addr, &zone)
+	 || zone->op
+	 || base < zone->addr
+	 || base + LARGE_SIZE > zone->addr + zone->size)
+		return;
+	if (pm_alloc_pages_aligned(&pages, LARGE_PAGES, LARGE_PAGES))
+		return;
+	memset(PMAP(pm_page_addr(pages)), 0, LARGE_SIZE);
+	*dir = mkentry(pages->offset,
+	               large_flags(prot_flags(space, zone->prot)) | DIR_FLAG_P);
+	if (is_active(space))
+		invlpg(addr);
 }
 
 int arch_vm_populate_page(struct vm_space *space, uintptr_t addr,
                           uint32_t prot, uintptr_t *poffp)
 {
 	uint64_t *dir;
-	int ret = get_dir(space, addr, 1, &dir);
+	int ret = get_entry(space, addr, 1, 1, &dir);
+	if (ret)
+	{
+		TRACE("failed to get dir");
+		return ret;
+	}
+	if (space && !(*dir & DIR_FLAG_P))
+		populate_large(space, addr, dir);
+	if (*dir & DIR_FLAG_PS)
+	{
+		if (prot & VM_PROT_X)
+		{
+			if (*dir & DIR_FLAG_XD)
+				return -EFAULT;
+		}
+		else if (prot & VM_PROT_W)
+		{
+			if (!(*dir & DIR_FLAG_RW))
+				return -EFAULT;
+		}
+		if (poffp)
+			*poffp = LARGE_POFF(*dir) + DIR_ID(0, addr);
+		return 0;
+	}
+	ret = get_dir(space, addr, 1, &dir);
 	if (ret)
 	{
 		TRACE("failed to get dir");
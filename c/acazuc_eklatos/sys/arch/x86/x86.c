@@ -18,6 +18,7 @@
 
 uint8_t g_isa_irq[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
 int g_has_apic;
+int g_has_erms;
 extern uint8_t _kernel_end;
 struct user_fpu g_default_fpu;
 #if defined(__i386__)
@@ -140,6 +141,8 @@ void arch_cpu_boot(struct cpu *cpu)
 			wrmsr(MSR_KVM_EOI_EN, paddr | 1);
 		}
 		arch_save_fpu(&g_default_fpu);
+		if (cpu->arch.cpuid.extf_0_ebx & CPUID_EXTF_0_EBX_ERMS)
+			g_has_erms = 1;
 		if (cpu->arch.cpuid.feat_ecx & CPUID_FEAT_ECX_RDRAND)
 			random_register(rdrand_collect, NULL);
 	}
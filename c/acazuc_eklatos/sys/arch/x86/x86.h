@@ -157,6 +157,7 @@ int register_isa_irq(enum isa_irq_id id, irq_fn_t fn, void *userptr,
 
 extern uint8_t g_isa_irq[16];
 extern int g_has_apic;
+extern int g_has_erms;
 extern struct user_fpu g_default_fpu;
 
 #endif
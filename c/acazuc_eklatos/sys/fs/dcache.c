@@ -0,0 +1,429 @@
+#include "sysfs/sysfs.h"
+
+#include <spinlock.h>
+#include <errno.h>
+#include <file.h>
+#include <proc.h>
+#include <uio.h>
+#include <std.h>
+#include <vfs.h>
+
+/*
+ * dentry cache
+ *
+ * global hash table of (directory, name) -> node, including negative
+ * entries (node == NULL), for filesystems flagged with FS_TYPE_DCACHE
+ * (their namespace is only modified through the node_* functions, which
+ * invalidate the entries)
+ *
+ * entries are taken from a static pool and are never freed, which
+ * allows dcache_getnode to walk the hash chains without any lock or
+ * reference: everything required to walk a path is copied in the
+ * entry, and the walk is validated against the sequence counter
+ * (incremented twice by each modification) before taking the
+ * references of the result
+ *
+ * each entry holds a reference on its directory and its node; entries
+ * are recycled using a clock (second chance) over the lru list
+ */
+
+#define DCACHE_ENTRIES 4096
+#define DCACHE_BUCKETS 4096
+#define DCACHE_NAME_MAX 39
+#define DCACHE_CHAIN_MAX 32 /* give up lockless chain walks after that */
+#define DCACHE_FLUSH_BATCH 32
+
+#define DENTRY_DIR       (1 << 0)
+#define DENTRY_LNK       (1 << 1)
+#define DENTRY_CACHEABLE (1 << 2)
+
+struct dentry
+{
+	struct dentry *hash_next;
+	TAILQ_ENTRY(dentry) lru_chain;
+	struct node *dir;
+	struct node *child; /* as returned by the lookup, NULL if negative */
+	struct node *node; /* child once the mount point is resolved */
+	uint32_t hash;
+	uint8_t flags; /* of node */
+	uint8_t referenced;
+	uint8_t name_len;
+	char name[DCACHE_NAME_MAX];
+};
+
+struct dcache_stats
+{
+	uint64_t fast_hits;
+	uint64_t fast_misses;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+static struct dentry entries[DCACHE_ENTRIES];
+static struct dentry *buckets[DCACHE_BUCKETS];
+static TAILQ_HEAD(dentry_head, dentry) lru = TAILQ_HEAD_INITIALIZER(lru);
+static struct dentry *free_list;
+static struct spinlock lock = SPINLOCK_INITIALIZER();
+static size_t seq; /* odd while the hash table is being modified */
+static size_t gen; /* incremented by every invalidation */
+static size_t count;
+static struct dcache_stats stats;
+
+void dcache_init(void)
+{
+	for (size_t i = 0; i < DCACHE_ENTRIES; ++i)
+	{
+		entries[i].hash_next = free_list;
+		free_list = &entries[i];
+	}
+}
+
+static uint32_t name_hash(const struct node *dir, const char *name,
+                          size_t name_len)
+{
+	uint64_t h = (uintptr_t)dir * 0x9E3779B97F4A7C15ULL;
+	for (size_t i = 0; i < name_len; ++i)
+		h = (h ^ (uint8_t)name[i]) * 0x100000001B3ULL;
+	return h ^ (h >> 32);
+}
+
+static int is_cacheable(const struct node *dir)
+{
+	return dir->sb && (dir->sb->type->flags & FS_TYPE_DCACHE);
+}
+
+static int is_dot(const char *name, size_t name_len)
+{
+	return (name_len == 1 && name[0] == '.')
+	    || (name_len == 2 && name[0] == '.' && name[1] == '.');
+}
+
+static void write_begin(void)
+{
+	__atomic_store_n(&seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(void)
+{
+	__atomic_store_n(&seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static struct dentry *find(const struct node *dir, const char *name,
+                           size_t name_len, uint32_t hash)
+{
+	struct dentry *dentry = __atomic_load_n(&buckets[hash % DCACHE_BUCKETS],
+	                                        __ATOMIC_ACQUIRE);
+	for (size_t i = 0; dentry && i < DCACHE_CHAIN_MAX; ++i)
+	{
+		if (dentry->hash == hash
+		 && dentry->dir == dir
+		 && dentry->name_len == name_len
+		 && !memcmp(dentry->name, name, name_len))
+			return dentry;
+		dentry = __atomic_load_n(&dentry->hash_next, __ATOMIC_ACQUIRE);
+	}
+	return NULL;
+}
+
+static void unlink_dentry(struct dentry *dentry)
+{
+	struct dentry **it = &buckets[dentry->hash % DCACHE_BUCKETS];
+	while (*it != dentry)
+		it = &(*it)->hash_next;
+	__atomic_store_n(it, dentry->hash_next, __ATOMIC_RELEASE);
+	TAILQ_REMOVE(&lru, dentry, lru_chain);
+	count--;
+}
+
+/* called with the lock held, the references of the entry are moved
+ * to dir / child
+ */
+static void remove_dentry(struct dentry *dentry, struct node **dir,
+                          struct node **child)
+{
+	unlink_dentry(dentry);
+	*dir = dentry->dir;
+	*child = dentry->child;
+	dentry->dir = NULL;
+	dentry->child = NULL;
+	dentry->node = NULL;
+	dentry->hash_next = free_list;
+	free_list = dentry;
+}
+
+static void release(struct node *dir, struct node *child)
+{
+	if (dir)
+		node_free(dir);
+	if (child)
+		node_free(child);
+}
+
+/* second chance over the lru, called with the lock held */
+static struct dentry *evict(struct node **dir, struct node **child)
+{
+	struct dentry *dentry = NULL;
+	for (size_t i = 0; i < count; ++i)
+	{
+		dentry = TAILQ_LAST(&lru, dentry_head);
+		if (!dentry->referenced)
+			break;
+		dentry->referenced = 0;
+		TAILQ_REMOVE(&lru, dentry, lru_chain);
+		TAILQ_INSERT_HEAD(&lru, dentry, lru_chain);
+	}
+	dentry = TAILQ_LAST(&lru, dentry_head);
+	remove_dentry(dentry, dir, child);
+	stats.evictions++;
+	dentry = free_list;
+	free_list = dentry->hash_next;
+	return dentry;
+}
+
+static void insert(struct node *dir, const char *name, size_t name_len,
+                   uint32_t hash, struct node *child, size_t lookup_gen)
+{
+	struct node *node = child;
+	if (node && S_ISDIR(node->attr.mode) && node->mount)
+		node = node->mount->root;
+	uint8_t flags = 0;
+	if (node)
+	{
+		if (S_ISDIR(node->attr.mode))
+			flags |= DENTRY_DIR;
+		if (S_ISLNK(node->attr.mode))
+			flags |= DENTRY_LNK;
+		if (is_cacheable(node))
+			flags |= DENTRY_CACHEABLE;
+	}
+	struct node *old_dir = NULL;
+	struct node *old_child = NULL;
+	node_ref(dir);
+	if (child)
+		node_ref(child);
+	spinlock_lock(&lock);
+	if (gen != lookup_gen || find(dir, name, name_len, hash))
+	{
+		spinlock_unlock(&lock);
+		release(dir, child);
+		return;
+	}
+	write_begin();
+	struct dentry *dentry;
+	if (free_list)
+	{
+		dentry = free_list;
+		free_list = dentry->hash_next;
+	}
+	else
+	{
+		dentry = evict(&old_dir, &old_child);
+	}
+	dentry->dir = dir;
+	dentry->child = child;
+	dentry->node = node;
+	dentry->hash = hash;
+	dentry->flags = flags;
+	dentry->referenced = 0;
+	dentry->name_len = name_len;
+	memcpy(dentry->name, name, name_len);
+	struct dentry **bucket = &buckets[hash % DCACHE_BUCKETS];
+	dentry->hash_next = *bucket;
+	__atomic_store_n(bucket, dentry, __ATOMIC_RELEASE);
+	TAILQ_INSERT_HEAD(&lru, dentry, lru_chain);
+	count++;
+	write_end();
+	spinlock_unlock(&lock);
+	release(old_dir, old_child);
+}
+
+int dcache_lookup(struct node *dir, const char *name, size_t name_len,
+                  struct node **child)
+{
+	if (!is_cacheable(dir)
+	 || name_len > DCACHE_NAME_MAX
+	 || is_dot(name, name_len))
+		return node_lookup(dir, name, name_len, child);
+	uint32_t hash = name_hash(dir, name, name_len);
+	spinlock_lock(&lock);
+	struct dentry *dentry = find(dir, name, name_len, hash);
+	if (dentry)
+	{
+		dentry->referenced = 1;
+		*child = dentry->child;
+		if (*child)
+			node_ref(*child);
+		stats.hits++;
+		spinlock_unlock(&lock);
+		return *child ? 0 : -ENOENT;
+	}
+	size_t lookup_gen = gen;
+	stats.misses++;
+	spinlock_unlock(&lock);
+	int ret = node_lookup(dir, name, name_len, child);
+	if (ret == -ENOENT)
+		insert(dir, name, name_len, hash, NULL, lookup_gen);
+	else if (!ret)
+		insert(dir, name, name_len, hash, *child, lookup_gen);
+	return ret;
+}
+
+void dcache_invalidate(struct node *dir, const char *name, size_t name_len)
+{
+	if (!is_cacheable(dir) || name_len > DCACHE_NAME_MAX)
+		return;
+	uint32_t hash = name_hash(dir, name, name_len);
+	struct node *old_dir = NULL;
+	struct node *old_child = NULL;
+	spinlock_lock(&lock);
+	gen++;
+	struct dentry *dentry = find(dir, name, name_len, hash);
+	if (dentry)
+	{
+		write_begin();
+		remove_dentry(dentry, &old_dir, &old_child);
+		write_end();
+	}
+	spinlock_unlock(&lock);
+	release(old_dir, old_child);
+}
+
+void dcache_flush(void)
+{
+	struct node *dirs[DCACHE_FLUSH_BATCH];
+	struct node *childs[DCACHE_FLUSH_BATCH];
+	size_t n;
+	do
+	{
+		n = 0;
+		spinlock_lock(&lock);
+		gen++;
+		write_begin();
+		while (n < DCACHE_FLUSH_BATCH && !TAILQ_EMPTY(&lru))
+		{
+			remove_dentry(TAILQ_FIRST(&lru), &dirs[n], &childs[n]);
+			n++;
+		}
+		write_end();
+		spinlock_unlock(&lock);
+		for (size_t i = 0; i < n; ++i)
+			release(dirs[i], childs[i]);
+	} while (n == DCACHE_FLUSH_BATCH);
+}
+
+/*
+ * lockless version of getnode: return -EAGAIN if anything requires the
+ * filesystem (uncached component, symlink, dot, dotdot, ...) or if the
+ * cache was modified during the walk
+ */
+int dcache_getnode(struct node *cwd, const char *path, int flags,
+                   struct node **nodep, struct node **dirp, char **end_fn)
+{
+	if (!path)
+		return -EAGAIN;
+	size_t begin = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+	if (begin & 1)
+		goto miss;
+	if (S_ISDIR(cwd->attr.mode) && cwd->mount)
+		cwd = cwd->mount->root;
+	struct node *node = cwd;
+	uint8_t node_flags = 0;
+	if (S_ISDIR(node->attr.mode))
+		node_flags |= DENTRY_DIR;
+	if (is_cacheable(node))
+		node_flags |= DENTRY_CACHEABLE;
+	struct node *dir = node;
+	const char *dir_path = path;
+	for (;;)
+	{
+		while (*path == '/')
+			path++;
+		if (!*path)
+			break;
+		if (!node
+		 || !(node_flags & DENTRY_DIR)
+		 || !(node_flags & DENTRY_CACHEABLE))
+			goto miss;
+		const char *next_path = strchrnul(path, '/');
+		size_t path_len = next_path - path;
+		if (path_len > DCACHE_NAME_MAX || is_dot(path, path_len))
+			goto miss;
+		struct dentry *dentry = find(node, path, path_len,
+		                             name_hash(node, path, path_len));
+		if (!dentry)
+			goto miss;
+		dentry->referenced = 1;
+		dir = node;
+		dir_path = path;
+		node = dentry->node;
+		node_flags = dentry->flags;
+		path = next_path;
+	}
+	if (node && (node_flags & DENTRY_LNK) && !(flags & VFS_NOFOLLOW))
+		goto miss;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	spinlock_lock(&lock);
+	if (seq != begin)
+	{
+		spinlock_unlock(&lock);
+		goto miss;
+	}
+	/* the entries hold references on the nodes, they can't go away
+	 * until the lock is released
+	 */
+	if (nodep)
+	{
+		*nodep = node;
+		if (node)
+			node_ref(node);
+	}
+	if (dirp)
+	{
+		*dirp = dir;
+		node_ref(dir);
+	}
+	stats.fast_hits++;
+	spinlock_unlock(&lock);
+	if (end_fn)
+		*end_fn = (char*)dir_path;
+	return 0;
+
+miss:
+	__atomic_add_fetch(&stats.fast_misses, 1, __ATOMIC_RELAXED);
+	return -EAGAIN;
+}
+
+static ssize_t dcache_read(struct file *file, struct uio *uio)
+{
+	(void)file;
+	size_t count_before = uio->count;
+	off_t off = uio->off;
+	int ret = uprintf(uio, "entries    : %zu / %u\n"
+	                       "fast hits  : %" PRIu64 "\n"
+	                       "fast misses: %" PRIu64 "\n"
+	                       "hits       : %" PRIu64 "\n"
+	                       "misses     : %" PRIu64 "\n"
+	                       "evictions  : %" PRIu64 "\n",
+	                  count, DCACHE_ENTRIES,
+	                  stats.fast_hits,
+	                  stats.fast_misses,
+	                  stats.hits,
+	                  stats.misses,
+	                  stats.evictions);
+	if (ret < 0)
+		return ret;
+	uio->off = off + count_before - uio->count;
+	return count_before - uio->count;
+}
+
+static const struct file_op dcache_fop =
+{
+	.read = dcache_read,
+};
+
+int dcache_register_sysfs(void)
+{
+	return sysfs_mknode("dcache", 0, 0, 0444, &dcache_fop, NULL);
+}
@@ -65,6 +65,7 @@ static int reg_open(struct file *file, struct node *node);
 static ssize_t reg_read(struct file *file, struct uio *uio);
 static ssize_t reg_write(struct file *file, struct uio *uio);
 static int reg_mmap(struct file *file, struct vm_zone *zone);
+static ssize_t reg_getpage(struct file *file, off_t off, struct page **page);
 static int reg_release(struct node *node);
 static int reg_fault(struct vm_zone *zone, off_t off, struct page **page);
 
@@ -90,7 +91,7 @@ struct fs_type g_ramfs_type =
 {
 	.op = &fs_type_op,
 	.name = "ramfs",
-	.flags = 0,
+	.flags = FS_TYPE_DCACHE,
 };
 
 static const struct node_op dir_op =
@@ -126,6 +127,7 @@ static const struct file_op reg_fop =
 	.write = reg_write,
 	.seek = vfs_common_seek,
 	.mmap = reg_mmap,
+	.getpage = reg_getpage,
 };
 
 static const struct vm_zone_op reg_vm_op =
@@ -495,6 +497,20 @@ static int reg_mmap(struct file *file, struct vm_zone *zone)
 	return 0;
 }
 
+static ssize_t reg_getpage(struct file *file, off_t off, struct page **page)
+{
+	struct ramfs_reg *reg = (struct ramfs_reg*)file->node;
+	if (off < 0)
+		return -EINVAL;
+	if (off >= reg->node.attr.size)
+		return 0;
+	size_t n = PAGE_SIZE - off % PAGE_SIZE;
+	if (n > (size_t)(reg->node.attr.size - off))
+		n = reg->node.attr.size - off;
+	*page = ramfile_getpage(&reg->ramfile, off / PAGE_SIZE, 0);
+	return n;
+}
+
 static int reg_release(struct node *node)
 {
 	struct ramfs_reg *reg = (struct ramfs_reg*)node;
@@ -49,6 +49,7 @@ struct node vfs_root =
 void vfs_init_sma(void)
 {
 	sma_init(&fs_sb_sma, sizeof(struct fs_sb), NULL, NULL, "fs_sb");
+	dcache_init();
 }
 
 static int getnode(struct node *cwd, const char *path, int flags,
@@ -118,6 +119,9 @@ static int getnode(struct node *cwd, const char *path, int flags,
 		while (*path == '/')
 			path++;
 	}
+	int ret = dcache_getnode(cwd, path, flags, node, dir, end_fn);
+	if (ret != -EAGAIN)
+		return ret;
 	node_ref(cwd);
 	resolve_mount(&cwd);
 	node_ref(cwd);
@@ -140,7 +144,7 @@ static int getnode(struct node *cwd, const char *path, int flags,
 			break;
 		if (cwd && S_ISLNK(cwd->attr.mode))
 		{
-			int ret = resolve_symlink(&prv, &cwd, flags, recur_count);
+			ret = resolve_symlink(&prv, &cwd, flags, recur_count);
 			if (ret)
 				return ret;
 		}
@@ -158,7 +162,7 @@ static int getnode(struct node *cwd, const char *path, int flags,
 		const char *next_path = strchrnul(path, '/');
 		size_t path_len = next_path - path;
 		/* XXX vfs_getperm(cwd, R_OK) */
-		int ret = node_lookup(cwd, path, path_len, &nxt);
+		ret = dcache_lookup(cwd, path, path_len, &nxt);
 		if (ret)
 		{
 			if (ret != -ENOENT)
@@ -176,7 +180,7 @@ static int getnode(struct node *cwd, const char *path, int flags,
 		*end_fn = (char*)prv_path;
 	if (!(flags & VFS_NOFOLLOW) && cwd && S_ISLNK(cwd->attr.mode))
 	{
-		int ret = resolve_symlink(&prv, &cwd, flags, recur_count);
+		ret = resolve_symlink(&prv, &cwd, flags, recur_count);
 		if (ret)
 			return ret;
 		/* XXX what about end_fn ? */
@@ -351,6 +355,7 @@ int vfs_mount(struct node *dir, struct node *dev,
 	int ret = type->op->mount(dir, dev, flags, udata, &sb);
 	if (ret)
 		return ret;
+	dcache_flush();
 	TAILQ_INSERT_TAIL(&g_mounts, sb, chain);
 	if (sbp)
 		*sbp = sb;
@@ -504,7 +509,10 @@ int node_mknode(struct node *node, const char *name, size_t name_len,
 {
 	if (!node->op || !node->op->mknode)
 		return -ENOSYS;
-	return node->op->mknode(node, name, name_len, mask, attr, dev);
+	int ret = node->op->mknode(node, name, name_len, mask, attr, dev);
+	if (!ret)
+		dcache_invalidate(node, name, name_len);
+	return ret;
 }
 
 int node_getattr(struct node *node, fs_attr_mask_t mask,
@@ -529,7 +537,10 @@ int node_symlink(struct node *node, const char *name, size_t name_len,
 {
 	if (!node->op || !node->op->symlink)
 		return -ENOSYS;
-	return node->op->symlink(node, name, name_len, target, mask, attr);
+	int ret = node->op->symlink(node, name, name_len, target, mask, attr);
+	if (!ret)
+		dcache_invalidate(node, name, name_len);
+	return ret;
 }
 
 ssize_t node_readlink(struct node *node, struct uio *uio)
@@ -543,21 +554,30 @@ int node_link(struct node *node, struct node *src, const char *name)
 {
 	if (!node->op || !node->op->link)
 		return -ENOSYS;
-	return node->op->link(node, src, name);
+	int ret = node->op->link(node, src, name);
+	if (!ret)
+		dcache_invalidate(node, name, strlen(name));
+	return ret;
 }
 
 int node_unlink(struct node *node, const char *name)
 {
 	if (!node->op || !node->op->unlink)
 		return -ENOSYS;
-	return node->op->unlink(node, name);
+	int ret = node->op->unlink(node, name);
+	if (!ret)
+		dcache_invalidate(node, name, strlen(name));
+	return ret;
 }
 
 int node_rmdir(struct node *node, const char *name)
 {
 	if (!node->op || !node->op->rmdir)
 		return -ENOSYS;
-	return node->op->rmdir(node, name);
+	int ret = node->op->rmdir(node, name);
+	if (!ret)
+		dcache_invalidate(node, name, strlen(name));
+	return ret;
 }
 
 int node_rename(struct node *srcdir, const char *srcname,
@@ -565,7 +585,13 @@ int node_rename(struct node *srcdir, const char *srcname,
 {
 	if (!srcdir->op || !srcdir->op->rename)
 		return -ENOSYS;
-	return srcdir->op->rename(srcdir, srcname, dstdir, dstname);
+	int ret = srcdir->op->rename(srcdir, srcname, dstdir, dstname);
+	if (!ret)
+	{
+		dcache_invalidate(srcdir, srcname, strlen(srcname));
+		dcache_invalidate(dstdir, dstname, strlen(dstname));
+	}
+	return ret;
 }
 
 int node_cache_init(struct node_cache *cache)
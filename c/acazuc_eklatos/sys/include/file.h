@@ -48,11 +48,17 @@
 #define F_WRLCK 1
 #define F_UNLCK 2
 
+#define SPLICE_F_MOVE     (1 << 0)
+#define SPLICE_F_NONBLOCK (1 << 1)
+#define SPLICE_F_MORE     (1 << 2)
+#define SPLICE_F_GIFT     (1 << 3)
+
 struct poll_entry;
 struct vm_space;
 struct vm_zone;
 struct file_op;
 struct node;
+struct page;
 struct sock;
 struct uio;
 
@@ -88,6 +94,10 @@ struct file_op
 	int (*mmap)(struct file *file, struct vm_zone *zone);
 	off_t (*seek)(struct file *file, off_t off, int whence);
 	int (*poll)(struct file *file, struct poll_entry *entry);
+	/* return the page holding off and the number of bytes readable
+	 * from off in it (0 on eof), page is NULL for holes
+	 */
+	ssize_t (*getpage)(struct file *file, off_t off, struct page **page);
 };
 
 int file_fromnode(struct node *node, int flags, struct file **file);
@@ -106,5 +116,8 @@ int file_ioctl(struct file *file, unsigned long request, uintptr_t data);
 int file_mmap(struct file *file, struct vm_zone *zone);
 int file_seek(struct file *file, off_t off, int whence);
 int file_poll(struct file *file, struct poll_entry *entry);
+ssize_t file_getpage(struct file *file, off_t off, struct page **page);
+ssize_t file_splice(struct file *in, off_t *in_off, struct file *out,
+                    off_t *out_off, size_t count, unsigned flags);
 
 #endif
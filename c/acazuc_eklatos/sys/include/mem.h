@@ -46,6 +46,8 @@
 #define VM_MMIO      VM_TYPE(4) /* MMIO (device memory) */
 #define VM_TYPE_MASK VM_TYPE(0xF)
 
+#define VM_LARGE_ALIGN (512 * PAGE_SIZE) /* mappings able to use large pages */
+
 #define MAP_ANONYMOUS     (1 << 0)
 #define MAP_SHARED        (1 << 1)
 #define MAP_PRIVATE       (1 << 2)
@@ -221,6 +223,7 @@ int vm_copystr(struct vm_space *space, char *kstr, const char *ustr,
 
 int pm_alloc_page(struct page **page);
 int pm_alloc_pages(struct page **pages, size_t n);
+int pm_alloc_pages_aligned(struct page **pages, size_t n, size_t align);
 void pm_free_page(struct page *page);
 void pm_free_pages(struct page *page, size_t n);
 void pm_ref_page(struct page *page);
@@ -6,6 +6,7 @@
 
 struct file_op;
 struct file;
+struct uio;
 
 struct pipe
 {
@@ -21,6 +22,9 @@ int pipe_alloc(struct pipe **pipep, struct node *node);
 int fifo_alloc(struct pipe **pipe, struct node **nodep,
                struct file **rfilep, struct file **wfilep);
 void pipe_free(struct pipe *pipe);
+ssize_t pipe_readuio(struct file *file, struct uio *uio, int nonblock);
+ssize_t pipe_writeuio(struct file *file, struct uio *uio, int nonblock);
+ssize_t pipe_wspace(struct file *file, int nonblock);
 
 extern const struct file_op g_pipe_fop;
 
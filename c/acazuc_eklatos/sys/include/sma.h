@@ -1,10 +1,15 @@
 #ifndef SMA_H
 #define SMA_H
 
+#include <spinlock.h>
 #include <queue.h>
 #include <mutex.h>
 #include <types.h>
 
+#define SMA_NOCACHE (1 << 0) /* don't use per-cpu magazines */
+
+struct sma_magazine;
+struct sma_cpu;
 struct node;
 struct uio;
 
@@ -35,6 +40,12 @@ struct sma
 	size_t data_size; /* size of each element */
 	size_t meta_size; /* size of slab struct + bitmap */
 	struct mutex mutex;
+	struct spinlock depot_lock;
+	SLIST_HEAD(, sma_magazine) depot_full; /* magazines ready for alloc */
+	SLIST_HEAD(, sma_magazine) depot_empty; /* magazines ready for free */
+	size_t depot_full_count;
+	struct sma_cpu *cpus[MAXCPU];
+	uint32_t flags;
 	struct node *sysfs_node;
 	struct sma_stats stats;
 	const char *name;
@@ -48,7 +59,9 @@ void *sma_alloc(struct sma *sma, int flags);
 int sma_free(struct sma *sma, void *ptr);
 void *sma_move(struct sma *dst, struct sma *src, void *ptr, int flags);
 int sma_own(struct sma *sma, void *ptr);
+struct sma *sma_lookup(void *ptr);
 int sma_print(struct sma *sma, struct uio *uio);
 void sma_register_sysfs(void);
+void sma_cache_init(void);
 
 #endif
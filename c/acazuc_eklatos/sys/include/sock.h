@@ -29,6 +29,7 @@
 #define AF_PACKET PF_PACKET
 
 #define MSG_DONTWAIT (1 << 0)
+#define MSG_KBUF     (1 << 30) /* internal: msg_iov points to kernel memory */
 
 #define SOCK_STREAM 1
 #define SOCK_DGRAM  2
@@ -88,6 +89,7 @@ struct sock_op
 	int (*setopt)(struct sock *sock, int level, int opt, const void *uval,
 	              socklen_t len);
 	int (*shutdown)(struct sock *sock, int how);
+	ssize_t (*wspace)(struct sock *sock);
 	int (*input)(struct netif *netif, struct netpkt *pkt,
 	             struct sockaddr *src, struct sockaddr *dst);
 };
@@ -140,6 +142,7 @@ int sock_connect(struct sock *sock, const struct sockaddr *addr,
 int sock_listen(struct sock *sock, int backlog);
 ssize_t sock_recv(struct sock *sock, struct msghdr *msg, int flags);
 ssize_t sock_send(struct sock *sock, struct msghdr *msg, int flags);
+ssize_t sock_wspace(struct sock *sock);
 int sock_getopt(struct sock *sock, int level, int opt, void *uval,
                 socklen_t *ulen);
 int sock_setopt(struct sock *sock, int level, int opt, const void *uval,
@@ -161,7 +164,7 @@ static inline void uio_from_msghdr(struct uio *uio, const struct msghdr *msg)
 	for (size_t i = 0; i < uio->iovcnt; ++i)
 		uio->count += uio->iov[i].iov_len;
 	uio->off = 0;
-	uio->userbuf = 1;
+	uio->userbuf = !(msg->msg_flags & MSG_KBUF);
 }
 
 static inline void sock_lock(struct sock *sock)
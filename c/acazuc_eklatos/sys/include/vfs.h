@@ -115,6 +115,8 @@ struct fs_type_op
 	int (*stat)(struct fs_sb *sb, struct statvfs *st);
 };
 
+#define FS_TYPE_DCACHE (1 << 0) /* namespace only modified through node_* */
+
 struct fs_type
 {
 	const struct fs_type_op *op;
@@ -275,6 +277,15 @@ void node_ref(struct node *node);
 void vfs_init_sma(void);
 void vfs_init(void);
 
+void dcache_init(void);
+int dcache_lookup(struct node *dir, const char *name, size_t name_len,
+                  struct node **child);
+void dcache_invalidate(struct node *dir, const char *name, size_t name_len);
+void dcache_flush(void);
+int dcache_getnode(struct node *cwd, const char *path, int flags,
+                   struct node **node, struct node **dir, char **end_fn);
+int dcache_register_sysfs(void);
+
 int vfs_mount(struct node *dir, struct node *dev,
               const struct fs_type *type, unsigned long flags,
               const void *udata, struct fs_sb **sbp);
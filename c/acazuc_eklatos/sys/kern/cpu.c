@@ -196,6 +196,7 @@ static void register_sysfs_nodes(void)
 	arch_register_sysfs();
 	vm_register_sysfs();
 	mounts_register_sysfs();
+	dcache_register_sysfs();
 	multiboot_register_sysfs();
 	procinfo_register_sysfs();
 	loadavg_register_sysfs();
@@ -207,6 +208,7 @@ static void register_sysfs_nodes(void)
 
 static void init_sma(void)
 {
+	sma_cache_init();
 	sock_init();
 	file_init();
 	vm_zone_init();
@@ -8,6 +8,9 @@
 #include <vfs.h>
 #include <uio.h>
 #include <sma.h>
+#include <mem.h>
+
+#define SPLICE_BUF_SIZE (PAGE_SIZE * 4)
 
 static struct sma file_sma;
 
@@ -193,3 +196,199 @@ int file_poll(struct file *file, struct poll_entry *entry)
 		return -ENOSYS;
 	return file->op->poll(file, entry);
 }
+
+ssize_t file_getpage(struct file *file, off_t off, struct page **page)
+{
+	if (!file->op || !file->op->getpage)
+		return -ENOSYS;
+	return file->op->getpage(file, off, page);
+}
+
+static int is_pipe(struct file *file)
+{
+	return file->node && S_ISFIFO(file->node->attr.mode);
+}
+
+static int is_seekable(struct file *file)
+{
+	return file->node && (S_ISREG(file->node->attr.mode)
+	                   || S_ISBLK(file->node->attr.mode));
+}
+
+static ssize_t splice_read(struct file *in, struct uio *uio, int nonblock)
+{
+	if (is_pipe(in))
+		return pipe_readuio(in, uio, nonblock);
+	return file_read(in, uio);
+}
+
+static ssize_t splice_write(struct file *out, off_t *off, void *data,
+                            size_t count, int nonblock)
+{
+	size_t wr = 0;
+	while (wr < count)
+	{
+		struct iovec iov;
+		struct uio uio;
+		uio_fromkbuf(&uio, &iov, (uint8_t*)data + wr, count - wr, *off);
+		ssize_t ret;
+		if (is_pipe(out))
+			ret = pipe_writeuio(out, &uio, nonblock);
+		else
+			ret = file_write(out, &uio);
+		if (ret < 0)
+		{
+			if (wr)
+				break;
+			return ret;
+		}
+		if (!ret)
+			break;
+		*off = uio.off;
+		wr += ret;
+	}
+	return wr;
+}
+
+static ssize_t splice_page(struct file *in, off_t *in_off, struct file *out,
+                           off_t *out_off, size_t count, int nonblock)
+{
+	struct page *page;
+	ssize_t ret = file_getpage(in, *in_off, &page);
+	if (ret <= 0)
+		return ret;
+	if (!page)
+		return -ENOENT;
+	if ((size_t)ret > count)
+		ret = count;
+	void *ptr = vm_map(page, PAGE_SIZE, VM_PROT_R);
+	if (!ptr)
+	{
+		pm_free_page(page);
+		return -ENOMEM;
+	}
+	ret = splice_write(out, out_off, &((uint8_t*)ptr)[*in_off % PAGE_SIZE],
+	                   ret, nonblock);
+	vm_unmap(ptr, PAGE_SIZE);
+	pm_free_page(page);
+	if (ret > 0)
+		*in_off += ret;
+	return ret;
+}
+
+/*
+ * what is read from a stream can't be given back: only read what out can
+ * take, it is then written with blocking writes
+ */
+static ssize_t splice_room(struct file *out, size_t count, int nonblock)
+{
+	ssize_t ret;
+	if (is_seekable(out))
+		return count;
+	if (is_pipe(out))
+	{
+		ret = pipe_wspace(out, nonblock);
+	}
+	else if (out->sock)
+	{
+		if (!nonblock)
+			return count;
+		ret = sock_wspace(out->sock);
+		if (ret == -EOPNOTSUPP)
+			return count;
+		if (!ret)
+			ret = -EAGAIN;
+	}
+	else
+	{
+		if (!out->op || !out->op->write
+		 || (out->node && S_ISDIR(out->node->attr.mode)))
+			return -EINVAL;
+		/* the free space of other sinks isn't known */
+		if (nonblock)
+			return -EAGAIN;
+		return count;
+	}
+	if (ret > 0 && (size_t)ret > count)
+		ret = count;
+	return ret;
+}
+
+static ssize_t splice_copy(struct file *in, off_t *in_off, struct file *out,
+                           off_t *out_off, void *buf, size_t count,
+                           int nonblock)
+{
+	int seekable = is_seekable(in);
+	int in_nonblock = nonblock || (in->flags & O_NONBLOCK);
+	int out_nonblock = nonblock || (out->flags & O_NONBLOCK);
+	ssize_t ret;
+	if (!seekable)
+	{
+		ret = splice_room(out, count, out_nonblock);
+		if (ret <= 0)
+			return ret;
+		count = ret;
+	}
+	struct iovec iov;
+	struct uio uio;
+	uio_fromkbuf(&uio, &iov, buf, count, *in_off);
+	ret = splice_read(in, &uio, in_nonblock);
+	if (ret <= 0)
+		return ret;
+	ret = splice_write(out, out_off, buf, ret, seekable ? out_nonblock : 0);
+	if (ret > 0)
+		*in_off += ret;
+	return ret;
+}
+
+/*
+ * move up to count bytes from in to out without going through userland:
+ * the pages exposed by in are written to out from their kernel mapping,
+ * everything else goes through a bounce buffer
+ *
+ * with SPLICE_F_NONBLOCK, the pipe operations don't block, as if the pipes
+ * were opened with O_NONBLOCK
+ */
+ssize_t file_splice(struct file *in, off_t *in_off, struct file *out,
+                    off_t *out_off, size_t count, unsigned flags)
+{
+	int seekable = is_seekable(in);
+	int nonblock = flags & SPLICE_F_NONBLOCK;
+	void *buf = NULL;
+	size_t total = 0;
+	ssize_t ret = 0;
+	while (total < count)
+	{
+		size_t n = count - total;
+		/* once some data moved, return instead of waiting for a full pipe */
+		int chunk_nonblock = nonblock || total;
+		ret = splice_page(in, in_off, out, out_off, n,
+		                  chunk_nonblock || (out->flags & O_NONBLOCK));
+		if (ret == -ENOSYS || ret == -ENOENT)
+		{
+			if (!buf)
+			{
+				buf = malloc(SPLICE_BUF_SIZE, 0);
+				if (!buf)
+				{
+					ret = -ENOMEM;
+					break;
+				}
+			}
+			if (n > SPLICE_BUF_SIZE)
+				n = SPLICE_BUF_SIZE;
+			ret = splice_copy(in, in_off, out, out_off, buf, n,
+			                  chunk_nonblock);
+		}
+		if (ret <= 0)
+			break;
+		total += ret;
+		/* don't wait for more data on pipes and sockets */
+		if (!seekable)
+			break;
+	}
+	free(buf);
+	if (total)
+		return total;
+	return ret;
+}
@@ -85,6 +85,15 @@ static enum block_type get_block_type(size_t size)
 	return BLOCK_LARGE;
 }
 
+/* size class of an sma allocated pointer, BLOCK_LARGE otherwise */
+static enum block_type get_ptr_type(void *ptr)
+{
+	struct sma *sma = sma_lookup(ptr);
+	if (sma < &g_ctx.sma[0] || sma >= &g_ctx.sma[BLOCK_LARGE])
+		return BLOCK_LARGE;
+	return sma - &g_ctx.sma[0];
+}
+
 static struct large_page *alloc_large_page(size_t size)
 {
 	struct large_page *page;
@@ -172,10 +181,11 @@ void free(void *ptr)
 {
 	if (!ptr)
 		return;
-	for (size_t i = 0; i < sizeof(g_ctx.sma) / sizeof(*g_ctx.sma); ++i)
+	enum block_type type = get_ptr_type(ptr);
+	if (type != BLOCK_LARGE)
 	{
-		if (!sma_free(&g_ctx.sma[i], ptr))
-			return;
+		sma_free(&g_ctx.sma[type], ptr);
+		return;
 	}
 	MALLOC_LOCK();
 	struct large_page *page;
@@ -202,17 +212,18 @@ void *realloc(void *ptr, size_t size, uint32_t flags)
 		return NULL;
 	}
 	enum block_type type = get_block_type(size);
+	enum block_type ptr_type = get_ptr_type(ptr);
 	if (type == BLOCK_LARGE)
 	{
-		for (size_t i = 0; i < sizeof(g_ctx.sma) / sizeof(*g_ctx.sma); ++i)
+		if (ptr_type != BLOCK_LARGE)
 		{
-			if (!sma_own(&g_ctx.sma[i], ptr))
-				continue;
+			MALLOC_LOCK();
 			void *addr = create_new_large_page(size);
+			MALLOC_UNLOCK();
 			if (!addr)
 				return NULL;
-			memcpy(addr, ptr, block_sizes[i]);
-			sma_free(&g_ctx.sma[i], ptr);
+			memcpy(addr, ptr, block_sizes[ptr_type]);
+			sma_free(&g_ctx.sma[ptr_type], ptr);
 			return addr;
 		}
 		MALLOC_LOCK();
@@ -228,13 +239,11 @@ void *realloc(void *ptr, size_t size, uint32_t flags)
 		return NULL;
 	}
 	struct sma *dst_sma = &g_ctx.sma[type];
-	for (size_t i = 0; i < sizeof(g_ctx.sma) / sizeof(*g_ctx.sma); ++i)
+	if (ptr_type != BLOCK_LARGE)
 	{
-		if (!sma_own(&g_ctx.sma[i], ptr))
-			continue;
-		if (i == type)
+		if (ptr_type == type)
 			return ptr;
-		return sma_move(dst_sma, &g_ctx.sma[i], ptr, flags);
+		return sma_move(dst_sma, &g_ctx.sma[ptr_type], ptr, flags);
 	}
 	MALLOC_LOCK();
 	struct large_page *page;
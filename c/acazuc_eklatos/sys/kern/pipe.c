@@ -34,32 +34,74 @@ static struct pipe *getpipe(struct file *file)
 	return file->node->pipe;
 }
 
-static ssize_t pipe_read(struct file *file, struct uio *uio)
+ssize_t pipe_readuio(struct file *file, struct uio *uio, int nonblock)
 {
 	struct pipe *pipe = getpipe(file);
 	if (!pipe)
 		return -EINVAL;
 	ssize_t ret = pipebuf_read(&pipe->pipebuf, uio,
-	                           file->flags & O_NONBLOCK ? 0 : uio->count,
-	                           NULL);
+	                           nonblock ? 0 : uio->count, NULL);
 	if (ret > 0)
 		poller_broadcast(&pipe->poll_entries, POLLOUT);
 	return ret;
 }
 
-static ssize_t pipe_write(struct file *file, struct uio *uio)
+ssize_t pipe_writeuio(struct file *file, struct uio *uio, int nonblock)
 {
 	struct pipe *pipe = getpipe(file);
 	if (!pipe)
 		return -EINVAL;
 	ssize_t ret = pipebuf_write(&pipe->pipebuf, uio,
-	                            file->flags & O_NONBLOCK ? 0 : uio->count,
-	                            NULL);
+	                            nonblock ? 0 : uio->count, NULL);
 	if (ret > 0)
 		poller_broadcast(&pipe->poll_entries, POLLIN);
 	return ret;
 }
 
+/*
+ * bytes that can be written without blocking, waiting for some room
+ * unless nonblock is set
+ */
+ssize_t pipe_wspace(struct file *file, int nonblock)
+{
+	struct pipe *pipe = getpipe(file);
+	if (!pipe)
+		return -EINVAL;
+	ssize_t ret;
+	pipe_lock(pipe);
+	for (;;)
+	{
+		if (!pipe->pipebuf.nreaders)
+		{
+			ret = -EPIPE;
+			break;
+		}
+		ret = ringbuf_write_size(&pipe->pipebuf.ringbuf);
+		if (ret)
+			break;
+		if (nonblock)
+		{
+			ret = -EAGAIN;
+			break;
+		}
+		ret = waitq_wait_tail_mutex(&pipe->wwaitq, &pipe->mutex, NULL);
+		if (ret)
+			break;
+	}
+	pipe_unlock(pipe);
+	return ret;
+}
+
+static ssize_t pipe_read(struct file *file, struct uio *uio)
+{
+	return pipe_readuio(file, uio, file->flags & O_NONBLOCK);
+}
+
+static ssize_t pipe_write(struct file *file, struct uio *uio)
+{
+	return pipe_writeuio(file, uio, file->flags & O_NONBLOCK);
+}
+
 static int pipe_release(struct file *file)
 {
 	struct pipe *pipe = getpipe(file);
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <cpu.h>
 #include <queue.h>
 #include <mutex.h>
 #include <file.h>
@@ -15,12 +16,28 @@
  * an sma_meta is a PAGE_SIZE memory block containing a list of sma_slab
  * an sma_slab is a structure representing a PAGE_SIZE multiple memory block
  * each one of this memory block is containing only payload data
+ *
+ * every slab is registered in a global hash table indexed by its address
+ * so that the slab (and the sma) owning a pointer can be found without
+ * walking the metas
+ *
+ * allocations and frees go through per-cpu magazines first (see Bonwick's
+ * "Magazines and Vmem"): each cpu has a loaded and a previous magazine of
+ * objects, exchanged with the depot of full / empty magazines of the sma
+ * when both are exhausted; only the slabs are protected by the sma mutex
  */
 
 #define BITMAP_BPW (sizeof(size_t) * 8)
 
 #define BITMAP_MIN_SIZE 8 /* must never ever be 1 (it would make no partial / full distinction) */
 
+#define MAGAZINE_SIZE 15 /* objects per magazine */
+#define DEPOT_MAX 8 /* full magazines kept in the depot */
+
+#define SLAB_HASH_SIZE 1024
+
+#define SLAB_META(slab) ((struct sma_meta*)((uintptr_t)(slab) & ~(uintptr_t)PAGE_MASK))
+
 #define SLAB_FIRST(meta) ((struct sma_slab*)&meta->slabs[0])
 
 #define SLAB_FOREACH(slab, meta, sma) \
@@ -38,6 +55,8 @@ enum sma_slab_state
 struct sma_slab
 {
 	uint8_t *addr;
+	struct sma *sma;
+	struct sma_slab *hash_next;
 	TAILQ_ENTRY(sma_slab) chain;
 	enum sma_slab_state state;
 	size_t first_free;
@@ -53,6 +72,33 @@ struct sma_meta
 	uint8_t slabs[];
 };
 
+struct sma_magazine
+{
+	SLIST_ENTRY(sma_magazine) chain;
+	size_t count;
+	void *objs[MAGAZINE_SIZE];
+};
+
+/*
+ * the lock is only contended when a thread is migrated in the middle
+ * of an operation or by an interrupt handler: a failed trylock makes
+ * the operation fall back to the slabs
+ */
+struct sma_cpu
+{
+	struct spinlock lock;
+	struct sma_magazine *loaded;
+	struct sma_magazine *prev;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+struct slab_bucket
+{
+	struct spinlock lock;
+	struct sma_slab *head;
+};
+
 static const char *states_str[] =
 {
 	[SMA_SLAB_EMPTY]   = "EMPTY",
@@ -63,6 +109,11 @@ static const char *states_str[] =
 static struct spinlock sma_list_lock = SPINLOCK_INITIALIZER();
 static TAILQ_HEAD(, sma) sma_list = TAILQ_HEAD_INITIALIZER(sma_list);
 static int sysfs_enabled;
+static struct slab_bucket slab_hash[SLAB_HASH_SIZE];
+static size_t slab_max_pages = 1;
+static struct sma sma_magazine_sma;
+static struct sma sma_cpu_sma;
+static int cache_enabled;
 
 static int create_sysfs(struct sma *sma);
 
@@ -110,6 +161,31 @@ static size_t bitmap_get(struct sma_slab *slab, size_t offset)
 	return slab->bitmap[offset / BITMAP_BPW] & ((size_t)1 << (offset % BITMAP_BPW));
 }
 
+static struct slab_bucket *get_bucket(uintptr_t addr)
+{
+	return &slab_hash[(addr / PAGE_SIZE) % SLAB_HASH_SIZE];
+}
+
+static void hash_insert(struct sma_slab *slab)
+{
+	struct slab_bucket *bucket = get_bucket((uintptr_t)slab->addr);
+	spinlock_lock(&bucket->lock);
+	slab->hash_next = bucket->head;
+	bucket->head = slab;
+	spinlock_unlock(&bucket->lock);
+}
+
+static void hash_remove(struct sma_slab *slab)
+{
+	struct slab_bucket *bucket = get_bucket((uintptr_t)slab->addr);
+	spinlock_lock(&bucket->lock);
+	struct sma_slab **it = &bucket->head;
+	while (*it != slab)
+		it = &(*it)->hash_next;
+	*it = slab->hash_next;
+	spinlock_unlock(&bucket->lock);
+}
+
 static int slab_ctr(struct sma *sma, struct sma_slab *slab)
 {
 	slab->addr = mem_alloc(sma, sma->slab_size);
@@ -121,6 +197,7 @@ static int slab_ctr(struct sma *sma, struct sma_slab *slab)
 		for (size_t i = 0; i < sma->bitmap_count; ++i)
 			sma->ctr(slab->addr + i * sma->data_size, sma->data_size);
 	}
+	hash_insert(slab);
 	sma->stats.nslabs++;
 	return 0;
 }
@@ -132,6 +209,7 @@ static void slab_dtr(struct sma *sma, struct sma_slab *slab)
 		for (size_t i = 0; i < sma->bitmap_count; ++i)
 			sma->dtr(slab->addr + i * sma->data_size, sma->data_size);
 	}
+	hash_remove(slab);
 	void *addr = slab->addr;
 	slab->addr = NULL;
 	mem_free(sma, addr, sma->slab_size);
@@ -150,6 +228,7 @@ static struct sma_meta *sma_meta_new(struct sma *sma)
 	SLAB_FOREACH(slab, meta, sma)
 	{
 		slab->addr = NULL;
+		slab->sma = sma;
 		slab->state = SMA_SLAB_EMPTY;
 		TAILQ_INSERT_TAIL(&meta->slab_empty, slab, chain);
 	}
@@ -175,7 +254,8 @@ static void sma_meta_delete(struct sma *sma, struct sma_meta *meta)
 				TAILQ_REMOVE(&meta->slab_full, slab, chain);
 				break;
 		}
-		slab_dtr(sma, slab);
+		if (slab->addr)
+			slab_dtr(sma, slab);
 	}
 	mem_free(sma, meta, PAGE_SIZE);
 	sma->stats.nmetas--;
@@ -214,29 +294,18 @@ static void check_free_slab(struct sma *sma, struct sma_meta *meta,
 static void update_first_free(struct sma *sma, struct sma_meta *meta,
                               struct sma_slab *slab)
 {
-	for (size_t i = 0; i < sma->bitmap_words; ++i)
+	/* first_free is the lowest free bit, the previous words are full */
+	for (size_t i = slab->first_free / BITMAP_BPW; i < sma->bitmap_words; ++i)
 	{
-		size_t bitmap = slab->bitmap[i];
-		if (bitmap == SIZE_MAX)
-			continue;
+		size_t bitmap = ~slab->bitmap[i];
 		if (!bitmap)
-		{
-			slab->first_free = i * BITMAP_BPW;
-			return;
-		}
-		for (size_t j = 0; j < BITMAP_BPW; ++j)
-		{
-			if (bitmap & ((size_t)1 << j))
-				continue;
-			size_t ret = i * BITMAP_BPW + j;
-			if (ret >= sma->bitmap_count)
-				goto full;
-			slab->first_free = ret;
-			return;
-		}
-		panic("sma '%s': block != SIZE_MAX but no bit found", sma->name);
+			continue;
+		size_t ret = i * BITMAP_BPW + __builtin_ctzl(bitmap);
+		if (ret >= sma->bitmap_count)
+			break;
+		slab->first_free = ret;
+		return;
 	}
-full:
 	TAILQ_REMOVE(&meta->slab_partial, slab, chain);
 	slab->first_free = -1;
 	slab->state = SMA_SLAB_FULL;
@@ -280,7 +349,7 @@ static void *get_free_block(struct sma *sma)
 	return empty_slab->addr;
 }
 
-void *sma_alloc(struct sma *sma, int flags)
+static void *slab_alloc(struct sma *sma)
 {
 	sma_lock(sma);
 	void *addr = get_free_block(sma);
@@ -305,8 +374,6 @@ void *sma_alloc(struct sma *sma, int flags)
 	sma->stats.nalloc++;
 	sma->stats.ncurrent++;
 	sma_unlock(sma);
-	if (flags & M_ZERO)
-		memset(addr, 0, sma->data_size);
 	return addr;
 
 err:
@@ -326,74 +393,279 @@ static int slab_contains(struct sma *sma, struct sma_slab *slab, void *ptr,
 	return 0;
 }
 
-static struct sma_slab *find_ptr_slab(struct sma *sma, void *ptr,
-                                      struct sma_meta **meta, size_t *item)
+/*
+ * the first slab registered at or below the page of ptr is the only
+ * one which can contain it
+ */
+static struct sma_slab *find_ptr_slab(void *ptr, size_t *item)
 {
-	struct sma_slab *slab;
-	TAILQ_FOREACH(*meta, &sma->meta, chain)
+	uintptr_t addr = (uintptr_t)ptr & ~(uintptr_t)PAGE_MASK;
+	size_t max_pages = __atomic_load_n(&slab_max_pages, __ATOMIC_RELAXED);
+	for (size_t i = 0; i < max_pages && addr; ++i, addr -= PAGE_SIZE)
 	{
-		TAILQ_FOREACH(slab, &(*meta)->slab_partial, chain)
+		struct slab_bucket *bucket = get_bucket(addr);
+		struct sma_slab *slab;
+		spinlock_lock(&bucket->lock);
+		for (slab = bucket->head; slab; slab = slab->hash_next)
 		{
-			if (!slab_contains(sma, slab, ptr, item))
-				return slab;
+			if ((uintptr_t)slab->addr == addr)
+				break;
 		}
-		TAILQ_FOREACH(slab, &(*meta)->slab_full, chain)
+		if (slab)
 		{
-			if (!slab_contains(sma, slab, ptr, item))
-				return slab;
+			if (slab_contains(slab->sma, slab, ptr, item))
+				slab = NULL;
+			spinlock_unlock(&bucket->lock);
+			return slab;
 		}
+		spinlock_unlock(&bucket->lock);
 	}
 	return NULL;
 }
 
-int sma_free(struct sma *sma, void *ptr)
+static void slab_free(struct sma *sma, struct sma_slab *slab, size_t item)
 {
-	struct sma_meta *meta;
-	struct sma_slab *slab;
-	size_t item;
-
-	if (!ptr)
-		return -EINVAL;
-	sma_lock(sma);
-	slab = find_ptr_slab(sma, ptr, &meta, &item);
-	if (!slab)
-	{
-		sma_unlock(sma);
-		return -EINVAL;
-	}
+	void *ptr = slab->addr + item * sma->data_size;
 	if (!bitmap_get(slab, item))
 		panic("sma '%s': double free %p\n", sma->name, ptr);
 	bitmap_clr(slab, item);
 	if (item < slab->first_free)
 		slab->first_free = item;
-	check_free_slab(sma, meta, slab);
+	check_free_slab(sma, SLAB_META(slab), slab);
 	sma->stats.nfree++;
 	sma->stats.ncurrent--;
+}
+
+/* give the objects of the magazine back to their slabs */
+static void magazine_flush(struct sma *sma, struct sma_magazine *mag)
+{
+	sma_lock(sma);
+	for (size_t i = 0; i < mag->count; ++i)
+	{
+		size_t item;
+		struct sma_slab *slab = find_ptr_slab(mag->objs[i], &item);
+		slab_free(sma, slab, item);
+	}
+	mag->count = 0;
 	sma_unlock(sma);
+}
+
+static struct sma_cpu *get_cpu_cache(struct sma *sma)
+{
+	if (!__atomic_load_n(&cache_enabled, __ATOMIC_ACQUIRE)
+	 || (sma->flags & SMA_NOCACHE))
+		return NULL;
+	struct sma_cpu **cachep = &sma->cpus[curcpu()->id];
+	struct sma_cpu *cache = __atomic_load_n(cachep, __ATOMIC_ACQUIRE);
+	if (cache)
+		return cache;
+	cache = sma_alloc(&sma_cpu_sma, M_ZERO);
+	if (!cache)
+		return NULL;
+	struct sma_cpu *expected = NULL;
+	if (!__atomic_compare_exchange_n(cachep, &expected, cache, 0,
+	                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		sma_free(&sma_cpu_sma, cache);
+		return expected;
+	}
+	return cache;
+}
+
+static void *cache_alloc(struct sma *sma)
+{
+	struct sma_cpu *cache = get_cpu_cache(sma);
+	if (!cache || !spinlock_trylock(&cache->lock))
+		return NULL;
+	while (1)
+	{
+		struct sma_magazine *mag = cache->loaded;
+		if (mag && mag->count)
+		{
+			void *addr = mag->objs[--mag->count];
+			cache->hits++;
+			spinlock_unlock(&cache->lock);
+			return addr;
+		}
+		if (cache->prev && cache->prev->count)
+		{
+			cache->loaded = cache->prev;
+			cache->prev = mag;
+			continue;
+		}
+		spinlock_lock(&sma->depot_lock);
+		struct sma_magazine *full = SLIST_FIRST(&sma->depot_full);
+		if (!full)
+		{
+			spinlock_unlock(&sma->depot_lock);
+			break;
+		}
+		SLIST_REMOVE_HEAD(&sma->depot_full, chain);
+		sma->depot_full_count--;
+		if (cache->prev)
+			SLIST_INSERT_HEAD(&sma->depot_empty, cache->prev, chain);
+		spinlock_unlock(&sma->depot_lock);
+		cache->prev = mag;
+		cache->loaded = full;
+	}
+	cache->misses++;
+	spinlock_unlock(&cache->lock);
+	return NULL;
+}
+
+/*
+ * store ptr in the cpu magazines, exchanging them with the depot if
+ * required; return -ENOMEM if the depot has no empty magazine or
+ * -ENOSPC if it can't take the full one
+ */
+static int magazine_push(struct sma *sma, struct sma_cpu *cache, void *ptr)
+{
+	struct sma_magazine *mag = cache->loaded;
+	if (mag && mag->count < MAGAZINE_SIZE)
+		goto push;
+	if (cache->prev && cache->prev->count < MAGAZINE_SIZE)
+	{
+		cache->loaded = cache->prev;
+		cache->prev = mag;
+		goto push;
+	}
+	spinlock_lock(&sma->depot_lock);
+	if (cache->prev && sma->depot_full_count >= DEPOT_MAX)
+	{
+		spinlock_unlock(&sma->depot_lock);
+		return -ENOSPC;
+	}
+	struct sma_magazine *empty = SLIST_FIRST(&sma->depot_empty);
+	if (!empty)
+	{
+		spinlock_unlock(&sma->depot_lock);
+		return -ENOMEM;
+	}
+	SLIST_REMOVE_HEAD(&sma->depot_empty, chain);
+	if (cache->prev)
+	{
+		SLIST_INSERT_HEAD(&sma->depot_full, cache->prev, chain);
+		sma->depot_full_count++;
+	}
+	spinlock_unlock(&sma->depot_lock);
+	cache->prev = mag;
+	cache->loaded = empty;
+
+push:
+	cache->loaded->objs[cache->loaded->count++] = ptr;
 	return 0;
 }
 
-void *sma_move(struct sma *dst, struct sma *src, void *ptr, int flags)
+static int cache_free(struct sma *sma, void *ptr)
+{
+	struct sma_cpu *cache = get_cpu_cache(sma);
+	if (!cache || !spinlock_trylock(&cache->lock))
+		return -EAGAIN;
+	int ret = magazine_push(sma, cache, ptr);
+	if (!ret)
+	{
+		cache->hits++;
+		spinlock_unlock(&cache->lock);
+		return 0;
+	}
+	cache->misses++;
+	/*
+	 * the slabs and the magazines allocation may sleep: the cpu lock
+	 * is released to get an empty magazine before trying again
+	 */
+	struct sma_magazine *mag;
+	if (ret == -ENOSPC)
+	{
+		mag = cache->prev;
+		cache->prev = NULL;
+		spinlock_unlock(&cache->lock);
+		magazine_flush(sma, mag);
+	}
+	else
+	{
+		spinlock_unlock(&cache->lock);
+		mag = sma_alloc(&sma_magazine_sma, 0);
+		if (!mag)
+			return -ENOMEM;
+		mag->count = 0;
+	}
+	spinlock_lock(&sma->depot_lock);
+	SLIST_INSERT_HEAD(&sma->depot_empty, mag, chain);
+	spinlock_unlock(&sma->depot_lock);
+	if (!spinlock_trylock(&cache->lock))
+		return -EAGAIN;
+	ret = magazine_push(sma, cache, ptr);
+	spinlock_unlock(&cache->lock);
+	return ret;
+}
+
+static void cache_destroy(struct sma *sma)
+{
+	struct sma_magazine *mag;
+	for (size_t i = 0; i < MAXCPU; ++i)
+	{
+		struct sma_cpu *cache = sma->cpus[i];
+		if (!cache)
+			continue;
+		if (cache->loaded)
+			sma_free(&sma_magazine_sma, cache->loaded);
+		if (cache->prev)
+			sma_free(&sma_magazine_sma, cache->prev);
+		sma_free(&sma_cpu_sma, cache);
+		sma->cpus[i] = NULL;
+	}
+	while ((mag = SLIST_FIRST(&sma->depot_full)))
+	{
+		SLIST_REMOVE_HEAD(&sma->depot_full, chain);
+		sma_free(&sma_magazine_sma, mag);
+	}
+	while ((mag = SLIST_FIRST(&sma->depot_empty)))
+	{
+		SLIST_REMOVE_HEAD(&sma->depot_empty, chain);
+		sma_free(&sma_magazine_sma, mag);
+	}
+	sma->depot_full_count = 0;
+}
+
+void *sma_alloc(struct sma *sma, int flags)
+{
+	void *addr = cache_alloc(sma);
+	if (!addr)
+	{
+		addr = slab_alloc(sma);
+		if (!addr)
+			return NULL;
+	}
+	if (flags & M_ZERO)
+		memset(addr, 0, sma->data_size);
+	return addr;
+}
+
+int sma_free(struct sma *sma, void *ptr)
 {
 	struct sma_slab *slab;
-	struct sma_meta *meta;
 	size_t item;
 
-	sma_lock(src);
-	slab = find_ptr_slab(src, ptr, &meta, &item);
-	if (!slab)
-	{
-		sma_unlock(src);
+	if (!ptr)
+		return -EINVAL;
+	slab = find_ptr_slab(ptr, &item);
+	if (!slab || slab->sma != sma)
+		return -EINVAL;
+	if (!cache_free(sma, ptr))
+		return 0;
+	sma_lock(sma);
+	slab_free(sma, slab, item);
+	sma_unlock(sma);
+	return 0;
+}
+
+void *sma_move(struct sma *dst, struct sma *src, void *ptr, int flags)
+{
+	if (!sma_own(src, ptr))
 		return NULL;
-	}
-	if (!bitmap_get(slab, item))
-		panic("sma '%s': double free %p\n", src->name, ptr);
 	void *addr = sma_alloc(dst, flags);
 	if (!addr)
-	{
-		sma_unlock(src);
 		return NULL;
-	}
 	if (dst->data_size >= src->data_size)
 	{
 		memcpy(addr, ptr, src->data_size);
@@ -405,25 +677,20 @@ void *sma_move(struct sma *dst, struct sma *src, void *ptr, int flags)
 	{
 		memcpy(addr, ptr, dst->data_size);
 	}
-	bitmap_clr(slab, item);
-	if (item < slab->first_free)
-		slab->first_free = item;
-	src->stats.ncurrent--;
-	check_free_slab(src, meta, slab);
-	sma_unlock(src);
+	sma_free(src, ptr);
 	return addr;
 }
 
 int sma_own(struct sma *sma, void *ptr)
 {
-	struct sma_meta *meta;
-	struct sma_slab *slab;
-	size_t item;
+	return sma_lookup(ptr) == sma;
+}
 
-	sma_lock(sma);
-	slab = find_ptr_slab(sma, ptr, &meta, &item);
-	sma_unlock(sma);
-	return slab != NULL;
+struct sma *sma_lookup(void *ptr)
+{
+	size_t item;
+	struct sma_slab *slab = find_ptr_slab(ptr, &item);
+	return slab ? slab->sma : NULL;
 }
 
 int sma_init(struct sma *sma, size_t data_size, sma_ctr_t ctr, sma_dtr_t dtr,
@@ -452,8 +719,17 @@ int sma_init(struct sma *sma, size_t data_size, sma_ctr_t ctr, sma_dtr_t dtr,
 	sma->slab_size -= sma->slab_size % PAGE_SIZE;
 	memset(&sma->stats, 0, sizeof(sma->stats));
 	mutex_init(&sma->mutex, MUTEX_RECURSIVE);
+	spinlock_init(&sma->depot_lock);
+	SLIST_INIT(&sma->depot_full);
+	SLIST_INIT(&sma->depot_empty);
+	sma->depot_full_count = 0;
+	memset(sma->cpus, 0, sizeof(sma->cpus));
+	sma->flags = 0;
 	sma->name = name;
 	spinlock_lock(&sma_list_lock);
+	if (sma->slab_size / PAGE_SIZE > slab_max_pages)
+		__atomic_store_n(&slab_max_pages, sma->slab_size / PAGE_SIZE,
+		                 __ATOMIC_RELAXED);
 	TAILQ_INSERT_TAIL(&sma_list, sma, chain);
 	if (sysfs_enabled)
 		create_sysfs(sma);
@@ -466,6 +742,7 @@ void sma_destroy(struct sma *sma)
 	spinlock_lock(&sma_list_lock);
 	TAILQ_REMOVE(&sma_list, sma, chain);
 	spinlock_unlock(&sma_list_lock);
+	cache_destroy(sma);
 	struct sma_meta *meta, *nxt;
 	TAILQ_FOREACH_SAFE(meta, &sma->meta, chain, nxt)
 		sma_meta_delete(sma, meta);
@@ -592,6 +869,19 @@ int sma_print(struct sma *sma, struct uio *uio)
 	ret = uprintf(uio, "currentp : %" PRIu64 "\n", sma->stats.ncurrentp);
 	if (ret < 0)
 		goto end;
+	ret = uprintf(uio, "depot    : %zu\n", sma->depot_full_count);
+	if (ret < 0)
+		goto end;
+	for (size_t i = 0; i < MAXCPU; ++i)
+	{
+		struct sma_cpu *cache = sma->cpus[i];
+		if (!cache)
+			continue;
+		ret = uprintf(uio, "cpu%-6zu: %" PRIu64 " hits / %" PRIu64 " misses\n",
+		              i, cache->hits, cache->misses);
+		if (ret < 0)
+			goto end;
+	}
 	ret = 0;
 
 end:
@@ -636,6 +926,19 @@ static int create_sysfs(struct sma *sma)
 	return 0;
 }
 
+void sma_cache_init(void)
+{
+	if (sma_init(&sma_magazine_sma, sizeof(struct sma_magazine), NULL, NULL,
+	             "sma_magazine"))
+		panic("failed to create magazine sma\n");
+	sma_magazine_sma.flags |= SMA_NOCACHE;
+	if (sma_init(&sma_cpu_sma, sizeof(struct sma_cpu), NULL, NULL,
+	             "sma_cpu"))
+		panic("failed to create cpu sma\n");
+	sma_cpu_sma.flags |= SMA_NOCACHE;
+	__atomic_store_n(&cache_enabled, 1, __ATOMIC_RELEASE);
+}
+
 void sma_register_sysfs(void)
 {
 	struct sma *sma;
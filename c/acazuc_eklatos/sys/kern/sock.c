@@ -39,7 +39,7 @@ static ssize_t sock_read(struct file *file, struct uio *uio)
 	msg.msg_iovlen = uio->iovcnt;
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
-	msg.msg_flags = 0;
+	msg.msg_flags = uio->userbuf ? 0 : MSG_KBUF;
 	return sock_recv(sock, &msg, 0);
 }
 
@@ -55,7 +55,7 @@ static ssize_t sock_write(struct file *file, struct uio *uio)
 	msg.msg_iovlen = uio->iovcnt;
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
-	msg.msg_flags = 0;
+	msg.msg_flags = uio->userbuf ? 0 : MSG_KBUF;
 	return sock_send(sock, &msg, 0);
 }
 
@@ -234,6 +234,14 @@ ssize_t sock_send(struct sock *sock, struct msghdr *msg, int flags)
 	return sock->op->send(sock, msg, flags);
 }
 
+/* bytes that can be sent without blocking */
+ssize_t sock_wspace(struct sock *sock)
+{
+	if (!sock->op || !sock->op->wspace)
+		return -EOPNOTSUPP;
+	return sock->op->wspace(sock);
+}
+
 int sock_getopt(struct sock *sock, int level, int opt, void *uval,
                 socklen_t *ulen)
 {
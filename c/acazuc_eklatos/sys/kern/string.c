@@ -4,6 +4,9 @@
 #define fillsize(v) ((v) * ((size_t)-1 / 255))
 #define haszero(x) (((x) - fillsize(1)) & ~(x) & fillsize(0x80))
 
+/* amd64 has its own rep movs / rep stos version in arch/amd64/string.S */
+#if !defined(__x86_64__)
+
 void *memset(void *d, int c, size_t n)
 {
 	size_t i = 0;
@@ -46,6 +49,8 @@ void *memcpy(void *d, const void *s, size_t n)
 	return d;
 }
 
+#endif
+
 void *memccpy(void *d, const void *s, int c, size_t n)
 {
 	size_t i = 0;
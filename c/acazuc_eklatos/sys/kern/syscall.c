@@ -383,6 +383,211 @@ ssize_t sys_writev(int fd, const struct iovec *uiov, int iovcnt)
 	return ret;
 }
 
+static int is_pipe(struct file *file)
+{
+	return file->node && S_ISFIFO(file->node->attr.mode);
+}
+
+static ssize_t splice_prepare(struct file *in, struct file *out)
+{
+	ssize_t ret;
+
+	if ((in->flags & 3) == O_WRONLY || (out->flags & 3) == O_RDONLY)
+		return -EBADF;
+	if (is_pipe(in) && in->node == out->node)
+		return -EINVAL;
+	if (out->node && is_node_rofs(out->node))
+		return -EROFS;
+	if (in->node)
+	{
+		ret = update_node_times(in->node, FS_ATTR_ATIME);
+		if (ret < 0 && ret != -EROFS)
+			return ret;
+	}
+	if (out->node)
+	{
+		ret = update_node_times(out->node, FS_ATTR_ATIME
+		                                 | FS_ATTR_CTIME
+		                                 | FS_ATTR_MTIME);
+		if (ret < 0 && ret != -EROFS)
+			return ret;
+	}
+	return 0;
+}
+
+static ssize_t splice_getoff(struct file *file, off_t *uoff, off_t *off)
+{
+	struct thread *thread = curcpu()->thread;
+
+	if (!uoff)
+	{
+		*off = file->off;
+		return 0;
+	}
+	return vm_copyin(thread->proc->vm_space, off, uoff, sizeof(*off));
+}
+
+static ssize_t splice_setoff(struct file *file, off_t *uoff, off_t off)
+{
+	struct thread *thread = curcpu()->thread;
+
+	if (!uoff)
+	{
+		file->off = off;
+		return 0;
+	}
+	return vm_copyout(thread->proc->vm_space, uoff, &off, sizeof(off));
+}
+
+ssize_t sys_sendfile(int out_fd, int in_fd, off_t *uoff, size_t count)
+{
+	struct thread *thread = curcpu()->thread;
+	struct file *in;
+	struct file *out;
+	off_t in_off;
+	off_t out_off;
+	ssize_t ret;
+	ssize_t err;
+
+	ret = proc_getfile(thread->proc, in_fd, &in);
+	if (ret < 0)
+		return ret;
+	ret = proc_getfile(thread->proc, out_fd, &out);
+	if (ret < 0)
+	{
+		file_free(in);
+		return ret;
+	}
+	ret = splice_prepare(in, out);
+	if (ret < 0)
+		goto end;
+	ret = splice_getoff(in, uoff, &in_off);
+	if (ret < 0)
+		goto end;
+	out_off = out->off;
+	ret = file_splice(in, &in_off, out, &out_off, count, 0);
+	if (ret <= 0)
+		goto end;
+	out->off = out_off;
+	err = splice_setoff(in, uoff, in_off);
+	if (err < 0)
+		ret = err;
+
+end:
+	file_free(out);
+	file_free(in);
+	return ret;
+}
+
+ssize_t sys_splice(int in_fd, off_t *uin_off, int out_fd, off_t *uout_off,
+                   size_t count, unsigned flags)
+{
+	struct thread *thread = curcpu()->thread;
+	struct file *in;
+	struct file *out;
+	off_t in_off;
+	off_t out_off;
+	ssize_t ret;
+	ssize_t err;
+
+	if (flags & ~(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE
+	            | SPLICE_F_GIFT))
+		return -EINVAL;
+	ret = proc_getfile(thread->proc, in_fd, &in);
+	if (ret < 0)
+		return ret;
+	ret = proc_getfile(thread->proc, out_fd, &out);
+	if (ret < 0)
+	{
+		file_free(in);
+		return ret;
+	}
+	if (!is_pipe(in) && !is_pipe(out))
+	{
+		ret = -EINVAL;
+		goto end;
+	}
+	if ((uin_off && is_pipe(in)) || (uout_off && is_pipe(out)))
+	{
+		ret = -ESPIPE;
+		goto end;
+	}
+	ret = splice_prepare(in, out);
+	if (ret < 0)
+		goto end;
+	ret = splice_getoff(in, uin_off, &in_off);
+	if (ret < 0)
+		goto end;
+	ret = splice_getoff(out, uout_off, &out_off);
+	if (ret < 0)
+		goto end;
+	ret = file_splice(in, &in_off, out, &out_off, count, flags);
+	if (ret <= 0)
+		goto end;
+	err = splice_setoff(in, uin_off, in_off);
+	if (err < 0)
+		ret = err;
+	err = splice_setoff(out, uout_off, out_off);
+	if (err < 0)
+		ret = err;
+
+end:
+	file_free(out);
+	file_free(in);
+	return ret;
+}
+
+/*
+ * pipes store their data in a ring buffer: the user pages can't be
+ * gifted to it and are copied, as with writev / readv
+ */
+ssize_t sys_vmsplice(int fd, const struct iovec *uiov, size_t iovcnt,
+                     unsigned flags)
+{
+	struct thread *thread = curcpu()->thread;
+	struct iovec iov[IOV_MAX];
+	struct file *file;
+	struct uio uio;
+	ssize_t count;
+	ssize_t ret;
+	int nonblock;
+
+	if (flags & ~(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE
+	            | SPLICE_F_GIFT))
+		return -EINVAL;
+	if (iovcnt > IOV_MAX)
+		return -EINVAL;
+	ret = vm_copyin(thread->proc->vm_space, iov, uiov, sizeof(*iov) * iovcnt);
+	if (ret < 0)
+		return ret;
+	count = 0;
+	for (size_t i = 0; i < iovcnt; ++i)
+	{
+		if (__builtin_add_overflow(count, iov[i].iov_len, &count))
+			return -EINVAL;
+	}
+	ret = proc_getfile(thread->proc, fd, &file);
+	if (ret < 0)
+		return ret;
+	if (!is_pipe(file))
+	{
+		file_free(file);
+		return -EBADF;
+	}
+	uio.iov = iov;
+	uio.iovcnt = iovcnt;
+	uio.count = count;
+	uio.off = 0;
+	uio.userbuf = 1;
+	nonblock = (flags & SPLICE_F_NONBLOCK) || (file->flags & O_NONBLOCK);
+	if ((file->flags & 3) == O_RDONLY)
+		ret = pipe_readuio(file, &uio, nonblock);
+	else
+		ret = pipe_writeuio(file, &uio, nonblock);
+	file_free(file);
+	return ret;
+}
+
 ssize_t sys_openat(int dirfd, const char *upathname, int flags,
                    mode_t mode)
 {
@@ -4192,6 +4397,9 @@ static const struct
 	SYSCALL_DEF(futex),
 	SYSCALL_DEF(times),
 	SYSCALL_DEF(chroot),
+	SYSCALL_DEF(sendfile),
+	SYSCALL_DEF(splice),
+	SYSCALL_DEF(vmsplice),
 	SYSCALL_DEF(sigsuspend),
 	SYSCALL_DEF(sigaltstack),
 	SYSCALL_DEF(madvise),
@@ -26,7 +26,14 @@ int dma_buf_alloc(size_t size, uint32_t flags, struct dma_buf **bufp)
 		return -ENOMEM;
 	buf->npages = npages;
 	buf->size = size;
-	ret = pm_alloc_pages(&buf->pages, npages); /* XXX use DMA_32BIT */
+	/* aligned buffers can be mapped with large pages */
+	if (npages >= VM_LARGE_ALIGN / PAGE_SIZE)
+		ret = pm_alloc_pages_aligned(&buf->pages, npages,
+		                             VM_LARGE_ALIGN / PAGE_SIZE);
+	else
+		ret = -ENOMEM;
+	if (ret)
+		ret = pm_alloc_pages(&buf->pages, npages); /* XXX use DMA_32BIT */
 	if (ret)
 		goto err;
 	buf->data = vm_map(buf->pages, buf->npages * PAGE_SIZE, VM_PROT_RW);
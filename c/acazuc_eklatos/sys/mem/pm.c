@@ -75,9 +75,50 @@ int pm_alloc_page(struct page **page)
 	return -ENOMEM;
 }
 
-int pm_alloc_pages(struct page **page, size_t nb)
+static int bitmap_test(struct pm_pool *pm_pool, size_t off)
+{
+	return (pm_pool->bitmap[off / BITMAP_BPW] >> (off % BITMAP_BPW)) & 1;
+}
+
+static int pool_alloc_pages(struct pm_pool *pm_pool, struct page **page,
+                            size_t nb, size_t align)
+{
+	size_t off = pm_pool->bitmap_first_free;
+	while (1)
+	{
+		size_t misalign = (pm_pool->offset + off) % align;
+		if (misalign)
+			off += align - misalign;
+		if (off + nb > pm_pool->count)
+			return -ENOMEM;
+		/* look for the last used page of the candidate range, the
+		 * next candidate can't start before it
+		 */
+		size_t k = nb;
+		while (k && !bitmap_test(pm_pool, off + k - 1))
+			k--;
+		if (!k)
+			break;
+		off += k;
+	}
+	for (size_t k = 0; k < nb; ++k)
+	{
+		size_t v = off + k;
+		assert(!refcount_get(&pm_pool->pages[v].refcount), "allocating referenced page\n");
+		pm_ref_page(&pm_pool->pages[v]);
+		pm_pool->bitmap[v / BITMAP_BPW] |= ((size_t)1 << (v % BITMAP_BPW));
+	}
+	if (pm_pool->bitmap_first_free == off)
+		update_pm_bitmap_first_free(pm_pool, off + nb);
+	*page = &pm_pool->pages[off];
+	pm_pool->used += nb;
+	return 0;
+}
+
+/* align is a page count, the first page offset is a multiple of it */
+int pm_alloc_pages_aligned(struct page **page, size_t nb, size_t align)
 {
-	if (!nb)
+	if (!nb || !align)
 		return -EINVAL;
 	struct pm_pool *pm_pool;
 	TAILQ_FOREACH(pm_pool, &pm_pools, chain)
@@ -88,47 +129,19 @@ int pm_alloc_pages(struct page **page, size_t nb)
 			mutex_unlock(&pm_pool->mutex);
 			continue;
 		}
-		for (size_t i = pm_pool->bitmap_first_free / BITMAP_BPW; i < pm_pool->bitmap_size; ++i)
-		{
-			if (pm_pool->bitmap[i] == (size_t)-1)
-				continue;
-			for (size_t j = 0; j < BITMAP_BPW; ++j)
-			{
-				if (pm_pool->bitmap[i] & ((size_t)1 << j))
-					continue;
-				size_t off = i * sizeof(size_t) * 8 + j;
-				for (size_t k = 0; k < nb; ++k)
-				{
-					size_t v = off + k;
-					if (pm_pool->bitmap[v / BITMAP_BPW] & ((size_t)1 << (v % BITMAP_BPW)))
-						goto next_page;
-				}
-				for (size_t k = 0; k < nb; ++k)
-				{
-					size_t v = off + k;
-					assert(!refcount_get(&pm_pool->pages[v].refcount), "allocating referenced page\n");
-					pm_ref_page(&pm_pool->pages[v]);
-				}
-				for (size_t k = 0; k < nb; ++k)
-				{
-					size_t v = off + k;
-					pm_pool->bitmap[v / BITMAP_BPW] |= ((size_t)1 << (v % BITMAP_BPW));
-				}
-				if (pm_pool->bitmap_first_free == off)
-					update_pm_bitmap_first_free(pm_pool, off + nb);
-				*page = &pm_pool->pages[off];
-				pm_pool->used += nb;
-				mutex_unlock(&pm_pool->mutex);
-				return 0;
-next_page:
-				continue;
-			}
-		}
+		int ret = pool_alloc_pages(pm_pool, page, nb, align);
 		mutex_unlock(&pm_pool->mutex);
+		if (!ret)
+			return 0;
 	}
 	return -ENOMEM;
 }
 
+int pm_alloc_pages(struct page **page, size_t nb)
+{
+	return pm_alloc_pages_aligned(page, nb, 1);
+}
+
 void pm_free_page(struct page *page)
 {
 	if (!page)
@@ -205,6 +205,9 @@ int vm_alloc(struct vm_space *space, uintptr_t addr, off_t off,
 		 * merge them to avoid useless zone allocation
 		 */
 	}
+	/* let large anonymous zones be faulted with large pages */
+	if (!file && !addr && !alignment && size >= VM_LARGE_ALIGN)
+		alignment = VM_LARGE_ALIGN;
 	struct vm_zone *zone = sma_alloc(&vm_zone_sma, 0);
 	if (!zone)
 		return -ENOMEM;
@@ -683,8 +686,12 @@ void *vm_map(struct page *page, size_t size, uint32_t prot)
 {
 	assert(!(size & PAGE_MASK), "vmap unaligned size 0x%zx\n", size);
 	uintptr_t addr;
+	size_t alignment = 0;
+	if (size >= VM_LARGE_ALIGN
+	 && !(pm_page_addr(page) % VM_LARGE_ALIGN))
+		alignment = VM_LARGE_ALIGN;
 	mutex_spinlock(&g_vm_mutex);
-	if (vm_region_alloc(&g_vm_heap, 0, size, 0, &addr))
+	if (vm_region_alloc(&g_vm_heap, 0, size, alignment, &addr))
 	{
 		mutex_unlock(&g_vm_mutex);
 		return NULL;
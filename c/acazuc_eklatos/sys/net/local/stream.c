@@ -149,6 +149,31 @@ end:
 	return ret;
 }
 
+ssize_t pfl_stream_wspace(struct sock *sock)
+{
+	struct sock_pfl_stream *pfl_stream = sock->userdata;
+	struct pipebuf *pipebuf;
+	ssize_t ret;
+
+	sock_lock(sock);
+	if (sock->state != SOCK_ST_CONNECTED)
+	{
+		ret = -ENOTCONN;
+		goto end;
+	}
+	pipebuf = &PAIR_OUTPUT(pfl_stream)->pipebuf;
+	pipebuf_lock(pipebuf);
+	if (pipebuf->nreaders)
+		ret = ringbuf_write_size(&pipebuf->ringbuf);
+	else
+		ret = -EPIPE;
+	pipebuf_unlock(pipebuf);
+
+end:
+	sock_unlock(sock);
+	return ret;
+}
+
 int pfl_stream_bind(struct sock *sock, const struct sockaddr *addr,
                     socklen_t addrlen)
 {
@@ -485,6 +510,7 @@ static const struct sock_op pfl_stream_op =
 	.send = pfl_stream_send,
 	.poll = pfl_stream_poll,
 	.shutdown = pfl_stream_shutdown,
+	.wspace = pfl_stream_wspace,
 };
 
 int pfl_stream_open(int domain, int type, int protocol, struct sock **sock)
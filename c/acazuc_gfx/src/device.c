@@ -3,6 +3,7 @@
 #include "config.h"
 #include "window.h"
 #include <stdlib.h>
+#include <string.h>
 
 #if 0
 # include <stdio.h>
@@ -43,6 +44,8 @@ static bool ctr(struct gfx_device *device, struct gfx_window *window)
 	device->stats.triangles_count = 0;
 	device->stats.points_count = 0;
 	device->stats.lines_count = 0;
+	device->stats.buffer_updates_count = 0;
+	device->stats.buffer_updates_bytes = 0;
 	device->capabilities.constant_alignment = 0;
 	device->capabilities.max_samplers = 0;
 	device->capabilities.max_msaa = 0;
@@ -60,6 +63,8 @@ static void tick(struct gfx_device *device)
 	device->stats.triangles_count = 0;
 	device->stats.points_count = 0;
 	device->stats.lines_count = 0;
+	device->stats.buffer_updates_count = 0;
+	device->stats.buffer_updates_bytes = 0;
 }
 
 const struct gfx_device_vtable gfx_device_vtable =
@@ -116,6 +121,14 @@ void gfx_add_draw_stats(struct gfx_device *device, enum gfx_primitive_type primi
 #endif
 }
 
+void gfx_add_buffer_stats(struct gfx_device *device, uint32_t size)
+{
+#ifndef NDEBUG
+	device->stats.buffer_updates_count++;
+	device->stats.buffer_updates_bytes += size;
+#endif
+}
+
 void gfx_draw_indexed_indirect(struct gfx_device *device, const gfx_buffer_t *buffer, uint32_t count, uint32_t offset)
 {
 	DEVICE_CALL(draw_indexed_indirect, device, buffer, count, offset);
@@ -183,6 +196,7 @@ bool gfx_create_buffer(struct gfx_device *device, gfx_buffer_t *buffer, enum gfx
 
 bool gfx_set_buffer_data(gfx_buffer_t *buffer, const void *data, uint32_t size, uint32_t offset)
 {
+	gfx_add_buffer_stats(buffer->device, size);
 	DEVICE_CALL_RET(bool, set_buffer_data, buffer->device, buffer, data, size, offset);
 }
 
@@ -191,6 +205,113 @@ void gfx_delete_buffer(struct gfx_device *device, gfx_buffer_t *buffer)
 	DEVICE_CALL(delete_buffer, device, buffer);
 }
 
+static uint32_t align_up(uint32_t size, uint32_t alignment)
+{
+	size += alignment - 1;
+	size -= size % alignment;
+	return size;
+}
+
+bool gfx_create_linear_buffer(struct gfx_device *device, gfx_linear_buffer_t *buffer, enum gfx_buffer_type type, uint32_t size, uint32_t reserve)
+{
+	buffer->alignment = device->capabilities.constant_alignment;
+	if (!buffer->alignment)
+		buffer->alignment = 16;
+	buffer->reserve = align_up(reserve, buffer->alignment);
+	size = align_up(size, buffer->alignment);
+	if (size < buffer->reserve)
+		size = buffer->reserve;
+	buffer->shadow = NULL;
+	buffer->data = NULL;
+	buffer->offset = 0;
+	buffer->flushed = 0;
+	buffer->required = 0;
+	if (!gfx_create_buffer(device, &buffer->buffer, type, NULL, size, GFX_BUFFER_STREAM))
+		return false;
+	if (buffer->buffer.map)
+	{
+		buffer->data = buffer->buffer.map;
+	}
+	else
+	{
+		buffer->shadow = GFX_MALLOC(size);
+		if (!buffer->shadow)
+		{
+			gfx_delete_buffer(device, &buffer->buffer);
+			return false;
+		}
+		buffer->data = buffer->shadow;
+	}
+	return true;
+}
+
+void gfx_delete_linear_buffer(struct gfx_device *device, gfx_linear_buffer_t *buffer)
+{
+	if (!buffer)
+		return;
+	gfx_delete_buffer(device, &buffer->buffer);
+	GFX_FREE(buffer->shadow);
+	buffer->shadow = NULL;
+	buffer->data = NULL;
+}
+
+bool gfx_linear_buffer_begin(gfx_linear_buffer_t *buffer)
+{
+	uint32_t required = buffer->required + buffer->reserve;
+	buffer->offset = 0;
+	buffer->flushed = 0;
+	buffer->required = 0;
+	if (required <= buffer->buffer.size)
+		return true;
+	struct gfx_device *device = buffer->buffer.device;
+	enum gfx_buffer_type type = buffer->buffer.type;
+	uint32_t size = buffer->buffer.size;
+	while (size < required)
+		size *= 2;
+	gfx_delete_linear_buffer(device, buffer);
+	buffer->buffer = GFX_BUFFER_INIT();
+	return gfx_create_linear_buffer(device, buffer, type, size, buffer->reserve);
+}
+
+void *gfx_linear_buffer_alloc(gfx_linear_buffer_t *buffer, uint32_t size, uint32_t *offset)
+{
+	size = align_up(size, buffer->alignment);
+	buffer->required += size;
+	if (!buffer->data)
+		return NULL;
+	uint32_t end = buffer->offset + (size > buffer->reserve ? size : buffer->reserve);
+	if (end > buffer->buffer.size)
+		return NULL;
+	*offset = buffer->offset;
+	buffer->offset += size;
+	if (!buffer->shadow)
+		gfx_add_buffer_stats(buffer->buffer.device, size);
+	return &buffer->data[*offset];
+}
+
+bool gfx_linear_buffer_push(gfx_linear_buffer_t *buffer, const void *data, uint32_t size, uint32_t *offset)
+{
+	void *dst = gfx_linear_buffer_alloc(buffer, size, offset);
+	if (!dst)
+		return false;
+	memcpy(dst, data, size);
+	return true;
+}
+
+void gfx_linear_buffer_flush(gfx_linear_buffer_t *buffer)
+{
+	if (!buffer->shadow || buffer->flushed == buffer->offset)
+		return;
+	gfx_set_buffer_data(&buffer->buffer, &buffer->shadow[buffer->flushed], buffer->offset - buffer->flushed, buffer->flushed);
+	buffer->flushed = buffer->offset;
+}
+
+void gfx_bind_linear_constant(struct gfx_device *device, uint32_t bind, gfx_linear_buffer_t *buffer, uint32_t size, uint32_t offset)
+{
+	gfx_linear_buffer_flush(buffer);
+	DEVICE_CALL(bind_constant, device, bind, &buffer->buffer, size, offset);
+}
+
 bool gfx_create_attributes_state(struct gfx_device *device, gfx_attributes_state_t *state, const struct gfx_attribute_bind *binds, uint32_t count, const gfx_buffer_t *index_buffer, enum gfx_index_type index_type)
 {
 	DEVICE_CALL_RET(bool, create_attributes_state, device, state, binds, count, index_buffer, index_type);
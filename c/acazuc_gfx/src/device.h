@@ -20,6 +20,8 @@ struct gfx_device_stats
 	uint32_t triangles_count;
 	uint32_t points_count;
 	uint32_t lines_count;
+	uint32_t buffer_updates_count;
+	uint32_t buffer_updates_bytes;
 };
 
 struct gfx_device_capabilities
@@ -39,6 +41,7 @@ struct gfx_device
 };
 
 void gfx_add_draw_stats(struct gfx_device *device, enum gfx_primitive_type primitive, uint32_t count, uint32_t prim_count);
+void gfx_add_buffer_stats(struct gfx_device *device, uint32_t size);
 
 void gfx_device_delete(struct gfx_device *device);
 void gfx_device_tick(struct gfx_device *device);
@@ -67,6 +70,14 @@ bool gfx_create_buffer(struct gfx_device *device, gfx_buffer_t *buffer, enum gfx
 bool gfx_set_buffer_data(gfx_buffer_t *buffer, const void *data, uint32_t size, uint32_t offset);
 void gfx_delete_buffer(struct gfx_device *device, gfx_buffer_t *buffer);
 
+bool gfx_create_linear_buffer(struct gfx_device *device, gfx_linear_buffer_t *buffer, enum gfx_buffer_type type, uint32_t size, uint32_t reserve);
+void gfx_delete_linear_buffer(struct gfx_device *device, gfx_linear_buffer_t *buffer);
+bool gfx_linear_buffer_begin(gfx_linear_buffer_t *buffer);
+void *gfx_linear_buffer_alloc(gfx_linear_buffer_t *buffer, uint32_t size, uint32_t *offset);
+bool gfx_linear_buffer_push(gfx_linear_buffer_t *buffer, const void *data, uint32_t size, uint32_t *offset);
+void gfx_linear_buffer_flush(gfx_linear_buffer_t *buffer);
+void gfx_bind_linear_constant(struct gfx_device *device, uint32_t bind, gfx_linear_buffer_t *buffer, uint32_t size, uint32_t offset);
+
 bool gfx_create_attributes_state(struct gfx_device *device, gfx_attributes_state_t *state, const struct gfx_attribute_bind *binds, uint32_t count, const gfx_buffer_t *index_buffer, enum gfx_index_type index_type);
 void gfx_bind_attributes_state(struct gfx_device *device, const gfx_attributes_state_t *state, const gfx_input_layout_t *input_layout);
 void gfx_delete_attributes_state(struct gfx_device *device, gfx_attributes_state_t *state);
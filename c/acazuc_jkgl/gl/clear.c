@@ -15,6 +15,9 @@ static void clear_depth(void)
 {
 	for (GLsizei i = 0; i < g_ctx->width * g_ctx->height; ++i)
 		g_ctx->depth_buffer[i] = g_ctx->clear_depth;
+	for (GLsizei i = 0; i < g_ctx->hiz_width * g_ctx->hiz_height; ++i)
+		g_ctx->hiz_buffer[i] = g_ctx->clear_depth;
+	g_ctx->hiz_valid = GL_TRUE;
 }
 
 static void clear_stencil(void)
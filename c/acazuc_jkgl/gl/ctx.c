@@ -109,11 +109,15 @@ struct gl_ctx *gl_ctx_new(void)
 	ctx->immediate.vert_len = 0;
 	ctx->immediate.vert_pos = 0;
 	ctx->vs.fn = fixed_vertex_shader;
+	ctx->vs.batch_fn = fixed_vertex_shader_batch;
 	ctx->vs.attr_nb = VERT_ATTR_NZ + 1;
 	ctx->vs.varying_nb = VERT_VARYING_FOG + 1;
 	ctx->fs.fn = fixed_fragment_shader;
 	ctx->fs.varying_nb = VERT_VARYING_FOG + 1;
 	ctx->dirty = -1;
+	const char *threads = getenv("JKGL_THREADS");
+	if (!rast_bin_init(ctx, threads ? strtoul(threads, NULL, 10) : 1))
+		rast_bin_init(ctx, 1);
 #ifdef ENABLE_GCCJIT
 	ctx->jit.ctx = gcc_jit_context_acquire();
 	assert(ctx->jit.ctx);
@@ -220,3 +224,12 @@ void gl_ctx_set(struct gl_ctx *new_ctx)
 {
 	g_ctx = new_ctx;
 }
+
+GLboolean gl_ctx_set_threads(struct gl_ctx *ctx, GLuint threads)
+{
+	rast_bin_destroy(ctx);
+	if (rast_bin_init(ctx, threads))
+		return GL_TRUE;
+	rast_bin_init(ctx, 1);
+	return GL_FALSE;
+}
@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 #include <limits.h>
 #include <math.h>
 
@@ -209,8 +210,62 @@ static void get_normal(struct vert *vert, GLint pos)
 	}
 }
 
-static void get_vert(struct vert *vert, GLint pos)
+static GLint get_indice(GLsizei n)
+{
+	if (!g_ctx->indices)
+		return n;
+	switch (g_ctx->indice_type)
+	{
+		case GL_UNSIGNED_BYTE:
+			return ((const GLubyte*)g_ctx->indices)[n];
+		case GL_UNSIGNED_SHORT:
+			return ((const GLushort*)g_ctx->indices)[n];
+		case GL_UNSIGNED_INT:
+			return ((const GLuint*)g_ctx->indices)[n];
+		default:
+			assert(!"unknown indice type");
+			return 0;
+	}
+}
+
+static void fetch_list_vert(struct vert *vert, GLint pos)
 {
+	const GLfloat *src = &g_ctx->vert_cache.list_verts[pos * LIST_VERT_SIZE];
+	GLuint inherit = src[LIST_VERT_ATTRS];
+
+	memcpy(vert->attr, src, sizeof(*vert->attr) * LIST_VERT_ATTRS);
+	if (!inherit)
+		return;
+	if (inherit & LIST_ATTR_COLOR)
+	{
+		vert->attr[VERT_ATTR_R] = g_ctx->immediate.color[0];
+		vert->attr[VERT_ATTR_G] = g_ctx->immediate.color[1];
+		vert->attr[VERT_ATTR_B] = g_ctx->immediate.color[2];
+		vert->attr[VERT_ATTR_A] = g_ctx->immediate.color[3];
+	}
+	if (inherit & LIST_ATTR_TEX_COORD)
+	{
+		vert->attr[VERT_ATTR_S] = g_ctx->immediate.tex_coord[0];
+		vert->attr[VERT_ATTR_T] = g_ctx->immediate.tex_coord[1];
+		vert->attr[VERT_ATTR_P] = g_ctx->immediate.tex_coord[2];
+		vert->attr[VERT_ATTR_Q] = g_ctx->immediate.tex_coord[3];
+	}
+	if (inherit & LIST_ATTR_NORMAL)
+	{
+		vert->attr[VERT_ATTR_NX] = g_ctx->immediate.normal[0];
+		vert->attr[VERT_ATTR_NY] = g_ctx->immediate.normal[1];
+		vert->attr[VERT_ATTR_NZ] = g_ctx->immediate.normal[2];
+	}
+}
+
+static void fetch_vert(struct vert *vert, GLint pos)
+{
+	vert->front_face = GL_FALSE;
+	if (g_ctx->vert_cache.list_verts)
+	{
+		fetch_list_vert(vert, pos);
+		return;
+	}
 	get_pos(vert, pos);
 	if (g_ctx->color_array.enabled)
 	{
@@ -244,26 +299,85 @@ static void get_vert(struct vert *vert, GLint pos)
 		vert->attr[VERT_ATTR_NY] = 0;
 		vert->attr[VERT_ATTR_NZ] = 0;
 	}
-	g_ctx->vs.fn(vert);
-	rast_normalize_vert(vert);
 }
 
-static GLint get_indice(GLsizei n)
+static void reset_cache(GLint min, GLint max)
 {
-	if (!g_ctx->indices)
-		return n;
-	switch (g_ctx->indice_type)
+	struct vert_cache *cache = &g_ctx->vert_cache;
+
+	for (GLuint i = 0; i < VERT_CACHE_BLOCKS; ++i)
+		cache->blocks[i].block = -1;
+	cache->min = min;
+	cache->max = max;
+	cache->last = 0;
+	cache->next = 0;
+}
+
+static struct vert_cache_block *load_block(GLint id)
+{
+	struct vert_cache *cache = &g_ctx->vert_cache;
+	struct vert_cache_block *block = &cache->blocks[cache->next];
+	GLint first = maxi(id * VERT_BATCH_SIZE, cache->min);
+	GLint last = mini((id + 1) * VERT_BATCH_SIZE, cache->max + 1);
+	struct vert *verts = &block->verts[first - id * VERT_BATCH_SIZE];
+	GLsizei count = last - first;
+
+	block->block = id;
+	cache->last = cache->next;
+	cache->next = (cache->next + 1) % VERT_CACHE_BLOCKS;
+	for (GLsizei i = 0; i < count; ++i)
+		fetch_vert(&verts[i], first + i);
+	if (g_ctx->vs.batch_fn)
 	{
-		case GL_UNSIGNED_BYTE:
-			return ((const GLubyte*)g_ctx->indices)[n];
-		case GL_UNSIGNED_SHORT:
-			return ((const GLushort*)g_ctx->indices)[n];
-		case GL_UNSIGNED_INT:
-			return ((const GLuint*)g_ctx->indices)[n];
-		default:
-			assert(!"unknown indice type");
-			return 0;
+		g_ctx->vs.batch_fn(verts, count);
+	}
+	else
+	{
+		for (GLsizei i = 0; i < count; ++i)
+			g_ctx->vs.fn(&verts[i]);
+	}
+	for (GLsizei i = 0; i < count; ++i)
+		rast_normalize_vert(&verts[i]);
+	return block;
+}
+
+static void copy_vert(struct vert *dst, const struct vert *src)
+{
+	dst->front_face = src->front_face;
+	dst->x = src->x;
+	dst->y = src->y;
+	dst->z = src->z;
+	dst->w = src->w;
+	memcpy(dst->attr, src->attr, sizeof(*dst->attr) * g_ctx->vs.attr_nb);
+	memcpy(dst->varying, src->varying,
+	       sizeof(*dst->varying) * g_ctx->vs.varying_nb);
+}
+
+static void get_vert(struct vert *vert, GLint pos)
+{
+	struct vert_cache *cache = &g_ctx->vert_cache;
+	struct vert_cache_block *block = NULL;
+	GLint id = pos / VERT_BATCH_SIZE;
+
+	if (cache->blocks[cache->last].block == id)
+	{
+		block = &cache->blocks[cache->last];
 	}
+	else
+	{
+		for (GLuint i = 0; i < VERT_CACHE_BLOCKS; ++i)
+		{
+			if (cache->blocks[i].block == id)
+			{
+				block = &cache->blocks[i];
+				cache->last = i;
+				break;
+			}
+		}
+		if (!block)
+			block = load_block(id);
+	}
+	copy_vert(vert, &block->verts[pos % VERT_BATCH_SIZE]);
 }
 
 static void points(GLsizei first, GLsizei count)
@@ -284,10 +398,10 @@ static void line_strip(GLsizei first, GLsizei count)
 	struct vert v2;
 	GLsizei n = first;
 
-	get_vert(&v1, n++);
+	get_vert(&v1, get_indice(n++));
 	for (GLsizei i = 1; i < count; i++)
 	{
-		get_vert(&v2, get_indice(i++));
+		get_vert(&v2, get_indice(n++));
 		rast_line(&v1, &v2);
 		v1 = v2;
 	}
@@ -487,6 +601,95 @@ static GLboolean update_jit(void)
 	return GL_TRUE;
 }
 
+static void indices_range(GLsizei count, GLint *min, GLint *max)
+{
+	*min = INT_MAX;
+	*max = 0;
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		GLint indice = get_indice(i);
+		*min = mini(*min, indice);
+		*max = maxi(*max, indice);
+	}
+}
+
+static void draw(GLenum mode, GLsizei first, GLsizei count)
+{
+	GLint min;
+	GLint max;
+
+	if (!update_jit())
+		return;
+	if (g_ctx->indices)
+	{
+		indices_range(count, &min, &max);
+	}
+	else
+	{
+		min = first;
+		max = first + count - 1;
+	}
+	reset_cache(min, max);
+	primitive(mode, first, count);
+	rast_bin_flush();
+}
+
+/*
+ * the referenced vertexes are stored converted to floats, indices are
+ * rebased on the first one
+ */
+static GLboolean record_draw(GLenum mode, GLsizei first, GLsizei count)
+{
+	GLboolean exec = g_ctx->list_compile.mode == GL_COMPILE_AND_EXECUTE;
+	GLsizei verts_first;
+	GLsizei indices_first;
+	GLfloat *verts;
+	GLuint *indices;
+	struct vert vert;
+	GLint min;
+	GLint max;
+
+	if (g_ctx->indices)
+	{
+		indices_range(count, &min, &max);
+	}
+	else
+	{
+		min = first;
+		max = first + count - 1;
+	}
+	verts = list_alloc_verts(max - min + 1, &verts_first);
+	if (!verts)
+		return exec;
+	for (GLint i = min; i <= max; ++i)
+	{
+		GLfloat *dst = &verts[(i - min) * LIST_VERT_SIZE];
+		fetch_vert(&vert, i);
+		memcpy(dst, vert.attr, sizeof(*dst) * LIST_VERT_ATTRS);
+		dst[LIST_VERT_ATTRS] = 0;
+	}
+	if (!g_ctx->indices)
+		return list_record_draw(mode, verts_first, count, -1);
+	indices = list_alloc_indices(count, &indices_first);
+	if (!indices)
+		return exec;
+	for (GLsizei i = 0; i < count; ++i)
+		indices[i] = get_indice(i) - min;
+	return list_record_draw(mode, verts_first, count, indices_first);
+}
+
+void draw_list(GLenum mode, const GLfloat *verts, const GLuint *indices,
+               GLsizei count)
+{
+	if (!count)
+		return;
+	g_ctx->vert_cache.list_verts = verts;
+	g_ctx->indices = indices;
+	g_ctx->indice_type = GL_UNSIGNED_INT;
+	draw(mode, 0, count);
+	g_ctx->vert_cache.list_verts = NULL;
+}
+
 void glDrawElements(GLenum mode, GLsizei count, GLenum type,
                     const GLvoid *indices)
 {
@@ -499,11 +702,11 @@ void glDrawElements(GLenum mode, GLsizei count, GLenum type,
 		return;
 	if (!count)
 		return;
-	if (!update_jit())
-		return;
 	g_ctx->indices = indices;
 	g_ctx->indice_type = type;
-	primitive(mode, 0, count);
+	if (g_ctx->list_compile.mode && !record_draw(mode, 0, count))
+		return;
+	draw(mode, 0, count);
 }
 
 void glMultiDrawElements(GLenum mode, const GLsizei *count, GLenum type,
@@ -524,10 +727,10 @@ void glDrawArrays(GLenum mode, GLint first, GLsizei count)
 		return;
 	if (!count)
 		return;
-	if (!update_jit())
-		return;
 	g_ctx->indices = NULL;
-	primitive(mode, 0, count);
+	if (g_ctx->list_compile.mode && !record_draw(mode, first, count))
+		return;
+	draw(mode, first, count);
 }
 
 void glMultiDrawArrays(GLenum mode, GLint *first, GLsizei *count,
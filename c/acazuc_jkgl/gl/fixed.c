@@ -162,17 +162,8 @@ GLboolean fixed_fragment_shader(const struct vert *vert, GLfloat *color)
 	return GL_FALSE;
 }
 
-void fixed_vertex_shader(struct vert *vert)
+static void shade_vert(struct vert *vert, const GLfloat *modelview_pos)
 {
-	vert->x = vert->attr[VERT_ATTR_X];
-	vert->y = vert->attr[VERT_ATTR_Y];
-	vert->z = vert->attr[VERT_ATTR_Z];
-	vert->w = vert->attr[VERT_ATTR_W];
-	mat4_transform_vec4(&g_ctx->modelview_matrix[g_ctx->modelview_stack_depth],
-	                    &vert->x);
-	GLfloat modelview_pos[3] = {vert->x, vert->y, vert->z};
-	mat4_transform_vec4(&g_ctx->projection_matrix[g_ctx->projection_stack_depth],
-	                    &vert->x);
 	vert->varying[VERT_VARYING_R] = vert->attr[VERT_ATTR_R];
 	vert->varying[VERT_VARYING_G] = vert->attr[VERT_ATTR_G];
 	vert->varying[VERT_VARYING_B] = vert->attr[VERT_ATTR_B];
@@ -214,3 +205,77 @@ void fixed_vertex_shader(struct vert *vert)
 	if (g_ctx->fog)
 		vert->varying[VERT_VARYING_FOG] = clampf(fog_factor(modelview_pos[2]), 0, 1);
 }
+
+void fixed_vertex_shader(struct vert *vert)
+{
+	vert->x = vert->attr[VERT_ATTR_X];
+	vert->y = vert->attr[VERT_ATTR_Y];
+	vert->z = vert->attr[VERT_ATTR_Z];
+	vert->w = vert->attr[VERT_ATTR_W];
+	mat4_transform_vec4(&g_ctx->modelview_matrix[g_ctx->modelview_stack_depth],
+	                    &vert->x);
+	GLfloat modelview_pos[3] = {vert->x, vert->y, vert->z};
+	mat4_transform_vec4(&g_ctx->projection_matrix[g_ctx->projection_stack_depth],
+	                    &vert->x);
+	shade_vert(vert, modelview_pos);
+}
+
+/*
+ * positions are transformed as structure of arrays so that the compiler can
+ * vectorize the matrix products; the operations order is the one of
+ * mat4_transform_vec4 so that both paths give the same results
+ */
+static void transform_soa(const struct mat4 *mat, const GLfloat *x,
+                          const GLfloat *y, const GLfloat *z,
+                          const GLfloat *w, GLfloat *dx, GLfloat *dy,
+                          GLfloat *dz, GLfloat *dw, GLsizei count)
+{
+	const GLfloat *m = mat->v;
+
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		dx[i] = x[i] * m[0] + y[i] * m[4] + z[i] * m[8] + w[i] * m[12];
+		dy[i] = x[i] * m[1] + y[i] * m[5] + z[i] * m[9] + w[i] * m[13];
+		dz[i] = x[i] * m[2] + y[i] * m[6] + z[i] * m[10] + w[i] * m[14];
+		dw[i] = x[i] * m[3] + y[i] * m[7] + z[i] * m[11] + w[i] * m[15];
+	}
+}
+
+void fixed_vertex_shader_batch(struct vert *verts, GLsizei count)
+{
+	const GLfloat *m = g_ctx->modelview_matrix[g_ctx->modelview_stack_depth].v;
+	GLfloat x[VERT_BATCH_SIZE];
+	GLfloat y[VERT_BATCH_SIZE];
+	GLfloat z[VERT_BATCH_SIZE];
+	GLfloat w[VERT_BATCH_SIZE];
+	GLfloat mx[VERT_BATCH_SIZE];
+	GLfloat my[VERT_BATCH_SIZE];
+	GLfloat mz[VERT_BATCH_SIZE];
+	GLfloat mw[VERT_BATCH_SIZE];
+
+	assert(count <= VERT_BATCH_SIZE);
+	/* same operations order as transform_soa */
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		GLfloat vx = verts[i].attr[VERT_ATTR_X];
+		GLfloat vy = verts[i].attr[VERT_ATTR_Y];
+		GLfloat vz = verts[i].attr[VERT_ATTR_Z];
+		GLfloat vw = verts[i].attr[VERT_ATTR_W];
+		mx[i] = vx * m[0] + vy * m[4] + vz * m[8] + vw * m[12];
+		my[i] = vx * m[1] + vy * m[5] + vz * m[9] + vw * m[13];
+		mz[i] = vx * m[2] + vy * m[6] + vz * m[10] + vw * m[14];
+		mw[i] = vx * m[3] + vy * m[7] + vz * m[11] + vw * m[15];
+	}
+	transform_soa(&g_ctx->projection_matrix[g_ctx->projection_stack_depth],
+	              mx, my, mz, mw, x, y, z, w, count);
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		struct vert *vert = &verts[i];
+		GLfloat modelview_pos[3] = {mx[i], my[i], mz[i]};
+		vert->x = x[i];
+		vert->y = y[i];
+		vert->z = z[i];
+		vert->w = w[i];
+		shade_vert(vert, modelview_pos);
+	}
+}
@@ -27,6 +27,12 @@ void glBegin(GLenum mode)
 			g_ctx->errno = GL_INVALID_ENUM;
 			return;
 	}
+	g_ctx->immediate.mode = mode;
+	g_ctx->immediate.enabled = GL_TRUE;
+	g_ctx->immediate.vert_len = 0;
+	g_ctx->immediate.vert_pos = 0;
+	if (g_ctx->list_compile.mode && !list_begin())
+		return;
 #ifdef ENABLE_GCCJIT
 	if (!jit_update_depth_test(g_ctx)
 	 || !jit_update_fragment_set(g_ctx))
@@ -43,10 +49,6 @@ void glBegin(GLenum mode)
 		}
 	}
 #endif
-	g_ctx->immediate.mode = mode;
-	g_ctx->immediate.enabled = GL_TRUE;
-	g_ctx->immediate.vert_len = 0;
-	g_ctx->immediate.vert_pos = 0;
 }
 
 #define IMMEDIATE_VERT(pos) (&g_ctx->immediate.verts[(pos)])
@@ -60,11 +62,17 @@ void glEnd(void)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	if (g_ctx->list_compile.mode && !list_end(g_ctx->immediate.mode))
+	{
+		g_ctx->immediate.enabled = GL_FALSE;
+		return;
+	}
 	if (g_ctx->immediate.mode == GL_LINE_LOOP)
 	{
 		if (g_ctx->immediate.vert_len > 2)
 			rast_line(IMMEDIATE_VERT_OFF(1, 2), IMMEDIATE_VERT(3));
 	}
+	rast_bin_flush();
 	g_ctx->immediate.enabled = GL_FALSE;
 }
 
@@ -212,6 +220,9 @@ static void quad_strip(void)
 static void glVertex(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
 	struct vert *vert = &g_ctx->immediate.verts[g_ctx->immediate.vert_pos];
+
+	if (g_ctx->list_compile.mode && !list_vertex(x, y, z, w))
+		return;
 	vert->attr[VERT_ATTR_X] = x;
 	vert->attr[VERT_ATTR_Y] = y;
 	vert->attr[VERT_ATTR_Z] = z;
@@ -263,6 +274,12 @@ static void glVertex(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 
 static void glNormal(GLfloat x, GLfloat y, GLfloat z)
 {
+	if (g_ctx->list_compile.mode)
+	{
+		GLfloat values[3] = {x, y, z};
+		if (!list_attr(LIST_ATTR_NORMAL, values))
+			return;
+	}
 	g_ctx->immediate.normal[0] = x;
 	g_ctx->immediate.normal[1] = y;
 	g_ctx->immediate.normal[2] = z;
@@ -270,6 +287,12 @@ static void glNormal(GLfloat x, GLfloat y, GLfloat z)
 
 static void glTexCoord(GLfloat s, GLfloat t, GLfloat r, GLfloat q)
 {
+	if (g_ctx->list_compile.mode)
+	{
+		GLfloat values[4] = {s, t, r, q};
+		if (!list_attr(LIST_ATTR_TEX_COORD, values))
+			return;
+	}
 	g_ctx->immediate.tex_coord[0] = s;
 	g_ctx->immediate.tex_coord[1] = t;
 	g_ctx->immediate.tex_coord[2] = r;
@@ -278,6 +301,12 @@ static void glTexCoord(GLfloat s, GLfloat t, GLfloat r, GLfloat q)
 
 static void glColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
 {
+	if (g_ctx->list_compile.mode)
+	{
+		GLfloat values[4] = {r, g, b, a};
+		if (!list_attr(LIST_ATTR_COLOR, values))
+			return;
+	}
 	g_ctx->immediate.color[0] = r;
 	g_ctx->immediate.color[1] = g;
 	g_ctx->immediate.color[2] = b;
@@ -1,8 +1,335 @@
 #include "internal.h"
 #include "fixed.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LIST_NESTING 64
+
+/*
+ * display lists are compiled into a command stream and packed vertex
+ * attributes already converted to floats (plus rebased indices for
+ * glDrawElements); both glBegin / glEnd primitives and vertex arrays are
+ * replayed through the vertex arrays path of draw.c
+ *
+ * only the state changes with a CMD_* are recorded, the other commands are
+ * executed immediately, even in GL_COMPILE mode
+ */
+
+static struct list *get_list(GLuint name)
+{
+	if (!name || name >= g_ctx->lists_capacity)
+		return NULL;
+	return g_ctx->lists[name];
+}
+
+static void free_list(struct list *list)
+{
+	if (!list)
+		return;
+	free(list->cmds);
+	free(list->verts);
+	free(list->indices);
+	free(list);
+}
+
+static void *reserve(void *ptr, GLsizei *size, GLsizei needed,
+                     size_t elem_size)
+{
+	GLsizei new_size;
+	void *new;
+
+	if (needed <= *size)
+		return ptr;
+	new_size = *size ? *size : 64;
+	while (new_size < needed)
+		new_size *= 2;
+	new = realloc(ptr, elem_size * new_size);
+	if (!new)
+	{
+		g_ctx->errno = GL_OUT_OF_MEMORY;
+		return NULL;
+	}
+	*size = new_size;
+	return new;
+}
+
+static GLboolean grow_lists(GLuint capacity)
+{
+	struct list **lists;
+	GLuint new_capacity;
+
+	if (capacity <= g_ctx->lists_capacity)
+		return GL_TRUE;
+	new_capacity = g_ctx->lists_capacity ? g_ctx->lists_capacity : 16;
+	while (new_capacity < capacity)
+		new_capacity *= 2;
+	lists = realloc(g_ctx->lists, sizeof(*lists) * new_capacity);
+	if (!lists)
+		return GL_FALSE;
+	memset(&lists[g_ctx->lists_capacity], 0,
+	       sizeof(*lists) * (new_capacity - g_ctx->lists_capacity));
+	g_ctx->lists = lists;
+	g_ctx->lists_capacity = new_capacity;
+	return GL_TRUE;
+}
+
+static GLboolean compile_exec(void)
+{
+	return g_ctx->list_compile.mode != GL_COMPILE;
+}
+
+GLboolean list_record(enum list_cmd_type type, const GLsizei *values,
+                      GLsizei values_nb, const GLfloat *floats,
+                      GLsizei floats_nb)
+{
+	struct list_compile *compile = &g_ctx->list_compile;
+	struct list *list = compile->list;
+	struct list_cmd *cmds;
+	struct list_cmd *cmd;
+
+	if (!compile->mode)
+		return GL_TRUE;
+	cmds = reserve(list->cmds, &list->cmd_size, list->cmd_count + 1,
+	               sizeof(*cmds));
+	if (!cmds)
+		return compile_exec();
+	list->cmds = cmds;
+	cmd = &cmds[list->cmd_count++];
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->type = type;
+	if (values_nb)
+		memcpy(cmd->values, values, sizeof(*values) * values_nb);
+	if (floats_nb)
+		memcpy(cmd->floats, floats, sizeof(*floats) * floats_nb);
+	return compile_exec();
+}
+
+GLfloat *list_alloc_verts(GLsizei count, GLsizei *first)
+{
+	struct list *list = g_ctx->list_compile.list;
+	GLfloat *verts;
+
+	verts = reserve(list->verts, &list->vert_size,
+	                (list->vert_count + count) * LIST_VERT_SIZE,
+	                sizeof(*verts));
+	if (!verts)
+		return NULL;
+	list->verts = verts;
+	*first = list->vert_count;
+	list->vert_count += count;
+	return &verts[*first * LIST_VERT_SIZE];
+}
+
+GLuint *list_alloc_indices(GLsizei count, GLsizei *first)
+{
+	struct list *list = g_ctx->list_compile.list;
+	GLuint *indices;
+
+	indices = reserve(list->indices, &list->indice_size,
+	                  list->indice_count + count, sizeof(*indices));
+	if (!indices)
+		return NULL;
+	list->indices = indices;
+	*first = list->indice_count;
+	list->indice_count += count;
+	return &indices[*first];
+}
+
+GLboolean list_record_draw(GLenum mode, GLsizei first, GLsizei count,
+                           GLsizei indices_first)
+{
+	GLsizei values[4];
+
+	values[0] = mode;
+	values[1] = first;
+	values[2] = count;
+	values[3] = indices_first;
+	return list_record(CMD_DRAW, values, 4, NULL, 0);
+}
+
+GLboolean list_begin(void)
+{
+	struct list_compile *compile = &g_ctx->list_compile;
+
+	compile->first = compile->list->vert_count;
+	compile->dirty = 0;
+	return compile_exec();
+}
+
+GLboolean list_vertex(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+	struct list_compile *compile = &g_ctx->list_compile;
+	GLfloat *vert;
+	GLsizei first;
+
+	vert = list_alloc_verts(1, &first);
+	if (!vert)
+		return compile_exec();
+	vert[VERT_ATTR_X] = x;
+	vert[VERT_ATTR_Y] = y;
+	vert[VERT_ATTR_Z] = z;
+	vert[VERT_ATTR_W] = w;
+	vert[VERT_ATTR_R] = compile->color[0];
+	vert[VERT_ATTR_G] = compile->color[1];
+	vert[VERT_ATTR_B] = compile->color[2];
+	vert[VERT_ATTR_A] = compile->color[3];
+	vert[VERT_ATTR_S] = compile->tex_coord[0];
+	vert[VERT_ATTR_T] = compile->tex_coord[1];
+	vert[VERT_ATTR_P] = compile->tex_coord[2];
+	vert[VERT_ATTR_Q] = compile->tex_coord[3];
+	vert[VERT_ATTR_NX] = compile->normal[0];
+	vert[VERT_ATTR_NY] = compile->normal[1];
+	vert[VERT_ATTR_NZ] = compile->normal[2];
+	/* attributes not set since glNewList come from the state at call time */
+	vert[LIST_VERT_ATTRS] = (LIST_ATTR_COLOR | LIST_ATTR_TEX_COORD | LIST_ATTR_NORMAL)
+	                      & ~compile->defined;
+	return compile_exec();
+}
+
+GLboolean list_end(GLenum mode)
+{
+	struct list_compile *compile = &g_ctx->list_compile;
+	GLsizei count = compile->list->vert_count - compile->first;
+
+	if (count)
+		list_record_draw(mode, compile->first, count, -1);
+	/* current attributes set inside glBegin / glEnd stay set after the call */
+	if (compile->dirty & LIST_ATTR_COLOR)
+		list_record(CMD_COLOR, NULL, 0, compile->color, 4);
+	if (compile->dirty & LIST_ATTR_TEX_COORD)
+		list_record(CMD_TEX_COORD, NULL, 0, compile->tex_coord, 4);
+	if (compile->dirty & LIST_ATTR_NORMAL)
+		list_record(CMD_NORMAL, NULL, 0, compile->normal, 3);
+	compile->dirty = 0;
+	return compile_exec();
+}
+
+GLboolean list_attr(GLuint attr, const GLfloat *values)
+{
+	struct list_compile *compile = &g_ctx->list_compile;
+	enum list_cmd_type type;
+	GLfloat *dst;
+	GLsizei count;
+
+	switch (attr)
+	{
+		case LIST_ATTR_COLOR:
+			type = CMD_COLOR;
+			dst = compile->color;
+			count = 4;
+			break;
+		case LIST_ATTR_TEX_COORD:
+			type = CMD_TEX_COORD;
+			dst = compile->tex_coord;
+			count = 4;
+			break;
+		case LIST_ATTR_NORMAL:
+			type = CMD_NORMAL;
+			dst = compile->normal;
+			count = 3;
+			break;
+		default:
+			return compile_exec();
+	}
+	memcpy(dst, values, sizeof(*dst) * count);
+	compile->defined |= attr;
+	if (g_ctx->immediate.enabled)
+	{
+		compile->dirty |= attr;
+		return compile_exec();
+	}
+	return list_record(type, NULL, 0, values, count);
+}
+
+static void call_list(GLuint name, GLuint depth);
+
+static void exec_cmd(const struct list *list, const struct list_cmd *cmd,
+                     GLuint depth)
+{
+	switch (cmd->type)
+	{
+		case CMD_DRAW:
+			draw_list(cmd->values[0],
+			          &list->verts[cmd->values[1] * LIST_VERT_SIZE],
+			          cmd->values[3] >= 0 ? &list->indices[cmd->values[3]] : NULL,
+			          cmd->values[2]);
+			break;
+		case CMD_ENABLE:
+			glEnable(cmd->values[0]);
+			break;
+		case CMD_DISABLE:
+			glDisable(cmd->values[0]);
+			break;
+		case CMD_MATRIX_MODE:
+			glMatrixMode(cmd->values[0]);
+			break;
+		case CMD_LOAD_MATRIX:
+			glLoadMatrixf(cmd->floats);
+			break;
+		case CMD_MULT_MATRIX:
+			glMultMatrixf(cmd->floats);
+			break;
+		case CMD_PUSH_MATRIX:
+			glPushMatrix();
+			break;
+		case CMD_POP_MATRIX:
+			glPopMatrix();
+			break;
+		case CMD_BIND_TEXTURE:
+			glBindTexture(cmd->values[0], cmd->values[1]);
+			break;
+		case CMD_MATERIAL:
+			glMaterialfv(cmd->values[0], cmd->values[1], (GLfloat*)cmd->floats);
+			break;
+		case CMD_COLOR:
+			glColor4f(cmd->floats[0], cmd->floats[1], cmd->floats[2], cmd->floats[3]);
+			break;
+		case CMD_NORMAL:
+			glNormal3f(cmd->floats[0], cmd->floats[1], cmd->floats[2]);
+			break;
+		case CMD_TEX_COORD:
+			glTexCoord4f(cmd->floats[0], cmd->floats[1], cmd->floats[2], cmd->floats[3]);
+			break;
+		case CMD_CALL_LIST:
+			if (cmd->values[1])
+				call_list(g_ctx->list_base + cmd->values[0], depth + 1);
+			else
+				call_list(cmd->values[0], depth + 1);
+			break;
+	}
+}
+
+static void call_list(GLuint name, GLuint depth)
+{
+	const struct list *list = get_list(name);
+
+	if (!list || depth >= MAX_LIST_NESTING)
+		return;
+	for (GLsizei i = 0; i < list->cmd_count; ++i)
+		exec_cmd(list, &list->cmds[i], depth);
+}
+
+static void exec_list(GLuint name, GLboolean base)
+{
+	GLenum mode = g_ctx->list_compile.mode;
+	GLsizei values[2];
+
+	values[0] = name;
+	values[1] = base;
+	if (!list_record(CMD_CALL_LIST, values, 2, NULL, 0))
+		return;
+	/* commands of the called list are not recorded a second time */
+	g_ctx->list_compile.mode = 0;
+	call_list(base ? g_ctx->list_base + name : name, 0);
+	g_ctx->list_compile.mode = mode;
+}
+
 GLuint glGenLists(GLsizei range)
 {
+	GLuint first;
+	GLuint n;
+
 	if (range < 0)
 	{
 		g_ctx->errno = GL_INVALID_VALUE;
@@ -13,15 +340,63 @@ GLuint glGenLists(GLsizei range)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return 0;
 	}
+	if (!range)
+		return 0;
+	first = 1;
+	n = 0;
+	while (n < (GLuint)range)
+	{
+		if (get_list(first + n))
+		{
+			first += n + 1;
+			n = 0;
+		}
+		else
+		{
+			n++;
+		}
+	}
+	if (!grow_lists(first + range))
+	{
+		g_ctx->errno = GL_OUT_OF_MEMORY;
+		return 0;
+	}
+	for (n = 0; n < (GLuint)range; ++n)
+	{
+		g_ctx->lists[first + n] = calloc(1, sizeof(**g_ctx->lists));
+		if (!g_ctx->lists[first + n])
+		{
+			while (n--)
+			{
+				free(g_ctx->lists[first + n]);
+				g_ctx->lists[first + n] = NULL;
+			}
+			g_ctx->errno = GL_OUT_OF_MEMORY;
+			return 0;
+		}
+	}
+	return first;
 }
 
 void glDeleteLists(GLuint list, GLsizei range)
 {
+	if (range < 0)
+	{
+		g_ctx->errno = GL_INVALID_VALUE;
+		return;
+	}
 	if (g_ctx->immediate.enabled)
 	{
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	for (GLsizei i = 0; i < range; ++i)
+	{
+		if (!get_list(list + i))
+			continue;
+		free_list(g_ctx->lists[list + i]);
+		g_ctx->lists[list + i] = NULL;
+	}
 }
 
 GLboolean glIsList(GLuint list)
@@ -31,8 +406,7 @@ GLboolean glIsList(GLuint list)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return GL_FALSE;
 	}
-	/* XXX */
-	return GL_FALSE;
+	return get_list(list) != NULL;
 }
 
 void glListBase(GLuint base)
@@ -42,24 +416,64 @@ void glListBase(GLuint base)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	g_ctx->list_base = base;
 }
 
 void glNewList(GLuint list, GLenum mode)
 {
-	if (g_ctx->immediate.enabled)
+	struct list_compile *compile = &g_ctx->list_compile;
+
+	if (g_ctx->immediate.enabled || compile->mode)
 	{
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	if (!list)
+	{
+		g_ctx->errno = GL_INVALID_VALUE;
+		return;
+	}
+	switch (mode)
+	{
+		case GL_COMPILE:
+		case GL_COMPILE_AND_EXECUTE:
+			break;
+		default:
+			g_ctx->errno = GL_INVALID_ENUM;
+			return;
+	}
+	compile->list = calloc(1, sizeof(*compile->list));
+	if (!compile->list)
+	{
+		g_ctx->errno = GL_OUT_OF_MEMORY;
+		return;
+	}
+	compile->name = list;
+	compile->mode = mode;
+	compile->defined = 0;
+	compile->dirty = 0;
 }
 
 void glEndList(void)
 {
-	if (g_ctx->immediate.enabled)
+	struct list_compile *compile = &g_ctx->list_compile;
+
+	if (g_ctx->immediate.enabled || !compile->mode)
 	{
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	compile->mode = 0;
+	if (!grow_lists(compile->name + 1))
+	{
+		g_ctx->errno = GL_OUT_OF_MEMORY;
+		free_list(compile->list);
+		compile->list = NULL;
+		return;
+	}
+	free_list(g_ctx->lists[compile->name]);
+	g_ctx->lists[compile->name] = compile->list;
+	compile->list = NULL;
 }
 
 void glCallList(GLuint list)
@@ -69,6 +483,7 @@ void glCallList(GLuint list)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	exec_list(list, GL_FALSE);
 }
 
 void glCallLists(GLsizei n, GLenum type, const GLvoid *lists)
@@ -78,4 +493,42 @@ void glCallLists(GLsizei n, GLenum type, const GLvoid *lists)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	if (n < 0)
+	{
+		g_ctx->errno = GL_INVALID_VALUE;
+		return;
+	}
+	for (GLsizei i = 0; i < n; ++i)
+	{
+		GLuint name;
+
+		switch (type)
+		{
+			case GL_BYTE:
+				name = ((const GLbyte*)lists)[i];
+				break;
+			case GL_UNSIGNED_BYTE:
+				name = ((const GLubyte*)lists)[i];
+				break;
+			case GL_SHORT:
+				name = ((const GLshort*)lists)[i];
+				break;
+			case GL_UNSIGNED_SHORT:
+				name = ((const GLushort*)lists)[i];
+				break;
+			case GL_INT:
+				name = ((const GLint*)lists)[i];
+				break;
+			case GL_UNSIGNED_INT:
+				name = ((const GLuint*)lists)[i];
+				break;
+			case GL_FLOAT:
+				name = ((const GLfloat*)lists)[i];
+				break;
+			default:
+				g_ctx->errno = GL_INVALID_ENUM;
+				return;
+		}
+		exec_list(name, GL_TRUE);
+	}
 }
@@ -17,6 +17,9 @@ void glMaterialf(GLenum face, GLenum pname, GLfloat param)
 			g_ctx->errno = GL_INVALID_ENUM;
 			return;
 	}
+	GLsizei values[2] = {face, pname};
+	if (!list_record(CMD_MATERIAL, values, 2, &param, 1))
+		return;
 	struct material *m = &g_ctx->materials[face == GL_FRONT];
 	switch (pname)
 	{
@@ -71,6 +74,9 @@ void glMaterialfv(GLenum face, GLenum pname, GLfloat *params)
 			g_ctx->errno = GL_INVALID_ENUM;
 			return;
 	}
+	GLsizei values[2] = {face, pname};
+	if (!list_record(CMD_MATERIAL, values, 2, params, pname == GL_SHININESS ? 1 : 4))
+		return;
 	struct material *m = &g_ctx->materials[face == GL_FRONT];
 	switch (pname)
 	{
@@ -61,15 +61,10 @@ void glLoadMatrixd(const GLdouble *m)
 	mat_opf(m, glLoadMatrixf);
 }
 
-void glLoadMatrixf(const GLfloat *m)
+static void load_matrix(const GLfloat *m)
 {
 	GLfloat *dst;
 
-	if (g_ctx->immediate.enabled)
-	{
-		g_ctx->errno = GL_INVALID_OPERATION;
-		return;
-	}
 	switch (g_ctx->matrix_mode)
 	{
 		case GL_MODELVIEW:
@@ -85,6 +80,18 @@ void glLoadMatrixf(const GLfloat *m)
 	memcpy(dst, m, sizeof(*m) * 16);
 }
 
+void glLoadMatrixf(const GLfloat *m)
+{
+	if (g_ctx->immediate.enabled)
+	{
+		g_ctx->errno = GL_INVALID_OPERATION;
+		return;
+	}
+	if (!list_record(CMD_LOAD_MATRIX, NULL, 0, m, 16))
+		return;
+	load_matrix(m);
+}
+
 void glLoadIdentity(void)
 {
 	struct mat4 identity;
@@ -105,27 +112,16 @@ void glLoadTransposeMatrixd(const GLdouble *m)
 
 void glLoadTransposeMatrixf(const GLfloat *m)
 {
-	struct mat4 *dst;
+	struct mat4 mat;
 
 	if (g_ctx->immediate.enabled)
 	{
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
-	switch (g_ctx->matrix_mode)
-	{
-		case GL_MODELVIEW:
-			dst = &g_ctx->modelview_matrix[g_ctx->modelview_stack_depth];
-			break;
-		case GL_PROJECTION:
-			dst = &g_ctx->projection_matrix[g_ctx->projection_stack_depth];
-			break;
-		default:
-			assert(!"invalid matrix type");
-			return;
-	}
-	memcpy(dst->v, m, sizeof(*m) * 16);
-	mat4_reverse(dst);
+	memcpy(mat.v, m, sizeof(*m) * 16);
+	mat4_reverse(&mat);
+	glLoadMatrixf(mat.v);
 }
 
 void glMatrixMode(GLenum mode)
@@ -139,6 +135,8 @@ void glMatrixMode(GLenum mode)
 	{
 		case GL_MODELVIEW:
 		case GL_PROJECTION:
+			if (!list_record(CMD_MATRIX_MODE, (GLsizei*)&mode, 1, NULL, 0))
+				return;
 			g_ctx->matrix_mode = mode;
 			break;
 		default:
@@ -162,10 +160,12 @@ void glMultMatrixf(const GLfloat *m)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	if (!list_record(CMD_MULT_MATRIX, NULL, 0, m, 16))
+		return;
 	memcpy(new.v, m, sizeof(*m) * 16);
 	get_curmat(&cur_mat);
 	mat4_mult(&cur_mat, &cur_mat, &new);
-	glLoadMatrixf(cur_mat.v);
+	load_matrix(cur_mat.v);
 }
 
 void glMultTransposeMatrixd(const GLdouble *m)
@@ -175,7 +175,6 @@ void glMultTransposeMatrixd(const GLdouble *m)
 
 void glMultTransposeMatrixf(const GLfloat *m)
 {
-	struct mat4 cur_mat;
 	struct mat4 new;
 
 	if (g_ctx->immediate.enabled)
@@ -185,9 +184,7 @@ void glMultTransposeMatrixf(const GLfloat *m)
 	}
 	memcpy(new.v, m, sizeof(*m) * 16);
 	mat4_reverse(&new);
-	get_curmat(&cur_mat);
-	mat4_mult(&cur_mat, &cur_mat, &new);
-	glLoadMatrixf(cur_mat.v);
+	glMultMatrixf(new.v);
 }
 
 void glOrtho(GLdouble left, GLdouble right, GLdouble bottom,
@@ -223,6 +220,8 @@ void glPopMatrix(void)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	if (!list_record(CMD_POP_MATRIX, NULL, 0, NULL, 0))
+		return;
 	switch (g_ctx->matrix_mode)
 	{
 		case GL_MODELVIEW:
@@ -254,6 +253,8 @@ void glPushMatrix(void)
 		g_ctx->errno = GL_INVALID_OPERATION;
 		return;
 	}
+	if (!list_record(CMD_PUSH_MATRIX, NULL, 0, NULL, 0))
+		return;
 	switch (g_ctx->matrix_mode)
 	{
 		case GL_MODELVIEW:
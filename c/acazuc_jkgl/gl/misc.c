@@ -61,8 +61,12 @@ void glViewport(GLsizei width, GLsizei height)
 	free(g_ctx->color_buffer);
 	free(g_ctx->depth_buffer);
 	free(g_ctx->stencil_buffer);
+	free(g_ctx->hiz_buffer);
 	g_ctx->width = width;
 	g_ctx->height = height;
+	g_ctx->hiz_width = (width + RAST_HIZ_SIZE - 1) / RAST_HIZ_SIZE;
+	g_ctx->hiz_height = (height + RAST_HIZ_SIZE - 1) / RAST_HIZ_SIZE;
+	g_ctx->hiz_valid = GL_FALSE;
 	if (width == 0 && height == 0)
 	{
 		g_ctx->color_buffer = malloc(1);
@@ -71,6 +75,8 @@ void glViewport(GLsizei width, GLsizei height)
 		assert(g_ctx->depth_buffer);
 		g_ctx->stencil_buffer = malloc(1);
 		assert(g_ctx->stencil_buffer);
+		g_ctx->hiz_buffer = malloc(1);
+		assert(g_ctx->hiz_buffer);
 	}
 	else
 	{
@@ -80,6 +86,8 @@ void glViewport(GLsizei width, GLsizei height)
 		assert(g_ctx->depth_buffer);
 		g_ctx->stencil_buffer = malloc(sizeof(*g_ctx->stencil_buffer) * g_ctx->height * g_ctx->width);
 		assert(g_ctx->stencil_buffer);
+		g_ctx->hiz_buffer = malloc(sizeof(*g_ctx->hiz_buffer) * g_ctx->hiz_height * g_ctx->hiz_width);
+		assert(g_ctx->hiz_buffer);
 	}
 }
 
@@ -63,11 +63,15 @@ static void set(GLenum cap, GLboolean v)
 
 void glEnable(GLenum cap)
 {
+	if (!list_record(CMD_ENABLE, (GLsizei*)&cap, 1, NULL, 0))
+		return;
 	set(cap, GL_TRUE);
 }
 
 void glDisable(GLenum cap)
 {
+	if (!list_record(CMD_DISABLE, (GLsizei*)&cap, 1, NULL, 0))
+		return;
 	set(cap, GL_FALSE);
 }
 
@@ -0,0 +1,287 @@
+#include "internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * triangles of a draw call are set up on the calling thread and binned into
+ * RAST_TILE_SIZE screen tiles; the tiles are then rasterized in parallel,
+ * each one by a single thread walking its triangles in submission order so
+ * the result is the same as the immediate path
+ */
+
+static void copy_vert(struct vert *dst, const struct vert *src)
+{
+	dst->front_face = src->front_face;
+	dst->x = src->x;
+	dst->y = src->y;
+	dst->z = src->z;
+	dst->w = src->w;
+	memcpy(dst->varying, src->varying,
+	       sizeof(*dst->varying) * g_ctx->vs.varying_nb);
+}
+
+static void draw_tile(struct rast_bin *bin, GLuint idx)
+{
+	struct rast_tile *tile = &bin->tiles[idx];
+	struct rast_rect clip;
+
+	clip.x0 = (idx % bin->tiles_x) * RAST_TILE_SIZE;
+	clip.y0 = (idx / bin->tiles_x) * RAST_TILE_SIZE;
+	clip.x1 = mini(clip.x0 + RAST_TILE_SIZE, bin->width);
+	clip.y1 = mini(clip.y0 + RAST_TILE_SIZE, bin->height);
+	for (GLuint i = 0; i < tile->triangles_nb; ++i)
+		rast_triangle_draw(&bin->triangles[tile->triangles[i]].ctx, &clip);
+}
+
+static void draw_tiles(struct rast_bin *bin)
+{
+	GLuint n;
+
+	while ((n = atomic_fetch_add(&bin->next_tile, 1)) < bin->used_tiles_nb)
+		draw_tile(bin, bin->used_tiles[n]);
+}
+
+static void *worker_run(void *arg)
+{
+	struct rast_bin *bin = arg;
+	GLuint generation = 0; /* value at rast_bin_init, the first flush may already be running */
+
+	pthread_mutex_lock(&bin->mutex);
+	while (1)
+	{
+		while (!bin->stop && bin->generation == generation)
+			pthread_cond_wait(&bin->work_cond, &bin->mutex);
+		if (bin->stop)
+			break;
+		generation = bin->generation;
+		pthread_mutex_unlock(&bin->mutex);
+		draw_tiles(bin);
+		pthread_mutex_lock(&bin->mutex);
+		if (!--bin->running)
+			pthread_cond_signal(&bin->done_cond);
+	}
+	pthread_mutex_unlock(&bin->mutex);
+	return NULL;
+}
+
+static void free_tiles(struct rast_bin *bin)
+{
+	for (GLuint i = 0; i < bin->tiles_x * bin->tiles_y; ++i)
+		free(bin->tiles[i].triangles);
+	free(bin->tiles);
+	free(bin->used_tiles);
+	bin->tiles = NULL;
+	bin->used_tiles = NULL;
+	bin->tiles_x = 0;
+	bin->tiles_y = 0;
+	bin->width = 0;
+	bin->height = 0;
+}
+
+static GLboolean resize_tiles(struct rast_bin *bin)
+{
+	GLuint tiles_x = (g_ctx->width + RAST_TILE_SIZE - 1) / RAST_TILE_SIZE;
+	GLuint tiles_y = (g_ctx->height + RAST_TILE_SIZE - 1) / RAST_TILE_SIZE;
+
+	free_tiles(bin);
+	bin->tiles = calloc(tiles_x * tiles_y + 1, sizeof(*bin->tiles));
+	if (!bin->tiles)
+		return GL_FALSE;
+	bin->used_tiles = malloc(sizeof(*bin->used_tiles) * (tiles_x * tiles_y + 1));
+	if (!bin->used_tiles)
+	{
+		free(bin->tiles);
+		bin->tiles = NULL;
+		return GL_FALSE;
+	}
+	bin->tiles_x = tiles_x;
+	bin->tiles_y = tiles_y;
+	bin->width = g_ctx->width;
+	bin->height = g_ctx->height;
+	return GL_TRUE;
+}
+
+static GLboolean reserve_tile(struct rast_tile *tile)
+{
+	if (tile->triangles_nb < tile->triangles_size)
+		return GL_TRUE;
+	GLuint size = tile->triangles_size ? tile->triangles_size * 2 : 64;
+	GLuint *triangles = realloc(tile->triangles, sizeof(*triangles) * size);
+	if (!triangles)
+		return GL_FALSE;
+	tile->triangles = triangles;
+	tile->triangles_size = size;
+	return GL_TRUE;
+}
+
+static void draw_direct(struct vert *v1, struct vert *v2, struct vert *v3)
+{
+	struct triangle_ctx ctx;
+	struct rast_rect clip;
+
+	rast_bin_flush();
+	if (!rast_triangle_setup(&ctx, v1, v2, v3))
+		return;
+	clip.x0 = 0;
+	clip.y0 = 0;
+	clip.x1 = g_ctx->width;
+	clip.y1 = g_ctx->height;
+	rast_triangle_draw(&ctx, &clip);
+}
+
+void rast_bin_triangle(struct vert *v1, struct vert *v2, struct vert *v3)
+{
+	struct rast_bin *bin = &g_ctx->bin;
+	struct rast_bin_triangle *triangle;
+	GLint tx0;
+	GLint ty0;
+	GLint tx1;
+	GLint ty1;
+
+	if (bin->width != g_ctx->width || bin->height != g_ctx->height)
+	{
+		rast_bin_flush();
+		if (!resize_tiles(bin))
+		{
+			draw_direct(v1, v2, v3);
+			return;
+		}
+	}
+	if (bin->triangles_nb == RAST_BIN_MAX_TRIANGLES)
+		rast_bin_flush();
+	triangle = &bin->triangles[bin->triangles_nb];
+	copy_vert(&triangle->v[0], v1);
+	copy_vert(&triangle->v[1], v2);
+	copy_vert(&triangle->v[2], v3);
+	if (!rast_triangle_setup(&triangle->ctx, &triangle->v[0],
+	                         &triangle->v[1], &triangle->v[2]))
+		return;
+	/* vertices are sorted by y; spans never leave the vertices bounds */
+	GLfloat minx = minf(minf(v1->x, v2->x), v3->x);
+	GLfloat maxx = maxf(maxf(v1->x, v2->x), v3->x);
+	GLint x0 = maxi(floorf(minx) - 1, 0);
+	GLint y0 = maxi(floorf(triangle->ctx.v[0]->y) - 1, 0);
+	GLint x1 = mini(ceilf(maxx) + 1, g_ctx->width);
+	GLint y1 = mini(ceilf(triangle->ctx.v[2]->y) + 1, g_ctx->height);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	tx0 = x0 / RAST_TILE_SIZE;
+	ty0 = y0 / RAST_TILE_SIZE;
+	tx1 = (x1 - 1) / RAST_TILE_SIZE;
+	ty1 = (y1 - 1) / RAST_TILE_SIZE;
+	for (GLint ty = ty0; ty <= ty1; ++ty)
+	{
+		for (GLint tx = tx0; tx <= tx1; ++tx)
+		{
+			if (!reserve_tile(&bin->tiles[ty * bin->tiles_x + tx]))
+			{
+				draw_direct(v1, v2, v3);
+				return;
+			}
+		}
+	}
+	for (GLint ty = ty0; ty <= ty1; ++ty)
+	{
+		for (GLint tx = tx0; tx <= tx1; ++tx)
+		{
+			GLuint idx = ty * bin->tiles_x + tx;
+			struct rast_tile *tile = &bin->tiles[idx];
+			if (!tile->triangles_nb)
+				bin->used_tiles[bin->used_tiles_nb++] = idx;
+			tile->triangles[tile->triangles_nb++] = bin->triangles_nb;
+		}
+	}
+	bin->triangles_nb++;
+}
+
+void rast_bin_flush(void)
+{
+	struct rast_bin *bin = &g_ctx->bin;
+
+	if (!bin->triangles_nb)
+		return;
+	atomic_store(&bin->next_tile, 0);
+	pthread_mutex_lock(&bin->mutex);
+	bin->generation++;
+	bin->running = bin->threads_nb - 1;
+	pthread_cond_broadcast(&bin->work_cond);
+	pthread_mutex_unlock(&bin->mutex);
+	draw_tiles(bin);
+	pthread_mutex_lock(&bin->mutex);
+	while (bin->running)
+		pthread_cond_wait(&bin->done_cond, &bin->mutex);
+	pthread_mutex_unlock(&bin->mutex);
+	for (GLuint i = 0; i < bin->used_tiles_nb; ++i)
+		bin->tiles[bin->used_tiles[i]].triangles_nb = 0;
+	bin->used_tiles_nb = 0;
+	bin->triangles_nb = 0;
+}
+
+static void stop_workers(struct rast_bin *bin, GLuint count)
+{
+	pthread_mutex_lock(&bin->mutex);
+	bin->stop = GL_TRUE;
+	pthread_cond_broadcast(&bin->work_cond);
+	pthread_mutex_unlock(&bin->mutex);
+	for (GLuint i = 0; i < count; ++i)
+		pthread_join(bin->threads[i], NULL);
+}
+
+GLboolean rast_bin_init(struct gl_ctx *ctx, GLuint threads_nb)
+{
+	struct rast_bin *bin = &ctx->bin;
+
+	memset(bin, 0, sizeof(*bin));
+	bin->threads_nb = 1;
+	if (threads_nb <= 1)
+		return GL_TRUE;
+	bin->triangles = malloc(sizeof(*bin->triangles) * RAST_BIN_MAX_TRIANGLES);
+	if (!bin->triangles)
+		return GL_FALSE;
+	bin->threads = malloc(sizeof(*bin->threads) * (threads_nb - 1));
+	if (!bin->threads)
+	{
+		free(bin->triangles);
+		bin->triangles = NULL;
+		return GL_FALSE;
+	}
+	pthread_mutex_init(&bin->mutex, NULL);
+	pthread_cond_init(&bin->work_cond, NULL);
+	pthread_cond_init(&bin->done_cond, NULL);
+	for (GLuint i = 0; i < threads_nb - 1; ++i)
+	{
+		if (pthread_create(&bin->threads[i], NULL, worker_run, bin))
+		{
+			stop_workers(bin, i);
+			pthread_cond_destroy(&bin->done_cond);
+			pthread_cond_destroy(&bin->work_cond);
+			pthread_mutex_destroy(&bin->mutex);
+			free(bin->threads);
+			free(bin->triangles);
+			memset(bin, 0, sizeof(*bin));
+			bin->threads_nb = 1;
+			return GL_FALSE;
+		}
+	}
+	bin->threads_nb = threads_nb;
+	return GL_TRUE;
+}
+
+void rast_bin_destroy(struct gl_ctx *ctx)
+{
+	struct rast_bin *bin = &ctx->bin;
+
+	if (bin->threads_nb <= 1)
+		return;
+	stop_workers(bin, bin->threads_nb - 1);
+	pthread_cond_destroy(&bin->done_cond);
+	pthread_cond_destroy(&bin->work_cond);
+	pthread_mutex_destroy(&bin->mutex);
+	free_tiles(bin);
+	free(bin->threads);
+	free(bin->triangles);
+	memset(bin, 0, sizeof(*bin));
+	bin->threads_nb = 1;
+}
@@ -214,6 +214,8 @@ void rast_line(struct vert *v1, struct vert *v2)
 {
 	if (truncate(v1, v2))
 		return;
+	rast_hiz_invalidate(minf(v1->x, v2->x) - 2, minf(v1->y, v2->y) - 2,
+	                    maxf(v1->x, v2->x) + 3, maxf(v1->y, v2->y) + 3);
 	if (g_ctx->line_smooth)
 		rast_aa(v1, v2);
 	else
@@ -5,6 +5,10 @@
 
 void rast_point(struct vert *vert)
 {
+	rast_hiz_invalidate(vert->x - g_ctx->point_size * .5f - 1,
+	                    vert->y - g_ctx->point_size * .5f - 1,
+	                    vert->x + g_ctx->point_size * .5f + 2,
+	                    vert->y + g_ctx->point_size * .5f + 2);
 	if (g_ctx->point_size == 1)
 	{
 		struct vert tmp;
@@ -1,18 +1,36 @@
 #include "internal.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <math.h>
 
-struct triangle_ctx;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-struct triangle_ctx
+/*
+ * triangles are rasterized with edge functions evaluated on 2x2 quads, in
+ * doubled integer coordinates so the coverage is exact: a pixel is sampled
+ * at (x + .5, y), left and bottom edges are exclusive, right and top edges
+ * inclusive, which is what the scanline path (kept for vertices too far off
+ * screen) produces; only pixels whose center lies exactly on a slanted edge
+ * may differ, where the scanline path rounds its float span ends
+ */
+
+#define HALFSPACE_MAX_COORD 16384
+
+struct halfspace
 {
-	GLfloat d0[3];
-	GLfloat d1[3];
-	GLfloat d[3];
-	struct vert *v[3];
-	struct vert *first;
-	GLboolean front_face;
+	GLint e[3]; /* edge values at (ox, oy), positive inside */
+	GLint dx[3];
+	GLint dy[3];
+	GLint ox;
+	GLint oy;
+	GLfloat zerr; /* bound of the depth plane vs per pixel depth error */
+	struct rast_rect rect;
+#ifdef __SSE2__
+	__m128i quad[3];
+#endif
 };
 
 static void compute_ctx(struct triangle_ctx *ctx)
@@ -36,6 +54,9 @@ static void compute_ctx(struct triangle_ctx *ctx)
 	ctx->d[0] = d * (ctx->v[1]->x * ctx->v[2]->y - ctx->v[2]->x * ctx->v[1]->y);
 	ctx->d[1] = d * (ctx->v[2]->x * ctx->v[0]->y - ctx->v[0]->x * ctx->v[2]->y);
 	ctx->d[2] = d * (ctx->v[0]->x * ctx->v[1]->y - ctx->v[1]->x * ctx->v[0]->y);
+	ctx->zdx = ctx->d0[0] * ctx->v[0]->z + ctx->d0[1] * ctx->v[1]->z + ctx->d0[2] * ctx->v[2]->z;
+	ctx->zdy = ctx->d1[0] * ctx->v[0]->z + ctx->d1[1] * ctx->v[1]->z + ctx->d1[2] * ctx->v[2]->z;
+	ctx->zc = ctx->d[0] * ctx->v[0]->z + ctx->d[1] * ctx->v[1]->z + ctx->d[2] * ctx->v[2]->z;
 }
 
 static GLboolean truncate(struct vert *p1, struct vert *p2, struct vert *p3)
@@ -53,7 +74,7 @@ static GLboolean truncate(struct vert *p1, struct vert *p2, struct vert *p3)
 	return GL_FALSE;
 }
 
-static void draw_smooth(struct triangle_ctx *ctx, GLint x, GLint y)
+static GLboolean draw_smooth(const struct triangle_ctx *ctx, GLint x, GLint y)
 {
 	struct vert tmp;
 	GLfloat bary[3];
@@ -68,7 +89,7 @@ static void draw_smooth(struct triangle_ctx *ctx, GLint x, GLint y)
 	bary[2] = tmp.x * ctx->d0[2] + tmp.y * ctx->d1[2] + ctx->d[2];
 	tmp.z = bary[0] * ctx->v[0]->z + bary[1] * ctx->v[1]->z + bary[2] * ctx->v[2]->z;
 	if (!rast_depth_test(x, y, tmp.z))
-		return;
+		return GL_FALSE;
 	tmp.w = bary[0] * ctx->v[0]->w + bary[1] * ctx->v[1]->w + bary[2] * ctx->v[2]->w;
 	q[0] = bary[0] / ctx->v[0]->w;
 	q[1] = bary[1] / ctx->v[1]->w;
@@ -79,21 +100,25 @@ static void draw_smooth(struct triangle_ctx *ctx, GLint x, GLint y)
 		                + q[1] * ctx->v[1]->varying[i]
 		                + q[2] * ctx->v[2]->varying[i]) * qd;
 	rast_fragment(&tmp);
+	return GL_TRUE;
 }
 
-static void render_line(struct triangle_ctx *ctx, GLint y, GLfloat xl, GLfloat xr)
+static void render_line(const struct triangle_ctx *ctx,
+                        const struct rast_rect *clip, GLint y,
+                        GLfloat xl, GLfloat xr)
 {
 	GLint minx = lroundf(xl);
 	GLint maxx = lroundf(xr);
-	if (minx < 0)
-		minx = 0;
-	if (maxx > g_ctx->width)
-		maxx = g_ctx->width;
+	if (minx < clip->x0)
+		minx = clip->x0;
+	if (maxx > clip->x1)
+		maxx = clip->x1;
 	for (GLint x = minx; x < maxx; ++x)
 		draw_smooth(ctx, x, y);
 }
 
-static void render_span(struct triangle_ctx *ctx, struct vert *v1,
+static void render_span(const struct triangle_ctx *ctx,
+                        const struct rast_rect *clip, struct vert *v1,
                         struct vert *v2, struct vert *v3,
                         GLfloat y0, GLfloat y1)
 {
@@ -105,10 +130,10 @@ static void render_span(struct triangle_ctx *ctx, struct vert *v1,
 	}
 	GLint miny = lroundf(y0);
 	GLint maxy = lroundf(y1);
-	if (miny < 0)
-		miny = 0;
-	if (maxy > g_ctx->height)
-		maxy = g_ctx->height;
+	if (miny < clip->y0)
+		miny = clip->y0;
+	if (maxy > clip->y1)
+		maxy = clip->y1;
 	GLfloat dxl = v2->x - v1->x;
 	GLfloat dxr = v3->x - v1->x;
 	GLfloat dyl = v2->y - v1->y;
@@ -118,18 +143,20 @@ static void render_span(struct triangle_ctx *ctx, struct vert *v1,
 		GLfloat dy = y - v1->y;
 		GLfloat xl = v1->x + dxl * (dy / dyl);
 		GLfloat xr = v1->x + dxr * (dy / dyr);
-		render_line(ctx, y, xl, xr);
+		render_line(ctx, clip, y, xl, xr);
 	}
 }
 
-static void render_not_flat(struct vert *v1, struct vert *v2, struct vert *v3, struct triangle_ctx *ctx)
+static void render_not_flat(struct vert *v1, struct vert *v2, struct vert *v3,
+                            const struct triangle_ctx *ctx,
+                            const struct rast_rect *clip)
 {
 	struct vert new;
 	GLfloat f = (v2->y - v1->y) / (v3->y - v1->y);
 	new.x = mixf(v1->x, v3->x, f);
 	new.y = mixf(v1->y, v3->y, f);
-	render_span(ctx, v3, &new, v2, v2->y, v3->y);
-	render_span(ctx, v1, v2, &new, v1->y, v2->y);
+	render_span(ctx, clip, v3, &new, v2, v2->y, v3->y);
+	render_span(ctx, clip, v1, v2, &new, v1->y, v2->y);
 }
 
 static void get_vertices_sorted(struct triangle_ctx *ctx)
@@ -156,32 +183,310 @@ static void get_vertices_sorted(struct triangle_ctx *ctx)
 	}
 }
 
-void rast_triangle(struct vert *v1, struct vert *v2, struct vert *v3)
+static GLboolean setup_edge(struct halfspace *hs, int i, const int64_t *px,
+                            const int64_t *py)
 {
-	struct triangle_ctx ctx;
+	int j = (i + 1) % 3;
+	int k = (i + 2) % 3;
+	int64_t a = py[j] - py[i];
+	int64_t b = px[i] - px[j];
+	int64_t c = -(a * px[i] + b * py[i]);
+	if (a * px[k] + b * py[k] + c < 0)
+	{
+		a = -a;
+		b = -b;
+		c = -c;
+	}
+	/* E >= 0 on right and top edges, E > 0 on left and bottom ones */
+	if (a < 0 || (a == 0 && b > 0))
+		c++;
+	int64_t e = a * (2 * hs->ox + 1) + b * (2 * hs->oy) + c;
+	int64_t max = (e < 0 ? -e : e)
+	            + (a < 0 ? -a : a) * 2 * (hs->rect.x1 - hs->ox + 2)
+	            + (b < 0 ? -b : b) * 2 * (hs->rect.y1 - hs->oy + 2);
+	if (max > INT32_MAX)
+		return GL_FALSE;
+	hs->e[i] = e;
+	hs->dx[i] = a * 2;
+	hs->dy[i] = b * 2;
+#ifdef __SSE2__
+	hs->quad[i] = _mm_setr_epi32(0, hs->dx[i], hs->dy[i], hs->dx[i] + hs->dy[i]);
+#endif
+	return GL_TRUE;
+}
 
-	if (truncate(v1, v2, v3))
+/* returns -1 if the triangle cannot be handled with 32 bits edge functions */
+static int setup_halfspace(const struct triangle_ctx *ctx,
+                           const struct rast_rect *clip,
+                           struct halfspace *hs)
+{
+	int64_t px[3];
+	int64_t py[3];
+	GLfloat zerr = 0;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		const struct vert *v = ctx->v[i];
+		if (!(fabsf(v->x) <= HALFSPACE_MAX_COORD)
+		 || !(fabsf(v->y) <= HALFSPACE_MAX_COORD)
+		 || v->x != floorf(v->x)
+		 || v->y != floorf(v->y))
+			return -1;
+		px[i] = 2 * (int64_t)v->x;
+		py[i] = 2 * (int64_t)v->y;
+		zerr += fabsf(v->z) * (fabsf(ctx->d0[i]) * g_ctx->width
+		                     + fabsf(ctx->d1[i]) * g_ctx->height
+		                     + fabsf(ctx->d[i]));
+	}
+	if ((px[1] - px[0]) * (py[2] - py[0]) == (py[1] - py[0]) * (px[2] - px[0]))
+		return 0;
+	/* samples are at (x + .5, y): x in [minx, maxx), y in [miny, maxy) */
+	hs->rect.x0 = maxi(clip->x0, minf(minf(ctx->v[0]->x, ctx->v[1]->x), ctx->v[2]->x));
+	hs->rect.x1 = mini(clip->x1, maxf(maxf(ctx->v[0]->x, ctx->v[1]->x), ctx->v[2]->x));
+	hs->rect.y0 = maxi(clip->y0, ctx->v[0]->y);
+	hs->rect.y1 = mini(clip->y1, ctx->v[2]->y);
+	if (hs->rect.x0 >= hs->rect.x1 || hs->rect.y0 >= hs->rect.y1)
+		return 0;
+	hs->ox = hs->rect.x0 & ~(RAST_HIZ_SIZE - 1);
+	hs->oy = hs->rect.y0 & ~(RAST_HIZ_SIZE - 1);
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!setup_edge(hs, i, px, py))
+			return -1;
+	}
+	zerr += fabsf(ctx->zdx) * g_ctx->width
+	      + fabsf(ctx->zdy) * g_ctx->height
+	      + fabsf(ctx->zc);
+	hs->zerr = zerr * 1e-6f;
+	return 1;
+}
+
+static GLuint quad_mask(const struct halfspace *hs, const GLint *e)
+{
+#ifdef __SSE2__
+	__m128i zero = _mm_setzero_si128();
+	__m128i e0 = _mm_add_epi32(_mm_set1_epi32(e[0]), hs->quad[0]);
+	__m128i e1 = _mm_add_epi32(_mm_set1_epi32(e[1]), hs->quad[1]);
+	__m128i e2 = _mm_add_epi32(_mm_set1_epi32(e[2]), hs->quad[2]);
+	__m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(e0, zero),
+	                                        _mm_cmpgt_epi32(e1, zero)),
+	                          _mm_cmpgt_epi32(e2, zero));
+	return _mm_movemask_ps(_mm_castsi128_ps(m));
+#else
+	GLuint mask = 0;
+	for (GLuint i = 0; i < 4; ++i)
+	{
+		GLint dx = (i & 1);
+		GLint dy = (i >> 1);
+		if (e[0] + hs->dx[0] * dx + hs->dy[0] * dy > 0
+		 && e[1] + hs->dx[1] * dx + hs->dy[1] * dy > 0
+		 && e[2] + hs->dx[2] * dx + hs->dy[2] * dy > 0)
+			mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+static GLboolean block_outside(const struct halfspace *hs,
+                               const struct rast_rect *block)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		GLint e = hs->e[i]
+		        + (block->x0 - hs->ox) * hs->dx[i]
+		        + (block->y0 - hs->oy) * hs->dy[i];
+		if (hs->dx[i] > 0)
+			e += (block->x1 - 1 - block->x0) * hs->dx[i];
+		if (hs->dy[i] > 0)
+			e += (block->y1 - 1 - block->y0) * hs->dy[i];
+		if (e <= 0)
+			return GL_TRUE;
+	}
+	return GL_FALSE;
+}
+
+static GLfloat block_min_depth(const struct triangle_ctx *ctx,
+                               const struct halfspace *hs,
+                               const struct rast_rect *block)
+{
+	GLfloat x = (ctx->zdx > 0 ? block->x0 : block->x1 - 1) + .5f;
+	GLfloat y = (ctx->zdy > 0 ? block->y0 : block->y1 - 1) + .5f;
+	return x * ctx->zdx + y * ctx->zdy + ctx->zc - hs->zerr;
+}
+
+static void update_hiz(const struct rast_rect *block)
+{
+	GLfloat max = -INFINITY;
+
+	for (GLint y = block->y0; y < block->y1; ++y)
+	{
+		const GLfloat *depth = &g_ctx->depth_buffer[y * g_ctx->width];
+		for (GLint x = block->x0; x < block->x1; ++x)
+			max = maxf(max, depth[x]);
+	}
+	g_ctx->hiz_buffer[(block->y0 / RAST_HIZ_SIZE) * g_ctx->hiz_width
+	                + block->x0 / RAST_HIZ_SIZE] = max;
+}
+
+static GLboolean draw_block(const struct triangle_ctx *ctx,
+                            const struct halfspace *hs,
+                            const struct rast_rect *block)
+{
+	GLboolean written = GL_FALSE;
+	GLint x0 = block->x0 & ~1;
+	GLint y0 = block->y0 & ~1;
+
+	for (GLint y = y0; y < block->y1; y += 2)
+	{
+		GLint e[3];
+		GLuint valid = 0xF;
+		if (y < block->y0)
+			valid &= ~0x3;
+		if (y + 1 >= block->y1)
+			valid &= ~0xC;
+		for (int i = 0; i < 3; ++i)
+			e[i] = hs->e[i] + (x0 - hs->ox) * hs->dx[i] + (y - hs->oy) * hs->dy[i];
+		for (GLint x = x0; x < block->x1; x += 2)
+		{
+			GLuint mask = quad_mask(hs, e) & valid;
+			if (x < block->x0)
+				mask &= ~0x5;
+			if (x + 1 >= block->x1)
+				mask &= ~0xA;
+			while (mask)
+			{
+				GLuint i = __builtin_ctz(mask);
+				mask &= mask - 1;
+				if (draw_smooth(ctx, x + (i & 1), y + (i >> 1)))
+					written = GL_TRUE;
+			}
+			e[0] += hs->dx[0] * 2;
+			e[1] += hs->dx[1] * 2;
+			e[2] += hs->dx[2] * 2;
+		}
+	}
+	return written;
+}
+
+static void draw_halfspace(const struct triangle_ctx *ctx,
+                           const struct halfspace *hs)
+{
+	GLboolean hiz_test = g_ctx->hiz_valid
+	                  && g_ctx->depth_test
+	                  && (g_ctx->depth_func == GL_LESS
+	                   || g_ctx->depth_func == GL_LEQUAL);
+	GLboolean hiz_write = g_ctx->hiz_valid && g_ctx->depth_write;
+
+	for (GLint by = hs->oy; by < hs->rect.y1; by += RAST_HIZ_SIZE)
+	{
+		for (GLint bx = hs->ox; bx < hs->rect.x1; bx += RAST_HIZ_SIZE)
+		{
+			struct rast_rect block;
+			block.x0 = maxi(bx, hs->rect.x0);
+			block.y0 = maxi(by, hs->rect.y0);
+			block.x1 = mini(bx + RAST_HIZ_SIZE, hs->rect.x1);
+			block.y1 = mini(by + RAST_HIZ_SIZE, hs->rect.y1);
+			if (block_outside(hs, &block))
+				continue;
+			if (hiz_test && block_min_depth(ctx, hs, &block) > g_ctx->hiz_buffer[(by / RAST_HIZ_SIZE) * g_ctx->hiz_width + bx / RAST_HIZ_SIZE])
+				continue;
+			if (!draw_block(ctx, hs, &block) || !hiz_write)
+				continue;
+			block.x0 = bx;
+			block.y0 = by;
+			block.x1 = mini(bx + RAST_HIZ_SIZE, g_ctx->width);
+			block.y1 = mini(by + RAST_HIZ_SIZE, g_ctx->height);
+			update_hiz(&block);
+		}
+	}
+}
+
+static void draw_spans(const struct triangle_ctx *ctx,
+                       const struct rast_rect *clip)
+{
+	rast_hiz_invalidate(maxf(clip->x0, minf(minf(ctx->v[0]->x, ctx->v[1]->x), ctx->v[2]->x) - 1),
+	                    maxf(clip->y0, ctx->v[0]->y - 1),
+	                    minf(clip->x1, maxf(maxf(ctx->v[0]->x, ctx->v[1]->x), ctx->v[2]->x) + 1),
+	                    minf(clip->y1, ctx->v[2]->y + 1));
+	if (ctx->v[1]->y == ctx->v[2]->y)
+		render_span(ctx, clip, ctx->v[0], ctx->v[1], ctx->v[2], ctx->v[0]->y, ctx->v[1]->y);
+	else if (ctx->v[0]->y == ctx->v[1]->y)
+		render_span(ctx, clip, ctx->v[2], ctx->v[1], ctx->v[0], ctx->v[0]->y, ctx->v[2]->y);
+	else
+		render_not_flat(ctx->v[0], ctx->v[1], ctx->v[2], ctx, clip);
+}
+
+void rast_hiz_invalidate(GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1)
+{
+	if (!g_ctx->hiz_valid || !g_ctx->depth_write)
+		return;
+	if (!(x0 < g_ctx->width && y0 < g_ctx->height && x1 > 0 && y1 > 0))
 		return;
-	ctx.front_face = (v2->x - v1->x) * (v3->y - v2->y) - (v2->y - v1->y) * (v3->x - v2->x) > 0;
+	GLint bx0 = maxf(x0, 0) / RAST_HIZ_SIZE;
+	GLint by0 = maxf(y0, 0) / RAST_HIZ_SIZE;
+	GLint bx1 = minf(x1, g_ctx->width);
+	GLint by1 = minf(y1, g_ctx->height);
+	for (GLint y = by0; y * RAST_HIZ_SIZE < by1; ++y)
+	{
+		for (GLint x = bx0; x * RAST_HIZ_SIZE < bx1; ++x)
+			g_ctx->hiz_buffer[y * g_ctx->hiz_width + x] = INFINITY;
+	}
+}
+
+GLboolean rast_triangle_setup(struct triangle_ctx *ctx, struct vert *v1,
+                              struct vert *v2, struct vert *v3)
+{
+	if (truncate(v1, v2, v3))
+		return GL_FALSE;
+	ctx->front_face = (v2->x - v1->x) * (v3->y - v2->y) - (v2->y - v1->y) * (v3->x - v2->x) > 0;
 	if (g_ctx->front_face == GL_CCW)
-		ctx.front_face = !ctx.front_face;
+		ctx->front_face = !ctx->front_face;
 	if (g_ctx->enable_cull)
 	{
 		if (g_ctx->cull_face == GL_FRONT_AND_BACK)
-			return;
-		if (ctx.front_face == (g_ctx->cull_face == GL_FRONT))
-			return;
-	}
-	ctx.first = v1;
-	ctx.v[0] = v1;
-	ctx.v[1] = v2;
-	ctx.v[2] = v3;
-	get_vertices_sorted(&ctx);
-	compute_ctx(&ctx);
-	if (ctx.v[1]->y == ctx.v[2]->y)
-		render_span(&ctx, ctx.v[0], ctx.v[1], ctx.v[2], ctx.v[0]->y, ctx.v[1]->y);
-	else if (ctx.v[0]->y == ctx.v[1]->y)
-		render_span(&ctx, ctx.v[2], ctx.v[1], ctx.v[0], ctx.v[0]->y, ctx.v[2]->y);
-	else
-		render_not_flat(ctx.v[0], ctx.v[1], ctx.v[2], &ctx);
+			return GL_FALSE;
+		if (ctx->front_face == (g_ctx->cull_face == GL_FRONT))
+			return GL_FALSE;
+	}
+	ctx->v[0] = v1;
+	ctx->v[1] = v2;
+	ctx->v[2] = v3;
+	get_vertices_sorted(ctx);
+	compute_ctx(ctx);
+	return GL_TRUE;
+}
+
+void rast_triangle_draw(const struct triangle_ctx *ctx,
+                        const struct rast_rect *clip)
+{
+	struct halfspace hs;
+
+	switch (setup_halfspace(ctx, clip, &hs))
+	{
+		case -1:
+			draw_spans(ctx, clip);
+			break;
+		case 1:
+			draw_halfspace(ctx, &hs);
+			break;
+	}
+}
+
+void rast_triangle(struct vert *v1, struct vert *v2, struct vert *v3)
+{
+	struct triangle_ctx ctx;
+	struct rast_rect clip;
+
+	if (g_ctx->bin.threads_nb > 1)
+	{
+		rast_bin_triangle(v1, v2, v3);
+		return;
+	}
+	if (!rast_triangle_setup(&ctx, v1, v2, v3))
+		return;
+	clip.x0 = 0;
+	clip.y0 = 0;
+	clip.x1 = g_ctx->width;
+	clip.y1 = g_ctx->height;
+	rast_triangle_draw(&ctx, &clip);
 }
@@ -3,7 +3,12 @@
 void glBindTexture(GLenum target, GLuint texture)
 {
 	struct texture *tex;
+	GLsizei values[2];
 
+	values[0] = target;
+	values[1] = texture;
+	if (!list_record(CMD_BIND_TEXTURE, values, 2, NULL, 0))
+		return;
 	if (texture >= g_ctx->textures_capacity)
 	{
 		g_ctx->errno = GL_INVALID_VALUE;
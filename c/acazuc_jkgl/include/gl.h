@@ -274,6 +274,7 @@ struct gl_ctx;
 
 void gl_ctx_set(struct gl_ctx *new_ctx);
 struct gl_ctx *gl_ctx_new(void);
+GLboolean gl_ctx_set_threads(struct gl_ctx *ctx, GLuint threads);
 
 GLenum glGetError(void);
 void glViewport(GLsizei width, GLsizei height);
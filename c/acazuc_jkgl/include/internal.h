@@ -11,6 +11,9 @@
 
 #include <sys/queue.h>
 
+#include <stdatomic.h>
+#include <pthread.h>
+
 #define MODELVIEW_MAX_STACK_DEPTH  32
 #define PROJECTION_MAX_STACK_DEPTH 2
 
@@ -19,6 +22,20 @@
 
 #define MAX_LIGHTS 8
 
+#define RAST_TILE_SIZE 64
+#define RAST_BIN_MAX_TRIANGLES 4096
+#define RAST_HIZ_SIZE 8
+
+#define VERT_BATCH_SIZE 16
+#define VERT_CACHE_BLOCKS 32
+
+#define LIST_VERT_ATTRS 15 /* VERT_ATTR_NZ + 1 */
+#define LIST_VERT_SIZE  16 /* attributes and LIST_ATTR_* taken from the current state */
+
+#define LIST_ATTR_COLOR     (1 << 0)
+#define LIST_ATTR_TEX_COORD (1 << 1)
+#define LIST_ATTR_NORMAL    (1 << 2)
+
 #define GL_CTX_DIRTY_BLEND_SRC_RGB        (1 << 0)
 #define GL_CTX_DIRTY_BLEND_SRC_ALPHA      (1 << 1)
 #define GL_CTX_DIRTY_BLEND_DST_RGB        (1 << 2)
@@ -48,6 +65,7 @@
 #define GL_TEXTURE_DIRTY_MAG_FILTER (1 << 9)
 
 typedef void (*vertex_shader_fn_t)(struct vert *vert);
+typedef void (*vertex_shader_batch_fn_t)(struct vert *verts, GLsizei count);
 typedef GLboolean (*fragment_shader_fn_t)(const struct vert *vert, GLfloat *color);
 
 #ifdef ENABLE_GCCJIT
@@ -215,6 +233,7 @@ struct immediate
 struct vertex_shader
 {
 	vertex_shader_fn_t fn;
+	vertex_shader_batch_fn_t batch_fn; /* optional, shades VERT_BATCH_SIZE vertexes at most */
 	GLuint attr_nb;
 	GLuint varying_nb;
 };
@@ -228,19 +247,131 @@ struct fragment_shader
 enum list_cmd_type
 {
 	CMD_DRAW,
+	CMD_ENABLE,
+	CMD_DISABLE,
+	CMD_MATRIX_MODE,
+	CMD_LOAD_MATRIX,
+	CMD_MULT_MATRIX,
+	CMD_PUSH_MATRIX,
+	CMD_POP_MATRIX,
+	CMD_BIND_TEXTURE,
+	CMD_MATERIAL,
+	CMD_COLOR,
+	CMD_NORMAL,
+	CMD_TEX_COORD,
+	CMD_CALL_LIST,
 };
 
 struct list_cmd
 {
 	enum list_cmd_type type;
 	GLsizei values[4];
+	GLfloat floats[16];
 };
 
+/*
+ * CMD_DRAW values are mode, first vertex, count and first indice (or -1)
+ */
 struct list
 {
 	struct list_cmd *cmds;
 	GLsizei cmd_count;
 	GLsizei cmd_size;
+	GLfloat *verts; /* LIST_VERT_SIZE floats per vertex */
+	GLsizei vert_count;
+	GLsizei vert_size; /* in floats */
+	GLuint *indices;
+	GLsizei indice_count;
+	GLsizei indice_size;
+};
+
+struct list_compile
+{
+	GLuint name;
+	GLenum mode; /* 0 when not compiling */
+	struct list *list;
+	GLfloat color[4];
+	GLfloat normal[3];
+	GLfloat tex_coord[4];
+	GLuint defined; /* LIST_ATTR_* set since glNewList */
+	GLuint dirty; /* LIST_ATTR_* set inside the current primitive */
+	GLsizei first;
+};
+
+struct vert_cache_block
+{
+	GLint block;
+	struct vert verts[VERT_BATCH_SIZE];
+};
+
+/*
+ * post-transform cache of the current draw: vertexes are fetched and shaded
+ * in blocks of VERT_BATCH_SIZE consecutive indices, blocks are evicted in
+ * fifo order
+ */
+struct vert_cache
+{
+	const GLfloat *list_verts; /* source when drawing a display list */
+	GLint min; /* first fetchable vertex */
+	GLint max; /* last fetchable vertex */
+	GLuint last;
+	GLuint next;
+	struct vert_cache_block blocks[VERT_CACHE_BLOCKS];
+};
+
+struct rast_rect
+{
+	GLint x0;
+	GLint y0;
+	GLint x1;
+	GLint y1;
+};
+
+struct triangle_ctx
+{
+	GLfloat d0[3];
+	GLfloat d1[3];
+	GLfloat d[3];
+	GLfloat zdx; /* depth plane at pixel centers */
+	GLfloat zdy;
+	GLfloat zc;
+	struct vert *v[3];
+	GLboolean front_face;
+};
+
+struct rast_bin_triangle
+{
+	struct triangle_ctx ctx;
+	struct vert v[3];
+};
+
+struct rast_tile
+{
+	GLuint *triangles; /* indexes in rast_bin triangles, in submission order */
+	GLuint triangles_nb;
+	GLuint triangles_size;
+};
+
+struct rast_bin
+{
+	pthread_t *threads;
+	GLuint threads_nb; /* including the thread issuing the draws */
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	GLuint generation;
+	GLuint running;
+	GLboolean stop;
+	atomic_uint next_tile;
+	struct rast_bin_triangle *triangles;
+	GLuint triangles_nb;
+	struct rast_tile *tiles;
+	GLuint *used_tiles;
+	GLuint used_tiles_nb;
+	GLuint tiles_x;
+	GLuint tiles_y;
+	GLsizei width;
+	GLsizei height;
 };
 
 struct gl_ctx
@@ -248,6 +379,10 @@ struct gl_ctx
 	GLfloat *depth_buffer;
 	GLfloat *color_buffer;
 	GLubyte *stencil_buffer;
+	GLfloat *hiz_buffer; /* max depth of each RAST_HIZ_SIZE block */
+	GLsizei hiz_width;
+	GLsizei hiz_height;
+	GLboolean hiz_valid;
 	GLsizei width;
 	GLsizei height;
 	GLenum matrix_mode;
@@ -314,8 +449,14 @@ struct gl_ctx
 	GLsizei scissor_width;
 	GLsizei scissor_height;
 	struct immediate immediate;
+	struct list **lists;
+	GLuint lists_capacity;
+	GLuint list_base;
+	struct list_compile list_compile;
+	struct vert_cache vert_cache;
 	struct vertex_shader vs;
 	struct fragment_shader fs;
+	struct rast_bin bin;
 	GLuint dirty;
 #ifdef ENABLE_GCCJIT
 	struct jit_ctx jit;
@@ -328,9 +469,27 @@ void rast_fragment(struct vert *vs_out);
 void rast_point(struct vert *vn);
 void rast_line(struct vert *v1, struct vert *v2);
 void rast_triangle(struct vert *v1, struct vert *v2, struct vert *v3);
+GLboolean rast_triangle_setup(struct triangle_ctx *ctx, struct vert *v1, struct vert *v2, struct vert *v3);
+void rast_triangle_draw(const struct triangle_ctx *ctx, const struct rast_rect *clip);
+GLboolean rast_bin_init(struct gl_ctx *ctx, GLuint threads_nb);
+void rast_bin_destroy(struct gl_ctx *ctx);
+void rast_bin_triangle(struct vert *v1, struct vert *v2, struct vert *v3);
+void rast_bin_flush(void);
 void rast_texture_sample(const struct texture *texture, const GLfloat *coord, GLfloat *color);
 void rast_normalize_vert(struct vert *vert);
 GLboolean rast_depth_test(GLint x, GLint y, GLfloat test);
+void rast_hiz_invalidate(GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1);
+
+void draw_list(GLenum mode, const GLfloat *verts, const GLuint *indices, GLsizei count);
+
+GLboolean list_record(enum list_cmd_type type, const GLsizei *values, GLsizei values_nb, const GLfloat *floats, GLsizei floats_nb);
+GLfloat *list_alloc_verts(GLsizei count, GLsizei *first);
+GLuint *list_alloc_indices(GLsizei count, GLsizei *first);
+GLboolean list_record_draw(GLenum mode, GLsizei first, GLsizei count, GLsizei indices_first);
+GLboolean list_begin(void);
+GLboolean list_vertex(GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+GLboolean list_end(GLenum mode);
+GLboolean list_attr(GLuint attr, const GLfloat *values);
 
 #ifdef ENABLE_GCCJIT
 GLboolean jit_update_depth_test(struct gl_ctx *gl_ctx);
@@ -339,6 +498,7 @@ GLboolean jit_update_texture_fetch(struct gl_ctx *gl_ctx, struct texture *textur
 #endif
 
 void fixed_vertex_shader(struct vert *vert);
+void fixed_vertex_shader_batch(struct vert *verts, GLsizei count);
 GLboolean fixed_fragment_shader(const struct vert *vert, GLfloat *color);
 
 extern struct gl_ctx *g_ctx;
@@ -0,0 +1,124 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "scene.h"
+#include "gl.h"
+
+/*
+ * renders the demo scene offscreen with 1 to max_threads rasterizer threads
+ * and reports the mean frame time; every run is compared against the single
+ * threaded output
+ *
+ * -s sets the sphere subdivisions (up to 255, about 130k indexed triangles)
+ * -l draws the objects through display lists
+ */
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "%s [-l] [-s sphere_detail] [max_threads [frames [width height]]]\n", progname);
+}
+
+static uint64_t render_frames(struct scene *scene, uint32_t width,
+                              uint32_t height, uint32_t frames,
+                              uint8_t *pixels)
+{
+	uint64_t start = nanotime();
+	for (uint32_t i = 0; i < frames; ++i)
+		scene_render(scene, width, height, i * 16666666ull);
+	uint64_t end = nanotime();
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	return end - start;
+}
+
+int main(int argc, char **argv)
+{
+	struct scene scene;
+	struct gl_ctx *ctx;
+	uint32_t max_threads = 8;
+	uint32_t frames = 50;
+	uint32_t width = 640;
+	uint32_t height = 480;
+	uint32_t sphere_detail = 100;
+	int lists = 0;
+	uint8_t *reference;
+	uint8_t *pixels;
+	int c;
+
+	while ((c = getopt(argc, argv, "ls:")) != -1)
+	{
+		switch (c)
+		{
+			case 'l':
+				lists = 1;
+				break;
+			case 's':
+				sphere_detail = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
+	if (argc != 1 && argc != 2 && argc != 3 && argc != 5)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc > 1)
+		max_threads = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		frames = strtoul(argv[2], NULL, 10);
+	if (argc > 4)
+	{
+		width = strtoul(argv[3], NULL, 10);
+		height = strtoul(argv[4], NULL, 10);
+	}
+	if (!max_threads || !frames || !width || !height)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	ctx = gl_ctx_new();
+	if (!ctx)
+	{
+		fprintf(stderr, "%s: failed to create ctx\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	gl_ctx_set(ctx);
+	reference = malloc(width * height * 4);
+	pixels = malloc(width * height * 4);
+	if (!reference || !pixels)
+	{
+		fprintf(stderr, "%s: failed to malloc pixels\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (scene_setup_ctx(width, height)
+	 || scene_init_detail(&scene, sphere_detail)
+	 || (lists && scene_compile_lists(&scene)))
+		return EXIT_FAILURE;
+	for (uint32_t threads = 1; threads <= max_threads; ++threads)
+	{
+		if (!gl_ctx_set_threads(ctx, threads))
+		{
+			fprintf(stderr, "%s: failed to start %" PRIu32 " threads\n",
+			        argv[0], threads);
+			return EXIT_FAILURE;
+		}
+		uint64_t duration = render_frames(&scene, width, height,
+		                                  frames, threads == 1 ? reference : pixels);
+		const char *match = "";
+		if (threads != 1)
+			match = memcmp(reference, pixels, width * height * 4) ? " (MISMATCH)" : "";
+		printf("threads: %2" PRIu32 " frame: %8.3f ms%s\n", threads,
+		       duration / (double)frames / 1000000., match);
+	}
+	free(reference);
+	free(pixels);
+	return EXIT_SUCCESS;
+}
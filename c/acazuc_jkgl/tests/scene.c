@@ -0,0 +1,502 @@
+#include "common.h"
+#include "scene.h"
+#include "glu.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define FOV 65
+
+#define Z_MIN 0.01
+#define Z_MAX 100
+
+static float light01_ambient[4] = {0, 0, 0, 0};
+static float light01_diffuse[4] = {0, 0, .5, 1};
+static float light01_specular[4] = {0, 0, 1, 1};
+static float light23_ambient[4] = {0, 0, 0, 0};
+static float light23_diffuse[4] = {.5, 0, 0, 1};
+static float light23_specular[4] = {1, 0, 0, 1};
+static float light45_ambient[4] = {0, 0, 0, 0};
+static float light45_diffuse[4] = {0, .5, 0, 1};
+static float light45_specular[4] = {0, 1, 0, 1};
+static float light6_ambient[4] = {.05, .05, .05, 1};
+static float light6_diffuse[4] = {.5, .5, .5, 1};
+static float light6_specular[4] = {0, 0, 0, 0};
+static float light6_position[4] = {-5, -5, 5, 1};
+
+static float material_ambient[4] = {1, 1, 1, 1};
+static float material_diffuse[4] = {1, 1, 1, 1};
+static float material_specular[4] = {1, 1, 1, 1};
+static float material_emission[4] = {0, 0, 0, 1};
+
+static float hue2rgb(float p, float q, float t)
+{
+	if (t < 0)
+		t += 1;
+	else if (t > 1)
+		t -= 1;
+	if (t < 1 / 6.)
+		return p + (q - p) * 6 * t;
+	if (t < 1 / 2.)
+		return q;
+	if (t < 2 / 3.)
+		return p + (q - p) * (2 / 3. - t) * 6;
+	return p;
+}
+
+static void hsl2rgb(float *rgb, float *hsl)
+{
+	if (!hsl[1])
+	{
+		rgb[0] = hsl[2];
+		rgb[1] = hsl[2];
+		rgb[2] = hsl[2];
+		return;
+	}
+	float q = hsl[2] < .5 ? hsl[2] * (1 + hsl[1]) : hsl[2] + hsl[1] - hsl[2] * hsl[1];
+	float p = 2 * hsl[2] - q;
+	rgb[0] = hue2rgb(p, q, hsl[0] + 1 / 3.);
+	rgb[1] = hue2rgb(p, q, hsl[0]);
+	rgb[2] = hue2rgb(p, q, hsl[0] - 1 / 3.);
+}
+
+int scene_setup_ctx(uint32_t width, uint32_t height)
+{
+	GL_CALL(glViewport, width, height);
+	GL_CALL(glEnable, 0x56454536); /* test GL_CALL macro */
+	GL_CALL(glEnable, GL_DEPTH_TEST);
+	GL_CALL(glClearDepth, 1);
+	GL_CALL(glClearStencil, 0);
+	GL_CALL(glEnableClientState, GL_VERTEX_ARRAY);
+	GL_CALL(glEnableClientState, GL_COLOR_ARRAY);
+
+#if 1
+	GL_CALL(glFogi, GL_FOG_MODE, GL_LINEAR);
+	GL_CALL(glFogf, GL_FOG_START, 1);
+	GL_CALL(glFogf, GL_FOG_END, 3);
+	GL_CALL(glEnable, GL_FOG);
+#endif
+
+#if 0
+	GL_CALL(glFogi, GL_FOG_MODE, GL_EXP2);
+	GL_CALL(glFogf, GL_FOG_DENSITY, 1);
+	GL_CALL(glEnable, GL_FOG);
+#endif
+
+	GL_CALL(glDepthFunc, GL_LESS);
+	GL_CALL(glEnable, GL_BLEND);
+	GL_CALL(glBlendFunc, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	GL_CALL(glEnable, GL_LIGHT0);
+	GL_CALL(glLightfv, GL_LIGHT0, GL_AMBIENT, light01_ambient);
+	GL_CALL(glLightfv, GL_LIGHT0, GL_DIFFUSE, light01_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT0, GL_SPECULAR, light01_specular);
+	GL_CALL(glLightf, GL_LIGHT0, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT0, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glEnable, GL_LIGHT1);
+	GL_CALL(glLightfv, GL_LIGHT1, GL_AMBIENT, light01_ambient);
+	GL_CALL(glLightfv, GL_LIGHT1, GL_DIFFUSE, light01_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT1, GL_SPECULAR, light01_specular);
+	GL_CALL(glLightf, GL_LIGHT1, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT1, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glEnable, GL_LIGHT2);
+	GL_CALL(glLightfv, GL_LIGHT2, GL_AMBIENT, light23_ambient);
+	GL_CALL(glLightfv, GL_LIGHT2, GL_DIFFUSE, light23_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT2, GL_SPECULAR, light23_specular);
+	GL_CALL(glLightf, GL_LIGHT2, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT2, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glEnable, GL_LIGHT3);
+	GL_CALL(glLightfv, GL_LIGHT3, GL_AMBIENT, light23_ambient);
+	GL_CALL(glLightfv, GL_LIGHT3, GL_DIFFUSE, light23_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT3, GL_SPECULAR, light23_specular);
+	GL_CALL(glLightf, GL_LIGHT3, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT3, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glEnable, GL_LIGHT4);
+	GL_CALL(glLightfv, GL_LIGHT4, GL_AMBIENT, light45_ambient);
+	GL_CALL(glLightfv, GL_LIGHT4, GL_DIFFUSE, light45_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT4, GL_SPECULAR, light45_specular);
+	GL_CALL(glLightf, GL_LIGHT4, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT4, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glEnable, GL_LIGHT5);
+	GL_CALL(glLightfv, GL_LIGHT5, GL_AMBIENT, light45_ambient);
+	GL_CALL(glLightfv, GL_LIGHT5, GL_DIFFUSE, light45_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT5, GL_SPECULAR, light45_specular);
+	GL_CALL(glLightf, GL_LIGHT5, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT5, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glEnable, GL_LIGHT6);
+	GL_CALL(glLightfv, GL_LIGHT6, GL_AMBIENT, light6_ambient);
+	GL_CALL(glLightfv, GL_LIGHT6, GL_DIFFUSE, light6_diffuse);
+	GL_CALL(glLightfv, GL_LIGHT6, GL_SPECULAR, light6_specular);
+	GL_CALL(glLightf, GL_LIGHT6, GL_CONSTANT_ATTENUATION, 1);
+	GL_CALL(glLightf, GL_LIGHT6, GL_LINEAR_ATTENUATION, 0);
+
+	GL_CALL(glMaterialfv, GL_FRONT_AND_BACK, GL_AMBIENT, material_ambient);
+	GL_CALL(glMaterialfv, GL_FRONT_AND_BACK, GL_DIFFUSE, material_diffuse);
+	GL_CALL(glMaterialfv, GL_FRONT_AND_BACK, GL_SPECULAR, material_specular);
+	GL_CALL(glMaterialfv, GL_FRONT_AND_BACK, GL_EMISSION, material_emission);
+	GL_CALL(glMaterialf, GL_FRONT_AND_BACK, GL_SHININESS, 50);
+
+	GLuint texture;
+	GL_CALL(glGenTextures, 1, &texture);
+	GL_CALL(glBindTexture, GL_TEXTURE_2D, texture);
+	GL_CALL(glShadeModel, GL_SMOOTH);
+	static uint8_t data[16] =
+	{
+		0xFF, 0x00, 0x00, 0x40,
+		0x00, 0xFF, 0x00, 0x80,
+		0x00, 0x00, 0xFF, 0xC0,
+		0xFF, 0xFF, 0xFF, 0xFF,
+	};
+	GL_CALL(glTexImage2D, GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+	GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+	GL_CALL(glEnable, GL_CULL_FACE);
+	GL_CALL(glCullFace, GL_FRONT);
+	GL_CALL(glFrontFace, GL_CCW);
+	return 0;
+}
+
+static int mkobj(struct obj *obj, uint16_t vertexes_nb, uint32_t indices_nb)
+{
+	obj->px = 0;
+	obj->py = 0;
+	obj->pz = 0;
+	obj->rx = 0;
+	obj->ry = 0;
+	obj->rz = 0;
+	obj->sx = 1;
+	obj->sy = 1;
+	obj->sz = 1;
+	obj->vertexes_nb = vertexes_nb;
+	obj->indices_nb = indices_nb;
+	obj->list = 0;
+	obj->colors = malloc(sizeof(*obj->colors) * vertexes_nb);
+	if (!obj->colors)
+		return 1;
+	obj->positions = malloc(sizeof(*obj->positions) * vertexes_nb);
+	if (!obj->positions)
+		return 1;
+	obj->tex_coords = malloc(sizeof(*obj->tex_coords) * vertexes_nb);
+	if (!obj->tex_coords)
+		return 1;
+	obj->normals = malloc(sizeof(*obj->normals) * vertexes_nb);
+	if (!obj->normals)
+		return 1;
+	obj->indices = malloc(sizeof(*obj->indices) * indices_nb);
+	if (!obj->indices)
+		return 1;
+	return 0;
+}
+
+static int mkcube(struct obj *obj)
+{
+	if (mkobj(obj, 8, 24))
+		return 1;
+	static const struct vec4 colors[8] =
+	{
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+		{1, 1, 1, 1},
+	};
+	static const struct vec3 positions[8] =
+	{
+		{-.5, -.5, +.5},
+		{+.5, -.5, +.5},
+		{+.5, +.5, +.5},
+		{-.5, +.5, +.5},
+		{-.5, -.5, -.5},
+		{+.5, -.5, -.5},
+		{+.5, +.5, -.5},
+		{-.5, +.5, -.5},
+	};
+	static const struct vec2 tex_coords[8] =
+	{
+		{-5, -5},
+		{ 5, -5},
+		{ 5,  5},
+		{-5,  5},
+		{-5,  5},
+		{ 5,  5},
+		{ 5, -5},
+		{-5, -5},
+	};
+	static const struct vec3 normals[8] =
+	{
+		{-1,  1,  1},
+		{ 1,  1,  1},
+		{ 1, -1,  1},
+		{-1, -1,  1},
+		{-1,  1, -1},
+		{ 1,  1, -1},
+		{ 1, -1, -1},
+		{-1, -1, -1},
+	};
+	static const GLushort indices[24] =
+	{
+		0, 1, 2, 3, /* front */
+		5, 4, 7, 6, /* back */
+		4, 5, 1, 0, /* top */
+		3, 2, 6, 7, /* bottom */
+		4, 0, 3, 7, /* left */
+		1, 5, 6, 2, /* right */
+	};
+	memcpy(obj->colors, colors, sizeof(colors));
+	memcpy(obj->positions, positions, sizeof(positions));
+	memcpy(obj->tex_coords, tex_coords, sizeof(tex_coords));
+	memcpy(obj->normals, normals, sizeof(normals));
+	memcpy(obj->indices, indices, sizeof(indices));
+	obj->primitive = GL_QUADS;
+	return 0;
+}
+
+static int mksphere(struct obj *obj, uint16_t n)
+{
+	if (n < 3 || n > 255)
+		return 1;
+	if (mkobj(obj, n * n, n * (n - 1) * 4))
+		return 1;
+	size_t i = 0;
+	for (size_t y = 0; y < n; ++y)
+	{
+		float fy = y / (float)(n - 1);
+		float cy = cosf(fy * M_PI);
+		float sy = sinf(fy * M_PI);
+		for (size_t x = 0; x < n; ++x)
+		{
+			struct vec4 *color = &obj->colors[i];
+			struct vec3 *position = &obj->positions[i];
+			struct vec2 *tex_coord = &obj->tex_coords[i];
+			struct vec3 *normal = &obj->normals[i];
+			float fx = x / (float)n;
+			float cx = cosf(fx * M_PI * 2);
+			float sx = sinf(fx * M_PI * 2);
+			color->x = 1;
+			color->y = 1;
+			color->z = 1;
+			color->w = 1;
+			position->x = cx * sy;
+			position->y = -cy;
+			position->z = sx * sy;
+			tex_coord->x = fx * 20;
+			tex_coord->y = fy * 20;
+			normal->x = position->x;
+			normal->y = position->y;
+			normal->z = position->z;
+			i++;
+		}
+	}
+	i = 0;
+	for (size_t y = 0; y < (n - 1u); ++y)
+	{
+		size_t idx_base = y * n;
+		for (size_t x = 0; x < n; ++x)
+		{
+			size_t t = (x + 1) % n;
+			obj->indices[i++] = idx_base + x;
+			obj->indices[i++] = idx_base + x + n;
+			obj->indices[i++] = idx_base + t + n;
+			obj->indices[i++] = idx_base + t;
+		}
+	}
+	obj->primitive = GL_QUADS;
+	return 0;
+}
+
+static void draw_obj(const struct obj *obj)
+{
+	GL_CALL(glPushMatrix);
+	GL_CALL(glTranslatef, obj->px, obj->py, obj->pz);
+	GL_CALL(glRotatef, obj->rz, 0, 0, 1);
+	GL_CALL(glRotatef, obj->ry, 0, 1, 0);
+	GL_CALL(glRotatef, obj->rx, 1, 0, 0);
+	GL_CALL(glScalef, obj->sx, obj->sy, obj->sz);
+	if (obj->list)
+	{
+		GL_CALL(glCallList, obj->list);
+		GL_CALL(glPopMatrix);
+		return;
+	}
+	GL_CALL(glColorPointer, 4, GL_FLOAT, 0, obj->colors);
+	GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, obj->positions);
+	GL_CALL(glTexCoordPointer, 2, GL_FLOAT, 0, obj->tex_coords);
+	GL_CALL(glNormalPointer, GL_FLOAT, 0, obj->normals);
+	GL_CALL(glDrawElements, obj->primitive, obj->indices_nb, GL_UNSIGNED_SHORT, obj->indices);
+	GL_CALL(glPopMatrix);
+}
+
+void scene_render(struct scene *scene, uint32_t width, uint32_t height,
+                  uint64_t frametime)
+{
+	GL_CALL(glViewport, width, height);
+
+	float hsl[3];
+	float rgb[4];
+	hsl[0] = fmodf((frametime % 5000000000) / 5000000000., 1);
+	hsl[1] = .5;
+	hsl[2] = .5;
+	hsl2rgb(rgb, hsl);
+	rgb[3] = 1;
+	GL_CALL(glFogfv, GL_FOG_COLOR, rgb);
+	GL_CALL(glClearColor, rgb[0], rgb[1], rgb[2], 1);
+	GL_CALL(glClear, GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+	GL_CALL(glMatrixMode, GL_PROJECTION);
+	GL_CALL(glLoadIdentity);
+	GL_CALL(gluPerspective, FOV, width / (float)height, Z_MIN, Z_MAX);
+
+	GL_CALL(glMatrixMode, GL_MODELVIEW);
+	GL_CALL(glLoadIdentity);
+	GL_CALL(glRotated, -scene->rotx, 1, 0, 0);
+	GL_CALL(glRotated, -scene->roty, 0, 1, 0);
+	GL_CALL(glTranslated, -scene->posx, -scene->posy, -scene->posz);
+	GL_CALL(glScaled, 1, 1, 1);
+
+#if 1
+	{
+		GL_CALL(glDisable, GL_LIGHTING);
+		float n = (frametime % 2000000000) / 2000000000.;
+		float c = cosf(n * M_PI);
+		float s = sinf(n * M_PI);
+		float d = 1;
+		float light0_position[4] = {+c * d, +s * d, 0, 1};
+		float light1_position[4] = {-c * d, -s * d, 0, 1};
+		float light2_position[4] = {0, +c * d, -s * d, 1};
+		float light3_position[4] = {0, -c * d, +s * d, 1};
+		float light4_position[4] = {+c * d, 0, -s * d, 1};
+		float light5_position[4] = {-c * d, 0, +s * d, 1};
+		GL_CALL(glLightfv, GL_LIGHT0, GL_POSITION, light0_position);
+		GL_CALL(glLightfv, GL_LIGHT1, GL_POSITION, light1_position);
+		GL_CALL(glLightfv, GL_LIGHT2, GL_POSITION, light2_position);
+		GL_CALL(glLightfv, GL_LIGHT3, GL_POSITION, light3_position);
+		GL_CALL(glLightfv, GL_LIGHT4, GL_POSITION, light4_position);
+		GL_CALL(glLightfv, GL_LIGHT5, GL_POSITION, light5_position);
+		GL_CALL(glLightfv, GL_LIGHT6, GL_POSITION, light6_position);
+		GL_CALL(glPointSize, 5);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, light0_position);
+		GL_CALL(glColorPointer, 3, GL_FLOAT, 0, light01_diffuse);
+		GL_CALL(glDrawArrays, GL_POINTS, 0, 1);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, light1_position);
+		GL_CALL(glColorPointer, 3, GL_FLOAT, 0, light01_diffuse);
+		GL_CALL(glDrawArrays, GL_POINTS, 0, 1);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, light2_position);
+		GL_CALL(glColorPointer, 3, GL_FLOAT, 0, light23_diffuse);
+		GL_CALL(glDrawArrays, GL_POINTS, 0, 1);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, light3_position);
+		GL_CALL(glColorPointer, 3, GL_FLOAT, 0, light23_diffuse);
+		GL_CALL(glDrawArrays, GL_POINTS, 0, 1);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, light4_position);
+		GL_CALL(glColorPointer, 3, GL_FLOAT, 0, light45_diffuse);
+		GL_CALL(glDrawArrays, GL_POINTS, 0, 1);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, light5_position);
+		GL_CALL(glColorPointer, 3, GL_FLOAT, 0, light45_diffuse);
+		GL_CALL(glDrawArrays, GL_POINTS, 0, 1);
+	}
+#endif
+
+#if 0
+	{
+		int64_t t = (frametime / 1000000000) % 3;
+		static const GLenum filters[] = {GL_NEAREST, GL_LINEAR, GL_CUBIC};
+		GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filters[t]);
+	}
+#endif
+
+#if 0
+	{
+		int64_t t = (frametime / 1000000000) % 4;
+		GL_CALL(glColorMask, t != 0, t != 1, t != 2, 1);
+	}
+#endif
+
+#if 1
+	GL_CALL(glEnable, GL_LIGHTING);
+	GL_CALL(glEnableClientState, GL_TEXTURE_COORD_ARRAY);
+	GL_CALL(glEnableClientState, GL_NORMAL_ARRAY);
+	GL_CALL(glEnableClientState, GL_COLOR_ARRAY);
+	GL_CALL(glEnable, GL_TEXTURE_2D);
+	GL_CALL(glMatrixMode, GL_MODELVIEW);
+	for (size_t i = 0; i < scene->objects_nb; ++i)
+		draw_obj(&scene->objects[i]);
+	GL_CALL(glDisable, GL_TEXTURE_2D);
+	GL_CALL(glDisableClientState, GL_COLOR_ARRAY);
+	GL_CALL(glDisableClientState, GL_NORMAL_ARRAY);
+	GL_CALL(glDisableClientState, GL_TEXTURE_COORD_ARRAY);
+	GL_CALL(glDisable, GL_LIGHTING);
+#endif
+}
+
+int scene_init(struct scene *scene)
+{
+	return scene_init_detail(scene, 100);
+}
+
+int scene_init_detail(struct scene *scene, uint16_t sphere_detail)
+{
+	memset(scene, 0, sizeof(*scene));
+	scene->objects_nb = 2;
+	scene->objects = malloc(sizeof(*scene->objects) * scene->objects_nb);
+	if (!scene->objects)
+	{
+		fprintf(stderr, "failed to malloc objects\n");
+		return 1;
+	}
+	if (mkcube(&scene->objects[0]))
+	{
+		fprintf(stderr, "failed to create cube\n");
+		return 1;
+	}
+	scene->objects[0].py = 1;
+	if (mksphere(&scene->objects[1], sphere_detail))
+	{
+		fprintf(stderr, "failed to create sphere\n");
+		return 1;
+	}
+	scene->objects[1].sx = .75;
+	scene->objects[1].sy = .75;
+	scene->objects[1].sz = .75;
+	scene->posz = 2;
+	return 0;
+}
+
+int scene_compile_lists(struct scene *scene)
+{
+	GLuint lists = glGenLists(scene->objects_nb);
+	if (!lists)
+	{
+		fprintf(stderr, "failed to generate lists\n");
+		return 1;
+	}
+	GL_CALL(glEnableClientState, GL_TEXTURE_COORD_ARRAY);
+	GL_CALL(glEnableClientState, GL_NORMAL_ARRAY);
+	GL_CALL(glEnableClientState, GL_COLOR_ARRAY);
+	for (size_t i = 0; i < scene->objects_nb; ++i)
+	{
+		struct obj *obj = &scene->objects[i];
+		GL_CALL(glColorPointer, 4, GL_FLOAT, 0, obj->colors);
+		GL_CALL(glVertexPointer, 3, GL_FLOAT, 0, obj->positions);
+		GL_CALL(glTexCoordPointer, 2, GL_FLOAT, 0, obj->tex_coords);
+		GL_CALL(glNormalPointer, GL_FLOAT, 0, obj->normals);
+		GL_CALL(glNewList, lists + i, GL_COMPILE);
+		GL_CALL(glDrawElements, obj->primitive, obj->indices_nb, GL_UNSIGNED_SHORT, obj->indices);
+		GL_CALL(glEndList);
+		obj->list = lists + i;
+	}
+	GL_CALL(glDisableClientState, GL_COLOR_ARRAY);
+	GL_CALL(glDisableClientState, GL_NORMAL_ARRAY);
+	GL_CALL(glDisableClientState, GL_TEXTURE_COORD_ARRAY);
+	return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "gl.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct vec2
+{
+	GLfloat x;
+	GLfloat y;
+};
+
+struct vec3
+{
+	GLfloat x;
+	GLfloat y;
+	GLfloat z;
+};
+
+struct vec4
+{
+	GLfloat x;
+	GLfloat y;
+	GLfloat z;
+	GLfloat w;
+};
+
+struct obj
+{
+	struct vec4 *colors;
+	struct vec3 *positions;
+	struct vec2 *tex_coords;
+	struct vec3 *normals;
+	GLushort *indices;
+	GLushort vertexes_nb;
+	GLuint indices_nb;
+	GLenum primitive;
+	GLuint list;
+	GLfloat px;
+	GLfloat py;
+	GLfloat pz;
+	GLfloat rx;
+	GLfloat ry;
+	GLfloat rz;
+	GLfloat sx;
+	GLfloat sy;
+	GLfloat sz;
+};
+
+struct scene
+{
+	float posx;
+	float posy;
+	float posz;
+	float rotx;
+	float roty;
+	float rotz;
+	struct obj *objects;
+	size_t objects_nb;
+};
+
+int scene_init(struct scene *scene);
+int scene_init_detail(struct scene *scene, uint16_t sphere_detail);
+int scene_compile_lists(struct scene *scene);
+int scene_setup_ctx(uint32_t width, uint32_t height);
+void scene_render(struct scene *scene, uint32_t width, uint32_t height,
+                  uint64_t frametime);
+
+#endif
@@ -5,6 +5,7 @@ in fs_block
 	vec3 fs_position;
 	vec3 fs_color;
 	vec2 fs_uv;
+	flat vec2 fs_tile;
 };
 
 layout(location = 0) out vec4 fragcolor;
@@ -24,7 +25,7 @@ layout(std140, binding = 1) uniform model_block
 
 void main()
 {
-	vec4 tex_col = texture(tex, fs_uv);
+	vec4 tex_col = texture(tex, (fs_tile + fract(fs_uv)) / 16);
 	if (disable_tex == 1)
 	{
 		tex_col.rgb = vec3(1, 1, 1);
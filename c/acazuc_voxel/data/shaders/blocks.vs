@@ -1,14 +1,15 @@
 #version 450
 
-layout(location = 0) in vec3 vs_position;
-layout(location = 1) in vec3 vs_color;
-layout(location = 2) in vec2 vs_uv;
+layout(location = 0) in uvec4 vs_position;
+layout(location = 1) in vec4 vs_color;
+layout(location = 2) in uvec2 vs_uv;
 
 out fs_block
 {
 	vec3 fs_position;
 	vec3 fs_color;
 	vec2 fs_uv;
+	flat vec2 fs_tile;
 };
 
 layout(std140, binding = 1) uniform model_block
@@ -22,17 +23,23 @@ layout(std140, binding = 1) uniform model_block
 	int disable_tex;
 };
 
+layout(std140, binding = 2) uniform chunk_block
+{
+	vec4 chunk_position;
+};
+
 void main()
 {
-	vec4 position = vec4(vs_position, 1);
+	vec4 position = vec4(vec3(vs_position.xyz) / 128 + chunk_position.xyz, 1);
 	/*if (blockId == 18)
 	{
 		newVertex.x += cos(newVertex.x + newVertex.y + newVertex.z + timeFactor * 3.14) * .1;
 		newVertex.y += cos(newVertex.x + newVertex.y + newVertex.z + timeFactor * 3.14 / 3) * .033;
 		newVertex.z += cos(newVertex.x + newVertex.y + newVertex.z + timeFactor * 3.14 / 2) * .05;
 	}*/
-	fs_uv = vs_uv;
-	fs_color = vs_color;
+	fs_uv = vec2(vs_uv) / 256;
+	fs_tile = vec2(vs_position.w & 0xF, (vs_position.w >> 4) & 0xF);
+	fs_color = vs_color.rgb;
 	fs_position = (mv * position).xyz;
 	gl_Position = mvp * position;
 }
@@ -35,10 +35,38 @@ void block_base_get_destroy_values(struct block_def *def, struct vec2f *uv, stru
 	VEC4_SET(*color, 1, 1, 1, 1);
 }
 
-static void draw(struct block_def *def, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
+bool block_base_get_face(struct block_def *def, uint8_t face, struct vec2f *tex, struct vec3f *color)
 {
 	struct block_base *base = (struct block_base*)def;
-	(void)chunk;
+	switch (face)
+	{
+		case BLOCK_FACE_FRONT:
+			*tex = base->tex_front;
+			break;
+		case BLOCK_FACE_BACK:
+		case BLOCK_FACE_LEFT:
+			*tex = base->tex_left;
+			break;
+		case BLOCK_FACE_RIGHT:
+			*tex = base->tex_right;
+			break;
+		case BLOCK_FACE_TOP:
+			*tex = base->tex_top;
+			break;
+		case BLOCK_FACE_BOTTOM:
+			*tex = base->tex_bottom;
+			break;
+		default:
+			return false;
+	}
+	VEC3_SETV(*color, 1);
+	return true;
+}
+
+static void draw(struct block_def *def, const struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
+{
+	struct block_base *base = (struct block_base*)def;
+	(void)snapshot;
 	struct vec3f color;
 	struct vec3f org;
 	struct vec3f dst;
@@ -126,6 +154,7 @@ static const struct block_def_vtable base_vtable =
 {
 	.draw = draw,
 	.get_destroy_values = block_base_get_destroy_values,
+	.get_face = block_base_get_face,
 };
 
 bool block_base_init(struct blocks_def *blocks, struct block_base *base, uint16_t id, const char *name)
@@ -6,6 +6,7 @@
 #include <jks/aabb.h>
 #include <jks/vec2.h>
 
+struct chunk_snapshot;
 struct tessellator;
 struct blocks_def;
 struct block_def;
@@ -24,8 +25,9 @@ enum block_flag
 struct block_def_vtable
 {
 	void (*destroy)(struct block_def *def);
-	void (*draw)(struct block_def *def, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights);
+	void (*draw)(struct block_def *def, const struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights);
 	void (*get_destroy_values)(struct block_def *def, struct vec2f *uv, struct vec4f *color);
+	bool (*get_face)(struct block_def *def, uint8_t face, struct vec2f *tex, struct vec3f *color);
 	bool (*on_right_click)(struct block_def *def, struct chunk *chunk, struct vec3f pos);
 };
 
@@ -128,5 +130,6 @@ void block_base_set_tex_x(struct block_base *base, float tex_x);
 void block_base_set_tex_y(struct block_base *base, float tex_y);
 
 void block_base_get_destroy_values(struct block_def *def, struct vec2f *uv, struct vec4f *color);
+bool block_base_get_face(struct block_def *def, uint8_t face, struct vec2f *tex, struct vec3f *color);
 
 #endif
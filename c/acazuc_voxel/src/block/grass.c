@@ -38,10 +38,19 @@ static void get_destroy_values(struct block_def *def, struct vec2f *uv, struct v
 	}
 }
 
-static void draw(struct block_def *def, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
+static bool get_face(struct block_def *def, uint8_t face, struct vec2f *tex, struct vec3f *color)
+{
+	if (!block_base_get_face(def, face, tex, color))
+		return false;
+	if (face == BLOCK_FACE_TOP)
+		VEC3_SET(*color, 0.4, 1.0, 0.4);
+	return true;
+}
+
+static void draw(struct block_def *def, const struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
 {
 	struct block_base *base = (struct block_base*)def;
-	(void)chunk;
+	(void)snapshot;
 	struct vec3f color;
 	struct vec3f org;
 	struct vec3f dst;
@@ -132,6 +141,7 @@ static const struct block_def_vtable grass_vtable =
 {
 	.draw = draw,
 	.get_destroy_values = get_destroy_values,
+	.get_face = get_face,
 };
 
 struct block_base *block_grass_new(struct blocks_def *blocks, uint16_t id, const char *name)
@@ -35,10 +35,18 @@ static void get_destroy_values(struct block_def *def, struct vec2f *uv, struct v
 	VEC4_SET(*color, 0.4, 1, 0.4, 1);
 }
 
-static void draw(struct block_def *def, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
+static bool get_face(struct block_def *def, uint8_t face, struct vec2f *tex, struct vec3f *color)
+{
+	if (!block_base_get_face(def, face, tex, color))
+		return false;
+	VEC3_SET(*color, 0.4, 1, 0.4);
+	return true;
+}
+
+static void draw(struct block_def *def, const struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
 {
 	struct block_base *base = (struct block_base*)def;
-	(void)chunk;
+	(void)snapshot;
 	struct vec3f color;
 	VEC3_SET(color, 0.4, 1, 0.4);
 	struct vec3f org;
@@ -126,6 +134,7 @@ static const struct block_def_vtable leaves_vtable =
 {
 	.draw = draw,
 	.get_destroy_values = get_destroy_values,
+	.get_face = get_face,
 };
 
 struct block_base *block_leaves_new(struct blocks_def *blocks, uint16_t id, const char *name)
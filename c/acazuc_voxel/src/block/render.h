@@ -2,65 +2,240 @@
 #define BLOCK_RENDER_H
 
 #include "world/tessellator.h"
+#include "world/block.h"
 
 #include "shaders.h"
 #include "log.h"
 
 #include <stdlib.h>
 
-static inline void add_face_indices(uint32_t *indices, uint32_t current_indice, const uint32_t *idx)
+#define BLOCK_POSITION_SCALE 128
+#define BLOCK_UV_SCALE 256
+#define BLOCK_TILES 16
+
+/*
+ * the quads are pushed as 4 vertexes, drawn with the shared 0 1 2 0 2 3
+ * index pattern of graphics->blocks.indices_buffer; the orders tables pick
+ * the first vertex so that the diagonal used matches the flip argument
+ */
+
+enum block_face_index
 {
-	indices[0] = current_indice + idx[0];
-	indices[1] = current_indice + idx[1];
-	indices[2] = current_indice + idx[2];
-	indices[3] = current_indice + idx[3];
-	indices[4] = current_indice + idx[4];
-	indices[5] = current_indice + idx[5];
+	BLOCK_FACE_INDEX_FRONT,
+	BLOCK_FACE_INDEX_BACK,
+	BLOCK_FACE_INDEX_LEFT,
+	BLOCK_FACE_INDEX_RIGHT,
+	BLOCK_FACE_INDEX_TOP,
+	BLOCK_FACE_INDEX_BOTTOM,
+	BLOCK_FACE_INDEX_DIAG,
+};
+
+static inline uint8_t block_pack_color(float value)
+{
+	if (value <= 0)
+		return 0;
+	if (value >= 1)
+		return 0xFF;
+	return value * 0xFF + .5f;
 }
 
-static inline void add_face_front(struct tessellator *tessellator,
-                                  struct vec3f pos_org,
-                                  struct vec3f pos_dst,
-                                  struct vec2f tex_org,
-                                  struct vec2f tex_dst,
-                                  struct vec3f *colors,
-                                  int flip)
+static inline uint16_t block_pack_position(float value)
+{
+	value = value * BLOCK_POSITION_SCALE + .5f;
+	if (value <= 0)
+		return 0;
+	if (value >= 0xFFFF)
+		return 0xFFFF;
+	return value;
+}
+
+static inline uint8_t block_tile(struct vec2f tex)
+{
+	uint8_t x = tex.x * BLOCK_TILES + .001f;
+	uint8_t y = tex.y * BLOCK_TILES + .001f;
+	return (x & 0xF) | ((y & 0xF) << 4);
+}
+
+static inline void add_quad(struct tessellator *tessellator,
+                            const struct vec3f *positions,
+                            const struct vec3f *colors,
+                            const struct vec2f *uvs,
+                            uint8_t tile,
+                            uint8_t face,
+                            const uint8_t *order)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
 	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
 	if (!vertexes)
 	{
 		LOG_ERROR("allocation failed");
 		abort();
 	}
-	VEC3_SET(vertexes[0].position, pos_org.x, pos_org.y, pos_dst.z);
-	VEC3_SET(vertexes[1].position, pos_org.x, pos_dst.y, pos_dst.z);
-	VEC3_SET(vertexes[2].position, pos_dst.x, pos_dst.y, pos_dst.z);
-	VEC3_SET(vertexes[3].position, pos_dst.x, pos_org.y, pos_dst.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_org.x, tex_dst.y);
-	VEC2_SET(vertexes[1].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[2].uv, tex_dst.x, tex_org.y);
-	VEC2_SET(vertexes[3].uv, tex_dst.x, tex_dst.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 6);
-	if (!indices)
+	for (uint8_t i = 0; i < 4; ++i)
 	{
-		LOG_ERROR("allocation failed");
-		abort();
+		struct shader_blocks_vertex *vertex = &vertexes[i];
+		uint8_t j = order[i];
+		vertex->position[0] = block_pack_position(positions[j].x);
+		vertex->position[1] = block_pack_position(positions[j].y);
+		vertex->position[2] = block_pack_position(positions[j].z);
+		vertex->position[3] = tile | (face << 8);
+		vertex->color[0] = block_pack_color(colors[j].x);
+		vertex->color[1] = block_pack_color(colors[j].y);
+		vertex->color[2] = block_pack_color(colors[j].z);
+		vertex->color[3] = 0xFF;
+		vertex->uv[0] = uvs[j].x * BLOCK_UV_SCALE + .5f;
+		vertex->uv[1] = uvs[j].y * BLOCK_UV_SCALE + .5f;
 	}
-	if (flip)
+}
+
+/* converts uvs from atlas space to the tile holding them */
+static inline uint8_t atlas_to_tile(struct vec2f *uvs)
+{
+	struct vec2f min = uvs[0];
+	for (uint8_t i = 1; i < 4; ++i)
 	{
-		static const uint32_t idx[] = {1, 0, 3, 2, 1, 3};
-		add_face_indices(indices, current_indice, idx);
+		if (uvs[i].x < min.x)
+			min.x = uvs[i].x;
+		if (uvs[i].y < min.y)
+			min.y = uvs[i].y;
 	}
-	else
+	uint8_t tile = block_tile(min);
+	for (uint8_t i = 0; i < 4; ++i)
 	{
-		static const uint32_t idx[] = {2, 0, 3, 2, 1, 0};
-		add_face_indices(indices, current_indice, idx);
+		uvs[i].x = uvs[i].x * BLOCK_TILES - (tile & 0xF);
+		uvs[i].y = uvs[i].y * BLOCK_TILES - (tile >> 4);
 	}
+	return tile;
+}
+
+static inline void add_quad_atlas(struct tessellator *tessellator,
+                                  const struct vec3f *positions,
+                                  const struct vec3f *colors,
+                                  struct vec2f *uvs,
+                                  uint8_t face,
+                                  const uint8_t *order)
+{
+	uint8_t tile = atlas_to_tile(uvs);
+	add_quad(tessellator, positions, colors, uvs, tile, face, order);
+}
+
+static inline void face_front(struct vec3f *positions,
+                              struct vec2f *uvs,
+                              struct vec3f pos_org,
+                              struct vec3f pos_dst,
+                              struct vec2f tex_org,
+                              struct vec2f tex_dst)
+{
+	VEC3_SET(positions[0], pos_org.x, pos_org.y, pos_dst.z);
+	VEC3_SET(positions[1], pos_org.x, pos_dst.y, pos_dst.z);
+	VEC3_SET(positions[2], pos_dst.x, pos_dst.y, pos_dst.z);
+	VEC3_SET(positions[3], pos_dst.x, pos_org.y, pos_dst.z);
+	VEC2_SET(uvs[0], tex_org.x, tex_dst.y);
+	VEC2_SET(uvs[1], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[2], tex_dst.x, tex_org.y);
+	VEC2_SET(uvs[3], tex_dst.x, tex_dst.y);
+}
+
+static inline void face_back(struct vec3f *positions,
+                             struct vec2f *uvs,
+                             struct vec3f pos_org,
+                             struct vec3f pos_dst,
+                             struct vec2f tex_org,
+                             struct vec2f tex_dst)
+{
+	VEC3_SET(positions[0], pos_org.x, pos_org.y, pos_org.z);
+	VEC3_SET(positions[1], pos_org.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[2], pos_dst.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[3], pos_dst.x, pos_org.y, pos_org.z);
+	VEC2_SET(uvs[0], tex_dst.x, tex_dst.y);
+	VEC2_SET(uvs[1], tex_dst.x, tex_org.y);
+	VEC2_SET(uvs[2], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[3], tex_org.x, tex_dst.y);
+}
+
+static inline void face_left(struct vec3f *positions,
+                             struct vec2f *uvs,
+                             struct vec3f pos_org,
+                             struct vec3f pos_dst,
+                             struct vec2f tex_org,
+                             struct vec2f tex_dst)
+{
+	VEC3_SET(positions[0], pos_org.x, pos_org.y, pos_org.z);
+	VEC3_SET(positions[1], pos_org.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[2], pos_org.x, pos_dst.y, pos_dst.z);
+	VEC3_SET(positions[3], pos_org.x, pos_org.y, pos_dst.z);
+	VEC2_SET(uvs[0], tex_org.x, tex_dst.y);
+	VEC2_SET(uvs[1], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[2], tex_dst.x, tex_org.y);
+	VEC2_SET(uvs[3], tex_dst.x, tex_dst.y);
+}
+
+static inline void face_right(struct vec3f *positions,
+                              struct vec2f *uvs,
+                              struct vec3f pos_org,
+                              struct vec3f pos_dst,
+                              struct vec2f tex_org,
+                              struct vec2f tex_dst)
+{
+	VEC3_SET(positions[0], pos_dst.x, pos_org.y, pos_org.z);
+	VEC3_SET(positions[1], pos_dst.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[2], pos_dst.x, pos_dst.y, pos_dst.z);
+	VEC3_SET(positions[3], pos_dst.x, pos_org.y, pos_dst.z);
+	VEC2_SET(uvs[0], tex_dst.x, tex_dst.y);
+	VEC2_SET(uvs[1], tex_dst.x, tex_org.y);
+	VEC2_SET(uvs[2], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[3], tex_org.x, tex_dst.y);
+}
+
+static inline void face_up(struct vec3f *positions,
+                           struct vec2f *uvs,
+                           struct vec3f pos_org,
+                           struct vec3f pos_dst,
+                           struct vec2f tex_org,
+                           struct vec2f tex_dst)
+{
+	VEC3_SET(positions[0], pos_org.x, pos_dst.y, pos_dst.z);
+	VEC3_SET(positions[1], pos_org.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[2], pos_dst.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[3], pos_dst.x, pos_dst.y, pos_dst.z);
+	VEC2_SET(uvs[0], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[1], tex_org.x, tex_dst.y);
+	VEC2_SET(uvs[2], tex_dst.x, tex_dst.y);
+	VEC2_SET(uvs[3], tex_dst.x, tex_org.y);
+}
+
+static inline void face_down(struct vec3f *positions,
+                             struct vec2f *uvs,
+                             struct vec3f pos_org,
+                             struct vec3f pos_dst,
+                             struct vec2f tex_org,
+                             struct vec2f tex_dst)
+{
+	VEC3_SET(positions[0], pos_org.x, pos_org.y, pos_dst.z);
+	VEC3_SET(positions[1], pos_org.x, pos_org.y, pos_org.z);
+	VEC3_SET(positions[2], pos_dst.x, pos_org.y, pos_org.z);
+	VEC3_SET(positions[3], pos_dst.x, pos_org.y, pos_dst.z);
+	VEC2_SET(uvs[0], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[1], tex_org.x, tex_dst.y);
+	VEC2_SET(uvs[2], tex_dst.x, tex_dst.y);
+	VEC2_SET(uvs[3], tex_dst.x, tex_org.y);
+}
+
+static const uint8_t front_orders[2][4] = {{0, 3, 2, 1}, {1, 0, 3, 2}};
+static const uint8_t back_orders[2][4] = {{1, 2, 3, 0}, {0, 1, 2, 3}};
+static const uint8_t down_orders[2][4] = {{1, 2, 3, 0}, {0, 1, 2, 3}};
+
+static inline void add_face_front(struct tessellator *tessellator,
+                                  struct vec3f pos_org,
+                                  struct vec3f pos_dst,
+                                  struct vec2f tex_org,
+                                  struct vec2f tex_dst,
+                                  struct vec3f *colors,
+                                  int flip)
+{
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	face_front(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+	add_quad_atlas(tessellator, positions, colors, uvs, BLOCK_FACE_INDEX_FRONT, front_orders[flip ? 1 : 0]);
 }
 
 static inline void add_face_back(struct tessellator *tessellator,
@@ -71,41 +246,10 @@ static inline void add_face_back(struct tessellator *tessellator,
                                  struct vec3f *colors,
                                  int flip)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
-	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
-	if (!vertexes)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	VEC3_SET(vertexes[0].position, pos_org.x, pos_org.y, pos_org.z);
-	VEC3_SET(vertexes[1].position, pos_org.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[2].position, pos_dst.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[3].position, pos_dst.x, pos_org.y, pos_org.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_dst.x, tex_dst.y);
-	VEC2_SET(vertexes[1].uv, tex_dst.x, tex_org.y);
-	VEC2_SET(vertexes[2].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[3].uv, tex_org.x, tex_dst.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 6);
-	if (!indices)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	if (flip)
-	{
-		static const uint32_t idx[] = {2, 3, 0, 1, 2, 0};
-		add_face_indices(indices, current_indice, idx);
-	}
-	else
-	{
-		static const uint32_t idx[] = {1, 3, 0, 1, 2, 3};
-		add_face_indices(indices, current_indice, idx);
-	}
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	face_back(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+	add_quad_atlas(tessellator, positions, colors, uvs, BLOCK_FACE_INDEX_BACK, back_orders[flip ? 1 : 0]);
 }
 
 static inline void add_face_left(struct tessellator *tessellator,
@@ -116,41 +260,10 @@ static inline void add_face_left(struct tessellator *tessellator,
                                  struct vec3f *colors,
                                  int flip)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
-	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
-	if (!vertexes)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	VEC3_SET(vertexes[0].position, pos_org.x, pos_org.y, pos_org.z);
-	VEC3_SET(vertexes[1].position, pos_org.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[2].position, pos_org.x, pos_dst.y, pos_dst.z);
-	VEC3_SET(vertexes[3].position, pos_org.x, pos_org.y, pos_dst.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_org.x, tex_dst.y);
-	VEC2_SET(vertexes[1].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[2].uv, tex_dst.x, tex_org.y);
-	VEC2_SET(vertexes[3].uv, tex_dst.x, tex_dst.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 6);
-	if (!indices)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	if (flip)
-	{
-		static const uint32_t idx[] = {1, 0, 3, 2, 1, 3};
-		add_face_indices(indices, current_indice, idx);
-	}
-	else
-	{
-		static const uint32_t idx[] = {2, 0, 3, 2, 1, 0};
-		add_face_indices(indices, current_indice, idx);
-	}
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	face_left(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+	add_quad_atlas(tessellator, positions, colors, uvs, BLOCK_FACE_INDEX_LEFT, front_orders[flip ? 1 : 0]);
 }
 
 static inline void add_face_right(struct tessellator *tessellator,
@@ -161,41 +274,10 @@ static inline void add_face_right(struct tessellator *tessellator,
                                   struct vec3f *colors,
                                   int flip)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
-	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
-	if (!vertexes)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	VEC3_SET(vertexes[0].position, pos_dst.x, pos_org.y, pos_org.z);
-	VEC3_SET(vertexes[1].position, pos_dst.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[2].position, pos_dst.x, pos_dst.y, pos_dst.z);
-	VEC3_SET(vertexes[3].position, pos_dst.x, pos_org.y, pos_dst.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_dst.x, tex_dst.y);
-	VEC2_SET(vertexes[1].uv, tex_dst.x, tex_org.y);
-	VEC2_SET(vertexes[2].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[3].uv, tex_org.x, tex_dst.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 6);
-	if (!indices)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	if (flip)
-	{
-		static const uint32_t idx[] = {2, 3, 0, 1, 2, 0};
-		add_face_indices(indices, current_indice, idx);
-	}
-	else
-	{
-		static const uint32_t idx[] = {1, 3, 0, 1, 2, 3};
-		add_face_indices(indices, current_indice, idx);
-	}
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	face_right(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+	add_quad_atlas(tessellator, positions, colors, uvs, BLOCK_FACE_INDEX_RIGHT, back_orders[flip ? 1 : 0]);
 }
 
 static inline void add_face_up(struct tessellator *tessellator,
@@ -206,41 +288,10 @@ static inline void add_face_up(struct tessellator *tessellator,
                                struct vec3f *colors,
                                int flip)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
-	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
-	if (!vertexes)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	VEC3_SET(vertexes[0].position, pos_org.x, pos_dst.y, pos_dst.z);
-	VEC3_SET(vertexes[1].position, pos_org.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[2].position, pos_dst.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[3].position, pos_dst.x, pos_dst.y, pos_dst.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[1].uv, tex_org.x, tex_dst.y);
-	VEC2_SET(vertexes[2].uv, tex_dst.x, tex_dst.y);
-	VEC2_SET(vertexes[3].uv, tex_dst.x, tex_org.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 6);
-	if (!indices)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	if (flip)
-	{
-		static const uint32_t idx[] = {1, 0, 3, 2, 1, 3};
-		add_face_indices(indices, current_indice, idx);
-	}
-	else
-	{
-		static const uint32_t idx[] = {2, 0, 3, 2, 1, 0};
-		add_face_indices(indices, current_indice, idx);
-	}
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	face_up(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+	add_quad_atlas(tessellator, positions, colors, uvs, BLOCK_FACE_INDEX_TOP, front_orders[flip ? 1 : 0]);
 }
 
 static inline void add_face_down(struct tessellator *tessellator,
@@ -251,43 +302,13 @@ static inline void add_face_down(struct tessellator *tessellator,
                                  struct vec3f *colors,
                                  int flip)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
-	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
-	if (!vertexes)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	VEC3_SET(vertexes[0].position, pos_org.x, pos_org.y, pos_dst.z);
-	VEC3_SET(vertexes[1].position, pos_org.x, pos_org.y, pos_org.z);
-	VEC3_SET(vertexes[2].position, pos_dst.x, pos_org.y, pos_org.z);
-	VEC3_SET(vertexes[3].position, pos_dst.x, pos_org.y, pos_dst.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[1].uv, tex_org.x, tex_dst.y);
-	VEC2_SET(vertexes[2].uv, tex_dst.x, tex_dst.y);
-	VEC2_SET(vertexes[3].uv, tex_dst.x, tex_org.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 6);
-	if (!indices)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	if (flip)
-	{
-		static const uint32_t idx[] = {0, 1, 2, 3, 0, 2};
-		add_face_indices(indices, current_indice, idx);
-	}
-	else
-	{
-		static const uint32_t idx[] = {3, 1, 2, 3, 0, 1};
-		add_face_indices(indices, current_indice, idx);
-	}
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	face_down(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+	add_quad_atlas(tessellator, positions, colors, uvs, BLOCK_FACE_INDEX_BOTTOM, down_orders[flip ? 1 : 0]);
 }
 
+/* two sided, pushed as two quads of opposite winding */
 static inline void add_face_diag(struct tessellator *tessellator,
                                  struct vec3f pos_org,
                                  struct vec3f pos_dst,
@@ -295,38 +316,72 @@ static inline void add_face_diag(struct tessellator *tessellator,
                                  struct vec2f tex_dst,
                                  struct vec3f *colors)
 {
-	uint32_t current_indice = tessellator->vertexes.size;
-	struct shader_blocks_vertex *vertexes = jks_array_grow(&tessellator->vertexes, 4);
-	if (!vertexes)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	VEC3_SET(vertexes[0].position, pos_org.x, pos_org.y, pos_org.z);
-	VEC3_SET(vertexes[1].position, pos_org.x, pos_dst.y, pos_org.z);
-	VEC3_SET(vertexes[2].position, pos_dst.x, pos_dst.y, pos_dst.z);
-	VEC3_SET(vertexes[3].position, pos_dst.x, pos_org.y, pos_dst.z);
-	VEC3_CPY(vertexes[0].color, colors[0]);
-	VEC3_CPY(vertexes[1].color, colors[1]);
-	VEC3_CPY(vertexes[2].color, colors[2]);
-	VEC3_CPY(vertexes[3].color, colors[3]);
-	VEC2_SET(vertexes[0].uv, tex_org.x, tex_dst.y);
-	VEC2_SET(vertexes[1].uv, tex_org.x, tex_org.y);
-	VEC2_SET(vertexes[2].uv, tex_dst.x, tex_org.y);
-	VEC2_SET(vertexes[3].uv, tex_dst.x, tex_dst.y);
-	uint32_t *indices = jks_array_grow(&tessellator->indices, 12);
-	if (!indices)
-	{
-		LOG_ERROR("allocation failed");
-		abort();
-	}
-	{
-		static const uint32_t idx[] = {1, 0, 3, 2, 1, 3};
-		add_face_indices(&indices[0], current_indice, idx);
-	}
+	static const uint8_t orders[2][4] = {{1, 0, 3, 2}, {1, 2, 3, 0}};
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	VEC3_SET(positions[0], pos_org.x, pos_org.y, pos_org.z);
+	VEC3_SET(positions[1], pos_org.x, pos_dst.y, pos_org.z);
+	VEC3_SET(positions[2], pos_dst.x, pos_dst.y, pos_dst.z);
+	VEC3_SET(positions[3], pos_dst.x, pos_org.y, pos_dst.z);
+	VEC2_SET(uvs[0], tex_org.x, tex_dst.y);
+	VEC2_SET(uvs[1], tex_org.x, tex_org.y);
+	VEC2_SET(uvs[2], tex_dst.x, tex_org.y);
+	VEC2_SET(uvs[3], tex_dst.x, tex_dst.y);
+	uint8_t tile = atlas_to_tile(uvs);
+	add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_DIAG, orders[0]);
+	add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_DIAG, orders[1]);
+}
+
+/*
+ * face covering several blocks with a single uniformly lit tile, as
+ * produced by the greedy merge: the tile is repeated once per block,
+ * oriented as with the add_face_* of a single block
+ */
+static inline void add_face_tiled(struct tessellator *tessellator,
+                                  uint8_t face,
+                                  struct vec3f pos_org,
+                                  struct vec3f pos_dst,
+                                  uint8_t tile,
+                                  struct vec3f color)
+{
+	struct vec3f colors[4] = {color, color, color, color};
+	struct vec3f positions[4];
+	struct vec2f uvs[4];
+	struct vec2f tex_org;
+	struct vec2f tex_dst;
+	VEC2_SET(tex_org, 0, 0);
+	switch (face)
 	{
-		static const uint32_t idx[] = {3, 0, 1, 3, 1, 2};
-		add_face_indices(&indices[6], current_indice, idx);
+		case BLOCK_FACE_FRONT:
+			VEC2_SET(tex_dst, pos_dst.x - pos_org.x, pos_dst.y - pos_org.y);
+			face_front(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+			add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_FRONT, front_orders[0]);
+			break;
+		case BLOCK_FACE_BACK:
+			VEC2_SET(tex_dst, pos_dst.x - pos_org.x, pos_dst.y - pos_org.y);
+			face_back(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+			add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_BACK, back_orders[0]);
+			break;
+		case BLOCK_FACE_LEFT:
+			VEC2_SET(tex_dst, pos_dst.z - pos_org.z, pos_dst.y - pos_org.y);
+			face_left(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+			add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_LEFT, front_orders[0]);
+			break;
+		case BLOCK_FACE_RIGHT:
+			VEC2_SET(tex_dst, pos_dst.z - pos_org.z, pos_dst.y - pos_org.y);
+			face_right(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+			add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_RIGHT, back_orders[0]);
+			break;
+		case BLOCK_FACE_TOP:
+			VEC2_SET(tex_dst, pos_dst.x - pos_org.x, pos_dst.z - pos_org.z);
+			face_up(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+			add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_TOP, front_orders[0]);
+			break;
+		case BLOCK_FACE_BOTTOM:
+			VEC2_SET(tex_dst, pos_dst.x - pos_org.x, pos_dst.z - pos_org.z);
+			face_down(positions, uvs, pos_org, pos_dst, tex_org, tex_dst);
+			add_quad(tessellator, positions, colors, uvs, tile, BLOCK_FACE_INDEX_BOTTOM, down_orders[0]);
+			break;
 	}
 }
 
@@ -2,8 +2,8 @@
 #include "block/block.h"
 
 #include "world/tessellator.h"
+#include "world/snapshot.h"
 #include "world/block.h"
-#include "world/chunk.h"
 
 #include "shaders.h"
 #include "voxel.h"
@@ -18,7 +18,7 @@ static void get_destroy_values(struct block_def *def, struct vec2f *uv, struct v
 	VEC4_SET(*color, 1, 1, 1, 1);
 }
 
-static void draw(struct block_def *def, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
+static void draw(struct block_def *def, const struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
 {
 	struct block_sapling *sapling = (struct block_sapling*)def;
 	(void)visible_faces;
@@ -33,7 +33,7 @@ static void draw(struct block_def *def, struct chunk *chunk, struct vec3f pos, s
 	VEC3_SET(dst, pos.x + BLOCK_SIZE - diff, pos.y + BLOCK_SIZE, pos.z + BLOCK_SIZE - diff);
 	VEC2_CPY(tex_org, sapling->tex);
 	VEC2_ADDV(tex_dst, tex_org, tex_size);
-	float light_value = voxel_light_value(chunk_get_light(chunk, pos.x - chunk->x, pos.y, pos.z - chunk->z));
+	float light_value = voxel_light_value(chunk_snapshot_get_light(snapshot, pos.x, pos.y, pos.z));
 	VEC3_SETV(color, light_value);
 	{
 		struct vec3f forg = {org.x, org.y, org.z};
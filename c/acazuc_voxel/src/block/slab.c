@@ -6,10 +6,10 @@
 
 static const float tex_size = 1.0 / 16;
 
-static void draw(struct block_def *def, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
+static void draw(struct block_def *def, const struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t visible_faces, float *lights)
 {
 	struct block_base *base = (struct block_base*)def;
-	(void)chunk;
+	(void)snapshot;
 	struct vec3f color;
 	VEC3_SETV(color, 1);
 	struct vec3f org;
@@ -1,3 +1,5 @@
+#include "world/chunk.h"
+
 #include "graphics.h"
 #include "shaders.h"
 #include "voxel.h"
@@ -167,10 +169,11 @@ static bool build_blocks(struct graphics_blocks *blocks)
 {
 	static const struct gfx_input_layout_bind binds[] =
 	{
-		{0, GFX_ATTR_R32G32B32_FLOAT, sizeof(struct shader_blocks_vertex), offsetof(struct shader_blocks_vertex, position)},
-		{0, GFX_ATTR_R32G32B32_FLOAT, sizeof(struct shader_blocks_vertex), offsetof(struct shader_blocks_vertex, color)},
-		{0, GFX_ATTR_R32G32_FLOAT   , sizeof(struct shader_blocks_vertex), offsetof(struct shader_blocks_vertex, uv)},
+		{0, GFX_ATTR_R16G16B16A16_UINT, sizeof(struct shader_blocks_vertex), offsetof(struct shader_blocks_vertex, position)},
+		{0, GFX_ATTR_R8G8B8A8_UNORM    , sizeof(struct shader_blocks_vertex), offsetof(struct shader_blocks_vertex, color)},
+		{0, GFX_ATTR_R16G16_UINT       , sizeof(struct shader_blocks_vertex), offsetof(struct shader_blocks_vertex, uv)},
 	};
+	uint32_t *indices;
 
 	gfx_create_depth_stencil_state(g_voxel->device, &blocks->depth_stencil_state, true, true, GFX_CMP_LEQUAL, false, 0, GFX_CMP_ALWAYS, 0, 0, GFX_STENCIL_KEEP, GFX_STENCIL_KEEP, GFX_STENCIL_KEEP);
 	gfx_create_rasterizer_state(g_voxel->device, &blocks->first_rasterizer_state, GFX_FILL_SOLID, GFX_CULL_BACK, GFX_FRONT_CCW, false);
@@ -179,11 +182,35 @@ static bool build_blocks(struct graphics_blocks *blocks)
 	gfx_create_blend_state(g_voxel->device, &blocks->blend_state, false, GFX_BLEND_SRC_ALPHA, GFX_BLEND_ONE_MINUS_SRC_ALPHA, GFX_BLEND_SRC_ALPHA, GFX_BLEND_ONE_MINUS_SRC_ALPHA, GFX_EQUATION_ADD, GFX_EQUATION_ADD, GFX_COLOR_MASK_ALL);
 	gfx_create_pipeline_state(g_voxel->device, &blocks->first_pipeline_state, &g_voxel->shaders->blocks, &blocks->first_rasterizer_state, &blocks->depth_stencil_state, &blocks->blend_state, &blocks->input_layout, GFX_PRIMITIVE_TRIANGLES);
 	gfx_create_pipeline_state(g_voxel->device, &blocks->second_pipeline_state, &g_voxel->shaders->blocks, &blocks->second_rasterizer_state, &blocks->depth_stencil_state, &blocks->blend_state, &blocks->input_layout, GFX_PRIMITIVE_TRIANGLES);
+	indices = malloc(sizeof(*indices) * CHUNK_MAX_QUADS * 6);
+	if (!indices)
+	{
+		LOG_ERROR("indices allocation failed");
+		return false;
+	}
+	for (uint32_t i = 0; i < CHUNK_MAX_QUADS; ++i)
+	{
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 0;
+		indices[i * 6 + 4] = i * 4 + 2;
+		indices[i * 6 + 5] = i * 4 + 3;
+	}
+	blocks->indices_buffer = GFX_BUFFER_INIT();
+	if (!gfx_create_buffer(g_voxel->device, &blocks->indices_buffer, GFX_BUFFER_INDICES, indices, sizeof(*indices) * CHUNK_MAX_QUADS * 6, GFX_BUFFER_IMMUTABLE))
+	{
+		LOG_ERROR("failed to create blocks indices buffer");
+		free(indices);
+		return false;
+	}
+	free(indices);
 	return true;
 }
 
 static void clean_blocks(struct graphics_blocks *blocks)
 {
+	gfx_delete_buffer(g_voxel->device, &blocks->indices_buffer);
 	gfx_delete_pipeline_state(g_voxel->device, &blocks->first_pipeline_state);
 	gfx_delete_pipeline_state(g_voxel->device, &blocks->second_pipeline_state);
 	gfx_delete_blend_state(g_voxel->device, &blocks->blend_state);
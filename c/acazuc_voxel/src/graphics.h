@@ -68,6 +68,7 @@ struct graphics_blocks
 	gfx_blend_state_t blend_state;
 	gfx_pipeline_state_t first_pipeline_state;
 	gfx_pipeline_state_t second_pipeline_state;
+	gfx_buffer_t indices_buffer; /* shared by all the chunks, 0 1 2 0 2 3 per quad */
 };
 
 struct graphics_entity
@@ -1,9 +1,15 @@
 #include "simplex_octave.h"
 #include "simplex.h"
+#include "voxel.h"
 #include "log.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#define BENCHMARK_SIZE 256
+#define BENCHMARK_ROUNDS 8
+
 bool simplex_noise_init(struct simplex_noise *simplex_noise, uint32_t octaves_number, float persistance, int32_t seed)
 {
 	jks_array_init(&simplex_noise->frequencies, sizeof(float), NULL, NULL);
@@ -66,6 +72,40 @@ float simplex_noise_get2(struct simplex_noise *simplex_noise, float x, float y)
 	return result;
 }
 
+void simplex_noise_get2_batch(struct simplex_noise *simplex_noise, const float *x, const float *y, float *out, size_t count)
+{
+	memset(out, 0, sizeof(*out) * count);
+	for (uint32_t i = 0; i < simplex_noise->octaves.size; ++i)
+	{
+		float frequency = *JKS_ARRAY_GET(&simplex_noise->frequencies, i, float);
+		float amplitude = *JKS_ARRAY_GET(&simplex_noise->amplitudes, i, float);
+		simplex_noise_octave_get2_batch(JKS_ARRAY_GET(&simplex_noise->octaves, i, struct simplex_noise_octave), x, y, frequency, amplitude, out, count);
+	}
+}
+
+void simplex_noise_get2_grid(struct simplex_noise *simplex_noise, float x, float y, float step, uint32_t width, uint32_t height, float *out)
+{
+	float xs[256];
+	float ys[256];
+	size_t count = 0;
+	size_t base = 0;
+	for (uint32_t i = 0; i < width; ++i)
+	{
+		for (uint32_t j = 0; j < height; ++j)
+		{
+			xs[count] = x + i * step;
+			ys[count] = y + j * step;
+			if (++count != sizeof(xs) / sizeof(*xs))
+				continue;
+			simplex_noise_get2_batch(simplex_noise, xs, ys, &out[base], count);
+			base += count;
+			count = 0;
+		}
+	}
+	if (count)
+		simplex_noise_get2_batch(simplex_noise, xs, ys, &out[base], count);
+}
+
 float simplex_noise_get3(struct simplex_noise *simplex_noise, float x, float y, float z)
 {
 	float result = 0;
@@ -89,3 +129,58 @@ float simplex_noise_get4(struct simplex_noise *simplex_noise, float x, float y,
 	}
 	return result;
 }
+
+static void benchmark_print(const char *name, uint64_t duration)
+{
+	double samples = (double)BENCHMARK_SIZE * BENCHMARK_SIZE * BENCHMARK_ROUNDS;
+	LOG_INFO("%-6s: %.2f Msamples/s", name, duration ? samples * 1000.0 / duration : 0.0);
+}
+
+void simplex_noise_benchmark(struct simplex_noise *simplex_noise)
+{
+	const size_t count = BENCHMARK_SIZE * BENCHMARK_SIZE;
+	float *xs = malloc(sizeof(*xs) * count);
+	float *ys = malloc(sizeof(*ys) * count);
+	float *scalar = malloc(sizeof(*scalar) * count);
+	float *out = malloc(sizeof(*out) * count);
+	if (!xs || !ys || !scalar || !out)
+	{
+		LOG_ERROR("allocation failed");
+		goto end;
+	}
+	for (uint32_t i = 0; i < BENCHMARK_SIZE; ++i)
+	{
+		for (uint32_t j = 0; j < BENCHMARK_SIZE; ++j)
+		{
+			xs[i * BENCHMARK_SIZE + j] = i;
+			ys[i * BENCHMARK_SIZE + j] = j;
+		}
+	}
+	uint64_t started = nanotime();
+	for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+	{
+		for (size_t i = 0; i < count; ++i)
+			scalar[i] = simplex_noise_get2(simplex_noise, xs[i], ys[i]);
+	}
+	benchmark_print("scalar", nanotime() - started);
+	started = nanotime();
+	for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+		simplex_noise_get2_batch(simplex_noise, xs, ys, out, count);
+	benchmark_print("batch", nanotime() - started);
+	float max_diff = 0;
+	for (size_t i = 0; i < count; ++i)
+		max_diff = fmaxf(max_diff, fabsf(out[i] - scalar[i]));
+	started = nanotime();
+	for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+		simplex_noise_get2_grid(simplex_noise, 0, 0, 1, BENCHMARK_SIZE, BENCHMARK_SIZE, out);
+	benchmark_print("grid", nanotime() - started);
+	for (size_t i = 0; i < count; ++i)
+		max_diff = fmaxf(max_diff, fabsf(out[i] - scalar[i]));
+	LOG_INFO("max difference to scalar: %g", max_diff);
+
+end:
+	free(xs);
+	free(ys);
+	free(scalar);
+	free(out);
+}
@@ -16,7 +16,11 @@ bool simplex_noise_init(struct simplex_noise *simplex_noise, uint32_t octaves_nu
 void simplex_noise_destroy(struct simplex_noise *simplex_noise);
 float simplex_noise_get1(struct simplex_noise *simplex_noise, float x);
 float simplex_noise_get2(struct simplex_noise *simplex_noise, float x, float y);
+void simplex_noise_get2_batch(struct simplex_noise *simplex_noise, const float *x, const float *y, float *out, size_t count);
+/* out[i * height + j] is the noise at (x + i * step, y + j * step) */
+void simplex_noise_get2_grid(struct simplex_noise *simplex_noise, float x, float y, float step, uint32_t width, uint32_t height, float *out);
 float simplex_noise_get3(struct simplex_noise *simplex_noise, float x, float y, float z);
 float simplex_noise_get4(struct simplex_noise *simplex_noise, float x, float y, float z, float w);
+void simplex_noise_benchmark(struct simplex_noise *simplex_noise);
 
 #endif
@@ -4,6 +4,10 @@
 
 #include <string.h>
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #define NUMBEROFSWAPS 4000
 
 #define F2 0.36602540378443864676f //.5 * (sqrt(3) - 1);
@@ -203,6 +207,91 @@ float simplex_noise_octave_get2(struct simplex_noise_octave *octave, float xin,
 	return 70 * (n0 + n1 + n2);
 }
 
+#ifdef __SSE2__
+static __m128i floor4(__m128 v)
+{
+	__m128i vi = _mm_cvttps_epi32(v);
+	__m128 below = _mm_cmplt_ps(v, _mm_cvtepi32_ps(vi));
+	return _mm_add_epi32(vi, _mm_castps_si128(below));
+}
+
+static __m128 corner2(__m128 x, __m128 y, const float *gx, const float *gy)
+{
+	__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+	t = _mm_max_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	t = _mm_mul_ps(t, t);
+	__m128 dot = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx), x), _mm_mul_ps(_mm_loadu_ps(gy), y));
+	return _mm_mul_ps(t, dot);
+}
+
+/*
+ * 4 samples per iteration: the skew, the corner offsets, the falloff and the
+ * accumulation are vectorized, the permutation lookups are gathered per lane
+ */
+static size_t get2_batch_sse2(struct simplex_noise_octave *octave, const float *xs, const float *ys, float frequency, float amplitude, float *out, size_t count)
+{
+	__m128 freq = _mm_set1_ps(frequency);
+	__m128 amp = _mm_set1_ps(amplitude * 70);
+	__m128 one = _mm_set1_ps(1);
+	__m128 g2 = _mm_set1_ps(G2);
+	size_t n;
+	for (n = 0; n + 4 <= count; n += 4)
+	{
+		__m128 xin = _mm_div_ps(_mm_loadu_ps(&xs[n]), freq);
+		__m128 yin = _mm_div_ps(_mm_loadu_ps(&ys[n]), freq);
+		__m128 s = _mm_mul_ps(_mm_add_ps(xin, yin), _mm_set1_ps(F2));
+		__m128i i = floor4(_mm_add_ps(xin, s));
+		__m128i j = floor4(_mm_add_ps(yin, s));
+		__m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), g2);
+		__m128 x0 = _mm_sub_ps(xin, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+		__m128 y0 = _mm_sub_ps(yin, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+		__m128 upper = _mm_cmpgt_ps(x0, y0);
+		__m128 i1 = _mm_and_ps(upper, one);
+		__m128 j1 = _mm_andnot_ps(upper, one);
+		__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), g2);
+		__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, j1), g2);
+		__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_set1_ps(2 * G2));
+		__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_set1_ps(2 * G2));
+		int32_t ii[4];
+		int32_t jj[4];
+		int32_t upper_mask[4];
+		_mm_storeu_si128((__m128i*)ii, _mm_and_si128(i, _mm_set1_epi32(0xFF)));
+		_mm_storeu_si128((__m128i*)jj, _mm_and_si128(j, _mm_set1_epi32(0xFF)));
+		_mm_storeu_si128((__m128i*)upper_mask, _mm_castps_si128(upper));
+		float gx[3][4];
+		float gy[3][4];
+		for (size_t k = 0; k < 4; ++k)
+		{
+			uint8_t ik = upper_mask[k] ? 1 : 0;
+			uint8_t gi0 = octave->perm_mod12[ii[k] + 0  + octave->perm[jj[k] + 0     ]];
+			uint8_t gi1 = octave->perm_mod12[ii[k] + ik + octave->perm[jj[k] + 1 - ik]];
+			uint8_t gi2 = octave->perm_mod12[ii[k] + 1  + octave->perm[jj[k] + 1     ]];
+			gx[0][k] = g_grad3[gi0].x;
+			gy[0][k] = g_grad3[gi0].y;
+			gx[1][k] = g_grad3[gi1].x;
+			gy[1][k] = g_grad3[gi1].y;
+			gx[2][k] = g_grad3[gi2].x;
+			gy[2][k] = g_grad3[gi2].y;
+		}
+		__m128 sum = _mm_add_ps(corner2(x0, y0, gx[0], gy[0]), corner2(x1, y1, gx[1], gy[1]));
+		sum = _mm_add_ps(sum, corner2(x2, y2, gx[2], gy[2]));
+		_mm_storeu_ps(&out[n], _mm_add_ps(_mm_loadu_ps(&out[n]), _mm_mul_ps(sum, amp)));
+	}
+	return n;
+}
+#endif
+
+void simplex_noise_octave_get2_batch(struct simplex_noise_octave *octave, const float *x, const float *y, float frequency, float amplitude, float *out, size_t count)
+{
+	size_t n = 0;
+#ifdef __SSE2__
+	n = get2_batch_sse2(octave, x, y, frequency, amplitude, out, count);
+#endif
+	for (; n < count; ++n)
+		out[n] += simplex_noise_octave_get2(octave, x[n] / frequency, y[n] / frequency) * amplitude;
+}
+
 float simplex_noise_octave_get3(struct simplex_noise_octave *octave, float xin, float yin, float zin)
 {
 	float n0;
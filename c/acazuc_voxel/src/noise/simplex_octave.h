@@ -1,6 +1,7 @@
 #ifndef SIMPLEX_NOISE_OCTAVE_H
 #define SIMPLEX_NOISE_OCTAVE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct simplex_noise_octave
@@ -12,6 +13,8 @@ struct simplex_noise_octave
 void simplex_noise_octave_init(struct simplex_noise_octave *octave, uint64_t seed);
 float simplex_noise_octave_get1(struct simplex_noise_octave *octave, float x);
 float simplex_noise_octave_get2(struct simplex_noise_octave *octave, float x, float y);
+/* adds the noise at (x / frequency, y / frequency) times amplitude to out */
+void simplex_noise_octave_get2_batch(struct simplex_noise_octave *octave, const float *x, const float *y, float frequency, float amplitude, float *out, size_t count);
 float simplex_noise_octave_get3(struct simplex_noise_octave *octave, float x, float y, float z);
 float simplex_noise_octave_get4(struct simplex_noise_octave *octave, float x, float y, float z, float w);
 
@@ -257,6 +257,7 @@ static bool build_blocks(gfx_shader_state_t *shader_state)
 	static const struct gfx_shader_constant constants[] =
 	{
 		{"model_block", 1},
+		{"chunk_block", 2},
 		{NULL, 0},
 	};
 	static const struct gfx_shader_sampler samplers[] =
@@ -107,11 +107,23 @@ struct shader_blocks_model_block
 	int32_t disable_tex;
 };
 
+struct shader_blocks_chunk_block
+{
+	struct vec4f position;
+};
+
+/*
+ * position is chunk local in 1 / 128 block units, w holds the atlas tile
+ * (x | y << 4) in the low byte and the face index in the high byte
+ *
+ * uv is relative to the tile, in 1 / 256 tile units, and repeats the tile
+ * when going over 1 so merged faces can span several blocks
+ */
 struct shader_blocks_vertex
 {
-	struct vec3f position;
-	struct vec3f color;
-	struct vec2f uv;
+	uint16_t position[4];
+	uint8_t color[4];
+	uint16_t uv[2];
 };
 
 struct shader_clouds_model_block
@@ -41,6 +41,7 @@ struct voxel
 	bool ssao;
 	bool grabbed;
 	bool vsync;
+	uint64_t chunk_generations;
 	uint64_t chunk_updates;
 	uint64_t fps;
 	float delta;
@@ -1,6 +1,7 @@
+#include "world/snapshot.h"
 #include "world/block.h"
-#include "world/chunk.h"
 
+#include "block/render.h"
 #include "block/blocks.h"
 #include "block/block.h"
 
@@ -96,14 +97,15 @@
 
 static bool should_render_face_near(struct block block, struct block neighboor);
 static void init_lights_levels(struct block_lights_levels *lights, uint8_t visible_faces, int8_t *blocks_lights);
-static void calc_visible_faces(struct block block, struct chunk *chunk, struct vec3f pos, uint8_t *visible_faces);
-static int8_t calc_light_level(struct chunk *chunk, struct vec3f pos, int8_t add_x, int8_t add_y, int8_t add_z);
-static bool calc_transparent(struct chunk *chunk, struct vec3f pos, int8_t add_x, int8_t add_y, int8_t add_z);
+static void calc_visible_faces(struct block block, const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z, uint8_t *visible_faces);
+static int8_t calc_light_level(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z);
+static bool calc_transparent(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z);
 static void calc_ambient_occlusion(struct vec3f pos, struct block_lights_levels *lights, uint8_t visible_faces, bool *blocks_transparent);
 static void smooth_lights(struct block block, float *lights, uint8_t visible_faces, struct block_lights_levels *lights_levels, bool *blocks_transparent, int8_t *blocks_lights);
+static uint8_t record_faces(struct block_def *block_def, struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z, uint8_t visible_faces, float *lights);
 static bool is_transparent(struct block block);
 
-void block_fill_buffers(struct block block, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t layer)
+void block_fill_buffers(struct block block, struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t layer)
 {
 	if (block.type == 0)
 		return;
@@ -114,8 +116,11 @@ void block_fill_buffers(struct block block, struct chunk *chunk, struct vec3f po
 		return;
 	if (!block_def->vtable || !block_def->vtable->draw)
 		return;
+	int32_t chunk_x = pos.x;
+	int32_t chunk_y = pos.y;
+	int32_t chunk_z = pos.z;
 	uint8_t visible_faces;
-	calc_visible_faces(block, chunk, pos, &visible_faces);
+	calc_visible_faces(block, snapshot, chunk_x, chunk_y, chunk_z, &visible_faces);
 	if (!visible_faces)
 		return;
 	bool blocks_transparent[27];
@@ -128,8 +133,8 @@ void block_fill_buffers(struct block block, struct chunk *chunk, struct vec3f po
 			{
 				for (int8_t z = -1; z <= 1; ++z)
 				{
-					blocks_transparent[i] = calc_transparent(chunk, pos, x, y, z);
-					blocks_lights[i++] = calc_light_level(chunk, pos, x, y, z);
+					blocks_transparent[i] = calc_transparent(snapshot, chunk_x + x, chunk_y + y, chunk_z + z);
+					blocks_lights[i++] = calc_light_level(snapshot, chunk_x + x, chunk_y + y, chunk_z + z);
 				}
 			}
 		}
@@ -149,7 +154,58 @@ void block_fill_buffers(struct block block, struct chunk *chunk, struct vec3f po
 #endif
 	float lights[24];
 	smooth_lights(block, lights, visible_faces, &lights_levels, blocks_transparent, blocks_lights);
-	block_def->vtable->draw(block_def, chunk, pos, tessellator, visible_faces, lights);
+	if (block_def->vtable->get_face && block_def->flags & BLOCK_FLAG_FULL_CUBE)
+	{
+		visible_faces = record_faces(block_def, snapshot, chunk_x, chunk_y, chunk_z, visible_faces, lights);
+		if (!visible_faces)
+			return;
+	}
+	block_def->vtable->draw(block_def, snapshot, pos, tessellator, visible_faces, lights);
+}
+
+/*
+ * faces with the same light on their four corners are left to the greedy
+ * merge of chunk_snapshot_fill_buffers, the others are drawn by the block
+ */
+static uint8_t record_faces(struct block_def *block_def, struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z, uint8_t visible_faces, float *lights)
+{
+	static const float factors[6] =
+	{
+		FRONT_COLOR_FACTOR,
+		BACK_COLOR_FACTOR,
+		LEFT_COLOR_FACTOR,
+		RIGHT_COLOR_FACTOR,
+		TOP_COLOR_FACTOR,
+		BOTTOM_COLOR_FACTOR,
+	};
+	uint32_t id = chunk_snapshot_face_id(x, y, z);
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		uint8_t face = 1 << i;
+		if (!(visible_faces & face))
+			continue;
+		const float *face_lights = &lights[i * 4];
+		if (face_lights[1] != face_lights[0]
+		 || face_lights[2] != face_lights[0]
+		 || face_lights[3] != face_lights[0])
+			continue;
+		struct vec2f tex;
+		struct vec3f color;
+		if (!block_def->vtable->get_face(block_def, face, &tex, &color))
+			continue;
+		VEC3_MULV(color, color, factors[i] * face_lights[0]);
+		uint8_t rgb[3];
+		rgb[0] = block_pack_color(color.x);
+		rgb[1] = block_pack_color(color.y);
+		rgb[2] = block_pack_color(color.z);
+		snapshot->faces[i][id] = chunk_snapshot_face_key(block_tile(tex), rgb);
+		if (y < snapshot->faces_min_y[i])
+			snapshot->faces_min_y[i] = y;
+		if (y > snapshot->faces_max_y[i])
+			snapshot->faces_max_y[i] = y;
+		visible_faces &= ~face;
+	}
+	return visible_faces;
 }
 
 static bool should_render_face_near(struct block block, struct block neighboor)
@@ -165,151 +221,37 @@ static bool should_render_face_near(struct block block, struct block neighboor)
 	return true;
 }
 
-static void calc_visible_faces(struct block block, struct chunk *chunk, struct vec3f pos, uint8_t *visible_faces)
+static void calc_visible_faces(struct block block, const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z, uint8_t *visible_faces)
 {
-	struct block neighboor;
 	*visible_faces = 0;
-	if (pos.z - chunk->z == CHUNK_WIDTH - 1)
-	{
-		if (!chunk->chunk_z_more)
-			*visible_faces |= BLOCK_FACE_FRONT;
-		else if (!chunk_get_block(chunk->chunk_z_more, pos.x - chunk->x, pos.y, 0, &neighboor)
-		      || should_render_face_near(block, neighboor))
-			*visible_faces |= BLOCK_FACE_FRONT;
-	}
-	else if (!chunk_get_block(chunk, pos.x - chunk->x, pos.y, pos.z - chunk->z + 1, &neighboor)
-	      || should_render_face_near(block, neighboor))
-	{
+	if (should_render_face_near(block, chunk_snapshot_get_block(snapshot, x, y, z + 1)))
 		*visible_faces |= BLOCK_FACE_FRONT;
-	}
-	if (pos.z - chunk->z == 0)
-	{
-		if (!chunk->chunk_z_less)
-			*visible_faces |= BLOCK_FACE_BACK;
-		else if (!chunk_get_block(chunk->chunk_z_less, pos.x - chunk->x, pos.y, CHUNK_WIDTH - 1, &neighboor)
-		      || should_render_face_near(block, neighboor))
-			*visible_faces |= BLOCK_FACE_BACK;
-	}
-	else if (!chunk_get_block(chunk, pos.x - chunk->x, pos.y, pos.z - chunk->z - 1, &neighboor)
-	      || should_render_face_near(block, neighboor))
-	{
+	if (should_render_face_near(block, chunk_snapshot_get_block(snapshot, x, y, z - 1)))
 		*visible_faces |= BLOCK_FACE_BACK;
-	}
-	if (pos.x - chunk->x == 0)
-	{
-		if (!chunk->chunk_x_less)
-			*visible_faces |= BLOCK_FACE_LEFT;
-		else if (!chunk_get_block(chunk->chunk_x_less, CHUNK_WIDTH - 1, pos.y, pos.z - chunk->z, &neighboor)
-		      || should_render_face_near(block, neighboor))
-			*visible_faces |= BLOCK_FACE_LEFT;
-	}
-	else if (!chunk_get_block(chunk, pos.x - chunk->x - 1, pos.y, pos.z - chunk->z, &neighboor)
-	      || should_render_face_near(block, neighboor))
-	{
+	if (should_render_face_near(block, chunk_snapshot_get_block(snapshot, x - 1, y, z)))
 		*visible_faces |= BLOCK_FACE_LEFT;
-	}
-	if (pos.x - chunk->x == CHUNK_WIDTH - 1)
-	{
-		if (!chunk->chunk_x_more)
-			*visible_faces |= BLOCK_FACE_RIGHT;
-		else if (!chunk_get_block(chunk->chunk_x_more, 0, pos.y, pos.z - chunk->z, &neighboor)
-		      || should_render_face_near(block, neighboor))
-			*visible_faces |= BLOCK_FACE_RIGHT;
-	}
-	else if (!chunk_get_block(chunk, pos.x - chunk->x + 1, pos.y, pos.z - chunk->z, &neighboor)
-	      || should_render_face_near(block, neighboor))
-	{
+	if (should_render_face_near(block, chunk_snapshot_get_block(snapshot, x + 1, y, z)))
 		*visible_faces |= BLOCK_FACE_RIGHT;
-	}
-	if (pos.y == CHUNK_HEIGHT - 1)
-		*visible_faces |= BLOCK_FACE_TOP;
-	else if (!chunk_get_block(chunk, pos.x - chunk->x, pos.y + 1, pos.z - chunk->z, &neighboor)
-	      || should_render_face_near(block, neighboor))
+	if (y == CHUNK_HEIGHT - 1
+	 || should_render_face_near(block, chunk_snapshot_get_block(snapshot, x, y + 1, z)))
 		*visible_faces |= BLOCK_FACE_TOP;
-	if (pos.y == 0)
-		*visible_faces |= BLOCK_FACE_BOTTOM;
-	else if (!chunk_get_block(chunk, pos.x - chunk->x, pos.y - 1, pos.z - chunk->z, &neighboor)
-	      || should_render_face_near(block, neighboor))
+	if (y == 0
+	 || should_render_face_near(block, chunk_snapshot_get_block(snapshot, x, y - 1, z)))
 		*visible_faces |= BLOCK_FACE_BOTTOM;
 }
 
-static int8_t calc_light_level(struct chunk *chunk, struct vec3f pos, int8_t add_x, int8_t add_y, int8_t add_z)
+static int8_t calc_light_level(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z)
 {
-	if (pos.y + add_y < 0 || pos.y + add_y >= CHUNK_HEIGHT)
+	if (y < 0 || y >= CHUNK_HEIGHT)
 		return 15;
-	int32_t new_x = pos.x - chunk->x + add_x;
-	int32_t new_y = pos.y + add_y;
-	int32_t new_z = pos.z - chunk->z + add_z;
-	if (new_x < 0)
-	{
-		new_x += CHUNK_WIDTH;
-		chunk = chunk->chunk_x_less;
-		if (!chunk)
-			return 15;
-	}
-	else if (new_x >= CHUNK_WIDTH)
-	{
-		new_x -= CHUNK_WIDTH;
-		chunk = chunk->chunk_x_more;
-		if (!chunk)
-			return 15;
-	}
-	if (new_z < 0)
-	{
-		new_z += CHUNK_WIDTH;
-		chunk = chunk->chunk_z_less;
-		if (!chunk)
-			return 15;
-	}
-	else if (new_z >= CHUNK_WIDTH)
-	{
-		new_z -= CHUNK_WIDTH;
-		chunk = chunk->chunk_z_more;
-		if (!chunk)
-			return 15;
-	}
-	return chunk_get_light(chunk, new_x, new_y, new_z);
+	return chunk_snapshot_get_light(snapshot, x, y, z);
 }
 
-static bool calc_transparent(struct chunk *chunk, struct vec3f pos, int8_t add_x, int8_t add_y, int8_t add_z)
+static bool calc_transparent(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z)
 {
-	if (pos.y + add_y < 0 || pos.y + add_y >= CHUNK_HEIGHT)
-		return true;
-	int32_t new_x = pos.x - chunk->x + add_x;
-	int32_t new_y = pos.y + add_y;
-	int32_t new_z = pos.z - chunk->z + add_z;
-	if (new_x < 0)
-	{
-		new_x += CHUNK_WIDTH;
-		chunk = chunk->chunk_x_less;
-		if (!chunk)
-			return true;
-	}
-	else if (new_x >= CHUNK_WIDTH)
-	{
-		new_x -= CHUNK_WIDTH;
-		chunk = chunk->chunk_x_more;
-		if (!chunk)
-			return true;
-	}
-	if (new_z < 0)
-	{
-		new_z += CHUNK_WIDTH;
-		chunk = chunk->chunk_z_less;
-		if (!chunk)
-			return true;
-	}
-	else if (new_z >= CHUNK_WIDTH)
-	{
-		new_z -= CHUNK_WIDTH;
-		chunk = chunk->chunk_z_more;
-		if (!chunk)
-			return true;
-	}
-	struct block block;
-	if (!chunk_get_block(chunk, new_x, new_y, new_z, &block))
+	if (y < 0 || y >= CHUNK_HEIGHT)
 		return true;
-	return is_transparent(block);
+	return is_transparent(chunk_snapshot_get_block(snapshot, x, y, z));
 }
 
 static void init_lights_levels(struct block_lights_levels *lights, uint8_t visible_faces, int8_t *blocks_lights)
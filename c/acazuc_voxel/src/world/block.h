@@ -14,8 +14,8 @@
 #define TOP_COLOR_FACTOR    0.985
 #define BOTTOM_COLOR_FACTOR 0.496
 
+struct chunk_snapshot;
 struct tessellator;
-struct chunk;
 
 enum block_faces
 {
@@ -89,6 +89,6 @@ struct block
 	uint8_t data;
 };
 
-void block_fill_buffers(struct block block, struct chunk *chunk, struct vec3f pos, struct tessellator *tessellator, uint8_t layer);
+void block_fill_buffers(struct block block, struct chunk_snapshot *snapshot, struct vec3f pos, struct tessellator *tessellator, uint8_t layer);
 
 #endif
@@ -1,6 +1,7 @@
 #include "world/storage.h"
 #include "world/block.h"
 #include "world/chunk.h"
+#include "world/light.h"
 #include "world/world.h"
 
 #include "biome/biomes.h"
@@ -46,6 +47,7 @@ struct chunk *chunk_new(struct world *world, int32_t x, int32_t z, struct nbt_ta
 		abort();
 	}
 	chunk->world = world;
+	chunk->id = ++world->chunks_id;
 	chunk->x = x;
 	chunk->z = z;
 	VEC3_SET(chunk->aabb.p0, x, 0, z);
@@ -78,11 +80,10 @@ struct chunk *chunk_new(struct world *world, int32_t x, int32_t z, struct nbt_ta
 	{
 		chunk->layers[i].attributes_state = GFX_ATTRIBUTES_STATE_INIT();
 		chunk->layers[i].vertexes_buffer = GFX_BUFFER_INIT();
-		chunk->layers[i].indices_buffer = GFX_BUFFER_INIT();
 		chunk->layers[i].indices_nb = 0;
 		jks_array_init(&chunk->layers[i].tessellator.vertexes, sizeof(struct shader_blocks_vertex), NULL, NULL);
-		jks_array_init(&chunk->layers[i].tessellator.indices, sizeof(uint32_t), NULL, NULL);
 	}
+	chunk->uniform_buffer = GFX_BUFFER_INIT();
 	init_nbt(chunk, nbt);
 	return chunk;
 }
@@ -91,67 +92,68 @@ void chunk_delete(struct chunk *chunk)
 {
 	if (!chunk)
 		return;
-	for (size_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
-		storage_delete(chunk->storages[i]);
-	nbt_tag_delete((struct nbt_tag*)chunk->nbt.nbt);
 	if (chunk->chunk_x_less_z_less)
 	{
 		chunk->chunk_x_less_z_less->chunk_x_more_z_more = NULL;
-		chunk_regenerate_light_map(chunk->chunk_x_less_z_less);
+		chunk_regenerate_buffers(chunk->chunk_x_less_z_less);
 	}
 	if (chunk->chunk_x_more_z_less)
 	{
 		chunk->chunk_x_more_z_less->chunk_x_less_z_more = NULL;
-		chunk_regenerate_light_map(chunk->chunk_x_more_z_less);
+		chunk_regenerate_buffers(chunk->chunk_x_more_z_less);
 	}
 	if (chunk->chunk_x_less_z_more)
 	{
 		chunk->chunk_x_less_z_more->chunk_x_more_z_less = NULL;
-		chunk_regenerate_light_map(chunk->chunk_x_less_z_more);
+		chunk_regenerate_buffers(chunk->chunk_x_less_z_more);
 	}
 	if (chunk->chunk_x_more_z_more)
 	{
 		chunk->chunk_x_more_z_more->chunk_x_less_z_less = NULL;
-		chunk_regenerate_light_map(chunk->chunk_x_more_z_more);
+		chunk_regenerate_buffers(chunk->chunk_x_more_z_more);
 	}
 	if (chunk->chunk_x_less)
 	{
 		chunk->chunk_x_less->chunk_x_more = NULL;
-		chunk_regenerate_light_map(chunk->chunk_x_less);
+		chunk_regenerate_buffers(chunk->chunk_x_less);
 	}
 	if (chunk->chunk_x_more)
 	{
 		chunk->chunk_x_more->chunk_x_less = NULL;
-		chunk_regenerate_light_map(chunk->chunk_x_more);
+		chunk_regenerate_buffers(chunk->chunk_x_more);
 	}
 	if (chunk->chunk_z_less)
 	{
 		chunk->chunk_z_less->chunk_z_more = NULL;
-		chunk_regenerate_light_map(chunk->chunk_z_less);
+		chunk_regenerate_buffers(chunk->chunk_z_less);
 	}
 	if (chunk->chunk_z_more)
 	{
 		chunk->chunk_z_more->chunk_z_less = NULL;
-		chunk_regenerate_light_map(chunk->chunk_z_more);
+		chunk_regenerate_buffers(chunk->chunk_z_more);
 	}
+	if (chunk->world->running && chunk_is_light_populated(chunk))
+		light_remove_chunk(&chunk->world->light, chunk);
+	for (size_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
+		storage_delete(chunk->storages[i]);
+	nbt_tag_delete((struct nbt_tag*)chunk->nbt.nbt);
 	for (size_t i = 0; i < sizeof(chunk->layers) / sizeof(*chunk->layers); ++i)
 	{
 		gfx_delete_attributes_state(g_voxel->device, &chunk->layers[i].attributes_state);
 		gfx_delete_buffer(g_voxel->device, &chunk->layers[i].vertexes_buffer);
-		gfx_delete_buffer(g_voxel->device, &chunk->layers[i].indices_buffer);
 		jks_array_destroy(&chunk->layers[i].tessellator.vertexes);
-		jks_array_destroy(&chunk->layers[i].tessellator.indices);
 	}
+	gfx_delete_buffer(g_voxel->device, &chunk->uniform_buffer);
 	particles_destroy(&chunk->particles);
 	entities_destroy(&chunk->entities);
 	free(chunk);
 }
 
-void chunk_generate(struct chunk *chunk)
+/* only reads the noise, so it can run without the chunks mutex */
+void chunk_generate_heights(struct world *world, int32_t chunk_x, int32_t chunk_z, int32_t *heights)
 {
-	if (chunk_is_generated(chunk))
-		return;
-	chunk_set_generated(chunk, true);
+	float noise[CHUNK_WIDTH * CHUNK_WIDTH];
+	simplex_noise_get2_grid(&world->noise, chunk_x * 100, chunk_z * 100, 100, CHUNK_WIDTH, CHUNK_WIDTH, noise);
 	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
 	{
 		for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
@@ -164,14 +166,28 @@ void chunk_generate(struct chunk *chunk)
 			//chunk->nbt.Biomes->getValues()[getXZId(x, z)] = Biomes::getBiomeFor(temp, rain);
 			//float noise_index = -.02;
 			//float noise_index = 0;
-			float noise_index = simplex_noise_get2(&chunk->world->noise, (chunk->x + x) * 100, (chunk->z + z) * 100);
+			float noise_index = noise[chunk_xz_id(x, z)];
 			//float noise_index = std::min(1., std::max(-1., WorleyNoise::get2((chunk->x + x) / 50., (chunk->z + z) / 50.)));
 			//noise_index *= chunk->world.getNoise().get2(chunk->x + x, chunk->z + z);
 			//float noise_index = chunk->world.getNoise().get2(chunk->x + x, chunk->z + z) / 2;
 			//noise_index += chunk->world.getNoise().get3(chunk->x + x, chunk->z + z, 3) / 3;
 			//noise_index += chunk->world.getNoise().get3(chunk->x + x, chunk->z + z, 300000) / 4;
 			noise_index = noise_index * CHUNK_HEIGHT / 5 + CHUNK_HEIGHT / 4;
-			noise_index = roundf(noise_index);
+			heights[chunk_xz_id(x, z)] = roundf(noise_index);
+		}
+	}
+}
+
+void chunk_generate(struct chunk *chunk, const int32_t *heights)
+{
+	if (chunk_is_generated(chunk))
+		return;
+	chunk_set_generated(chunk, true);
+	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
+	{
+		for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
+		{
+			int32_t noise_index = heights[chunk_xz_id(x, z)];
 			//if ((x + z) % 2 == 0)
 			//	noise_index--;
 			for (int32_t y = 0; y < CHUNK_HEIGHT; ++y)
@@ -202,7 +218,24 @@ void chunk_generate(struct chunk *chunk)
 		}
 	}
 	biome_generate(g_voxel->biomes->biomes[1], chunk);
-	chunk_regenerate_light_map_rec(chunk);
+	chunk_regenerate_light_map(chunk);
+	/* the faces of the neighbours facing this chunk are now hidden */
+	struct chunk *neighbours[] =
+	{
+		chunk->chunk_x_less_z_less,
+		chunk->chunk_x_less_z_more,
+		chunk->chunk_x_more_z_less,
+		chunk->chunk_x_more_z_more,
+		chunk->chunk_x_less,
+		chunk->chunk_x_more,
+		chunk->chunk_z_less,
+		chunk->chunk_z_more,
+	};
+	for (size_t i = 0; i < sizeof(neighbours) / sizeof(*neighbours); ++i)
+	{
+		if (neighbours[i])
+			chunk_regenerate_buffers(neighbours[i]);
+	}
 }
 
 void chunk_tick(struct chunk *chunk)
@@ -234,242 +267,47 @@ void chunk_draw(struct chunk *chunk, uint8_t layer)
 	}
 	if (!chunk->layers[layer].indices_nb)
 		return;
+	gfx_bind_constant(g_voxel->device, 2, &chunk->uniform_buffer, sizeof(struct shader_blocks_chunk_block), 0);
 	gfx_bind_attributes_state(g_voxel->device, &chunk->layers[layer].attributes_state, &g_voxel->graphics->blocks.input_layout);
 	gfx_draw_indexed(g_voxel->device, chunk->layers[layer].indices_nb, 0);
 }
 
-static uint8_t add_near_light_value(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint8_t light)
-{
-	if (x > 0)
-	{
-		if (y > chunk_get_top_block(chunk, x - 1, z))
-			return 0xE;
-	}
-	else
-	{
-		if (chunk->chunk_x_less && y > chunk_get_top_block(chunk->chunk_x_less, CHUNK_WIDTH - 1, z))
-			return 0xE;
-	}
-	if (x < CHUNK_WIDTH - 1)
-	{
-		if (y > chunk_get_top_block(chunk, x + 1, z))
-			return 0xE;
-	}
-	else
-	{
-		if (chunk->chunk_x_more && y > chunk_get_top_block(chunk->chunk_x_more, 0, z))
-			return 0xE;
-	}
-	if (z > 0)
-	{
-		if (y > chunk_get_top_block(chunk, x, z - 1))
-			return 0xE;
-	}
-	else
-	{
-		if (chunk->chunk_z_less && y > chunk_get_top_block(chunk->chunk_z_less, x, CHUNK_WIDTH - 1))
-			return 0xE;
-	}
-	if (z < CHUNK_WIDTH - 1)
-	{
-		if (y > chunk_get_top_block(chunk, x, z + 1))
-			return 0xE;
-	}
-	else
-	{
-		if (chunk->chunk_z_more && y > chunk_get_top_block(chunk->chunk_z_more, x, 0))
-			return 0xE;
-	}
-	if (x == 0 && chunk->chunk_x_less)
-	{
-		uint8_t near_light = chunk_get_sky_light(chunk->chunk_x_less, CHUNK_WIDTH - 1, y, z);
-		if (near_light > 0)
-		{
-			near_light--;
-			if (near_light > light)
-				light = near_light;
-		}
-	}
-	else if (x == CHUNK_WIDTH - 1 && chunk->chunk_x_more)
-	{
-		uint8_t near_light = chunk_get_sky_light(chunk->chunk_x_more, 0, y, z);
-		if (near_light > 0)
-		{
-			near_light--;
-			if (near_light > light)
-				light = near_light;
-		}
-	}
-	if (z == 0 && chunk->chunk_z_less)
-	{
-		uint8_t near_light = chunk_get_sky_light(chunk->chunk_z_less, x, y, CHUNK_WIDTH - 1);
-		if (near_light > 0)
-		{
-			near_light--;
-			if (near_light > light)
-				light = near_light;
-		}
-	}
-	else if (z == CHUNK_WIDTH - 1 && chunk->chunk_z_more)
-	{
-		uint8_t near_light = chunk_get_sky_light(chunk->chunk_z_more, x, y, 0);
-		if (near_light > 0)
-		{
-			near_light--;
-			if (near_light > light)
-				light = near_light;
-		}
-	}
-	return light;
-}
-
-static void set_block_light_rec(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint8_t light)
-{
-	struct block block;
-	if (!chunk_get_block(chunk, x, y, z, &block))
-		block.type = 0;
-	struct block_def *block_def = g_voxel->blocks->blocks[block.type];
-	if (!block_def)
-		block_def = g_voxel->blocks->blocks[0];
-	if (block_def->opacity == 0xF)
-		return;
-	bool is_top_block = false;
-	if (light == 0xF)
-		goto end_near_top;
-	if (y >= chunk_get_top_block(chunk, x, z))
-	{
-		is_top_block = true;
-		light = 0xF;
-		goto end_near_top;
-	}
-#if 0
-	for (int8_t xx = -1; xx <= 1; ++xx)
-	{
-		for (int8_t yy = -1; yy <= 1; ++yy)
-		{
-			for (int8_t zz = -1; zz <= 1; ++zz)
-			{
-				struct block tmp;
-				if (world_get_block(chunk->world, chunk->x + xx + x, yy + y, chunk->z + zz + z, &tmp)
-				 && tmp.type)
-					goto end_check_around;
-			}
-		}
-	}
-	return;
-end_check_around:
-#endif
-	light = add_near_light_value(chunk, x, y, z, light);
-end_near_top:
-	if (chunk_get_sky_light_val(chunk, x, y, z) >= light)
-		return;
-	chunk_set_sky_light(chunk, x, y, z, light);
-	if (block_def->opacity >= light)
-		return;
-	light -= block_def->opacity;
-	if (x > 0)
-		set_block_light_rec(chunk, x - 1, y, z, light);
-	else if (chunk->chunk_x_less && !is_top_block)
-		{}//chunk->chunk_x_less->setBlockLightRec(CHUNK_WIDTH - 1, y, z, light);
-	if (x < CHUNK_WIDTH - 1)
-		set_block_light_rec(chunk, x + 1, y, z, light);
-	else if (chunk->chunk_x_more && !is_top_block)
-		{}//chunk->chunk_x_more->setBlockLightRec(0, y, z, light);
-	if (y > 0)
-		set_block_light_rec(chunk, x, y - 1, z, light);
-	if (y < CHUNK_HEIGHT - 1 && !is_top_block)
-		set_block_light_rec(chunk, x, y + 1, z, light);
-	if (z > 0)
-		set_block_light_rec(chunk, x, y, z - 1, light);
-	else if (chunk->chunk_z_less && !is_top_block)
-		{}//chunk->chunk_z_less->setBlockLightRec(x, y, CHUNK_WIDTH - 1, light);
-	if (z < CHUNK_WIDTH - 1)
-		set_block_light_rec(chunk, x, y, z + 1, light);
-	else if (chunk->chunk_z_more && !is_top_block)
-		{}//chunk->chunk_z_more->setBlockLightRec(x, y, 0, light);
-}
-
 void chunk_generate_light_map(struct chunk *chunk)
 {
 	chunk->must_generate_light_map = false;
-	for (size_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
-	{
-		struct storage *storage = chunk->storages[i];
-		if (!storage)
-			continue;
-		storage_reset_lights(storage);
-	}
-	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
-	{
-		for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
-		{
-			uint8_t top_block = chunk_get_top_block(chunk, x, z);
-			if (top_block == CHUNK_HEIGHT)
-				set_block_light_rec(chunk, x, top_block, z, 0xF);
-			else
-				set_block_light_rec(chunk, x, top_block + 1, z, 0xE);
-		}
-	}
-	if (chunk->recursive_light_map)
-	{
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_XLESS_ZLESS) && chunk->chunk_x_less_z_less)
-			chunk_regenerate_light_map(chunk->chunk_x_less_z_less);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_XMORE_ZLESS) && chunk->chunk_x_more_z_less)
-			chunk_regenerate_light_map(chunk->chunk_x_more_z_less);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_XLESS_ZMORE) && chunk->chunk_x_less_z_more)
-			chunk_regenerate_light_map(chunk->chunk_x_less_z_more);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_XMORE_ZMORE) && chunk->chunk_x_more_z_more)
-			chunk_regenerate_light_map(chunk->chunk_x_more_z_more);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_XLESS) && chunk->chunk_x_less)
-			chunk_regenerate_light_map(chunk->chunk_x_less);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_XMORE) && chunk->chunk_x_more)
-			chunk_regenerate_light_map(chunk->chunk_x_more);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_ZLESS) && chunk->chunk_z_less)
-			chunk_regenerate_light_map(chunk->chunk_z_less);
-		if ((chunk->recursive_light_map & CHUNK_RECURSIVE_ZMORE) && chunk->chunk_z_more)
-			chunk_regenerate_light_map(chunk->chunk_z_more);
-	}
-	chunk->recursive_light_map = 0;
+	light_generate_chunk(&chunk->world->light, chunk);
 }
 
-void chunk_generate_buffers(struct chunk *chunk)
+static void update_gfx_buffer(struct chunk *chunk, uint8_t layer)
 {
-	chunk->must_generate_buffers = false;
-	for (uint8_t layer = 0; layer < sizeof(chunk->layers) / sizeof(*chunk->layers); ++layer)
+	size_t quads = chunk->layers[layer].tessellator.vertexes.size / 4;
+	if (quads > CHUNK_MAX_QUADS)
 	{
-		for (uint8_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
-		{
-			struct storage *storage = chunk->storages[i];
-			if (!storage)
-				continue;
-			storage_fill_buffers(storage, chunk, &chunk->layers[layer].tessellator, layer);
-		}
+		LOG_WARN("too many quads in chunk layer: %lu", (unsigned long)quads);
+		quads = CHUNK_MAX_QUADS;
 	}
-	chunk->must_update_buffers = true;
-}
-
-static void update_gfx_buffer(struct chunk *chunk, uint8_t layer)
-{
 	gfx_delete_attributes_state(g_voxel->device, &chunk->layers[layer].attributes_state);
 	gfx_delete_buffer(g_voxel->device, &chunk->layers[layer].vertexes_buffer);
-	gfx_delete_buffer(g_voxel->device, &chunk->layers[layer].indices_buffer);
 	gfx_create_buffer(g_voxel->device, &chunk->layers[layer].vertexes_buffer, GFX_BUFFER_VERTEXES, chunk->layers[layer].tessellator.vertexes.data, sizeof(struct shader_blocks_vertex) * chunk->layers[layer].tessellator.vertexes.size, GFX_BUFFER_IMMUTABLE);
-	gfx_create_buffer(g_voxel->device, &chunk->layers[layer].indices_buffer, GFX_BUFFER_INDICES, chunk->layers[layer].tessellator.indices.data, sizeof(uint32_t) * chunk->layers[layer].tessellator.indices.size, GFX_BUFFER_IMMUTABLE);
 	const struct gfx_attribute_bind binds[] =
 	{
 		{&chunk->layers[layer].vertexes_buffer},
 	};
-	gfx_create_attributes_state(g_voxel->device, &chunk->layers[layer].attributes_state, binds, sizeof(binds) / sizeof(*binds), &chunk->layers[layer].indices_buffer, GFX_INDEX_UINT32);
-	chunk->layers[layer].indices_nb = chunk->layers[layer].tessellator.indices.size;
+	gfx_create_attributes_state(g_voxel->device, &chunk->layers[layer].attributes_state, binds, sizeof(binds) / sizeof(*binds), &g_voxel->graphics->blocks.indices_buffer, GFX_INDEX_UINT32);
+	chunk->layers[layer].indices_nb = quads * 6;
 	jks_array_resize(&chunk->layers[layer].tessellator.vertexes, 0);
 	jks_array_shrink(&chunk->layers[layer].tessellator.vertexes);
-	jks_array_resize(&chunk->layers[layer].tessellator.indices, 0);
-	jks_array_shrink(&chunk->layers[layer].tessellator.indices);
 }
 
 static void update_gfx_buffers(struct chunk *chunk)
 {
 	chunk->must_update_buffers = false;
+	if (!chunk->uniform_buffer.handle.ptr)
+	{
+		struct shader_blocks_chunk_block chunk_block;
+		VEC4_SET(chunk_block.position, chunk->x, 0, chunk->z, 0);
+		gfx_create_buffer(g_voxel->device, &chunk->uniform_buffer, GFX_BUFFER_UNIFORM, &chunk_block, sizeof(chunk_block), GFX_BUFFER_IMMUTABLE);
+	}
 	for (size_t layer = 0; layer < sizeof(chunk->layers) / sizeof(*chunk->layers); ++layer)
 		update_gfx_buffer(chunk, layer);
 }
@@ -488,12 +326,6 @@ void chunk_set_block_if_replaceable(struct chunk *chunk, int32_t x, int32_t y, i
 
 void chunk_set_block(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint16_t type)
 {
-	if (type)
-	{
-		uint8_t top = chunk_get_top_block(chunk, x, z);
-		if (y > top)
-			chunk_set_top_block(chunk, x, z, y);
-	}
 	uint8_t storage_id = y / CHUNK_STORAGE_HEIGHT;
 	uint8_t storage_y = y % CHUNK_STORAGE_HEIGHT;
 	struct storage *storage = chunk->storages[storage_id];
@@ -505,27 +337,31 @@ void chunk_set_block(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint1
 	}
 	storage_set_block(storage, x, storage_y, z, type);
 	chunk->changed = true;
-	if (x == 0)
+	uint8_t top = chunk_get_top_block(chunk, x, z);
+	if (type)
+	{
+		if (y > top)
+			chunk_set_top_block(chunk, x, z, y);
+	}
+	else if (y == top)
 	{
-		chunk->recursive_light_map |= CHUNK_RECURSIVE_XLESS;
-		if (z == 0)
-			chunk->recursive_light_map |= CHUNK_RECURSIVE_XLESS_ZLESS;
-		else if (z == CHUNK_WIDTH - 1)
-			chunk->recursive_light_map |= CHUNK_RECURSIVE_XLESS_ZMORE;
+		int16_t i;
+		for (i = top - 1; i > 0; --i)
+		{
+			struct block block;
+			if (chunk_get_block(chunk, x, i, z, &block)
+			 && block.type)
+				break;
+		}
+		chunk_set_top_block(chunk, x, z, i);
 	}
-	else if (x == CHUNK_WIDTH - 1)
+	if (!chunk_is_light_populated(chunk))
 	{
-		chunk->recursive_light_map |= CHUNK_RECURSIVE_XMORE;
-		if (z == 0)
-			chunk->recursive_light_map |= CHUNK_RECURSIVE_XMORE_ZLESS;
-		else if (z == CHUNK_WIDTH - 1)
-			chunk->recursive_light_map |= CHUNK_RECURSIVE_XMORE_ZMORE;
+		chunk_regenerate_light_map(chunk);
+		return;
 	}
-	if (z == 0)
-		chunk->recursive_light_map |= CHUNK_RECURSIVE_ZLESS;
-	else if (z == CHUNK_WIDTH - 1)
-		chunk->recursive_light_map |= CHUNK_RECURSIVE_ZMORE;
-	chunk_regenerate_light_map(chunk);
+	light_update_block(&chunk->world->light, chunk, x, y, z, top);
+	chunk_touch(chunk, x, z);
 }
 
 bool chunk_get_block(struct chunk *chunk, int32_t x, int32_t y, int32_t z, struct block *block)
@@ -596,7 +432,11 @@ void chunk_set_block_light(struct chunk *chunk, int32_t x, int32_t y, int32_t z,
 	uint8_t storage_y = y % CHUNK_STORAGE_HEIGHT;
 	struct storage *storage = chunk->storages[storage_id];
 	if (!storage)
-		return;
+	{
+		if (!light)
+			return;
+		storage = create_storage(chunk, storage_id);
+	}
 	storage_set_block_light(storage, x, storage_y, z, light);
 	chunk->changed = true;
 }
@@ -637,56 +477,55 @@ uint8_t chunk_get_biome(struct chunk *chunk, int32_t x, int32_t z)
 
 void chunk_destroy_block(struct chunk *chunk, int32_t x, int32_t y, int32_t z)
 {
-	uint8_t top = chunk_get_top_block(chunk, x, z);
-	if (y == top)
-	{
-		for (int16_t i = top - 1; i >= 0; --i)
-		{
-			struct block block;
-			if (chunk_get_block(chunk, x, i, z, &block)
-			 && block.type)
-			{
-				chunk_set_top_block(chunk, x, z, i);
-				break;
-			}
-		}
-	}
 	chunk_set_block(chunk, x, y, z, 0);
-	chunk_regenerate_light_map(chunk);
+}
+
+void chunk_regenerate_buffers(struct chunk *chunk)
+{
+	if (!chunk_is_generated(chunk))
+		return;
+	if (chunk->must_generate_buffers)
+		return;
+	chunk->must_generate_buffers = true;
+	world_jobs_mesh(&chunk->world->jobs, chunk);
+}
+
+/* regenerates the buffers of the chunk, and of the neighbours sampling the
+ * column at x / z when it lies on a border
+ */
+void chunk_touch(struct chunk *chunk, int32_t x, int32_t z)
+{
+	chunk_regenerate_buffers(chunk);
 	if (x == 0)
 	{
 		if (chunk->chunk_x_less)
-			chunk_regenerate_light_map(chunk->chunk_x_less);
+			chunk_regenerate_buffers(chunk->chunk_x_less);
+		if (z == 0 && chunk->chunk_x_less_z_less)
+			chunk_regenerate_buffers(chunk->chunk_x_less_z_less);
+		else if (z == CHUNK_WIDTH - 1 && chunk->chunk_x_less_z_more)
+			chunk_regenerate_buffers(chunk->chunk_x_less_z_more);
 	}
 	else if (x == CHUNK_WIDTH - 1)
 	{
 		if (chunk->chunk_x_more)
-			chunk_regenerate_light_map(chunk->chunk_x_more);
+			chunk_regenerate_buffers(chunk->chunk_x_more);
+		if (z == 0 && chunk->chunk_x_more_z_less)
+			chunk_regenerate_buffers(chunk->chunk_x_more_z_less);
+		else if (z == CHUNK_WIDTH - 1 && chunk->chunk_x_more_z_more)
+			chunk_regenerate_buffers(chunk->chunk_x_more_z_more);
 	}
 	if (z == 0)
 	{
 		if (chunk->chunk_z_less)
-			chunk_regenerate_light_map(chunk->chunk_z_less);
+			chunk_regenerate_buffers(chunk->chunk_z_less);
 	}
 	else if (z == CHUNK_WIDTH - 1)
 	{
 		if (chunk->chunk_z_more)
-			chunk_regenerate_light_map(chunk->chunk_z_more);
+			chunk_regenerate_buffers(chunk->chunk_z_more);
 	}
 }
 
-void chunk_regenerate_buffers(struct chunk *chunk)
-{
-	if (!chunk_is_generated(chunk))
-		return;
-	if (chunk->must_generate_buffers)
-		return;
-	chunk->must_generate_buffers = true;
-	pthread_mutex_lock(&chunk->world->chunks_mutex);
-	TAILQ_INSERT_TAIL(&chunk->world->chunks_to_update, chunk, update_chain);
-	pthread_mutex_unlock(&chunk->world->chunks_mutex);
-}
-
 void chunk_regenerate_light_map(struct chunk *chunk)
 {
 	if (!chunk_is_generated(chunk))
@@ -697,12 +536,6 @@ void chunk_regenerate_light_map(struct chunk *chunk)
 	chunk_regenerate_buffers(chunk);
 }
 
-void chunk_regenerate_light_map_rec(struct chunk *chunk)
-{
-	chunk->recursive_light_map = 0xFF;
-	chunk_regenerate_light_map(chunk);
-}
-
 static struct storage *create_storage(struct chunk *chunk, uint8_t id)
 {
 	assert(!chunk->storages[id]);
@@ -766,6 +599,8 @@ static void init_nbt(struct chunk *chunk, struct nbt_tag_compound *nbt)
 		LOG_ERROR("failed to sanitize");
 		abort();
 	}
+	/* the light of the neighbours may have changed since it was saved */
+	chunk_set_light_populated(chunk, false);
 	bool section_added = false;
 	for (int32_t i = 0; i < chunk->nbt.Sections->count; ++i)
 	{
@@ -799,7 +634,7 @@ static void init_nbt(struct chunk *chunk, struct nbt_tag_compound *nbt)
 		i--;
 	}
 	if (section_added)
-		chunk_regenerate_light_map_rec(chunk);
+		chunk_regenerate_light_map(chunk);
 }
 
 void chunk_set_generated(struct chunk *chunk, bool generated)
@@ -812,6 +647,16 @@ bool chunk_is_generated(struct chunk *chunk)
 	return chunk->nbt.TerrainPopulated->value;
 }
 
+void chunk_set_light_populated(struct chunk *chunk, bool populated)
+{
+	chunk->nbt.LightPopulated->value = populated ? 1 : 0;
+}
+
+bool chunk_is_light_populated(struct chunk *chunk)
+{
+	return chunk->nbt.LightPopulated->value;
+}
+
 void chunk_get_aabbs(struct chunk *chunk, const struct aabb *aabb,
                      struct jks_array *aabbs)
 {
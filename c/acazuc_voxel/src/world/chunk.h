@@ -13,14 +13,8 @@
 
 #include <jks/aabb.h>
 
-#define CHUNK_RECURSIVE_XLESS 0x1
-#define CHUNK_RECURSIVE_XMORE 0x2
-#define CHUNK_RECURSIVE_ZLESS 0x4
-#define CHUNK_RECURSIVE_ZMORE 0x8
-#define CHUNK_RECURSIVE_XLESS_ZLESS 0x10
-#define CHUNK_RECURSIVE_XMORE_ZLESS 0x20
-#define CHUNK_RECURSIVE_XLESS_ZMORE 0x40
-#define CHUNK_RECURSIVE_XMORE_ZMORE 0x80
+#define CHUNK_LAYERS 3
+#define CHUNK_MAX_QUADS (CHUNK_WIDTH * CHUNK_WIDTH * CHUNK_HEIGHT * 6)
 
 struct storage;
 struct block;
@@ -51,14 +45,14 @@ struct chunk_layer
 	struct tessellator tessellator;
 	gfx_attributes_state_t attributes_state;
 	gfx_buffer_t vertexes_buffer;
-	gfx_buffer_t indices_buffer;
 	uint32_t indices_nb;
 };
 
 struct chunk
 {
 	struct storage *storages[16];
-	struct chunk_layer layers[3];
+	struct chunk_layer layers[CHUNK_LAYERS];
+	gfx_buffer_t uniform_buffer;
 	struct particles particles;
 	struct entities entities;
 	struct chunk_nbt nbt;
@@ -72,7 +66,8 @@ struct chunk
 	struct chunk *chunk_z_more;
 	struct world *world;
 	struct aabb aabb;
-	uint8_t recursive_light_map;
+	uint64_t mesh_sequence;
+	uint64_t id;
 	int32_t x;
 	int32_t z;
 	bool must_generate_light_map;
@@ -81,19 +76,18 @@ struct chunk
 	bool deleted;
 	bool changed;
 	bool visible;
-	TAILQ_ENTRY(chunk) update_chain;
 };
 
 struct chunk *chunk_new(struct world *world, int32_t x, int32_t y, struct nbt_tag_compound *nbt);
 void chunk_delete(struct chunk *chunk);
 void chunk_tick(struct chunk *chunk);
-void chunk_generate(struct chunk *chunk);
+void chunk_generate_heights(struct world *world, int32_t x, int32_t z, int32_t *heights);
+void chunk_generate(struct chunk *chunk, const int32_t *heights);
 void chunk_draw_entities(struct chunk *chunk);
 void chunk_draw(struct chunk *chunk, uint8_t layer);
-void chunk_generate_buffers(struct chunk *chunk);
 void chunk_regenerate_buffers(struct chunk *chunk);
+void chunk_touch(struct chunk *chunk, int32_t x, int32_t z);
 void chunk_generate_light_map(struct chunk *chunk);
-void chunk_regenerate_light_map_rec(struct chunk *chunk);
 void chunk_regenerate_light_map(struct chunk *chunk);
 void chunk_set_block(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint16_t type);
 void chunk_set_block_if_replaceable(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint16_t type);
@@ -111,6 +105,8 @@ uint8_t chunk_get_biome(struct chunk *chunk, int32_t x, int32_t z);
 void chunk_destroy_block(struct chunk *chunk, int32_t x, int32_t y, int32_t z);
 void chunk_set_generated(struct chunk *chunk, bool generated);
 bool chunk_is_generated(struct chunk *chunk);
+void chunk_set_light_populated(struct chunk *chunk, bool populated);
+bool chunk_is_light_populated(struct chunk *chunk);
 void chunk_get_aabbs(struct chunk *chunk, const struct aabb *aabb,
                      struct jks_array *aabbs);
 
@@ -0,0 +1,330 @@
+#include "world/snapshot.h"
+#include "world/chunk.h"
+#include "world/world.h"
+#include "world/jobs.h"
+
+#include "shaders.h"
+#include "voxel.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+struct chunk_mesh
+{
+	struct tessellator tessellators[CHUNK_LAYERS];
+	uint64_t chunk_id;
+	uint64_t sequence;
+	int32_t x;
+	int32_t z;
+};
+
+static void *worker_run(void *data);
+
+static uint64_t job_key(int32_t x, int32_t z)
+{
+	return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+}
+
+void world_jobs_init(struct world_jobs *jobs, struct world *world)
+{
+	jobs->world = world;
+	jobs->running = true;
+	jobs->mesh_sequence = 0;
+	jobs->generated = 0;
+	jobs->meshed = 0;
+	jobs->last_stats = g_voxel->frametime;
+	VEC3_SETV(jobs->position, 0);
+	frustum_init(&jobs->frustum);
+	jks_array_init(&jobs->pending, sizeof(struct world_job), NULL, NULL);
+	jks_array_init(&jobs->meshes, sizeof(struct chunk_mesh*), NULL, NULL);
+	jks_hmap_init(&jobs->generating, sizeof(uint8_t), NULL, jks_hmap_hash_u64, jks_hmap_cmp_u64, NULL);
+	if (pthread_mutex_init(&jobs->mutex, NULL)
+	 || pthread_cond_init(&jobs->cond, NULL))
+	{
+		LOG_ERROR("jobs mutex creation failed");
+		abort();
+	}
+	/* the render thread keeps one core */
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 2)
+		jobs->workers_nb = 1;
+	else if (cpus > WORLD_JOBS_MAX_WORKERS + 1)
+		jobs->workers_nb = WORLD_JOBS_MAX_WORKERS;
+	else
+		jobs->workers_nb = cpus - 1;
+	for (size_t i = 0; i < jobs->workers_nb; ++i)
+	{
+		struct world_worker *worker = &jobs->workers[i];
+		worker->jobs = jobs;
+		worker->snapshot = calloc(1, sizeof(*worker->snapshot));
+		if (!worker->snapshot)
+		{
+			LOG_ERROR("snapshot allocation failed");
+			abort();
+		}
+		if (pthread_create(&worker->thread, NULL, worker_run, worker))
+		{
+			LOG_ERROR("worker creation failed");
+			abort();
+		}
+	}
+	LOG_INFO("started %lu chunk workers", (unsigned long)jobs->workers_nb);
+}
+
+static void mesh_delete(struct chunk_mesh *mesh)
+{
+	for (size_t i = 0; i < CHUNK_LAYERS; ++i)
+		jks_array_destroy(&mesh->tessellators[i].vertexes);
+	free(mesh);
+}
+
+void world_jobs_stop(struct world_jobs *jobs)
+{
+	pthread_mutex_lock(&jobs->mutex);
+	jobs->running = false;
+	pthread_cond_broadcast(&jobs->cond);
+	pthread_mutex_unlock(&jobs->mutex);
+	for (size_t i = 0; i < jobs->workers_nb; ++i)
+	{
+		pthread_join(jobs->workers[i].thread, NULL);
+		free(jobs->workers[i].snapshot);
+	}
+	jobs->workers_nb = 0;
+}
+
+void world_jobs_destroy(struct world_jobs *jobs)
+{
+	for (size_t i = 0; i < jobs->meshes.size; ++i)
+		mesh_delete(*JKS_ARRAY_GET(&jobs->meshes, i, struct chunk_mesh*));
+	jks_array_destroy(&jobs->meshes);
+	jks_array_destroy(&jobs->pending);
+	jks_hmap_destroy(&jobs->generating);
+	frustum_destroy(&jobs->frustum);
+	pthread_cond_destroy(&jobs->cond);
+	pthread_mutex_destroy(&jobs->mutex);
+}
+
+void world_jobs_set_view(struct world_jobs *jobs, struct vec3f position, const struct mat4f *mat_vp)
+{
+	pthread_mutex_lock(&jobs->mutex);
+	jobs->position = position;
+	frustum_update(&jobs->frustum, mat_vp);
+	pthread_mutex_unlock(&jobs->mutex);
+}
+
+static void push_job(struct world_jobs *jobs, enum world_job_type type, int32_t x, int32_t z)
+{
+	struct world_job job;
+	job.type = type;
+	job.x = x;
+	job.z = z;
+	if (!jks_array_push_back(&jobs->pending, &job))
+	{
+		LOG_ERROR("failed to push job");
+		abort();
+	}
+	pthread_cond_signal(&jobs->cond);
+}
+
+void world_jobs_generate(struct world_jobs *jobs, int32_t x, int32_t z)
+{
+	uint64_t key = job_key(x, z);
+	pthread_mutex_lock(&jobs->mutex);
+	if (!jobs->running
+	 || jks_hmap_get(&jobs->generating, JKS_HMAP_KEY_U64(key)))
+	{
+		pthread_mutex_unlock(&jobs->mutex);
+		return;
+	}
+	uint8_t value = 1;
+	if (!jks_hmap_set(&jobs->generating, JKS_HMAP_KEY_U64(key), &value))
+	{
+		LOG_ERROR("failed to add generating chunk");
+		abort();
+	}
+	push_job(jobs, WORLD_JOB_GENERATE, x, z);
+	pthread_mutex_unlock(&jobs->mutex);
+}
+
+/* deduplicated by the must_generate_buffers flag of the chunk, which is only
+ * accessed with the chunks mutex held
+ */
+void world_jobs_mesh(struct world_jobs *jobs, struct chunk *chunk)
+{
+	pthread_mutex_lock(&jobs->mutex);
+	if (jobs->running)
+		push_job(jobs, WORLD_JOB_MESH, chunk->x, chunk->z);
+	pthread_mutex_unlock(&jobs->mutex);
+}
+
+static float job_priority(struct world_jobs *jobs, const struct world_job *job)
+{
+	float dx = job->x + CHUNK_WIDTH / 2 - jobs->position.x;
+	float dz = job->z + CHUNK_WIDTH / 2 - jobs->position.z;
+	float priority = dx * dx + dz * dz;
+	struct aabb aabb;
+	VEC3_SET(aabb.p0, job->x, 0, job->z);
+	VEC3_SET(aabb.p1, job->x + CHUNK_WIDTH, CHUNK_HEIGHT, job->z + CHUNK_WIDTH);
+	if (!frustum_check_fast(&jobs->frustum, &aabb))
+		priority *= 4;
+	return priority;
+}
+
+/* the view moves between two pops, so the priorities are computed on the fly
+ * instead of keeping the pending jobs sorted
+ */
+static void pop_job(struct world_jobs *jobs, struct world_job *job)
+{
+	size_t best = 0;
+	float best_priority = job_priority(jobs, JKS_ARRAY_GET(&jobs->pending, 0, struct world_job));
+	for (size_t i = 1; i < jobs->pending.size; ++i)
+	{
+		float priority = job_priority(jobs, JKS_ARRAY_GET(&jobs->pending, i, struct world_job));
+		if (priority < best_priority)
+		{
+			best = i;
+			best_priority = priority;
+		}
+	}
+	struct world_job *last = JKS_ARRAY_GET(&jobs->pending, jobs->pending.size - 1, struct world_job);
+	*job = *JKS_ARRAY_GET(&jobs->pending, best, struct world_job);
+	*JKS_ARRAY_GET(&jobs->pending, best, struct world_job) = *last;
+	jks_array_resize(&jobs->pending, jobs->pending.size - 1);
+}
+
+static void run_generate(struct world_worker *worker, const struct world_job *job)
+{
+	struct world_jobs *jobs = worker->jobs;
+	struct world *world = jobs->world;
+	int32_t heights[CHUNK_WIDTH * CHUNK_WIDTH];
+	bool generated = false;
+	pthread_mutex_lock(&world->chunks_mutex);
+	struct chunk *chunk = world_get_chunk(world, job->x, job->z);
+	bool done = chunk && chunk_is_generated(chunk);
+	pthread_mutex_unlock(&world->chunks_mutex);
+	if (!done)
+	{
+		chunk_generate_heights(world, job->x, job->z, heights);
+		pthread_mutex_lock(&world->chunks_mutex);
+		generated = world_generate_chunk(world, job->x, job->z, heights);
+		pthread_mutex_unlock(&world->chunks_mutex);
+	}
+	pthread_mutex_lock(&jobs->mutex);
+	jks_hmap_erase(&jobs->generating, JKS_HMAP_KEY_U64(job_key(job->x, job->z)));
+	if (generated)
+		jobs->generated++;
+	pthread_mutex_unlock(&jobs->mutex);
+}
+
+static void run_mesh(struct world_worker *worker, const struct world_job *job)
+{
+	struct world_jobs *jobs = worker->jobs;
+	struct world *world = jobs->world;
+	pthread_mutex_lock(&world->chunks_mutex);
+	struct chunk *chunk = world_get_chunk(world, job->x, job->z);
+	if (!chunk || !chunk->must_generate_buffers)
+	{
+		pthread_mutex_unlock(&world->chunks_mutex);
+		return;
+	}
+	if (chunk->must_generate_light_map)
+		chunk_generate_light_map(chunk);
+	chunk->must_generate_buffers = false;
+	chunk_snapshot_capture(worker->snapshot, chunk);
+	struct chunk_mesh *mesh = malloc(sizeof(*mesh));
+	if (!mesh)
+	{
+		LOG_ERROR("mesh allocation failed");
+		abort();
+	}
+	mesh->chunk_id = chunk->id;
+	mesh->sequence = ++jobs->mesh_sequence;
+	mesh->x = chunk->x;
+	mesh->z = chunk->z;
+	pthread_mutex_unlock(&world->chunks_mutex);
+	for (size_t i = 0; i < CHUNK_LAYERS; ++i)
+		jks_array_init(&mesh->tessellators[i].vertexes, sizeof(struct shader_blocks_vertex), NULL, NULL);
+	chunk_snapshot_fill_buffers(worker->snapshot, mesh->tessellators, CHUNK_LAYERS);
+	pthread_mutex_lock(&jobs->mutex);
+	if (!jks_array_push_back(&jobs->meshes, &mesh))
+	{
+		LOG_ERROR("failed to push mesh");
+		abort();
+	}
+	jobs->meshed++;
+	pthread_mutex_unlock(&jobs->mutex);
+}
+
+static void *worker_run(void *data)
+{
+	struct world_worker *worker = data;
+	struct world_jobs *jobs = worker->jobs;
+	pthread_mutex_lock(&jobs->mutex);
+	while (1)
+	{
+		while (jobs->running && !jobs->pending.size)
+			pthread_cond_wait(&jobs->cond, &jobs->mutex);
+		if (!jobs->running)
+			break;
+		struct world_job job;
+		pop_job(jobs, &job);
+		pthread_mutex_unlock(&jobs->mutex);
+		switch (job.type)
+		{
+			case WORLD_JOB_GENERATE:
+				run_generate(worker, &job);
+				break;
+			case WORLD_JOB_MESH:
+				run_mesh(worker, &job);
+				break;
+		}
+		pthread_mutex_lock(&jobs->mutex);
+	}
+	pthread_mutex_unlock(&jobs->mutex);
+	return NULL;
+}
+
+static void apply_mesh(struct world_jobs *jobs, struct chunk_mesh *mesh)
+{
+	struct chunk *chunk = world_get_chunk(jobs->world, mesh->x, mesh->z);
+	if (!chunk
+	 || chunk->id != mesh->chunk_id
+	 || chunk->mesh_sequence > mesh->sequence)
+		return;
+	chunk->mesh_sequence = mesh->sequence;
+	for (size_t i = 0; i < CHUNK_LAYERS; ++i)
+	{
+		struct tessellator tmp = chunk->layers[i].tessellator;
+		chunk->layers[i].tessellator = mesh->tessellators[i];
+		mesh->tessellators[i] = tmp;
+	}
+	chunk->must_update_buffers = true;
+}
+
+/* called by the render thread with the chunks mutex held */
+void world_jobs_flush(struct world_jobs *jobs)
+{
+	struct jks_array meshes;
+	jks_array_init(&meshes, sizeof(struct chunk_mesh*), NULL, NULL);
+	pthread_mutex_lock(&jobs->mutex);
+	struct jks_array tmp = jobs->meshes;
+	jobs->meshes = meshes;
+	meshes = tmp;
+	if (g_voxel->frametime - jobs->last_stats >= 1000000000)
+	{
+		jobs->last_stats = g_voxel->frametime;
+		g_voxel->chunk_updates = jobs->meshed;
+		g_voxel->chunk_generations = jobs->generated;
+		jobs->meshed = 0;
+		jobs->generated = 0;
+	}
+	pthread_mutex_unlock(&jobs->mutex);
+	for (size_t i = 0; i < meshes.size; ++i)
+	{
+		struct chunk_mesh *mesh = *JKS_ARRAY_GET(&meshes, i, struct chunk_mesh*);
+		apply_mesh(jobs, mesh);
+		mesh_delete(mesh);
+	}
+	jks_array_destroy(&meshes);
+}
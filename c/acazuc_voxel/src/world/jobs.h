@@ -0,0 +1,82 @@
+#ifndef WORLD_JOBS_H
+#define WORLD_JOBS_H
+
+#include <jks/frustum.h>
+#include <jks/array.h>
+#include <jks/hmap.h>
+#include <jks/mat4.h>
+#include <jks/vec3.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WORLD_JOBS_MAX_WORKERS 16
+
+struct chunk_snapshot;
+struct world_jobs;
+struct chunk;
+struct world;
+
+enum world_job_type
+{
+	WORLD_JOB_GENERATE,
+	WORLD_JOB_MESH,
+};
+
+struct world_job
+{
+	enum world_job_type type;
+	int32_t x;
+	int32_t z;
+};
+
+struct world_worker
+{
+	struct world_jobs *jobs;
+	struct chunk_snapshot *snapshot;
+	pthread_t thread;
+};
+
+/*
+ * pool of workers generating and meshing the chunks
+ *
+ * the pending jobs are picked by distance to the player, the chunks out of
+ * the frustum being pushed back. the terrain noise and the meshing run
+ * without the chunks mutex, meshing working on a snapshot of the chunk and of
+ * its borders; the decoration and the light, which write into the
+ * neighbours, are done under the chunks mutex
+ *
+ * the finished meshes are queued and swapped into the chunks by the render
+ * thread in world_jobs_flush
+ *
+ * lock order is chunks mutex, then jobs mutex
+ */
+struct world_jobs
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct world_worker workers[WORLD_JOBS_MAX_WORKERS];
+	size_t workers_nb;
+	struct world *world;
+	struct jks_array pending; /* struct world_job */
+	struct jks_hmap generating; /* uint64_t, uint8_t */
+	struct jks_array meshes; /* struct chunk_mesh* */
+	struct frustum frustum;
+	struct vec3f position;
+	uint64_t mesh_sequence; /* protected by the chunks mutex */
+	uint64_t generated;
+	uint64_t meshed;
+	int64_t last_stats;
+	bool running;
+};
+
+void world_jobs_init(struct world_jobs *jobs, struct world *world);
+void world_jobs_stop(struct world_jobs *jobs);
+void world_jobs_destroy(struct world_jobs *jobs);
+void world_jobs_set_view(struct world_jobs *jobs, struct vec3f position, const struct mat4f *mat_vp);
+void world_jobs_generate(struct world_jobs *jobs, int32_t x, int32_t z);
+void world_jobs_mesh(struct world_jobs *jobs, struct chunk *chunk);
+void world_jobs_flush(struct world_jobs *jobs);
+
+#endif
@@ -0,0 +1,540 @@
+#include "world/storage.h"
+#include "world/region.h"
+#include "world/light.h"
+#include "world/chunk.h"
+#include "world/world.h"
+
+#include "player/player.h"
+
+#include "block/blocks.h"
+#include "block/block.h"
+
+#include "voxel.h"
+#include "log.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#define BENCHMARK_EDITS 64
+
+static const int8_t directions[6][3] =
+{
+	{-1, 0, 0},
+	{ 1, 0, 0},
+	{ 0,-1, 0},
+	{ 0, 1, 0},
+	{ 0, 0,-1},
+	{ 0, 0, 1},
+};
+
+static void queue_init(struct light_queue *queue)
+{
+	jks_array_init(&queue->nodes, sizeof(struct light_node), NULL, NULL);
+	queue->head = 0;
+}
+
+static void queue_destroy(struct light_queue *queue)
+{
+	jks_array_destroy(&queue->nodes);
+}
+
+static void queue_push(struct light_queue *queue, struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint8_t light)
+{
+	struct light_node *node = jks_array_grow(&queue->nodes, 1);
+	if (!node)
+	{
+		LOG_ERROR("failed to grow light queue");
+		abort();
+	}
+	node->chunk = chunk;
+	node->x = x;
+	node->y = y;
+	node->z = z;
+	node->light = light;
+}
+
+static bool queue_pop(struct light_queue *queue, struct light_node *node)
+{
+	if (queue->head == queue->nodes.size)
+	{
+		if (queue->head)
+		{
+			jks_array_resize(&queue->nodes, 0);
+			queue->head = 0;
+		}
+		return false;
+	}
+	*node = *JKS_ARRAY_GET(&queue->nodes, queue->head, struct light_node);
+	queue->head++;
+	return true;
+}
+
+void light_init(struct light *light)
+{
+	for (size_t i = 0; i < LIGHT_CHANNELS; ++i)
+	{
+		queue_init(&light->add[i]);
+		queue_init(&light->remove[i]);
+	}
+}
+
+void light_destroy(struct light *light)
+{
+	for (size_t i = 0; i < LIGHT_CHANNELS; ++i)
+	{
+		queue_destroy(&light->add[i]);
+		queue_destroy(&light->remove[i]);
+	}
+}
+
+static bool is_available(struct chunk *chunk)
+{
+	return chunk && chunk_is_generated(chunk) && chunk_is_light_populated(chunk);
+}
+
+/* moves x / z to the chunk holding the cell, NULL if it isn't lit */
+static struct chunk *get_chunk(struct chunk *chunk, int32_t *x, int32_t *z)
+{
+	if (*x < 0)
+	{
+		*x += CHUNK_WIDTH;
+		chunk = chunk->chunk_x_less;
+	}
+	else if (*x >= CHUNK_WIDTH)
+	{
+		*x -= CHUNK_WIDTH;
+		chunk = chunk->chunk_x_more;
+	}
+	if (!chunk)
+		return NULL;
+	if (*z < 0)
+	{
+		*z += CHUNK_WIDTH;
+		chunk = chunk->chunk_z_less;
+	}
+	else if (*z >= CHUNK_WIDTH)
+	{
+		*z -= CHUNK_WIDTH;
+		chunk = chunk->chunk_z_more;
+	}
+	if (!is_available(chunk))
+		return NULL;
+	return chunk;
+}
+
+static bool is_sky(struct chunk *chunk, int32_t x, int32_t y, int32_t z)
+{
+	return y > chunk_get_top_block(chunk, x, z);
+}
+
+static const struct block_def *get_block_def(struct chunk *chunk, int32_t x, int32_t y, int32_t z)
+{
+	struct block block;
+	if (!chunk_get_block(chunk, x, y, z, &block))
+		block.type = 0;
+	const struct block_def *block_def = g_voxel->blocks->blocks[block.type];
+	if (!block_def)
+		block_def = g_voxel->blocks->blocks[0];
+	return block_def;
+}
+
+/* light lost when entering the cell, 0xF if the light can't enter it */
+static uint8_t get_attenuation(const struct block_def *block_def)
+{
+	if (block_def->opacity >= 0xF)
+		return 0xF;
+	if (!block_def->opacity)
+		return 1;
+	return block_def->opacity;
+}
+
+static uint8_t get_light(struct chunk *chunk, enum light_channel channel, int32_t x, int32_t y, int32_t z)
+{
+	if (channel == LIGHT_SKY)
+	{
+		if (is_sky(chunk, x, y, z))
+			return 0xF;
+		return chunk_get_sky_light_val(chunk, x, y, z);
+	}
+	return chunk_get_block_light(chunk, x, y, z);
+}
+
+static void set_light(struct chunk *chunk, enum light_channel channel, int32_t x, int32_t y, int32_t z, uint8_t light)
+{
+	if (channel == LIGHT_SKY)
+		chunk_set_sky_light(chunk, x, y, z, light);
+	else
+		chunk_set_block_light(chunk, x, y, z, light);
+	chunk_touch(chunk, x, z);
+}
+
+/* light emitted into a stored cell: the sky directly above or beside it, or
+ * the block itself
+ */
+static uint8_t get_source(struct chunk *chunk, enum light_channel channel, int32_t x, int32_t y, int32_t z)
+{
+	const struct block_def *block_def = get_block_def(chunk, x, y, z);
+	if (channel == LIGHT_BLOCK)
+		return block_def->light;
+	uint8_t attenuation = get_attenuation(block_def);
+	if (attenuation >= 0xF)
+		return 0;
+	if (y == chunk_get_top_block(chunk, x, z))
+		return 0xF - attenuation;
+	for (size_t i = 0; i < 6; ++i)
+	{
+		if (directions[i][1])
+			continue;
+		int32_t nx = x + directions[i][0];
+		int32_t nz = z + directions[i][2];
+		struct chunk *neighbour = get_chunk(chunk, &nx, &nz);
+		if (neighbour && is_sky(neighbour, nx, y, nz))
+			return 0xF - attenuation;
+	}
+	return 0;
+}
+
+static void seed(struct light *light, struct chunk *chunk, enum light_channel channel, int32_t x, int32_t y, int32_t z)
+{
+	uint8_t source = get_source(chunk, channel, x, y, z);
+	if (source <= get_light(chunk, channel, x, y, z))
+		return;
+	set_light(chunk, channel, x, y, z, source);
+	queue_push(&light->add[channel], chunk, x, y, z, source);
+}
+
+static void unlight(struct light *light, struct chunk *chunk, enum light_channel channel, int32_t x, int32_t y, int32_t z, uint8_t level)
+{
+	set_light(chunk, channel, x, y, z, 0);
+	queue_push(&light->remove[channel], chunk, x, y, z, level);
+}
+
+static void push_neighbours(struct light *light, struct chunk *chunk, enum light_channel channel, int32_t x, int32_t y, int32_t z)
+{
+	for (size_t i = 0; i < 6; ++i)
+	{
+		int32_t ny = y + directions[i][1];
+		if (ny < 0 || ny >= CHUNK_HEIGHT)
+			continue;
+		int32_t nx = x + directions[i][0];
+		int32_t nz = z + directions[i][2];
+		struct chunk *neighbour = get_chunk(chunk, &nx, &nz);
+		if (!neighbour)
+			continue;
+		uint8_t level = get_light(neighbour, channel, nx, ny, nz);
+		if (level > 1)
+			queue_push(&light->add[channel], neighbour, nx, ny, nz, level);
+	}
+}
+
+static void process_remove(struct light *light, enum light_channel channel)
+{
+	struct light_queue *queue = &light->remove[channel];
+	struct light_node node;
+	while (queue_pop(queue, &node))
+	{
+		seed(light, node.chunk, channel, node.x, node.y, node.z);
+		for (size_t i = 0; i < 6; ++i)
+		{
+			int32_t ny = node.y + directions[i][1];
+			if (ny < 0 || ny >= CHUNK_HEIGHT)
+				continue;
+			int32_t nx = node.x + directions[i][0];
+			int32_t nz = node.z + directions[i][2];
+			struct chunk *neighbour = get_chunk(node.chunk, &nx, &nz);
+			if (!neighbour)
+				continue;
+			if (channel == LIGHT_SKY && is_sky(neighbour, nx, ny, nz))
+				continue;
+			uint8_t level = get_light(neighbour, channel, nx, ny, nz);
+			if (!level)
+				continue;
+			if (level < node.light)
+				unlight(light, neighbour, channel, nx, ny, nz, level);
+			else
+				queue_push(&light->add[channel], neighbour, nx, ny, nz, level);
+		}
+	}
+}
+
+static void process_add(struct light *light, enum light_channel channel)
+{
+	struct light_queue *queue = &light->add[channel];
+	struct light_node node;
+	while (queue_pop(queue, &node))
+	{
+		/* the cell may have been updated since it was queued */
+		uint8_t level = get_light(node.chunk, channel, node.x, node.y, node.z);
+		if (level <= 1)
+			continue;
+		for (size_t i = 0; i < 6; ++i)
+		{
+			int32_t ny = node.y + directions[i][1];
+			if (ny < 0 || ny >= CHUNK_HEIGHT)
+				continue;
+			int32_t nx = node.x + directions[i][0];
+			int32_t nz = node.z + directions[i][2];
+			struct chunk *neighbour = get_chunk(node.chunk, &nx, &nz);
+			if (!neighbour)
+				continue;
+			if (channel == LIGHT_SKY && is_sky(neighbour, nx, ny, nz))
+				continue;
+			uint8_t attenuation = get_attenuation(get_block_def(neighbour, nx, ny, nz));
+			if (level <= attenuation)
+				continue;
+			uint8_t new_level = level - attenuation;
+			if (get_light(neighbour, channel, nx, ny, nz) >= new_level)
+				continue;
+			set_light(neighbour, channel, nx, ny, nz, new_level);
+			queue_push(queue, neighbour, nx, ny, nz, new_level);
+		}
+	}
+}
+
+static void process(struct light *light)
+{
+	for (size_t i = 0; i < LIGHT_CHANNELS; ++i)
+	{
+		process_remove(light, i);
+		process_add(light, i);
+	}
+}
+
+static uint8_t get_lowest_neighbour_top(struct chunk *chunk, int32_t x, int32_t z)
+{
+	uint8_t lowest = CHUNK_HEIGHT;
+	for (size_t i = 0; i < 6; ++i)
+	{
+		if (directions[i][1])
+			continue;
+		int32_t nx = x + directions[i][0];
+		int32_t nz = z + directions[i][2];
+		struct chunk *neighbour = get_chunk(chunk, &nx, &nz);
+		if (!neighbour)
+			continue;
+		uint8_t top = chunk_get_top_block(neighbour, nx, nz);
+		if (top < lowest)
+			lowest = top;
+	}
+	return lowest;
+}
+
+static void seed_column(struct light *light, struct chunk *chunk, int32_t x, int32_t z)
+{
+	int32_t top = chunk_get_top_block(chunk, x, z);
+	int32_t lowest = get_lowest_neighbour_top(chunk, x, z);
+	for (int32_t y = top; y >= 0 && (y == top || y > lowest); --y)
+		seed(light, chunk, LIGHT_SKY, x, y, z);
+}
+
+/* pushes the border of a neighbour into the chunk, and lights the cells of
+ * the border now lying beside the sky of the chunk
+ */
+static void seed_border(struct light *light, struct chunk *chunk, struct chunk *neighbour, int32_t x, int32_t z, int32_t nx, int32_t nz)
+{
+	int32_t top = chunk_get_top_block(neighbour, nx, nz);
+	int32_t chunk_top = chunk_get_top_block(chunk, x, z);
+	for (int32_t y = 0; y <= top; ++y)
+	{
+		if (y > chunk_top)
+			seed(light, neighbour, LIGHT_SKY, nx, y, nz);
+		uint8_t level = get_light(neighbour, LIGHT_SKY, nx, y, nz);
+		if (level > 1)
+			queue_push(&light->add[LIGHT_SKY], neighbour, nx, y, nz, level);
+	}
+	for (int32_t y = 0; y < CHUNK_HEIGHT; ++y)
+	{
+		uint8_t level = get_light(neighbour, LIGHT_BLOCK, nx, y, nz);
+		if (level > 1)
+			queue_push(&light->add[LIGHT_BLOCK], neighbour, nx, y, nz, level);
+	}
+}
+
+static void seed_borders(struct light *light, struct chunk *chunk)
+{
+	for (int32_t i = 0; i < CHUNK_WIDTH; ++i)
+	{
+		if (is_available(chunk->chunk_x_less))
+			seed_border(light, chunk, chunk->chunk_x_less, 0, i, CHUNK_WIDTH - 1, i);
+		if (is_available(chunk->chunk_x_more))
+			seed_border(light, chunk, chunk->chunk_x_more, CHUNK_WIDTH - 1, i, 0, i);
+		if (is_available(chunk->chunk_z_less))
+			seed_border(light, chunk, chunk->chunk_z_less, i, 0, i, CHUNK_WIDTH - 1);
+		if (is_available(chunk->chunk_z_more))
+			seed_border(light, chunk, chunk->chunk_z_more, i, CHUNK_WIDTH - 1, i, 0);
+	}
+}
+
+static void seed_blocks(struct light *light, struct chunk *chunk)
+{
+	for (size_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
+	{
+		struct storage *storage = chunk->storages[i];
+		if (!storage)
+			continue;
+		for (int32_t y = 0; y < CHUNK_STORAGE_HEIGHT; ++y)
+		{
+			for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
+			{
+				for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
+				{
+					struct block block = storage_get_block(storage, x, y, z);
+					const struct block_def *block_def = g_voxel->blocks->blocks[block.type];
+					if (block_def && block_def->light)
+						seed(light, chunk, LIGHT_BLOCK, x, i * CHUNK_STORAGE_HEIGHT + y, z);
+				}
+			}
+		}
+	}
+}
+
+void light_generate_chunk(struct light *light, struct chunk *chunk)
+{
+	for (size_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
+	{
+		struct storage *storage = chunk->storages[i];
+		if (!storage)
+			continue;
+		storage_reset_lights(storage);
+	}
+	chunk_set_light_populated(chunk, true);
+	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
+	{
+		for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
+			seed_column(light, chunk, x, z);
+	}
+	seed_blocks(light, chunk);
+	seed_borders(light, chunk);
+	process(light);
+}
+
+static void remove_border(struct light *light, struct chunk *neighbour, int32_t nx, int32_t nz)
+{
+	int32_t top = chunk_get_top_block(neighbour, nx, nz);
+	for (int32_t y = 0; y < CHUNK_HEIGHT; ++y)
+	{
+		for (size_t i = 0; i < LIGHT_CHANNELS; ++i)
+		{
+			if (i == LIGHT_SKY && y > top)
+				continue;
+			uint8_t level = get_light(neighbour, i, nx, y, nz);
+			if (level && level != get_source(neighbour, i, nx, y, nz))
+				unlight(light, neighbour, i, nx, y, nz, level);
+		}
+	}
+}
+
+/* called once the neighbours no longer point to the chunk: unlights the
+ * cells of their borders that aren't lit by their own source, and so
+ * everything that was lit through the chunk, before lighting them back from
+ * what remains
+ */
+void light_remove_chunk(struct light *light, struct chunk *chunk)
+{
+	for (int32_t i = 0; i < CHUNK_WIDTH; ++i)
+	{
+		if (is_available(chunk->chunk_x_less))
+			remove_border(light, chunk->chunk_x_less, CHUNK_WIDTH - 1, i);
+		if (is_available(chunk->chunk_x_more))
+			remove_border(light, chunk->chunk_x_more, 0, i);
+		if (is_available(chunk->chunk_z_less))
+			remove_border(light, chunk->chunk_z_less, i, CHUNK_WIDTH - 1);
+		if (is_available(chunk->chunk_z_more))
+			remove_border(light, chunk->chunk_z_more, i, 0);
+	}
+	process(light);
+}
+
+void light_update_block(struct light *light, struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint8_t old_top)
+{
+	uint8_t top = chunk_get_top_block(chunk, x, z);
+	/* the cells between both tops were lit by the sky and are not anymore,
+	 * or are now lit by the sky
+	 */
+	for (int32_t i = old_top + 1; i <= top; ++i)
+		unlight(light, chunk, LIGHT_SKY, x, i, z, 0xF);
+	for (int32_t i = top + 1; i <= old_top; ++i)
+		queue_push(&light->add[LIGHT_SKY], chunk, x, i, z, 0xF);
+	for (size_t i = 0; i < LIGHT_CHANNELS; ++i)
+	{
+		if (i == LIGHT_SKY && y > top)
+			continue;
+		uint8_t level = get_light(chunk, i, x, y, z);
+		if (level)
+			unlight(light, chunk, i, x, y, z, level);
+		else
+			seed(light, chunk, i, x, y, z);
+		push_neighbours(light, chunk, i, x, y, z);
+	}
+	process(light);
+}
+
+static void benchmark_edit(struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint16_t type, uint64_t *duration)
+{
+	uint64_t started = nanotime();
+	chunk_set_block(chunk, x, y, z, type);
+	*duration += nanotime() - started;
+}
+
+void light_benchmark(struct light *light, struct world *world)
+{
+	uint64_t generate_duration = 0;
+	uint64_t generate_max = 0;
+	uint32_t generate_count = 0;
+	struct region *region;
+	TAILQ_FOREACH(region, &world->regions, chain)
+	{
+		for (size_t i = 0; i < REGION_WIDTH * REGION_WIDTH; ++i)
+		{
+			struct chunk *chunk = region->chunks[i];
+			if (!is_available(chunk))
+				continue;
+			uint64_t started = nanotime();
+			light_generate_chunk(light, chunk);
+			uint64_t duration = nanotime() - started;
+			generate_duration += duration;
+			if (duration > generate_max)
+				generate_max = duration;
+			generate_count++;
+		}
+	}
+	uint64_t place_duration = 0;
+	uint64_t break_duration = 0;
+	uint64_t dig_duration = 0;
+	uint32_t edits_count = 0;
+	int32_t player_x = world->player->entity.pos.x;
+	int32_t player_z = world->player->entity.pos.z;
+	for (int32_t i = 0; i < BENCHMARK_EDITS; ++i)
+	{
+		int32_t world_x = player_x + (i % 8 - 4) * 4;
+		int32_t world_z = player_z + (i / 8 - 4) * 4;
+		struct chunk *chunk = world_get_chunk(world, world_x, world_z);
+		if (!is_available(chunk))
+			continue;
+		int32_t x = world_x - chunk->x;
+		int32_t z = world_z - chunk->z;
+		int32_t top = chunk_get_top_block(chunk, x, z);
+		struct block block;
+		if (top + 1 >= CHUNK_HEIGHT || top < 3
+		 || !chunk_get_block(chunk, x, top - 2, z, &block)
+		 || !block.type)
+			continue;
+		/* a block over the column, removed, then a hole under the surface */
+		benchmark_edit(chunk, x, top + 1, z, 1, &place_duration);
+		benchmark_edit(chunk, x, top + 1, z, 0, &break_duration);
+		benchmark_edit(chunk, x, top - 2, z, 0, &dig_duration);
+		chunk_set_block(chunk, x, top - 2, z, block.type);
+		edits_count++;
+	}
+	if (generate_count)
+		LOG_INFO("chunk lighting: %" PRIu32 " chunks, %" PRIu64 " us avg, %" PRIu64 " us max",
+		         generate_count,
+		         generate_duration / generate_count / 1000,
+		         generate_max / 1000);
+	if (edits_count)
+		LOG_INFO("block edits: %" PRIu32 " columns, place %.1f us, break %.1f us, dig %.1f us avg",
+		         edits_count,
+		         place_duration / (edits_count * 1000.0),
+		         break_duration / (edits_count * 1000.0),
+		         dig_duration / (edits_count * 1000.0));
+}
@@ -0,0 +1,58 @@
+#ifndef WORLD_LIGHT_H
+#define WORLD_LIGHT_H
+
+#include <jks/array.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct chunk;
+struct world;
+
+enum light_channel
+{
+	LIGHT_SKY,
+	LIGHT_BLOCK,
+	LIGHT_CHANNELS,
+};
+
+struct light_node
+{
+	struct chunk *chunk;
+	uint8_t x;
+	uint8_t y;
+	uint8_t z;
+	uint8_t light;
+};
+
+struct light_queue
+{
+	struct jks_array nodes; /* struct light_node */
+	size_t head;
+};
+
+/*
+ * breadth-first propagation of the sky and block lights
+ *
+ * the cells above the top block of a column are implicitly lit by the sky,
+ * every other cell is stored and updated through the queues: additions
+ * spread a light level to the neighbours, removals clear the cells that were
+ * lit by a removed level and re-queue the brighter cells around them
+ *
+ * the propagation crosses chunk borders through the neighbours pointers and
+ * only visits the chunks that have their light populated
+ */
+struct light
+{
+	struct light_queue add[LIGHT_CHANNELS];
+	struct light_queue remove[LIGHT_CHANNELS];
+};
+
+void light_init(struct light *light);
+void light_destroy(struct light *light);
+void light_generate_chunk(struct light *light, struct chunk *chunk);
+void light_remove_chunk(struct light *light, struct chunk *chunk);
+void light_update_block(struct light *light, struct chunk *chunk, int32_t x, int32_t y, int32_t z, uint8_t old_top);
+void light_benchmark(struct light *light, struct world *world);
+
+#endif
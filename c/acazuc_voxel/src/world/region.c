@@ -330,12 +330,15 @@ void region_draw(struct region *region, uint8_t layer)
 	}
 }
 
-void region_generate_chunk(struct region *region, int32_t x, int32_t z)
+bool region_generate_chunk(struct region *region, int32_t x, int32_t z, const int32_t *heights)
 {
 	struct chunk *chunk = region_get_chunk(region, x, z);
 	if (!chunk)
 		chunk = region_create_chunk(region, x, z);
-	chunk_generate(chunk);
+	if (chunk_is_generated(chunk))
+		return false;
+	chunk_generate(chunk, heights);
+	return true;
 }
 
 static bool read_chunk_storage(struct region *region, uint32_t storage,
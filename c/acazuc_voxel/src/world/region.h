@@ -5,6 +5,7 @@
 
 #include <sys/queue.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -35,7 +36,7 @@ void region_save_chunk(struct region *region, struct chunk *chunk);
 void region_tick(struct region *region);
 void region_draw_entities(struct region *region);
 void region_draw(struct region *region, uint8_t layer);
-void region_generate_chunk(struct region *region, int32_t x, int32_t z);
+bool region_generate_chunk(struct region *region, int32_t x, int32_t z, const int32_t *heights);
 struct chunk *region_create_chunk(struct region *region, int32_t x, int32_t z);
 void region_set_chunk(struct region *region, int32_t x, int32_t z, struct chunk *chunk);
 struct chunk *region_get_chunk(struct region *region, int32_t x, int32_t z);
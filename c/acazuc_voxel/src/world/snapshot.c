@@ -0,0 +1,240 @@
+#include "world/tessellator.h"
+#include "world/snapshot.h"
+#include "world/storage.h"
+#include "world/chunk.h"
+
+#include "block/render.h"
+
+#include <string.h>
+
+static void capture_cell(struct chunk_snapshot *snapshot, struct chunk *chunk, int32_t x, int32_t z, int32_t cx, int32_t cz)
+{
+	for (int32_t y = 0; y < CHUNK_HEIGHT; ++y)
+	{
+		struct snapshot_cell *cell = (struct snapshot_cell*)chunk_snapshot_cell(snapshot, x, y, z);
+		struct block block;
+		if (!chunk)
+		{
+			cell->type = 0;
+			cell->data = 0;
+			cell->light = 15;
+			continue;
+		}
+		if (chunk_get_block(chunk, cx, y, cz, &block))
+		{
+			cell->type = block.type;
+			cell->data = block.data;
+		}
+		else
+		{
+			cell->type = 0;
+			cell->data = 0;
+		}
+		cell->light = chunk_get_light(chunk, cx, y, cz);
+	}
+}
+
+static void capture_borders(struct chunk_snapshot *snapshot, struct chunk *chunk)
+{
+	for (int32_t i = 0; i < CHUNK_WIDTH; ++i)
+	{
+		capture_cell(snapshot, chunk->chunk_x_less, -1, i, CHUNK_WIDTH - 1, i);
+		capture_cell(snapshot, chunk->chunk_x_more, CHUNK_WIDTH, i, 0, i);
+		capture_cell(snapshot, chunk->chunk_z_less, i, -1, i, CHUNK_WIDTH - 1);
+		capture_cell(snapshot, chunk->chunk_z_more, i, CHUNK_WIDTH, i, 0);
+	}
+	capture_cell(snapshot, chunk->chunk_x_less_z_less, -1, -1, CHUNK_WIDTH - 1, CHUNK_WIDTH - 1);
+	capture_cell(snapshot, chunk->chunk_x_less_z_more, -1, CHUNK_WIDTH, CHUNK_WIDTH - 1, 0);
+	capture_cell(snapshot, chunk->chunk_x_more_z_less, CHUNK_WIDTH, -1, 0, CHUNK_WIDTH - 1);
+	capture_cell(snapshot, chunk->chunk_x_more_z_more, CHUNK_WIDTH, CHUNK_WIDTH, 0, 0);
+}
+
+void chunk_snapshot_capture(struct chunk_snapshot *snapshot, struct chunk *chunk)
+{
+	snapshot->x = chunk->x;
+	snapshot->z = chunk->z;
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		snapshot->faces_min_y[i] = CHUNK_HEIGHT;
+		snapshot->faces_max_y[i] = -1;
+	}
+	snapshot->storages_mask = 0;
+	for (size_t i = 0; i < sizeof(chunk->storages) / sizeof(*chunk->storages); ++i)
+	{
+		struct storage *storage = chunk->storages[i];
+		if (!storage)
+			continue;
+		struct snapshot_storage *dst = &snapshot->storages[i];
+		memcpy(dst->blocks, storage->nbt.Blocks->value, sizeof(dst->blocks));
+		memcpy(dst->add, storage->nbt.Add->value, sizeof(dst->add));
+		memcpy(dst->data, storage->nbt.Data->value, sizeof(dst->data));
+		memcpy(dst->block_light, storage->nbt.BlockLight->value, sizeof(dst->block_light));
+		memcpy(dst->sky_light, storage->nbt.SkyLight->value, sizeof(dst->sky_light));
+		snapshot->storages_mask |= 1 << i;
+	}
+	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
+	{
+		for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
+			snapshot->top[chunk_xz_id(x, z)] = chunk_get_top_block(chunk, x, z);
+	}
+	capture_borders(snapshot, chunk);
+}
+
+static uint8_t get_nibble(const uint8_t *values, uint32_t id)
+{
+	if (id & 1)
+		return values[id / 2] & 0xF;
+	return (values[id / 2] >> 4) & 0xF;
+}
+
+static void decode_storage(struct chunk_snapshot *snapshot, uint8_t id)
+{
+	const struct snapshot_storage *storage = &snapshot->storages[id];
+	bool present = snapshot->storages_mask & (1 << id);
+	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
+	{
+		for (int32_t y = 0; y < CHUNK_STORAGE_HEIGHT; ++y)
+		{
+			int32_t chunk_y = id * CHUNK_STORAGE_HEIGHT + y;
+			if (chunk_y >= CHUNK_HEIGHT)
+				break;
+			for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
+			{
+				struct snapshot_cell *cell = (struct snapshot_cell*)chunk_snapshot_cell(snapshot, x, chunk_y, z);
+				if (!present)
+				{
+					cell->type = 0;
+					cell->data = 0;
+					cell->light = 0xF;
+					continue;
+				}
+				uint32_t idx = storage_xyz_id(x, y, z);
+				uint8_t add = idx & 1 ? storage->add[idx / 2] & 0x0F : (storage->add[idx / 2] & 0xF0) >> 4;
+				cell->type = storage->blocks[idx] | (add << 8);
+				cell->data = get_nibble(storage->data, idx);
+				if (chunk_y > snapshot->top[chunk_xz_id(x, z)])
+				{
+					cell->light = 0xF;
+					continue;
+				}
+				uint8_t sky_light = get_nibble(storage->sky_light, idx);
+				uint8_t block_light = get_nibble(storage->block_light, idx);
+				cell->light = block_light > sky_light ? block_light : sky_light;
+			}
+		}
+	}
+}
+
+/*
+ * greedy merge of the faces of one direction: for each slice along the
+ * normal, grow each face along u while the key matches, then along v while
+ * the whole row matches, and emit the rectangle as a single quad
+ */
+static void merge_faces(struct chunk_snapshot *snapshot, struct tessellator *tessellator, uint8_t face_id)
+{
+	int32_t dims[3] = {CHUNK_WIDTH, snapshot->faces_max_y[face_id] + 1, CHUNK_WIDTH};
+	int32_t start[3] = {0, snapshot->faces_min_y[face_id], 0};
+	static const uint8_t axes[6][3] =
+	{
+		{2, 0, 1}, /* front: slice z, u x, v y */
+		{2, 0, 1}, /* back */
+		{0, 2, 1}, /* left: slice x, u z, v y */
+		{0, 2, 1}, /* right */
+		{1, 0, 2}, /* top: slice y, u x, v z */
+		{1, 0, 2}, /* bottom */
+	};
+	uint64_t *faces = snapshot->faces[face_id];
+	uint8_t n = axes[face_id][0];
+	uint8_t u = axes[face_id][1];
+	uint8_t v = axes[face_id][2];
+	int32_t pos[3];
+	for (pos[n] = start[n]; pos[n] < dims[n]; ++pos[n])
+	{
+		for (int32_t j = start[v]; j < dims[v]; ++j)
+		{
+			for (int32_t i = start[u]; i < dims[u];)
+			{
+				pos[u] = i;
+				pos[v] = j;
+				uint64_t key = faces[chunk_snapshot_face_id(pos[0], pos[1], pos[2])];
+				if (!key)
+				{
+					++i;
+					continue;
+				}
+				int32_t w = 1;
+				for (; i + w < dims[u]; ++w)
+				{
+					pos[u] = i + w;
+					if (faces[chunk_snapshot_face_id(pos[0], pos[1], pos[2])] != key)
+						break;
+				}
+				int32_t h = 1;
+				for (; j + h < dims[v]; ++h)
+				{
+					pos[v] = j + h;
+					int32_t k;
+					for (k = 0; k < w; ++k)
+					{
+						pos[u] = i + k;
+						if (faces[chunk_snapshot_face_id(pos[0], pos[1], pos[2])] != key)
+							break;
+					}
+					if (k != w)
+						break;
+				}
+				for (int32_t dv = 0; dv < h; ++dv)
+				{
+					pos[v] = j + dv;
+					for (int32_t du = 0; du < w; ++du)
+					{
+						pos[u] = i + du;
+						faces[chunk_snapshot_face_id(pos[0], pos[1], pos[2])] = 0;
+					}
+				}
+				int32_t size[3];
+				size[n] = 1;
+				size[u] = w;
+				size[v] = h;
+				pos[u] = i;
+				pos[v] = j;
+				struct vec3f org;
+				struct vec3f dst;
+				struct vec3f color;
+				VEC3_SET(org, pos[0], pos[1], pos[2]);
+				VEC3_SET(dst, pos[0] + size[0], pos[1] + size[1], pos[2] + size[2]);
+				VEC3_SET(color, ((key >> 24) & 0xFF) / 255.0f, ((key >> 16) & 0xFF) / 255.0f, ((key >> 8) & 0xFF) / 255.0f);
+				add_face_tiled(tessellator, 1 << face_id, org, dst, key & 0xFF, color);
+				i += w;
+			}
+		}
+	}
+	snapshot->faces_min_y[face_id] = CHUNK_HEIGHT;
+	snapshot->faces_max_y[face_id] = -1;
+}
+
+void chunk_snapshot_fill_buffers(struct chunk_snapshot *snapshot, struct tessellator *tessellators, uint8_t layers_nb)
+{
+	for (uint8_t i = 0; i < sizeof(snapshot->storages) / sizeof(*snapshot->storages); ++i)
+		decode_storage(snapshot, i);
+	for (uint8_t layer = 0; layer < layers_nb; ++layer)
+	{
+		for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
+		{
+			for (int32_t y = 0; y < CHUNK_HEIGHT; ++y)
+			{
+				for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
+				{
+					struct block block = chunk_snapshot_get_block(snapshot, x, y, z);
+					if (!block.type)
+						continue;
+					struct vec3f pos;
+					VEC3_SET(pos, x, y, z);
+					block_fill_buffers(block, snapshot, pos, &tessellators[layer], layer);
+				}
+			}
+		}
+		for (uint8_t face = 0; face < 6; ++face)
+			merge_faces(snapshot, &tessellators[layer], face);
+	}
+}
@@ -0,0 +1,97 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include "world/storage.h"
+#include "world/block.h"
+
+#include "const.h"
+
+#include <stdint.h>
+
+#define SNAPSHOT_WIDTH (CHUNK_WIDTH + 2)
+#define SNAPSHOT_STORAGE_SIZE (CHUNK_WIDTH * CHUNK_WIDTH * CHUNK_STORAGE_HEIGHT)
+#define SNAPSHOT_FACES_SIZE (CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_WIDTH)
+
+struct tessellator;
+struct chunk;
+
+struct snapshot_cell
+{
+	uint16_t type;
+	uint8_t data;
+	uint8_t light;
+};
+
+struct snapshot_storage
+{
+	uint8_t blocks[SNAPSHOT_STORAGE_SIZE];
+	uint8_t add[SNAPSHOT_STORAGE_SIZE / 2];
+	uint8_t data[SNAPSHOT_STORAGE_SIZE / 2];
+	uint8_t block_light[SNAPSHOT_STORAGE_SIZE / 2];
+	uint8_t sky_light[SNAPSHOT_STORAGE_SIZE / 2];
+};
+
+/*
+ * copy of everything the meshing of a chunk reads, so the buffers can be
+ * built without holding the chunks mutex
+ *
+ * the capture only copies the raw storages of the chunk and decodes the one
+ * cell wide border of its neighbours into the cells grid, the center of the
+ * grid is decoded by chunk_snapshot_fill_buffers once the lock is released
+ *
+ * cells of missing chunks or storages are air, missing neighbours are fully
+ * lit, as with chunk_get_block / chunk_get_light
+ *
+ * faces holds, for each direction, the uniformly lit full tile faces found
+ * while filling a layer (see block_fill_buffers); they are merged into
+ * larger quads at the end of the layer, which leaves the grids zeroed;
+ * faces_min_y / faces_max_y bound the rows holding faces (empty when
+ * min > max)
+ */
+struct chunk_snapshot
+{
+	struct snapshot_storage storages[16];
+	struct snapshot_cell cells[SNAPSHOT_WIDTH * CHUNK_HEIGHT * SNAPSHOT_WIDTH];
+	uint64_t faces[6][SNAPSHOT_FACES_SIZE];
+	int32_t faces_min_y[6];
+	int32_t faces_max_y[6];
+	uint8_t top[CHUNK_WIDTH * CHUNK_WIDTH];
+	uint16_t storages_mask;
+	int32_t x;
+	int32_t z;
+};
+
+void chunk_snapshot_capture(struct chunk_snapshot *snapshot, struct chunk *chunk);
+void chunk_snapshot_fill_buffers(struct chunk_snapshot *snapshot, struct tessellator *tessellators, uint8_t layers_nb);
+
+static inline const struct snapshot_cell *chunk_snapshot_cell(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z)
+{
+	return &snapshot->cells[((x + 1) * CHUNK_HEIGHT + y) * SNAPSHOT_WIDTH + z + 1];
+}
+
+static inline struct block chunk_snapshot_get_block(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z)
+{
+	const struct snapshot_cell *cell = chunk_snapshot_cell(snapshot, x, y, z);
+	struct block block;
+	block.type = cell->type;
+	block.data = cell->data;
+	return block;
+}
+
+static inline uint8_t chunk_snapshot_get_light(const struct chunk_snapshot *snapshot, int32_t x, int32_t y, int32_t z)
+{
+	return chunk_snapshot_cell(snapshot, x, y, z)->light;
+}
+
+static inline uint32_t chunk_snapshot_face_id(int32_t x, int32_t y, int32_t z)
+{
+	return (x * CHUNK_HEIGHT + y) * CHUNK_WIDTH + z;
+}
+
+/* faces with the same key can be merged, 0 being no face */
+static inline uint64_t chunk_snapshot_face_key(uint8_t tile, const uint8_t *color)
+{
+	return (1ull << 32) | ((uint64_t)color[0] << 24) | ((uint64_t)color[1] << 16) | ((uint64_t)color[2] << 8) | tile;
+}
+
+#endif
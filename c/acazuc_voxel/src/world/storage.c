@@ -1,6 +1,5 @@
 #include "world/storage.h"
 #include "world/block.h"
-#include "world/chunk.h"
 
 #include "log.h"
 
@@ -42,25 +41,6 @@ void storage_delete(struct storage *storage)
 	free(storage);
 }
 
-void storage_fill_buffers(struct storage *storage, struct chunk *chunk, struct tessellator *tessellator, uint8_t layer)
-{
-	for (int32_t x = 0; x < CHUNK_WIDTH; ++x)
-	{
-		for (int32_t y = 0; y < CHUNK_STORAGE_HEIGHT; ++y)
-		{
-			for (int32_t z = 0; z < CHUNK_WIDTH; ++z)
-			{
-				struct block block = storage_get_block(storage, x, y, z);
-				if (!block.type)
-					continue;
-				struct vec3f pos;
-				VEC3_SET(pos, chunk->x + x, storage->id * CHUNK_STORAGE_HEIGHT + y, chunk->z + z);
-				block_fill_buffers(block, chunk, pos, tessellator, layer);
-			}
-		}
-	}
-}
-
 void storage_reset_lights(struct storage *storage)
 {
 	memset(storage->nbt.BlockLight->value, 0, storage->nbt.BlockLight->count);
@@ -11,9 +11,7 @@
 
 #define CHUNK_STORAGE_HEIGHT 16
 
-struct tessellator;
 struct block;
-struct chunk;
 
 struct storage_nbt
 {
@@ -34,7 +32,6 @@ struct storage
 
 struct storage *storage_new(uint8_t id, struct nbt_tag_compound *nbt);
 void storage_delete(struct storage *storage);
-void storage_fill_buffers(struct storage *storage, struct chunk *chunk, struct tessellator *tessellator, uint8_t layer);
 void storage_reset_lights(struct storage *storage);
 void storage_set_block(struct storage *storage, int32_t x, int32_t y, int32_t z, uint16_t type);
 struct block storage_get_block(struct storage *storage, int32_t x, int32_t y, int32_t z);
@@ -5,8 +5,7 @@
 
 struct tessellator
 {
-	struct jks_array indices; /* uint32_t */
-	struct jks_array vertexes; /* struct shader_blocks_vertex */
+	struct jks_array vertexes; /* struct shader_blocks_vertex, 4 per quad */
 };
 
 #endif
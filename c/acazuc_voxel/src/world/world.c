@@ -25,7 +25,18 @@
 
 uint64_t g_seed = 1337;
 
-static void *updater_run(void *data);
+void world_benchmark_light(struct world *world)
+{
+	pthread_mutex_lock(&world->chunks_mutex);
+	light_benchmark(&world->light, world);
+	pthread_mutex_unlock(&world->chunks_mutex);
+}
+
+void world_benchmark_noise(struct world *world)
+{
+	simplex_noise_benchmark(&world->noise);
+}
+
 static void *loader_run(void *data);
 
 struct world *world_new(void)
@@ -36,7 +47,6 @@ struct world *world_new(void)
 		LOG_ERROR("world allocation failed");
 		return NULL;
 	}
-	TAILQ_INIT(&world->chunks_to_update);
 	world->seed = g_seed;
 	world->last_region_check = g_voxel->frametime;
 	TAILQ_INIT(&world->regions);
@@ -46,6 +56,7 @@ struct world *world_new(void)
 	frustum_init(&world->frustum);
 	clouds_init(&world->clouds, world);
 	skybox_init(&world->skybox, world);
+	light_init(&world->light);
 	simplex_noise_init(&world->biome_temp_noise, 16, 0.70, 1334538);
 	simplex_noise_init(&world->biome_rain_noise, 16, 0.70, 1222222339);
 	simplex_noise_init(&world->noise, 16, 0.5, world->seed);
@@ -62,7 +73,7 @@ struct world *world_new(void)
 	world->random[1] = world->seed >> 16;
 	world->random[2] = world->seed >> 32;
 	world->running = true;
-	pthread_create(&world->updater_thread, NULL, updater_run, world);
+	world_jobs_init(&world->jobs, world);
 	pthread_create(&world->loader_thread, NULL, loader_run, world);
 	return world;
 }
@@ -72,8 +83,8 @@ void world_delete(struct world *world)
 	if (!world)
 		return;
 	world->running = false;
-	pthread_join(world->updater_thread, NULL);
 	pthread_join(world->loader_thread, NULL);
+	world_jobs_stop(&world->jobs);
 	struct region *region = TAILQ_FIRST(&world->regions);
 	while (region)
 	{
@@ -86,6 +97,8 @@ void world_delete(struct world *world)
 	simplex_noise_destroy(&world->noise);
 	clouds_destroy(&world->clouds);
 	skybox_destroy(&world->skybox);
+	light_destroy(&world->light);
+	world_jobs_destroy(&world->jobs);
 	frustum_destroy(&world->frustum);
 	gfx_delete_buffer(g_voxel->device, &world->blocks_uniform_buffer);
 	pthread_mutex_destroy(&world->chunks_mutex);
@@ -130,6 +143,8 @@ void world_draw(struct world *world)
 {
 	pthread_mutex_lock(&world->chunks_mutex);
 	player_update(world->player);
+	world_jobs_set_view(&world->jobs, world->player->entity.pos, &world->player->mat_vp);
+	world_jobs_flush(&world->jobs);
 	VEC4_SET(world->sky_color, 0.71, 0.82, 1, 1);
 	if (world->player->eye_in_water)
 	{
@@ -241,12 +256,13 @@ static struct region *fetch_region(struct world *world, int32_t x, int32_t z)
 	return region;
 }
 
-void world_generate_chunk(struct world *world, int32_t x, int32_t z)
+bool world_generate_chunk(struct world *world, int32_t x, int32_t z, const int32_t *heights)
 {
 	struct region *region = fetch_region(world, x, z);
-	region_generate_chunk(region,
-	                      (x - region->x) / CHUNK_WIDTH,
-	                      (z - region->z) / CHUNK_WIDTH);
+	return region_generate_chunk(region,
+	                             (x - region->x) / CHUNK_WIDTH,
+	                             (z - region->z) / CHUNK_WIDTH,
+	                             heights);
 }
 
 struct chunk *world_create_chunk(struct world *world, int32_t x, int32_t z)
@@ -307,77 +323,17 @@ void world_regenerate_buffers(struct world *world)
 		region_regenerate_buffers(region);
 }
 
-static void *updater_run(void *data)
+static void loader_check_chunk(struct world *world, int32_t player_x, int32_t player_z, int32_t chunk_x, int32_t chunk_z)
 {
-	int64_t last_update = g_voxel->frametime / 1000000000 * 1000000000;
-	int64_t updates_count = 0;
-	struct world *world = data;
-	struct timespec ts;
-	while (world->running)
-	{
-		if (g_voxel->frametime - last_update >= 1000000000)
-		{
-			last_update += 1000000000;
-			g_voxel->chunk_updates = updates_count;
-			updates_count = 0;
-		}
-		pthread_mutex_lock(&world->chunks_mutex);
-		if (TAILQ_EMPTY(&world->chunks_to_update))
-		{
-			pthread_mutex_unlock(&world->chunks_mutex);
-			ts.tv_sec = 0;
-			ts.tv_nsec = 20000000;
-			nanosleep(&ts, NULL);
-			continue;
-		}
-		struct chunk *chunk = TAILQ_FIRST(&world->chunks_to_update);
-		TAILQ_REMOVE(&world->chunks_to_update, chunk, update_chain);
-		if (chunk->must_generate_light_map)
-		{
-			++updates_count;
-			chunk_generate_light_map(chunk);
-			chunk_generate_buffers(chunk);
-		}
-		else if (chunk->must_generate_buffers)
-		{
-			++updates_count;
-			chunk_generate_buffers(chunk);
-		}
-		else
-		{
-			pthread_mutex_unlock(&world->chunks_mutex);
-			continue;
-		}
-		pthread_mutex_unlock(&world->chunks_mutex);
-		ts.tv_sec = 0;
-		ts.tv_nsec = 5000;
-		nanosleep(&ts, NULL);
-	}
-	return NULL;
-}
-
-static bool loader_check_chunk(struct world *world, const struct frustum *frustum, int32_t chunk_x, int32_t chunk_z)
-{
-	if (!world->running)
-		return true;
-	int32_t part1 = world->player->entity.pos.x - (chunk_x + CHUNK_WIDTH / 2);
-	int32_t part2 = world->player->entity.pos.z - (chunk_z + CHUNK_WIDTH / 2);
+	int32_t part1 = player_x - (chunk_x + CHUNK_WIDTH / 2);
+	int32_t part2 = player_z - (chunk_z + CHUNK_WIDTH / 2);
 	int32_t distance = sqrtf(part1 * part1 + part2 * part2);
 	if (distance > LOAD_DISTANCE * CHUNK_WIDTH)
-		return false;
-	if (distance > 2 * 16)
-	{
-		struct aabb aabb;
-		VEC3_SET(aabb.p0, chunk_x, 0, chunk_z);
-		VEC3_SET(aabb.p1, chunk_x + CHUNK_WIDTH, CHUNK_HEIGHT, chunk_z + CHUNK_WIDTH);
-		if (!frustum_check_fast(frustum, &aabb))
-			return false;
-	}
-	pthread_mutex_lock(&world->chunks_mutex);
-	world_generate_chunk(world, chunk_x, chunk_z);
-	pthread_mutex_unlock(&world->chunks_mutex);
-	sched_yield();
-	return true;
+		return;
+	struct chunk *chunk = world_get_chunk(world, chunk_x, chunk_z);
+	if (chunk && chunk_is_generated(chunk))
+		return;
+	world_jobs_generate(&world->jobs, chunk_x, chunk_z);
 }
 
 static void check_out_of_range_chunks(struct world *world, int32_t player_x, int32_t player_z)
@@ -401,14 +357,6 @@ static void check_out_of_range_chunks(struct world *world, int32_t player_x, int
 			                 (chunk->x - region->x) / CHUNK_WIDTH,
 			                 (chunk->z - region->z) / CHUNK_WIDTH,
 			                 NULL);
-			struct chunk *to_update = TAILQ_FIRST(&world->chunks_to_update);
-			while (to_update)
-			{
-				struct chunk *next = TAILQ_NEXT(to_update, update_chain);
-				if (to_update == chunk)
-					TAILQ_REMOVE(&world->chunks_to_update, to_update, update_chain);
-				to_update = next;
-			}
 			chunk_delete(chunk);
 			pthread_mutex_unlock(&world->chunks_mutex);
 		}
@@ -418,55 +366,34 @@ static void check_out_of_range_chunks(struct world *world, int32_t player_x, int
 	}
 }
 
+/* only queues the generation of the missing chunks, the workers pick them by
+ * distance and visibility
+ */
 static void *loader_run(void *data)
 {
-	struct frustum frustum;
-	frustum_init(&frustum);
 	struct world *world = data;
 	while (world->running)
 	{
 		pthread_mutex_lock(&world->chunks_mutex);
 		int32_t player_x = world->player->entity.pos.x;
 		int32_t player_z = world->player->entity.pos.z;
-		frustum_update(&frustum, &world->player->mat_vp);
 		pthread_mutex_unlock(&world->chunks_mutex);
 		int32_t player_chunk_x = chunk_get_coord(player_x);
 		int32_t player_chunk_z = chunk_get_coord(player_z);
 		check_out_of_range_chunks(world, player_x, player_z);
-		loader_check_chunk(world, &frustum, player_chunk_x, player_chunk_z);
-		for (int32_t i = 0; i <= LOAD_DISTANCE; ++i)
-		{
-			int32_t chunk_x = player_chunk_x - i * CHUNK_WIDTH;
-			int32_t chunk_z = player_chunk_z - i * CHUNK_WIDTH;
-			loader_check_chunk(world, &frustum, chunk_x, chunk_z);
-			for (int32_t j = 0; j <= i * 2; ++j)
-			{
-				chunk_x += CHUNK_WIDTH;
-				loader_check_chunk(world, &frustum, chunk_x, chunk_z);
-			}
-			for (int32_t j = 0; j <= i * 2; ++j)
-			{
-				chunk_z += CHUNK_WIDTH;
-				loader_check_chunk(world, &frustum, chunk_x, chunk_z);
-			}
-			for (int32_t j = 0; j <= i * 2; ++j)
-			{
-				chunk_x -= CHUNK_WIDTH;
-				loader_check_chunk(world, &frustum, chunk_x, chunk_z);
-			}
-			for (int32_t j = 0; j <= i * 2 - 1; ++j)
-			{
-				chunk_z -= CHUNK_WIDTH;
-				loader_check_chunk(world, &frustum, chunk_x, chunk_z);
-			}
-		}
+		pthread_mutex_lock(&world->chunks_mutex);
+		for (int32_t x = -LOAD_DISTANCE; x <= LOAD_DISTANCE; ++x)
 		{
-			struct timespec ts;
-			ts.tv_sec = 0;
-			ts.tv_nsec = 100000000;
-			nanosleep(&ts, NULL);
+			for (int32_t z = -LOAD_DISTANCE; z <= LOAD_DISTANCE; ++z)
+				loader_check_chunk(world, player_x, player_z,
+				                   player_chunk_x + x * CHUNK_WIDTH,
+				                   player_chunk_z + z * CHUNK_WIDTH);
 		}
+		pthread_mutex_unlock(&world->chunks_mutex);
+		struct timespec ts;
+		ts.tv_sec = 0;
+		ts.tv_nsec = 100000000;
+		nanosleep(&ts, NULL);
 	}
-	frustum_destroy(&frustum);
 	return NULL;
 }
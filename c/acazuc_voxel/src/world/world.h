@@ -5,6 +5,8 @@
 
 #include "world/clouds.h"
 #include "world/skybox.h"
+#include "world/light.h"
+#include "world/jobs.h"
 
 #include <jks/frustum.h>
 
@@ -20,9 +22,7 @@ struct block;
 struct world
 {
 	pthread_mutex_t chunks_mutex;
-	pthread_t updater_thread;
 	pthread_t loader_thread;
-	TAILQ_HEAD(, chunk) chunks_to_update;
 	uint16_t random[3];
 	struct simplex_noise biome_temp_noise;
 	struct simplex_noise biome_rain_noise;
@@ -32,11 +32,14 @@ struct world
 	struct frustum frustum;
 	struct clouds clouds;
 	struct skybox skybox;
+	struct light light;
+	struct world_jobs jobs;
 	struct player *player;
 	struct vec4f sky_color;
 	struct vec4f fog_color;
 	float fog_distance;
 	float fog_density;
+	uint64_t chunks_id;
 	uint64_t seed;
 	int64_t last_region_check;
 	bool running;
@@ -50,12 +53,14 @@ void world_draw(struct world *world);
 void world_get_aabbs(struct world *world, const struct aabb *aabb, struct jks_array *aabbs);
 void world_set_block(struct world *world, int32_t x, int32_t y, int32_t z, uint16_t type);
 void world_set_block_if_replaceable(struct world *world, int32_t x, int32_t y, int32_t z, uint16_t type);
-void world_generate_chunk(struct world *world, int32_t x, int32_t y);
+bool world_generate_chunk(struct world *world, int32_t x, int32_t y, const int32_t *heights);
 struct chunk *world_create_chunk(struct world *world, int32_t x, int32_t y);
 void world_add_chunk(struct world *world, struct chunk *chunk);
 struct chunk *world_get_chunk(struct world *world, int32_t x, int32_t y);
 bool world_get_block(struct world *world, int32_t x, int32_t y, int32_t z, struct block *block);
 uint8_t world_get_light(struct world *world, int32_t x, int32_t y, int32_t z);
 void world_regenerate_buffers(struct world *world);
+void world_benchmark_light(struct world *world);
+void world_benchmark_noise(struct world *world);
 
 #endif
@@ -36,6 +36,7 @@ void world_screen_gui_init(struct world_screen_gui *gui,
 	gui_label_init(&gui->pos_label);
 	gui_cross_init(&gui->cross);
 	gui_bar_init(&gui->bar);
+	gui->last_chunk_generations = UINT64_MAX;
 	gui->last_chunk_updates = UINT64_MAX;
 	gui->last_fps = UINT64_MAX;
 	gui->state = WORLD_SCREEN_GUI_NONE;
@@ -78,13 +79,16 @@ void world_screen_gui_draw(struct world_screen_gui *gui)
 	gui_cross_draw(&gui->cross);
 	char text[128];
 	if (gui->last_fps != g_voxel->fps
-	 || gui->last_chunk_updates != g_voxel->chunk_updates)
+	 || gui->last_chunk_updates != g_voxel->chunk_updates
+	 || gui->last_chunk_generations != g_voxel->chunk_generations)
 	{
 		gui->last_fps = g_voxel->fps;
 		gui->last_chunk_updates = g_voxel->chunk_updates;
-		snprintf(text, sizeof(text), "voxel (%lu fps, %lu chunk updates)",
+		gui->last_chunk_generations = g_voxel->chunk_generations;
+		snprintf(text, sizeof(text), "voxel (%lu fps, %lu chunk updates, %lu chunks generated)",
 		         (unsigned long)g_voxel->fps,
-		         (unsigned long)g_voxel->chunk_updates);
+		         (unsigned long)g_voxel->chunk_updates,
+		         (unsigned long)g_voxel->chunk_generations);
 		gui_label_set_text(&gui->fps_label, text);
 	}
 	gui_label_draw(&gui->fps_label);
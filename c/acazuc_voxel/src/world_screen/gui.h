@@ -36,6 +36,7 @@ struct world_screen_gui
 	struct gui_label pos_label;
 	struct gui_cross cross;
 	struct gui_bar bar;
+	uint64_t last_chunk_generations;
 	uint64_t last_chunk_updates;
 	uint64_t last_fps;
 	enum world_screen_gui_state state;
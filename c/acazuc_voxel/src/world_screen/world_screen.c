@@ -40,6 +40,16 @@ static void key_down(struct screen *screen, struct gfx_key_event *event)
 		voxel_ungrab_cursor(g_voxel);
 		event->used = true;
 	}
+	else if (event->key == GFX_KEY_L)
+	{
+		world_benchmark_light(g_voxel->world);
+		event->used = true;
+	}
+	else if (event->key == GFX_KEY_N)
+	{
+		world_benchmark_noise(g_voxel->world);
+		event->used = true;
+	}
 }
 
 static void mouse_move(struct screen *screen, struct gfx_pointer_event *event)
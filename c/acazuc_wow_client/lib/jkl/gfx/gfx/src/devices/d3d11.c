@@ -674,7 +674,12 @@ static bool d3d11_set_buffer_data(struct gfx_device *device, gfx_buffer_t *buffe
 {
 	assert(buffer->handle.ptr);
 	D3D11_MAPPED_SUBRESOURCE sub_resource;
-	D3D11_CALL(ID3D11DeviceContext_Map, D3D11_DEVICE->d3dctx, (ID3D11Resource*)buffer->handle.ptr, 0, D3D11_MAP_WRITE, 0, &sub_resource);
+	D3D11_MAP map_type;
+	if (buffer->usage == GFX_BUFFER_DYNAMIC || buffer->usage == GFX_BUFFER_STREAM)
+		map_type = offset ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+	else
+		map_type = D3D11_MAP_WRITE;
+	D3D11_CALL(ID3D11DeviceContext_Map, D3D11_DEVICE->d3dctx, (ID3D11Resource*)buffer->handle.ptr, 0, map_type, 0, &sub_resource);
 	memcpy(((uint8_t*)sub_resource.pData) + offset, data, size);
 	ID3D11DeviceContext_Unmap(D3D11_DEVICE->d3dctx, (ID3D11Resource*)buffer->handle.ptr, 0);
 	return true; //XXX
@@ -267,6 +267,20 @@ typedef struct gfx_buffer
 	void *map;
 } gfx_buffer_t;
 
+#define GFX_LINEAR_BUFFER_INIT() (gfx_linear_buffer_t){.buffer = GFX_BUFFER_INIT()}
+
+typedef struct gfx_linear_buffer
+{
+	gfx_buffer_t buffer;
+	uint8_t *shadow; /* only used if the backend doesn't keep buffer mapped */
+	uint8_t *data; /* buffer.map or shadow */
+	uint32_t alignment;
+	uint32_t reserve; /* minimum bytes after any offset, so binds may be larger than allocations */
+	uint32_t offset;
+	uint32_t flushed;
+	uint32_t required;
+} gfx_linear_buffer_t;
+
 #define GFX_TEXTURE_INIT() (gfx_texture_t){.handle = GFX_HANDLE_INIT}
 
 typedef struct gfx_texture
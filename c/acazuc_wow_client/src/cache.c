@@ -16,28 +16,61 @@
 #include <wow/mpq.h>
 #include <wow/dbc.h>
 
+#include <sys/queue.h>
+
 #include <inttypes.h>
 #include <string.h>
 #include <assert.h>
 
+/* number of least recently released entries compared on eviction */
+#define CACHE_EVICT_WINDOW 8
+
 MEMORY_DECL(GENERIC);
 
 typedef bool (*cache_constructor_t)(void *key, void **ref);
 typedef bool (*cache_key_dup_t)(const void *key, void **d);
 typedef void (*cache_ref_t)(void *ref);
+typedef void (*cache_unload_t)(void *ref);
+typedef bool (*cache_size_t)(void *ref, size_t *cpu, size_t *gpu); /* false if not final yet */
 
 struct cache_def
 {
 	const char *name;
 	cache_constructor_t constructor;
 	cache_ref_t ref;
+	cache_unload_t unload; /* NULL if the type can't be kept resident */
+	cache_size_t size;
+	size_t budget; /* default bytes of unreferenced assets kept resident */
 	int string_key;
 };
 
+struct cache_entry
+{
+	void *key;
+	void *ref;
+	size_t cpu_bytes;
+	size_t gpu_bytes;
+	int64_t release_time;
+	bool resident; /* unreferenced, in the lru */
+	bool sized; /* the size was final when measured */
+	TAILQ_ENTRY(cache_entry) chain;
+};
+
 struct cache_type
 {
 	const struct cache_def *def;
-	struct jks_hmap hmap; /* key, val */
+	struct jks_hmap hmap; /* key, struct cache_entry* */
+	TAILQ_HEAD(, cache_entry) lru; /* least recently released first */
+	size_t budget;
+	size_t resident_nb;
+	size_t resident_cpu;
+	size_t resident_gpu;
+	size_t unsized_nb; /* resident entries to measure again */
+	uint64_t hits;
+	uint64_t resident_hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t evicted_bytes;
 	pthread_mutex_t mutex;
 };
 
@@ -112,6 +145,9 @@ static const struct cache_def blp_def =
 	.name = "blp",
 	.constructor = blp_constructor,
 	.ref         = (void*)gx_blp_ref,
+	.unload      = (void*)gx_blp_unload,
+	.size        = (void*)gx_blp_get_size,
+	.budget      = 256 * 1024 * 1024,
 	.string_key  = 1,
 };
 
@@ -120,6 +156,9 @@ static const struct cache_def wmo_def =
 	.name = "wmo",
 	.constructor = wmo_constructor,
 	.ref         = (void*)gx_wmo_ref,
+	.unload      = (void*)gx_wmo_unload,
+	.size        = (void*)gx_wmo_get_size,
+	.budget      = 128 * 1024 * 1024,
 	.string_key  = 1,
 };
 
@@ -136,6 +175,9 @@ static const struct cache_def m2_def =
 	.name = "m2",
 	.constructor = m2_constructor,
 	.ref         = (void*)gx_m2_ref,
+	.unload      = (void*)gx_m2_unload,
+	.size        = (void*)gx_m2_get_size,
+	.budget      = 128 * 1024 * 1024,
 	.string_key  = 1,
 };
 
@@ -163,10 +205,27 @@ static const struct cache_def dbc_def =
 	.string_key  = 1,
 };
 
-static void cache_type_init(struct cache_type *cache, jks_hmap_destructor_t destructor, jks_hmap_hash_fn_t hash_fn, jks_hmap_cmp_fn_t cmp_fn, const struct cache_def *def)
+static void entry_dtr(jks_hmap_key_t key, void *ptr)
+{
+	(void)key;
+	mem_free(MEM_GENERIC, *(struct cache_entry**)ptr);
+}
+
+static void cache_type_init(struct cache_type *cache, jks_hmap_hash_fn_t hash_fn, jks_hmap_cmp_fn_t cmp_fn, const struct cache_def *def)
 {
-	jks_hmap_init(&cache->hmap, sizeof(void*), destructor, hash_fn, cmp_fn, &jks_hmap_memory_fn_GENERIC);
+	jks_hmap_init(&cache->hmap, sizeof(struct cache_entry*), entry_dtr, hash_fn, cmp_fn, &jks_hmap_memory_fn_GENERIC);
+	TAILQ_INIT(&cache->lru);
 	cache->def = def;
+	cache->budget = def->unload ? def->budget : 0;
+	cache->resident_nb = 0;
+	cache->resident_cpu = 0;
+	cache->resident_gpu = 0;
+	cache->unsized_nb = 0;
+	cache->hits = 0;
+	cache->resident_hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+	cache->evicted_bytes = 0;
 	pthread_mutex_init(&cache->mutex, NULL);
 }
 
@@ -175,13 +234,13 @@ struct cache *cache_new(void)
 	struct cache *cache = mem_malloc(MEM_GENERIC, sizeof(*cache));
 	if (!cache)
 		return NULL;
-	cache_type_init(&cache->blp, NULL, jks_hmap_hash_str, jks_hmap_cmp_str, &blp_def);
-	cache_type_init(&cache->wmo, NULL, jks_hmap_hash_str, jks_hmap_cmp_str, &wmo_def);
-	cache_type_init(&cache->map_wmo, NULL, jks_hmap_hash_u32, jks_hmap_cmp_u32, &map_wmo_def);
-	cache_type_init(&cache->m2, NULL, jks_hmap_hash_str, jks_hmap_cmp_str, &m2_def);
-	cache_type_init(&cache->map_m2, NULL, jks_hmap_hash_u32, jks_hmap_cmp_u32, &map_m2_def);
-	cache_type_init(&cache->font, NULL, jks_hmap_hash_str, jks_hmap_cmp_str, &font_def);
-	cache_type_init(&cache->dbc, NULL, jks_hmap_hash_str, jks_hmap_cmp_str, &dbc_def);
+	cache_type_init(&cache->blp, jks_hmap_hash_str, jks_hmap_cmp_str, &blp_def);
+	cache_type_init(&cache->wmo, jks_hmap_hash_str, jks_hmap_cmp_str, &wmo_def);
+	cache_type_init(&cache->map_wmo, jks_hmap_hash_u32, jks_hmap_cmp_u32, &map_wmo_def);
+	cache_type_init(&cache->m2, jks_hmap_hash_str, jks_hmap_cmp_str, &m2_def);
+	cache_type_init(&cache->map_m2, jks_hmap_hash_u32, jks_hmap_cmp_u32, &map_m2_def);
+	cache_type_init(&cache->font, jks_hmap_hash_str, jks_hmap_cmp_str, &font_def);
+	cache_type_init(&cache->dbc, jks_hmap_hash_str, jks_hmap_cmp_str, &dbc_def);
 	return cache;
 }
 
@@ -205,38 +264,176 @@ void cache_delete(struct cache *cache)
 	mem_free(MEM_GENERIC, cache);
 }
 
+static void print_type(struct cache_type *cache)
+{
+	pthread_mutex_lock(&cache->mutex);
+	uint64_t refs = cache->hits + cache->resident_hits + cache->misses;
+	LOG_INFO("%-7s: %6" PRIu32 " entries, %5zu resident (cpu: %zu KB, gpu: %zu KB, budget: %zu KB), hit rate: %5.1f%% (%5.1f%% resident), %" PRIu64 " evictions (%" PRIu64 " KB)",
+	         cache->def->name,
+	         (uint32_t)cache->hmap.size,
+	         cache->resident_nb,
+	         cache->resident_cpu / 1024,
+	         cache->resident_gpu / 1024,
+	         cache->budget / 1024,
+	         refs ? (cache->hits + cache->resident_hits) * 100. / refs : 0.,
+	         refs ? cache->resident_hits * 100. / refs : 0.,
+	         cache->evictions,
+	         cache->evicted_bytes / 1024);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
 void cache_print(struct cache *cache)
 {
-#define PRINT(type) \
-	LOG_INFO(#type "s: %"  PRIu32, (uint32_t)cache->type.hmap.size);
+	print_type(&cache->blp);
+	print_type(&cache->wmo);
+	print_type(&cache->map_wmo);
+	print_type(&cache->m2);
+	print_type(&cache->map_m2);
+	print_type(&cache->font);
+	print_type(&cache->dbc);
+}
 
-	PRINT(blp);
-	PRINT(wmo);
-	PRINT(map_wmo);
-	PRINT(m2);
-	PRINT(map_m2);
-	PRINT(font);
-	PRINT(dbc);
+static void evict_entry(struct cache_type *cache, struct cache_entry *entry)
+{
+	void *ref = entry->ref;
+	TAILQ_REMOVE(&cache->lru, entry, chain);
+	cache->resident_nb--;
+	cache->resident_cpu -= entry->cpu_bytes;
+	cache->resident_gpu -= entry->gpu_bytes;
+	if (!entry->sized)
+		cache->unsized_nb--;
+	cache->evictions++;
+	cache->evicted_bytes += entry->cpu_bytes + entry->gpu_bytes;
+	if (!jks_hmap_erase(&cache->hmap, JKS_HMAP_KEY_PTR(entry->key)))
+		assert(!"evict unexisting key");
+	cache->def->unload(ref);
+}
 
-#undef PRINT
+static void measure(struct cache_type *cache, struct cache_entry *entry)
+{
+	cache->resident_cpu -= entry->cpu_bytes;
+	cache->resident_gpu -= entry->gpu_bytes;
+	entry->sized = cache->def->size(entry->ref, &entry->cpu_bytes, &entry->gpu_bytes);
+	cache->resident_cpu += entry->cpu_bytes;
+	cache->resident_gpu += entry->gpu_bytes;
+}
+
+/* evicts, among the oldest entries, the one freeing the most bytes for
+ * the longest time unused
+ */
+static void evict(struct cache_type *cache)
+{
+	if (cache->unsized_nb)
+	{
+		struct cache_entry *entry;
+		TAILQ_FOREACH(entry, &cache->lru, chain)
+		{
+			if (entry->sized)
+				continue;
+			measure(cache, entry);
+			if (entry->sized)
+				cache->unsized_nb--;
+		}
+	}
+	while (cache->resident_nb && cache->resident_cpu + cache->resident_gpu > cache->budget)
+	{
+		struct cache_entry *victim = NULL;
+		double victim_score = -1;
+		size_t n = 0;
+		struct cache_entry *entry;
+		TAILQ_FOREACH(entry, &cache->lru, chain)
+		{
+			double age = g_wow->frametime - entry->release_time + 1;
+			double score = (entry->cpu_bytes + entry->gpu_bytes + 1) * age;
+			if (score > victim_score)
+			{
+				victim = entry;
+				victim_score = score;
+			}
+			if (++n == CACHE_EVICT_WINDOW)
+				break;
+		}
+		evict_entry(cache, victim);
+	}
+}
+
+void cache_flush(struct cache *cache)
+{
+	struct cache_type *types[] =
+	{
+		&cache->wmo,
+		&cache->m2,
+		&cache->blp,
+	};
+	for (size_t i = 0; i < sizeof(types) / sizeof(*types); ++i)
+	{
+		pthread_mutex_lock(&types[i]->mutex);
+		types[i]->budget = 0;
+		evict(types[i]);
+		pthread_mutex_unlock(&types[i]->mutex);
+	}
+}
+
+bool cache_set_budget(struct cache *cache, const char *name, size_t bytes)
+{
+	struct cache_type *types[] =
+	{
+		&cache->blp,
+		&cache->wmo,
+		&cache->m2,
+	};
+	for (size_t i = 0; i < sizeof(types) / sizeof(*types); ++i)
+	{
+		if (strcmp(types[i]->def->name, name))
+			continue;
+		pthread_mutex_lock(&types[i]->mutex);
+		types[i]->budget = bytes;
+		evict(types[i]);
+		pthread_mutex_unlock(&types[i]->mutex);
+		return true;
+	}
+	return false;
 }
 
 static bool cache_ref(struct cache_type *cache, const void *key, void **ref)
 {
 	assert(ref);
-	void **value = jks_hmap_get(&cache->hmap, JKS_HMAP_KEY_PTR((void*)key));
+	struct cache_entry **value = jks_hmap_get(&cache->hmap, JKS_HMAP_KEY_PTR((void*)key));
 	if (value)
 	{
-		cache->def->ref(*value);
-		*ref = *value;
+		struct cache_entry *entry = *value;
+		if (entry->resident)
+		{
+			TAILQ_REMOVE(&cache->lru, entry, chain);
+			entry->resident = false;
+			cache->resident_nb--;
+			cache->resident_cpu -= entry->cpu_bytes;
+			cache->resident_gpu -= entry->gpu_bytes;
+			if (!entry->sized)
+				cache->unsized_nb--;
+			cache->resident_hits++;
+		}
+		else
+		{
+			cache->hits++;
+		}
+		cache->def->ref(entry->ref);
+		*ref = entry->ref;
 		return true;
 	}
+	cache->misses++;
+	struct cache_entry *entry = mem_malloc(MEM_GENERIC, sizeof(*entry));
+	if (!entry)
+		return false;
 	void *key_dup;
 	if (cache->def->string_key)
 	{
 		key_dup = mem_strdup(MEM_GENERIC, key);
 		if (!key_dup)
+		{
+			mem_free(MEM_GENERIC, entry);
 			return false;
+		}
 	}
 	else
 	{
@@ -246,12 +443,18 @@ static bool cache_ref(struct cache_type *cache, const void *key, void **ref)
 	{
 		if (cache->def->string_key)
 			mem_free(MEM_GENERIC, key_dup);
+		mem_free(MEM_GENERIC, entry);
 		return false;
 	}
-	if (!jks_hmap_set(&cache->hmap, JKS_HMAP_KEY_PTR(key_dup), ref))
+	entry->key = key_dup;
+	entry->ref = *ref;
+	entry->resident = false;
+	entry->sized = false;
+	if (!jks_hmap_set(&cache->hmap, JKS_HMAP_KEY_PTR(key_dup), &entry))
 	{
 		if (cache->def->string_key)
 			mem_free(MEM_GENERIC, key_dup);
+		mem_free(MEM_GENERIC, entry);
 		return false;
 	}
 	return true;
@@ -266,6 +469,32 @@ static void cache_unref(struct cache_type *cache, const void *key)
 	}
 }
 
+/* the last reference has been dropped: keep the asset resident until the
+ * budget of its type is exceeded
+ */
+static void cache_release(struct cache_type *cache, const void *key)
+{
+	struct cache_entry **value = jks_hmap_get(&cache->hmap, JKS_HMAP_KEY_PTR((void*)key));
+	if (!value)
+	{
+		assert(!"release unexisting key");
+		return;
+	}
+	struct cache_entry *entry = *value;
+	if (entry->resident)
+		return;
+	entry->release_time = g_wow->frametime;
+	entry->resident = true;
+	entry->cpu_bytes = 0;
+	entry->gpu_bytes = 0;
+	TAILQ_INSERT_TAIL(&cache->lru, entry, chain);
+	cache->resident_nb++;
+	measure(cache, entry);
+	if (!entry->sized)
+		cache->unsized_nb++;
+	evict(cache);
+}
+
 #define CACHE_FUNCTIONS(key_type, ref_type, name) \
 bool cache_ref_##name(struct cache *cache, const key_type key, ref_type *ref) \
 { \
@@ -288,6 +517,10 @@ void cache_unref_unmutexed_##name(struct cache *cache, const key_type key) \
 { \
 	cache_unref(&cache->name, (void*)(intptr_t)key); \
 } \
+void cache_release_unmutexed_##name(struct cache *cache, const key_type key) \
+{ \
+	cache_release(&cache->name, (void*)(intptr_t)key); \
+} \
 void cache_lock_##name(struct cache *cache) \
 { \
 	pthread_mutex_lock(&cache->name.mutex); \
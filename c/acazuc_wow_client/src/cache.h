@@ -19,12 +19,15 @@ struct dbc;
 struct cache *cache_new(void);
 void cache_delete(struct cache *cache);
 void cache_print(struct cache *cache);
+void cache_flush(struct cache *cache);
+bool cache_set_budget(struct cache *cache, const char *name, size_t bytes);
 
 #define CACHE_FUNCTIONS(key_type, ref_type, name) \
 bool cache_ref_##name(struct cache *cache, const key_type key, ref_type *ref); \
 bool cache_ref_unmutexed_##name(struct cache *cache, const key_type key, ref_type *ref); \
 void cache_unref_##name(struct cache *cache, const key_type key); \
 void cache_unref_unmutexed_##name(struct cache *cache, const key_type key); \
+void cache_release_unmutexed_##name(struct cache *cache, const key_type key); \
 void cache_lock_##name(struct cache *cache); \
 void cache_unlock_##name(struct cache *cache); \
 
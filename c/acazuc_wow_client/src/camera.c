@@ -152,43 +152,29 @@ camera_handle_mouse(struct camera *camera)
 		VEC3_ADD(dst, dir, base);
 		{
 			PERFORMANCE_BEGIN(COLLISIONS);
-			struct collision_params params;
-			params.wmo_cam = true;
-			VEC3_MIN(params.aabb.p0, dst, base);
-			VEC3_MAX(params.aabb.p1, dst, base);
-			params.aabb.p0.x -= SPHERE_RADIUS;
-			params.aabb.p0.y -= SPHERE_RADIUS;
-			params.aabb.p0.z -= SPHERE_RADIUS;
-			params.aabb.p1.x += SPHERE_RADIUS;
-			params.aabb.p1.y += SPHERE_RADIUS;
-			params.aabb.p1.z += SPHERE_RADIUS;
-			struct vec3f delta;
-			VEC3_SUB(delta, params.aabb.p1, params.aabb.p0);
-			params.radius = VEC3_NORM(delta);
-			VEC3_MULV(params.center, delta, 0.5f);
-			VEC3_ADD(params.center, params.center, params.aabb.p0);
-			struct jks_array triangles;
-			jks_array_init(&triangles, sizeof(struct collision_triangle), NULL, NULL);
-			map_collect_collision_triangles(g_wow->map, &params, &triangles);
-			float t;
-			float dir_len = VEC3_NORM(dir);
-			VEC3_DIVV(dir, dir, dir_len);
-			if (find_nearest_triangle(&triangles, base, dir, dir_len, NULL, NULL, &t) && t >= 0)
+			/* the sweep keeps the camera away from the walls it grazes */
+			struct phys_query query;
+			struct phys_hit hit;
+			if (phys_query_init(&query, base, dst, SPHERE_RADIUS, PHYS_TRIANGLE_NOCAM))
 			{
-				camera->unit_distance = t;
-				if (t > 1)
-					t -= 1;
+				phys_hit_init(&hit, &query);
+				if (map_cast(g_wow->map, &query, &hit))
+				{
+					float t = hit.t;
+					camera->unit_distance = t + SPHERE_RADIUS;
+					if (t > SPHERE_RADIUS)
+						t -= SPHERE_RADIUS;
+					else
+						t = 0;
+					VEC3_MULV(dir, query.dir, t);
+					VEC3_ADD(dst, dir, base);
+					camera->unit_velocity = 0;
+				}
 				else
-					t = 0;
-				VEC3_MULV(dir, dir, t);
-				VEC3_ADD(dst, dir, base);
-				camera->unit_velocity = 0;
-			}
-			else
-			{
-				VEC3_SUB(dst, dst, dir);
+				{
+					VEC3_SUB(dst, dst, query.dir);
+				}
 			}
-			jks_array_destroy(&triangles);
 			PERFORMANCE_END(COLLISIONS);
 		}
 		camera->pos = dst;
@@ -67,6 +67,22 @@ void font_atlas_add_glyph(struct font_atlas *atlas, uint32_t x, uint32_t y, stru
 	atlas->dirty = true;
 }
 
+void font_atlas_add_rgba(struct font_atlas *atlas, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t *data)
+{
+	for (uint32_t tY = 0; tY < height + 2; ++tY)
+	{
+		uint32_t srcY = tY ? tY - 1 : 0;
+		if (srcY >= height)
+			srcY = height - 1;
+		uint32_t *dst = JKS_ARRAY_GET(&atlas->data, (y + tY - 1) * atlas->width + x - 1, uint32_t);
+		const uint8_t *src = &data[srcY * width * 4];
+		memcpy(&dst[1], src, width * 4);
+		memcpy(&dst[0], &src[0], 4);
+		memcpy(&dst[width + 1], &src[(width - 1) * 4], 4);
+	}
+	atlas->dirty = true;
+}
+
 bool font_atlas_find_place(struct font_atlas *atlas, uint32_t width, uint32_t height, uint32_t *x, uint32_t *y)
 {
 	if (width > atlas->width || height > atlas->height)
@@ -118,6 +134,14 @@ bool font_atlas_find_place(struct font_atlas *atlas, uint32_t width, uint32_t he
 	return true;
 }
 
+void font_atlas_clear(struct font_atlas *atlas)
+{
+	jks_array_resize(&atlas->lines, 0);
+	jks_array_resize(&atlas->data, 0);
+	atlas->height = 0;
+	atlas->dirty = false;
+}
+
 bool font_atlas_grow(struct font_atlas *atlas)
 {
 	atlas->height += GROW_SIZE;
@@ -32,8 +32,10 @@ struct font_atlas
 struct font_atlas *font_atlas_new(void);
 void font_atlas_delete(struct font_atlas *atlas);
 bool font_atlas_find_place(struct font_atlas *atlas, uint32_t width, uint32_t height, uint32_t *x, uint32_t *y);
+void font_atlas_clear(struct font_atlas *atlas);
 bool font_atlas_grow(struct font_atlas *atlas);
 void font_atlas_add_glyph(struct font_atlas *atlas, uint32_t x, uint32_t y, struct font_glyph *glyph, const uint8_t *bitmap);
+void font_atlas_add_rgba(struct font_atlas *atlas, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t *data); /* the edges are also copied around the image, x, y, width and height are the unpadded ones */
 void font_atlas_update(struct font_atlas *atlas);
 void font_atlas_bind(struct font_atlas *atlas, uint32_t bind);
 
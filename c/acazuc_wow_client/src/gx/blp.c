@@ -86,12 +86,29 @@ void gx_blp_free(struct gx_blp *blp)
 			cache_unlock_blp(g_wow->cache);
 			return;
 		}
-		cache_unref_unmutexed_blp(g_wow->cache, blp->filename);
+		cache_release_unmutexed_blp(g_wow->cache, blp->filename);
 		cache_unlock_blp(g_wow->cache);
+		return;
 	}
+	gx_blp_unload(blp);
+}
+
+void gx_blp_unload(struct gx_blp *blp)
+{
 	loader_push(g_wow->loader, ASYNC_TASK_BLP_UNLOAD, blp_unload_task, blp);
 }
 
+/* the mipmaps belong to the loader until initialize() frees them, only the
+ * size it recorded is read; returns false while that size isn't known yet
+ */
+bool gx_blp_get_size(struct gx_blp *blp, size_t *cpu, size_t *gpu)
+{
+	enum gx_blp_flag flags = __atomic_load_n(&blp->flags, __ATOMIC_ACQUIRE);
+	*cpu = sizeof(*blp);
+	*gpu = (flags & GX_BLP_FLAG_SIZED) ? blp->gpu_bytes : 0;
+	return (flags & GX_BLP_FLAG_SIZED) || !(flags & GX_BLP_FLAG_LOAD_ASKED);
+}
+
 void gx_blp_ref(struct gx_blp *blp)
 {
 	refcount_inc(&blp->refcount);
@@ -100,6 +117,7 @@ void gx_blp_ref(struct gx_blp *blp)
 static bool initialize(void *userdata)
 {
 	struct gx_blp *blp = userdata;
+	size_t gpu_bytes = 0;
 	if (blp->data)
 	{
 		gfx_create_texture(g_wow->device, &blp->texture, GFX_TEXTURE_2D, blp->format, 1, blp->width, blp->height, 0);
@@ -109,6 +127,7 @@ static bool initialize(void *userdata)
 		gfx_set_texture_addressing(&blp->texture, GFX_TEXTURE_ADDRESSING_REPEAT, GFX_TEXTURE_ADDRESSING_REPEAT, GFX_TEXTURE_ADDRESSING_REPEAT);
 		gfx_finalize_texture(&blp->texture);
 		gfx_set_texture_data(&blp->texture, 0, 0, blp->width, blp->height, 0, blp->width * blp->height * 4, blp->data);
+		gpu_bytes = blp->width * blp->height * 4;
 		mem_free(MEM_LIBWOW, blp->data);
 		blp->data = NULL;
 	}
@@ -126,6 +145,7 @@ static bool initialize(void *userdata)
 		{
 			struct gx_blp_mipmap *mipmap = &blp->mipmaps[i];
 			gfx_set_texture_data(&blp->texture, i, 0, mipmap->width, mipmap->height, 0, mipmap->data_len, mipmap->data);
+			gpu_bytes += mipmap->data_len;
 		}
 		free_mipmaps(blp->mipmaps, blp->mipmaps_nb);
 		blp->mipmaps = NULL;
@@ -133,6 +153,8 @@ static bool initialize(void *userdata)
 	gx_blp_flag_set(blp, GX_BLP_FLAG_INITIALIZED);
 
 end:
+	blp->gpu_bytes = gpu_bytes;
+	gx_blp_flag_set(blp, GX_BLP_FLAG_SIZED);
 	gx_blp_free(blp);
 	return true;
 }
@@ -294,6 +316,7 @@ static void load_task(struct wow_mpq_compound *mpq_compound, void *userdata)
 	struct gx_blp *blp = userdata;
 	struct wow_mpq_file *mpq_file = NULL;
 	struct wow_blp_file *blp_file = NULL;
+	bool blp_file_loaded = false;
 
 	mpq_file = wow_mpq_get_file(mpq_compound, blp->filename);
 	if (!mpq_file)
@@ -312,8 +335,12 @@ static void load_task(struct wow_mpq_compound *mpq_compound, void *userdata)
 		LOG_ERROR("failed to load blp");
 		goto end;
 	}
+	blp_file_loaded = true;
 
 end:
+	/* never initialized, nothing is uploaded */
+	if (!blp_file_loaded)
+		gx_blp_flag_set(blp, GX_BLP_FLAG_SIZED);
 	wow_mpq_file_delete(mpq_file);
 	wow_blp_file_delete(blp_file);
 	gx_blp_free(blp);
@@ -6,6 +6,7 @@
 #include <gfx/objects.h>
 
 #include <stdbool.h>
+#include <stddef.h>
 
 struct wow_blp_file;
 struct gx_blp_mipmap;
@@ -15,6 +16,7 @@ enum gx_blp_flag
 	GX_BLP_FLAG_LOAD_ASKED  = (1 << 0),
 	GX_BLP_FLAG_LOADED      = (1 << 1),
 	GX_BLP_FLAG_INITIALIZED = (1 << 2),
+	GX_BLP_FLAG_SIZED       = (1 << 3), /* gpu_bytes is final */
 };
 
 struct gx_blp
@@ -28,12 +30,15 @@ struct gx_blp
 	void *data;
 	uint32_t width;
 	uint32_t height;
+	size_t gpu_bytes;
 	refcount_t refcount;
 };
 
 struct gx_blp *gx_blp_from_filename(char *filename);
 struct gx_blp *gx_blp_from_data(uint8_t *data, uint32_t width, uint32_t height);
 void gx_blp_free(struct gx_blp *blp);
+void gx_blp_unload(struct gx_blp *blp);
+bool gx_blp_get_size(struct gx_blp *blp, size_t *cpu, size_t *gpu);
 void gx_blp_ref(struct gx_blp *blp);
 void gx_blp_ask_load(struct gx_blp *blp);
 bool gx_blp_load(struct gx_blp *blp, struct wow_blp_file *file);
@@ -107,6 +107,9 @@ gx_frame_init(struct gx_frame *frame, int id)
 	frame->mcnk_uniform_buffer = GFX_BUFFER_INIT();
 	frame->mliq_uniform_buffer = GFX_BUFFER_INIT();
 	frame->wmo_uniform_buffer = GFX_BUFFER_INIT();
+	frame->uniform_buffer = GFX_LINEAR_BUFFER_INIT();
+	mem_arena_init(&frame->arena, MEM_GX, 256 * 1024);
+	gx_occlusion_init(&frame->occlusion);
 	gfx_create_buffer(g_wow->device,
 	                  &frame->m2_ground_shadow_uniform_buffer,
 	                  GFX_BUFFER_UNIFORM,
@@ -179,6 +182,11 @@ gx_frame_init(struct gx_frame *frame, int id)
 	                  NULL,
 	                  sizeof(struct shader_wmo_scene_block),
 	                  GFX_BUFFER_STREAM);
+	gfx_create_linear_buffer(g_wow->device,
+	                         &frame->uniform_buffer,
+	                         GFX_BUFFER_UNIFORM,
+	                         1024 * 1024,
+	                         sizeof(struct shader_m2_model_block));
 #ifdef WITH_DEBUG_RENDERING
 	gx_collisions_init(&frame->gx_collisions);
 #endif
@@ -206,6 +214,9 @@ gx_frame_destroy(struct gx_frame *frame)
 	gfx_delete_buffer(g_wow->device, &frame->mcnk_uniform_buffer);
 	gfx_delete_buffer(g_wow->device, &frame->mliq_uniform_buffer);
 	gfx_delete_buffer(g_wow->device, &frame->wmo_uniform_buffer);
+	gfx_delete_linear_buffer(g_wow->device, &frame->uniform_buffer);
+	mem_arena_destroy(&frame->arena);
+	gx_occlusion_destroy(&frame->occlusion);
 	for (size_t i = 0; i < sizeof(frame->render_lists.wmo_mliq) / sizeof(*frame->render_lists.wmo_mliq); ++i)
 		list_destroy(&frame->render_lists.wmo_mliq[i]);
 	for (size_t i = 0; i < sizeof(frame->render_lists.mclq) / sizeof(*frame->render_lists.mclq); ++i)
@@ -434,6 +445,13 @@ gx_frame_build_uniform_buffers(struct gx_frame *frame)
 	build_m2_world_uniform_buffer(frame);
 }
 
+void
+gx_frame_begin_render(struct gx_frame *frame)
+{
+	if (!gfx_linear_buffer_begin(&frame->uniform_buffer))
+		LOG_ERROR("failed to grow frame uniform buffer");
+}
+
 void
 gx_frame_copy_cameras(struct gx_frame *frame,
                       struct camera *cull_camera,
@@ -536,6 +554,8 @@ gx_frame_clear_scene(struct gx_frame *frame)
 	list_clear(&frame->backrefs.wmo);
 	list_clear(&frame->backrefs.wmo_mliq);
 	list_clear(&frame->backrefs.tiles);
+	mem_arena_reset(&frame->arena);
+	gx_occlusion_clear(&frame->occlusion);
 }
 
 void
@@ -5,8 +5,11 @@
 # include "gx/collisions.h"
 #endif
 
+#include "gx/occlusion.h"
 #include "gx/m2.h"
 
+#include "memory.h"
+
 #include <jks/frustum.h>
 #include <jks/array.h>
 #include <jks/mat4.h>
@@ -86,6 +89,9 @@ struct gx_frame
 	gfx_buffer_t mcnk_uniform_buffer;
 	gfx_buffer_t mliq_uniform_buffer;
 	gfx_buffer_t wmo_uniform_buffer;
+	gfx_linear_buffer_t uniform_buffer; /* per draw blocks, reset each frame */
+	struct mem_arena arena; /* per frame temporaries, reset with the scene */
+	struct gx_occlusion occlusion;
 	struct gx_m2_render_params m2_params;
 	enum gx_m2_lighting_type m2_lighting_type;
 	struct frustum shadow_frustum;
@@ -120,6 +126,7 @@ struct gx_frame
 void gx_frame_init(struct gx_frame *gx_frame, int id);
 void gx_frame_destroy(struct gx_frame *gx_frame);
 void gx_frame_build_uniform_buffers(struct gx_frame *gx_frame);
+void gx_frame_begin_render(struct gx_frame *gx_frame);
 void gx_frame_copy_cameras(struct gx_frame *gx_frame, struct camera *cull_camera, struct camera *view_camera);
 void gx_frame_clear_scene(struct gx_frame *gx_frame);
 void gx_frame_release_obj(struct gx_frame *gx_frame);
@@ -480,6 +480,7 @@ gx_new(struct gfx_device *device)
 	gx->opt |= GX_OPT_M2_RIBBONS;
 	gx->opt |= GX_OPT_GROUND_EFFECT;
 	gx->opt |= GX_OPT_DYN_SHADOW;
+	gx->opt |= GX_OPT_OCCLUSION;
 	gx->device = device;
 	for (size_t i = 0; i < GX_BLEND_LAST; ++i)
 		gx->blend_states[i] = GFX_BLEND_STATE_INIT();
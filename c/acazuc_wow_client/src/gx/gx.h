@@ -75,6 +75,7 @@ enum gx_opt
 	GX_OPT_DYN_WATER      = (1 << 26),
 	GX_OPT_GROUND_EFFECT  = (1 << 27),
 	GX_OPT_DYN_SHADOW     = (1 << 28),
+	GX_OPT_OCCLUSION      = (1 << 29),
 };
 
 struct gx
@@ -1,4 +1,5 @@
 #include "gx/m2_particles.h"
+#include "gx/m2_anim.h"
 #include "gx/m2_ribbons.h"
 #include "gx/skybox.h"
 #include "gx/frame.h"
@@ -73,6 +74,10 @@
 #define GX_M2_FRAGMENT_DIFFUSE_2TEX_4X        0x23
 #define GX_M2_FRAGMENT_DIFFUSE_2TEX_FADE_2X   0x24
 
+/* fraction of the view distance after which bones are updated every 2 / 4 frames */
+#define ANIM_LOD_NEAR 0.25f
+#define ANIM_LOD_FAR  0.5f
+
 MEMORY_DECL(GX);
 
 /*
@@ -907,25 +912,15 @@ static bool gx_m2_batch_init(struct gx_m2_batch *batch, struct gx_m2_profile *pa
 	batch->pipeline_state = &g_wow->gx->m2_pipeline_states[rasterizer_state][depth_stencil_state][blend_state] - &g_wow->gx->m2_pipeline_states[0][0][0];
 	init_batch_color_transform(batch, file, wow_batch);
 	init_batch_texture_weight(batch, file, wow_batch);
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		batch->uniform_buffers[i] = GFX_BUFFER_INIT();
 	return true;
 }
 
 static void gx_m2_batch_destroy(struct gx_m2_batch *batch)
 {
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_delete_buffer(g_wow->device, &batch->uniform_buffers[i]);
 	gx_m2_texture_destroy(&batch->textures[0]);
 	gx_m2_texture_destroy(&batch->textures[1]);
 }
 
-static void gx_m2_batch_initialize(struct gx_m2_batch *batch)
-{
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_create_buffer(g_wow->device, &batch->uniform_buffers[i], GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_m2_mesh_block), GFX_BUFFER_STREAM);
-}
-
 static bool gx_m2_batch_prepare_draw(struct gx_m2_batch *batch, struct gx_frame *frame, struct gx_m2_render_params *params, bool pipeline_state)
 {
 	struct gx_m2 *m2 = batch->parent->parent;
@@ -980,8 +975,10 @@ static bool gx_m2_batch_prepare_draw(struct gx_m2_batch *batch, struct gx_frame
 		}
 	}
 	mesh_block.alpha_test = batch->alpha_test * color.w;
-	gfx_set_buffer_data(&batch->uniform_buffers[frame->id], &mesh_block, sizeof(mesh_block), 0);
-	gfx_bind_constant(g_wow->device, 0, &batch->uniform_buffers[frame->id], sizeof(struct shader_m2_mesh_block), 0);
+	uint32_t mesh_offset;
+	if (!gfx_linear_buffer_push(&frame->uniform_buffer, &mesh_block, sizeof(mesh_block), &mesh_offset))
+		return false;
+	gfx_bind_linear_constant(g_wow->device, 0, &frame->uniform_buffer, sizeof(struct shader_m2_mesh_block), mesh_offset);
 	if (pipeline_state)
 		gfx_bind_pipeline_state(g_wow->device, &((gfx_pipeline_state_t*)g_wow->gx->m2_pipeline_states)[batch->pipeline_state]);
 	return true;
@@ -990,11 +987,13 @@ static bool gx_m2_batch_prepare_draw(struct gx_m2_batch *batch, struct gx_frame
 static void gx_m2_batch_render(struct gx_m2_batch *batch, struct gx_frame *frame, struct gx_m2_instance *instance)
 {
 	struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
+	if (instance_frame->uniform_offset == UINT32_MAX)
+		return;
 	const gfx_texture_t *textures[2];
 	textures[0] = gx_m2_texture_bind(&batch->textures[0], instance);
 	textures[1] = gx_m2_texture_bind(&batch->textures[1], instance);
 	gfx_bind_samplers(g_wow->device, 0, 2, textures);
-	gfx_bind_constant(g_wow->device, 1, &instance_frame->uniform_buffer, sizeof(struct shader_m2_model_block), 0); /* XXX really there ? */
+	gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_m2_model_block), instance_frame->uniform_offset); /* XXX really there ? */
 	gfx_draw_indexed(g_wow->device, batch->indices_nb, batch->indices_offset);
 }
 
@@ -1069,8 +1068,6 @@ static void gx_m2_profile_destroy(struct gx_m2_profile *profile)
 
 static void gx_m2_profile_initialize(struct gx_m2_profile *profile)
 {
-	for (size_t i = 0; i < profile->batches.size; ++i)
-		gx_m2_batch_initialize(JKS_ARRAY_GET(&profile->batches, i, struct gx_m2_batch));
 	profile->initialized = true;
 }
 
@@ -1126,7 +1123,7 @@ static void gx_m2_profile_render(struct gx_m2_profile *profile, struct gx_frame
 				switch (instance->lighting_type)
 				{
 					case GX_M2_LIGHTING_WMO_INDOOR:
-						uniform_buffer = &instance->local_lighting->uniform_buffer;
+						uniform_buffer = NULL;
 						break;
 					default:
 					case GX_M2_LIGHTING_WORLD:
@@ -1140,7 +1137,17 @@ static void gx_m2_profile_render(struct gx_m2_profile *profile, struct gx_frame
 						uniform_buffer = &frame->m2_ground_light_uniform_buffer;
 						break;
 				}
-				gfx_bind_constant(g_wow->device, 2, uniform_buffer, sizeof(struct shader_m2_scene_block), 0);
+				if (uniform_buffer)
+				{
+					gfx_bind_constant(g_wow->device, 2, uniform_buffer, sizeof(struct shader_m2_scene_block), 0);
+				}
+				else
+				{
+					uint32_t lighting_offset = instance->frames[frame->id].lighting_offset;
+					if (lighting_offset == UINT32_MAX)
+						continue;
+					gfx_bind_linear_constant(g_wow->device, 2, &frame->uniform_buffer, sizeof(struct shader_m2_scene_block), lighting_offset);
+				}
 			}
 			gx_m2_batch_render(batch, frame, instance);
 		}
@@ -1188,6 +1195,8 @@ struct gx_m2 *gx_m2_new(char *filename)
 	jks_array_init(&m2->instances, sizeof(struct gx_m2_instance*), NULL, &jks_array_memory_fn_GX);
 	jks_array_init(&m2->profiles, sizeof(struct gx_m2_profile), (jks_array_destructor_t)gx_m2_profile_destroy, &jks_array_memory_fn_GX);
 	jks_array_init(&m2->indices, sizeof(uint16_t), NULL, &jks_array_memory_fn_GX);
+	gx_m2_anim_init(&m2->anim);
+	phys_bvh_init(&m2->collision_bvh);
 #ifdef WITH_DEBUG_RENDERING
 	gx_m2_collisions_init(&m2->gx_collisions);
 	gx_m2_lights_init(&m2->gx_lights);
@@ -1235,6 +1244,8 @@ static void m2_unload_task(struct wow_mpq_compound *mpq_compound, void *userdata
 	jks_array_destroy(&m2->instances);
 	jks_array_destroy(&m2->profiles);
 	jks_array_destroy(&m2->indices);
+	gx_m2_anim_destroy(&m2->anim);
+	phys_bvh_destroy(&m2->collision_bvh);
 #ifdef WITH_DEBUG_RENDERING
 	gx_m2_collisions_destroy(&m2->gx_collisions);
 	gx_m2_lights_destroy(&m2->gx_lights);
@@ -1281,11 +1292,53 @@ void gx_m2_free(struct gx_m2 *m2)
 		cache_unlock_m2(g_wow->cache);
 		return;
 	}
-	cache_unref_unmutexed_m2(g_wow->cache, m2->filename);
+	cache_release_unmutexed_m2(g_wow->cache, m2->filename);
 	cache_unlock_m2(g_wow->cache);
+}
+
+void gx_m2_unload(struct gx_m2 *m2)
+{
 	loader_push(g_wow->loader, ASYNC_TASK_M2_UNLOAD, m2_unload_task, m2);
 }
 
+bool gx_m2_get_size(struct gx_m2 *m2, size_t *cpu, size_t *gpu)
+{
+	bool sized = true;
+	*cpu = sizeof(*m2);
+	if (m2->vertexes)
+		*cpu += sizeof(*m2->vertexes) * m2->vertexes_nb;
+	*cpu += m2->indices.capacity * m2->indices.data_size;
+	*cpu += sizeof(*m2->sequences) * m2->sequences_nb;
+	*cpu += sizeof(*m2->collision_vertexes) * m2->collision_vertexes_nb;
+	*cpu += sizeof(*m2->collision_normals) * m2->collision_normals_nb;
+	*cpu += sizeof(*m2->collision_triangles) * m2->collision_triangles_nb;
+	*cpu += phys_bvh_get_size(&m2->collision_bvh);
+	*gpu = m2->vertexes_buffer.size + m2->indices_buffer.size;
+	/* the textures are kept alive by the model, account them here even
+	 * if shared with other models; they may not be sized yet
+	 */
+	for (size_t i = 0; i < m2->profiles.size; ++i)
+	{
+		struct gx_m2_profile *profile = JKS_ARRAY_GET(&m2->profiles, i, struct gx_m2_profile);
+		for (size_t j = 0; j < profile->batches.size; ++j)
+		{
+			struct gx_m2_batch *batch = JKS_ARRAY_GET(&profile->batches, j, struct gx_m2_batch);
+			for (size_t k = 0; k < sizeof(batch->textures) / sizeof(*batch->textures); ++k)
+			{
+				if (!batch->textures[k].texture)
+					continue;
+				size_t texture_cpu;
+				size_t texture_gpu;
+				if (!gx_blp_get_size(batch->textures[k].texture, &texture_cpu, &texture_gpu))
+					sized = false;
+				*cpu += texture_cpu;
+				*gpu += texture_gpu;
+			}
+		}
+	}
+	return sized;
+}
+
 void gx_m2_ref(struct gx_m2 *m2)
 {
 	refcount_inc(&m2->refcount);
@@ -1326,6 +1379,29 @@ static bool initialize(void *userdata)
 	return true;
 }
 
+static bool build_collision_bvh(struct gx_m2 *m2)
+{
+	size_t triangles_nb = m2->collision_triangles_nb / 3;
+	if (!triangles_nb)
+		return true;
+	struct vec3f *points = mem_malloc(MEM_PHYS, sizeof(*points) * triangles_nb * 3);
+	if (!points)
+		return false;
+	for (size_t i = 0; i < triangles_nb * 3; ++i)
+	{
+		uint16_t idx = m2->collision_triangles[i];
+		if (idx >= m2->collision_vertexes_nb)
+		{
+			LOG_WARN("invalid m2 collision triangle: %u / %u", idx, m2->collision_vertexes_nb);
+			idx = 0;
+		}
+		VEC3_CPY(points[i], m2->collision_vertexes[idx]);
+	}
+	bool ret = phys_bvh_build(&m2->collision_bvh, points, NULL, triangles_nb);
+	mem_free(MEM_PHYS, points);
+	return ret;
+}
+
 static void load(struct gx_m2 *m2, struct wow_m2_file *file)
 {
 	struct vec3f p0 = {file->header.aabb0.x, file->header.aabb0.z, -file->header.aabb0.y};
@@ -1401,6 +1477,11 @@ static void load(struct gx_m2 *m2, struct wow_m2_file *file)
 		return;
 	}
 	memcpy(m2->collision_normals, file->collision_normals, sizeof(*m2->collision_normals) * m2->collision_normals_nb);
+	if (!build_collision_bvh(m2))
+	{
+		LOG_ERROR("failed to build m2 collision bvh");
+		return;
+	}
 	m2->sequences_nb = file->sequences_nb;
 	m2->sequences = mem_malloc(MEM_GX, sizeof(*m2->sequences) * m2->sequences_nb);
 	if (m2->sequences_nb && !m2->sequences)
@@ -1558,6 +1639,11 @@ static void load(struct gx_m2 *m2, struct wow_m2_file *file)
 			break;
 		}
 	}
+	if (!gx_m2_anim_load(&m2->anim, m2->bones, m2->bones_nb))
+	{
+		LOG_ERROR("failed to load m2 bones animations");
+		return;
+	}
 	for (size_t i = file->skin_profiles_nb - 1; i < file->skin_profiles_nb; ++i)
 	{
 		struct gx_m2_profile *profile = jks_array_grow(&m2->profiles, 1);
@@ -1723,6 +1809,8 @@ static bool instance_init(struct gx_m2_instance *instance)
 	MAT4_IDENTITY(instance->m_inv);
 	MAT4_IDENTITY(instance->m);
 	instance->camera = -1;
+	instance->anim_frame = -1;
+	instance->anim_lod_counter = (uintptr_t)instance / sizeof(*instance); /* spread lod updates across frames */
 	instance->sequence_speed = 1;
 	instance->render_distance_max = -1;
 	instance->scale = 1;
@@ -1732,11 +1820,13 @@ static bool instance_init(struct gx_m2_instance *instance)
 		struct gx_m2_instance_frame *instance_frame = &instance->frames[i];
 		jks_array_init(&instance_frame->bone_mats, sizeof(struct mat4f), NULL, &jks_array_memory_fn_GX);
 		instance_frame->culled = true;
-		instance_frame->uniform_buffer = GFX_BUFFER_INIT();
+		instance_frame->uniform_offset = UINT32_MAX;
+		instance_frame->lighting_offset = UINT32_MAX;
 	}
 	jks_array_init(&instance->lights, sizeof(struct gx_m2_light), NULL, &jks_array_memory_fn_GX);
 	jks_array_init(&instance->enabled_batches, sizeof(uint16_t), NULL, &jks_array_memory_fn_GX);
 	jks_array_init(&instance->bone_calc, sizeof(uint8_t), NULL, &jks_array_memory_fn_GX);
+	jks_array_init(&instance->anim_cursors, sizeof(uint32_t), NULL, &jks_array_memory_fn_GX);
 #ifdef WITH_DEBUG_RENDERING
 	gx_aabb_init(&instance->gx_aabb, (struct vec4f){1, 1, 1, 1}, 1);
 	gx_aabb_init(&instance->gx_caabb, (struct vec4f){0.5, 0.5, 0.5, 1}, 1);
@@ -1800,21 +1890,17 @@ static void instance_delete_task(struct wow_mpq_compound *mpq_compound, void *us
 	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
 	{
 		struct gx_m2_instance_frame *instance_frame = &instance->frames[i];
-		gfx_delete_buffer(g_wow->device, &instance_frame->uniform_buffer);
 		jks_array_destroy(&instance_frame->bone_mats);
 	}
 	jks_array_destroy(&instance->lights);
 	jks_array_destroy(&instance->enabled_batches);
 	jks_array_destroy(&instance->bone_calc);
+	jks_array_destroy(&instance->anim_cursors);
 #ifdef WITH_DEBUG_RENDERING
 	gx_aabb_destroy(&instance->gx_aabb);
 	gx_aabb_destroy(&instance->gx_caabb);
 #endif
-	if (instance->local_lighting)
-	{
-		gfx_delete_buffer(g_wow->device, &instance->local_lighting->uniform_buffer);
-		mem_free(MEM_GX, instance->local_lighting);
-	}
+	mem_free(MEM_GX, instance->local_lighting);
 	gx_blp_free(instance->skin_extra_texture);
 	gx_blp_free(instance->skin_texture);
 	gx_blp_free(instance->hair_texture);
@@ -1854,11 +1940,11 @@ void gx_m2_instance_ref(struct gx_m2_instance *instance)
 
 static void update_local_lighting(struct gx_m2_instance *instance, struct gx_frame *frame)
 {
+	struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
 	struct gx_m2_lighting *loc = instance->local_lighting;
+	instance_frame->lighting_offset = UINT32_MAX;
 	if (!loc)
 		return;
-	if (!loc->uniform_buffer.handle.u64)
-		gfx_create_buffer(g_wow->device, &loc->uniform_buffer, GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_m2_scene_block), GFX_BUFFER_STREAM);
 	struct shader_m2_scene_block data;
 	VEC4_CPY(data.light_direction, loc->light_direction);
 	VEC4_CPY(data.specular_color, loc->diffuse_color);
@@ -1866,7 +1952,9 @@ static void update_local_lighting(struct gx_m2_instance *instance, struct gx_fra
 	VEC4_CPY(data.ambient_color, loc->ambient_color);
 	data.fog_range.y = frame->view_distance * g_wow->map->gx_skybox->float_values[SKYBOX_FLOAT_FOG_END] / 36 / g_wow->map->fog_divisor;
 	data.fog_range.x = data.fog_range.y * g_wow->map->gx_skybox->float_values[SKYBOX_FLOAT_FOG_START];
-	gfx_set_buffer_data(&loc->uniform_buffer, &data, sizeof(data), 0);
+	data.params.x = 0;
+	if (!gfx_linear_buffer_push(&frame->uniform_buffer, &data, sizeof(data), &instance_frame->lighting_offset))
+		instance_frame->lighting_offset = UINT32_MAX;
 }
 
 static void update_instance_uniform_buffer(struct gx_m2_instance *instance, struct gx_frame *frame)
@@ -1874,8 +1962,7 @@ static void update_instance_uniform_buffer(struct gx_m2_instance *instance, stru
 	size_t bones_off = offsetof(struct shader_m2_model_block, bone_mats);
 	size_t lights_off = offsetof(struct shader_m2_model_block, lights);
 	struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
-	if (!instance_frame->uniform_buffer.handle.u64)
-		gfx_create_buffer(g_wow->device, &instance_frame->uniform_buffer, GFX_BUFFER_UNIFORM, NULL, bones_off + instance_frame->bone_mats.size * sizeof(struct mat4f), GFX_BUFFER_STREAM);
+	size_t bones_nb = 0;
 	update_local_lighting(instance, frame);
 	struct shader_m2_model_block data;
 	data.v = frame->view_v;
@@ -1887,7 +1974,7 @@ static void update_instance_uniform_buffer(struct gx_m2_instance *instance, stru
 	if (instance->parent->bones_nb)
 	{
 		if (instance->parent->bones_nb <= sizeof(data.bone_mats) / sizeof(*data.bone_mats))
-			gfx_set_buffer_data(&instance_frame->uniform_buffer, instance_frame->bone_mats.data, instance_frame->bone_mats.size * sizeof(struct mat4f), bones_off);
+			bones_nb = instance_frame->bone_mats.size;
 		else
 			LOG_ERROR("too much bones (%u, %s)", instance->parent->bones_nb, instance->parent->filename);
 	}
@@ -1950,7 +2037,16 @@ static void update_instance_uniform_buffer(struct gx_m2_instance *instance, stru
 	{
 		data.light_count.x = 0;
 	}
-	gfx_set_buffer_data(&instance_frame->uniform_buffer, &data, lights_off + data.light_count.x * sizeof(struct shader_m2_light_block), 0);
+	/* bound with the whole block size, the linear buffer reserve keeps it in bounds */
+	uint8_t *dst = gfx_linear_buffer_alloc(&frame->uniform_buffer, bones_off + bones_nb * sizeof(struct mat4f), &instance_frame->uniform_offset);
+	if (!dst)
+	{
+		instance_frame->uniform_offset = UINT32_MAX;
+		return;
+	}
+	memcpy(dst, &data, lights_off + data.light_count.x * sizeof(struct shader_m2_light_block));
+	if (bones_nb)
+		memcpy(&dst[bones_off], instance_frame->bone_mats.data, bones_nb * sizeof(struct mat4f));
 }
 
 static void calc_bone_billboard(struct gx_m2_instance *instance, struct gx_frame *frame, struct wow_m2_bone *bone, struct mat4f *mat)
@@ -2032,97 +2128,133 @@ static void calc_bone_billboard(struct gx_m2_instance *instance, struct gx_frame
 	}
 }
 
-static void calc_bone_sequence(struct gx_m2_instance *instance, struct gx_frame *frame, struct mat4f *mat, struct wow_m2_bone *bone)
+static void calc_bone_sequence(struct gx_m2_instance *instance, struct gx_frame *frame, struct mat4f *mat, const struct mat4f *parent_mat, uint16_t bone_id)
 {
+	struct gx_m2_anim *anim = &instance->parent->anim;
+	const struct vec3f *pivot = &anim->pivots[bone_id];
+	struct vec3f translation;
+	struct vec3f scale;
+	if (!gx_m2_anim_sample_bone(instance, bone_id, GX_M2_ANIM_TRANSLATION, &translation.x))
+		VEC3_SETV(translation, 0);
+	if (!gx_m2_anim_sample_bone(instance, bone_id, GX_M2_ANIM_SCALE, &scale.x))
+		VEC3_SETV(scale, 1);
+	if (!(anim->flags[bone_id] & WOW_M2_BONE_BILLBOARD))
 	{
-		struct mat4f tmp_mat;
-		MAT4_TRANSLATE(tmp_mat, *mat, bone->pivot);
-		*mat = tmp_mat;
+		struct vec4f rotation;
+		if (!gx_m2_anim_sample_bone(instance, bone_id, GX_M2_ANIM_ROTATION, &rotation.x))
+			VEC4_SET(rotation, 0, 0, 0, 1);
+		gx_m2_anim_compose(mat, parent_mat, pivot, &translation, &rotation, &scale);
+		return;
 	}
+	struct vec3f tmp;
+	struct mat4f tmp_mat;
+	VEC3_ADD(tmp, *pivot, translation);
+	MAT4_TRANSLATE(*mat, *parent_mat, tmp);
+	calc_bone_billboard(instance, frame, &instance->parent->bones[bone_id], mat);
+	MAT4_SCALE(*mat, *mat, scale);
+	VEC3_MULV(tmp, *pivot, -1);
+	MAT4_TRANSLATE(tmp_mat, *mat, tmp);
+	*mat = tmp_mat;
+}
+
+static bool bone_calculated(struct gx_m2_instance *instance, uint16_t bone_id)
+{
+	return (*JKS_ARRAY_GET(&instance->bone_calc, bone_id / 8, uint8_t)) & (1 << (bone_id % 8));
+}
+
+/* parent bone must already be calculated */
+static void calc_bone(struct gx_m2_instance *instance, struct gx_frame *frame, uint16_t bone_id, const struct mat4f *init_mat)
+{
+	struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
+	struct gx_m2_anim *anim = &instance->parent->anim;
+	struct mat4f *bone_mat = JKS_ARRAY_GET(&instance_frame->bone_mats, bone_id, struct mat4f);
+	struct mat4f parent_mat;
+	int16_t parent = anim->parents[bone_id];
+	if (parent != -1)
 	{
-		struct vec3f v;
-		if (m2_instance_get_track_value_vec3f(instance, &bone->translation, &v))
-		{
-			struct vec3f tmp = {v.x, v.z, -v.y};
-			struct mat4f tmp_mat;
-			MAT4_TRANSLATE(tmp_mat, *mat, tmp);
-			*mat = tmp_mat;
-		}
+		struct mat4f *mat = JKS_ARRAY_GET(&instance_frame->bone_mats, parent, struct mat4f);
+		if (init_mat)
+			MAT4_MUL(parent_mat, *mat, *init_mat);
+		else
+			parent_mat = *mat;
 	}
-	if (bone->flags & WOW_M2_BONE_BILLBOARD)
+	else if (init_mat)
 	{
-		calc_bone_billboard(instance, frame, bone, mat);
+		parent_mat = *init_mat;
 	}
 	else
 	{
-		struct vec4f v;
-		if (m2_instance_get_track_value_quat16(instance, &bone->rotation, &v))
-		{
-			VEC4_NORMALIZE(float, v, v);
-			struct vec4f tmp = {v.x, v.z, -v.y, v.w};
-			struct mat4f quat;
-			QUATERNION_TO_MAT4(float, quat, tmp);
-			struct mat4f tmp_mat;
-			MAT4_MUL(tmp_mat, *mat, quat);
-			*mat = tmp_mat;
-		}
+		MAT4_IDENTITY(parent_mat);
 	}
+	*JKS_ARRAY_GET(&instance->bone_calc, bone_id / 8, uint8_t) |= 1 << (bone_id % 8);
+	if (!(anim->flags[bone_id] & (WOW_M2_BONE_TRANSFORMED | WOW_M2_BONE_BILLBOARD))
+	 || !instance->sequence || instance->sequence->end <= instance->sequence->start)
 	{
-		struct vec3f v;
-		if (m2_instance_get_track_value_vec3f(instance, &bone->scale, &v))
-		{
-			struct vec3f tmp = {v.x, v.z, v.y};
-			MAT4_SCALE(*mat, *mat, tmp);
-		}
+		*bone_mat = parent_mat;
+		return;
 	}
+	calc_bone_sequence(instance, frame, bone_mat, &parent_mat, bone_id);
+}
+
+static void update_bone(struct gx_m2_instance *instance, struct gx_frame *frame, uint16_t bone_id, const struct mat4f *init_mat)
+{
+	struct gx_m2_anim *anim = &instance->parent->anim;
+	if (!instance->bone_calc.size || bone_id >= anim->bones_nb)
+		return;
+	if (bone_calculated(instance, bone_id))
+		return;
+	while (true)
 	{
-		struct vec3f tmp = {-bone->pivot.x, -bone->pivot.y, -bone->pivot.z};
-		struct mat4f tmp_mat;
-		MAT4_TRANSLATE(tmp_mat, *mat, tmp);
-		*mat = tmp_mat;
+		uint16_t id = bone_id;
+		while (anim->parents[id] != -1 && !bone_calculated(instance, anim->parents[id]))
+			id = anim->parents[id];
+		if (id == bone_id)
+			break;
+		calc_bone(instance, frame, id, NULL);
 	}
+	calc_bone(instance, frame, bone_id, init_mat);
 }
 
-static void update_bone(struct gx_m2_instance *instance, struct gx_frame *frame, uint16_t bone_id, const struct mat4f *init_mat)
+static uint32_t anim_lod_interval(struct gx_m2_instance *instance, struct gx_frame *frame)
+{
+	if (!(g_wow->wow_opt & WOW_OPT_M2_ANIM_LOD)
+	 || gx_m2_flag_get(instance->parent, GX_M2_FLAG_HAS_BILLBOARD_BONES))
+		return 1;
+	struct vec3f tmp;
+	VEC3_SUB(tmp, frame->cull_pos, instance->pos);
+	float distance = VEC3_NORM(tmp);
+	if (distance < frame->view_distance * ANIM_LOD_NEAR)
+		return 1;
+	if (distance < frame->view_distance * ANIM_LOD_FAR)
+		return 2;
+	return 4;
+}
+
+static void update_bones(struct gx_m2_instance *instance, struct gx_frame *frame, bool lod)
 {
-	if (bone_id > instance->bone_calc.size * 8)
+	if (gx_m2_instance_flag_set(instance, GX_M2_INSTANCE_FLAG_BONES_UPDATED))
 		return;
-	if ((*JKS_ARRAY_GET(&instance->bone_calc, bone_id / 8, uint8_t)) & (1 << (bone_id % 8)))
+	if (!instance->bone_calc.size)
 		return;
-	struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
-	struct wow_m2_bone *bone = &instance->parent->bones[bone_id];
-	struct mat4f mat;
-	struct mat4f *matp;
-	if (bone->flags & (WOW_M2_BONE_TRANSFORMED | WOW_M2_BONE_BILLBOARD))
-		matp = &mat;
-	else
-		matp = JKS_ARRAY_GET(&instance_frame->bone_mats, bone_id, struct mat4f);
-	if (bone->parent_bone != -1)
+	struct gx_m2_anim *anim = &instance->parent->anim;
+	if (lod && instance->anim_frame != -1 && instance->anim_lod_counter++ % anim_lod_interval(instance, frame))
 	{
-		update_bone(instance, frame, bone->parent_bone, NULL);
-		*matp = *JKS_ARRAY_GET(&instance_frame->bone_mats, bone->parent_bone, struct mat4f);
-		if (init_mat)
+		if (instance->anim_frame != frame->id)
 		{
-			struct mat4f tmp;
-			MAT4_MUL(tmp, *matp, *init_mat);
-			*matp = tmp;
+			struct jks_array *dst = &instance->frames[frame->id].bone_mats;
+			struct jks_array *src = &instance->frames[instance->anim_frame].bone_mats;
+			memcpy(dst->data, src->data, dst->size * sizeof(struct mat4f));
 		}
+		memset(instance->bone_calc.data, 0xFF, instance->bone_calc.size);
+		return;
 	}
-	else if (init_mat)
-	{
-		*matp = *init_mat;
-	}
-	else
+	for (size_t i = 0; i < anim->bones_nb; ++i)
 	{
-		MAT4_IDENTITY(*matp);
+		uint16_t bone_id = anim->order[i];
+		if (!bone_calculated(instance, bone_id))
+			calc_bone(instance, frame, bone_id, NULL);
 	}
-	*JKS_ARRAY_GET(&instance->bone_calc, bone_id / 8, uint8_t) |= 1 << (bone_id % 8);
-	if (!(bone->flags & (WOW_M2_BONE_TRANSFORMED | WOW_M2_BONE_BILLBOARD)))
-		return;
-	if (instance->sequence && instance->sequence->end > instance->sequence->start)
-		calc_bone_sequence(instance, frame, &mat, bone);
-	*JKS_ARRAY_GET(&instance_frame->bone_mats, bone_id, struct mat4f) = mat;
-	*JKS_ARRAY_GET(&instance->bone_calc, bone_id / 8, uint8_t) |= 1 << (bone_id % 8);
+	instance->anim_frame = frame->id;
 }
 
 void gx_m2_instance_clear_bones(struct gx_m2_instance *instance)
@@ -2133,12 +2265,7 @@ void gx_m2_instance_clear_bones(struct gx_m2_instance *instance)
 
 void gx_m2_instance_update_bones(struct gx_m2_instance *instance, struct gx_frame *frame)
 {
-	if (gx_m2_instance_flag_set(instance, GX_M2_INSTANCE_FLAG_BONES_UPDATED))
-		return;
-	if (!instance->bone_calc.size)
-		return;
-	for (size_t i = 0; i < instance->parent->bones_nb; ++i)
-		update_bone(instance, frame, i, NULL);
+	update_bones(instance, frame, true);
 }
 
 void gx_m2_instance_update_bone(struct gx_m2_instance *instance, struct gx_frame *frame, uint16_t bone, const struct mat4f *mat)
@@ -2179,7 +2306,7 @@ void gx_m2_instance_force_update(struct gx_m2_instance *instance, struct gx_fram
 		return;
 	}
 	update_matrix(instance, frame, params);
-	gx_m2_instance_update_bones(instance, frame);
+	update_bones(instance, frame, false);
 	update_sequences_times(instance, frame);
 	instance_frame->culled = false;
 }
@@ -2230,7 +2357,8 @@ void gx_m2_instance_add_to_render(struct gx_m2_instance *instance, struct gx_fra
 		instance_frame->culled = true;
 		return;
 	}
-	instance_frame->culled = !bypass_frustum && !frustum_check_fast(&frame->frustum, &instance->aabb);
+	instance_frame->culled = (!bypass_frustum && !frustum_check_fast(&frame->frustum, &instance->aabb))
+	                      || gx_occlusion_test(&frame->occlusion, &instance->aabb);
 	instance_frame->shadow_culled = !(g_wow->gx->opt & GX_OPT_DYN_SHADOW)
 	                             || !(instance->flags & GX_M2_INSTANCE_FLAG_DYN_SHADOW)
 	                             || !frustum_check_fast(&frame->shadow_frustum, &instance->aabb);
@@ -2350,6 +2478,12 @@ void gx_m2_instance_on_parent_loaded(struct gx_m2_instance *instance)
 		return;
 	}
 	memset(instance->bone_calc.data, 0, instance->bone_calc.size);
+	if (!jks_array_resize(&instance->anim_cursors, instance->parent->anim.bones_nb * GX_M2_ANIM_LAST * 2))
+	{
+		LOG_ERROR("failed to alloc animation cursors array");
+		return;
+	}
+	memset(instance->anim_cursors.data, 0, instance->anim_cursors.size * sizeof(uint32_t));
 	if (instance->parent->particles_nb)
 	{
 		instance->gx_particles = gx_m2_particles_new(instance);
@@ -2377,6 +2511,7 @@ void gx_m2_instance_set_sequence(struct gx_m2_instance *instance, uint32_t seque
 	if (gx_m2_flag_get(instance->parent, GX_M2_FLAG_LOADED))
 		resolve_sequence(instance);
 	instance->sequence_started = g_wow->frametime;
+	instance->anim_frame = -1;
 }
 
 void gx_m2_instance_set_skin_extra_texture(struct gx_m2_instance *instance, struct gx_blp *texture)
@@ -2486,7 +2621,6 @@ struct gx_m2_ground_batch *gx_m2_ground_batch_new(struct gx_m2 *m2, bool light)
 		struct gx_m2_ground_batch_frame *frame = &batch->frames[i];
 		frame->attributes_state = GFX_ATTRIBUTES_STATE_INIT();
 		frame->instanced_buffer = GFX_BUFFER_INIT();
-		frame->uniform_buffer = GFX_BUFFER_INIT();
 		jks_array_init(&frame->instances, sizeof(struct mat4f), NULL, &jks_array_memory_fn_GX);
 	}
 	return batch;
@@ -2503,7 +2637,6 @@ void gx_m2_ground_batch_free(struct gx_m2_ground_batch *batch)
 		struct gx_m2_ground_batch_frame *frame = &batch->frames[i];
 		gfx_delete_attributes_state(g_wow->device, &frame->attributes_state);
 		gfx_delete_buffer(g_wow->device, &frame->instanced_buffer);
-		gfx_delete_buffer(g_wow->device, &frame->uniform_buffer);
 		jks_array_destroy(&frame->instances);
 	}
 	gx_m2_free(batch->m2);
@@ -2554,23 +2687,16 @@ void gx_m2_ground_batch_cull_end(struct gx_m2_ground_batch *batch, struct gx_fra
 	}
 }
 
-static void gx_m2_ground_batch_initialize(struct gx_m2_ground_batch *batch)
-{
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_create_buffer(g_wow->device, &batch->frames[i].uniform_buffer, GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_m2_ground_model_block), GFX_BUFFER_STREAM);
-	batch->initialized = true;
-}
-
 void gx_m2_ground_batch_render(struct gx_m2_ground_batch *batch, struct gx_frame *frame)
 {
 	struct gx_m2_ground_batch_frame *batch_frame = &batch->frames[frame->id];
-	if (!batch->initialized)
-		gx_m2_ground_batch_initialize(batch);
 	struct shader_m2_ground_model_block model_block;
 	model_block.v = frame->view_v;
 	model_block.p = frame->view_p;
-	gfx_set_buffer_data(&batch_frame->uniform_buffer, &model_block, sizeof(struct shader_m2_ground_model_block), 0);
-	gfx_bind_constant(g_wow->device, 1, &batch_frame->uniform_buffer, sizeof(struct shader_m2_ground_model_block), 0);
+	uint32_t model_offset;
+	if (!gfx_linear_buffer_push(&frame->uniform_buffer, &model_block, sizeof(model_block), &model_offset))
+		return;
+	gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_m2_ground_model_block), model_offset);
 	if (batch_frame->instances.size > batch_frame->buffer_size
 	 || batch_frame->instances.size < batch_frame->buffer_size / 2)
 	{
@@ -8,6 +8,10 @@
 # include "gx/aabb.h"
 #endif
 
+#include "gx/m2_anim.h"
+
+#include "phys/bvh.h"
+
 #include "refcount.h"
 
 #include <jks/array.h>
@@ -59,7 +63,6 @@ struct gx_m2_batch
 	struct gx_m2_profile *parent;
 	uint16_t combiners[2];
 	uint32_t pipeline_state;
-	gfx_buffer_t uniform_buffers[RENDER_FRAMES_COUNT];
 	struct gx_m2_texture textures[2];
 	struct vec3f fog_color;
 	uint16_t skin_section_id;
@@ -158,6 +161,8 @@ struct gx_m2
 	uint32_t global_sequences_nb;
 	uint32_t bone_lookups_nb;
 	struct jks_array indices; /* uint16_t */
+	struct gx_m2_anim anim;
+	struct phys_bvh collision_bvh;
 	enum gx_m2_flag flags;
 	gfx_buffer_t vertexes_buffer;
 	gfx_buffer_t indices_buffer;
@@ -179,6 +184,8 @@ struct gx_m2
 
 struct gx_m2 *gx_m2_new(char *filename);
 void gx_m2_free(struct gx_m2 *m2);
+void gx_m2_unload(struct gx_m2 *m2);
+bool gx_m2_get_size(struct gx_m2 *m2, size_t *cpu, size_t *gpu);
 void gx_m2_ref(struct gx_m2 *m2);
 void gx_m2_ask_load(struct gx_m2 *m2);
 void gx_m2_render(struct gx_m2 *m2, struct gx_frame *frame, bool transparent);
@@ -219,7 +226,6 @@ struct gx_m2_lighting
 	struct vec4f diffuse_color;
 	struct gx_m2_light lights[4];
 	uint32_t lights_count;
-	gfx_buffer_t uniform_buffer;
 };
 
 enum gx_m2_lighting_type
@@ -233,7 +239,8 @@ enum gx_m2_lighting_type
 
 struct gx_m2_instance_frame
 {
-	gfx_buffer_t uniform_buffer;
+	uint32_t uniform_offset; /* in frame uniform_buffer, UINT32_MAX if not uploaded */
+	uint32_t lighting_offset;
 	struct jks_array bone_mats; /* struct mat4f */
 	struct mat4f shadow_mvp;
 	struct mat4f shadow_mv;
@@ -263,6 +270,7 @@ struct gx_m2_instance
 	struct jks_array lights; /* struct gx_m2_light */
 	struct jks_array enabled_batches; /* uint16_t */
 	struct jks_array bone_calc; /* bitmask as uint8_t */
+	struct jks_array anim_cursors; /* uint32_t, bones * GX_M2_ANIM_LAST * 2 (current & previous sequence) */
 #ifdef WITH_DEBUG_RENDERING
 	struct gx_aabb gx_caabb;
 	struct gx_aabb gx_aabb;
@@ -286,6 +294,8 @@ struct gx_m2_instance
 	uint32_t sequence_time;
 	uint32_t sequence_id;
 	uint32_t camera;
+	uint32_t anim_lod_counter;
+	int anim_frame;
 	float render_distance_max;
 	float sequence_speed;
 	float scale;
@@ -362,7 +372,6 @@ struct gx_m2_ground_batch_frame
 {
 	gfx_attributes_state_t attributes_state;
 	gfx_buffer_t instanced_buffer;
-	gfx_buffer_t uniform_buffer;
 	struct jks_array instances; /* struct mat4f */
 	size_t buffer_size;
 };
@@ -371,7 +380,6 @@ struct gx_m2_ground_batch
 {
 	struct gx_m2_ground_batch_frame frames[RENDER_FRAMES_COUNT];
 	struct gx_m2 *m2;
-	bool initialized;
 	bool light;
 	refcount_t refcount;
 };
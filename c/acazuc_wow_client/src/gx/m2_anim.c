@@ -0,0 +1,350 @@
+#include "gx/m2_anim.h"
+#include "gx/m2.h"
+
+#include "memory.h"
+#include "log.h"
+#include "wow.h"
+
+#include <jks/quaternion.h>
+
+#include <wow/m2.h>
+
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE__
+# include <xmmintrin.h>
+#endif
+
+/* number of keys walked forward from the cached cursor before falling back to a bsearch */
+#define CURSOR_WALK 4
+
+MEMORY_DECL(GX);
+
+void gx_m2_anim_init(struct gx_m2_anim *anim)
+{
+	anim->tracks = NULL;
+	anim->pivots = NULL;
+	anim->flags = NULL;
+	anim->parents = NULL;
+	anim->order = NULL;
+	anim->bones_nb = 0;
+}
+
+void gx_m2_anim_destroy(struct gx_m2_anim *anim)
+{
+	if (anim->tracks)
+	{
+		for (size_t i = 0; i < anim->bones_nb * GX_M2_ANIM_LAST; ++i)
+			mem_free(MEM_GX, anim->tracks[i].values);
+	}
+	mem_free(MEM_GX, anim->tracks);
+	mem_free(MEM_GX, anim->pivots);
+	mem_free(MEM_GX, anim->flags);
+	mem_free(MEM_GX, anim->parents);
+	mem_free(MEM_GX, anim->order);
+	gx_m2_anim_init(anim);
+}
+
+static float quat16_value(int16_t v)
+{
+	return (v < 0 ? v + 32768 : v - 32767) / 32767.f;
+}
+
+static bool bake_track(struct gx_m2_anim_track *track, const struct wow_m2_track *wow_track, enum gx_m2_anim_channel channel)
+{
+	track->timestamps = wow_track->timestamps;
+	track->values = NULL;
+	track->global_sequence = wow_track->global_sequence;
+	track->interpolation_type = wow_track->interpolation_type;
+	track->components = channel == GX_M2_ANIM_ROTATION ? 4 : 3;
+	if (wow_track->timestamps_nb != wow_track->values_nb)
+	{
+		LOG_WARN("timestamps_nb != values_nb");
+		track->nb = 0;
+		return true;
+	}
+	track->nb = wow_track->timestamps_nb;
+	if (!track->nb)
+		return true;
+	track->values = mem_malloc(MEM_GX, sizeof(*track->values) * track->components * track->nb);
+	if (!track->values)
+		return false;
+	float *dst = track->values;
+	switch (channel)
+	{
+		case GX_M2_ANIM_TRANSLATION:
+			for (uint32_t i = 0; i < track->nb; ++i)
+			{
+				const struct wow_vec3f *v = &((const struct wow_vec3f*)wow_track->values)[i];
+				*(dst++) = v->x;
+				*(dst++) = v->z;
+				*(dst++) = -v->y;
+			}
+			break;
+		case GX_M2_ANIM_ROTATION:
+			for (uint32_t i = 0; i < track->nb; ++i)
+			{
+				const struct vec4s *v = &((const struct vec4s*)wow_track->values)[i];
+				*(dst++) = quat16_value(v->x);
+				*(dst++) = quat16_value(v->z);
+				*(dst++) = -quat16_value(v->y);
+				*(dst++) = quat16_value(v->w);
+			}
+			break;
+		case GX_M2_ANIM_SCALE:
+			for (uint32_t i = 0; i < track->nb; ++i)
+			{
+				const struct wow_vec3f *v = &((const struct wow_vec3f*)wow_track->values)[i];
+				*(dst++) = v->x;
+				*(dst++) = v->z;
+				*(dst++) = v->y;
+			}
+			break;
+		default:
+			break;
+	}
+	return true;
+}
+
+static bool build_order(struct gx_m2_anim *anim)
+{
+	uint32_t nb = anim->bones_nb;
+	uint32_t *depths = mem_malloc(MEM_GX, sizeof(*depths) * nb);
+	uint32_t *offsets = mem_zalloc(MEM_GX, sizeof(*offsets) * (nb + 1));
+	if (!depths || !offsets)
+	{
+		mem_free(MEM_GX, depths);
+		mem_free(MEM_GX, offsets);
+		return false;
+	}
+	for (uint32_t i = 0; i < nb; ++i)
+	{
+		if (anim->parents[i] >= 0 && (uint32_t)anim->parents[i] >= nb)
+			anim->parents[i] = -1;
+	}
+	for (uint32_t i = 0; i < nb; ++i)
+	{
+		uint32_t depth = 0;
+		int16_t parent = anim->parents[i];
+		while (parent != -1 && depth < nb)
+		{
+			parent = anim->parents[parent];
+			depth++;
+		}
+		if (depth >= nb)
+		{
+			LOG_WARN("bone hierarchy loop on bone %" PRIu32, i);
+			anim->parents[i] = -1;
+			depth = 0;
+		}
+		depths[i] = depth;
+		offsets[depth + 1]++;
+	}
+	for (uint32_t i = 1; i <= nb; ++i)
+		offsets[i] += offsets[i - 1];
+	for (uint32_t i = 0; i < nb; ++i)
+		anim->order[offsets[depths[i]]++] = i;
+	mem_free(MEM_GX, depths);
+	mem_free(MEM_GX, offsets);
+	return true;
+}
+
+bool gx_m2_anim_load(struct gx_m2_anim *anim, const struct wow_m2_bone *bones, uint32_t nb)
+{
+	if (!nb)
+		return true;
+	anim->tracks = mem_zalloc(MEM_GX, sizeof(*anim->tracks) * nb * GX_M2_ANIM_LAST);
+	anim->pivots = mem_malloc(MEM_GX, sizeof(*anim->pivots) * nb);
+	anim->flags = mem_malloc(MEM_GX, sizeof(*anim->flags) * nb);
+	anim->parents = mem_malloc(MEM_GX, sizeof(*anim->parents) * nb);
+	anim->order = mem_malloc(MEM_GX, sizeof(*anim->order) * nb);
+	anim->bones_nb = nb;
+	if (!anim->tracks || !anim->pivots || !anim->flags || !anim->parents || !anim->order)
+		goto err;
+	for (uint32_t i = 0; i < nb; ++i)
+	{
+		const struct wow_m2_bone *bone = &bones[i];
+		struct gx_m2_anim_track *tracks = &anim->tracks[i * GX_M2_ANIM_LAST];
+		if (!bake_track(&tracks[GX_M2_ANIM_TRANSLATION], &bone->translation, GX_M2_ANIM_TRANSLATION)
+		 || !bake_track(&tracks[GX_M2_ANIM_ROTATION], &bone->rotation, GX_M2_ANIM_ROTATION)
+		 || !bake_track(&tracks[GX_M2_ANIM_SCALE], &bone->scale, GX_M2_ANIM_SCALE))
+			goto err;
+		VEC3_CPY(anim->pivots[i], bone->pivot);
+		anim->flags[i] = bone->flags;
+		anim->parents[i] = bone->parent_bone;
+	}
+	if (!build_order(anim))
+		goto err;
+	return true;
+
+err:
+	gx_m2_anim_destroy(anim);
+	return false;
+}
+
+static uint32_t track_time(struct gx_m2 *m2, const struct gx_m2_anim_track *track, const struct wow_m2_sequence *sequence, uint32_t t)
+{
+	if (track->global_sequence >= 0 && (uint16_t)track->global_sequence < m2->global_sequences_nb)
+	{
+		uint32_t max = m2->global_sequences[track->global_sequence];
+		if (max == 0)
+			t = 0;
+		else
+			t = (g_wow->frametime / 1000000) % max;
+	}
+	else if (sequence)
+	{
+		t = sequence->start + t % (sequence->end - sequence->start);
+	}
+	return t % (track->timestamps[track->nb - 1] + 1);
+}
+
+/* first key with timestamp >= t, starting from the key found on the previous evaluation */
+static uint32_t find_key(const struct gx_m2_anim_track *track, uint32_t t, uint32_t *cursor)
+{
+	const uint32_t *timestamps = track->timestamps;
+	uint32_t i = *cursor;
+	if (i >= track->nb)
+		i = 0;
+	if (timestamps[i] >= t)
+	{
+		if (!i || timestamps[i - 1] < t)
+			goto end;
+	}
+	else
+	{
+		for (uint32_t n = 0; n < CURSOR_WALK && ++i < track->nb; ++n)
+		{
+			if (timestamps[i] >= t)
+				goto end;
+		}
+	}
+	uint32_t lo = 0;
+	uint32_t hi = track->nb - 1;
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (timestamps[mid] < t)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	i = lo;
+end:
+	*cursor = i;
+	return i;
+}
+
+static bool sample_track(struct gx_m2 *m2, const struct gx_m2_anim_track *track, const struct wow_m2_sequence *sequence, uint32_t t, uint32_t *cursor, float *val)
+{
+	if (!track->nb)
+		return false;
+	if (track->nb == 1)
+	{
+		memcpy(val, track->values, sizeof(*val) * track->components);
+		return true;
+	}
+	t = track_time(m2, track, sequence, t);
+	uint32_t i = find_key(track, t, cursor);
+	if (i == 0)
+	{
+		memcpy(val, track->values, sizeof(*val) * track->components);
+		return true;
+	}
+	const float *v1 = &track->values[(i - 1) * track->components];
+	const float *v2 = &track->values[i * track->components];
+	if (track->interpolation_type == 0)
+	{
+		memcpy(val, v1, sizeof(*val) * track->components);
+		return true;
+	}
+	uint32_t t1 = track->timestamps[i - 1];
+	uint32_t t2 = track->timestamps[i];
+	float a = t1 == t2 ? 1 : (t - t1) / (float)(t2 - t1);
+	for (uint8_t c = 0; c < track->components; ++c)
+		val[c] = v1[c] + (v2[c] - v1[c]) * a;
+	return true;
+}
+
+bool gx_m2_anim_sample_bone(struct gx_m2_instance *instance, uint16_t bone, enum gx_m2_anim_channel channel, float *val)
+{
+	struct gx_m2_anim *anim = &instance->parent->anim;
+	size_t idx = bone * GX_M2_ANIM_LAST + channel;
+	const struct gx_m2_anim_track *track = &anim->tracks[idx];
+	uint32_t *cursors = JKS_ARRAY_GET(&instance->anim_cursors, idx * 2, uint32_t);
+	if (!sample_track(instance->parent, track, instance->sequence, instance->sequence_time, &cursors[0], val))
+		return false;
+	if (g_wow->frametime - instance->sequence_started >= (instance->sequence->blend_time * 1000000)
+	 || !instance->prev_sequence || instance->prev_sequence->end <= instance->prev_sequence->start)
+		return true;
+	float prev[4];
+	if (!sample_track(instance->parent, track, instance->prev_sequence, instance->prev_sequence_time, &cursors[1], prev))
+		return true;
+	float pct = (g_wow->frametime - instance->sequence_started) / (instance->sequence->blend_time * 1000000.0);
+	for (uint8_t c = 0; c < track->components; ++c)
+		val[c] = val[c] * pct + prev[c] * (1 - pct);
+	return true;
+}
+
+/*
+ * mat = parent * translate(pivot + translation) * rotation * scale * translate(-pivot)
+ * built directly as an affine matrix instead of chaining full 4x4 products
+ */
+void gx_m2_anim_compose(struct mat4f *mat, const struct mat4f *parent, const struct vec3f *pivot, const struct vec3f *translation, const struct vec4f *rotation, const struct vec3f *scale)
+{
+	struct mat4f rs;
+	float norm = VEC4_NORM(*rotation);
+	if (norm > 0)
+	{
+		struct vec4f q;
+		VEC4_DIVV(q, *rotation, norm);
+		QUATERNION_TO_MAT3(float, rs, q);
+	}
+	else
+	{
+		VEC3_SET(rs.x, 1, 0, 0);
+		VEC3_SET(rs.y, 0, 1, 0);
+		VEC3_SET(rs.z, 0, 0, 1);
+	}
+	VEC3_MULV(rs.x, rs.x, scale->x);
+	VEC3_MULV(rs.y, rs.y, scale->y);
+	VEC3_MULV(rs.z, rs.z, scale->z);
+	struct vec3f t;
+	t.x = pivot->x + translation->x - (rs.x.x * pivot->x + rs.y.x * pivot->y + rs.z.x * pivot->z);
+	t.y = pivot->y + translation->y - (rs.x.y * pivot->x + rs.y.y * pivot->y + rs.z.y * pivot->z);
+	t.z = pivot->z + translation->z - (rs.x.z * pivot->x + rs.y.z * pivot->y + rs.z.z * pivot->z);
+#ifdef __SSE__
+	__m128 px = _mm_loadu_ps(&parent->x.x);
+	__m128 py = _mm_loadu_ps(&parent->y.x);
+	__m128 pz = _mm_loadu_ps(&parent->z.x);
+	__m128 pw = _mm_loadu_ps(&parent->w.x);
+#define COMPOSE_COL(dst, v) \
+	_mm_storeu_ps(&(dst).x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps((v).x)), \
+	                                              _mm_mul_ps(py, _mm_set1_ps((v).y))), \
+	                                   _mm_mul_ps(pz, _mm_set1_ps((v).z))))
+	COMPOSE_COL(mat->x, rs.x);
+	COMPOSE_COL(mat->y, rs.y);
+	COMPOSE_COL(mat->z, rs.z);
+	_mm_storeu_ps(&mat->w.x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(t.x)),
+	                                               _mm_mul_ps(py, _mm_set1_ps(t.y))),
+	                                    _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(t.z)), pw)));
+#undef COMPOSE_COL
+#else
+#define COMPOSE_COL(dst, v) \
+	do \
+	{ \
+		(dst).x = parent->x.x * (v).x + parent->y.x * (v).y + parent->z.x * (v).z; \
+		(dst).y = parent->x.y * (v).x + parent->y.y * (v).y + parent->z.y * (v).z; \
+		(dst).z = parent->x.z * (v).x + parent->y.z * (v).y + parent->z.z * (v).z; \
+		(dst).w = parent->x.w * (v).x + parent->y.w * (v).y + parent->z.w * (v).z; \
+	} while (0)
+	COMPOSE_COL(mat->x, rs.x);
+	COMPOSE_COL(mat->y, rs.y);
+	COMPOSE_COL(mat->z, rs.z);
+	COMPOSE_COL(mat->w, t);
+	VEC4_ADD(mat->w, mat->w, parent->w);
+#undef COMPOSE_COL
+#endif
+}
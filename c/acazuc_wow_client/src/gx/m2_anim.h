@@ -0,0 +1,48 @@
+#ifndef GX_M2_ANIM_H
+#define GX_M2_ANIM_H
+
+#include <jks/mat4.h>
+#include <jks/vec4.h>
+#include <jks/vec3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct gx_m2_instance;
+struct wow_m2_bone;
+
+enum gx_m2_anim_channel
+{
+	GX_M2_ANIM_TRANSLATION,
+	GX_M2_ANIM_ROTATION,
+	GX_M2_ANIM_SCALE,
+	GX_M2_ANIM_LAST
+};
+
+struct gx_m2_anim_track
+{
+	const uint32_t *timestamps; /* owned by the wow_m2_bone */
+	float *values; /* components floats per key, already in gx space */
+	uint32_t nb;
+	int16_t global_sequence;
+	uint8_t interpolation_type;
+	uint8_t components;
+};
+
+struct gx_m2_anim
+{
+	struct gx_m2_anim_track *tracks; /* bones_nb * GX_M2_ANIM_LAST */
+	struct vec3f *pivots;
+	uint32_t *flags;
+	int16_t *parents;
+	uint16_t *order; /* every parent is before its children */
+	uint32_t bones_nb;
+};
+
+void gx_m2_anim_init(struct gx_m2_anim *anim);
+void gx_m2_anim_destroy(struct gx_m2_anim *anim);
+bool gx_m2_anim_load(struct gx_m2_anim *anim, const struct wow_m2_bone *bones, uint32_t nb);
+bool gx_m2_anim_sample_bone(struct gx_m2_instance *instance, uint16_t bone, enum gx_m2_anim_channel channel, float *val);
+void gx_m2_anim_compose(struct mat4f *mat, const struct mat4f *parent, const struct vec3f *pivot, const struct vec3f *translation, const struct vec4f *rotation, const struct vec3f *scale);
+
+#endif
@@ -143,9 +143,9 @@ void gx_m2_bones_render_points(struct gx_m2_bones *bones, struct gx_frame *frame
 	{
 		const struct gx_m2_instance *instance = instances[i];
 		const struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
-		if (!instance_frame->uniform_buffer.handle.u64)
+		if (instance_frame->uniform_offset == UINT32_MAX)
 			continue;
-		gfx_bind_constant(g_wow->device, 1, &instance_frame->uniform_buffer, sizeof(struct shader_m2_model_block), 0);
+		gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_m2_model_block), instance_frame->uniform_offset);
 		gfx_draw(g_wow->device, bones->points_indices_nb, 0);
 	}
 }
@@ -159,9 +159,9 @@ void gx_m2_bones_render_lines(struct gx_m2_bones *bones, struct gx_frame *frame,
 	{
 		const struct gx_m2_instance *instance = instances[i];
 		const struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
-		if (!instance_frame->uniform_buffer.handle.u64)
+		if (instance_frame->uniform_offset == UINT32_MAX)
 			continue;
-		gfx_bind_constant(g_wow->device, 1, &instance_frame->uniform_buffer, sizeof(struct shader_m2_model_block), 0);
+		gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_m2_model_block), instance_frame->uniform_offset);
 		gfx_draw(g_wow->device, bones->lines_indices_nb, 0);
 	}
 }
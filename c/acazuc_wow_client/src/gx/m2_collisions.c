@@ -133,9 +133,10 @@ void gx_m2_collisions_render(struct gx_m2_collisions *collisions, struct gx_fram
 	for (size_t i = 0; i < instances_nb; ++i)
 	{
 		const struct gx_m2_instance *instance = instances[i];
-		if (!instance->frames[frame->id].uniform_buffer.handle.u64)
+		const struct gx_m2_instance_frame *instance_frame = &instance->frames[frame->id];
+		if (instance_frame->uniform_offset == UINT32_MAX)
 			continue;
-		gfx_bind_constant(g_wow->device, 1, &instance->frames[frame->id].uniform_buffer, sizeof(struct shader_m2_model_block), 0);
+		gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_m2_model_block), instance_frame->uniform_offset);
 		gfx_draw_indexed(g_wow->device, collisions->triangles_nb * 3, 0);
 	}
 }
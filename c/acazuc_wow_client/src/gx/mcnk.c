@@ -689,7 +689,6 @@ struct gx_mcnk *gx_mcnk_new(struct map_tile *tile, struct wow_adt_file *file)
 	{
 		struct gx_mcnk_frame *mcnk_frame = &mcnk->frames[i];
 		mcnk_frame->indirect_buffer = GFX_BUFFER_INIT();
-		mcnk_frame->uniform_buffer = GFX_BUFFER_INIT();
 	}
 	mcnk->vertexes_buffer = GFX_BUFFER_INIT();
 	mcnk->indices_buffer = GFX_BUFFER_INIT();
@@ -719,7 +718,6 @@ void gx_mcnk_delete(struct gx_mcnk *mcnk)
 	{
 		struct gx_mcnk_frame *mcnk_frame = &mcnk->frames[i];
 		gfx_delete_buffer(g_wow->device, &mcnk_frame->indirect_buffer);
-		gfx_delete_buffer(g_wow->device, &mcnk_frame->uniform_buffer);
 	}
 	gfx_delete_buffer(g_wow->device, &mcnk->vertexes_buffer);
 	gfx_delete_buffer(g_wow->device, &mcnk->indices_buffer);
@@ -758,7 +756,6 @@ int gx_mcnk_initialize(struct gx_mcnk *mcnk)
 	{
 		struct gx_mcnk_frame *mcnk_frame = &mcnk->frames[i];
 		gfx_create_buffer(g_wow->device, &mcnk_frame->indirect_buffer, GFX_BUFFER_INDIRECT, NULL, sizeof(struct gfx_draw_indexed_indirect_cmd) * GX_MCNK_CHUNKS_PER_TILE, GFX_BUFFER_STREAM);
-		gfx_create_buffer(g_wow->device, &mcnk_frame->uniform_buffer, GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_mcnk_model_block), GFX_BUFFER_STREAM);
 	}
 	gfx_create_buffer(g_wow->device, &mcnk->chunks_uniform_buffer, GFX_BUFFER_UNIFORM, mcnk->init_data->mesh_blocks, sizeof(mcnk->init_data->mesh_blocks), GFX_BUFFER_IMMUTABLE);
 	clean_init_data(mcnk->init_data);
@@ -806,17 +803,19 @@ void gx_mcnk_cull(struct gx_mcnk *mcnk, struct gx_frame *frame)
 			case FRUSTUM_INSIDE:
 				gx_chunk->frustum_result = FRUSTUM_INSIDE;
 				chunk_frame->culled = false;
-				has_unculled_chunk = true;
 				break;
 			case FRUSTUM_OUTSIDE:
 				chunk_frame->culled = true;
 				break;
 			case FRUSTUM_COLLIDE:
 				gx_chunk->frustum_result = frustum_check(&frame->frustum, &chunk->aabb);
-				if (!(chunk_frame->culled = !gx_chunk->frustum_result))
-					has_unculled_chunk = true;
+				chunk_frame->culled = !gx_chunk->frustum_result;
 				break;
 		}
+		if (!chunk_frame->culled && gx_occlusion_test(&frame->occlusion, &chunk->aabb))
+			chunk_frame->culled = true;
+		if (!chunk_frame->culled)
+			has_unculled_chunk = true;
 	}
 	if (!has_unculled_chunk)
 		return;
@@ -865,6 +864,7 @@ void gx_mcnk_render(struct gx_mcnk *mcnk, struct gx_frame *frame)
 	struct gx_mcnk_frame *mcnk_frame = &mcnk->frames[frame->id];
 	if (!mcnk_frame->draw_cmd_nb)
 		return;
+	uint32_t model_offset;
 	{
 		struct shader_mcnk_model_block model_block;
 		model_block.v = *(struct mat4f*)&frame->view_v;
@@ -872,12 +872,13 @@ void gx_mcnk_render(struct gx_mcnk *mcnk, struct gx_frame *frame)
 		model_block.mvp = mcnk_frame->mvp;
 		model_block.shadow_mvp = mcnk_frame->shadow_mvp;
 		model_block.offset_time = frame->time / 333000000000.0;
-		gfx_set_buffer_data(&mcnk_frame->uniform_buffer, &model_block, sizeof(model_block), 0);
+		if (!gfx_linear_buffer_push(&frame->uniform_buffer, &model_block, sizeof(model_block), &model_offset))
+			return;
 		gfx_set_buffer_data(&mcnk_frame->indirect_buffer, mcnk_frame->draw_cmds, sizeof(*mcnk_frame->draw_cmds) * mcnk_frame->draw_cmd_nb, 0);
 	}
 	{
 		gfx_bind_constant(g_wow->device, 0, &mcnk->chunks_uniform_buffer, sizeof(struct shader_mcnk_mesh_block) * GX_MCNK_CHUNKS_PER_TILE, 0);
-		gfx_bind_constant(g_wow->device, 1, &mcnk_frame->uniform_buffer, sizeof(struct shader_mcnk_model_block), 0);
+		gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_mcnk_model_block), model_offset);
 		gfx_bind_attributes_state(g_wow->device, &mcnk->attributes_state, &g_wow->gx->mcnk_input_layout);
 	}
 	uint32_t draw_cmd_offset = 0;
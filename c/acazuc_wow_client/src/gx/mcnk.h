@@ -56,7 +56,6 @@ struct gx_mcnk_batch
 struct gx_mcnk_frame
 {
 	gfx_buffer_t indirect_buffer;
-	gfx_buffer_t uniform_buffer;
 	struct gfx_draw_indexed_indirect_cmd draw_cmds[GX_MCNK_CHUNKS_PER_TILE];
 	uint16_t batches_draw_cmds[GX_MCNK_CHUNKS_PER_TILE];
 	size_t draw_cmd_nb;
@@ -0,0 +1,452 @@
+#include "gx/occlusion.h"
+
+#include "performance.h"
+#include "memory.h"
+#include "log.h"
+
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE__
+# include <xmmintrin.h>
+#endif
+
+/* triangles are clipped to w >= NEAR_W and to a guard band of GUARD_BAND
+ * times the screen, which keeps the edge functions precise
+ */
+#define NEAR_W 0.1f
+#define GUARD_BAND 2.0f
+
+#define CLIP_PLANES 5
+#define CLIP_MAX_POINTS (3 + CLIP_PLANES)
+
+/* number of clipped triangles buffered before being appended */
+#define BATCH_SIZE 64
+
+MEMORY_DECL(GX);
+
+void gx_occlusion_init(struct gx_occlusion *occlusion)
+{
+	jks_array_init(&occlusion->triangles, sizeof(struct gx_occlusion_triangle), NULL, &jks_array_memory_fn_GX);
+	pthread_mutex_init(&occlusion->mutex, NULL);
+	pthread_cond_init(&occlusion->cond, NULL);
+	gx_occlusion_clear(occlusion);
+}
+
+void gx_occlusion_destroy(struct gx_occlusion *occlusion)
+{
+	jks_array_destroy(&occlusion->triangles);
+	pthread_cond_destroy(&occlusion->cond);
+	pthread_mutex_destroy(&occlusion->mutex);
+}
+
+void gx_occlusion_clear(struct gx_occlusion *occlusion)
+{
+	jks_array_resize(&occlusion->triangles, 0);
+	occlusion->jobs_nb = 0;
+	occlusion->next_job = 0;
+	occlusion->collecting = 0;
+	occlusion->next_band = 0;
+	occlusion->bands_done = 0;
+	occlusion->started = false;
+	occlusion->disabled = false;
+	occlusion->ready = false;
+}
+
+void gx_occlusion_begin(struct gx_occlusion *occlusion, const struct mat4f *vp, uint32_t jobs_nb)
+{
+	pthread_mutex_lock(&occlusion->mutex);
+	if (!occlusion->started)
+	{
+		occlusion->started = true;
+		occlusion->vp = *vp;
+		occlusion->jobs_nb = jobs_nb;
+	}
+	occlusion->collecting++;
+	pthread_mutex_unlock(&occlusion->mutex);
+}
+
+bool gx_occlusion_next_job(struct gx_occlusion *occlusion, uint32_t *job)
+{
+	*job = __atomic_fetch_add(&occlusion->next_job, 1, __ATOMIC_RELAXED);
+	return *job < occlusion->jobs_nb;
+}
+
+void gx_occlusion_disable(struct gx_occlusion *occlusion)
+{
+	__atomic_store_n(&occlusion->disabled, true, __ATOMIC_RELAXED);
+}
+
+static float plane_distance(const struct vec4f *p, int plane)
+{
+	switch (plane)
+	{
+		case 0:
+			return p->w - NEAR_W;
+		case 1:
+			return GUARD_BAND * p->w - p->x;
+		case 2:
+			return GUARD_BAND * p->w + p->x;
+		case 3:
+			return GUARD_BAND * p->w - p->y;
+		default:
+			return GUARD_BAND * p->w + p->y;
+	}
+}
+
+static size_t clip_polygon(struct vec4f *points, size_t nb)
+{
+	struct vec4f tmp[CLIP_MAX_POINTS];
+	for (int plane = 0; plane < CLIP_PLANES && nb; ++plane)
+	{
+		size_t n = 0;
+		for (size_t i = 0; i < nb; ++i)
+		{
+			const struct vec4f *a = &points[i];
+			const struct vec4f *b = &points[(i + 1) % nb];
+			float da = plane_distance(a, plane);
+			float db = plane_distance(b, plane);
+			if (da >= 0)
+				tmp[n++] = *a;
+			if ((da >= 0) != (db >= 0))
+			{
+				float t = da / (da - db);
+				tmp[n].x = a->x + (b->x - a->x) * t;
+				tmp[n].y = a->y + (b->y - a->y) * t;
+				tmp[n].z = a->z + (b->z - a->z) * t;
+				tmp[n].w = a->w + (b->w - a->w) * t;
+				n++;
+			}
+		}
+		memcpy(points, tmp, sizeof(*points) * n);
+		nb = n;
+	}
+	return nb;
+}
+
+static void project(const struct vec4f *p, float *x, float *y, float *iz)
+{
+	*iz = 1.0f / p->w;
+	*x = (p->x * *iz * 0.5f + 0.5f) * GX_OCCLUSION_WIDTH;
+	*y = (0.5f - p->y * *iz * 0.5f) * GX_OCCLUSION_HEIGHT;
+}
+
+static void flush_batch(struct gx_occlusion *occlusion, const struct gx_occlusion_triangle *batch, size_t nb)
+{
+	if (!nb)
+		return;
+	pthread_mutex_lock(&occlusion->mutex);
+	struct gx_occlusion_triangle *dst = jks_array_grow(&occlusion->triangles, nb);
+	if (dst)
+		memcpy(dst, batch, sizeof(*batch) * nb);
+	else
+		LOG_ERROR("failed to grow occluders array");
+	pthread_mutex_unlock(&occlusion->mutex);
+	PERFORMANCE_COUNT(OCCLUSION_OCCLUDERS, nb);
+}
+
+void gx_occlusion_add_triangles(struct gx_occlusion *occlusion, const struct vec3f *points, size_t triangles_nb)
+{
+	struct gx_occlusion_triangle batch[BATCH_SIZE];
+	size_t batch_nb = 0;
+	for (size_t i = 0; i < triangles_nb; ++i)
+	{
+		struct vec4f clip[CLIP_MAX_POINTS];
+		float x[CLIP_MAX_POINTS];
+		float y[CLIP_MAX_POINTS];
+		float iz[CLIP_MAX_POINTS];
+		for (size_t j = 0; j < 3; ++j)
+		{
+			struct vec4f tmp;
+			VEC3_CPY(tmp, points[i * 3 + j]);
+			tmp.w = 1;
+			MAT4_VEC4_MUL(clip[j], occlusion->vp, tmp);
+		}
+		size_t nb = clip_polygon(clip, 3);
+		if (nb < 3)
+			continue;
+		float miny = INFINITY;
+		float maxy = -INFINITY;
+		float minx = INFINITY;
+		float maxx = -INFINITY;
+		for (size_t j = 0; j < nb; ++j)
+		{
+			project(&clip[j], &x[j], &y[j], &iz[j]);
+			if (x[j] < minx)
+				minx = x[j];
+			if (x[j] > maxx)
+				maxx = x[j];
+			if (y[j] < miny)
+				miny = y[j];
+			if (y[j] > maxy)
+				maxy = y[j];
+		}
+		if (maxx < 0 || minx >= GX_OCCLUSION_WIDTH
+		 || maxy < 0 || miny >= GX_OCCLUSION_HEIGHT)
+			continue;
+		int band_min = miny < 0 ? 0 : (int)miny / GX_OCCLUSION_TILE;
+		int band_max = maxy >= GX_OCCLUSION_HEIGHT ? GX_OCCLUSION_TILES_Y - 1 : (int)maxy / GX_OCCLUSION_TILE;
+		for (size_t j = 1; j < nb - 1; ++j)
+		{
+			struct gx_occlusion_triangle *triangle = &batch[batch_nb++];
+			triangle->x[0] = x[0];
+			triangle->y[0] = y[0];
+			triangle->iz[0] = iz[0];
+			triangle->x[1] = x[j];
+			triangle->y[1] = y[j];
+			triangle->iz[1] = iz[j];
+			triangle->x[2] = x[j + 1];
+			triangle->y[2] = y[j + 1];
+			triangle->iz[2] = iz[j + 1];
+			triangle->band_min = band_min;
+			triangle->band_max = band_max;
+			if (batch_nb == BATCH_SIZE)
+			{
+				flush_batch(occlusion, batch, batch_nb);
+				batch_nb = 0;
+			}
+		}
+	}
+	flush_batch(occlusion, batch, batch_nb);
+}
+
+static void draw_triangle(struct gx_occlusion *occlusion, const struct gx_occlusion_triangle *triangle, int band)
+{
+	const float *x = triangle->x;
+	const float *y = triangle->y;
+	const float *iz = triangle->iz;
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0)
+		return;
+	/* both windings are drawn, the edge functions are flipped to be
+	 * positive inside the triangle
+	 */
+	float sign = area < 0 ? -1 : 1;
+	float dzdx = ((iz[1] - iz[0]) * (y[2] - y[0]) - (iz[2] - iz[0]) * (y[1] - y[0])) / area;
+	float dzdy = ((iz[2] - iz[0]) * (x[1] - x[0]) - (iz[1] - iz[0]) * (x[2] - x[0])) / area;
+	float edx[3];
+	float edy[3];
+	float ec[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		int j = (i + 1) % 3;
+		/* e(px, py) = (xj - xi) * (py - yi) - (yj - yi) * (px - xi) */
+		edx[i] = -(y[j] - y[i]) * sign;
+		edy[i] = (x[j] - x[i]) * sign;
+		ec[i] = ((y[j] - y[i]) * x[i] - (x[j] - x[i]) * y[i]) * sign;
+	}
+	float minx = fminf(fminf(x[0], x[1]), x[2]);
+	float maxx = fmaxf(fmaxf(x[0], x[1]), x[2]);
+	float miny = fminf(fminf(y[0], y[1]), y[2]);
+	float maxy = fmaxf(fmaxf(y[0], y[1]), y[2]);
+	int x0 = minx < 0 ? 0 : (int)minx;
+	int x1 = maxx >= GX_OCCLUSION_WIDTH ? GX_OCCLUSION_WIDTH - 1 : (int)maxx;
+	int y0 = band * GX_OCCLUSION_TILE;
+	int y1 = y0 + GX_OCCLUSION_TILE - 1;
+	if (miny > y0)
+		y0 = miny;
+	if (maxy < y1)
+		y1 = maxy;
+	if (x0 > x1 || y0 > y1)
+		return;
+#ifdef __SSE__
+	x0 &= ~3;
+	__m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 zero = _mm_setzero_ps();
+#endif
+	for (int py = y0; py <= y1; ++py)
+	{
+		float *row = &occlusion->depth[py * GX_OCCLUSION_WIDTH];
+		float fy = py + 0.5f;
+#ifdef __SSE__
+		__m128 e0 = _mm_add_ps(_mm_set1_ps(ec[0] + edy[0] * fy + edx[0] * x0), _mm_mul_ps(offsets, _mm_set1_ps(edx[0])));
+		__m128 e1 = _mm_add_ps(_mm_set1_ps(ec[1] + edy[1] * fy + edx[1] * x0), _mm_mul_ps(offsets, _mm_set1_ps(edx[1])));
+		__m128 e2 = _mm_add_ps(_mm_set1_ps(ec[2] + edy[2] * fy + edx[2] * x0), _mm_mul_ps(offsets, _mm_set1_ps(edx[2])));
+		__m128 z = _mm_add_ps(_mm_set1_ps(iz[0] + dzdy * (fy - y[0]) + dzdx * (x0 - x[0])), _mm_mul_ps(offsets, _mm_set1_ps(dzdx)));
+		__m128 e0_step = _mm_set1_ps(edx[0] * 4);
+		__m128 e1_step = _mm_set1_ps(edx[1] * 4);
+		__m128 e2_step = _mm_set1_ps(edx[2] * 4);
+		__m128 z_step = _mm_set1_ps(dzdx * 4);
+		for (int px = x0; px <= x1; px += 4)
+		{
+			__m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(mask))
+			{
+				__m128 d = _mm_loadu_ps(&row[px]);
+				__m128 nearest = _mm_max_ps(d, z);
+				_mm_storeu_ps(&row[px], _mm_or_ps(_mm_and_ps(mask, nearest), _mm_andnot_ps(mask, d)));
+			}
+			e0 = _mm_add_ps(e0, e0_step);
+			e1 = _mm_add_ps(e1, e1_step);
+			e2 = _mm_add_ps(e2, e2_step);
+			z = _mm_add_ps(z, z_step);
+		}
+#else
+		for (int px = x0; px <= x1; ++px)
+		{
+			float fx = px + 0.5f;
+			if (ec[0] + edx[0] * fx + edy[0] * fy < 0
+			 || ec[1] + edx[1] * fx + edy[1] * fy < 0
+			 || ec[2] + edx[2] * fx + edy[2] * fy < 0)
+				continue;
+			float z = iz[0] + dzdx * (fx - x[0]) + dzdy * (fy - y[0]);
+			if (z > row[px])
+				row[px] = z;
+		}
+#endif
+	}
+}
+
+static void draw_band(struct gx_occlusion *occlusion, int band)
+{
+	memset(&occlusion->depth[band * GX_OCCLUSION_TILE * GX_OCCLUSION_WIDTH], 0, sizeof(*occlusion->depth) * GX_OCCLUSION_TILE * GX_OCCLUSION_WIDTH);
+	for (size_t i = 0; i < occlusion->triangles.size; ++i)
+	{
+		const struct gx_occlusion_triangle *triangle = JKS_ARRAY_GET(&occlusion->triangles, i, struct gx_occlusion_triangle);
+		if (band < triangle->band_min || band > triangle->band_max)
+			continue;
+		draw_triangle(occlusion, triangle, band);
+	}
+	for (int tx = 0; tx < GX_OCCLUSION_TILES_X; ++tx)
+	{
+		const float *src = &occlusion->depth[band * GX_OCCLUSION_TILE * GX_OCCLUSION_WIDTH + tx * GX_OCCLUSION_TILE];
+#ifdef __SSE__
+		__m128 farthest = _mm_set1_ps(INFINITY);
+		for (int py = 0; py < GX_OCCLUSION_TILE; ++py)
+		{
+			for (int px = 0; px < GX_OCCLUSION_TILE; px += 4)
+				farthest = _mm_min_ps(farthest, _mm_loadu_ps(&src[py * GX_OCCLUSION_WIDTH + px]));
+		}
+		farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+		farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+		occlusion->hiz[band * GX_OCCLUSION_TILES_X + tx] = _mm_cvtss_f32(farthest);
+#else
+		float farthest = INFINITY;
+		for (int py = 0; py < GX_OCCLUSION_TILE; ++py)
+		{
+			for (int px = 0; px < GX_OCCLUSION_TILE; ++px)
+			{
+				if (src[py * GX_OCCLUSION_WIDTH + px] < farthest)
+					farthest = src[py * GX_OCCLUSION_WIDTH + px];
+			}
+		}
+		occlusion->hiz[band * GX_OCCLUSION_TILES_X + tx] = farthest;
+#endif
+	}
+}
+
+void gx_occlusion_end(struct gx_occlusion *occlusion)
+{
+	pthread_mutex_lock(&occlusion->mutex);
+	if (!--occlusion->collecting)
+		pthread_cond_broadcast(&occlusion->cond);
+	while (occlusion->collecting)
+		pthread_cond_wait(&occlusion->cond, &occlusion->mutex);
+	pthread_mutex_unlock(&occlusion->mutex);
+	if (__atomic_load_n(&occlusion->disabled, __ATOMIC_RELAXED))
+		return;
+	uint32_t drawn = 0;
+	uint32_t band;
+	while ((band = __atomic_fetch_add(&occlusion->next_band, 1, __ATOMIC_RELAXED)) < GX_OCCLUSION_TILES_Y)
+	{
+		draw_band(occlusion, band);
+		drawn++;
+	}
+	pthread_mutex_lock(&occlusion->mutex);
+	occlusion->bands_done += drawn;
+	if (occlusion->bands_done == GX_OCCLUSION_TILES_Y)
+	{
+		__atomic_store_n(&occlusion->ready, true, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&occlusion->cond);
+	}
+	while (occlusion->bands_done < GX_OCCLUSION_TILES_Y)
+		pthread_cond_wait(&occlusion->cond, &occlusion->mutex);
+	pthread_mutex_unlock(&occlusion->mutex);
+}
+
+static bool test_rect(struct gx_occlusion *occlusion, int x0, int y0, int x1, int y1, float iz)
+{
+	for (int ty = y0 / GX_OCCLUSION_TILE; ty <= y1 / GX_OCCLUSION_TILE; ++ty)
+	{
+		for (int tx = x0 / GX_OCCLUSION_TILE; tx <= x1 / GX_OCCLUSION_TILE; ++tx)
+		{
+			if (occlusion->hiz[ty * GX_OCCLUSION_TILES_X + tx] > iz)
+				continue;
+			/* the tile isn't fully in front, check the covered pixels */
+			int px0 = tx * GX_OCCLUSION_TILE;
+			int py0 = ty * GX_OCCLUSION_TILE;
+			int px1 = px0 + GX_OCCLUSION_TILE - 1;
+			int py1 = py0 + GX_OCCLUSION_TILE - 1;
+			if (px0 < x0)
+				px0 = x0;
+			if (py0 < y0)
+				py0 = y0;
+			if (px1 > x1)
+				px1 = x1;
+			if (py1 > y1)
+				py1 = y1;
+			for (int py = py0; py <= py1; ++py)
+			{
+				const float *row = &occlusion->depth[py * GX_OCCLUSION_WIDTH];
+				for (int px = px0; px <= px1; ++px)
+				{
+					if (row[px] <= iz)
+						return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool gx_occlusion_test(struct gx_occlusion *occlusion, const struct aabb *aabb)
+{
+	if (!__atomic_load_n(&occlusion->ready, __ATOMIC_ACQUIRE))
+		return false;
+	float minx = INFINITY;
+	float maxx = -INFINITY;
+	float miny = INFINITY;
+	float maxy = -INFINITY;
+	float nearest = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		struct vec4f p;
+		struct vec4f tmp;
+		p.x = (i & 1) ? aabb->p1.x : aabb->p0.x;
+		p.y = (i & 2) ? aabb->p1.y : aabb->p0.y;
+		p.z = (i & 4) ? aabb->p1.z : aabb->p0.z;
+		p.w = 1;
+		MAT4_VEC4_MUL(tmp, occlusion->vp, p);
+		if (tmp.w < NEAR_W)
+		{
+			PERFORMANCE_COUNT(OCCLUSION_VISIBLE, 1);
+			return false;
+		}
+		float x;
+		float y;
+		float iz;
+		project(&tmp, &x, &y, &iz);
+		if (x < minx)
+			minx = x;
+		if (x > maxx)
+			maxx = x;
+		if (y < miny)
+			miny = y;
+		if (y > maxy)
+			maxy = y;
+		if (iz > nearest)
+			nearest = iz;
+	}
+	/* w is linear over the box: the nearest point is one of the corners */
+	int x0 = minx < 0 ? 0 : (int)minx;
+	int y0 = miny < 0 ? 0 : (int)miny;
+	int x1 = maxx >= GX_OCCLUSION_WIDTH ? GX_OCCLUSION_WIDTH - 1 : (int)maxx;
+	int y1 = maxy >= GX_OCCLUSION_HEIGHT ? GX_OCCLUSION_HEIGHT - 1 : (int)maxy;
+	if (x0 > x1 || y0 > y1 || !test_rect(occlusion, x0, y0, x1, y1, nearest))
+	{
+		PERFORMANCE_COUNT(OCCLUSION_VISIBLE, 1);
+		return false;
+	}
+	PERFORMANCE_COUNT(OCCLUSION_CULLED, 1);
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef GX_OCCLUSION_H
+#define GX_OCCLUSION_H
+
+#include <jks/array.h>
+#include <jks/aabb.h>
+#include <jks/mat4.h>
+#include <jks/vec3.h>
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#define GX_OCCLUSION_WIDTH   256
+#define GX_OCCLUSION_HEIGHT  128
+#define GX_OCCLUSION_TILE    8 /* hi-z tile size, also the height of a rasterization band */
+#define GX_OCCLUSION_TILES_X (GX_OCCLUSION_WIDTH / GX_OCCLUSION_TILE)
+#define GX_OCCLUSION_TILES_Y (GX_OCCLUSION_HEIGHT / GX_OCCLUSION_TILE)
+
+struct gx_occlusion_triangle
+{
+	float x[3];
+	float y[3];
+	float iz[3]; /* 1 / w, linear in screen space */
+	uint16_t band_min;
+	uint16_t band_max;
+};
+
+/*
+ * low resolution depth buffer of the cull camera
+ *
+ * every cull thread walks the occluder jobs (gx_occlusion_next_job), then
+ * the rasterization bands; tests are only enabled once all the bands are
+ * done, before that everything is considered visible
+ */
+struct gx_occlusion
+{
+	float depth[GX_OCCLUSION_WIDTH * GX_OCCLUSION_HEIGHT]; /* nearest 1 / w */
+	float hiz[GX_OCCLUSION_TILES_X * GX_OCCLUSION_TILES_Y]; /* farthest 1 / w of the tile */
+	struct jks_array triangles; /* struct gx_occlusion_triangle */
+	struct mat4f vp;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	uint32_t jobs_nb;
+	uint32_t next_job;
+	uint32_t collecting;
+	uint32_t next_band;
+	uint32_t bands_done;
+	bool started;
+	bool disabled;
+	bool ready;
+};
+
+void gx_occlusion_init(struct gx_occlusion *occlusion);
+void gx_occlusion_destroy(struct gx_occlusion *occlusion);
+void gx_occlusion_clear(struct gx_occlusion *occlusion);
+void gx_occlusion_begin(struct gx_occlusion *occlusion, const struct mat4f *vp, uint32_t jobs_nb);
+bool gx_occlusion_next_job(struct gx_occlusion *occlusion, uint32_t *job);
+void gx_occlusion_add_triangles(struct gx_occlusion *occlusion, const struct vec3f *points, size_t triangles_nb);
+void gx_occlusion_disable(struct gx_occlusion *occlusion);
+void gx_occlusion_end(struct gx_occlusion *occlusion);
+bool gx_occlusion_test(struct gx_occlusion *occlusion, const struct aabb *aabb);
+
+#endif
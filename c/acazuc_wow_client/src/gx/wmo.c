@@ -99,13 +99,34 @@ void gx_wmo_free(struct gx_wmo *wmo)
 		cache_unlock_wmo(g_wow->cache);
 		return;
 	}
-	cache_unref_unmutexed_wmo(g_wow->cache, wmo->filename);
+	cache_release_unmutexed_wmo(g_wow->cache, wmo->filename);
 	cache_unlock_wmo(g_wow->cache);
+}
+
+void gx_wmo_unload(struct gx_wmo *wmo)
+{
 	for (size_t i = 0; i < wmo->groups.size; ++i)
 		gx_wmo_group_free(*JKS_ARRAY_GET(&wmo->groups, i, struct gx_wmo_group*));
 	loader_push(g_wow->loader, ASYNC_TASK_WMO_UNLOAD, wmo_unload_task, wmo);
 }
 
+bool gx_wmo_get_size(struct gx_wmo *wmo, size_t *cpu, size_t *gpu)
+{
+	bool sized = true;
+	*cpu = sizeof(*wmo);
+	*gpu = 0;
+	for (size_t i = 0; i < wmo->groups.size; ++i)
+	{
+		size_t group_cpu;
+		size_t group_gpu;
+		if (!gx_wmo_group_get_size(*JKS_ARRAY_GET(&wmo->groups, i, struct gx_wmo_group*), &group_cpu, &group_gpu))
+			sized = false;
+		*cpu += group_cpu;
+		*gpu += group_gpu;
+	}
+	return sized;
+}
+
 void gx_wmo_ref(struct gx_wmo *wmo)
 {
 	refcount_inc(&wmo->refcount);
@@ -325,9 +346,8 @@ void gx_wmo_render(struct gx_wmo *wmo, struct gx_frame *frame)
 		model_block.v = *(struct mat4f*)&frame->view_v;
 		model_block.mv = instance_frame->mv;
 		model_block.mvp = instance_frame->mvp;
-		if (!instance_frame->uniform_buffer.handle.u64)
-			gfx_create_buffer(g_wow->device, &instance_frame->uniform_buffer, GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_wmo_model_block), GFX_BUFFER_STREAM);
-		gfx_set_buffer_data(&instance_frame->uniform_buffer, &model_block, sizeof(model_block), 0);
+		if (!gfx_linear_buffer_push(&frame->uniform_buffer, &model_block, sizeof(model_block), &instance_frame->uniform_offset))
+			instance_frame->uniform_offset = UINT32_MAX;
 	}
 	for (size_t i = 0; i < wmo->groups.size; ++i)
 		gx_wmo_group_render(*JKS_ARRAY_GET(&wmo->groups, i, struct gx_wmo_group*), frame, &wmo_frame->to_render);
@@ -499,7 +519,7 @@ struct gx_wmo_instance *gx_wmo_instance_new(const char *filename)
 	instance->traversed_portals = NULL;
 	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
 	{
-		instance->frames[i].uniform_buffer = GFX_BUFFER_INIT();
+		instance->frames[i].uniform_offset = UINT32_MAX;
 		instance->frames[i].culled = true;
 	}
 	jks_array_init(&instance->groups, sizeof(struct gx_wmo_group_instance), (jks_array_destructor_t)gx_wmo_group_instance_destroy, &jks_array_memory_fn_GX);
@@ -532,8 +552,6 @@ static void instance_delete_task(struct wow_mpq_compound *mpq_compound, void *us
 	(void)mpq_compound;
 	struct gx_wmo_instance *instance = userdata;
 	frustum_destroy(&instance->frustum);
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_delete_buffer(g_wow->device, &instance->frames[i].uniform_buffer);
 	jks_array_destroy(&instance->groups);
 	jks_array_destroy(&instance->m2);
 #ifdef WITH_DEBUG_RENDERING
@@ -650,6 +668,11 @@ void gx_wmo_instance_update(struct gx_wmo_instance *instance, struct gx_frame *f
 			return;
 		}
 	}
+	if (gx_occlusion_test(&frame->occlusion, &instance->aabb))
+	{
+		instance_frame->culled = true;
+		return;
+	}
 	struct gx_wmo_frame *wmo_frame = &instance->parent->frames[frame->id];
 	pthread_mutex_lock(&wmo_frame->mutex);
 	if (!jks_array_push_back(&wmo_frame->to_render, &instance))
@@ -66,6 +66,8 @@ struct gx_wmo
 
 struct gx_wmo *gx_wmo_new(char *filename);
 void gx_wmo_free(struct gx_wmo *wmo);
+void gx_wmo_unload(struct gx_wmo *wmo);
+bool gx_wmo_get_size(struct gx_wmo *wmo, size_t *cpu, size_t *gpu);
 void gx_wmo_ref(struct gx_wmo *wmo);
 void gx_wmo_ask_load(struct gx_wmo *wmo);
 void gx_wmo_clear_update(struct gx_wmo *wmo, struct gx_frame *frame);
@@ -133,7 +135,7 @@ bool gx_wmo_group_instance_on_load(struct gx_wmo_instance *instance, struct gx_w
 
 struct gx_wmo_instance_frame
 {
-	gfx_buffer_t uniform_buffer;
+	uint32_t uniform_offset; /* in frame uniform_buffer, UINT32_MAX if not uploaded */
 	struct mat4f mvp;
 	struct mat4f mv;
 	float distance_to_camera;
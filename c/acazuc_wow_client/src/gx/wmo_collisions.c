@@ -138,7 +138,10 @@ void gx_wmo_collisions_render(struct gx_wmo_collisions *collisions, struct gx_fr
 		struct gx_wmo_group_instance *group_instance = JKS_ARRAY_GET(&instances[i]->groups, group_idx, struct gx_wmo_group_instance);
 		if (group_instance->frames[frame->id].culled)
 			continue;
-		gfx_bind_constant(g_wow->device, 1, &instances[i]->frames[frame->id].uniform_buffer, sizeof(struct shader_wmo_model_block), 0);
+		uint32_t uniform_offset = instances[i]->frames[frame->id].uniform_offset;
+		if (uniform_offset == UINT32_MAX)
+			continue;
+		gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_wmo_model_block), uniform_offset);
 		gfx_draw(g_wow->device, collisions->indices_nb, 0);
 	}
 }
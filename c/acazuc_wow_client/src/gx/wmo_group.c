@@ -6,6 +6,8 @@
 #include "gx/m2.h"
 #include "gx/gx.h"
 
+#include "phys/physics.h"
+
 #include "shaders.h"
 #include "camera.h"
 #include "loader.h"
@@ -123,22 +125,16 @@ static void batch_init(struct gx_wmo_batch *batch, struct gx_wmo_group *parent,
 			batch->texture2 = NULL;
 		}
 	}
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		batch->uniform_buffers[i] = GFX_BUFFER_INIT();
 }
 
 static void batch_destroy(struct gx_wmo_batch *batch)
 {
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_delete_buffer(g_wow->device, &batch->uniform_buffers[i]);
 	gx_blp_free(batch->texture1);
 	gx_blp_free(batch->texture2);
 }
 
-static void batch_prepare_draw(struct gx_wmo_group *group, struct gx_frame *frame, struct gx_wmo_batch *batch)
+static bool batch_prepare_draw(struct gx_wmo_group *group, struct gx_frame *frame, struct gx_wmo_batch *batch)
 {
-	if (!batch->uniform_buffers[frame->id].handle.u64)
-		gfx_create_buffer(g_wow->device, &batch->uniform_buffers[frame->id], GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_wmo_mesh_block), GFX_BUFFER_STREAM);
 	struct shader_wmo_mesh_block mesh_block;
 	VEC4_SETV(mesh_block.emissive_color, 0);
 	VEC4_SETV(mesh_block.combiners, 0);
@@ -147,7 +143,9 @@ static void batch_prepare_draw(struct gx_wmo_group *group, struct gx_frame *fram
 	mesh_block.settings.y = (batch->flags1 & WOW_MOMT_FLAGS_UNLIT) ? 1 : 0;
 	mesh_block.settings.z = (batch->flags1 & WOW_MOMT_FLAGS_UNFOGGED) ? 1 : 0;
 	mesh_block.settings.w = batch->shader;
-	gfx_set_buffer_data(&batch->uniform_buffers[frame->id], &mesh_block, sizeof(mesh_block), 0);
+	uint32_t mesh_offset;
+	if (!gfx_linear_buffer_push(&frame->uniform_buffer, &mesh_block, sizeof(mesh_block), &mesh_offset))
+		return false;
 	const gfx_texture_t *textures[2];
 	if (batch->texture1)
 	{
@@ -186,11 +184,12 @@ static void batch_prepare_draw(struct gx_wmo_group *group, struct gx_frame *fram
 		textures[1] = &g_wow->grey_texture->texture;
 	}
 	gfx_bind_samplers(g_wow->device, 0, 1, textures); /* XXX 2 textures */
-	gfx_bind_constant(g_wow->device, 0, &batch->uniform_buffers[frame->id], sizeof(struct shader_wmo_mesh_block), 0);
+	gfx_bind_linear_constant(g_wow->device, 0, &frame->uniform_buffer, sizeof(struct shader_wmo_mesh_block), mesh_offset);
 	if (group->wow_flags & WOW_MOGP_FLAGS_COLOR)
 		gfx_bind_pipeline_state(g_wow->device, &((gfx_pipeline_state_t*)g_wow->gx->wmo_colored_pipeline_states)[batch->pipeline_state]);
 	else
 		gfx_bind_pipeline_state(g_wow->device, &((gfx_pipeline_state_t*)g_wow->gx->wmo_pipeline_states)[batch->pipeline_state]);
+	return true;
 }
 
 static void batch_render(struct gx_wmo_batch *batch)
@@ -225,6 +224,7 @@ struct gx_wmo_group *gx_wmo_group_new(struct gx_wmo *parent, uint32_t index, uin
 	jks_array_init(&group->movi, sizeof(uint16_t), NULL, &jks_array_memory_fn_GX);
 	jks_array_init(&group->movt, sizeof(struct wow_vec3f), NULL, &jks_array_memory_fn_GX);
 	jks_array_init(&group->mopy, sizeof(struct wow_mopy_data), NULL, &jks_array_memory_fn_GX);
+	phys_bvh_init(&group->collision_bvh);
 	group->attributes_state = GFX_ATTRIBUTES_STATE_INIT();
 	group->vertexes_buffer = GFX_BUFFER_INIT();
 	group->indices_buffer = GFX_BUFFER_INIT();
@@ -250,6 +250,7 @@ static void wmo_group_unload_task(struct wow_mpq_compound *mpq_compound, void *u
 	jks_array_destroy(&group->movi);
 	jks_array_destroy(&group->movt);
 	jks_array_destroy(&group->mopy);
+	phys_bvh_destroy(&group->collision_bvh);
 	gx_wmo_mliq_delete(group->gx_mliq);
 	gfx_delete_buffer(g_wow->device, &group->vertexes_buffer);
 	gfx_delete_buffer(g_wow->device, &group->indices_buffer);
@@ -267,6 +268,49 @@ void gx_wmo_group_free(struct gx_wmo_group *group)
 	loader_push(g_wow->loader, ASYNC_TASK_WMO_GROUP_UNLOAD, wmo_group_unload_task, group);
 }
 
+static size_t array_bytes(const struct jks_array *array)
+{
+	return array->capacity * array->data_size;
+}
+
+bool gx_wmo_group_get_size(struct gx_wmo_group *group, size_t *cpu, size_t *gpu)
+{
+	bool sized = true;
+	*cpu = sizeof(*group)
+	     + array_bytes(&group->batches)
+	     + array_bytes(&group->doodads)
+	     + array_bytes(&group->lights)
+	     + array_bytes(&group->mobn)
+	     + array_bytes(&group->mobr)
+	     + array_bytes(&group->movi)
+	     + array_bytes(&group->movt)
+	     + array_bytes(&group->mopy)
+	     + phys_bvh_get_size(&group->collision_bvh);
+	*gpu = group->vertexes_buffer.size
+	     + group->indices_buffer.size
+	     + group->colors_buffer.size;
+	/* the textures are kept alive by the group, account them here even
+	 * if shared with other groups; they may not be sized yet
+	 */
+	for (size_t i = 0; i < group->batches.size; ++i)
+	{
+		struct gx_wmo_batch *batch = JKS_ARRAY_GET(&group->batches, i, struct gx_wmo_batch);
+		struct gx_blp *textures[] = {batch->texture1, batch->texture2};
+		for (size_t j = 0; j < sizeof(textures) / sizeof(*textures); ++j)
+		{
+			if (!textures[j])
+				continue;
+			size_t texture_cpu;
+			size_t texture_gpu;
+			if (!gx_blp_get_size(textures[j], &texture_cpu, &texture_gpu))
+				sized = false;
+			*cpu += texture_cpu;
+			*gpu += texture_gpu;
+		}
+	}
+	return sized;
+}
+
 static bool initialize(void *userdata)
 {
 	struct gx_wmo_group *group = userdata;
@@ -364,6 +408,55 @@ static void update_mocv_portals(struct gx_wmo_group *group)
 	}
 }
 
+/* the collision mesh is made of the faces referenced by the bsp leaves */
+static bool build_collision_bvh(struct gx_wmo_group *group)
+{
+	size_t triangles_nb = group->mopy.size;
+	size_t n = 0;
+	bool ret = false;
+	if (!group->mobn.size || !triangles_nb)
+		return true;
+	uint8_t *used = mem_zalloc(MEM_PHYS, triangles_nb);
+	uint8_t *flags = mem_malloc(MEM_PHYS, triangles_nb);
+	struct vec3f *points = mem_malloc(MEM_PHYS, sizeof(*points) * triangles_nb * 3);
+	if (!used || !flags || !points)
+		goto end;
+	for (size_t i = 0; i < group->mobr.size; ++i)
+	{
+		uint16_t indice = *JKS_ARRAY_GET(&group->mobr, i, uint16_t);
+		if (indice >= triangles_nb || used[indice])
+			continue;
+		used[indice] = 1;
+		uint8_t mopy_flags = JKS_ARRAY_GET(&group->mopy, indice, struct wow_mopy_data)->flags;
+		if (!((mopy_flags & WOW_MOPY_FLAGS_COLLISION) || ((mopy_flags & WOW_MOPY_FLAGS_RENDER) && !(mopy_flags & WOW_MOPY_FLAGS_DETAIL))))
+			continue;
+		if (indice * 3u + 2 >= group->movi.size)
+			continue;
+		bool valid = true;
+		for (size_t j = 0; j < 3; ++j)
+		{
+			uint16_t vertex = *JKS_ARRAY_GET(&group->movi, indice * 3 + j, uint16_t);
+			if (vertex >= group->movt.size)
+			{
+				valid = false;
+				break;
+			}
+			VEC3_CPY(points[n * 3 + j], *JKS_ARRAY_GET(&group->movt, vertex, struct wow_vec3f));
+		}
+		if (!valid)
+			continue;
+		flags[n] = (mopy_flags & WOW_MOPY_FLAGS_NOCAMCOLLIDE) ? PHYS_TRIANGLE_NOCAM : 0;
+		n++;
+	}
+	ret = phys_bvh_build(&group->collision_bvh, points, flags, n);
+
+end:
+	mem_free(MEM_PHYS, points);
+	mem_free(MEM_PHYS, flags);
+	mem_free(MEM_PHYS, used);
+	return ret;
+}
+
 static void load(struct gx_wmo_group *group, struct wow_wmo_group_file *file)
 {
 	group->init_data = mem_malloc(MEM_GX, sizeof(*group->init_data));
@@ -515,6 +608,11 @@ static void load(struct gx_wmo_group *group, struct wow_wmo_group_file *file)
 	if (group->wow_flags & WOW_MOGP_FLAGS_BSP)
 		gx_wmo_collisions_load(&group->gx_collisions, group->mobr.data, group->mobr.size, group->movi.data, group->movt.data, group->mopy.data);
 #endif
+	if (!build_collision_bvh(group))
+	{
+		LOG_ERROR("failed to build wmo group collision bvh");
+		return;
+	}
 	gx_wmo_group_flag_set(group, GX_WMO_GROUP_FLAG_LOADED);
 	loader_init_object(g_wow->loader, LOADER_WMO_GROUP, initialize, group);
 }
@@ -574,18 +672,21 @@ void gx_wmo_group_render(struct gx_wmo_group *group, struct gx_frame *frame, str
 			if (batch_instance_frame->culled)
 				continue;
 			struct gx_wmo_batch *batch = JKS_ARRAY_GET(&group->batches, i, struct gx_wmo_batch);
+			if (instance_frame->uniform_offset == UINT32_MAX)
+				continue;
 			if (!initialized)
 			{
-				batch_prepare_draw(group, frame, batch);
+				if (!batch_prepare_draw(group, frame, batch))
+					break;
 				initialized = true;
 			}
-			gfx_bind_constant(g_wow->device, 1, &instance_frame->uniform_buffer, sizeof(struct shader_wmo_model_block), 0);
+			gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(struct shader_wmo_model_block), instance_frame->uniform_offset);
 			batch_render(batch);
 		}
 	}
 }
 
-static bool cull_portal_rec(struct gx_wmo_group *group, struct gx_wmo_instance *instance, struct gx_frame *frame, struct jks_array *frustums, struct vec4f rpos, struct jks_array *transformed)
+static bool cull_portal_rec(struct gx_wmo_group *group, struct gx_wmo_instance *instance, struct gx_frame *frame, struct jks_array *frustums, struct vec4f rpos)
 {
 	if (!gx_wmo_group_flag_get(group, GX_WMO_GROUP_FLAG_LOADED))
 		return true;
@@ -653,11 +754,13 @@ static bool cull_portal_rec(struct gx_wmo_group *group, struct gx_wmo_instance *
 		if ((VEC3_DOT(mopt->normal, rpos) + mopt->distance < 0) != (mopr->side < 0))
 			continue;
 		uint32_t base = mopt->start_vertex;
-		if (!jks_array_resize(transformed, mopt->count))
+		uint32_t transformed_nb = mopt->count;
+		struct vec4f *transformed = mem_arena_alloc(&frame->arena, sizeof(*transformed) * transformed_nb);
+		if (!transformed)
 			goto err;
-		for (uint32_t j = 0; j < transformed->size; ++j)
+		for (uint32_t j = 0; j < transformed_nb; ++j)
 		{
-			struct vec4f *dst = JKS_ARRAY_GET(transformed, j, struct vec4f);
+			struct vec4f *dst = &transformed[j];
 			struct wow_vec3f *vec = JKS_ARRAY_GET(&group->parent->mopv, base + j, struct wow_vec3f);
 			struct vec4f tmp;
 			VEC4_SET(tmp, vec->x, vec->y, vec->z, 1);
@@ -666,7 +769,7 @@ static bool cull_portal_rec(struct gx_wmo_group *group, struct gx_wmo_instance *
 		bool outside = false;
 		for (size_t j = 0; j < frustums->size; ++j)
 		{
-			if (!frustum_check_points(JKS_ARRAY_GET(frustums, j, struct frustum), (struct vec4f*)transformed->data, transformed->size))
+			if (!frustum_check_points(JKS_ARRAY_GET(frustums, j, struct frustum), transformed, transformed_nb))
 			{
 				outside = true;
 				break;
@@ -681,10 +784,10 @@ static bool cull_portal_rec(struct gx_wmo_group *group, struct gx_wmo_instance *
 		if (!new_frustum)
 			goto err;
 		frustum_init(new_frustum);
-		for (uint32_t j = 0; j < transformed->size; ++j)
+		for (uint32_t j = 0; j < transformed_nb; ++j)
 		{
-			struct vec4f *t1 = JKS_ARRAY_GET(transformed, j, struct vec4f);
-			struct vec4f *t2 = JKS_ARRAY_GET(transformed, (j + 1) % transformed->size, struct vec4f);
+			struct vec4f *t1 = &transformed[j];
+			struct vec4f *t2 = &transformed[(j + 1) % transformed_nb];
 			struct vec3f p1 = {t1->x, t1->y, t1->z};
 			struct vec3f p2 = {t2->x, t2->y, t2->z};
 			if (mopr->side < 0)
@@ -698,7 +801,7 @@ static bool cull_portal_rec(struct gx_wmo_group *group, struct gx_wmo_instance *
 					goto err;
 			}
 		}
-		cull_portal_rec(*JKS_ARRAY_GET(&group->parent->groups, mopr->group_index, struct gx_wmo_group*), instance, frame, frustums, rpos, transformed);
+		cull_portal_rec(*JKS_ARRAY_GET(&group->parent->groups, mopr->group_index, struct gx_wmo_group*), instance, frame, frustums, rpos);
 		if (!jks_array_resize(frustums, frustums->size - 1))
 			goto err;
 		instance->traversed_portals[portal / 8] &= ~(1 << (portal % 8));
@@ -723,11 +826,8 @@ void gx_wmo_group_cull_portal(struct gx_wmo_group *group, struct gx_wmo_instance
 		jks_array_destroy(&frustums);
 		return;
 	}
-	struct jks_array transformed; /* struct vec4f */
-	jks_array_init(&transformed, sizeof(struct vec4f), NULL, &jks_array_memory_fn_GX);
-	if (!cull_portal_rec(group, instance, frame, &frustums, rpos, &transformed))
+	if (!cull_portal_rec(group, instance, frame, &frustums, rpos))
 		LOG_INFO("cull failed");
-	jks_array_destroy(&transformed);
 	jks_array_destroy(&frustums);
 }
 
@@ -766,7 +866,6 @@ void gx_wmo_group_set_m2_lighting(struct gx_wmo_group *group, struct gx_wmo_inst
 			LOG_ERROR("failed to allocate m2 local lighting");
 			continue;
 		}
-		loc->uniform_buffer = GFX_BUFFER_INIT();
 		if (m2->local_lighting)
 		{
 			/* detect m2 which belongs to at least two groups */
@@ -802,7 +901,6 @@ void gx_wmo_group_set_m2_lighting(struct gx_wmo_group *group, struct gx_wmo_inst
 #if 0
 			LOG_WARN("replacing m2 local lighting");
 #endif
-			gfx_delete_buffer(g_wow->device, &m2->local_lighting->uniform_buffer);
 			mem_free(MEM_GX, m2->local_lighting);
 		}
 		m2->local_lighting = loc;
@@ -5,6 +5,8 @@
 # include "gx/wmo_collisions.h"
 #endif
 
+#include "phys/bvh.h"
+
 #include <jks/array.h>
 #include <jks/aabb.h>
 #include <jks/vec2.h>
@@ -28,7 +30,6 @@ struct gx_wmo_batch
 {
 	struct gx_wmo_group *parent;
 	uint32_t pipeline_state;
-	gfx_buffer_t uniform_buffers[RENDER_FRAMES_COUNT];
 	char *texture_name;
 	struct gx_blp *texture1;
 	struct gx_blp *texture2;
@@ -60,6 +61,7 @@ struct gx_wmo_group
 	struct jks_array movi; /* uint16_t */
 	struct jks_array movt; /* struct wow_vec3f */
 	struct jks_array mopy; /* struct wow_mopy_data */
+	struct phys_bvh collision_bvh;
 	gfx_attributes_state_t attributes_state;
 	gfx_buffer_t vertexes_buffer;
 	gfx_buffer_t indices_buffer;
@@ -95,6 +97,7 @@ static inline bool gx_wmo_group_flag_clear(struct gx_wmo_group *group, enum gx_w
 
 struct gx_wmo_group *gx_wmo_group_new(struct gx_wmo *parent, uint32_t index, uint32_t flags);
 void gx_wmo_group_free(struct gx_wmo_group *group);
+bool gx_wmo_group_get_size(struct gx_wmo_group *group, size_t *cpu, size_t *gpu);
 void gx_wmo_group_ask_load(struct gx_wmo_group *group);
 void gx_wmo_group_render(struct gx_wmo_group *group, struct gx_frame *frame, struct jks_array *instances);
 void gx_wmo_group_cull_portal(struct gx_wmo_group *group, struct gx_wmo_instance *instance, struct gx_frame *frame, struct vec4f rpos);
@@ -123,15 +123,7 @@ struct gx_wmo_mliq *gx_wmo_mliq_new(struct wow_wmo_group_file *file)
 			}
 		}
 	}
-	for (size_t i = 0; i < WMO_MLIQ_LIQUIDS_COUNT; ++i)
-	{
-		struct gx_wmo_mliq_liquid *liquid = &mliq->liquids[i];
-		for (size_t j = 0; j < RENDER_FRAMES_COUNT; ++j)
-			liquid->uniform_buffers[j] = GFX_BUFFER_INIT();
-	}
 	mliq->attributes_state = GFX_ATTRIBUTES_STATE_INIT();
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		mliq->frames[i].uniform_buffer = GFX_BUFFER_INIT();
 	mliq->vertexes_buffer = GFX_BUFFER_INIT();
 	mliq->indices_buffer = GFX_BUFFER_INIT();
 	return mliq;
@@ -149,17 +141,10 @@ void gx_wmo_mliq_delete(struct gx_wmo_mliq *mliq)
 {
 	if (!mliq)
 		return;
-	for (size_t i = 0; i < WMO_MLIQ_LIQUIDS_COUNT; ++i)
-	{
-		struct gx_wmo_mliq_liquid *liquid = &mliq->liquids[i];
-		for (size_t j = 0; j < RENDER_FRAMES_COUNT; ++j)
-			gfx_delete_buffer(g_wow->device, &liquid->uniform_buffers[j]);
-	}
 	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
 	{
 		for (size_t j = 0; j < WMO_MLIQ_LIQUIDS_COUNT; ++j)
 			jks_array_destroy(&mliq->frames[i].to_render[j]);
-		gfx_delete_buffer(g_wow->device, &mliq->frames[i].uniform_buffer);
 	}
 	gfx_delete_buffer(g_wow->device, &mliq->vertexes_buffer);
 	gfx_delete_buffer(g_wow->device, &mliq->indices_buffer);
@@ -185,13 +170,9 @@ void gx_wmo_mliq_initialize(struct gx_wmo_mliq *mliq)
 		if (!liquid->indices_nb)
 			continue;
 		gfx_set_buffer_data(&mliq->indices_buffer, mliq->init_data->indices[i].data, mliq->init_data->indices[i].size * sizeof(uint16_t), indices_pos * sizeof(uint16_t));
-		for (size_t j = 0; j < RENDER_FRAMES_COUNT; ++j)
-			gfx_create_buffer(g_wow->device, &liquid->uniform_buffers[j], GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_mliq_mesh_block), GFX_BUFFER_STREAM);
 		indices_pos += liquid->indices_nb;
 	}
 	gfx_create_buffer(g_wow->device, &mliq->vertexes_buffer, GFX_BUFFER_VERTEXES, mliq->init_data->vertexes.data, mliq->init_data->vertexes.size * sizeof(struct shader_mliq_input), GFX_BUFFER_IMMUTABLE);
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_create_buffer(g_wow->device, &mliq->frames[i].uniform_buffer, GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_mliq_model_block), GFX_BUFFER_STREAM);
 	init_data_delete(mliq->init_data);
 	mliq->init_data = NULL;
 	const struct gfx_attribute_bind binds[] =
@@ -233,22 +214,20 @@ void gx_wmo_mliq_add_to_render(struct gx_wmo_mliq *mliq, struct gx_wmo_instance
 	}
 }
 
-static void render_liquid(struct gx_wmo_mliq_liquid *liquid, struct gx_frame *frame, uint8_t type)
+void gx_wmo_mliq_render(struct gx_wmo_mliq *mliq, struct gx_frame *frame, uint8_t type)
 {
 	const float alphas[9] = {0.5f, 1.0f, 1.0f, 1.0f, 0.5f, 0.0f, 1.0f, 1.0f, 0.5f};
+	if (!mliq->attributes_state.handle.ptr)
+		return;
+	struct gx_wmo_mliq_frame *mliq_frame = &mliq->frames[frame->id];
+	struct gx_wmo_mliq_liquid *liquid = &mliq->liquids[type];
 	struct shader_mliq_mesh_block mesh_block;
 	mesh_block.alpha = alphas[type];
 	mesh_block.type = type;
-	gfx_set_buffer_data(&liquid->uniform_buffers[frame->id], &mesh_block, sizeof(mesh_block), 0);
-	gfx_bind_constant(g_wow->device, 0, &liquid->uniform_buffers[frame->id], sizeof(mesh_block), 0);
-	gfx_draw_indexed(g_wow->device, liquid->indices_nb, liquid->indices_offset);
-}
-
-void gx_wmo_mliq_render(struct gx_wmo_mliq *mliq, struct gx_frame *frame, uint8_t type)
-{
-	if (!mliq->attributes_state.handle.ptr)
+	uint32_t mesh_offset;
+	if (!gfx_linear_buffer_push(&frame->uniform_buffer, &mesh_block, sizeof(mesh_block), &mesh_offset))
 		return;
-	struct gx_wmo_mliq_frame *mliq_frame = &mliq->frames[frame->id];
+	gfx_bind_linear_constant(g_wow->device, 0, &frame->uniform_buffer, sizeof(mesh_block), mesh_offset);
 	gfx_bind_attributes_state(g_wow->device, &mliq->attributes_state, &g_wow->gx->wmo_mliq_input_layout);
 	for (size_t i = 0; i < mliq_frame->to_render[type].size; ++i)
 	{
@@ -259,8 +238,10 @@ void gx_wmo_mliq_render(struct gx_wmo_mliq *mliq, struct gx_frame *frame, uint8_
 		model_block.v = frame->view_v;
 		MAT4_MUL(model_block.mv, model_block.v, tmp);
 		MAT4_MUL(model_block.mvp, frame->view_p, model_block.mv);
-		gfx_set_buffer_data(&mliq_frame->uniform_buffer, &model_block, sizeof(model_block), 0);
-		gfx_bind_constant(g_wow->device, 1, &mliq_frame->uniform_buffer, sizeof(model_block), 0);
-		render_liquid(&mliq->liquids[type], frame, type);
+		uint32_t model_offset;
+		if (!gfx_linear_buffer_push(&frame->uniform_buffer, &model_block, sizeof(model_block), &model_offset))
+			return;
+		gfx_bind_linear_constant(g_wow->device, 1, &frame->uniform_buffer, sizeof(model_block), model_offset);
+		gfx_draw_indexed(g_wow->device, liquid->indices_nb, liquid->indices_offset);
 	}
 }
@@ -19,7 +19,6 @@ struct gx_frame;
 
 struct gx_wmo_mliq_liquid
 {
-	gfx_buffer_t uniform_buffers[RENDER_FRAMES_COUNT];
 	uint32_t indices_offset;
 	uint32_t indices_nb;
 };
@@ -27,7 +26,6 @@ struct gx_wmo_mliq_liquid
 struct gx_wmo_mliq_frame
 {
 	struct jks_array to_render[WMO_MLIQ_LIQUIDS_COUNT]; /* gx_wmo_instance_t* */
-	gfx_buffer_t uniform_buffer;
 };
 
 struct gx_wmo_mliq
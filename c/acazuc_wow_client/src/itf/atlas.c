@@ -0,0 +1,170 @@
+#include "itf/atlas.h"
+
+#include "font/atlas.h"
+
+#include "loader.h"
+#include "memory.h"
+#include "log.h"
+#include "wow.h"
+
+#include <wow/blp.h>
+#include <wow/mpq.h>
+
+#include <string.h>
+
+#define ATLAS_WIDTH 1024
+#define ATLAS_MAX_HEIGHT 4096
+#define ENTRY_MAX_SIZE 128
+
+MEMORY_DECL(UI);
+
+static void entry_unref(struct interface_atlas_entry *entry)
+{
+	if (refcount_dec(&entry->refcount))
+		return;
+	mem_free(MEM_LIBWOW, entry->data);
+	mem_free(MEM_UI, entry->filename);
+	mem_free(MEM_UI, entry);
+}
+
+static void entries_hmap_destructor(jks_hmap_key_t key, void *val)
+{
+	(void)key;
+	entry_unref(*(struct interface_atlas_entry**)val);
+}
+
+static void set_state(struct interface_atlas_entry *entry, enum interface_atlas_state state)
+{
+	__atomic_store_n(&entry->state, state, __ATOMIC_RELEASE);
+}
+
+static enum interface_atlas_state get_state(struct interface_atlas_entry *entry)
+{
+	return __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+}
+
+static void load_task(struct wow_mpq_compound *mpq_compound, void *userdata)
+{
+	struct interface_atlas_entry *entry = userdata;
+	struct wow_mpq_file *mpq_file = NULL;
+	struct wow_blp_file *blp_file = NULL;
+	enum interface_atlas_state state = INTERFACE_ATLAS_REJECTED;
+
+	mpq_file = wow_mpq_get_file(mpq_compound, entry->filename);
+	if (!mpq_file)
+		goto end;
+	blp_file = wow_blp_file_new(mpq_file);
+	if (!blp_file)
+		goto end;
+	if (blp_file->header.width > ENTRY_MAX_SIZE
+	 || blp_file->header.height > ENTRY_MAX_SIZE)
+		goto end;
+	if (!wow_blp_decode_rgba(blp_file, 0, &entry->width, &entry->height, &entry->data))
+	{
+		LOG_ERROR("failed to decode blp file %s", entry->filename);
+		goto end;
+	}
+	if (!entry->width || !entry->height)
+		goto end;
+	state = INTERFACE_ATLAS_LOADED;
+
+end:
+	wow_mpq_file_delete(mpq_file);
+	wow_blp_file_delete(blp_file);
+	set_state(entry, state);
+	entry_unref(entry);
+}
+
+bool interface_atlas_init(struct interface_atlas *atlas)
+{
+	atlas->atlas = font_atlas_new();
+	if (!atlas->atlas)
+	{
+		LOG_ERROR("failed to create interface atlas");
+		return false;
+	}
+	atlas->atlas->width = ATLAS_WIDTH;
+	jks_hmap_init(&atlas->entries, sizeof(struct interface_atlas_entry*), entries_hmap_destructor, jks_hmap_hash_str, jks_hmap_cmp_str, &jks_hmap_memory_fn_UI);
+	atlas->grey = interface_atlas_get(atlas, "TILESET\\GENERIC\\GREY.BLP");
+	return true;
+}
+
+void interface_atlas_destroy(struct interface_atlas *atlas)
+{
+	jks_hmap_destroy(&atlas->entries);
+	font_atlas_delete(atlas->atlas);
+}
+
+void interface_atlas_clear(struct interface_atlas *atlas)
+{
+	jks_hmap_destroy(&atlas->entries);
+	jks_hmap_init(&atlas->entries, sizeof(struct interface_atlas_entry*), entries_hmap_destructor, jks_hmap_hash_str, jks_hmap_cmp_str, &jks_hmap_memory_fn_UI);
+	font_atlas_clear(atlas->atlas);
+	atlas->grey = interface_atlas_get(atlas, "TILESET\\GENERIC\\GREY.BLP");
+}
+
+struct interface_atlas_entry *interface_atlas_get(struct interface_atlas *atlas, const char *filename)
+{
+	struct interface_atlas_entry **entryp = jks_hmap_get(&atlas->entries, JKS_HMAP_KEY_STR((char*)filename));
+	if (entryp)
+		return *entryp;
+	struct interface_atlas_entry *entry = mem_zalloc(MEM_UI, sizeof(*entry));
+	if (!entry)
+	{
+		LOG_ERROR("failed to allocate atlas entry");
+		return NULL;
+	}
+	entry->filename = mem_strdup(MEM_UI, filename);
+	if (!entry->filename)
+	{
+		LOG_ERROR("failed to duplicate atlas entry filename");
+		mem_free(MEM_UI, entry);
+		return NULL;
+	}
+	entry->state = INTERFACE_ATLAS_PENDING;
+	refcount_init(&entry->refcount, 2);
+	if (!jks_hmap_set(&atlas->entries, JKS_HMAP_KEY_STR(entry->filename), &entry))
+	{
+		LOG_ERROR("failed to add atlas entry");
+		mem_free(MEM_UI, entry->filename);
+		mem_free(MEM_UI, entry);
+		return NULL;
+	}
+	loader_push(g_wow->loader, ASYNC_TASK_BLP_LOAD, load_task, entry);
+	return entry;
+}
+
+static bool find_place(struct interface_atlas *atlas, uint32_t width, uint32_t height, uint32_t *x, uint32_t *y)
+{
+	if (font_atlas_find_place(atlas->atlas, width, height, x, y))
+		return true;
+	if (atlas->atlas->height >= ATLAS_MAX_HEIGHT)
+		return false;
+	if (!font_atlas_grow(atlas->atlas))
+		return false;
+	return font_atlas_find_place(atlas->atlas, width, height, x, y);
+}
+
+enum interface_atlas_state interface_atlas_pack(struct interface_atlas *atlas, struct interface_atlas_entry *entry)
+{
+	enum interface_atlas_state state = get_state(entry);
+	if (state != INTERFACE_ATLAS_LOADED)
+		return state;
+	uint32_t x;
+	uint32_t y;
+	if (find_place(atlas, entry->width + 2, entry->height + 2, &x, &y))
+	{
+		entry->x = x + 1;
+		entry->y = y + 1;
+		font_atlas_add_rgba(atlas->atlas, entry->x, entry->y, entry->width, entry->height, entry->data);
+		state = INTERFACE_ATLAS_PACKED;
+	}
+	else
+	{
+		state = INTERFACE_ATLAS_REJECTED;
+	}
+	mem_free(MEM_LIBWOW, entry->data);
+	entry->data = NULL;
+	set_state(entry, state);
+	return state;
+}
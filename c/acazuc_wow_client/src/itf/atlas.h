@@ -0,0 +1,58 @@
+#ifndef UI_ATLAS_H
+#define UI_ATLAS_H
+
+#include "refcount.h"
+
+#include <jks/hmap.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef interface
+# undef interface
+#endif
+
+struct font_atlas;
+
+enum interface_atlas_state
+{
+	INTERFACE_ATLAS_PENDING,
+	INTERFACE_ATLAS_LOADED, /* decoded, waiting to be packed by the render thread */
+	INTERFACE_ATLAS_PACKED,
+	INTERFACE_ATLAS_REJECTED, /* too big, missing or no more space: drawn from its own blp */
+};
+
+struct interface_atlas_entry
+{
+	char *filename;
+	uint8_t *data; /* rgba, only until packed */
+	uint32_t width;
+	uint32_t height;
+	uint32_t x;
+	uint32_t y;
+	enum interface_atlas_state state;
+	refcount_t refcount;
+};
+
+/*
+ * the glyphs of all the interface fonts and the small interface blps share a
+ * single rgba texture, so that consecutive texts and textures can be merged
+ * in a single draw call by the interface batch
+ *
+ * the atlas only grows (new rows are appended, the width never changes), the
+ * places are never reused and are only reclaimed when the interface is cleared
+ */
+struct interface_atlas
+{
+	struct font_atlas *atlas;
+	struct jks_hmap entries; /* char*, struct interface_atlas_entry* */
+	struct interface_atlas_entry *grey;
+};
+
+bool interface_atlas_init(struct interface_atlas *atlas);
+void interface_atlas_destroy(struct interface_atlas *atlas);
+void interface_atlas_clear(struct interface_atlas *atlas);
+struct interface_atlas_entry *interface_atlas_get(struct interface_atlas *atlas, const char *filename);
+enum interface_atlas_state interface_atlas_pack(struct interface_atlas *atlas, struct interface_atlas_entry *entry);
+
+#endif
@@ -0,0 +1,235 @@
+#include "itf/interface.h"
+#include "itf/batch.h"
+#include "itf/atlas.h"
+
+#include "font/atlas.h"
+
+#include "gx/frame.h"
+
+#include "performance.h"
+#include "shaders.h"
+#include "memory.h"
+#include "log.h"
+#include "wow.h"
+
+#include <gfx/device.h>
+
+#include <string.h>
+
+#define MIN_CAPACITY 256
+
+MEMORY_DECL(UI);
+
+void interface_batch_init(struct interface_batch *batch, struct interface *interface)
+{
+	batch->interface = interface;
+	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
+	{
+		batch->attributes_states[i] = GFX_ATTRIBUTES_STATE_INIT();
+		batch->vertexes_buffers[i] = GFX_BUFFER_INIT();
+		batch->indices_buffers[i] = GFX_BUFFER_INIT();
+		batch->uniform_buffers[i][0] = GFX_BUFFER_INIT();
+		batch->uniform_buffers[i][1] = GFX_BUFFER_INIT();
+		batch->buffers_capacity[i] = 0;
+		jks_array_init(&batch->retired_buffers[i], sizeof(gfx_buffer_t), NULL, &jks_array_memory_fn_UI);
+	}
+	jks_array_init(&batch->vertexes, sizeof(struct shader_ui_input), NULL, &jks_array_memory_fn_UI);
+	jks_array_init(&batch->draws, sizeof(struct interface_batch_draw), NULL, &jks_array_memory_fn_UI);
+	batch->quads_offset = 0;
+	batch->frame_id = 0;
+}
+
+static void delete_retired_buffers(struct interface_batch *batch, uint32_t id)
+{
+	for (size_t i = 0; i < batch->retired_buffers[id].size; ++i)
+		gfx_delete_buffer(g_wow->device, JKS_ARRAY_GET(&batch->retired_buffers[id], i, gfx_buffer_t));
+	jks_array_resize(&batch->retired_buffers[id], 0);
+}
+
+void interface_batch_destroy(struct interface_batch *batch)
+{
+	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
+	{
+		delete_retired_buffers(batch, i);
+		jks_array_destroy(&batch->retired_buffers[i]);
+		gfx_delete_attributes_state(g_wow->device, &batch->attributes_states[i]);
+		gfx_delete_buffer(g_wow->device, &batch->vertexes_buffers[i]);
+		gfx_delete_buffer(g_wow->device, &batch->indices_buffers[i]);
+		gfx_delete_buffer(g_wow->device, &batch->uniform_buffers[i][0]);
+		gfx_delete_buffer(g_wow->device, &batch->uniform_buffers[i][1]);
+	}
+	jks_array_destroy(&batch->vertexes);
+	jks_array_destroy(&batch->draws);
+}
+
+void interface_batch_begin(struct interface_batch *batch)
+{
+	batch->frame_id = g_wow->draw_frame->id;
+	batch->quads_offset = 0;
+	delete_retired_buffers(batch, batch->frame_id);
+	jks_array_resize(&batch->vertexes, 0);
+	jks_array_resize(&batch->draws, 0);
+	for (size_t i = 0; i < 2; ++i)
+	{
+		gfx_buffer_t *uniform_buffer = &batch->uniform_buffers[batch->frame_id][i];
+		if (!uniform_buffer->handle.u64)
+			gfx_create_buffer(g_wow->device, uniform_buffer, GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_ui_model_block), GFX_BUFFER_STREAM);
+		struct shader_ui_model_block model_block;
+		model_block.mvp = batch->interface->mat;
+		VEC4_SET(model_block.color, 1, 1, 1, 1);
+		VEC4_SET(model_block.uv_transform, 1, 0, 1, 0);
+		model_block.alpha_test = i ? 224.0 / 255.0 : 0.0;
+		model_block.use_mask = 0;
+		gfx_set_buffer_data(uniform_buffer, &model_block, sizeof(model_block), 0);
+	}
+}
+
+void interface_batch_push(struct interface_batch *batch, const gfx_texture_t *texture, uint32_t blend_state, uint32_t flags, const struct shader_ui_input *vertexes, uint32_t quads_nb, struct vec2f offset, struct vec4f color)
+{
+	if (!quads_nb)
+		return;
+	PERFORMANCE_COUNT(UI_REGIONS, 1);
+	struct interface_batch_draw *draw = NULL;
+	if (batch->draws.size)
+	{
+		draw = JKS_ARRAY_GET(&batch->draws, batch->draws.size - 1, struct interface_batch_draw);
+		if (draw->texture != texture
+		 || draw->blend_state != blend_state
+		 || draw->flags != flags)
+			draw = NULL;
+	}
+	size_t base = batch->vertexes.size;
+	struct shader_ui_input *dst = jks_array_grow(&batch->vertexes, quads_nb * 4);
+	if (!dst)
+	{
+		LOG_ERROR("failed to grow batch vertexes");
+		return;
+	}
+	if (!draw)
+	{
+		draw = jks_array_grow(&batch->draws, 1);
+		if (!draw)
+		{
+			LOG_ERROR("failed to grow batch draws");
+			jks_array_resize(&batch->vertexes, base);
+			return;
+		}
+		draw->texture = texture;
+		draw->blend_state = blend_state;
+		draw->flags = flags;
+		draw->quads_offset = base / 4;
+		draw->quads_nb = 0;
+	}
+	draw->quads_nb += quads_nb;
+	for (size_t i = 0; i < quads_nb * 4; ++i)
+	{
+		VEC2_ADD(dst[i].position, vertexes[i].position, offset);
+		VEC4_MUL(dst[i].color, vertexes[i].color, color);
+		dst[i].uv = vertexes[i].uv;
+	}
+}
+
+static bool reserve(struct interface_batch *batch, uint32_t quads_nb)
+{
+	uint32_t id = batch->frame_id;
+	if (batch->quads_offset + quads_nb <= batch->buffers_capacity[id])
+		return true;
+	/* the draws already recorded this frame still use the previous buffers:
+	 * they are retired until the frame slot comes round again, the new ones
+	 * are written from the start
+	 */
+	uint32_t capacity = batch->buffers_capacity[id] ? batch->buffers_capacity[id] : MIN_CAPACITY;
+	while (capacity < quads_nb)
+		capacity *= 2;
+	if (capacity == batch->buffers_capacity[id])
+		capacity *= 2;
+	uint32_t *indices = mem_malloc(MEM_UI, sizeof(*indices) * 6 * capacity);
+	if (!indices)
+	{
+		LOG_ERROR("failed to allocate batch indices");
+		return false;
+	}
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 0;
+		indices[i * 6 + 4] = i * 4 + 2;
+		indices[i * 6 + 5] = i * 4 + 3;
+	}
+	if (batch->buffers_capacity[id])
+	{
+		gfx_buffer_t *retired = jks_array_grow(&batch->retired_buffers[id], 2);
+		if (!retired)
+		{
+			LOG_ERROR("failed to grow retired batch buffers");
+			mem_free(MEM_UI, indices);
+			return false;
+		}
+		retired[0] = batch->vertexes_buffers[id];
+		retired[1] = batch->indices_buffers[id];
+		batch->vertexes_buffers[id] = GFX_BUFFER_INIT();
+		batch->indices_buffers[id] = GFX_BUFFER_INIT();
+	}
+	gfx_delete_attributes_state(g_wow->device, &batch->attributes_states[id]);
+	gfx_create_buffer(g_wow->device, &batch->vertexes_buffers[id], GFX_BUFFER_VERTEXES, NULL, sizeof(struct shader_ui_input) * 4 * capacity, GFX_BUFFER_STREAM);
+	gfx_create_buffer(g_wow->device, &batch->indices_buffers[id], GFX_BUFFER_INDICES, indices, sizeof(*indices) * 6 * capacity, GFX_BUFFER_IMMUTABLE);
+	mem_free(MEM_UI, indices);
+	const struct gfx_attribute_bind binds[] =
+	{
+		{&batch->vertexes_buffers[id]},
+	};
+	gfx_create_attributes_state(g_wow->device, &batch->attributes_states[id], binds, sizeof(binds) / sizeof(*binds), &batch->indices_buffers[id], GFX_INDEX_UINT32);
+	batch->buffers_capacity[id] = capacity;
+	batch->quads_offset = 0;
+	return true;
+}
+
+void interface_batch_flush(struct interface_batch *batch)
+{
+	if (!batch->draws.size)
+		return;
+	struct font_atlas *atlas = batch->interface->atlas.atlas;
+	uint32_t quads_nb = batch->vertexes.size / 4;
+	uint32_t id = batch->frame_id;
+	font_atlas_update(atlas);
+	if (!reserve(batch, quads_nb))
+		goto end;
+	if (atlas->width && atlas->height)
+	{
+		float inv_width = 1.f / atlas->width;
+		float inv_height = 1.f / atlas->height;
+		for (size_t i = 0; i < batch->draws.size; ++i)
+		{
+			struct interface_batch_draw *draw = JKS_ARRAY_GET(&batch->draws, i, struct interface_batch_draw);
+			if (!(draw->flags & INTERFACE_BATCH_ATLAS))
+				continue;
+			struct shader_ui_input *vertexes = JKS_ARRAY_GET(&batch->vertexes, draw->quads_offset * 4, struct shader_ui_input);
+			for (size_t j = 0; j < draw->quads_nb * 4; ++j)
+			{
+				vertexes[j].uv.x *= inv_width;
+				vertexes[j].uv.y *= inv_height;
+			}
+		}
+	}
+	gfx_set_buffer_data(&batch->vertexes_buffers[id], batch->vertexes.data, sizeof(struct shader_ui_input) * batch->vertexes.size, sizeof(struct shader_ui_input) * 4 * batch->quads_offset);
+	gfx_bind_attributes_state(g_wow->device, &batch->attributes_states[id], &batch->interface->input_layout);
+	for (size_t i = 0; i < batch->draws.size; ++i)
+	{
+		struct interface_batch_draw *draw = JKS_ARRAY_GET(&batch->draws, i, struct interface_batch_draw);
+		if ((draw->flags & INTERFACE_BATCH_ATLAS) && !atlas->texture.handle.u64)
+			continue;
+		const gfx_buffer_t *uniform_buffer = &batch->uniform_buffers[id][(draw->flags & INTERFACE_BATCH_ALPHA_TEST) ? 1 : 0];
+		gfx_bind_pipeline_state(g_wow->device, &batch->interface->pipeline_states[draw->blend_state]);
+		gfx_bind_constant(g_wow->device, 1, uniform_buffer, sizeof(struct shader_ui_model_block), 0);
+		gfx_bind_samplers(g_wow->device, 0, 1, &draw->texture);
+		gfx_draw_indexed(g_wow->device, draw->quads_nb * 6, (batch->quads_offset + draw->quads_offset) * 6);
+		PERFORMANCE_COUNT(UI_DRAWS, 1);
+	}
+	batch->quads_offset += quads_nb;
+
+end:
+	jks_array_resize(&batch->vertexes, 0);
+	jks_array_resize(&batch->draws, 0);
+}
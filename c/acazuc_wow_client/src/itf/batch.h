@@ -0,0 +1,65 @@
+#ifndef UI_BATCH_H
+#define UI_BATCH_H
+
+#include <jks/array.h>
+#include <jks/vec2.h>
+#include <jks/vec4.h>
+
+#include <gfx/objects.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef interface
+# undef interface
+#endif
+
+struct shader_ui_input;
+struct interface;
+
+enum interface_batch_flag
+{
+	INTERFACE_BATCH_ALPHA_TEST = (1 << 0),
+	INTERFACE_BATCH_ATLAS      = (1 << 1), /* uv are in atlas pixels, normalized when flushed as the atlas may grow meanwhile */
+};
+
+struct interface_batch_draw
+{
+	const gfx_texture_t *texture;
+	uint32_t blend_state; /* enum interface_blend_state */
+	uint32_t flags; /* enum interface_batch_flag */
+	uint32_t quads_offset;
+	uint32_t quads_nb;
+};
+
+/*
+ * collects the quads of the textures and font strings in the order they are
+ * rendered (which is already the strata / level / layer order) and merges the
+ * consecutive ones sharing a texture and a blend state in a single draw
+ *
+ * the quads of a frame are appended to a single stream vertexes buffer, every
+ * object rendering itself outside of the batch (backdrops, models, scissored
+ * frames, ...) must flush it first to keep the rendering order
+ */
+struct interface_batch
+{
+	struct interface *interface;
+	gfx_attributes_state_t attributes_states[RENDER_FRAMES_COUNT];
+	gfx_buffer_t vertexes_buffers[RENDER_FRAMES_COUNT];
+	gfx_buffer_t uniform_buffers[RENDER_FRAMES_COUNT][2]; /* without and with alpha test */
+	gfx_buffer_t indices_buffers[RENDER_FRAMES_COUNT];
+	uint32_t buffers_capacity[RENDER_FRAMES_COUNT]; /* quads */
+	struct jks_array retired_buffers[RENDER_FRAMES_COUNT]; /* gfx_buffer_t, outgrown during the frame, deleted when its slot comes round again */
+	struct jks_array vertexes; /* struct shader_ui_input, not yet flushed */
+	struct jks_array draws; /* struct interface_batch_draw, not yet flushed */
+	uint32_t quads_offset; /* quads already written in the current frame buffer */
+	uint32_t frame_id;
+};
+
+void interface_batch_init(struct interface_batch *batch, struct interface *interface);
+void interface_batch_destroy(struct interface_batch *batch);
+void interface_batch_begin(struct interface_batch *batch);
+void interface_batch_push(struct interface_batch *batch, const gfx_texture_t *texture, uint32_t blend_state, uint32_t flags, const struct shader_ui_input *vertexes, uint32_t quads_nb, struct vec2f offset, struct vec4f color);
+void interface_batch_flush(struct interface_batch *batch);
+
+#endif
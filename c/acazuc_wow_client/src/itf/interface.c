@@ -9,6 +9,7 @@
 #include "ui/edit_box.h"
 #include "ui/frame.h"
 
+#include "xml/document.h"
 #include "xml/ui.h"
 
 #include "font/model.h"
@@ -23,8 +24,6 @@
 #include "log.h"
 #include "wow.h"
 
-#include <libxml/tree.h>
-
 #include <gfx/window.h>
 #include <gfx/device.h>
 
@@ -144,7 +143,6 @@ static void render_font_hmap_destructor(jks_hmap_key_t key, void *val)
 	font_free(font->font);
 	font_free(font->outline_normal);
 	font_free(font->outline_thick);
-	font_atlas_delete(font->atlas);
 }
 
 static void xml_ui_dtr(void *ptr)
@@ -223,6 +221,14 @@ struct interface *interface_new(void)
 		mem_free(MEM_UI, interface);
 		return NULL;
 	}
+	if (!interface_atlas_init(&interface->atlas))
+	{
+		lua_close(interface->L);
+		mem_free(MEM_UI, interface);
+		return NULL;
+	}
+	interface_batch_init(&interface->batch, interface);
+	interface_cache_init(&interface->cache, (g_wow->wow_opt & WOW_OPT_INTERFACE_CACHE) != 0);
 	lua_checkstack(interface->L, 1024 * 16);
 	luaL_openlibs(interface->L);
 	interface->is_gluescreen = false;
@@ -309,6 +315,9 @@ void interface_delete(struct interface *interface)
 	jks_hmap_destroy(&interface->frames);
 	jks_hmap_destroy(&interface->fonts);
 	gfx_delete_texture(g_wow->device, &interface->white_pixel);
+	interface_batch_destroy(&interface->batch);
+	interface_atlas_destroy(&interface->atlas);
+	interface_cache_destroy(&interface->cache);
 	lua_script_delete(interface->error_script);
 	lua_close(interface->L);
 	for (size_t i = 0; i < sizeof(interface->cursors) / sizeof(*interface->cursors); ++i)
@@ -340,6 +349,7 @@ void interface_clear(struct interface *interface)
 	jks_hmap_init(&interface->frames, sizeof(struct ui_frame*), frames_hmap_destructor, jks_hmap_hash_str, jks_hmap_cmp_str, &jks_hmap_memory_fn_UI);
 	jks_hmap_init(&interface->fonts, sizeof(struct ui_font*), fonts_hmap_destructor, jks_hmap_hash_str, jks_hmap_cmp_str, &jks_hmap_memory_fn_UI);
 	interface->active_input = NULL;
+	interface_atlas_clear(&interface->atlas);
 }
 
 static void initialize(struct interface *interface)
@@ -367,6 +377,8 @@ static void initialize(struct interface *interface)
 
 static void set_frame_screen(struct interface *interface)
 {
+	uint32_t hits = interface->cache.hits;
+	uint32_t misses = interface->cache.misses;
 	int64_t started = nanotime();
 	load_src_addon(interface, "FrameXML");
 	load_addons(interface);
@@ -375,11 +387,17 @@ static void set_frame_screen(struct interface *interface)
 	interface_execute_event(g_wow->interface, EVENT_VARIABLES_LOADED, 0);
 	interface_execute_event(g_wow->interface, EVENT_UPDATE_CHAT_WINDOWS, 0);
 	snd_set_glue_music(g_wow->snd, NULL);
-	LOG_INFO("loaded FrameXML in %" PRId64 " ms", (ended - started) / 1000000);
+	LOG_INFO("loaded FrameXML in %" PRId64 " ms (interface cache %s: %" PRIu32 " hits, %" PRIu32 " misses)",
+	         (ended - started) / 1000000,
+	         interface->cache.enabled ? "enabled" : "disabled",
+	         interface->cache.hits - hits,
+	         interface->cache.misses - misses);
 }
 
 static void set_glue_screen(struct interface *interface)
 {
+	uint32_t hits = interface->cache.hits;
+	uint32_t misses = interface->cache.misses;
 	int64_t started = nanotime();
 	load_src_addon(interface, "GlueXML");
 	add_addons(interface);
@@ -387,7 +405,11 @@ static void set_glue_screen(struct interface *interface)
 	lua_pushnil(interface->L);
 	lua_pushstring(interface->L, "login");
 	interface_execute_event(g_wow->interface, EVENT_SET_GLUE_SCREEN, 1);
-	LOG_INFO("loaded GlueXML in %" PRId64 " ms", (ended - started) / 1000000);
+	LOG_INFO("loaded GlueXML in %" PRId64 " ms (interface cache %s: %" PRIu32 " hits, %" PRIu32 " misses)",
+	         (ended - started) / 1000000,
+	         interface->cache.enabled ? "enabled" : "disabled",
+	         interface->cache.hits - hits,
+	         interface->cache.misses - misses);
 }
 
 void interface_update(struct interface *interface)
@@ -440,6 +462,7 @@ void interface_render(struct interface *interface)
 {
 	gfx_bind_render_target(g_wow->device, NULL);
 	MAT4_ORTHO(float, interface->mat, 0.f, interface->width, interface->height, 0.f, -2.f, 2.f);
+	interface_batch_begin(&interface->batch);
 	interface_lock(interface);
 	for (size_t i = 0; i < sizeof(interface->root_frames) / sizeof(*interface->root_frames); ++i)
 	{
@@ -452,6 +475,7 @@ void interface_render(struct interface *interface)
 			ui_object_render((struct ui_object*)frame);
 		}
 	}
+	interface_batch_flush(&interface->batch);
 	interface_unlock(interface);
 }
 
@@ -647,37 +671,33 @@ void interface_set_cursor(struct interface *interface, enum cursor_type cursor)
 
 bool interface_load_xml(struct interface *interface, struct addon *addon, const char *filename, const char *data, size_t len)
 {
-	xmlDoc *doc = xmlReadMemory(data, len, NULL, "utf8", 0);
-	if (!doc)
-	{
-		LOG_ERROR("xmlReadMemory failed");
+	struct interface_cache_blob blob;
+	struct xml_document document;
+	if (!interface_cache_get_xml(&interface->cache, data, len, &blob))
 		return false;
-	}
-	xmlNode *root = xmlDocGetRootElement(doc);
-	if (!root)
+	if (!xml_document_load(&document, blob.data, blob.size))
 	{
-		xmlFreeDoc(doc);
-		LOG_ERROR("no root node");
+		interface_cache_release(&blob);
+		LOG_ERROR("failed to load xml document");
 		return false;
 	}
-	if (root->type != XML_ELEMENT_NODE)
+	struct xml_node node;
+	xml_node_parse(&node, &document, document.header->root);
+	if (node.type != XML_NODE_ELEMENT)
 	{
-		xmlFreeDoc(doc);
-		LOG_ERROR("root node is not XML_ELEMENT_NODE");
+		interface_cache_release(&blob);
+		LOG_ERROR("root node is not an element");
 		return false;
 	}
-	if (strcmp((const char*)root->name, "Ui"))
+	if (strcmp(node.name, "Ui"))
 	{
-		xmlFreeDoc(doc);
+		interface_cache_release(&blob);
 		LOG_ERROR("root node not <Ui>");
 		return false;
 	}
 	struct xml_ui *ui = xml_ui_new(addon, filename);
-	struct xml_node node;
-	xml_node_parse(&node, root);
 	xml_element_parse((struct xml_element*)ui, &node);
-	xmlFreeDoc(doc);
-	xmlCleanupParser();
+	interface_cache_release(&blob);
 	if (!jks_array_push_back(&interface->xml_ui, &ui))
 	{
 		xml_element_delete((struct xml_element*)ui);
@@ -713,7 +733,12 @@ bool interface_load_lua(struct interface *interface, const char *data, size_t le
 		tmp[1] = '\\';
 		tmp[2] = '"';
 	}
-	script = lua_script_new(interface->L, text, source);
+	if (!interface_cache_load_lua(&interface->cache, interface->L, text, strlen(text), source))
+	{
+		LOG_ERROR("failed to load lua script");
+		goto err;
+	}
+	script = lua_script_new_ref(interface->L, luaL_ref(interface->L, LUA_REGISTRYINDEX));
 	if (!script)
 	{
 		LOG_ERROR("failed to create lua script");
@@ -786,25 +811,18 @@ struct interface_font *interface_ref_render_font(struct interface *interface, co
 	struct interface_font new_font;
 	refcount_init(&new_font.refcount, 1);
 	new_font.size = size;
-	new_font.atlas = font_atlas_new();
+	new_font.atlas = interface->atlas.atlas;
 	new_font.model = font_model;
-	if (!new_font.atlas)
-	{
-		LOG_ERROR("font atlas creation failed");
-		return NULL;
-	}
 	new_font.font = font_new(font_model->model, size, 0, new_font.atlas);
 	if (!new_font.font)
 	{
 		LOG_ERROR("font creation failed");
-		font_atlas_delete(new_font.atlas);
 		return NULL;
 	}
 	new_font.outline_thick = font_new(font_model->model, size, 64, new_font.atlas);
 	if (!new_font.outline_thick)
 	{
 		LOG_ERROR("thick outline font creation failed");
-		font_atlas_delete(new_font.atlas);
 		font_free(new_font.font);
 		return NULL;
 	}
@@ -812,7 +830,6 @@ struct interface_font *interface_ref_render_font(struct interface *interface, co
 	if (!new_font.outline_normal)
 	{
 		LOG_ERROR("normal outline font creation failed");
-		font_atlas_delete(new_font.atlas);
 		font_free(new_font.font);
 		font_free(new_font.outline_thick);
 		return NULL;
@@ -821,7 +838,6 @@ struct interface_font *interface_ref_render_font(struct interface *interface, co
 	if (!font)
 	{
 		LOG_ERROR("can't add font to hmap");
-		font_atlas_delete(new_font.atlas);
 		font_free(new_font.font);
 		font_free(new_font.outline_thick);
 		font_free(new_font.outline_normal);
@@ -1,6 +1,9 @@
 #ifndef UI_INTERFACE_H
 #define UI_INTERFACE_H
 
+#include "itf/atlas.h"
+#include "itf/batch.h"
+#include "itf/precompile.h"
 #include "itf/enum.h"
 
 #include <jks/array.h>
@@ -59,6 +62,9 @@ struct interface
 	struct jks_hmap fonts; /* char*, ui_font_t* */
 	gfx_attributes_state_t attributes_state;
 	gfx_depth_stencil_state_t depth_stencil_state;
+	struct interface_atlas atlas;
+	struct interface_batch batch;
+	struct interface_cache cache;
 	struct lua_script *error_script;
 	lua_State *L;
 	struct ui_edit_box *active_input;
@@ -0,0 +1,342 @@
+#include "itf/precompile.h"
+
+#include "xml/document.h"
+
+#include "wow_lua.h"
+#include "memory.h"
+#include "log.h"
+#include "wow.h"
+
+#include <jkssl/evp.h>
+
+#include <sys/stat.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifdef _WIN32
+# include <direct.h>
+# define mkdir(path, mode) _mkdir(path)
+#else
+# include <sys/mman.h>
+# include <unistd.h>
+# include <fcntl.h>
+#endif
+
+#define CACHE_MAGIC   0x43495757 /* WWIC */
+#define CACHE_VERSION 1
+
+#define HASH_SIZE 20
+
+MEMORY_DECL(UI);
+
+enum entry_type
+{
+	ENTRY_XML,
+	ENTRY_LUA,
+};
+
+struct entry_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t type;
+	uint32_t source_size;
+	uint8_t source_hash[HASH_SIZE];
+	uint32_t data_size;
+};
+
+static bool make_dir(const char *path)
+{
+	if (!mkdir(path, 0755))
+		return true;
+	return errno == EEXIST;
+}
+
+void interface_cache_init(struct interface_cache *cache, bool enabled)
+{
+	cache->path = NULL;
+	cache->enabled = false;
+	cache->hits = 0;
+	cache->misses = 0;
+	if (!enabled)
+		return;
+	char path[512];
+	snprintf(path, sizeof(path), "%s/Cache", g_wow->game_path);
+	if (!make_dir(path))
+	{
+		LOG_WARN("failed to create %s, interface cache disabled", path);
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/Cache/Interface", g_wow->game_path);
+	if (!make_dir(path))
+	{
+		LOG_WARN("failed to create %s, interface cache disabled", path);
+		return;
+	}
+	cache->path = mem_strdup(MEM_UI, path);
+	if (!cache->path)
+	{
+		LOG_ERROR("failed to duplicate interface cache path");
+		return;
+	}
+	cache->enabled = true;
+}
+
+void interface_cache_destroy(struct interface_cache *cache)
+{
+	mem_free(MEM_UI, cache->path);
+}
+
+static bool hash(const char *data, size_t len, const char *name, uint8_t *md)
+{
+	struct evp_md_ctx *ctx = evp_md_ctx_new();
+	if (!ctx)
+		return false;
+	bool ret = evp_digest_init(ctx, evp_sha1())
+	        && evp_digest_update(ctx, (const uint8_t*)data, len)
+	        && (!name || evp_digest_update(ctx, (const uint8_t*)name, strlen(name) + 1))
+	        && evp_digest_final(ctx, md);
+	evp_md_ctx_free(ctx);
+	return ret;
+}
+
+static void get_path(struct interface_cache *cache, const uint8_t *md, enum entry_type type, char *path, size_t size)
+{
+	static const char hex[] = "0123456789abcdef";
+	char name[HASH_SIZE * 2 + 1];
+	for (size_t i = 0; i < HASH_SIZE; ++i)
+	{
+		name[i * 2 + 0] = hex[md[i] >> 4];
+		name[i * 2 + 1] = hex[md[i] & 0xF];
+	}
+	name[HASH_SIZE * 2] = '\0';
+	snprintf(path, size, "%s/%s.%s", cache->path, name, type == ENTRY_XML ? "xmlc" : "luac");
+}
+
+static void blob_init(struct interface_cache_blob *blob)
+{
+	blob->data = NULL;
+	blob->size = 0;
+	blob->map = NULL;
+	blob->map_size = 0;
+	jks_array_init(&blob->buffer, sizeof(uint8_t), NULL, &jks_array_memory_fn_UI);
+}
+
+#ifdef _WIN32
+
+static bool map_entry(const char *path, struct interface_cache_blob *blob)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	bool ret = false;
+	if (fseek(fp, 0, SEEK_END))
+		goto end;
+	long size = ftell(fp);
+	if (size <= 0 || fseek(fp, 0, SEEK_SET))
+		goto end;
+	blob->map = mem_malloc(MEM_UI, size);
+	if (!blob->map)
+		goto end;
+	if (fread(blob->map, 1, size, fp) != (size_t)size)
+	{
+		mem_free(MEM_UI, blob->map);
+		blob->map = NULL;
+		goto end;
+	}
+	blob->map_size = size;
+	ret = true;
+
+end:
+	fclose(fp);
+	return ret;
+}
+
+static void unmap_entry(struct interface_cache_blob *blob)
+{
+	mem_free(MEM_UI, blob->map);
+	blob->map = NULL;
+}
+
+#else
+
+static bool map_entry(const char *path, struct interface_cache_blob *blob)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	blob->map = map;
+	blob->map_size = st.st_size;
+	return true;
+}
+
+static void unmap_entry(struct interface_cache_blob *blob)
+{
+	munmap(blob->map, blob->map_size);
+	blob->map = NULL;
+}
+
+#endif
+
+static const struct entry_header *get_entry(struct interface_cache_blob *blob, enum entry_type type, size_t source_size, const uint8_t *md)
+{
+	const struct entry_header *header = blob->map;
+	if (blob->map_size < sizeof(*header)
+	 || header->magic != CACHE_MAGIC
+	 || header->version != CACHE_VERSION
+	 || header->type != type
+	 || header->source_size != source_size
+	 || memcmp(header->source_hash, md, HASH_SIZE)
+	 || header->data_size > blob->map_size - sizeof(*header))
+		return NULL;
+	return header;
+}
+
+static void write_entry(const char *path, enum entry_type type, size_t source_size, const uint8_t *md, const void *data, size_t size)
+{
+	char tmp_path[512];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	FILE *fp = fopen(tmp_path, "wb");
+	if (!fp)
+	{
+		LOG_WARN("failed to open %s", tmp_path);
+		return;
+	}
+	struct entry_header header;
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.type = type;
+	header.source_size = source_size;
+	memcpy(header.source_hash, md, HASH_SIZE);
+	header.data_size = size;
+	if (fwrite(&header, 1, sizeof(header), fp) != sizeof(header)
+	 || fwrite(data, 1, size, fp) != size)
+	{
+		LOG_WARN("failed to write %s", tmp_path);
+		fclose(fp);
+		remove(tmp_path);
+		return;
+	}
+	fclose(fp);
+	if (rename(tmp_path, path) == -1)
+	{
+		LOG_WARN("failed to rename %s", tmp_path);
+		remove(tmp_path);
+	}
+}
+
+bool interface_cache_get_xml(struct interface_cache *cache, const char *data, size_t len, struct interface_cache_blob *blob)
+{
+	uint8_t md[HASH_SIZE];
+	char path[512];
+	blob_init(blob);
+	bool cached = cache->enabled && hash(data, len, NULL, md);
+	if (cached)
+	{
+		get_path(cache, md, ENTRY_XML, path, sizeof(path));
+		if (map_entry(path, blob))
+		{
+			const struct entry_header *header = get_entry(blob, ENTRY_XML, len, md);
+			if (header)
+			{
+				blob->data = &header[1];
+				blob->size = header->data_size;
+				cache->hits++;
+				return true;
+			}
+			LOG_WARN("invalid interface cache entry %s", path);
+			unmap_entry(blob);
+		}
+		cache->misses++;
+	}
+	if (!xml_document_build(&blob->buffer, data, len))
+	{
+		jks_array_destroy(&blob->buffer);
+		return false;
+	}
+	blob->data = blob->buffer.data;
+	blob->size = blob->buffer.size;
+	if (cached)
+		write_entry(path, ENTRY_XML, len, md, blob->data, blob->size);
+	return true;
+}
+
+void interface_cache_release(struct interface_cache_blob *blob)
+{
+	if (blob->map)
+		unmap_entry(blob);
+	jks_array_destroy(&blob->buffer);
+}
+
+static int dump_writer(lua_State *L, const void *data, size_t size, void *userdata)
+{
+	(void)L;
+	struct jks_array *bytecode = userdata;
+	uint8_t *dst = jks_array_grow(bytecode, size);
+	if (!dst)
+		return 1;
+	memcpy(dst, data, size);
+	return 0;
+}
+
+static bool load_source(lua_State *L, const char *data, size_t len, const char *name)
+{
+	if (luaL_loadbuffer(L, data, len, name))
+	{
+		const char *err = lua_tostring(L, -1);
+		LOG_ERROR("lua error: %s", err ? err : "(null)");
+		lua_pop(L, 1);
+		return false;
+	}
+	return true;
+}
+
+bool interface_cache_load_lua(struct interface_cache *cache, lua_State *L, const char *data, size_t len, const char *name)
+{
+	uint8_t md[HASH_SIZE];
+	char path[512];
+	if (len >= 3 && !strncmp(data, "\xef\xbb\xbf", 3))
+	{
+		data += 3;
+		len -= 3;
+	}
+	if (!cache->enabled || !hash(data, len, name, md))
+		return load_source(L, data, len, name);
+	get_path(cache, md, ENTRY_LUA, path, sizeof(path));
+	struct interface_cache_blob blob;
+	blob_init(&blob);
+	if (map_entry(path, &blob))
+	{
+		const struct entry_header *header = get_entry(&blob, ENTRY_LUA, len, md);
+		if (header && !luaL_loadbuffer(L, (const char*)&header[1], header->data_size, name))
+		{
+			interface_cache_release(&blob);
+			cache->hits++;
+			return true;
+		}
+		if (header)
+			lua_pop(L, 1);
+		LOG_WARN("invalid interface cache entry %s", path);
+		interface_cache_release(&blob);
+	}
+	cache->misses++;
+	if (!load_source(L, data, len, name))
+		return false;
+	blob_init(&blob);
+	if (!lua_dump(L, dump_writer, &blob.buffer))
+		write_entry(path, ENTRY_LUA, len, md, blob.buffer.data, blob.buffer.size);
+	jks_array_destroy(&blob.buffer);
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef UI_PRECOMPILE_H
+#define UI_PRECOMPILE_H
+
+#include <jks/array.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct lua_State lua_State;
+
+/*
+ * on-disk cache of the interface files, stored in Cache/Interface
+ *
+ * xml files are kept as compact xml documents (see xml/document.h) that are
+ * mapped back instead of being parsed, lua files are kept as bytecode
+ *
+ * entries are named after the sha1 of the source content, so a file changed
+ * in a mpq or an addon simply hashes to another entry, the source hash is
+ * also stored in the entry header and checked when loading it
+ */
+
+struct interface_cache_blob
+{
+	const void *data;
+	size_t size;
+	void *map; /* cache entry mapping */
+	size_t map_size;
+	struct jks_array buffer; /* uint8_t, built when not in the cache */
+};
+
+struct interface_cache
+{
+	char *path;
+	bool enabled;
+	uint32_t hits;
+	uint32_t misses;
+};
+
+void interface_cache_init(struct interface_cache *cache, bool enabled);
+void interface_cache_destroy(struct interface_cache *cache);
+bool interface_cache_get_xml(struct interface_cache *cache, const char *data, size_t len, struct interface_cache_blob *blob);
+void interface_cache_release(struct interface_cache_blob *blob);
+bool interface_cache_load_lua(struct interface_cache *cache, lua_State *L, const char *data, size_t len, const char *name); /* pushes the chunk function on success */
+
+#endif
@@ -73,6 +73,8 @@ struct loader
 	pthread_cond_t cull_end_condition;
 	TAILQ_HEAD(, loader_object) objects_to_init[LOADER_LAST];
 	pthread_mutex_t objects_to_init_mutexes[LOADER_LAST];
+	struct mem_pool tasks_pool; /* struct async_task */
+	struct mem_pool objects_pool; /* struct loader_object */
 	size_t cull_ended;
 	size_t cull_ready;
 	bool running;
@@ -128,7 +130,7 @@ static void *loader_run(void *data)
 		if (task)
 		{
 			task->fn(worker->mpq_compound, task->userdata);
-			mem_free(MEM_GENERIC, task);
+			mem_pool_put(&loader->tasks_pool, task);
 		}
 		else
 		{
@@ -262,6 +264,8 @@ struct loader *loader_new(void)
 	loader->cull_ready = 0;
 	loader->cull_ended = CULL_THREADS;
 	loader->running = true;
+	mem_pool_init(&loader->tasks_pool, MEM_GENERIC, sizeof(struct async_task), 256, NULL, NULL);
+	mem_pool_init(&loader->objects_pool, MEM_GENERIC, sizeof(struct loader_object), 256, NULL, NULL);
 	jks_array_init(&loader->cull_threads, sizeof(pthread_t), NULL, &jks_array_memory_fn_GENERIC);
 	for (size_t i = 0; i < LOADER_LAST; ++i)
 	{
@@ -357,7 +361,7 @@ void loader_delete(struct loader *loader)
 		while ((object = TAILQ_FIRST(&loader->objects_to_init[i])))
 		{
 			TAILQ_REMOVE(&loader->objects_to_init[i], object, chain);
-			mem_free(MEM_GENERIC, object);
+			mem_pool_put(&loader->objects_pool, object);
 		}
 		pthread_mutex_destroy(&loader->objects_to_init_mutexes[i]);
 	}
@@ -367,10 +371,12 @@ void loader_delete(struct loader *loader)
 		while ((task = TAILQ_FIRST(&loader->tasks[i])))
 		{
 			TAILQ_REMOVE(&loader->tasks[i], task, chain);
-			mem_free(MEM_GENERIC, task);
+			mem_pool_put(&loader->tasks_pool, task);
 		}
 		pthread_mutex_destroy(&loader->tasks_mutexes[i]);
 	}
+	mem_pool_destroy(&loader->tasks_pool);
+	mem_pool_destroy(&loader->objects_pool);
 	mem_free(MEM_GENERIC, loader);
 }
 
@@ -410,6 +416,7 @@ static void do_init(struct loader *loader)
 				pthread_mutex_lock(&loader->objects_to_init_mutexes[i]);
 				TAILQ_REMOVE(&loader->objects_to_init[i], object, chain);
 				pthread_mutex_unlock(&loader->objects_to_init_mutexes[i]);
+				mem_pool_put(&loader->objects_pool, object);
 			}
 			tmp = nanotime();
 			if (tmp - started < INIT_MIN_DURATION)
@@ -427,7 +434,7 @@ static void do_init(struct loader *loader)
 void loader_push(struct loader *loader, enum async_task_type type, loader_load_fn_t fn, void *data)
 {
 	assert(loader->running);
-	struct async_task *task = mem_malloc(MEM_GENERIC, sizeof(*task));
+	struct async_task *task = mem_pool_get(&loader->tasks_pool);
 	if (!task)
 	{
 		LOG_ERROR("failed to add task to queue");
@@ -448,7 +455,7 @@ void loader_tick(struct loader *loader)
 
 void loader_init_object(struct loader *loader, enum loader_object_type type, loader_init_fn_t fn, void *userdata)
 {
-	struct loader_object *object = mem_malloc(MEM_GENERIC, sizeof(*object));
+	struct loader_object *object = mem_pool_get(&loader->objects_pool);
 	if (!object)
 	{
 		LOG_ERROR("failed to add object to init buffer");
@@ -46,6 +46,17 @@
 #include <math.h>
 
 MEMORY_DECL(GENERIC);
+MEMORY_DECL(MAP);
+
+static void collision_triangles_ctor(void *ptr)
+{
+	jks_array_init(ptr, sizeof(struct collision_triangle), NULL, &jks_array_memory_fn_MAP);
+}
+
+static void collision_triangles_dtor(void *ptr)
+{
+	jks_array_destroy(ptr);
+}
 
 struct map *map_new(void)
 {
@@ -56,6 +67,7 @@ struct map *map_new(void)
 	map->fog_divisor = 1300;
 	map->minimap.texture = GFX_TEXTURE_INIT();
 	pthread_mutex_init(&map->minimap.mutex, NULL);
+	mem_pool_init(&map->collision_triangles, MEM_MAP, sizeof(struct jks_array), 8, collision_triangles_ctor, collision_triangles_dtor);
 	return map;
 }
 
@@ -74,6 +86,7 @@ void map_delete(struct map *map)
 	gx_taxi_delete(map->gx_taxi);
 #endif
 	pthread_mutex_destroy(&map->minimap.mutex);
+	mem_pool_destroy(&map->collision_triangles);
 	mem_free(MEM_MAP, map);
 }
 
@@ -119,9 +132,29 @@ static void map_load_tick(struct map *map, struct gx_frame *frame)
 	adt_start_z = (adt_start_z < 0 ? 0 : (adt_start_z > 63 ? 63 : adt_start_z));
 	adt_end_x = (adt_end_x < 0 ? 0 : (adt_end_x > 63 ? 63 : adt_end_x));
 	adt_end_z = (adt_end_z < 0 ? 0 : (adt_end_z > 63 ? 63 : adt_end_z));
-	for (int32_t z = adt_start_z; z <= adt_end_z; ++z)
+	/* prefetch one more tile row in the movement direction so its assets
+	 * are (mostly) resident by the time it enters the view distance;
+	 * big deltas are teleports or the first tick and get no prefetch
+	 */
+	int32_t load_start_x = adt_start_x;
+	int32_t load_start_z = adt_start_z;
+	int32_t load_end_x = adt_end_x;
+	int32_t load_end_z = adt_end_z;
+	float moved = sqrtf(delta.x * delta.x + delta.z * delta.z);
+	if (moved < 16 * CHUNK_WIDTH)
 	{
-		for (int32_t x = adt_start_x; x <= adt_end_x; ++x)
+		if (delta.z > moved * 0.38f && load_end_x < 63)
+			load_end_x++;
+		else if (delta.z < -moved * 0.38f && load_start_x > 0)
+			load_start_x--;
+		if (delta.x > moved * 0.38f && load_start_z > 0)
+			load_start_z--;
+		else if (delta.x < -moved * 0.38f && load_end_z < 63)
+			load_end_z++;
+	}
+	for (int32_t z = load_start_z; z <= load_end_z; ++z)
+	{
+		for (int32_t x = load_start_x; x <= load_end_x; ++x)
 		{
 			if (!load_tile(map, x, z))
 				LOG_ERROR("failed load adt %" PRId32 "x%" PRId32, x, z);
@@ -707,6 +740,27 @@ static void cull_wdl(struct map *map, struct gx_frame *frame)
 	PERFORMANCE_END(WDL_CULL);
 }
 
+/* every cull thread helps building the occlusion buffer from the terrain
+ * of the loaded tiles, and waits for it to be complete before testing
+ * anything against it
+ */
+static void cull_occluders(struct map *map, struct gx_frame *frame)
+{
+	PERFORMANCE_BEGIN(OCCLUSION_CULL);
+	gx_occlusion_begin(&frame->occlusion, &frame->cull_vp, map->tiles_nb);
+	uint32_t job;
+	while (gx_occlusion_next_job(&frame->occlusion, &job))
+	{
+		if (job >= map->tiles_nb)
+			continue;
+		struct map_tile *tile = map->tile_array[map->tiles[job]];
+		if (tile)
+			map_tile_add_occluders(tile, frame);
+	}
+	gx_occlusion_end(&frame->occlusion);
+	PERFORMANCE_END(OCCLUSION_CULL);
+}
+
 static void cull_tiles(struct map *map, struct gx_frame *frame)
 {
 	PERFORMANCE_BEGIN(ADT_CULL);
@@ -721,6 +775,8 @@ void map_cull(struct map *map, struct gx_frame *frame)
 		map_load_tick(map, frame);
 	if (!map_flag_set(map, MAP_FLAG_WDL_CULLED))
 		cull_wdl(map, frame);
+	if (g_wow->gx->opt & GX_OPT_OCCLUSION)
+		cull_occluders(map, frame);
 	if (map->wmo && !map_flag_set(map, MAP_FLAG_WMO_CULLED))
 		gx_wmo_instance_add_to_render(map->wmo, frame, true);
 	cull_tiles(map, frame);
@@ -993,13 +1049,32 @@ map_render(struct map *map, struct gx_frame *frame)
 	}
 }
 
-void map_collect_collision_triangles(struct map *map, const struct collision_params *params, struct jks_array *triangles)
+bool map_cast(struct map *map, const struct phys_query *query, struct phys_hit *hit)
+{
+	struct collision_state state;
+	bool found = false;
+	state.visited_nb = 0;
+	for (size_t i = 0; i < map->tiles_nb; ++i)
+		found |= map_tile_cast(map->tile_array[map->tiles[i]], query, &state, hit);
+	return found;
+}
+
+void map_collect_collision_triangles(struct map *map, const struct phys_query *query, struct jks_array *triangles)
 {
 	struct collision_state state;
-	jks_array_init(&state.wmo, sizeof(struct gx_wmo_instance*), NULL, &jks_array_memory_fn_GENERIC);
-	jks_array_init(&state.m2, sizeof(struct gx_m2_instance*), NULL, &jks_array_memory_fn_GENERIC);
+	state.visited_nb = 0;
 	for (size_t i = 0; i < map->tiles_nb; ++i)
-		map_tile_collect_collision_triangles(map->tile_array[map->tiles[i]], params, &state, triangles);
-	jks_array_destroy(&state.wmo);
-	jks_array_destroy(&state.m2);
+		map_tile_collect_collision_triangles(map->tile_array[map->tiles[i]], query, &state, triangles);
+}
+
+/* the arrays keep their capacity between physics steps */
+struct jks_array *map_collision_triangles_get(struct map *map)
+{
+	return mem_pool_get(&map->collision_triangles);
+}
+
+void map_collision_triangles_put(struct map *map, struct jks_array *triangles)
+{
+	jks_array_resize(triangles, 0);
+	mem_pool_put(&map->collision_triangles, triangles);
 }
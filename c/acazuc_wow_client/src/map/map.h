@@ -1,6 +1,8 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include "memory.h"
+
 #include <gfx/objects.h>
 
 #include <jks/array.h>
@@ -12,8 +14,10 @@
 #include <stdbool.h>
 #include <pthread.h>
 
+struct phys_query;
 struct taxi_node;
 struct gx_skybox;
+struct phys_hit;
 struct gx_frame;
 struct gx_taxi;
 struct gx_wdl;
@@ -99,27 +103,23 @@ struct map
 	float last_view_distance;
 	struct worldmap worldmap;
 	struct taxi_info taxi;
+	struct mem_pool collision_triangles; /* struct jks_array of struct collision_triangle */
 	enum map_flag flags;
 };
 
-struct collision_params
-{
-	struct aabb aabb;
-	struct vec3f center;
-	float radius;
-	bool wmo_cam;
-};
-
 struct collision_triangle
 {
 	struct vec3f points[3];
 	bool touched;
 };
 
+#define COLLISION_STATE_VISITED 64
+
+/* instances already queried, the next ones are queried again when it is full */
 struct collision_state
 {
-	struct jks_array wmo;
-	struct jks_array m2;
+	const void *visited[COLLISION_STATE_VISITED];
+	size_t visited_nb;
 };
 
 static inline bool map_flag_get(struct map *map, enum map_flag flag)
@@ -143,6 +143,9 @@ bool map_setid(struct map *map, uint32_t mapid);
 void map_cull(struct map *map, struct gx_frame *frame);
 void map_render(struct map *map, struct gx_frame *frame);
 void map_gen_taxi_path(struct map *map, uint32_t src, uint32_t dst);
-void map_collect_collision_triangles(struct map *map, const struct collision_params *param, struct jks_array *triangles);
+bool map_cast(struct map *map, const struct phys_query *query, struct phys_hit *hit);
+void map_collect_collision_triangles(struct map *map, const struct phys_query *query, struct jks_array *triangles);
+struct jks_array *map_collision_triangles_get(struct map *map);
+void map_collision_triangles_put(struct map *map, struct jks_array *triangles);
 
 #endif
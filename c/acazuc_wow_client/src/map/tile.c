@@ -9,6 +9,8 @@
 #include "map/tile.h"
 #include "map/map.h"
 
+#include "phys/physics.h"
+
 #include "performance.h"
 #include "loader.h"
 #include "memory.h"
@@ -18,7 +20,6 @@
 #include "wow.h"
 #include "dbc.h"
 
-#include <wow/wmo_group.h>
 #include <wow/adt.h>
 #include <wow/mpq.h>
 
@@ -99,6 +100,7 @@ map_tile_new(const char *filename, int32_t x, int32_t z)
 	gx_aabb_init(&tile->gx_aabb, (struct vec4f){1, 0.4, 0, 1}, 3);
 #endif
 	jks_array_init(&tile->ground_effects, sizeof(struct map_tile_ground_effect), tile_ground_effect_destroy, &jks_array_memory_fn_MAP);
+	phys_bvh_init(&tile->collision_bvh);
 	if (!tile->filename)
 		goto err;
 	return tile;
@@ -136,6 +138,7 @@ map_tile_unload_task(struct wow_mpq_compound *mpq_compound, void *userdata)
 	gx_aabb_destroy(&tile->gx_aabb);
 #endif
 	jks_array_destroy(&tile->ground_effects);
+	phys_bvh_destroy(&tile->collision_bvh);
 	mem_free(MEM_MAP, tile->filename);
 	mem_free(MEM_MAP, tile);
 }
@@ -316,6 +319,72 @@ load_wmo(struct map_tile *tile, struct wow_adt_file *file)
 	return true;
 }
 
+static void
+add_point(struct map_tile *tile,
+          struct map_chunk *chunk,
+          uint8_t chunk_id,
+          uint16_t idx,
+          struct vec3f *p)
+{
+	size_t y = idx % 17;
+	float z = idx / 17 * 2;
+	float x;
+	if (y < 9)
+	{
+		x = y * 2;
+	}
+	else
+	{
+		z++;
+		x = (y - 9) * 2 + 1;
+	}
+	p->x = tile->pos.x + (-1 - (ssize_t)(chunk_id / 16) + (16 - z) / 16.f) * CHUNK_WIDTH;
+	p->z = tile->pos.z + ((1 + (ssize_t)(chunk_id % 16) - (16 - x) / 16.f) * CHUNK_WIDTH);
+	p->y = chunk->height[idx];
+}
+
+/* four triangles per cell, around its inner vertex */
+static bool
+build_collision_bvh(struct map_tile *tile)
+{
+	struct vec3f *points = mem_malloc(MEM_PHYS, sizeof(*points) * CHUNKS_PER_TILE * 8 * 8 * 4 * 3);
+	if (!points)
+		return false;
+	size_t n = 0;
+	for (size_t i = 0; i < CHUNKS_PER_TILE; ++i)
+	{
+		struct map_chunk *chunk = &tile->chunks[i];
+		for (size_t z = 0; z < 8; ++z)
+		{
+			for (size_t x = 0; x < 8; ++x)
+			{
+				if (chunk->holes & (1 << (z / 2 * 4 + x / 2)))
+					continue;
+				uint16_t idx = 9 + z * 17 + x;
+				uint16_t p1 = idx - 9;
+				uint16_t p2 = idx - 8;
+				uint16_t p3 = idx + 9;
+				uint16_t p4 = idx + 8;
+				add_point(tile, chunk, i, p2, &points[n++]);
+				add_point(tile, chunk, i, p1, &points[n++]);
+				add_point(tile, chunk, i, idx, &points[n++]);
+				add_point(tile, chunk, i, p3, &points[n++]);
+				add_point(tile, chunk, i, p2, &points[n++]);
+				add_point(tile, chunk, i, idx, &points[n++]);
+				add_point(tile, chunk, i, p4, &points[n++]);
+				add_point(tile, chunk, i, p3, &points[n++]);
+				add_point(tile, chunk, i, idx, &points[n++]);
+				add_point(tile, chunk, i, p1, &points[n++]);
+				add_point(tile, chunk, i, p4, &points[n++]);
+				add_point(tile, chunk, i, idx, &points[n++]);
+			}
+		}
+	}
+	bool ret = phys_bvh_build(&tile->collision_bvh, points, NULL, n / 3);
+	mem_free(MEM_PHYS, points);
+	return ret;
+}
+
 static bool
 load(struct map_tile *tile, struct wow_adt_file *file)
 {
@@ -415,6 +484,11 @@ load(struct map_tile *tile, struct wow_adt_file *file)
 #ifdef WITH_DEBUG_RENDERING
 	gx_aabb_set_aabb(&tile->gx_aabb, &tile->aabb);
 #endif
+	if (!build_collision_bvh(tile))
+	{
+		LOG_ERROR("failed to build terrain collision bvh");
+		return false;
+	}
 	tile->gx_mcnk = gx_mcnk_new(tile, file);
 	if (!tile->gx_mcnk)
 	{
@@ -688,412 +762,289 @@ map_tile_cull(struct map_tile *tile, struct gx_frame *frame)
 		gx_mclq_cull(tile->gx_mclq, frame);
 }
 
-static void
-add_point(struct map_tile *tile,
-          struct map_chunk *chunk,
-          uint8_t chunk_id,
-          uint16_t idx,
-          struct vec3f *p)
+static float
+plane_height(const float *p0, const float *p1, const float *p2, float u, float v)
 {
-	size_t y = idx % 17;
-	float z = idx / 17 * 2;
-	float x;
-	if (y < 9)
-	{
-		x = y * 2;
-	}
+	float d = (p1[0] - p0[0]) * (p2[1] - p0[1]) - (p2[0] - p0[0]) * (p1[1] - p0[1]);
+	float l1 = ((u - p0[0]) * (p2[1] - p0[1]) - (p2[0] - p0[0]) * (v - p0[1])) / d;
+	float l2 = ((p1[0] - p0[0]) * (v - p0[1]) - (u - p0[0]) * (p1[1] - p0[1])) / d;
+	return p0[2] + l1 * (p1[2] - p0[2]) + l2 * (p2[2] - p0[2]);
+}
+
+/* terrain height under pos, false if pos is over a hole */
+static bool
+chunk_height(struct map_tile *tile,
+             struct map_chunk *chunk,
+             uint8_t chunk_id,
+             const struct vec3f *pos,
+             float *height)
+{
+	float fr = ((tile->pos.x - pos->x) / CHUNK_WIDTH - chunk_id / 16) * 8;
+	float fc = ((pos->z - tile->pos.z) / CHUNK_WIDTH - chunk_id % 16) * 8;
+	int r = fr < 0 ? 0 : (fr >= 8 ? 7 : (int)fr);
+	int c = fc < 0 ? 0 : (fc >= 8 ? 7 : (int)fc);
+	if (chunk->holes & (1 << (r / 2 * 4 + c / 2)))
+		return false;
+	float u = fc - c;
+	float v = fr - r;
+	uint16_t idx = 9 + r * 17 + c;
+	/* the cell is a fan of 4 triangles around its inner vertex */
+	float center[3] = {0.5f, 0.5f, chunk->height[idx]};
+	float p1[3] = {0, 0, chunk->height[idx - 9]};
+	float p2[3] = {1, 0, chunk->height[idx - 8]};
+	float p3[3] = {1, 1, chunk->height[idx + 9]};
+	float p4[3] = {0, 1, chunk->height[idx + 8]};
+	float du = u - 0.5f;
+	float dv = v - 0.5f;
+	if (dv <= -fabsf(du))
+		*height = plane_height(p1, p2, center, u, v);
+	else if (du >= fabsf(dv))
+		*height = plane_height(p2, p3, center, u, v);
+	else if (dv >= fabsf(du))
+		*height = plane_height(p3, p4, center, u, v);
 	else
-	{
-		z++;
-		x = (y - 9) * 2 + 1;
-	}
-	p->x = tile->pos.x + (-1 - (ssize_t)(chunk_id / 16) + (16 - z) / 16.f) * CHUNK_WIDTH;
-	p->z = tile->pos.z + ((1 + (ssize_t)(chunk_id % 16) - (16 - x) / 16.f) * CHUNK_WIDTH);
-	p->y = chunk->height[idx];
+		*height = plane_height(p4, p1, center, u, v);
+	return true;
 }
 
+/*
+ * the occluder of a chunk is a 4x4 grid matching the holes granularity;
+ * each corner takes the lowest height of the blocks around it, which keeps
+ * the coarse surface under the real terrain
+ */
 static void
-add_chunk(struct map_tile *tile,
-          struct map_chunk *chunk,
-          uint8_t chunk_id,
-          const struct collision_params *params,
-          struct jks_array *triangles)
+add_chunk_occluders(struct map_tile *tile,
+                    struct map_chunk *chunk,
+                    uint8_t chunk_id,
+                    struct gx_occlusion *occlusion)
 {
-	float xmin = tile->pos.x - (1 + (ssize_t)(chunk_id / 16)) * CHUNK_WIDTH;
-	ssize_t z_end = floorf((params->aabb.p0.x - xmin) / (CHUNK_WIDTH / 8));
-	z_end = 8 - z_end;
-	if (z_end > 8)
-		z_end = 8;
-	else if (z_end < 8)
-		z_end++;
-	ssize_t z_start = ceilf((params->aabb.p1.x - xmin) / (CHUNK_WIDTH / 8));
-	z_start = 8 - z_start;
-	if (z_start < 0)
-		z_start = 0;
-	else if (z_start > 0)
-		z_start--;
-	if (z_start >= z_end)
-		return;
-	float zmin = tile->pos.z + (chunk_id % 16) * CHUNK_WIDTH;
-	ssize_t x_end = ceilf((params->aabb.p1.z - zmin) / (CHUNK_WIDTH / 8));
-	if (x_end > 8)
-		x_end = 8;
-	else if (x_end < 8)
-		x_end++;
-	ssize_t x_start = floorf((params->aabb.p0.z - zmin) / (CHUNK_WIDTH / 8));
-	if (x_start < 0)
-		x_start = 0;
-	else if (x_start > 0)
-		x_start--;
-	if (x_start >= x_end)
-		return;
-	size_t triangles_nb = triangles->size;
-	struct collision_triangle *tmp = jks_array_grow(triangles, (z_end - z_start) * (x_end - x_start) * 4);
-	if (!tmp)
+	float blocks[4][4];
+	float corners[5][5];
+	struct vec3f points[4 * 4 * 6];
+	size_t n = 0;
+
+	for (size_t bz = 0; bz < 4; ++bz)
 	{
-		LOG_ERROR("triangles allocation failed");
-		return;
+		for (size_t bx = 0; bx < 4; ++bx)
+		{
+			float height = INFINITY;
+			for (size_t z = bz * 2; z <= bz * 2 + 2; ++z)
+			{
+				for (size_t x = bx * 2; x <= bx * 2 + 2; ++x)
+					height = fminf(height, chunk->height[z * 17 + x]);
+			}
+			for (size_t z = bz * 2; z < bz * 2 + 2; ++z)
+			{
+				for (size_t x = bx * 2; x < bx * 2 + 2; ++x)
+					height = fminf(height, chunk->height[9 + z * 17 + x]);
+			}
+			blocks[bz][bx] = height;
+		}
 	}
-	size_t n = 0;
-	for (ssize_t z = z_start; z < z_end; ++z)
+	for (size_t z = 0; z < 5; ++z)
 	{
-		for (ssize_t x = x_start; x < x_end; ++x)
+		for (size_t x = 0; x < 5; ++x)
 		{
-			if (chunk->holes & (1 << (z / 2 * 4 + x / 2)))
+			float height = INFINITY;
+			for (size_t bz = z ? z - 1 : 0; bz <= z && bz < 4; ++bz)
+			{
+				for (size_t bx = x ? x - 1 : 0; bx <= x && bx < 4; ++bx)
+					height = fminf(height, blocks[bz][bx]);
+			}
+			corners[z][x] = height;
+		}
+	}
+	for (size_t bz = 0; bz < 4; ++bz)
+	{
+		for (size_t bx = 0; bx < 4; ++bx)
+		{
+			if (chunk->holes & (1 << (bz * 4 + bx)))
 				continue;
-			n++;
-			uint16_t idx = 9 + z * 17 + x;
-			uint16_t p1 = idx - 9;
-			uint16_t p2 = idx - 8;
-			uint16_t p3 = idx + 9;
-			uint16_t p4 = idx + 8;
-			add_point(tile, chunk, chunk_id, p2, &tmp->points[0]);
-			add_point(tile, chunk, chunk_id, p1, &tmp->points[1]);
-			add_point(tile, chunk, chunk_id, idx, &tmp->points[2]);
-			tmp->touched = false;
-			tmp++;
-			add_point(tile, chunk, chunk_id, p3, &tmp->points[0]);
-			add_point(tile, chunk, chunk_id, p2, &tmp->points[1]);
-			add_point(tile, chunk, chunk_id, idx, &tmp->points[2]);
-			tmp->touched = false;
-			tmp++;
-			add_point(tile, chunk, chunk_id, p4, &tmp->points[0]);
-			add_point(tile, chunk, chunk_id, p3, &tmp->points[1]);
-			add_point(tile, chunk, chunk_id, idx, &tmp->points[2]);
-			tmp->touched = false;
-			tmp++;
-			add_point(tile, chunk, chunk_id, p1, &tmp->points[0]);
-			add_point(tile, chunk, chunk_id, p4, &tmp->points[1]);
-			add_point(tile, chunk, chunk_id, idx, &tmp->points[2]);
-			tmp->touched = false;
-			tmp++;
+			struct vec3f p[4];
+			static const uint8_t offsets[4][2] = {{0, 0}, {0, 1}, {1, 1}, {1, 0}};
+			for (size_t i = 0; i < 4; ++i)
+			{
+				size_t z = bz + offsets[i][0];
+				size_t x = bx + offsets[i][1];
+				add_point(tile, chunk, chunk_id, z * 2 * 17 + x * 2, &p[i]);
+				p[i].y = corners[z][x];
+			}
+			points[n++] = p[0];
+			points[n++] = p[1];
+			points[n++] = p[2];
+			points[n++] = p[0];
+			points[n++] = p[2];
+			points[n++] = p[3];
 		}
 	}
-	jks_array_resize(triangles, triangles_nb + n * 4);
+	gx_occlusion_add_triangles(occlusion, points, n / 3);
 }
 
-static void
-add_object_point(struct gx_m2_instance *m2, struct vec3f *point, uint16_t idx)
+void
+map_tile_add_occluders(struct map_tile *tile, struct gx_frame *frame)
 {
-	struct vec4f tmp;
-	VEC3_CPY(tmp, m2->parent->collision_vertexes[idx]);
-	tmp.w = 1;
-	struct vec4f out;
-	MAT4_VEC4_MUL(out, m2->m, tmp);
-	VEC3_CPY(*point, out);
-}
+	const struct vec3f *pos = &frame->cull_pos;
 
-static void
-add_object(struct gx_m2_instance *m2, struct jks_array *triangles)
-{
-	if (!m2->parent->collision_triangles_nb)
+	if (!(tile->flags & MAP_TILE_FLAG_INITIALIZED))
 		return;
-	struct collision_triangle *tmp = jks_array_grow(triangles, m2->parent->collision_triangles_nb / 3);
-	if (!tmp)
-	{
-		LOG_ERROR("triangles allocation failed");
+	bool camera_over = pos->x >= tile->aabb.p0.x && pos->x <= tile->aabb.p1.x
+	                && pos->z >= tile->aabb.p0.z && pos->z <= tile->aabb.p1.z;
+	if (!camera_over && !frustum_check_fast(&frame->frustum, &tile->aabb))
 		return;
-	}
-	for (size_t i = 0; i < m2->parent->collision_triangles_nb;)
-	{
-		add_object_point(m2, &tmp->points[0], m2->parent->collision_triangles[i++]);
-		add_object_point(m2, &tmp->points[1], m2->parent->collision_triangles[i++]);
-		add_object_point(m2, &tmp->points[2], m2->parent->collision_triangles[i++]);
-		tmp->touched = false;
-		tmp++;
-	}
-}
-
-static void
-add_objects(struct map_tile *tile,
-            struct map_chunk *chunk,
-            const struct collision_params *params,
-            struct collision_state *state,
-            struct jks_array *triangles)
-{
-	for (size_t i = 0; i < chunk->doodads_nb; ++i)
+	for (uint32_t i = 0; i < CHUNKS_PER_TILE; ++i)
 	{
-		struct map_m2 *m2 = tile->m2[chunk->doodads[i]];
-		if (!gx_m2_flag_get(m2->instance->parent, GX_M2_FLAG_LOADED))
-			continue;
-		bool m2_found = false;
-		for (size_t j = 0; j < state->m2.size; ++j)
+		struct map_chunk *chunk = &tile->chunks[i];
+		if (camera_over
+		 && pos->x >= chunk->aabb.p0.x && pos->x <= chunk->aabb.p1.x
+		 && pos->z >= chunk->aabb.p0.z && pos->z <= chunk->aabb.p1.z)
 		{
-			if (*JKS_ARRAY_GET(&state->m2, j, struct gx_m2_instance*) == m2->instance)
+			/* the terrain doesn't hide anything seen from below it
+			 * (caves, under a hole, ...)
+			 */
+			float height;
+			if (!chunk_height(tile, chunk, i, pos, &height))
+				height = chunk->aabb.p1.y;
+			if (pos->y < height)
 			{
-				m2_found = true;
-				break;
+				gx_occlusion_disable(&frame->occlusion);
+				return;
 			}
 		}
-		if (m2_found)
+		if (!frustum_check_fast(&frame->frustum, &chunk->aabb))
 			continue;
-		if (!jks_array_push_back(&state->m2, &m2->instance))
-			LOG_WARN("failed to add m2 to visited list");
-#if 0 /* doesn't work on some objects */
 		struct vec3f delta;
-		VEC3_SUB(delta, m2->instance->pos, params->center);
-		if (VEC3_NORM(delta) > m2->instance->parent->collision_sphere_radius * m2->instance->scale + params->radius)
+		VEC3_SUB(delta, chunk->center, *pos);
+		if (sqrtf(delta.x * delta.x + delta.z * delta.z) > frame->view_distance)
 			continue;
-#endif
-		if (!aabb_intersect_sphere(&m2->instance->caabb, params->center, params->radius)
-		 || !aabb_intersect_aabb(&m2->instance->caabb, &params->aabb))
-			continue;
-		add_object(m2->instance, triangles);
+		add_chunk_occluders(tile, chunk, i, &frame->occlusion);
 	}
 }
 
-static void
-add_wmo_point(struct gx_wmo_instance *wmo,
-              struct gx_wmo_group *group,
-              struct vec3f *point,
-              uint32_t indice)
-{
-	struct wow_vec3f *src = JKS_ARRAY_GET(&group->movt, *JKS_ARRAY_GET(&group->movi, indice, uint16_t), struct wow_vec3f);
-	struct vec4f tmp;
-	VEC3_CPY(tmp, *src);
-	tmp.w = 1;
-	struct vec4f out;
-	MAT4_VEC4_MUL(out, wmo->m, tmp);
-	VEC3_CPY(*point, out);
-}
-
-enum bsp_side
+/* a query either casts (hit) or collects the triangles (triangles) */
+struct collision_query
 {
-	BSP_POS = (1 << 0),
-	BSP_NEG = (1 << 1),
+	const struct phys_query *query;
+	struct collision_state *state;
+	struct phys_hit *hit;
+	struct jks_array *triangles;
+	bool found;
 };
 
-static enum bsp_side
-get_aabb_bsp_side(const struct aabb *aabb, const struct wow_mobn_node *node)
+static bool
+visit(struct collision_state *state, const void *instance)
 {
-	enum bsp_side side = 0;
-	uint8_t plane = node->flags & WOW_MOBN_NODE_FLAGS_AXIS_MASK;
-	if (((float*)&aabb->p0)[plane] <= node->plane_dist)
-		side |= BSP_NEG;
-	if (((float*)&aabb->p1)[plane] >= node->plane_dist)
-		side |= BSP_POS;
-	return side;
+	for (size_t i = 0; i < state->visited_nb; ++i)
+	{
+		if (state->visited[i] == instance)
+			return true;
+	}
+	if (state->visited_nb < COLLISION_STATE_VISITED)
+		state->visited[state->visited_nb++] = instance;
+	return false;
 }
 
 static void
-bsp_add_triangles(struct gx_wmo_instance *wmo,
-                  struct gx_wmo_group *group,
-                  const struct wow_mobn_node *node,
-                  const struct collision_params *params,
-                  struct jks_array *triangles,
-                  struct jks_array *triangles_tracker)
+collect_triangle(const struct vec3f *points, uint8_t flags, void *userdata)
 {
-	if (!node->faces_nb)
+	struct collision_query *cq = userdata;
+	if (flags & cq->query->ignore)
 		return;
-	struct collision_triangle *tmp = jks_array_grow(triangles, node->faces_nb);
-	if (!tmp)
+	struct collision_triangle *triangle = jks_array_grow(cq->triangles, 1);
+	if (!triangle)
 	{
 		LOG_ERROR("triangles allocation failed");
 		return;
 	}
-	size_t n = 0;
-	for (size_t i = 0; i < node->faces_nb; ++i)
+	memcpy(triangle->points, points, sizeof(triangle->points));
+	triangle->touched = false;
+}
+
+static void
+query_bvh(struct collision_query *cq,
+          const struct phys_bvh *bvh,
+          const struct mat4f *m,
+          const struct mat4f *m_inv)
+{
+	if (cq->hit)
 	{
-		assert(node->face_start + i < group->mobr.size);
-		uint32_t indice = *JKS_ARRAY_GET(&group->mobr, node->face_start + i, uint16_t);
-		uint8_t flags = JKS_ARRAY_GET(&group->mopy, indice, struct wow_mopy_data)->flags;
-		if (!((flags & WOW_MOPY_FLAGS_COLLISION) || ((flags & WOW_MOPY_FLAGS_RENDER) && !(flags & WOW_MOPY_FLAGS_DETAIL))))
-			continue;
-		if (params->wmo_cam && (flags & WOW_MOPY_FLAGS_NOCAMCOLLIDE))
-			continue;
-		bool triangle_found = false;
-		for (size_t j = 0; j < triangles_tracker->size; ++j)
-		{
-			if (*JKS_ARRAY_GET(triangles_tracker, j, uint32_t) == indice)
-			{
-				triangle_found = true;
-				break;
-			}
-		}
-		if (triangle_found)
-			continue;
-		if (!jks_array_push_back(triangles_tracker, &indice))
-			LOG_ERROR("failed to add triangle to triangles tracker");
-		indice *= 3;
-		add_wmo_point(wmo, group, &tmp->points[0], indice + 0);
-		add_wmo_point(wmo, group, &tmp->points[1], indice + 1);
-		add_wmo_point(wmo, group, &tmp->points[2], indice + 2);
-		tmp->touched = false;
-		tmp++;
-		n++;
+		if (m_inv)
+			cq->found |= phys_bvh_cast_instance(bvh, m_inv, cq->query, cq->hit);
+		else
+			cq->found |= phys_bvh_cast(bvh, cq->query, cq->hit);
+	}
+	else
+	{
+		if (m)
+			phys_bvh_query_aabb_instance(bvh, m, m_inv, &cq->query->aabb, collect_triangle, cq);
+		else
+			phys_bvh_query_aabb(bvh, &cq->query->aabb, collect_triangle, cq);
 	}
-	jks_array_resize(triangles, triangles->size - (node->faces_nb - n));
 }
 
 static void
-bsp_traverse(struct gx_wmo_instance *wmo,
-             struct gx_wmo_group *group,
-             const struct wow_mobn_node *node,
-             const struct aabb *aabb,
-             const struct collision_params *params,
-             struct jks_array *triangles,
-             struct jks_array *triangles_tracker)
+query_m2(struct collision_query *cq, struct gx_m2_instance *m2)
 {
-	if (node->flags & WOW_MOBN_NODE_FLAGS_LEAF)
-	{
-		bsp_add_triangles(wmo, group, node, params, triangles, triangles_tracker);
+	if (!gx_m2_flag_get(m2->parent, GX_M2_FLAG_LOADED))
 		return;
-	}
-	enum bsp_side side = get_aabb_bsp_side(aabb, node);
-	if ((side & BSP_POS) && node->pos_child != -1)
-		bsp_traverse(wmo, group, JKS_ARRAY_GET(&group->mobn, node->pos_child, struct wow_mobn_node), aabb, params, triangles, triangles_tracker);
-	if ((side & BSP_NEG) && node->neg_child != -1)
-		bsp_traverse(wmo, group, JKS_ARRAY_GET(&group->mobn, node->neg_child, struct wow_mobn_node), aabb, params, triangles, triangles_tracker);
+	if (visit(cq->state, m2))
+		return;
+	if (!aabb_intersect_aabb(&m2->caabb, &cq->query->aabb))
+		return;
+	query_bvh(cq, &m2->parent->collision_bvh, &m2->m, &m2->m_inv);
 }
 
 static void
-add_wmo_group(struct gx_wmo_instance *wmo,
-              struct gx_wmo_group *group,
-              const struct collision_params *params,
-              struct collision_state *state,
-              struct jks_array *triangles,
-              struct jks_array *triangles_tracker)
+query_wmo_group(struct collision_query *cq,
+                struct gx_wmo_instance *wmo,
+                struct gx_wmo_group *group)
 {
 	for (size_t i = 0; i < group->doodads.size; ++i)
 	{
 		uint16_t doodad = *JKS_ARRAY_GET(&group->doodads, i, uint16_t);
 		if (doodad < wmo->doodad_start || doodad >= wmo->doodad_end)
 			continue;
-		struct gx_m2_instance *m2 = *JKS_ARRAY_GET(&wmo->m2, doodad - wmo->doodad_start, struct gx_m2_instance*);
-		if (!gx_m2_flag_get(m2->parent, GX_M2_FLAG_LOADED))
-			continue;
-		bool m2_found = false;
-		for (size_t j = 0; j < state->m2.size; ++j)
-		{
-			if (*JKS_ARRAY_GET(&state->m2, j, struct gx_m2_instance*) == m2)
-			{
-				m2_found = true;
-				break;
-			}
-		}
-		if (m2_found)
-			continue;
-		if (!jks_array_push_back(&state->m2, &m2))
-			LOG_WARN("failed to add m2 to visited list");
-		if (!aabb_intersect_sphere(&m2->caabb, params->center, params->radius)
-		 || !aabb_intersect_aabb(&m2->caabb, &params->aabb))
-			continue;
-		add_object(m2, triangles);
-	}
-	if (group->mobn.size)
-	{
-		struct vec4f p0;
-		struct vec4f p1;
-		struct vec4f tmp0;
-		struct vec4f tmp1;
-		struct aabb aabb;
-		VEC3_CPY(p0, params->aabb.p0);
-		VEC3_CPY(p1, params->aabb.p1);
-		p0.w = 1;
-		p1.w = 1;
-		MAT4_VEC4_MUL(tmp0, wmo->m_inv, p0);
-		MAT4_VEC4_MUL(tmp1, wmo->m_inv, p1);
-		p0.x = tmp0.x;
-		p0.y = -tmp0.z;
-		p0.z = tmp0.y;
-		p1.x = tmp1.x;
-		p1.y = -tmp1.z;
-		p1.z = tmp1.y;
-		VEC3_MIN(aabb.p0, p0, p1);
-		VEC3_MAX(aabb.p1, p0, p1);
-		jks_array_resize(triangles_tracker, 0);
-		bsp_traverse(wmo, group, group->mobn.data, &aabb, params, triangles, triangles_tracker);
+		query_m2(cq, *JKS_ARRAY_GET(&wmo->m2, doodad - wmo->doodad_start, struct gx_m2_instance*));
 	}
+	query_bvh(cq, &group->collision_bvh, &wmo->m, &wmo->m_inv);
 }
 
 static void
-add_wmo(struct gx_wmo_instance *wmo,
-        const struct collision_params *params,
-        struct collision_state *state,
-        struct jks_array *triangles)
+query_wmo(struct collision_query *cq, struct gx_wmo_instance *wmo)
 {
-	struct jks_array triangles_tracker;
-	jks_array_init(&triangles_tracker, sizeof(uint32_t), NULL, NULL);
+	if (!gx_wmo_flag_get(wmo->parent, GX_WMO_FLAG_LOADED))
+		return;
+	if (visit(cq->state, wmo))
+		return;
+	if (!aabb_intersect_aabb(&wmo->aabb, &cq->query->aabb))
+		return;
 	for (size_t i = 0; i < wmo->groups.size; ++i)
 	{
 		struct gx_wmo_group *group = *JKS_ARRAY_GET(&wmo->parent->groups, i, struct gx_wmo_group*);
 		if (!gx_wmo_group_flag_get(group, GX_WMO_GROUP_FLAG_LOADED))
 			continue;
 		struct gx_wmo_group_instance *group_instance = JKS_ARRAY_GET(&wmo->groups, i, struct gx_wmo_group_instance);
-		if (!aabb_intersect_sphere(&group_instance->aabb, params->center, params->radius))
+		if (!aabb_intersect_aabb(&group_instance->aabb, &cq->query->aabb))
 			continue;
-		add_wmo_group(wmo, group, params, state, triangles, &triangles_tracker);
+		query_wmo_group(cq, wmo, group);
 	}
-	jks_array_destroy(&triangles_tracker);
 }
 
 static void
-add_wmos(struct map_tile *tile,
-         struct map_chunk *chunk,
-         const struct collision_params *params,
-         struct collision_state *state,
-         struct jks_array *triangles)
-{
-	for (size_t i = 0; i < chunk->wmos_nb; ++i)
-	{
-		struct map_wmo *wmo = tile->wmo[chunk->wmos[i]];
-		if (!gx_wmo_flag_get(wmo->instance->parent, GX_WMO_FLAG_LOADED))
-			continue;
-		bool wmo_found = false;
-		for (size_t j = 0; j < state->wmo.size; ++j)
-		{
-			if (*JKS_ARRAY_GET(&state->wmo, j, struct gx_wmo_instance*) == wmo->instance)
-			{
-				wmo_found = true;
-				break;
-			}
-		}
-		if (wmo_found)
-			continue;
-		if (!jks_array_push_back(&state->wmo, &wmo->instance))
-			LOG_WARN("failed to add wmo to visited list");
-		if (!aabb_intersect_sphere(&wmo->instance->aabb, params->center, params->radius))
-			continue;
-		add_wmo(wmo->instance, params, state, triangles);
-	}
-}
-
-void
-map_tile_collect_collision_triangles(struct map_tile *tile,
-                                     const struct collision_params *params,
-                                     struct collision_state *state,
-                                     struct jks_array *triangles)
+query_tile(struct map_tile *tile, struct collision_query *cq)
 {
+	const struct aabb *aabb = &cq->query->aabb;
 	if (!(tile->flags & MAP_TILE_FLAG_LOADED))
 		return;
+	if (aabb_intersect_aabb(&tile->aabb, aabb))
+		query_bvh(cq, &tile->collision_bvh, NULL, NULL);
 	float xmin = tile->pos.x - CHUNK_WIDTH * 16;
-	ssize_t z_end = floorf((params->aabb.p0.x - xmin) / CHUNK_WIDTH);
+	ssize_t z_end = floorf((aabb->p0.x - xmin) / CHUNK_WIDTH);
 	z_end = 16 - z_end;
 	if (z_end > 16)
 		z_end = 16;
 	else if (z_end < 16)
 		z_end++;
-	ssize_t z_start = ceilf((params->aabb.p1.x - xmin) / CHUNK_WIDTH);
+	ssize_t z_start = ceilf((aabb->p1.x - xmin) / CHUNK_WIDTH);
 	z_start = 16 - z_start;
 	if (z_start < 0)
 		z_start = 0;
@@ -1102,59 +1053,81 @@ map_tile_collect_collision_triangles(struct map_tile *tile,
 	if (z_start >= z_end)
 		return;
 	float zmin = tile->pos.z;
-	ssize_t x_end = ceilf((params->aabb.p1.z - zmin) / CHUNK_WIDTH);
+	ssize_t x_end = ceilf((aabb->p1.z - zmin) / CHUNK_WIDTH);
 	if (x_end > 16)
 		x_end = 16;
 	else if (x_end < 16)
 		x_end++;
-	ssize_t x_start = floorf((params->aabb.p0.z - zmin) / CHUNK_WIDTH);
+	ssize_t x_start = floorf((aabb->p0.z - zmin) / CHUNK_WIDTH);
 	if (x_start < 0)
 		x_start = 0;
 	else if (x_start > 0)
 		x_start--;
 	if (x_start >= x_end)
 		return;
-	if (aabb_intersect_aabb(&tile->aabb, &params->aabb))
-	{
-		for (ssize_t x = x_start; x < x_end; ++x)
-		{
-			for (ssize_t z = z_start; z < z_end; ++z)
-			{
-				uint8_t chunk_id = z * 16 + x;
-				struct map_chunk *chunk = &tile->chunks[chunk_id];
-				if (aabb_intersect_aabb(&chunk->aabb, &params->aabb))
-					add_chunk(tile, chunk, chunk_id, params, triangles);
-			}
-		}
-	}
-	if (aabb_intersect_aabb(&tile->objects_aabb, &params->aabb))
+	if (aabb_intersect_aabb(&tile->objects_aabb, aabb))
 	{
 		for (ssize_t x = x_start; x < x_end; ++x)
 		{
 			for (ssize_t z = z_start; z < z_end; ++z)
 			{
-				uint8_t chunk_id = z * 16 + x;
-				struct map_chunk *chunk = &tile->chunks[chunk_id];
-				if (chunk->doodads_nb && aabb_intersect_aabb(&chunk->objects_aabb, &params->aabb))
-					add_objects(tile, chunk, params, state, triangles);
+				struct map_chunk *chunk = &tile->chunks[z * 16 + x];
+				if (!chunk->doodads_nb || !aabb_intersect_aabb(&chunk->objects_aabb, aabb))
+					continue;
+				for (size_t i = 0; i < chunk->doodads_nb; ++i)
+					query_m2(cq, tile->m2[chunk->doodads[i]]->instance);
 			}
 		}
 	}
-	if (aabb_intersect_aabb(&tile->wmos_aabb, &params->aabb))
+	if (aabb_intersect_aabb(&tile->wmos_aabb, aabb))
 	{
 		for (ssize_t x = x_start; x < x_end; ++x)
 		{
 			for (ssize_t z = z_start; z < z_end; ++z)
 			{
-				uint8_t chunk_id = z * 16 + x;
-				struct map_chunk *chunk = &tile->chunks[chunk_id];
-				if (chunk->wmos_nb && aabb_intersect_aabb(&chunk->wmos_aabb, &params->aabb))
-					add_wmos(tile, chunk, params, state, triangles);
+				struct map_chunk *chunk = &tile->chunks[z * 16 + x];
+				if (!chunk->wmos_nb || !aabb_intersect_aabb(&chunk->wmos_aabb, aabb))
+					continue;
+				for (size_t i = 0; i < chunk->wmos_nb; ++i)
+					query_wmo(cq, tile->wmo[chunk->wmos[i]]->instance);
 			}
 		}
 	}
 }
 
+bool
+map_tile_cast(struct map_tile *tile,
+              const struct phys_query *query,
+              struct collision_state *state,
+              struct phys_hit *hit)
+{
+	struct collision_query cq;
+
+	cq.query = query;
+	cq.state = state;
+	cq.hit = hit;
+	cq.triangles = NULL;
+	cq.found = false;
+	query_tile(tile, &cq);
+	return cq.found;
+}
+
+void
+map_tile_collect_collision_triangles(struct map_tile *tile,
+                                     const struct phys_query *query,
+                                     struct collision_state *state,
+                                     struct jks_array *triangles)
+{
+	struct collision_query cq;
+
+	cq.query = query;
+	cq.state = state;
+	cq.hit = NULL;
+	cq.triangles = triangles;
+	cq.found = false;
+	query_tile(tile, &cq);
+}
+
 static void
 init_ground_effects(struct map_chunk *chunk, struct wow_mcnk *wow_mcnk)
 {
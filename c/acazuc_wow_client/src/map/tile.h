@@ -1,6 +1,8 @@
 #ifndef MAP_TILE_H
 #define MAP_TILE_H
 
+#include "phys/bvh.h"
+
 #include "refcount.h"
 
 #include <jks/vec3.h>
@@ -22,12 +24,13 @@ enum map_tile_flag
 };
 
 struct map_chunk_ground_effect;
-struct collision_params;
 struct collision_state;
 struct gx_wmo_instance;
 struct gx_m2_instance;
 struct wow_adt_file;
+struct phys_query;
 struct jks_array;
+struct phys_hit;
 struct gx_frame;
 struct gx_mcnk;
 struct gx_mclq;
@@ -90,6 +93,7 @@ struct map_tile
 	struct gx_mcnk *gx_mcnk;
 	struct gx_mclq *gx_mclq;
 	struct jks_array ground_effects; /* struct map_tile_ground_effect */
+	struct phys_bvh collision_bvh; /* terrain */
 	enum map_tile_flag flags;
 	char *filename;
 	struct vec3f pos;
@@ -130,7 +134,9 @@ void map_tile_free(struct map_tile *tile);
 void map_tile_ref(struct map_tile *tile);
 void map_tile_ask_load(struct map_tile *tile);
 void map_tile_cull(struct map_tile *tile, struct gx_frame *frame);
-void map_tile_collect_collision_triangles(struct map_tile *tile, const struct collision_params *params, struct collision_state *state, struct jks_array *triangles);
+void map_tile_add_occluders(struct map_tile *tile, struct gx_frame *frame);
+bool map_tile_cast(struct map_tile *tile, const struct phys_query *query, struct collision_state *state, struct phys_hit *hit);
+void map_tile_collect_collision_triangles(struct map_tile *tile, const struct phys_query *query, struct collision_state *state, struct jks_array *triangles);
 void map_tile_ground_end(struct map_tile *tile, struct gx_frame *frame);
 void map_tile_ground_clear(struct map_tile *tile, struct gx_frame *frame);
 
@@ -6,11 +6,16 @@
 #include <jks/hmap.h>
 #include <jks/list.h>
 
+#include <sys/resource.h>
+
 #include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
+#include <time.h>
 
 #ifdef WITH_MEMORY
 
@@ -30,14 +35,27 @@ static const char *g_memory_str[MEM_LAST] =
 	"MEM_PPE",
 	"MEM_SND",
 	"MEM_MAP",
+	"MEM_PHYS",
 };
 
-static struct
+/* each thread owns its counters, they are only summed on sample / dump
+ * size and count are signed as a block can be freed by another thread
+ * than the one which allocated it
+ */
+struct mem_stats
 {
-	pthread_mutex_t mutex;
-	size_t size;
-	size_t count;
-} g_memory[MEM_LAST] = {0};
+	int64_t size;
+	int64_t count;
+	uint64_t allocs;
+	uint64_t alloc_bytes;
+};
+
+struct mem_counters
+{
+	struct mem_counters *prev;
+	struct mem_counters *next;
+	struct mem_stats types[MEM_LAST];
+};
 
 struct mem_header
 {
@@ -45,13 +63,120 @@ struct mem_header
 	enum memory_type type;
 };
 
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_key;
+static struct mem_counters *g_threads;
+static struct mem_counters g_retired; /* exited threads */
+static __thread struct mem_counters *g_counters;
+
+static struct
+{
+	size_t peak;
+	uint64_t allocs;
+	uint64_t alloc_bytes;
+} g_report[MEM_LAST];
+static struct timespec g_report_time;
+
+static void counters_release(void *ptr)
+{
+	struct mem_counters *counters = ptr;
+	pthread_mutex_lock(&g_mutex);
+	for (size_t i = 0; i < MEM_LAST; ++i)
+	{
+		struct mem_stats *src = &counters->types[i];
+		struct mem_stats *dst = &g_retired.types[i];
+		__atomic_fetch_add(&dst->size, __atomic_load_n(&src->size, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+		__atomic_fetch_add(&dst->count, __atomic_load_n(&src->count, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+		__atomic_fetch_add(&dst->allocs, __atomic_load_n(&src->allocs, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+		__atomic_fetch_add(&dst->alloc_bytes, __atomic_load_n(&src->alloc_bytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+	}
+	if (counters->prev)
+		counters->prev->next = counters->next;
+	else
+		g_threads = counters->next;
+	if (counters->next)
+		counters->next->prev = counters->prev;
+	pthread_mutex_unlock(&g_mutex);
+	g_counters = NULL;
+	free(counters);
+}
+
+static void create_key(void)
+{
+	if (pthread_key_create(&g_key, counters_release))
+		LOG_ERROR("failed to create memory counters key");
+}
+
+static struct mem_counters *get_counters(void)
+{
+	struct mem_counters *counters = g_counters;
+	if (counters)
+		return counters;
+	pthread_once(&g_once, create_key);
+	counters = calloc(1, sizeof(*counters));
+	if (!counters)
+		return &g_retired; /* atomics keep it coherent, only slower */
+	pthread_mutex_lock(&g_mutex);
+	counters->next = g_threads;
+	if (g_threads)
+		g_threads->prev = counters;
+	g_threads = counters;
+	pthread_mutex_unlock(&g_mutex);
+	pthread_setspecific(g_key, counters);
+	g_counters = counters;
+	return counters;
+}
+
+static void account_alloc(enum memory_type type, size_t size)
+{
+	struct mem_stats *stats = &get_counters()->types[type];
+	__atomic_fetch_add(&stats->size, size, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stats->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stats->allocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stats->alloc_bytes, size, __ATOMIC_RELAXED);
+}
+
+static void account_free(enum memory_type type, size_t size)
+{
+	struct mem_stats *stats = &get_counters()->types[type];
+	__atomic_fetch_sub(&stats->size, size, __ATOMIC_RELAXED);
+	__atomic_fetch_sub(&stats->count, 1, __ATOMIC_RELAXED);
+}
+
+static void add_stats(struct mem_stats *stats, const struct mem_counters *counters)
+{
+	for (size_t i = 0; i < MEM_LAST; ++i)
+	{
+		stats[i].size += __atomic_load_n(&counters->types[i].size, __ATOMIC_RELAXED);
+		stats[i].count += __atomic_load_n(&counters->types[i].count, __ATOMIC_RELAXED);
+		stats[i].allocs += __atomic_load_n(&counters->types[i].allocs, __ATOMIC_RELAXED);
+		stats[i].alloc_bytes += __atomic_load_n(&counters->types[i].alloc_bytes, __ATOMIC_RELAXED);
+	}
+}
+
+static void sum_stats(struct mem_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats) * MEM_LAST);
+	pthread_mutex_lock(&g_mutex);
+	add_stats(stats, &g_retired);
+	for (struct mem_counters *counters = g_threads; counters; counters = counters->next)
+		add_stats(stats, counters);
+	for (size_t i = 0; i < MEM_LAST; ++i)
+	{
+		if (stats[i].size > 0 && (size_t)stats[i].size > g_report[i].peak)
+			g_report[i].peak = stats[i].size;
+	}
+	pthread_mutex_unlock(&g_mutex);
+}
+
 #endif
 
 void mem_init(void)
 {
 #ifdef WITH_MEMORY
-	for (size_t i = 0; i < MEM_LAST; ++i)
-		pthread_mutex_init(&g_memory[i].mutex, NULL);
+	get_counters();
+	clock_gettime(CLOCK_MONOTONIC, &g_report_time);
 #endif
 }
 
@@ -71,10 +196,7 @@ void *mem_malloc(enum memory_type type, size_t size)
 	assert(type < MEM_LAST);
 	ret->size = size;
 	ret->type = type;
-	pthread_mutex_lock(&g_memory[type].mutex);
-	g_memory[type].size += size;
-	g_memory[type].count++;
-	pthread_mutex_unlock(&g_memory[type].mutex);
+	account_alloc(type, size);
 	ret = (struct mem_header*)((char*)ret + sizeof(struct mem_header));
 #endif
 	return ret;
@@ -113,14 +235,8 @@ void *mem_realloc(enum memory_type type, void *ptr, size_t size)
 		return NULL;
 	}
 #ifdef WITH_MEMORY
-	pthread_mutex_lock(&g_memory[ret->type].mutex);
-	g_memory[ret->type].size -= ret->size;
-	g_memory[ret->type].count--;
-	pthread_mutex_unlock(&g_memory[ret->type].mutex);
-	pthread_mutex_lock(&g_memory[type].mutex);
-	g_memory[type].size += size;
-	g_memory[type].count++;
-	pthread_mutex_unlock(&g_memory[type].mutex);
+	account_free(ret->type, ret->size);
+	account_alloc(type, size);
 	ret->size = size;
 	ret->type = type;
 	ret = (struct mem_header*)((char*)ret + sizeof(struct mem_header));
@@ -157,10 +273,7 @@ void mem_free(enum memory_type type, void *ptr)
 	struct mem_header *header = (struct mem_header*)((char*)ptr - sizeof(*header));
 	if (header->type != type)
 		LOG_WARN("deallocation of invalid type: %d instead of %d", type, header->type);
-	pthread_mutex_lock(&g_memory[header->type].mutex);
-	g_memory[header->type].size -= header->size;
-	g_memory[header->type].count--;
-	pthread_mutex_unlock(&g_memory[header->type].mutex);
+	account_free(header->type, header->size);
 	free(header);
 #else
 	(void)type;
@@ -182,26 +295,244 @@ static void build_size_str(char *s, size_t n, size_t v)
 }
 #endif
 
+void mem_sample(void)
+{
+#ifdef WITH_MEMORY
+	struct mem_stats stats[MEM_LAST];
+	sum_stats(stats);
+#endif
+}
+
 void mem_dump(void)
 {
 #ifdef WITH_MEMORY
+	struct mem_stats stats[MEM_LAST];
+	struct timespec now;
+	struct rusage usage;
 	char str[256];
+	char peak_str[64];
+	char rate_str[64];
 	size_t sum_bytes = 0;
 	size_t sum_count = 0;
-	LOG_INFO("%20s | %10s | %10s | %7s", "category", "memory", "bytes", "count");
-	LOG_INFO("---------------------+------------+------------+--------");
-	for (size_t i = 0; i < sizeof(g_memory) / sizeof(*g_memory); ++i)
+	double sum_allocs = 0;
+	double sum_rate = 0;
+	sum_stats(stats);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double elapsed = (now.tv_sec - g_report_time.tv_sec) + (now.tv_nsec - g_report_time.tv_nsec) / 1000000000.;
+	if (elapsed <= 0)
+		elapsed = 1;
+	g_report_time = now;
+	LOG_INFO("%20s | %10s | %10s | %7s | %10s | %9s | %10s", "category", "memory", "bytes", "count", "peak", "allocs/s", "bytes/s");
+	LOG_INFO("---------------------+------------+------------+---------+------------+-----------+-----------");
+	for (size_t i = 0; i < MEM_LAST; ++i)
 	{
-		build_size_str(str, sizeof(str), g_memory[i].size);
-		LOG_INFO("%20s | %10s | %10zu | %7zu", g_memory_str[i], str, g_memory[i].size, g_memory[i].count);
-		sum_bytes += g_memory[i].size;
-		sum_count += g_memory[i].count;
+		double allocs = (stats[i].allocs - g_report[i].allocs) / elapsed;
+		double rate = (stats[i].alloc_bytes - g_report[i].alloc_bytes) / elapsed;
+		g_report[i].allocs = stats[i].allocs;
+		g_report[i].alloc_bytes = stats[i].alloc_bytes;
+		build_size_str(str, sizeof(str), stats[i].size);
+		build_size_str(peak_str, sizeof(peak_str), g_report[i].peak);
+		build_size_str(rate_str, sizeof(rate_str), rate);
+		LOG_INFO("%20s | %10s | %10zu | %7zu | %10s | %9.0f | %10s", g_memory_str[i], str, (size_t)stats[i].size, (size_t)stats[i].count, peak_str, allocs, rate_str);
+		sum_bytes += stats[i].size;
+		sum_count += stats[i].count;
+		sum_allocs += allocs;
+		sum_rate += rate;
 	}
 	build_size_str(str, sizeof(str), sum_bytes);
-	LOG_INFO("%20s | %10s | %10zu | %7zu", "SUM", str, sum_bytes, sum_count);
+	build_size_str(rate_str, sizeof(rate_str), sum_rate);
+	LOG_INFO("%20s | %10s | %10zu | %7zu | %10s | %9.0f | %10s", "SUM", str, sum_bytes, sum_count, "", sum_allocs, rate_str);
+	if (!getrusage(RUSAGE_SELF, &usage))
+	{
+		build_size_str(str, sizeof(str), (size_t)usage.ru_maxrss * 1024);
+		LOG_INFO("peak rss: %s", str);
+	}
 #endif
 }
 
+#define ARENA_ALIGN 16
+
+struct mem_arena_chunk
+{
+	struct mem_arena_chunk *next;
+	size_t size;
+	size_t used;
+	max_align_t data[];
+};
+
+void mem_arena_init(struct mem_arena *arena, enum memory_type type, size_t chunk_size)
+{
+	arena->type = type;
+	arena->chunk_size = chunk_size;
+	arena->chunks = NULL;
+	arena->chunk = NULL;
+	pthread_mutex_init(&arena->mutex, NULL);
+}
+
+void mem_arena_destroy(struct mem_arena *arena)
+{
+	struct mem_arena_chunk *chunk = arena->chunks;
+	while (chunk)
+	{
+		struct mem_arena_chunk *next = chunk->next;
+		mem_free(arena->type, chunk);
+		chunk = next;
+	}
+	pthread_mutex_destroy(&arena->mutex);
+}
+
+/* called with the arena mutex locked, publishes the chunk following the
+ * one that was found full, creating it if it doesn't exist or is too small
+ */
+static bool arena_next_chunk(struct mem_arena *arena, struct mem_arena_chunk *chunk, size_t size)
+{
+	struct mem_arena_chunk *next = chunk ? chunk->next : arena->chunks;
+	if (!next || next->size < size)
+	{
+		size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+		struct mem_arena_chunk *tmp = mem_malloc(arena->type, sizeof(*tmp) + chunk_size);
+		if (!tmp)
+			return false;
+		tmp->size = chunk_size;
+		tmp->next = next;
+		if (chunk)
+			chunk->next = tmp;
+		else
+			arena->chunks = tmp;
+		next = tmp;
+	}
+	next->used = 0;
+	__atomic_store_n(&arena->chunk, next, __ATOMIC_RELEASE);
+	return true;
+}
+
+void *mem_arena_alloc(struct mem_arena *arena, size_t size)
+{
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	while (1)
+	{
+		struct mem_arena_chunk *chunk = __atomic_load_n(&arena->chunk, __ATOMIC_ACQUIRE);
+		if (chunk)
+		{
+			size_t offset = __atomic_fetch_add(&chunk->used, size, __ATOMIC_RELAXED);
+			if (offset + size <= chunk->size)
+				return (char*)chunk->data + offset;
+		}
+		pthread_mutex_lock(&arena->mutex);
+		if (__atomic_load_n(&arena->chunk, __ATOMIC_RELAXED) == chunk
+		 && !arena_next_chunk(arena, chunk, size))
+		{
+			pthread_mutex_unlock(&arena->mutex);
+			LOG_ERROR("failed to allocate arena chunk");
+			return NULL;
+		}
+		pthread_mutex_unlock(&arena->mutex);
+	}
+}
+
+/* O(1), must not race with mem_arena_alloc */
+void mem_arena_reset(struct mem_arena *arena)
+{
+	__atomic_store_n(&arena->chunk, NULL, __ATOMIC_RELEASE);
+}
+
+struct mem_pool_item
+{
+	struct mem_pool_item *next;
+	max_align_t data[];
+};
+
+struct mem_pool_chunk
+{
+	struct mem_pool_chunk *next;
+	max_align_t data[];
+};
+
+static size_t pool_stride(const struct mem_pool *pool)
+{
+	size_t align = sizeof(max_align_t);
+	return sizeof(struct mem_pool_item) + (pool->item_size + align - 1) / align * align;
+}
+
+static struct mem_pool_item *pool_item(const struct mem_pool *pool, struct mem_pool_chunk *chunk, size_t i)
+{
+	return (struct mem_pool_item*)((char*)chunk->data + pool_stride(pool) * i);
+}
+
+void mem_pool_init(struct mem_pool *pool, enum memory_type type, size_t item_size, size_t chunk_items, mem_pool_fn_t ctor, mem_pool_fn_t dtor)
+{
+	pool->type = type;
+	pool->item_size = item_size;
+	pool->chunk_items = chunk_items;
+	pool->ctor = ctor;
+	pool->dtor = dtor;
+	pool->chunks = NULL;
+	pool->items = NULL;
+	pthread_mutex_init(&pool->mutex, NULL);
+}
+
+void mem_pool_destroy(struct mem_pool *pool)
+{
+	struct mem_pool_chunk *chunk = pool->chunks;
+	while (chunk)
+	{
+		struct mem_pool_chunk *next = chunk->next;
+		if (pool->dtor)
+		{
+			for (size_t i = 0; i < pool->chunk_items; ++i)
+				pool->dtor(pool_item(pool, chunk, i)->data);
+		}
+		mem_free(pool->type, chunk);
+		chunk = next;
+	}
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+static bool pool_add_chunk(struct mem_pool *pool)
+{
+	struct mem_pool_chunk *chunk = mem_malloc(pool->type, sizeof(*chunk) + pool_stride(pool) * pool->chunk_items);
+	if (!chunk)
+		return false;
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	for (size_t i = 0; i < pool->chunk_items; ++i)
+	{
+		struct mem_pool_item *item = pool_item(pool, chunk, i);
+		if (pool->ctor)
+			pool->ctor(item->data);
+		item->next = pool->items;
+		pool->items = item;
+	}
+	return true;
+}
+
+void *mem_pool_get(struct mem_pool *pool)
+{
+	struct mem_pool_item *item;
+	pthread_mutex_lock(&pool->mutex);
+	if (!pool->items && !pool_add_chunk(pool))
+	{
+		pthread_mutex_unlock(&pool->mutex);
+		LOG_ERROR("failed to allocate pool chunk");
+		return NULL;
+	}
+	item = pool->items;
+	pool->items = item->next;
+	pthread_mutex_unlock(&pool->mutex);
+	return item->data;
+}
+
+void mem_pool_put(struct mem_pool *pool, void *ptr)
+{
+	if (!ptr)
+		return;
+	struct mem_pool_item *item = (struct mem_pool_item*)((char*)ptr - offsetof(struct mem_pool_item, data));
+	pthread_mutex_lock(&pool->mutex);
+	item->next = pool->items;
+	pool->items = item;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
 #define MEMORY_DEFINE(mem) \
 	void *mem_malloc_##mem(size_t size) \
 	{ \
@@ -260,3 +591,4 @@ MEMORY_DEFINE(LIBWOW);
 MEMORY_DEFINE(PPE);
 MEMORY_DEFINE(SND);
 MEMORY_DEFINE(MAP);
+MEMORY_DEFINE(PHYS);
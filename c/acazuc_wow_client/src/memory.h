@@ -1,6 +1,7 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <pthread.h>
 #include <stddef.h>
 
 enum memory_type
@@ -19,6 +20,7 @@ enum memory_type
 	MEM_PPE,
 	MEM_SND,
 	MEM_MAP,
+	MEM_PHYS,
 	MEM_LAST
 };
 
@@ -29,8 +31,50 @@ void *mem_realloc(enum memory_type type, void *ptr, size_t size);
 char *mem_strdup(enum memory_type type, const char *str);
 char *mem_strndup(enum memory_type type, const char *str, size_t size);
 void mem_free(enum memory_type type, void *ptr);
+void mem_sample(void);
 void mem_dump(void);
 
+struct mem_arena_chunk;
+struct mem_pool_chunk;
+struct mem_pool_item;
+
+/* bump allocator, chunks are kept across resets */
+struct mem_arena
+{
+	enum memory_type type;
+	size_t chunk_size;
+	struct mem_arena_chunk *chunks;
+	struct mem_arena_chunk *chunk; /* current chunk, NULL after reset */
+	pthread_mutex_t mutex;
+};
+
+void mem_arena_init(struct mem_arena *arena, enum memory_type type, size_t chunk_size);
+void mem_arena_destroy(struct mem_arena *arena);
+void *mem_arena_alloc(struct mem_arena *arena, size_t size);
+void mem_arena_reset(struct mem_arena *arena);
+
+typedef void (*mem_pool_fn_t)(void *item);
+
+/* free list of fixed size items, ctor / dtor are called once per item
+ * when its chunk is created / when the pool is destroyed, not on get / put
+ */
+struct mem_pool
+{
+	enum memory_type type;
+	size_t item_size;
+	size_t chunk_items;
+	mem_pool_fn_t ctor;
+	mem_pool_fn_t dtor;
+	struct mem_pool_chunk *chunks;
+	struct mem_pool_item *items;
+	pthread_mutex_t mutex;
+};
+
+void mem_pool_init(struct mem_pool *pool, enum memory_type type, size_t item_size, size_t chunk_items, mem_pool_fn_t ctor, mem_pool_fn_t dtor);
+void mem_pool_destroy(struct mem_pool *pool);
+void *mem_pool_get(struct mem_pool *pool);
+void mem_pool_put(struct mem_pool *pool, void *ptr);
+
 #define MEMORY_DECL(mem) \
 	void *mem_malloc_##mem(size_t size); \
 	void *mem_zalloc_##mem(size_t size); \
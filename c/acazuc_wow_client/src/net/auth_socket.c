@@ -1072,7 +1072,7 @@ static bool recv_packet(struct net_auth_socket *socket, struct net_packet_reader
 		LOG_DEBUG("packet not full");
 		return false;
 	}
-	if (!net_packet_reader_init(packet, opcode, ptr, len))
+	if (!net_packet_reader_init(packet, NULL, opcode, ptr, len))
 	{
 		LOG_ERROR("failed to init packet reader");
 		return false;
@@ -76,7 +76,7 @@ static void close_world_socket(struct network *network)
 	net_world_socket_delete(tmp);
 }
 
-void net_tick(struct network *network)
+void net_tick(struct network *network, struct mem_arena *arena)
 {
 	if (network->auth_socket)
 	{
@@ -88,7 +88,7 @@ void net_tick(struct network *network)
 	}
 	if (network->world_socket)
 	{
-		if (!net_world_socket_tick(network->world_socket))
+		if (!net_world_socket_tick(network->world_socket, arena))
 		{
 			LOG_ERROR("error on world socket tick");
 			close_world_socket(network);
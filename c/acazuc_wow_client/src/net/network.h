@@ -11,6 +11,7 @@
 struct net_packet_writer;
 struct net_world_socket;
 struct net_auth_socket;
+struct mem_arena;
 
 enum world_server_flag
 {
@@ -50,7 +51,7 @@ struct network
 
 struct network *network_new(void);
 void network_delete(struct network *network);
-void net_tick(struct network *network);
+void net_tick(struct network *network, struct mem_arena *arena);
 bool net_auth_connect(struct network *network, const char *username, const char *password);
 bool net_world_connect(struct network *network, const char *address);
 void net_disconnect(struct network *network);
@@ -7,10 +7,14 @@
 
 MEMORY_DECL(NET);
 
-bool net_packet_reader_init(struct net_packet_reader *packet, uint32_t opcode, uint8_t *data, uint16_t size)
+bool net_packet_reader_init(struct net_packet_reader *packet, struct mem_arena *arena, uint32_t opcode, uint8_t *data, uint16_t size)
 {
+	packet->arena = arena;
 	packet->opcode = opcode;
-	packet->data = mem_malloc(MEM_NET, size);
+	if (arena)
+		packet->data = mem_arena_alloc(arena, size);
+	else
+		packet->data = mem_malloc(MEM_NET, size);
 	if (!packet->data)
 	{
 		LOG_ERROR("failed to allocate buffer");
@@ -24,7 +28,8 @@ bool net_packet_reader_init(struct net_packet_reader *packet, uint32_t opcode, u
 
 void net_packet_reader_destroy(struct net_packet_reader *packet)
 {
-	mem_free(MEM_NET, packet->data);
+	if (!packet->arena)
+		mem_free(MEM_NET, packet->data);
 }
 
 bool net_read_i8(struct net_packet_reader *packet, int8_t *data)
@@ -7,8 +7,11 @@
 #include <stdint.h>
 #include <stddef.h>
 
+struct mem_arena;
+
 struct net_packet_reader
 {
+	struct mem_arena *arena; /* owns data if not NULL */
 	uint32_t opcode;
 	uint8_t *data;
 	uint16_t size;
@@ -21,7 +24,7 @@ struct net_packet_writer
 	struct jks_array data; /* uint8_t */
 };
 
-bool net_packet_reader_init(struct net_packet_reader *packet, uint32_t opcode, uint8_t *data, uint16_t size);
+bool net_packet_reader_init(struct net_packet_reader *packet, struct mem_arena *arena, uint32_t opcode, uint8_t *data, uint16_t size);
 void net_packet_reader_destroy(struct net_packet_reader *packet);
 bool net_read_i8(struct net_packet_reader *packet, int8_t *data);
 bool net_read_u8(struct net_packet_reader *packet, uint8_t *data);
@@ -12,7 +12,7 @@
 
 MEMORY_DECL(NET);
 
-static bool recv_packet(struct net_world_socket *socket, struct net_packet_reader *packet);
+static bool recv_packet(struct net_world_socket *socket, struct mem_arena *arena, struct net_packet_reader *packet);
 
 static void login_character_dtr(void *data)
 {
@@ -49,7 +49,7 @@ void net_world_socket_delete(struct net_world_socket *socket)
 	mem_free(MEM_NET, socket);
 }
 
-bool net_world_socket_tick(struct net_world_socket *socket)
+bool net_world_socket_tick(struct net_world_socket *socket, struct mem_arena *arena)
 {
 	switch (net_socket_get_connection_status(&socket->socket))
 	{
@@ -65,7 +65,7 @@ bool net_world_socket_tick(struct net_world_socket *socket)
 	if (!net_socket_recv(&socket->socket))
 		return false;
 	struct net_packet_reader packet;
-	while (recv_packet(socket, &packet))
+	while (recv_packet(socket, arena, &packet))
 	{
 		LOG_INFO("recv \e[1;36m%s\e[0m", net_opcodes_str[packet.opcode]);
 		net_packet_handle(&socket->network->packet_handler, &packet);
@@ -124,7 +124,7 @@ bool net_world_socket_send_packet(struct net_world_socket *socket, const struct
 	return true;
 }
 
-static bool recv_packet(struct net_world_socket *socket, struct net_packet_reader *packet)
+static bool recv_packet(struct net_world_socket *socket, struct mem_arena *arena, struct net_packet_reader *packet)
 {
 	if (socket->socket.rbuffer.position + 4 > socket->socket.rbuffer.limit + 4)
 		return false;
@@ -154,7 +154,7 @@ static bool recv_packet(struct net_world_socket *socket, struct net_packet_reade
 		cipher_recv(socket, ptr);
 	uint16_t opcode = *(ptr + 2);
 	opcode |= (uint16_t)*(ptr + 3) << 8;
-	if (!net_packet_reader_init(packet, opcode, ptr + 4, len - 2))
+	if (!net_packet_reader_init(packet, arena, opcode, ptr + 4, len - 2))
 		return false;
 	socket->socket.rbuffer.position += len + 2;
 	return true;
@@ -9,6 +9,7 @@
 
 struct net_packet_writer;
 struct net_packet_reader;
+struct mem_arena;
 struct network;
 
 struct login_character_item
@@ -63,7 +64,7 @@ struct net_world_socket
 
 struct net_world_socket *net_world_socket_new(struct network *network);
 void net_world_socket_delete(struct net_world_socket *socket);
-bool net_world_socket_tick(struct net_world_socket *socket);
+bool net_world_socket_tick(struct net_world_socket *socket, struct mem_arena *arena);
 bool net_world_socket_send_packet(struct net_world_socket *socket, const struct net_packet_writer *packet);
 void net_world_socket_init_cipher(struct net_world_socket *socket, const uint8_t *key);
 bool net_world_socket_add_character(struct net_world_socket *socket, const struct login_character *character);
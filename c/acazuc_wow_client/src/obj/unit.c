@@ -13,6 +13,7 @@
 #include "map/map.h"
 
 #include "phys/physics.h"
+#include "phys/bench.h"
 
 #include "performance.h"
 #include "const.h"
@@ -1024,19 +1025,58 @@ void unit_update_items(struct object *object)
 	}
 }
 
-static struct vec3f update_position_collision(struct unit *unit, struct jks_array *triangles, struct vec3f src, struct vec3f dst, size_t recursion, struct vec3f *norm, bool *ground_touched)
+#define UNIT_COLLISION_OBJECTS 64
+
+/* world objects near the movement, the map is queried directly */
+struct unit_collisions
+{
+	struct worldobj *objects[UNIT_COLLISION_OBJECTS];
+	size_t objects_nb;
+};
+
+static void collect_collisions(struct unit_collisions *collisions, const struct phys_query *bounds)
+{
+	collisions->objects_nb = 0;
+	JKS_HMAP_FOREACH(iter, g_wow->objects)
+	{
+		struct object *obj = *(struct object**)jks_hmap_iterator_get_value(&iter);
+		if (!object_is_worldobj(obj) || object_is_unit(obj))
+			continue;
+		struct worldobj *worldobj = (struct worldobj*)obj;
+		if (!worldobj->m2 || !aabb_intersect_aabb(&worldobj->m2->caabb, &bounds->aabb))
+			continue;
+		if (collisions->objects_nb == UNIT_COLLISION_OBJECTS)
+		{
+			LOG_WARN("too many objects around unit");
+			break;
+		}
+		collisions->objects[collisions->objects_nb++] = worldobj;
+	}
+}
+
+static bool cast(const struct unit_collisions *collisions, const struct phys_query *query, struct phys_hit *hit)
+{
+	bool found = map_cast(g_wow->map, query, hit);
+	for (size_t i = 0; i < collisions->objects_nb; ++i)
+		found |= worldobj_cast(collisions->objects[i], query, hit);
+	return found;
+}
+
+static struct vec3f update_position_collision(struct unit *unit, const struct unit_collisions *collisions, struct vec3f src, struct vec3f dst, size_t recursion, struct vec3f *norm, bool *ground_touched)
 {
 	if (recursion >= 10)
 		return src;
-	struct vec3f ray_dir;
-	VEC3_SUB(ray_dir, dst, src);
-	float dir_len = VEC3_NORM(ray_dir);
-	VEC3_DIVV(ray_dir, ray_dir, dir_len);
-	float lowest;
-	struct collision_triangle *best;
-	struct vec3f best_norm;
-	if (!find_nearest_triangle(triangles, src, ray_dir, dir_len, &best, &best_norm, &lowest))
+	struct phys_query query;
+	struct phys_hit hit;
+	if (!phys_query_init(&query, src, dst, 0, 0))
+		return dst;
+	phys_hit_init(&hit, &query);
+	if (!cast(collisions, &query, &hit))
 		return dst;
+	struct vec3f ray_dir = query.dir;
+	struct vec3f best_norm = hit.norm;
+	float dir_len = query.len;
+	float lowest = hit.t;
 	*norm = best_norm;
 	struct vec3f collision_point;
 	VEC3_MULV(collision_point, ray_dir, lowest);
@@ -1057,7 +1097,7 @@ static struct vec3f update_position_collision(struct unit *unit, struct jks_arra
 			VEC3_MULV(repulsion, best_norm, d);
 			VEC3_MULV(repulsion, repulsion, len + 0.01f);
 #if 0
-			LOG_INFO("correct %f of {%f, %f, %f} because of %p; norm: %f, %f, %f; d: %f; y: %f", len, dst.x, dst.y, dst.z, best, best_norm.x, best_norm.y, best_norm.z, d, best->points[0].y);
+			LOG_INFO("correct %f of {%f, %f, %f}; norm: %f, %f, %f; d: %f", len, dst.x, dst.y, dst.z, best_norm.x, best_norm.y, best_norm.z, d);
 #endif
 			VEC3_SUB(dst, dst, repulsion);
 		}
@@ -1066,7 +1106,7 @@ static struct vec3f update_position_collision(struct unit *unit, struct jks_arra
 	if (!(unit->worldobj.movement_data.flags & (MOVEFLAG_FLYING | MOVEFLAG_FALLING)) && dst.y > src.y && best_norm.y < WALL_CLIMB)
 		dst.y = src.y;
 
-	return update_position_collision(unit, triangles, src, dst, recursion + 1, norm, ground_touched);
+	return update_position_collision(unit, collisions, src, dst, recursion + 1, norm, ground_touched);
 }
 
 static struct vec3f get_next_pos(struct unit *unit)
@@ -1255,34 +1295,29 @@ void unit_physics(struct unit *unit)
 		}
 	}
 	dst.y -= gravity;
+	if (g_wow->phys_bench && unit == (struct unit*)g_wow->player)
+		phys_bench_record(g_wow->phys_bench, src, dst);
 	PERFORMANCE_BEGIN(COLLISIONS);
-	struct collision_params params;
-	params.wmo_cam = false;
-	VEC3_MIN(params.aabb.p0, dst, src);
-	VEC3_MAX(params.aabb.p1, dst, src);
-	params.aabb.p0.x -= SPHERE_RADIUS;
-	params.aabb.p0.y -= SPHERE_RADIUS;
-	params.aabb.p0.z -= SPHERE_RADIUS;
-	params.aabb.p1.x += SPHERE_RADIUS;
-	params.aabb.p1.y += SPHERE_RADIUS;
-	params.aabb.p1.z += SPHERE_RADIUS;
-	struct vec3f delta;
-	VEC3_SUB(delta, params.aabb.p1, params.aabb.p0);
-	params.radius = VEC3_NORM(delta);
-	VEC3_MULV(params.center, delta, 0.5);
-	VEC3_ADD(params.center, params.center, params.aabb.p0);
-	struct jks_array triangles;
-	jks_array_init(&triangles, sizeof(struct collision_triangle), NULL, NULL);
-	map_collect_collision_triangles(g_wow->map, &params, &triangles);
-	JKS_HMAP_FOREACH(iter, g_wow->objects)
+	struct unit_collisions collisions;
+	struct phys_query bounds;
+	bool has_bounds = phys_query_init(&bounds, src, dst, SPHERE_RADIUS, 0);
+	if (has_bounds)
+		collect_collisions(&collisions, &bounds);
+	else
+		collisions.objects_nb = 0;
+#ifdef WITH_DEBUG_RENDERING
+	if (unit == (struct unit*)g_wow->player && has_bounds)
 	{
-		struct object *obj = *(struct object**)jks_hmap_iterator_get_value(&iter);
-		if (object_is_worldobj(obj) && !object_is_unit(obj))
-			worldobj_collect_collisions_triangles((struct worldobj*)obj, &params, &triangles);
+		struct jks_array *triangles = map_collision_triangles_get(g_wow->map);
+		if (triangles)
+		{
+			map_collect_collision_triangles(g_wow->map, &bounds, triangles);
+			for (size_t i = 0; i < collisions.objects_nb; ++i)
+				worldobj_collect_collisions_triangles(collisions.objects[i], &bounds, triangles);
+			gx_collisions_update(&g_wow->cull_frame->gx_collisions, g_wow->cull_frame, triangles->data, triangles->size);
+			map_collision_triangles_put(g_wow->map, triangles);
+		}
 	}
-#ifdef WITH_DEBUG_RENDERING
-	if (unit == (struct unit*)g_wow->player)
-		gx_collisions_update(&g_wow->cull_frame->gx_collisions, g_wow->cull_frame, triangles.data, triangles.size);
 #endif
 	struct vec3f norm;
 	VEC3_SET(norm, 0, -1, 0);
@@ -1292,7 +1327,7 @@ void unit_physics(struct unit *unit)
 #if 0
 		LOG_INFO("src: {%f, %f, %f}, dst: {%f, %f, %f}, velocity: {%f, %f, %f}; ground: %d", src.x, src.y, src.z, dst.x, dst.y, dst.z, camera->velocity.x, camera->velocity.y, camera->velocity.z, camera->grounded);
 #endif
-		struct vec3f tmp = update_position_collision(unit, &triangles, src, dst, 0, &norm, &ground_touched);
+		struct vec3f tmp = update_position_collision(unit, &collisions, src, dst, 0, &norm, &ground_touched);
 		if (!ground_touched)
 		{
 			if (!(unit->worldobj.movement_data.flags & (MOVEFLAG_FLYING | MOVEFLAG_FALLING)))
@@ -1315,7 +1350,6 @@ void unit_physics(struct unit *unit)
 		unit->worldobj.slope = 0;
 		unit->worldobj.movement_data.flags &= ~MOVEFLAG_FLYING;
 	}
-	jks_array_destroy(&triangles);
 	PERFORMANCE_END(COLLISIONS);
 	worldobj_set_position(&unit->worldobj, dst);
 }
@@ -10,6 +10,8 @@
 
 #include "map/map.h"
 
+#include "phys/physics.h"
+
 #include "const.h"
 #include "wow.h"
 #include "log.h"
@@ -228,46 +230,41 @@ float worldobj_get_speed(struct worldobj *worldobj, bool backward)
 	return speed;
 }
 
-static void add_object_point(struct gx_m2_instance *m2, struct vec3f *point, uint16_t idx)
+static bool has_collisions(struct worldobj *worldobj, const struct phys_query *query)
 {
-	struct vec4f tmp;
-	VEC3_CPY(tmp, m2->parent->collision_vertexes[idx]);
-	tmp.w = 1;
-	struct vec4f out;
-	MAT4_VEC4_MUL(out, m2->m, tmp);
-	VEC3_CPY(*point, out);
+	if (!worldobj->m2)
+		return false;
+	if (!gx_m2_flag_get(worldobj->m2->parent, GX_M2_FLAG_LOADED))
+		return false;
+	return aabb_intersect_aabb(&worldobj->m2->caabb, &query->aabb);
 }
 
-static void add_object(struct gx_m2_instance *m2, struct jks_array *triangles)
+bool worldobj_cast(struct worldobj *worldobj, const struct phys_query *query, struct phys_hit *hit)
 {
-	if (!m2->parent->collision_triangles_nb)
-		return;
-	struct collision_triangle *tmp = jks_array_grow(triangles, m2->parent->collision_triangles_nb / 3);
-	if (!tmp)
+	if (!has_collisions(worldobj, query))
+		return false;
+	return phys_bvh_cast_instance(&worldobj->m2->parent->collision_bvh, &worldobj->m2->m_inv, query, hit);
+}
+
+static void collect_triangle(const struct vec3f *points, uint8_t flags, void *userdata)
+{
+	struct jks_array *triangles = userdata;
+	(void)flags;
+	struct collision_triangle *triangle = jks_array_grow(triangles, 1);
+	if (!triangle)
 	{
 		LOG_ERROR("triangles allocation failed");
 		return;
 	}
-	for (size_t i = 0; i < m2->parent->collision_triangles_nb;)
-	{
-		add_object_point(m2, &tmp->points[0], m2->parent->collision_triangles[i++]);
-		add_object_point(m2, &tmp->points[1], m2->parent->collision_triangles[i++]);
-		add_object_point(m2, &tmp->points[2], m2->parent->collision_triangles[i++]);
-		tmp->touched = false;
-		tmp++;
-	}
+	memcpy(triangle->points, points, sizeof(triangle->points));
+	triangle->touched = false;
 }
 
-void worldobj_collect_collisions_triangles(struct worldobj *worldobj, struct collision_params *params, struct jks_array *triangles)
+void worldobj_collect_collisions_triangles(struct worldobj *worldobj, const struct phys_query *query, struct jks_array *triangles)
 {
-	if (!worldobj->m2)
-		return;
-	if (!gx_m2_flag_get(worldobj->m2->parent, GX_M2_FLAG_LOADED))
-		return;
-	if (!aabb_intersect_sphere(&worldobj->m2->caabb, params->center, params->radius)
-	 || !aabb_intersect_aabb(&worldobj->m2->caabb, &params->aabb))
+	if (!has_collisions(worldobj, query))
 		return;
-	add_object(worldobj->m2, triangles);
+	phys_bvh_query_aabb_instance(&worldobj->m2->parent->collision_bvh, &worldobj->m2->m, &worldobj->m2->m_inv, &query->aabb, collect_triangle, triangles);
 }
 
 static void on_field_changed(struct object *object, uint32_t field)
@@ -8,9 +8,10 @@
 
 struct net_packet_writer;
 struct net_packet_reader;
-struct collision_params;
 struct gx_m2_instance;
+struct phys_query;
 struct jks_array;
+struct phys_hit;
 
 struct world_movement_data
 {
@@ -73,7 +74,8 @@ void worldobj_set_slope(struct worldobj *worldobj, float slope);
 float worldobj_get_speed(struct worldobj *worldobj, bool backward);
 void worldobj_set_m2(struct worldobj *worldobj, const char *file);
 void worldobj_add_to_render(struct worldobj *worldobj);
-void worldobj_collect_collisions_triangles(struct worldobj *worldobj, struct collision_params *params, struct jks_array *triangles);
+bool worldobj_cast(struct worldobj *worldobj, const struct phys_query *query, struct phys_hit *hit);
+void worldobj_collect_collisions_triangles(struct worldobj *worldobj, const struct phys_query *query, struct jks_array *triangles);
 
 extern const struct worldobj_vtable worldobj_vtable;
 extern const struct object_vtable worldobj_object_vtable;
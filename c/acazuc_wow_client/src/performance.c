@@ -7,6 +7,7 @@
 #include <limits.h>
 
 struct performance_report g_performances[PERFORMANCE_LAST];
+uint64_t g_performance_counters[PERFORMANCE_COUNTER_LAST];
 
 #ifdef WITH_PERFORMANCE
 static const char *strings[PERFORMANCE_LAST] =
@@ -27,6 +28,7 @@ static const char *strings[PERFORMANCE_LAST] =
 	"M2_PARTICLES_RENDER",
 	"M2_RENDER",
 	"M2_RIBBONS_RENDER",
+	"OCCLUSION_CULL",
 	"SKYBOX_RENDER",
 	"TAXI_RENDER",
 	"TEXT_RENDER",
@@ -39,6 +41,15 @@ static const char *strings[PERFORMANCE_LAST] =
 	"WMO_PORTALS_RENDER",
 	"WMO_RENDER",
 };
+
+static const char *counter_strings[PERFORMANCE_COUNTER_LAST] =
+{
+	"OCCLUSION_CULLED",
+	"OCCLUSION_OCCLUDERS",
+	"OCCLUSION_VISIBLE",
+	"UI_DRAWS",
+	"UI_REGIONS",
+};
 #endif
 
 void performance_init(void)
@@ -63,6 +74,8 @@ void performance_reset(void)
 		report->min = UINT_MAX;
 		report->max = 0;
 	}
+	for (size_t i = 0; i < sizeof(g_performance_counters) / sizeof(*g_performance_counters); ++i)
+		__atomic_store_n(&g_performance_counters[i], 0, __ATOMIC_RELAXED);
 #endif
 }
 
@@ -82,6 +95,11 @@ void performance_dump(void)
 		LOG_INFO("%21s | %7" PRIu64 " | %6" PRIu64 " | %6" PRIu64 " | %8.2lf | %7" PRIu64, strings[i], samples, min, max, avg, sum);
 	}
 	LOG_INFO(" ");
+	LOG_INFO("%21s | %9s", "counter", "total");
+	LOG_INFO("----------------------+----------");
+	for (size_t i = 0; i < sizeof(g_performance_counters) / sizeof(*g_performance_counters); ++i)
+		LOG_INFO("%21s | %9" PRIu64, counter_strings[i], __atomic_load_n(&g_performance_counters[i], __ATOMIC_RELAXED));
+	LOG_INFO(" ");
 #endif
 }
 
@@ -102,3 +120,13 @@ void performance_add(enum performance_category category, uint64_t time)
 	(void)time;
 #endif
 }
+
+void performance_count(enum performance_counter counter, uint64_t n)
+{
+#ifdef WITH_PERFORMANCE
+	__atomic_add_fetch(&g_performance_counters[counter], n, __ATOMIC_RELAXED);
+#else
+	(void)counter;
+	(void)n;
+#endif
+}
@@ -22,6 +22,7 @@ enum performance_category
 	PERFORMANCE_M2_PARTICLES_RENDER,
 	PERFORMANCE_M2_RENDER,
 	PERFORMANCE_M2_RIBBONS_RENDER,
+	PERFORMANCE_OCCLUSION_CULL,
 	PERFORMANCE_SKYBOX_RENDER,
 	PERFORMANCE_TAXI_RENDER,
 	PERFORMANCE_TEXT_RENDER,
@@ -36,13 +37,25 @@ enum performance_category
 	PERFORMANCE_LAST
 };
 
+enum performance_counter
+{
+	PERFORMANCE_OCCLUSION_CULLED,
+	PERFORMANCE_OCCLUSION_OCCLUDERS,
+	PERFORMANCE_OCCLUSION_VISIBLE,
+	PERFORMANCE_UI_DRAWS,
+	PERFORMANCE_UI_REGIONS,
+	PERFORMANCE_COUNTER_LAST
+};
+
 #ifdef WITH_PERFORMANCE
 # define PERFORMANCE_VAR_NAME(type) performance_##type##_section
 # define PERFORMANCE_BEGIN(type) uint64_t PERFORMANCE_VAR_NAME(type) = nanotime();
 # define PERFORMANCE_END(type) performance_add(PERFORMANCE_##type, nanotime() - PERFORMANCE_VAR_NAME(type));
+# define PERFORMANCE_COUNT(type, n) performance_count(PERFORMANCE_##type, n);
 #else
 # define PERFORMANCE_BEGIN(type)
 # define PERFORMANCE_END(type)
+# define PERFORMANCE_COUNT(type, n)
 #endif
 
 struct performance_report
@@ -55,10 +68,12 @@ struct performance_report
 };
 
 extern struct performance_report g_performances[PERFORMANCE_LAST];
+extern uint64_t g_performance_counters[PERFORMANCE_COUNTER_LAST];
 
 void performance_init(void);
 void performance_reset(void);
 void performance_dump(void);
 void performance_add(enum performance_category category, uint64_t time);
+void performance_count(enum performance_counter counter, uint64_t n);
 
 #endif
@@ -0,0 +1,178 @@
+#include "phys/physics.h"
+#include "phys/bench.h"
+
+#include "map/map.h"
+
+#include "memory.h"
+#include "loader.h"
+#include "log.h"
+#include "wow.h"
+
+#include <jks/array.h>
+
+#include <string.h>
+#include <errno.h>
+
+#define BENCH_LOOPS 16
+
+static bool load_replay(struct phys_bench *bench, const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+	{
+		LOG_ERROR("failed to open %s: %s", path, strerror(errno));
+		return false;
+	}
+	if (fseek(fp, 0, SEEK_END)
+	 || ftell(fp) < 0)
+	{
+		LOG_ERROR("failed to get %s size", path);
+		fclose(fp);
+		return false;
+	}
+	size_t size = ftell(fp);
+	rewind(fp);
+	bench->steps_nb = size / sizeof(*bench->steps);
+	if (!bench->steps_nb)
+	{
+		LOG_ERROR("empty replay file %s", path);
+		fclose(fp);
+		return false;
+	}
+	bench->steps = mem_malloc(MEM_PHYS, sizeof(*bench->steps) * bench->steps_nb);
+	if (!bench->steps)
+	{
+		LOG_ERROR("failed to allocate replay steps");
+		fclose(fp);
+		return false;
+	}
+	if (fread(bench->steps, sizeof(*bench->steps), bench->steps_nb, fp) != bench->steps_nb)
+	{
+		LOG_ERROR("failed to read %s", path);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+	return true;
+}
+
+struct phys_bench *phys_bench_new(const char *record_path, const char *replay_path)
+{
+	struct phys_bench *bench = mem_zalloc(MEM_PHYS, sizeof(*bench));
+	if (!bench)
+	{
+		LOG_ERROR("failed to allocate physics bench");
+		return NULL;
+	}
+	if (record_path)
+	{
+		bench->record = fopen(record_path, "wb");
+		if (!bench->record)
+		{
+			LOG_ERROR("failed to open %s: %s", record_path, strerror(errno));
+			goto err;
+		}
+	}
+	if (replay_path && !load_replay(bench, replay_path))
+		goto err;
+	return bench;
+
+err:
+	phys_bench_delete(bench);
+	return NULL;
+}
+
+void phys_bench_delete(struct phys_bench *bench)
+{
+	if (!bench)
+		return;
+	if (bench->record)
+		fclose(bench->record);
+	mem_free(MEM_PHYS, bench->steps);
+	mem_free(MEM_PHYS, bench);
+}
+
+void phys_bench_record(struct phys_bench *bench, struct vec3f src, struct vec3f dst)
+{
+	if (!bench->record)
+		return;
+	struct phys_bench_step step;
+	step.src = src;
+	step.dst = dst;
+	if (fwrite(&step, sizeof(step), 1, bench->record) != 1)
+	{
+		LOG_ERROR("failed to write physics record");
+		fclose(bench->record);
+		bench->record = NULL;
+	}
+}
+
+static void report(const char *name, size_t queries, int64_t duration, size_t results)
+{
+	double seconds = duration / 1000000000.0;
+	LOG_INFO("%s: %zu queries in %.3f ms, %.0f queries/s, %zu results",
+	         name, queries, seconds * 1000, seconds > 0 ? queries / seconds : 0,
+	         results);
+}
+
+static void replay_casts(struct phys_bench *bench, const char *name, float radius)
+{
+	size_t queries = 0;
+	size_t hits = 0;
+	int64_t start = nanotime();
+	for (size_t loop = 0; loop < BENCH_LOOPS; ++loop)
+	{
+		for (size_t i = 0; i < bench->steps_nb; ++i)
+		{
+			struct phys_bench_step *step = &bench->steps[i];
+			struct phys_query query;
+			struct phys_hit hit;
+			if (!phys_query_init(&query, step->src, step->dst, radius, 0))
+				continue;
+			phys_hit_init(&hit, &query);
+			if (map_cast(g_wow->map, &query, &hit))
+				hits++;
+			queries++;
+		}
+	}
+	report(name, queries, nanotime() - start, hits);
+}
+
+static void replay_aabbs(struct phys_bench *bench)
+{
+	struct jks_array *triangles = map_collision_triangles_get(g_wow->map);
+	if (!triangles)
+		return;
+	size_t queries = 0;
+	size_t found = 0;
+	int64_t start = nanotime();
+	for (size_t loop = 0; loop < BENCH_LOOPS; ++loop)
+	{
+		for (size_t i = 0; i < bench->steps_nb; ++i)
+		{
+			struct phys_bench_step *step = &bench->steps[i];
+			struct phys_query query;
+			if (!phys_query_init(&query, step->src, step->dst, SPHERE_RADIUS, 0))
+				continue;
+			jks_array_resize(triangles, 0);
+			map_collect_collision_triangles(g_wow->map, &query, triangles);
+			found += triangles->size;
+			queries++;
+		}
+	}
+	report("aabb", queries, nanotime() - start, found);
+	map_collision_triangles_put(g_wow->map, triangles);
+}
+
+void phys_bench_tick(struct phys_bench *bench)
+{
+	if (!bench->steps_nb || bench->replayed)
+		return;
+	if (!g_wow->map || !g_wow->player || loader_has_async(g_wow->loader))
+		return;
+	bench->replayed = true;
+	LOG_INFO("replaying %zu physics steps %d times", bench->steps_nb, BENCH_LOOPS);
+	replay_casts(bench, "ray", 0);
+	replay_casts(bench, "sweep", SPHERE_RADIUS);
+	replay_aabbs(bench);
+}
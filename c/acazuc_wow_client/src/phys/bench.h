@@ -0,0 +1,34 @@
+#ifndef PHYS_BENCH_H
+#define PHYS_BENCH_H
+
+#include <jks/vec3.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct phys_bench_step
+{
+	struct vec3f src;
+	struct vec3f dst;
+};
+
+/*
+ * records the player movements to a file, or replays a recorded path once
+ * the world around the player is loaded, timing the ray, sweep and aabb
+ * collision queries along it
+ */
+struct phys_bench
+{
+	FILE *record;
+	struct phys_bench_step *steps;
+	size_t steps_nb;
+	bool replayed;
+};
+
+struct phys_bench *phys_bench_new(const char *record_path, const char *replay_path);
+void phys_bench_delete(struct phys_bench *bench);
+void phys_bench_record(struct phys_bench *bench, struct vec3f src, struct vec3f dst);
+void phys_bench_tick(struct phys_bench *bench);
+
+#endif
@@ -0,0 +1,733 @@
+#include "phys/physics.h"
+#include "phys/bvh.h"
+
+#include "memory.h"
+#include "log.h"
+
+#include <jks/vec4.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include <sys/types.h>
+
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define STACK_SIZE 64
+
+struct build_ctx
+{
+	struct phys_bvh *bvh;
+	const struct vec3f *points;
+	const uint8_t *flags;
+	struct vec3f *centers;
+	uint32_t *indices;
+};
+
+struct stack_entry
+{
+	uint32_t node;
+	float t;
+};
+
+struct instance_ctx
+{
+	const struct mat4f *m;
+	phys_bvh_triangle_fn_t fn;
+	void *userdata;
+};
+
+void phys_bvh_init(struct phys_bvh *bvh)
+{
+	bvh->nodes = NULL;
+	bvh->batches = NULL;
+	bvh->nodes_nb = 0;
+	bvh->batches_nb = 0;
+}
+
+void phys_bvh_destroy(struct phys_bvh *bvh)
+{
+	mem_free(MEM_PHYS, bvh->nodes);
+	mem_free(MEM_PHYS, bvh->batches);
+	phys_bvh_init(bvh);
+}
+
+size_t phys_bvh_get_size(const struct phys_bvh *bvh)
+{
+	return sizeof(*bvh->nodes) * bvh->nodes_nb
+	     + sizeof(*bvh->batches) * bvh->batches_nb;
+}
+
+static float center_axis(const struct build_ctx *ctx, uint32_t triangle, int axis)
+{
+	return ((const float*)&ctx->centers[triangle])[axis];
+}
+
+/* partially sorts the indices so that the k-th one is at its place */
+static void select_nth(const struct build_ctx *ctx, uint32_t *indices, ssize_t n, ssize_t k, int axis)
+{
+	ssize_t lo = 0;
+	ssize_t hi = n - 1;
+	while (lo < hi)
+	{
+		float pivot = center_axis(ctx, indices[lo + (hi - lo) / 2], axis);
+		ssize_t i = lo;
+		ssize_t j = hi;
+		while (i <= j)
+		{
+			while (center_axis(ctx, indices[i], axis) < pivot)
+				i++;
+			while (center_axis(ctx, indices[j], axis) > pivot)
+				j--;
+			if (i <= j)
+			{
+				uint32_t tmp = indices[i];
+				indices[i] = indices[j];
+				indices[j] = tmp;
+				i++;
+				j--;
+			}
+		}
+		if (k <= j)
+			hi = j;
+		else if (k >= i)
+			lo = i;
+		else
+			break;
+	}
+}
+
+static void fill_batch(const struct build_ctx *ctx, struct phys_bvh_batch *batch, const uint32_t *indices, uint32_t count)
+{
+	memset(batch, 0, sizeof(*batch));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const struct vec3f *p = &ctx->points[indices[i] * 3];
+		struct vec3f e1;
+		struct vec3f e2;
+		VEC3_SUB(e1, p[1], p[0]);
+		VEC3_SUB(e2, p[2], p[0]);
+		batch->v0[0][i] = p[0].x;
+		batch->v0[1][i] = p[0].y;
+		batch->v0[2][i] = p[0].z;
+		batch->e1[0][i] = e1.x;
+		batch->e1[1][i] = e1.y;
+		batch->e1[2][i] = e1.z;
+		batch->e2[0][i] = e2.x;
+		batch->e2[1][i] = e2.y;
+		batch->e2[2][i] = e2.z;
+		batch->flags[i] = ctx->flags ? ctx->flags[indices[i]] : 0;
+	}
+}
+
+static uint32_t build_node(struct build_ctx *ctx, uint32_t start, uint32_t count)
+{
+	struct phys_bvh *bvh = ctx->bvh;
+	uint32_t id = bvh->nodes_nb++;
+	struct phys_bvh_node *node = &bvh->nodes[id];
+	struct aabb centers;
+	VEC3_SETV(node->aabb.p0, +INFINITY);
+	VEC3_SETV(node->aabb.p1, -INFINITY);
+	VEC3_SETV(centers.p0, +INFINITY);
+	VEC3_SETV(centers.p1, -INFINITY);
+	for (uint32_t i = start; i < start + count; ++i)
+	{
+		const struct vec3f *p = &ctx->points[ctx->indices[i] * 3];
+		for (size_t j = 0; j < 3; ++j)
+		{
+			VEC3_MIN(node->aabb.p0, node->aabb.p0, p[j]);
+			VEC3_MAX(node->aabb.p1, node->aabb.p1, p[j]);
+		}
+		VEC3_MIN(centers.p0, centers.p0, ctx->centers[ctx->indices[i]]);
+		VEC3_MAX(centers.p1, centers.p1, ctx->centers[ctx->indices[i]]);
+	}
+	if (count <= PHYS_BVH_BATCH)
+	{
+		node->offset = bvh->batches_nb++;
+		node->count = 1;
+		fill_batch(ctx, &bvh->batches[node->offset], &ctx->indices[start], count);
+		return id;
+	}
+	struct vec3f extent;
+	VEC3_SUB(extent, centers.p1, centers.p0);
+	int axis = 0;
+	if (extent.y > extent.x)
+		axis = 1;
+	if (extent.z > ((float*)&extent)[axis])
+		axis = 2;
+	/* the left side is made of full batches so that there is exactly one
+	 * leaf per batch and 2 * batches - 1 nodes */
+	uint32_t batches = (count + PHYS_BVH_BATCH - 1) / PHYS_BVH_BATCH;
+	uint32_t left = (batches + 1) / 2 * PHYS_BVH_BATCH;
+	select_nth(ctx, &ctx->indices[start], count, left, axis);
+	node->count = 0;
+	build_node(ctx, start, left);
+	uint32_t right = build_node(ctx, start + left, count - left);
+	bvh->nodes[id].offset = right;
+	return id;
+}
+
+bool phys_bvh_build(struct phys_bvh *bvh, const struct vec3f *points, const uint8_t *flags, size_t triangles_nb)
+{
+	struct build_ctx ctx;
+	bool ret = false;
+
+	phys_bvh_destroy(bvh);
+	if (!triangles_nb)
+		return true;
+	uint32_t batches_nb = (triangles_nb + PHYS_BVH_BATCH - 1) / PHYS_BVH_BATCH;
+	ctx.bvh = bvh;
+	ctx.points = points;
+	ctx.flags = flags;
+	ctx.centers = mem_malloc(MEM_PHYS, sizeof(*ctx.centers) * triangles_nb);
+	ctx.indices = mem_malloc(MEM_PHYS, sizeof(*ctx.indices) * triangles_nb);
+	bvh->nodes = mem_malloc(MEM_PHYS, sizeof(*bvh->nodes) * (batches_nb * 2 - 1));
+	bvh->batches = mem_malloc(MEM_PHYS, sizeof(*bvh->batches) * batches_nb);
+	if (!ctx.centers || !ctx.indices || !bvh->nodes || !bvh->batches)
+	{
+		LOG_ERROR("failed to allocate bvh");
+		phys_bvh_destroy(bvh);
+		goto end;
+	}
+	for (size_t i = 0; i < triangles_nb; ++i)
+	{
+		VEC3_ADD(ctx.centers[i], points[i * 3 + 0], points[i * 3 + 1]);
+		VEC3_ADD(ctx.centers[i], ctx.centers[i], points[i * 3 + 2]);
+		VEC3_MULV(ctx.centers[i], ctx.centers[i], 1 / 3.f);
+		ctx.indices[i] = i;
+	}
+	build_node(&ctx, 0, triangles_nb);
+	assert(bvh->nodes_nb == batches_nb * 2 - 1);
+	assert(bvh->batches_nb == batches_nb);
+	ret = true;
+
+end:
+	mem_free(MEM_PHYS, ctx.centers);
+	mem_free(MEM_PHYS, ctx.indices);
+	return ret;
+}
+
+static bool ray_aabb(const struct aabb *aabb,
+                     const struct vec3f *src,
+                     const struct vec3f *inv_dir,
+                     float radius,
+                     float tmax,
+                     float *tnear)
+{
+	/* fminf / fmaxf drop the NaN of a null direction on a slab border */
+	float tx0 = (aabb->p0.x - radius - src->x) * inv_dir->x;
+	float tx1 = (aabb->p1.x + radius - src->x) * inv_dir->x;
+	float ty0 = (aabb->p0.y - radius - src->y) * inv_dir->y;
+	float ty1 = (aabb->p1.y + radius - src->y) * inv_dir->y;
+	float tz0 = (aabb->p0.z - radius - src->z) * inv_dir->z;
+	float tz1 = (aabb->p1.z + radius - src->z) * inv_dir->z;
+	float t0 = fmaxf(fmaxf(fminf(tx0, tx1), fminf(ty0, ty1)), fmaxf(fminf(tz0, tz1), 0));
+	float t1 = fminf(fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1)), fminf(fmaxf(tz0, tz1), tmax));
+	*tnear = t0;
+	return t0 <= t1;
+}
+
+static void lane_get(const float (*values)[PHYS_BVH_BATCH], int lane, struct vec3f *v)
+{
+	v->x = values[0][lane];
+	v->y = values[1][lane];
+	v->z = values[2][lane];
+}
+
+static bool pick_lane(const struct phys_bvh_batch *batch, uint32_t lanes, const float *t, float *tp, struct vec3f *normp)
+{
+	int best = -1;
+	for (int i = 0; i < PHYS_BVH_BATCH; ++i)
+	{
+		if (!(lanes & (1 << i)) || t[i] > *tp)
+			continue;
+		if (best == -1 || t[i] < t[best])
+			best = i;
+	}
+	if (best == -1)
+		return false;
+	struct vec3f e1;
+	struct vec3f e2;
+	struct vec3f norm;
+	lane_get(batch->e1, best, &e1);
+	lane_get(batch->e2, best, &e2);
+	VEC3_CROSS(norm, e1, e2);
+	VEC3_NORMALIZE(float, *normp, norm);
+	*tp = t[best];
+	return true;
+}
+
+#ifndef __SSE__
+/* möller-trumbore, back faces never collide */
+static bool ray_triangle(const struct phys_bvh_batch *batch,
+                         int lane,
+                         const struct vec3f *src,
+                         const struct vec3f *dir,
+                         float *tp)
+{
+	struct vec3f v0;
+	struct vec3f e1;
+	struct vec3f e2;
+	struct vec3f p;
+	struct vec3f q;
+	struct vec3f tt;
+	lane_get(batch->v0, lane, &v0);
+	lane_get(batch->e1, lane, &e1);
+	lane_get(batch->e2, lane, &e2);
+	VEC3_CROSS(p, *dir, e2);
+	float det = VEC3_DOT(e1, p);
+	if (det < EPSILON)
+		return false;
+	det = 1 / det;
+	VEC3_SUB(tt, *src, v0);
+	float u = VEC3_DOT(tt, p) * det;
+	if (u < -EPSILON || u > 1 + EPSILON)
+		return false;
+	VEC3_CROSS(q, tt, e1);
+	float v = VEC3_DOT(*dir, q) * det;
+	if (v < -EPSILON || u + v > 1 + EPSILON)
+		return false;
+	float t = VEC3_DOT(e2, q) * det;
+	if (t < 0)
+		return false;
+	*tp = t;
+	return true;
+}
+#endif
+
+/* the four triangles of the batch are tested at once */
+static bool ray_batch(const struct phys_bvh_batch *batch,
+                      const struct vec3f *src,
+                      const struct vec3f *dir,
+                      uint8_t ignore,
+                      float *tp,
+                      struct vec3f *normp)
+{
+	uint32_t lanes = 0;
+	float t[PHYS_BVH_BATCH];
+	for (int i = 0; i < PHYS_BVH_BATCH; ++i)
+	{
+		if (!(batch->flags[i] & ignore))
+			lanes |= 1 << i;
+	}
+	if (!lanes)
+		return false;
+#ifdef __SSE__
+	__m128 eps = _mm_set1_ps(EPSILON);
+	__m128 one_eps = _mm_set1_ps(1 + EPSILON);
+	__m128 dx = _mm_set1_ps(dir->x);
+	__m128 dy = _mm_set1_ps(dir->y);
+	__m128 dz = _mm_set1_ps(dir->z);
+	__m128 e1x = _mm_loadu_ps(batch->e1[0]);
+	__m128 e1y = _mm_loadu_ps(batch->e1[1]);
+	__m128 e1z = _mm_loadu_ps(batch->e1[2]);
+	__m128 e2x = _mm_loadu_ps(batch->e2[0]);
+	__m128 e2y = _mm_loadu_ps(batch->e2[1]);
+	__m128 e2z = _mm_loadu_ps(batch->e2[2]);
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 mask = _mm_cmpge_ps(det, eps);
+	if (!(_mm_movemask_ps(mask) & lanes))
+		return false;
+	__m128 inv = _mm_div_ps(_mm_set1_ps(1), det);
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(src->x), _mm_loadu_ps(batch->v0[0]));
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(src->y), _mm_loadu_ps(batch->v0[1]));
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(src->z), _mm_loadu_ps(batch->v0[2]));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inv);
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(u, _mm_sub_ps(_mm_setzero_ps(), eps)));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(u, one_eps));
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv);
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(v, _mm_sub_ps(_mm_setzero_ps(), eps)));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one_eps));
+	__m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv);
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(tt, _mm_setzero_ps()));
+	lanes &= _mm_movemask_ps(mask);
+	_mm_storeu_ps(t, tt);
+#else
+	for (int i = 0; i < PHYS_BVH_BATCH; ++i)
+	{
+		if ((lanes & (1 << i)) && !ray_triangle(batch, i, src, dir, &t[i]))
+			lanes &= ~(1 << i);
+	}
+#endif
+	return pick_lane(batch, lanes, t, tp, normp);
+}
+
+static float ray_sphere(const struct vec3f *src, const struct vec3f *dir, const struct vec3f *center, float radius)
+{
+	struct vec3f oc;
+	VEC3_SUB(oc, *src, *center);
+	float c = VEC3_DOT(oc, oc) - radius * radius;
+	if (c < 0)
+		return -1;
+	float b = VEC3_DOT(oc, *dir);
+	float h = b * b - c;
+	if (h < 0)
+		return -1;
+	return -b - sqrtf(h);
+}
+
+/* cylinder around the edge, without its caps */
+static float ray_edge(const struct vec3f *src, const struct vec3f *dir, const struct vec3f *a, const struct vec3f *b, float radius)
+{
+	struct vec3f ba;
+	struct vec3f oa;
+	VEC3_SUB(ba, *b, *a);
+	VEC3_SUB(oa, *src, *a);
+	float baba = VEC3_DOT(ba, ba);
+	float bard = VEC3_DOT(ba, *dir);
+	float baoa = VEC3_DOT(ba, oa);
+	float rdoa = VEC3_DOT(*dir, oa);
+	float oaoa = VEC3_DOT(oa, oa);
+	float k2 = baba - bard * bard;
+	if (k2 < EPSILON)
+		return -1;
+	float k1 = baba * rdoa - baoa * bard;
+	float k0 = baba * oaoa - baoa * baoa - radius * radius * baba;
+	if (k0 < 0)
+		return -1;
+	float h = k1 * k1 - k2 * k0;
+	if (h < 0)
+		return -1;
+	float t = (-k1 - sqrtf(h)) / k2;
+	float y = baoa + t * bard;
+	if (y <= 0 || y >= baba)
+		return -1;
+	return t;
+}
+
+static void closest_on_segment(const struct vec3f *p, const struct vec3f *a, const struct vec3f *b, struct vec3f *closest)
+{
+	struct vec3f ba;
+	struct vec3f pa;
+	VEC3_SUB(ba, *b, *a);
+	VEC3_SUB(pa, *p, *a);
+	float d = VEC3_DOT(ba, ba);
+	float f = d > EPSILON ? VEC3_DOT(pa, ba) / d : 0;
+	if (f < 0)
+		f = 0;
+	else if (f > 1)
+		f = 1;
+	VEC3_MULV(ba, ba, f);
+	VEC3_ADD(*closest, *a, ba);
+}
+
+/*
+ * first contact of the moving sphere with the face, else with the edges
+ * and vertexes; like the rays, the back faces are ignored so that a unit
+ * can always slide away from a wall. a sphere already overlapping the face
+ * and moving into it hits at t = 0 to not sink further, while overlaps of
+ * the edges and vertexes existing at the start of the sweep are ignored
+ */
+static bool sweep_triangle(const struct phys_bvh_batch *batch,
+                           int lane,
+                           const struct vec3f *src,
+                           const struct vec3f *dir,
+                           float radius,
+                           float *tp,
+                           struct vec3f *normp)
+{
+	struct vec3f points[3];
+	struct vec3f e1;
+	struct vec3f e2;
+	struct vec3f n;
+	lane_get(batch->v0, lane, &points[0]);
+	lane_get(batch->e1, lane, &e1);
+	lane_get(batch->e2, lane, &e2);
+	VEC3_ADD(points[1], points[0], e1);
+	VEC3_ADD(points[2], points[0], e2);
+	VEC3_CROSS(n, e1, e2);
+	float n_len = VEC3_NORM(n);
+	if (n_len < EPSILON)
+		return false;
+	VEC3_DIVV(n, n, n_len);
+	float dn = VEC3_DOT(*dir, n);
+	if (dn >= -EPSILON)
+		return false;
+	struct vec3f tmp;
+	VEC3_SUB(tmp, *src, points[0]);
+	float dist = VEC3_DOT(tmp, n);
+	if (dist < -radius)
+		return false;
+	float t = (dist - radius) / -dn;
+	if (t < 0)
+		t = 0;
+	if (t > *tp)
+		return false;
+	/* contact point of the sphere with the plane */
+	struct vec3f p;
+	VEC3_MULV(tmp, *dir, t);
+	VEC3_ADD(p, *src, tmp);
+	VEC3_MULV(tmp, n, radius);
+	VEC3_SUB(p, p, tmp);
+	VEC3_SUB(tmp, p, points[0]);
+	float d00 = VEC3_DOT(e1, e1);
+	float d01 = VEC3_DOT(e1, e2);
+	float d11 = VEC3_DOT(e2, e2);
+	float d20 = VEC3_DOT(tmp, e1);
+	float d21 = VEC3_DOT(tmp, e2);
+	float denom = d00 * d11 - d01 * d01;
+	float v = (d11 * d20 - d01 * d21) / denom;
+	float w = (d00 * d21 - d01 * d20) / denom;
+	if (v >= -EPSILON && w >= -EPSILON && v + w <= 1 + EPSILON)
+	{
+		*tp = t;
+		*normp = n;
+		return true;
+	}
+	float best = *tp;
+	int feature = -1;
+	for (int i = 0; i < 3; ++i)
+	{
+		float ft = ray_sphere(src, dir, &points[i], radius);
+		if (ft >= 0 && ft <= best)
+		{
+			best = ft;
+			feature = i;
+		}
+		ft = ray_edge(src, dir, &points[i], &points[(i + 1) % 3], radius);
+		if (ft >= 0 && ft <= best)
+		{
+			best = ft;
+			feature = 3 + i;
+		}
+	}
+	if (feature == -1)
+		return false;
+	struct vec3f center;
+	struct vec3f closest;
+	VEC3_MULV(tmp, *dir, best);
+	VEC3_ADD(center, *src, tmp);
+	if (feature < 3)
+		closest = points[feature];
+	else
+		closest_on_segment(&center, &points[feature - 3], &points[(feature - 2) % 3], &closest);
+	VEC3_SUB(tmp, center, closest);
+	float len = VEC3_NORM(tmp);
+	if (len < EPSILON)
+		return false;
+	VEC3_DIVV(*normp, tmp, len);
+	*tp = best;
+	return true;
+}
+
+static bool sweep_batch(const struct phys_bvh_batch *batch,
+                        const struct vec3f *src,
+                        const struct vec3f *dir,
+                        float radius,
+                        uint8_t ignore,
+                        float *tp,
+                        struct vec3f *normp)
+{
+	bool found = false;
+	for (int i = 0; i < PHYS_BVH_BATCH; ++i)
+	{
+		if (batch->flags[i] & ignore)
+			continue;
+		found |= sweep_triangle(batch, i, src, dir, radius, tp, normp);
+	}
+	return found;
+}
+
+static bool cast(const struct phys_bvh *bvh,
+                 const struct vec3f *src,
+                 const struct vec3f *dir,
+                 float radius,
+                 uint8_t ignore,
+                 float *tp,
+                 struct vec3f *normp)
+{
+	struct stack_entry stack[STACK_SIZE];
+	size_t stack_pos = 0;
+	struct vec3f inv_dir;
+	bool found = false;
+	uint32_t idx = 0;
+	float tnear;
+
+	if (!bvh->nodes_nb)
+		return false;
+	VEC3_SET(inv_dir, 1 / dir->x, 1 / dir->y, 1 / dir->z);
+	if (!ray_aabb(&bvh->nodes[0].aabb, src, &inv_dir, radius, *tp, &tnear))
+		return false;
+	while (1)
+	{
+		const struct phys_bvh_node *node = &bvh->nodes[idx];
+		if (node->count)
+		{
+			for (uint32_t i = 0; i < node->count; ++i)
+			{
+				const struct phys_bvh_batch *batch = &bvh->batches[node->offset + i];
+				if (radius > 0)
+					found |= sweep_batch(batch, src, dir, radius, ignore, tp, normp);
+				else
+					found |= ray_batch(batch, src, dir, ignore, tp, normp);
+			}
+		}
+		else
+		{
+			uint32_t left = idx + 1;
+			uint32_t right = node->offset;
+			float tleft;
+			float tright;
+			bool hleft = ray_aabb(&bvh->nodes[left].aabb, src, &inv_dir, radius, *tp, &tleft);
+			bool hright = ray_aabb(&bvh->nodes[right].aabb, src, &inv_dir, radius, *tp, &tright);
+			if (hleft && hright)
+			{
+				assert(stack_pos < STACK_SIZE);
+				if (tleft <= tright)
+				{
+					stack[stack_pos].node = right;
+					stack[stack_pos].t = tright;
+					idx = left;
+				}
+				else
+				{
+					stack[stack_pos].node = left;
+					stack[stack_pos].t = tleft;
+					idx = right;
+				}
+				stack_pos++;
+				continue;
+			}
+			if (hleft)
+			{
+				idx = left;
+				continue;
+			}
+			if (hright)
+			{
+				idx = right;
+				continue;
+			}
+		}
+		do
+		{
+			if (!stack_pos)
+				return found;
+			stack_pos--;
+		} while (stack[stack_pos].t > *tp);
+		idx = stack[stack_pos].node;
+	}
+}
+
+bool phys_bvh_cast(const struct phys_bvh *bvh, const struct phys_query *query, struct phys_hit *hit)
+{
+	return cast(bvh, &query->src, &query->dir, query->radius, query->ignore, &hit->t, &hit->norm);
+}
+
+/* instances are only rotated, translated and uniformly scaled */
+bool phys_bvh_cast_instance(const struct phys_bvh *bvh, const struct mat4f *m_inv, const struct phys_query *query, struct phys_hit *hit)
+{
+	struct vec4f tmp;
+	struct vec4f src;
+	struct vec4f dir;
+	struct vec3f norm;
+	VEC3_CPY(tmp, query->src);
+	tmp.w = 1;
+	MAT4_VEC4_MUL(src, *m_inv, tmp);
+	VEC3_CPY(tmp, query->dir);
+	tmp.w = 0;
+	MAT4_VEC4_MUL(dir, *m_inv, tmp);
+	float scale = VEC3_NORM(dir);
+	if (scale < EPSILON)
+		return false;
+	VEC3_DIVV(dir, dir, scale);
+	float t = hit->t * scale;
+	struct vec3f src3;
+	struct vec3f dir3;
+	VEC3_CPY(src3, src);
+	VEC3_CPY(dir3, dir);
+	if (!cast(bvh, &src3, &dir3, query->radius * scale, query->ignore, &t, &norm))
+		return false;
+	hit->t = t / scale;
+	/* normals are transformed by the transpose of the inverse */
+	struct vec3f n;
+	n.x = VEC3_DOT(m_inv->x, norm);
+	n.y = VEC3_DOT(m_inv->y, norm);
+	n.z = VEC3_DOT(m_inv->z, norm);
+	VEC3_NORMALIZE(float, hit->norm, n);
+	return true;
+}
+
+void phys_bvh_query_aabb(const struct phys_bvh *bvh, const struct aabb *aabb, phys_bvh_triangle_fn_t fn, void *userdata)
+{
+	uint32_t stack[STACK_SIZE];
+	size_t stack_pos = 0;
+
+	if (!bvh->nodes_nb)
+		return;
+	stack[stack_pos++] = 0;
+	while (stack_pos)
+	{
+		const struct phys_bvh_node *node = &bvh->nodes[stack[--stack_pos]];
+		if (!aabb_intersect_aabb(&node->aabb, aabb))
+			continue;
+		if (!node->count)
+		{
+			assert(stack_pos + 2 <= STACK_SIZE);
+			stack[stack_pos++] = node->offset;
+			stack[stack_pos++] = node - bvh->nodes + 1;
+			continue;
+		}
+		for (uint32_t i = 0; i < node->count; ++i)
+		{
+			const struct phys_bvh_batch *batch = &bvh->batches[node->offset + i];
+			for (int j = 0; j < PHYS_BVH_BATCH; ++j)
+			{
+				struct vec3f points[3];
+				struct vec3f e1;
+				struct vec3f e2;
+				struct aabb triangle;
+				lane_get(batch->v0, j, &points[0]);
+				lane_get(batch->e1, j, &e1);
+				lane_get(batch->e2, j, &e2);
+				if (!e1.x && !e1.y && !e1.z && !e2.x && !e2.y && !e2.z)
+					continue;
+				VEC3_ADD(points[1], points[0], e1);
+				VEC3_ADD(points[2], points[0], e2);
+				VEC3_MIN(triangle.p0, points[0], points[1]);
+				VEC3_MIN(triangle.p0, triangle.p0, points[2]);
+				VEC3_MAX(triangle.p1, points[0], points[1]);
+				VEC3_MAX(triangle.p1, triangle.p1, points[2]);
+				if (aabb_intersect_aabb(&triangle, aabb))
+					fn(points, batch->flags[j], userdata);
+			}
+		}
+	}
+}
+
+static void instance_triangle(const struct vec3f *points, uint8_t flags, void *userdata)
+{
+	struct instance_ctx *ctx = userdata;
+	struct vec3f transformed[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		struct vec4f tmp;
+		struct vec4f out;
+		VEC3_CPY(tmp, points[i]);
+		tmp.w = 1;
+		MAT4_VEC4_MUL(out, *ctx->m, tmp);
+		VEC3_CPY(transformed[i], out);
+	}
+	ctx->fn(transformed, flags, ctx->userdata);
+}
+
+void phys_bvh_query_aabb_instance(const struct phys_bvh *bvh, const struct mat4f *m, const struct mat4f *m_inv, const struct aabb *aabb, phys_bvh_triangle_fn_t fn, void *userdata)
+{
+	struct instance_ctx ctx;
+	struct aabb local = *aabb;
+
+	aabb_transform(&local, m_inv);
+	ctx.m = m;
+	ctx.fn = fn;
+	ctx.userdata = userdata;
+	phys_bvh_query_aabb(bvh, &local, instance_triangle, &ctx);
+}
@@ -0,0 +1,60 @@
+#ifndef PHYS_BVH_H
+#define PHYS_BVH_H
+
+#include <jks/aabb.h>
+#include <jks/mat4.h>
+#include <jks/vec3.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PHYS_BVH_BATCH 4 /* triangles per leaf */
+
+struct phys_query;
+struct phys_hit;
+
+/* triangles of a leaf by lane, unused lanes are degenerate (e1 = e2 = 0) */
+struct phys_bvh_batch
+{
+	float v0[3][PHYS_BVH_BATCH];
+	float e1[3][PHYS_BVH_BATCH];
+	float e2[3][PHYS_BVH_BATCH];
+	uint8_t flags[PHYS_BVH_BATCH]; /* enum phys_triangle_flag */
+};
+
+struct phys_bvh_node
+{
+	struct aabb aabb;
+	uint32_t offset; /* first batch of a leaf, right child of an inner node (the left one is the next node) */
+	uint32_t count; /* batches nb of a leaf, 0 for an inner node */
+};
+
+/*
+ * static triangle hierarchy, built once when its mesh is loaded and then only
+ * read, concurrently, by the queries; the meshes placed many times (m2, wmo)
+ * are queried in model space through the instance matrixes
+ *
+ * queries never allocate: the traversal uses a fixed size stack, which is
+ * enough as the build always splits at the median
+ */
+struct phys_bvh
+{
+	struct phys_bvh_node *nodes;
+	struct phys_bvh_batch *batches;
+	uint32_t nodes_nb;
+	uint32_t batches_nb;
+};
+
+typedef void (*phys_bvh_triangle_fn_t)(const struct vec3f *points, uint8_t flags, void *userdata);
+
+void phys_bvh_init(struct phys_bvh *bvh);
+void phys_bvh_destroy(struct phys_bvh *bvh);
+bool phys_bvh_build(struct phys_bvh *bvh, const struct vec3f *points, const uint8_t *flags, size_t triangles_nb);
+size_t phys_bvh_get_size(const struct phys_bvh *bvh);
+bool phys_bvh_cast(const struct phys_bvh *bvh, const struct phys_query *query, struct phys_hit *hit);
+bool phys_bvh_cast_instance(const struct phys_bvh *bvh, const struct mat4f *m_inv, const struct phys_query *query, struct phys_hit *hit);
+void phys_bvh_query_aabb(const struct phys_bvh *bvh, const struct aabb *aabb, phys_bvh_triangle_fn_t fn, void *userdata);
+void phys_bvh_query_aabb_instance(const struct phys_bvh *bvh, const struct mat4f *m, const struct mat4f *m_inv, const struct aabb *aabb, phys_bvh_triangle_fn_t fn, void *userdata);
+
+#endif
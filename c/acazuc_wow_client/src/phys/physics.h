@@ -1,9 +1,11 @@
 #ifndef PHYSICS_H
 #define PHYSICS_H
 
+#include <jks/aabb.h>
 #include <jks/vec3.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define GRAVITY 19.29110336303711f
 #define WALL_CLIMB 0.64278764f
@@ -11,9 +13,30 @@
 #define SPHERE_RADIUS 0.5f
 #define JUMP_VELOCITY -7.9555473f
 
-struct collision_triangle;
-struct jks_array;
+enum phys_triangle_flag
+{
+	PHYS_TRIANGLE_NOCAM = (1 << 0),
+};
 
-bool find_nearest_triangle(struct jks_array *triangles, struct vec3f src, struct vec3f dir, float dir_len, struct collision_triangle **trianglep, struct vec3f *norm, float *t);
+/* ray (radius == 0) or sphere sweep from src to src + dir * len */
+struct phys_query
+{
+	struct vec3f src;
+	struct vec3f dir; /* normalized */
+	struct aabb aabb; /* bounds of the swept volume */
+	float len;
+	float radius;
+	uint8_t ignore; /* enum phys_triangle_flag */
+};
+
+/* only hits closer than t are reported, t must be initialized to the query len */
+struct phys_hit
+{
+	struct vec3f norm; /* normalized */
+	float t;
+};
+
+bool phys_query_init(struct phys_query *query, struct vec3f src, struct vec3f dst, float radius, uint8_t ignore);
+void phys_hit_init(struct phys_hit *hit, const struct phys_query *query);
 
 #endif
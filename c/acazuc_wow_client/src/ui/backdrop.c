@@ -225,6 +225,7 @@ static void update_edge_vertexes_buffer(struct ui_backdrop *backdrop)
 
 void ui_backdrop_render(struct ui_backdrop *backdrop)
 {
+	interface_batch_flush(&backdrop->interface->batch);
 	if (backdrop->bg_file)
 	{
 		if (!backdrop->bg_initialized)
@@ -215,6 +215,7 @@ static void render(struct ui_object *object)
 		}
 		if (count)
 		{
+			interface_batch_flush(&UI_OBJECT->interface->batch);
 			gfx_bind_attributes_state(g_wow->device, &edit_box->attributes_state, &UI_OBJECT->interface->input_layout);
 			gfx_bind_pipeline_state(g_wow->device, &UI_OBJECT->interface->pipeline_states[INTERFACE_BLEND_ALPHA]);
 			const gfx_texture_t *textures = &UI_OBJECT->interface->white_pixel;
@@ -2,6 +2,7 @@
 #include "ui/font.h"
 
 #include "itf/interface.h"
+#include "itf/batch.h"
 #include "itf/font.h"
 
 #include "xml/font_string.h"
@@ -74,34 +75,26 @@ static bool ctr(struct ui_object *object, struct interface *interface, const cha
 	font_string->nonspacewrap = false;
 	font_string->max_lines = 0;
 	font_string->indented = false;
-	font_string->indices_nb = 0;
 	font_string->text_width = 0;
 	font_string->text_height = 0;
-	font_string->initialized = false;
 	font_string->dirty_buffers = true;
 	font_string->dirty_size = true;
+	font_string->vertexes_width = 0;
+	font_string->vertexes_height = 0;
 	font_string->last_font = NULL;
 	font_string->last_font_revision = 0;
 	font_string->text = NULL;
 	font_string->bypass_size = false;
+	jks_array_init(&font_string->vertexes, sizeof(struct shader_ui_input), NULL, &jks_array_memory_fn_UI);
 	load_render_font(font_string);
 	ui_font_string_update_size(font_string, ui_font_instance_get_render_font(UI_FONT_INSTANCE));
-	font_string->attributes_state = GFX_ATTRIBUTES_STATE_INIT();
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		font_string->uniform_buffers[i] = GFX_BUFFER_INIT();
-	font_string->vertexes_buffer = GFX_BUFFER_INIT();
-	font_string->indices_buffer = GFX_BUFFER_INIT();
 	return true;
 }
 
 static void dtr(struct ui_object *object)
 {
 	struct ui_font_string *font_string = (struct ui_font_string*)object;
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_delete_buffer(g_wow->device, &font_string->uniform_buffers[i]);
-	gfx_delete_buffer(g_wow->device, &font_string->vertexes_buffer);
-	gfx_delete_buffer(g_wow->device, &font_string->indices_buffer);
-	gfx_delete_attributes_state(g_wow->device, &font_string->attributes_state);
+	jks_array_destroy(&font_string->vertexes);
 	mem_free(MEM_UI, font_string->text);
 	ui_font_instance_destroy(UI_FONT_INSTANCE);
 	ui_layered_region_vtable.dtr(object);
@@ -236,43 +229,21 @@ static void render(struct ui_object *object)
 	struct interface_font *font = ui_font_instance_get_render_font(UI_FONT_INSTANCE);
 	if (!font)
 		return;
-	if (!font_string->initialized)
-	{
-		for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-			gfx_create_buffer(g_wow->device, &font_string->uniform_buffers[i], GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_ui_model_block), GFX_BUFFER_STREAM);
-		font_string->initialized = true;
-	}
-	struct shader_ui_model_block model_block;
-	VEC4_CPY(model_block.color, UI_LAYERED_REGION->vertex_color);
-	model_block.color.w *= ui_object_get_alpha(UI_OBJECT);
-	if (model_block.color.w == 0)
+	struct vec4f color;
+	VEC4_CPY(color, UI_LAYERED_REGION->vertex_color);
+	color.w *= ui_object_get_alpha(UI_OBJECT);
+	if (color.w == 0)
 		return;
-	if (font_string->dirty_buffers)
-	{
+	if (font_string->dirty_buffers
+	 || font_string->last_font != font
+	 || font_string->last_font_revision != font->atlas->revision
+	 || font_string->vertexes_width != ui_region_get_width(UI_REGION)
+	 || font_string->vertexes_height != ui_region_get_height(UI_REGION))
 		update_buffers(font_string, font);
-		font_string->last_font_revision = font->atlas->revision;
-		font_string->last_font = font;
-	}
-	if (!font_string->indices_nb)
+	if (!font_string->vertexes.size)
 		return;
-	VEC4_SET(model_block.uv_transform, 1, 0, 1, 0);
-	font_atlas_update(font->atlas);
-	if (font_string->last_font != font || font->atlas->revision != font_string->last_font_revision)
-	{
-		update_buffers(font_string, font);
-		font_string->last_font_revision = font->atlas->revision;
-		font_string->last_font = font;
-	}
-	font_atlas_bind(font->atlas, 0);
-	gfx_bind_attributes_state(g_wow->device, &font_string->attributes_state, &UI_OBJECT->interface->input_layout);
-	gfx_bind_pipeline_state(g_wow->device, &UI_OBJECT->interface->pipeline_states[INTERFACE_BLEND_ALPHA]);
-	model_block.alpha_test = 0;
-	model_block.use_mask = 0;
-	struct vec3f tmp = {(float)ui_region_get_left(UI_REGION), (float)ui_region_get_top(UI_REGION), 0};
-	MAT4_TRANSLATE(model_block.mvp, UI_OBJECT->interface->mat, tmp);
-	gfx_set_buffer_data(&font_string->uniform_buffers[g_wow->draw_frame->id], &model_block, sizeof(model_block), 0);
-	gfx_bind_constant(g_wow->device, 1, &font_string->uniform_buffers[g_wow->draw_frame->id], sizeof(model_block), 0);
-	gfx_draw_indexed(g_wow->device, font_string->indices_nb, 0);
+	struct vec2f offset = {(float)ui_region_get_left(UI_REGION), (float)ui_region_get_top(UI_REGION)};
+	interface_batch_push(&UI_OBJECT->interface->batch, &font->atlas->texture, INTERFACE_BLEND_ALPHA, INTERFACE_BATCH_ATLAS, font_string->vertexes.data, font_string->vertexes.size / 4, offset, color);
 	ui_layered_region_vtable.render(object);
 }
 
@@ -371,45 +342,25 @@ static inline char get_hex(uint32_t t)
 	return 0;
 }
 
-static bool update_char(struct interface_font *font,
-                        struct font_glyph *glyph,
+static bool update_char(struct font_glyph *glyph,
                         int32_t x, int32_t y,
                         struct vec4f color,
-                        struct jks_array *vertexes,
-                        struct jks_array *indices)
+                        struct jks_array *vertexes)
 {
 	float char_render_left = x + glyph->offset_x;
 	float char_render_top = y + glyph->offset_y;
 	float char_render_right = char_render_left + glyph->width;
 	float char_render_bottom = char_render_top + glyph->height;
-	{
-		uint16_t *tmp = jks_array_grow(indices, 6);
-		if (!tmp)
-		{
-			LOG_ERROR("failed to grow indices");
-			return false;
-		}
-		tmp[0] = vertexes->size + 0;
-		tmp[1] = vertexes->size + 1;
-		tmp[2] = vertexes->size + 2;
-		tmp[3] = vertexes->size + 0;
-		tmp[4] = vertexes->size + 2;
-		tmp[5] = vertexes->size + 3;
-	}
 	struct shader_ui_input *vertex = jks_array_grow(vertexes, 4);
 	if (!vertex)
 	{
 		LOG_ERROR("failed to grow vertex");
 		return false;
 	}
-	{
-		struct vec2f tmp[4];
-		font_glyph_tex_coords(font->font, glyph, &tmp[0].x);
-		VEC2_CPY(vertex[0].uv, tmp[0]);
-		VEC2_CPY(vertex[1].uv, tmp[1]);
-		VEC2_CPY(vertex[2].uv, tmp[2]);
-		VEC2_CPY(vertex[3].uv, tmp[3]);
-	}
+	VEC2_SET(vertex[0].uv, glyph->tex_x                , glyph->tex_y);
+	VEC2_SET(vertex[1].uv, glyph->tex_x + glyph->width , glyph->tex_y);
+	VEC2_SET(vertex[2].uv, glyph->tex_x + glyph->width , glyph->tex_y + glyph->height);
+	VEC2_SET(vertex[3].uv, glyph->tex_x                , glyph->tex_y + glyph->height);
 	VEC2_SET(vertex[0].position, char_render_left , char_render_top);
 	VEC2_SET(vertex[1].position, char_render_right, char_render_top);
 	VEC2_SET(vertex[2].position, char_render_right, char_render_bottom);
@@ -425,8 +376,7 @@ static bool update_outline(struct ui_font_string *font_string,
                            struct interface_font *font,
                            int32_t base_x, int32_t base_y,
                            int32_t max_x, int32_t spacing,
-                           struct jks_array *vertexes,
-                           struct jks_array *indices)
+                           struct jks_array *vertexes)
 {
 	enum outline_type outline = ui_font_instance_get_outline(UI_FONT_INSTANCE);
 	if (outline == OUTLINE_NONE)
@@ -491,10 +441,10 @@ static bool update_outline(struct ui_font_string *font_string,
 			y += font->font->height;
 		}
 		static const struct vec4f color = {0, 0, 0, 1};
-		if (!update_char(font, glyph,
+		if (!update_char(glyph,
 		                 x + OUTLINE_OFFSET,
 		                 y + OUTLINE_OFFSET,
-		                 color, vertexes, indices))
+		                 color, vertexes))
 			return false;
 		x += char_width;
 		x += spacing;
@@ -506,8 +456,7 @@ static bool update_shadow(struct ui_font_string *font_string,
                           struct interface_font *font,
                           int32_t base_x, int32_t base_y,
                           int32_t max_x, int32_t spacing,
-                          struct jks_array *vertexes,
-                          struct jks_array *indices)
+                          struct jks_array *vertexes)
 {
 	const struct ui_shadow *shadow = ui_font_instance_get_shadow(UI_FONT_INSTANCE);
 	if (!shadow)
@@ -594,10 +543,10 @@ static bool update_shadow(struct ui_font_string *font_string,
 		}
 		struct vec4f color;
 		VEC4_CPY(color, *shadow_color);
-		if (!update_char(font, glyph,
+		if (!update_char(glyph,
 		                 x + shadow_offset->abs.x,
 		                 y - shadow_offset->abs.y,
-		                 color, vertexes, indices))
+		                 color, vertexes))
 			return false;
 		x += char_width;
 		x += spacing;
@@ -610,7 +559,6 @@ static bool update_text(struct ui_font_string *font_string,
                         int32_t base_x, int32_t base_y,
                         int32_t max_x, int32_t spacing,
                         struct jks_array *vertexes,
-                        struct jks_array *indices,
                         struct jks_array *color_stack)
 {
 	const char *iter = font_string->text;
@@ -714,7 +662,7 @@ static bool update_text(struct ui_font_string *font_string,
 			y += font->font->height;
 		}
 		struct vec4f *color = JKS_ARRAY_GET(color_stack, color_stack->size - 1, struct vec4f);
-		if (!update_char(font, glyph, x, y, *color, vertexes, indices))
+		if (!update_char(glyph, x, y, *color, vertexes))
 			return false;
 		x += char_width;
 		x += spacing;
@@ -727,46 +675,22 @@ static void update_buffers(struct ui_font_string *font_string, struct interface_
 	if (font_string->dirty_size)
 		ui_font_string_update_size(font_string, font);
 	struct jks_array color_stack; /* struct vec4f */
-	struct jks_array vertexes; /* struct shader_ui_input */
-	struct jks_array indices; /* uint16_t */
 	jks_array_init(&color_stack, sizeof(struct vec4f), NULL, &jks_array_memory_fn_UI);
-	jks_array_init(&vertexes, sizeof(struct shader_ui_input), NULL, &jks_array_memory_fn_UI);
-	jks_array_init(&indices, sizeof(uint16_t), NULL, &jks_array_memory_fn_UI);
+	jks_array_resize(&font_string->vertexes, 0);
 	int32_t base_x = ui_font_string_get_text_left(font_string);
 	int32_t base_y = ui_font_string_get_text_top(font_string);
 	float spacing = 0;/* ui_font_instance_get_spacing(UI_FONT_INSTANCE); */
 	int32_t max_x = base_x + (OPTIONAL_ISSET(UI_REGION->size) && OPTIONAL_GET(UI_REGION->size).abs.x ? OPTIONAL_GET(UI_REGION->size).abs.x : ui_region_get_width(UI_REGION));
 	max_x++;
-	if (!update_outline(font_string, font, base_x, base_y, max_x, spacing, &vertexes, &indices))
-		goto end;
-	if (!update_shadow(font_string, font, base_x, base_y, max_x, spacing, &vertexes, &indices))
-		goto end;
-	if (!update_text(font_string, font, base_x, base_y, max_x, spacing, &vertexes, &indices, &color_stack))
-		goto end;
-	/* XXX: don't recreate if indices nb didn't changed too much (maybe allocate something like npot(indices_nb)) ? */
-	if (indices.size != font_string->indices_nb)
-	{
-		font_string->indices_nb = indices.size;
-		gfx_delete_buffer(g_wow->device, &font_string->vertexes_buffer);
-		gfx_delete_buffer(g_wow->device, &font_string->indices_buffer);
-		gfx_delete_attributes_state(g_wow->device, &font_string->attributes_state);
-		gfx_create_buffer(g_wow->device, &font_string->vertexes_buffer, GFX_BUFFER_VERTEXES, vertexes.data, vertexes.size * sizeof(struct shader_ui_input), GFX_BUFFER_STATIC);
-		gfx_create_buffer(g_wow->device, &font_string->indices_buffer, GFX_BUFFER_INDICES, indices.data, indices.size * sizeof(uint16_t), GFX_BUFFER_STATIC);
-		const struct gfx_attribute_bind binds[] =
-		{
-			{&font_string->vertexes_buffer},
-		};
-		gfx_create_attributes_state(g_wow->device, &font_string->attributes_state, binds, sizeof(binds) / sizeof(*binds), &font_string->indices_buffer, GFX_INDEX_UINT16);
-	}
-	else
-	{
-		gfx_set_buffer_data(&font_string->vertexes_buffer, vertexes.data, vertexes.size * sizeof(struct shader_ui_input), 0);
-	}
-
-end:
+	if (!update_outline(font_string, font, base_x, base_y, max_x, spacing, &font_string->vertexes)
+	 || !update_shadow(font_string, font, base_x, base_y, max_x, spacing, &font_string->vertexes)
+	 || !update_text(font_string, font, base_x, base_y, max_x, spacing, &font_string->vertexes, &color_stack))
+		jks_array_resize(&font_string->vertexes, 0);
 	jks_array_destroy(&color_stack);
-	jks_array_destroy(&vertexes);
-	jks_array_destroy(&indices);
+	font_string->vertexes_width = ui_region_get_width(UI_REGION);
+	font_string->vertexes_height = ui_region_get_height(UI_REGION);
+	font_string->last_font = font;
+	font_string->last_font_revision = font->atlas->revision;
 	font_string->dirty_buffers = false;
 }
 
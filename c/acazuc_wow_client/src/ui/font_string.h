@@ -4,7 +4,7 @@
 #include "ui/layered_region.h"
 #include "ui/font_instance.h"
 
-#include <gfx/objects.h>
+#include <jks/array.h>
 
 #ifdef interface
 # undef interface
@@ -16,22 +16,19 @@ struct ui_font_string
 {
 	struct ui_layered_region layered_region;
 	struct ui_font_instance font_instance;
-	gfx_attributes_state_t attributes_state;
-	gfx_buffer_t uniform_buffers[RENDER_FRAMES_COUNT];
-	gfx_buffer_t vertexes_buffer;
-	gfx_buffer_t indices_buffer;
+	struct jks_array vertexes; /* struct shader_ui_input, relative to the region, uv in atlas pixels */
 	int bytes;
 	char *text;
 	bool nonspacewrap;
 	int max_lines;
 	bool indented;
-	size_t indices_nb;
 	int32_t text_width;
 	int32_t text_height;
 	bool bypass_size;
-	bool initialized;
 	bool dirty_buffers;
 	bool dirty_size;
+	int32_t vertexes_width;
+	int32_t vertexes_height;
 	struct interface_font *last_font;
 	uint32_t last_font_revision;
 };
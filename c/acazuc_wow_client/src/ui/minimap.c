@@ -85,6 +85,7 @@ static void render(struct ui_object *object)
 	struct ui_minimap *minimap = (struct ui_minimap*)object;
 	if (UI_REGION->hidden)
 		return;
+	interface_batch_flush(&UI_OBJECT->interface->batch);
 	if (!minimap->initialized)
 	{
 		static const uint16_t indices[6] = {0, 1, 2, 0, 2, 3};
@@ -95,6 +95,7 @@ static void render(struct ui_object *object)
 	struct ui_model *model = (struct ui_model*)object;
 	if (model->m2 && model->m2->parent->cameras && model->camera < model->m2->parent->cameras_nb)
 	{
+		interface_batch_flush(&UI_OBJECT->interface->batch);
 		if (!model->uniform_buffers[0].handle.u64)
 		{
 			for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
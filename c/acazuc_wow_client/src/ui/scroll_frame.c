@@ -118,8 +118,10 @@ static void render(struct ui_object *object)
 			top_anchor->offset.abs.y = scroll_frame->vertical_scroll;
 			ui_object_set_dirty_coords((struct ui_object*)scroll_frame->scroll_child);
 		}
+		interface_batch_flush(&UI_OBJECT->interface->batch);
 		interface_enable_scissor(left, top, width, height);
 		ui_object_render((struct ui_object*)scroll_frame->scroll_child);
+		interface_batch_flush(&UI_OBJECT->interface->batch);
 		interface_disable_scissor();
 	}
 	ui_region_vtable.render(object);
@@ -172,6 +172,7 @@ static void render(struct ui_object *object)
 	int32_t scissor_top = (ui_region_get_top(UI_REGION) + scrolling_message_frame->text_insets.abs.top) * (g_wow->render_height / (float)UI_OBJECT->interface->height);
 	int32_t scissor_width = (ui_region_get_width(UI_REGION) - scrolling_message_frame->text_insets.abs.left - scrolling_message_frame->text_insets.abs.right) * (g_wow->render_width / (float)UI_OBJECT->interface->width);
 	int32_t scissor_height = (ui_region_get_height(UI_REGION) - scrolling_message_frame->text_insets.abs.top - scrolling_message_frame->text_insets.abs.bottom) * (g_wow->render_height / (float)UI_OBJECT->interface->height);
+	interface_batch_flush(&UI_OBJECT->interface->batch);
 	interface_enable_scissor(scissor_left, scissor_top, scissor_width, scissor_height);
 	int32_t y = 0;
 	for (size_t i = scrolling_message_frame->messages.size; i > 0; --i)
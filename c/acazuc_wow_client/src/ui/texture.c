@@ -1,6 +1,9 @@
 #include "ui/texture.h"
 
 #include "itf/interface.h"
+#include "itf/atlas.h"
+
+#include "font/atlas.h"
 
 #include "xml/texture.h"
 
@@ -41,25 +44,18 @@ static bool ctr(struct ui_object *object, struct interface *interface, const cha
 	OPTIONAL_UNSET(texture->color);
 	texture->texture = NULL;
 	texture->alpha_mode = BLEND_BLEND;
-	texture->update_tex_coords = false;
-	texture->initialized = false;
+	texture->update_tex_coords = true;
 	texture->file = NULL;
-	texture->attributes_state = GFX_ATTRIBUTES_STATE_INIT();
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		texture->uniform_buffers[i] = GFX_BUFFER_INIT();
-	texture->vertexes_buffer = GFX_BUFFER_INIT();
-	texture->indices_buffer = GFX_BUFFER_INIT();
+	texture->atlas_entry = NULL;
+	texture->vertexes_entry = NULL;
+	texture->vertexes_width = 0;
+	texture->vertexes_height = 0;
 	return true;
 }
 
 static void dtr(struct ui_object *object)
 {
 	struct ui_texture *texture = (struct ui_texture*)object;
-	for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-		gfx_delete_buffer(g_wow->device, &texture->uniform_buffers[i]);
-	gfx_delete_buffer(g_wow->device, &texture->vertexes_buffer);
-	gfx_delete_buffer(g_wow->device, &texture->indices_buffer);
-	gfx_delete_attributes_state(g_wow->device, &texture->attributes_state);
 	gx_blp_free(texture->texture);
 	mem_free(MEM_UI, texture->file);
 	ui_layered_region_vtable.dtr(object);
@@ -100,13 +96,13 @@ static void load_xml(struct ui_object *object, const struct xml_layout_frame *la
 		ui_texture_set_file(texture, file);
 }
 
-static void update_vertexes_buffer(struct ui_texture *texture)
+static void update_vertexes(struct ui_texture *texture, struct interface_atlas_entry *entry, int32_t width, int32_t height)
 {
-	struct shader_ui_input vertexes[4];
+	struct shader_ui_input *vertexes = texture->vertexes;
 	VEC2_SET(vertexes[0].position, 0, 0);
-	VEC2_SET(vertexes[1].position, 1, 0);
-	VEC2_SET(vertexes[2].position, 1, 1);
-	VEC2_SET(vertexes[3].position, 0, 1);
+	VEC2_SET(vertexes[1].position, width, 0);
+	VEC2_SET(vertexes[2].position, width, height);
+	VEC2_SET(vertexes[3].position, 0, height);
 	if (OPTIONAL_ISSET(texture->tex_coords))
 	{
 		VEC2_CPY(vertexes[0].uv, OPTIONAL_GET(texture->tex_coords).top_left);
@@ -121,6 +117,14 @@ static void update_vertexes_buffer(struct ui_texture *texture)
 		VEC2_SET(vertexes[2].uv, 1, 1);
 		VEC2_SET(vertexes[3].uv, 0, 1);
 	}
+	if (entry)
+	{
+		for (size_t i = 0; i < 4; ++i)
+		{
+			vertexes[i].uv.x = entry->x + vertexes[i].uv.x * entry->width;
+			vertexes[i].uv.y = entry->y + vertexes[i].uv.y * entry->height;
+		}
+	}
 	VEC4_SET(vertexes[0].color, 1, 1, 1, 1);
 	VEC4_SET(vertexes[1].color, 1, 1, 1, 1);
 	VEC4_SET(vertexes[2].color, 1, 1, 1, 1);
@@ -142,7 +146,57 @@ static void update_vertexes_buffer(struct ui_texture *texture)
 			VEC4_MUL(vertexes[3].color, vertexes[3].color, OPTIONAL_GET(texture->gradient).max_color);
 		}
 	}
-	gfx_set_buffer_data(&texture->vertexes_buffer, vertexes, sizeof(vertexes), 0);
+	texture->vertexes_entry = entry;
+	texture->vertexes_width = width;
+	texture->vertexes_height = height;
+	texture->update_tex_coords = false;
+}
+
+static bool tex_coords_clamped(const struct ui_texture *texture)
+{
+	if (!OPTIONAL_ISSET(texture->tex_coords))
+		return true;
+	const struct vec2f *coords = &OPTIONAL_GET(texture->tex_coords).top_left;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		if (coords[i].x < 0 || coords[i].x > 1
+		 || coords[i].y < 0 || coords[i].y > 1)
+			return false;
+	}
+	return true;
+}
+
+/* the file is drawn from the atlas if it fits in it, otherwise from its own blp */
+static struct interface_atlas_entry *get_atlas_entry(struct ui_texture *texture)
+{
+	struct interface_atlas *atlas = &UI_OBJECT->interface->atlas;
+	struct interface_atlas_entry *entry;
+	if (texture->file)
+	{
+		entry = texture->atlas_entry;
+		if (!entry || !tex_coords_clamped(texture))
+			goto blp;
+	}
+	else
+	{
+		entry = atlas->grey;
+		if (!entry)
+			return NULL;
+	}
+	switch (interface_atlas_pack(atlas, entry))
+	{
+		case INTERFACE_ATLAS_PACKED:
+			return entry;
+		case INTERFACE_ATLAS_REJECTED:
+			goto blp;
+		default:
+			return NULL;
+	}
+
+blp:
+	if (texture->texture)
+		gx_blp_ask_load(texture->texture);
+	return NULL;
 }
 
 static void render(struct ui_object *object)
@@ -150,75 +204,61 @@ static void render(struct ui_object *object)
 	struct ui_texture *texture = (struct ui_texture*)object;
 	if (UI_REGION->hidden)
 		return;
-	if (!texture->initialized)
+	struct vec4f color;
+	VEC4_CPY(color, UI_LAYERED_REGION->vertex_color);
+	if (OPTIONAL_ISSET(texture->color))
+		VEC4_MUL(color, color, OPTIONAL_GET(texture->color));
+	color.w *= ui_object_get_alpha(UI_OBJECT);
+	if (color.w == 0)
+		return;
+	struct interface_atlas_entry *entry = get_atlas_entry(texture);
+	int32_t width = ui_region_get_width(UI_REGION);
+	int32_t height = ui_region_get_height(UI_REGION);
+	if (texture->update_tex_coords
+	 || texture->vertexes_entry != entry
+	 || texture->vertexes_width != width
+	 || texture->vertexes_height != height)
+		update_vertexes(texture, entry, width, height);
+	const gfx_texture_t *gfx_texture;
+	uint32_t flags = 0;
+	if (entry)
 	{
-		static const uint16_t indices[6] = {0, 1, 2, 0, 2, 3};
-		gfx_create_buffer(g_wow->device, &texture->vertexes_buffer, GFX_BUFFER_VERTEXES, NULL, 4 * sizeof(struct shader_ui_input), GFX_BUFFER_STATIC);
-		gfx_create_buffer(g_wow->device, &texture->indices_buffer, GFX_BUFFER_INDICES, indices, sizeof(indices), GFX_BUFFER_IMMUTABLE);
-		update_vertexes_buffer(texture);
-		const struct gfx_attribute_bind binds[] =
-		{
-			{&texture->vertexes_buffer},
-		};
-		gfx_create_attributes_state(g_wow->device, &texture->attributes_state, binds, sizeof(binds) / sizeof(*binds), &texture->indices_buffer, GFX_INDEX_UINT16);
-		for (size_t i = 0; i < RENDER_FRAMES_COUNT; ++i)
-			gfx_create_buffer(g_wow->device, &texture->uniform_buffers[i], GFX_BUFFER_UNIFORM, NULL, sizeof(struct shader_ui_model_block), GFX_BUFFER_STREAM);
-		texture->initialized = true;
+		gfx_texture = &UI_OBJECT->interface->atlas.atlas->texture;
+		flags |= INTERFACE_BATCH_ATLAS;
 	}
-	else if (texture->update_tex_coords)
+	else if (texture->texture && gx_blp_flag_get(texture->texture, GX_BLP_FLAG_INITIALIZED))
 	{
-		update_vertexes_buffer(texture);
-		texture->update_tex_coords = false;
+		gfx_set_texture_addressing(&texture->texture->texture, GFX_TEXTURE_ADDRESSING_CLAMP, GFX_TEXTURE_ADDRESSING_CLAMP, GFX_TEXTURE_ADDRESSING_CLAMP);
+		gfx_texture = &texture->texture->texture;
 	}
-	struct shader_ui_model_block model_block;
-	VEC4_CPY(model_block.color, UI_LAYERED_REGION->vertex_color);
-	if (OPTIONAL_ISSET(texture->color))
-		VEC4_MUL(model_block.color, model_block.color, OPTIONAL_GET(texture->color));
-	model_block.color.w *= ui_object_get_alpha(UI_OBJECT);
-	if (model_block.color.w == 0)
-		return;
-	model_block.use_mask = 0;
-	VEC4_SET(model_block.uv_transform, 1, 0, 1, 0);
-	struct vec3f tmp = {(float)ui_region_get_left(UI_REGION), (float)ui_region_get_top(UI_REGION), 0};
-	struct vec3f scale = {(float)ui_region_get_width(UI_REGION), (float)ui_region_get_height(UI_REGION), 1};
-	MAT4_TRANSLATE(model_block.mvp, UI_OBJECT->interface->mat, tmp);
-	MAT4_SCALE(model_block.mvp, model_block.mvp, scale);
-	gfx_bind_attributes_state(g_wow->device, &texture->attributes_state, &UI_OBJECT->interface->input_layout);
+	else
 	{
-		enum interface_blend_state blend_state;
-		switch (texture->alpha_mode)
-		{
-			case BLEND_DISABLE:
-				blend_state = INTERFACE_BLEND_OPAQUE;
-				model_block.alpha_test = 0.0;
-				break;
-			default:
-				/* FALLTHROUGH */
-			case BLEND_BLEND:
-				blend_state = INTERFACE_BLEND_ALPHA;
-				model_block.alpha_test = 0.0;
-				break;
-			case BLEND_ALPHAKEY:
-				blend_state = INTERFACE_BLEND_OPAQUE;
-				model_block.alpha_test = 224.0 / 255.0;
-				break;
-			case BLEND_ADD:
-				blend_state = INTERFACE_BLEND_ADD;
-				model_block.alpha_test = 0.0;
-				break;
-			case BLEND_MOD:
-				blend_state = INTERFACE_BLEND_MOD;
-				model_block.alpha_test = 0.0;
-				break;
-		}
-		gfx_bind_pipeline_state(g_wow->device, &UI_OBJECT->interface->pipeline_states[blend_state]);
+		gfx_texture = &g_wow->grey_texture->texture;
 	}
-	gfx_set_buffer_data(&texture->uniform_buffers[g_wow->draw_frame->id], &model_block, sizeof(model_block), 0);
-	gfx_bind_constant(g_wow->device, 1, &texture->uniform_buffers[g_wow->draw_frame->id], sizeof(model_block), 0);
-	if (texture->texture && gx_blp_flag_get(texture->texture, GX_BLP_FLAG_INITIALIZED))
-		gfx_set_texture_addressing(&texture->texture->texture, GFX_TEXTURE_ADDRESSING_CLAMP, GFX_TEXTURE_ADDRESSING_CLAMP, GFX_TEXTURE_ADDRESSING_CLAMP);
-	gx_blp_bind(texture->texture, 0);
-	gfx_draw_indexed(g_wow->device, 6, 0);
+	enum interface_blend_state blend_state;
+	switch (texture->alpha_mode)
+	{
+		case BLEND_DISABLE:
+			blend_state = INTERFACE_BLEND_OPAQUE;
+			break;
+		default:
+			/* FALLTHROUGH */
+		case BLEND_BLEND:
+			blend_state = INTERFACE_BLEND_ALPHA;
+			break;
+		case BLEND_ALPHAKEY:
+			blend_state = INTERFACE_BLEND_OPAQUE;
+			flags |= INTERFACE_BATCH_ALPHA_TEST;
+			break;
+		case BLEND_ADD:
+			blend_state = INTERFACE_BLEND_ADD;
+			break;
+		case BLEND_MOD:
+			blend_state = INTERFACE_BLEND_MOD;
+			break;
+	}
+	struct vec2f offset = {(float)ui_region_get_left(UI_REGION), (float)ui_region_get_top(UI_REGION)};
+	interface_batch_push(&UI_OBJECT->interface->batch, gfx_texture, blend_state, flags, texture->vertexes, 1, offset, color);
 	ui_layered_region_vtable.render(object);
 }
 
@@ -228,6 +268,7 @@ void ui_texture_set_file(struct ui_texture *texture, const char *f)
 	{
 		texture->texture = NULL;
 		texture->file = NULL;
+		texture->atlas_entry = NULL;
 		return;
 	}
 	char file[512];
@@ -240,9 +281,8 @@ void ui_texture_set_file(struct ui_texture *texture, const char *f)
 	texture->file = mem_strdup(MEM_UI, file);
 	if (texture->file)
 	{
-		if (cache_ref_blp(g_wow->cache, texture->file, &texture->texture))
-			gx_blp_ask_load(texture->texture);
-		else
+		texture->atlas_entry = interface_atlas_get(&UI_OBJECT->interface->atlas, texture->file);
+		if (!cache_ref_blp(g_wow->cache, texture->file, &texture->texture))
 			texture->texture = NULL;
 	}
 	else
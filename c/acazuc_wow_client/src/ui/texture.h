@@ -8,29 +8,30 @@
 #include "ui/gradient.h"
 #include "ui/color.h"
 
-#include <gfx/objects.h>
+#include "shaders.h"
 
 #ifdef interface
 # undef interface
 #endif
 
+struct interface_atlas_entry;
 struct gx_blp;
 
 struct ui_texture
 {
 	struct ui_layered_region layered_region;
-	gfx_attributes_state_t attributes_state;
-	gfx_buffer_t uniform_buffers[RENDER_FRAMES_COUNT];
-	gfx_buffer_t vertexes_buffer;
-	gfx_buffer_t indices_buffer;
-	struct gx_blp *texture;
+	struct shader_ui_input vertexes[4]; /* relative to the region top left */
+	struct interface_atlas_entry *vertexes_entry; /* atlas entry of the vertexes uv, if any */
+	int32_t vertexes_width;
+	int32_t vertexes_height;
+	struct interface_atlas_entry *atlas_entry;
+	struct gx_blp *texture; /* only loaded if the file doesn't fit in the atlas */
 	struct optional_ui_tex_coords tex_coords;
 	struct optional_ui_gradient gradient;
 	struct optional_ui_color color;
 	char *file;
 	enum blend_mode alpha_mode;
 	bool update_tex_coords;
-	bool initialized;
 };
 
 extern const struct ui_object_vtable ui_texture_vtable;
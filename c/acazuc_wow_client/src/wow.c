@@ -28,6 +28,7 @@
 #include "snd/snd.h"
 
 #include "map/map.h"
+#include "phys/bench.h"
 
 #include "performance.h"
 #include "lagometer.h"
@@ -380,6 +381,32 @@ static bool setup_cache(struct wow *wow)
 	return true;
 }
 
+static bool setup_cache_budget(struct wow *wow, const char *arg)
+{
+	const char *sep = strchr(arg, '=');
+	if (!sep || (size_t)(sep - arg) >= 16)
+	{
+		LOG_ERROR("invalid cache budget: %s", arg);
+		return false;
+	}
+	char name[16];
+	memcpy(name, arg, sep - arg);
+	name[sep - arg] = '\0';
+	char *endptr;
+	unsigned long long mib = strtoull(sep + 1, &endptr, 10);
+	if (!sep[1] || *endptr)
+	{
+		LOG_ERROR("invalid cache budget: %s", arg);
+		return false;
+	}
+	if (!cache_set_budget(wow->cache, name, mib * 1024 * 1024))
+	{
+		LOG_ERROR("unknown cache: %s", name);
+		return false;
+	}
+	return true;
+}
+
 static void archive_delete(void *ptr)
 {
 	wow_mpq_archive_delete(*(struct wow_mpq_archive**)ptr);
@@ -1065,6 +1092,9 @@ static void loop(struct wow *wow)
 		started = nanotime();
 		wow->lastframetime = wow->frametime;
 		wow->frametime = nanotime();
+#ifdef WITH_MEMORY
+		mem_sample();
+#endif
 		if (wow->frametime - last_fps >= 1000000000)
 		{
 #ifdef WITH_MEMORY
@@ -1085,6 +1115,7 @@ static void loop(struct wow *wow)
 		wow->cull_frame->time = wow->frametime;
 		wow->cull_frame->dt = wow->frametime - wow->lastframetime;
 		loader_start_cull(wow->loader);
+		gx_frame_begin_render(wow->draw_frame);
 		if (wow->map && (!wow->interface || !wow->interface->is_gluescreen))
 			map_render(wow->map, wow->draw_frame);
 		gfx_bind_render_target(wow->device, NULL);
@@ -1114,7 +1145,7 @@ static void loop(struct wow *wow)
 		started = nanotime();
 		if ((wow->wow_opt & WOW_OPT_RENDER_INTERFACE) && wow->interface)
 			interface_lock(wow->interface);
-		net_tick(wow->network);
+		net_tick(wow->network, &wow->draw_frame->arena);
 		if ((wow->wow_opt & WOW_OPT_RENDER_INTERFACE) && wow->interface)
 			interface_unlock(wow->interface);
 		gfx_window_poll_events(wow->window);
@@ -1123,6 +1154,8 @@ static void loop(struct wow *wow)
 
 		started = nanotime();
 		loader_tick(wow->loader);
+		if (wow->phys_bench)
+			phys_bench_tick(wow->phys_bench);
 		gfx_device_tick(wow->device);
 		ended = nanotime();
 		wow->last_frame_misc_duration = ended - started;
@@ -1237,12 +1270,16 @@ static int wow_main(struct wow *wow, int argc, char **argv)
 		LOG_ERROR("no window backend available");
 		return EXIT_FAILURE;
 	}
-	while ((opt = getopt(argc, argv, "hm:p:ex:w:l:s:")) != -1)
+	const char *cache_budgets[8];
+	size_t cache_budgets_nb = 0;
+	const char *phys_record = NULL;
+	const char *phys_replay = NULL;
+	while ((opt = getopt(argc, argv, "hm:p:ex:w:l:s:c:R:B:N")) != -1)
 	{
 		switch (opt)
 		{
 			case 'h':
-				printf("wow [-h] [-m <mapid>] [-p <path>] [-e] [-x <device>] [-w <window>] [-l <locale>] [-s <screen>]\n");
+				printf("wow [-h] [-m <mapid>] [-p <path>] [-e] [-x <device>] [-w <window>] [-l <locale>] [-s <screen>] [-c <cache>=<MiB>] [-R <file>] [-B <file>]\n");
 				printf("-h: show this help\n");
 				printf("-m: set set mapid where to spawn\n");
 				printf("-p: set the game path\n");
@@ -1272,6 +1309,10 @@ static int wow_main(struct wow *wow, int argc, char **argv)
 					printf("\tsdl: sdl library\n");
 				printf("-l: set the locale (frFR, enUS, ..)\n");
 				printf("-s: set the boot screen (FrameXML, GlueXML)\n");
+				printf("-c: set the MiB of unused assets kept in a cache (blp, m2, wmo)\n");
+				printf("-R: record the player movements to a file\n");
+				printf("-B: benchmark the collision queries along a recorded path\n");
+				printf("-N: disable the precompiled interface cache\n");
 				return EXIT_SUCCESS;
 			case 'm':
 				mapid = atoll(optarg);
@@ -1296,6 +1337,23 @@ static int wow_main(struct wow *wow, int argc, char **argv)
 			case 's':
 				screen = optarg;
 				break;
+			case 'c':
+				if (cache_budgets_nb == sizeof(cache_budgets) / sizeof(*cache_budgets))
+				{
+					LOG_ERROR("too many cache budgets");
+					return EXIT_FAILURE;
+				}
+				cache_budgets[cache_budgets_nb++] = optarg;
+				break;
+			case 'R':
+				phys_record = optarg;
+				break;
+			case 'B':
+				phys_replay = optarg;
+				break;
+			case 'N':
+				wow->wow_opt &= ~WOW_OPT_INTERFACE_CACHE;
+				break;
 			default:
 				LOG_ERROR("unknown parameter: %c", opt);
 				return EXIT_FAILURE;
@@ -1307,6 +1365,17 @@ static int wow_main(struct wow *wow, int argc, char **argv)
 		return EXIT_FAILURE;
 	if (!setup_cache(wow))
 		return EXIT_FAILURE;
+	for (size_t i = 0; i < cache_budgets_nb; ++i)
+	{
+		if (!setup_cache_budget(wow, cache_budgets[i]))
+			return EXIT_FAILURE;
+	}
+	if (phys_record || phys_replay)
+	{
+		wow->phys_bench = phys_bench_new(phys_record, phys_replay);
+		if (!wow->phys_bench)
+			return EXIT_FAILURE;
+	}
 	if (!setup_loader(wow))
 		return EXIT_FAILURE;
 	if (!setup_gfx(wow, windowing, renderer))
@@ -1381,6 +1450,7 @@ static int wow_main(struct wow *wow, int argc, char **argv)
 	interface_delete(wow->interface);
 	network_delete(wow->network);
 	lagometer_delete(wow->lagometer);
+	phys_bench_delete(wow->phys_bench);
 	unload_dbc(wow);
 	for (size_t i = 0; i <= RENDER_FRAMES_COUNT; ++i)
 	{
@@ -1388,6 +1458,7 @@ static int wow_main(struct wow *wow, int argc, char **argv)
 		increment_frames(wow);
 		gx_frame_release_obj(wow->cull_frame);
 	}
+	cache_flush(wow->cache);
 	while (1)
 	{
 		bool done = false;
@@ -1575,6 +1646,9 @@ do \
 		case GFX_KEY_INSERT:
 			WOW_OPT_FLIP(WOW_OPT_M2_TRACK_BSEARCH);
 			break;
+		case GFX_KEY_END:
+			WOW_OPT_FLIP(WOW_OPT_M2_ANIM_LOD);
+			break;
 		case GFX_KEY_H:
 			WOW_OPT_FLIP(WOW_OPT_RENDER_GUI);
 			return;
@@ -1644,6 +1718,9 @@ do \
 		case GFX_KEY_8:
 			GX_OPT_FLIP(GX_OPT_DYN_SHADOW);
 			break;
+		case GFX_KEY_0:
+			GX_OPT_FLIP(GX_OPT_OCCLUSION);
+			break;
 		default:
 			break;
 	}
@@ -1909,7 +1986,9 @@ int main(int argc, char **argv)
 	g_wow->wow_opt |= WOW_OPT_AABB_OPTIMIZE;
 	g_wow->wow_opt |= WOW_OPT_RENDER_GUI;
 	g_wow->wow_opt |= WOW_OPT_M2_TRACK_BSEARCH;
+	g_wow->wow_opt |= WOW_OPT_M2_ANIM_LOD;
 	g_wow->wow_opt |= WOW_OPT_ASYNC_CULL;
+	g_wow->wow_opt |= WOW_OPT_INTERFACE_CACHE;
 #if defined (_WIN32)
 	{
 		LARGE_INTEGER frequency;
@@ -26,6 +26,7 @@ struct font_model;
 struct jks_array;
 struct interface;
 struct lagometer;
+struct phys_bench;
 struct gx_frame;
 struct jks_hmap;
 struct shaders;
@@ -58,6 +59,8 @@ enum wow_opt
 	WOW_OPT_VSYNC             = (1 << 6),
 	WOW_OPT_GRAVITY           = (1 << 7),
 	WOW_OPT_M2_TRACK_BSEARCH  = (1 << 8),
+	WOW_OPT_M2_ANIM_LOD       = (1 << 9),
+	WOW_OPT_INTERFACE_CACHE   = (1 << 10),
 };
 
 struct dbc_list
@@ -145,6 +148,7 @@ struct wow
 	struct camera *view_camera;
 	struct dbc_list dbc;
 	struct lagometer *lagometer;
+	struct phys_bench *phys_bench;
 	struct network *network;
 	struct social *social;
 	struct player *player;
@@ -0,0 +1,258 @@
+#include "xml/document.h"
+#include "xml/element.h"
+
+#include "memory.h"
+#include "log.h"
+
+#include <jks/hmap.h>
+
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include <string.h>
+
+MEMORY_DECL(XML);
+
+struct builder
+{
+	struct jks_array nodes; /* struct xml_document_node */
+	struct jks_array attributes; /* struct xml_document_attribute */
+	struct jks_array strings; /* char */
+	struct jks_hmap offsets; /* char*, uint32_t */
+};
+
+static bool add_string(struct builder *builder, const char *str, uint32_t *offset)
+{
+	if (!str)
+	{
+		*offset = XML_DOCUMENT_NONE;
+		return true;
+	}
+	uint32_t *existing = jks_hmap_get(&builder->offsets, JKS_HMAP_KEY_STR((char*)str));
+	if (existing)
+	{
+		*offset = *existing;
+		return true;
+	}
+	size_t len = strlen(str) + 1;
+	*offset = builder->strings.size;
+	char *dst = jks_array_grow(&builder->strings, len);
+	if (!dst)
+	{
+		LOG_ERROR("failed to grow strings");
+		return false;
+	}
+	memcpy(dst, str, len);
+	if (!jks_hmap_set(&builder->offsets, JKS_HMAP_KEY_STR((char*)str), offset))
+	{
+		LOG_ERROR("failed to add string offset");
+		return false;
+	}
+	return true;
+}
+
+static bool add_node(struct builder *builder, const xmlNode *n, uint32_t *index)
+{
+	enum xml_node_type type;
+	switch (n->type)
+	{
+		case XML_ELEMENT_NODE:
+			type = XML_NODE_ELEMENT;
+			break;
+		case XML_COMMENT_NODE:
+			type = XML_NODE_COMMENT;
+			break;
+		case XML_TEXT_NODE:
+		case XML_CDATA_SECTION_NODE:
+			type = XML_NODE_TEXT;
+			break;
+		default:
+			LOG_INFO("unknown node type: %d", n->type);
+			*index = XML_DOCUMENT_NONE;
+			return true;
+	}
+	struct xml_document_node node;
+	node.type = type;
+	node.attributes = builder->attributes.size;
+	node.attributes_nb = 0;
+	node.children = XML_DOCUMENT_NONE;
+	node.next = XML_DOCUMENT_NONE;
+	if (!add_string(builder, (const char*)n->name, &node.name)
+	 || !add_string(builder, (const char*)n->content, &node.value))
+		return false;
+	if (type == XML_NODE_ELEMENT)
+	{
+		for (const xmlAttr *attribute = n->properties; attribute; attribute = attribute->next)
+		{
+			struct xml_document_attribute attr;
+			if (!add_string(builder, (const char*)attribute->name, &attr.name)
+			 || !add_string(builder, attribute->children ? (const char*)attribute->children->content : NULL, &attr.value))
+				return false;
+			if (!jks_array_push_back(&builder->attributes, &attr))
+			{
+				LOG_ERROR("failed to push attribute");
+				return false;
+			}
+			node.attributes_nb++;
+		}
+	}
+	*index = builder->nodes.size;
+	if (!jks_array_push_back(&builder->nodes, &node))
+	{
+		LOG_ERROR("failed to push node");
+		return false;
+	}
+	if (type != XML_NODE_ELEMENT)
+		return true;
+	uint32_t prev = XML_DOCUMENT_NONE;
+	for (const xmlNode *child = n->children; child; child = child->next)
+	{
+		uint32_t child_index;
+		if (!add_node(builder, child, &child_index))
+			return false;
+		if (child_index == XML_DOCUMENT_NONE)
+			continue;
+		if (prev == XML_DOCUMENT_NONE)
+			JKS_ARRAY_GET(&builder->nodes, *index, struct xml_document_node)->children = child_index;
+		else
+			JKS_ARRAY_GET(&builder->nodes, prev, struct xml_document_node)->next = child_index;
+		prev = child_index;
+	}
+	return true;
+}
+
+static bool append(struct jks_array *data, const void *src, size_t size)
+{
+	size_t aligned = (size + 3) & ~(size_t)3;
+	uint8_t *dst = jks_array_grow(data, aligned);
+	if (!dst)
+	{
+		LOG_ERROR("failed to grow document data");
+		return false;
+	}
+	memcpy(dst, src, size);
+	memset(&dst[size], 0, aligned - size);
+	return true;
+}
+
+bool xml_document_build(struct jks_array *data, const char *xml, size_t len)
+{
+	struct builder builder;
+	bool ret = false;
+	xmlDoc *doc = xmlReadMemory(xml, len, NULL, "utf8", 0);
+	if (!doc)
+	{
+		LOG_ERROR("xmlReadMemory failed");
+		return false;
+	}
+	jks_array_init(&builder.nodes, sizeof(struct xml_document_node), NULL, &jks_array_memory_fn_XML);
+	jks_array_init(&builder.attributes, sizeof(struct xml_document_attribute), NULL, &jks_array_memory_fn_XML);
+	jks_array_init(&builder.strings, sizeof(char), NULL, &jks_array_memory_fn_XML);
+	jks_hmap_init(&builder.offsets, sizeof(uint32_t), NULL, jks_hmap_hash_str, jks_hmap_cmp_str, &jks_hmap_memory_fn_XML);
+	xmlNode *root = xmlDocGetRootElement(doc);
+	if (!root)
+	{
+		LOG_ERROR("no root node");
+		goto end;
+	}
+	struct xml_document_header header;
+	if (!add_node(&builder, root, &header.root))
+		goto end;
+	if (header.root == XML_DOCUMENT_NONE)
+	{
+		LOG_ERROR("invalid root node");
+		goto end;
+	}
+	header.magic = XML_DOCUMENT_MAGIC;
+	header.version = XML_DOCUMENT_VERSION;
+	header.nodes_nb = builder.nodes.size;
+	header.attributes_nb = builder.attributes.size;
+	header.strings_size = builder.strings.size;
+	if (!append(data, &header, sizeof(header))
+	 || !append(data, builder.nodes.data, builder.nodes.size * sizeof(struct xml_document_node))
+	 || !append(data, builder.attributes.data, builder.attributes.size * sizeof(struct xml_document_attribute))
+	 || !append(data, builder.strings.data, builder.strings.size))
+		goto end;
+	ret = true;
+
+end:
+	jks_hmap_destroy(&builder.offsets);
+	jks_array_destroy(&builder.nodes);
+	jks_array_destroy(&builder.attributes);
+	jks_array_destroy(&builder.strings);
+	xmlFreeDoc(doc);
+	xmlCleanupParser();
+	return ret;
+}
+
+static bool check_string(const struct xml_document_header *header, uint32_t offset)
+{
+	return offset == XML_DOCUMENT_NONE || offset < header->strings_size;
+}
+
+/* nodes are stored in pre-order, so a child or a next sibling always comes
+ * after its node, which guarantees that a walk through the tree terminates
+ */
+static bool check_index(uint32_t index, uint32_t node, uint32_t count)
+{
+	return index == XML_DOCUMENT_NONE || (index > node && index < count);
+}
+
+bool xml_document_load(struct xml_document *document, const void *data, size_t size)
+{
+	const struct xml_document_header *header = data;
+	if (size < sizeof(*header)
+	 || header->magic != XML_DOCUMENT_MAGIC
+	 || header->version != XML_DOCUMENT_VERSION)
+	{
+		LOG_ERROR("invalid document header");
+		return false;
+	}
+	size_t nodes_size = ((size_t)header->nodes_nb * sizeof(struct xml_document_node) + 3) & ~(size_t)3;
+	size_t attributes_size = ((size_t)header->attributes_nb * sizeof(struct xml_document_attribute) + 3) & ~(size_t)3;
+	size_t strings_size = ((size_t)header->strings_size + 3) & ~(size_t)3;
+	if (sizeof(*header) + nodes_size + attributes_size + strings_size > size
+	 || header->root >= header->nodes_nb
+	 || !header->strings_size)
+	{
+		LOG_ERROR("invalid document size");
+		return false;
+	}
+	document->header = header;
+	document->nodes = (const struct xml_document_node*)&header[1];
+	document->attributes = (const struct xml_document_attribute*)((const uint8_t*)document->nodes + nodes_size);
+	document->strings = (const char*)document->attributes + attributes_size;
+	if (document->strings[header->strings_size - 1])
+	{
+		LOG_ERROR("invalid document strings");
+		return false;
+	}
+	for (uint32_t i = 0; i < header->nodes_nb; ++i)
+	{
+		const struct xml_document_node *node = &document->nodes[i];
+		if (node->type > XML_NODE_COMMENT
+		 || node->name == XML_DOCUMENT_NONE
+		 || !check_string(header, node->name)
+		 || !check_string(header, node->value)
+		 || node->attributes > header->attributes_nb
+		 || node->attributes_nb > header->attributes_nb - node->attributes
+		 || !check_index(node->children, i, header->nodes_nb)
+		 || !check_index(node->next, i, header->nodes_nb))
+		{
+			LOG_ERROR("invalid document node");
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->attributes_nb; ++i)
+	{
+		const struct xml_document_attribute *attribute = &document->attributes[i];
+		if (attribute->name == XML_DOCUMENT_NONE
+		 || !check_string(header, attribute->name)
+		 || !check_string(header, attribute->value))
+		{
+			LOG_ERROR("invalid document attribute");
+			return false;
+		}
+	}
+	return true;
+}
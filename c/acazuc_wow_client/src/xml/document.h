@@ -0,0 +1,68 @@
+#ifndef XML_DOCUMENT_H
+#define XML_DOCUMENT_H
+
+#include <jks/array.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define XML_DOCUMENT_MAGIC   0x434D5857 /* WXMC */
+#define XML_DOCUMENT_VERSION 1
+#define XML_DOCUMENT_NONE    UINT32_MAX
+
+/*
+ * compact form of a parsed xml file
+ *
+ * every reference is an index in the nodes / attributes tables or an offset
+ * in the strings table, so the whole document is a single relocatable blob
+ * that can be written as-is to the interface cache and mapped back without
+ * any parsing
+ */
+
+struct xml_document_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nodes_nb;
+	uint32_t attributes_nb;
+	uint32_t strings_size;
+	uint32_t root;
+};
+
+struct xml_document_node
+{
+	uint32_t type; /* enum xml_node_type */
+	uint32_t name;
+	uint32_t value;
+	uint32_t attributes;
+	uint32_t attributes_nb;
+	uint32_t children;
+	uint32_t next;
+};
+
+struct xml_document_attribute
+{
+	uint32_t name;
+	uint32_t value;
+};
+
+struct xml_document
+{
+	const struct xml_document_header *header;
+	const struct xml_document_node *nodes;
+	const struct xml_document_attribute *attributes;
+	const char *strings;
+};
+
+bool xml_document_build(struct jks_array *data, const char *xml, size_t len);
+bool xml_document_load(struct xml_document *document, const void *data, size_t size);
+
+static inline const char *xml_document_string(const struct xml_document *document, uint32_t offset)
+{
+	if (offset == XML_DOCUMENT_NONE)
+		return NULL;
+	return &document->strings[offset];
+}
+
+#endif
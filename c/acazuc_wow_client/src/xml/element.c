@@ -17,6 +17,7 @@
 #include "xml/cooldown.h"
 #include "xml/edit_box.h"
 #include "xml/internal.h"
+#include "xml/document.h"
 #include "xml/include.h"
 #include "xml/texture.h"
 #include "xml/minimap.h"
@@ -30,8 +31,6 @@
 #include "memory.h"
 #include "log.h"
 
-#include <libxml/tree.h>
-
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -123,16 +122,16 @@ enum xml_parse_attribute_status xml_parse_attribute_string(const struct xml_attr
 	return XML_PARSE_ATTRIBUTE_OK;
 }
 
-static void parse_attributes(struct xml_element *element, const xmlAttr *attributes)
+static void parse_attributes(struct xml_element *element, const struct xml_node *node)
 {
-	for (const xmlAttr *attribute = attributes; attribute; attribute = attribute->next)
+	const struct xml_document *document = node->document;
+	const struct xml_document_node *n = &document->nodes[node->index];
+	for (uint32_t i = 0; i < n->attributes_nb; ++i)
 	{
+		const struct xml_document_attribute *attribute = &document->attributes[n->attributes + i];
 		struct xml_attr attr;
-		attr.name = (const char*)attribute->name;
-		if (attribute->children)
-			attr.value = (const char*)attribute->children->content;
-		else
-			attr.value = NULL;
+		attr.name = xml_document_string(document, attribute->name);
+		attr.value = xml_document_string(document, attribute->value);
 		switch (element->vtable->parse_attribute(element, &attr))
 		{
 			case XML_PARSE_ATTRIBUTE_OK:
@@ -147,12 +146,13 @@ static void parse_attributes(struct xml_element *element, const xmlAttr *attribu
 	}
 }
 
-static void parse_childs(struct xml_element *element, const xmlNode *childs)
+static void parse_childs(struct xml_element *element, const struct xml_node *parent)
 {
-	for (const xmlNode *child = childs; child; child = child->next)
+	struct xml_node node;
+	if (!xml_node_children(parent, &node))
+		return;
+	do
 	{
-		struct xml_node node;
-		xml_node_parse(&node, child);
 		switch (element->vtable->parse_child(element, &node))
 		{
 			case XML_PARSE_CHILD_OK:
@@ -170,13 +170,13 @@ static void parse_childs(struct xml_element *element, const xmlNode *childs)
 				LOG_ERROR("failed to parse <%s> child <%s>: internal error", element->vtable->name, node.name);
 				break;
 		}
-	}
+	} while (xml_node_next(&node));
 }
 
 void xml_element_parse(struct xml_element *element, const struct xml_node *node)
 {
-	parse_attributes(element, node->node->properties);
-	parse_childs(element, node->node->children);
+	parse_attributes(element, node);
+	parse_childs(element, node);
 }
 
 struct xml_layout_frame *xml_create_layout_frame(const char *name)
@@ -228,26 +228,32 @@ do \
 #undef LAYOUT_FRAME_TEST
 }
 
-void xml_node_parse(struct xml_node *node, const xmlNode *n)
+void xml_node_parse(struct xml_node *node, const struct xml_document *document, uint32_t index)
 {
-	switch (n->type)
-	{
-		case XML_ELEMENT_NODE:
-			node->type = XML_NODE_ELEMENT;
-			break;
-		case XML_COMMENT_NODE:
-			node->type = XML_NODE_COMMENT;
-			break;
-		case XML_TEXT_NODE:
-			node->type = XML_NODE_TEXT;
-			break;
-		default:
-			LOG_INFO("unknown node type: %d", n->type);
-			return;
-	}
-	node->name = (const char*)n->name;
-	node->value = (const char*)n->content;
-	node->node = n;
+	const struct xml_document_node *n = &document->nodes[index];
+	node->type = n->type;
+	node->name = xml_document_string(document, n->name);
+	node->value = xml_document_string(document, n->value);
+	node->document = document;
+	node->index = index;
+}
+
+bool xml_node_children(const struct xml_node *node, struct xml_node *child)
+{
+	uint32_t index = node->document->nodes[node->index].children;
+	if (index == XML_DOCUMENT_NONE)
+		return false;
+	xml_node_parse(child, node->document, index);
+	return true;
+}
+
+bool xml_node_next(struct xml_node *node)
+{
+	uint32_t index = node->document->nodes[node->index].next;
+	if (index == XML_DOCUMENT_NONE)
+		return false;
+	xml_node_parse(node, node->document, index);
+	return true;
 }
 
 void xml_element_delete(struct xml_element *element)
@@ -3,6 +3,9 @@
 
 #include <jks/optional.h>
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef interface
 # undef interface
 #endif
@@ -10,9 +13,9 @@
 struct interface;
 struct ui_region;
 struct ui_object;
+struct xml_document;
 struct xml_node;
 struct xml_attr;
-typedef struct _xmlNode xmlNode;
 
 struct xml_layout_frame;
 struct xml_vtable;
@@ -45,7 +48,8 @@ struct xml_node
 	enum xml_node_type type;
 	const char *name;
 	const char *value;
-	const xmlNode *node;
+	const struct xml_document *document;
+	uint32_t index;
 };
 
 struct xml_element
@@ -67,7 +71,9 @@ extern const struct xml_vtable xml_element_vtable;
 
 void xml_element_parse(struct xml_element *element, const struct xml_node *node);
 struct xml_layout_frame *xml_create_layout_frame(const char *name);
-void xml_node_parse(struct xml_node *node, const xmlNode *n);
+void xml_node_parse(struct xml_node *node, const struct xml_document *document, uint32_t index);
+bool xml_node_children(const struct xml_node *node, struct xml_node *child);
+bool xml_node_next(struct xml_node *node);
 void xml_element_delete(struct xml_element *element);
 struct ui_region *xml_load_interface(const struct xml_layout_frame *layout_frame, struct interface *interface, struct ui_region *parent);
 
@@ -4,8 +4,6 @@
 #include "memory.h"
 #include "log.h"
 
-#include <libxml/tree.h>
-
 #include <string.h>
 
 MEMORY_DECL(XML);
@@ -60,22 +58,23 @@ static enum xml_parse_child_status parse_child(struct xml_element *element, cons
 			{
 				if (strcmp(child->name, values[i]))
 					continue;
-				if (!child->node->children)
+				struct xml_node node;
+				if (!xml_node_children(child, &node))
 					return XML_PARSE_CHILD_INVALID_TYPE;
 				if (jks_hmap_get(&scripts->scripts, JKS_HMAP_KEY_PTR((void*)values[i])))
 					return XML_PARSE_CHILD_ALREADY;
 				char *val = NULL;
-				for (const xmlNode *node = child->node->children; node; node = node->next)
+				do
 				{
-					if (node->type == XML_COMMENT_NODE)
+					if (node.type == XML_NODE_COMMENT || !node.value)
 						continue;
-					if (node->type != XML_TEXT_NODE)
+					if (node.type != XML_NODE_TEXT)
 					{
 						mem_free(MEM_XML, val);
 						return XML_PARSE_CHILD_INVALID_TYPE;
 					}
 					size_t val_len = val ? strlen(val) : 0;
-					char *newval = mem_realloc(MEM_XML, val, val_len + strlen((const char*)node->content) + 1);
+					char *newval = mem_realloc(MEM_XML, val, val_len + strlen(node.value) + 1);
 					if (!newval)
 					{
 						LOG_ERROR("malloc failed");
@@ -83,9 +82,9 @@ static enum xml_parse_child_status parse_child(struct xml_element *element, cons
 						return XML_PARSE_CHILD_INTERNAL;
 					}
 					newval[val_len] = '\0';
-					strcat(newval, (const char*)node->content);
+					strcat(newval, node.value);
 					val = newval;
-				}
+				} while (xml_node_next(&node));
 				if (val)
 				{
 					char *key = mem_strdup(MEM_XML, child->name);